@@ -74,8 +74,7 @@ eIOnDemandStatus Arris_StreamControl::StreamPlay(bool usingStartNPT)
     LOG(DLOGL_FUNCTION_CALLS, "usingStartNPT: %d", usingStartNPT);
 
     eIOnDemandStatus status = ON_DEMAND_OK;
-    isAssetUpdatedNPTset = FALSE;
-    isPrecisoNset = FALSE;
+    nptModel.invalidate();
 
     if (!isStreamParametersSet && ptrOnDemand)
     {
@@ -131,7 +130,7 @@ eIOnDemandStatus Arris_StreamControl::StreamPlay(bool usingStartNPT)
 
         if (socketFd != -1)
         {
-            setupObject->SendMessage(socketFd, data, length);
+            lscpPipeline.send(socketFd, setupObject->GetReturnTransId(), LSC_PLAY, data, length);
         }
         else
         {
@@ -150,6 +149,28 @@ eIOnDemandStatus Arris_StreamControl::StreamPlay(bool usingStartNPT)
 }
 
 
+// a reply from the server is the reference the position polls are answered from until the next one
+static void syncNptModel(NptModel &model, VodLscp_Base *message)
+{
+    if (message->GetReturnStatusCode() != LSC_OK)
+    {
+        model.invalidate();
+    }
+    else if (message->GetNPT() == (i32) NPT_END)
+    {
+        model.syncSpeed(message->GetNum(), message->GetDen());
+    }
+    else if (message->GetMessageId() == LSC_PAUSE_REPLY)
+    {
+        // a paused stream does not move, whatever scale the reply carries
+        model.sync(message->GetNPT(), 0, 1);
+    }
+    else
+    {
+        model.sync(message->GetNPT(), message->GetNum(), message->GetDen());
+    }
+}
+
 void Arris_StreamControl::HandleInput(void *ptrMessage)
 {
     LOG(DLOGL_FUNCTION_CALLS, "ptrMessage: %p", ptrMessage);
@@ -166,6 +187,18 @@ void Arris_StreamControl::HandleInput(void *ptrMessage)
 
     LOG(DLOGL_NOISE, " Opcode recieved from VOD server is %d", opcode);
 
+    // the position and speed of a reply overtaken by a newer play/pause are stale
+    if ((opcode != LSC_DONE) && (lscpPipeline.complete(message->GetReturnTransId()) == kLscpReply_Superseded))
+    {
+        LOG(DLOGL_NOISE, "superseded reply opcode %d transaction-id %d", opcode, message->GetReturnTransId());
+        pthread_mutex_lock(&mutex_Arris);
+        rettransid = message->GetReturnTransId();
+        retstatus = message->GetReturnStatusCode();
+        pthread_mutex_unlock(&mutex_Arris);
+        delete message;
+        return;
+    }
+
     switch (opcode)
 
     {
@@ -173,13 +206,13 @@ void Arris_StreamControl::HandleInput(void *ptrMessage)
         LOG(DLOGL_NORMAL, "LSC_DONE");
         LOG(DLOGL_NORMAL, " numerator == %d", numerator);
         streamStarted = FALSE;
+        nptModel.invalidate();
         numerator < 0 ? ptrOnDemand->queueEvent(kOnDemandPlayBOFEvent) : ptrOnDemand->queueEvent(kOnDemandPlayEOFEvent);
         break;
 
     case LSC_PLAY_REPLY:
     case LSC_PAUSE_REPLY:
     {
-        time(&start);
         pthread_mutex_lock(&mutex_Arris);
         streamStarted = TRUE;
         if (opcode == LSC_PLAY_REPLY)
@@ -198,6 +231,7 @@ void Arris_StreamControl::HandleInput(void *ptrMessage)
         rettransid = message->GetReturnTransId();
         retstatus = message->GetReturnStatusCode();
         pthread_mutex_unlock(&mutex_Arris);
+        syncNptModel(nptModel, message);
         LOG(DLOGL_NOISE, "Updating values for transaction-id %d having Return status code %d", rettransid, retstatus);
         LOG(DLOGL_NOISE, "Updated NPT to %f", nptPosition);
         LOG(DLOGL_NOISE, "Updated numerator to %d", numerator);
@@ -217,7 +251,6 @@ void Arris_StreamControl::HandleInput(void *ptrMessage)
     break;
 
     default:
-        time(&start);
         pthread_mutex_lock(&mutex_Arris);
         streamStarted = TRUE;
         dlog(DL_MSP_ONDEMAND, DLOGL_NOISE, "Updating NPT, Num, Den received from Server");
@@ -231,6 +264,7 @@ void Arris_StreamControl::HandleInput(void *ptrMessage)
         retstatus = message->GetReturnStatusCode();
         Pause_Mode = FALSE;
         pthread_mutex_unlock(&mutex_Arris);
+        syncNptModel(nptModel, message);
         LOG(DLOGL_NOISE, "Updating values for transaction-id %d having Return status code %d",
             rettransid, retstatus);
         LOG(DLOGL_NOISE, "Updated NPT to %f", nptPosition);
@@ -288,12 +322,12 @@ Arris_StreamControl::Arris_StreamControl(OnDemand* ptrOnDemand,
 {
 
     lscpBaseObj = new VodLscp_Base();
+    if (ptrOnDemand)
+    {
+        lscpPipeline.setEventLoop(ptrOnDemand->GetEventLoop());
+    }
     pClientMetaDataContext = pClientMetaDataContext;
-    isPrecisoNset = FALSE;
-    isAssetUpdatedNPTset = FALSE;
     StreamFailCount = 0;
-    start = 0;
-    end = 0;
     Pause_Mode = FALSE;
 }
 
@@ -304,96 +338,28 @@ Arris_StreamControl::~Arris_StreamControl()
         delete lscpBaseObj;
         lscpBaseObj = NULL;
     }
+    lscpPipeline.logStats();
+    lscpPipeline.reset();
     Close(socketFd);
     socketFd = -1;
 }
 /*SL  queries the middle ware very frequently for speed and position.
  *  This causes heavy network traffic if all of those requests are converted into protocol messages.
- *  To avoid this, approximating algorithm is used which keeps track of the position as soop as the streaming starts.
- *   It needs to keep track of NPT and numerator and denominator in all cases of normal play and trick modes(FF/RW).
- *   A precision update is required from VOD server to get the actual NPT values. This results in tremendous reduction of network traffic. */
+ *  To avoid this, nptModel predicts the position from the NPT and speed of the last reply from the VOD server,
+ *  and the server is only asked when the model has to be resynced. */
 
 eIOnDemandStatus Arris_StreamControl::StreamGetPosition(float *npt)
 {
     eIOnDemandStatus status = ON_DEMAND_ERROR;
+    int32_t nptMs = 0;
+    float endNPT = 0;
 
-    float nptPos = 0;
-    int16_t num = 0, den = 0;
-    bool strmStart;
-    pthread_mutex_lock(&mutex_Arris);
-    nptPos = nptPosition;
-    num = numerator;
-    den = denominator;
-    strmStart = streamStarted;
-    static int prevNum = 1;
-    static int prevDen = 1;
-    pthread_mutex_unlock(&mutex_Arris);
-
-    if (strmStart == TRUE)
+    ptrOnDemand->GetEndPosition(&endNPT);
+    nptModel.setEnd((int32_t)(endNPT * 1000));
+    if (nptModel.position(&nptMs))
     {
-
+        *npt = (float) nptMs / 1000;
         status = ON_DEMAND_OK;
-        if (num != prevNum)
-        {
-            num = prevNum;
-            den = prevDen;
-        }
-
-
-        if (Pause_Mode)
-        {
-            *npt = (float) nptPos / 1000;
-        }
-        else if ((num == 1) && (den == 1))
-        {
-            time(&end);
-            *npt = (float)(nptPos + 1000 * (end - start)) / 1000;
-        }
-
-        else if ((num == 15) && (den == 2))
-        {
-            time(&end);
-            *npt = (float)(nptPos + 7500 * (end - start)) / 1000;
-        }
-        else if ((num == -15) || ((num == -14) && (den == 2)))
-        {
-            time(&end);
-            *npt = (float)(nptPos - 7500 * (end - start)) / 1000;
-        }
-        else
-        {
-            LOG(DLOGL_NORMAL, "Warning: VOD Server returned UnKnown");
-            status = ON_DEMAND_ERROR;
-        }
-
-        LOG(DLOGL_NORMAL, " return nptTime : %f",  *npt);
-
-        float endNPT = 0;
-        ptrOnDemand->GetEndPosition(&endNPT);
-
-        if ((((endNPT - (*npt)) < PRECISION_UPDATE) && (isPrecisoNset == FALSE))
-                || (((*npt) < PRECISION_UPDATE) && (isPrecisoNset == FALSE)))
-        {
-            pthread_mutex_lock(&mutex_Arris);
-            streamStarted = FALSE;
-            isPrecisoNset = TRUE;
-            pthread_mutex_unlock(&mutex_Arris);
-
-        }
-        if (((endNPT > ASSET_UP_NPT) && ((endNPT / (*npt)) < 2))
-                && (isAssetUpdatedNPTset == FALSE))
-        {
-            pthread_mutex_lock(&mutex_Arris);
-            streamStarted = FALSE;
-            isAssetUpdatedNPTset = TRUE;
-            pthread_mutex_unlock(&mutex_Arris);
-
-        }
-        pthread_mutex_lock(&mutex_Arris);
-        nptPosition = (*npt) * 1000;
-        pthread_mutex_unlock(&mutex_Arris);
-        time(&start);
-
     }
     else
     {
@@ -412,8 +378,8 @@ eIOnDemandStatus Arris_StreamControl::StreamGetPosition(float *npt)
 
             if (socketFd != -1)
             {
-                setupObject->SendMessage(socketFd, data, length);
                 localtransid = setupObject->GetReturnTransId();
+                lscpPipeline.send(socketFd, localtransid, LSC_STATUS, data, length);
             }
 
             delete setupObject;
@@ -452,8 +418,6 @@ eIOnDemandStatus Arris_StreamControl::StreamGetPosition(float *npt)
 
         LOG(DLOGL_SIGNIFICANT_EVENT, "Warning: VOD Server did not respond");
     }
-    prevNum = numerator;
-    prevDen = denominator;
     return status;
 }
 
@@ -486,22 +450,10 @@ eIOnDemandStatus Arris_StreamControl::StreamGetSpeed(int16_t *num, uint16_t *den
     eIOnDemandStatus status = ON_DEMAND_ERROR;
 
 
-    int16_t nm = 0, dn = 0;
-    bool strmStart;
-    pthread_mutex_lock(&mutex_Arris);
-    nm = numerator;
-    dn = denominator;
-    strmStart = streamStarted;
-    pthread_mutex_unlock(&mutex_Arris);
-
-    if (strmStart == TRUE)
+    if (nptModel.speed(num, den))
     {
-        *num = nm;
-        *den = dn;
         status = ON_DEMAND_OK;
-
     }
-
     else
     {
         uint8_t *data;
@@ -519,8 +471,8 @@ eIOnDemandStatus Arris_StreamControl::StreamGetSpeed(int16_t *num, uint16_t *den
 
             if (socketFd != -1)
             {
-                setupObject->SendMessage(socketFd, data, length);
                 localtransid = setupObject->GetReturnTransId();
+                lscpPipeline.send(socketFd, localtransid, LSC_STATUS, data, length);
             }
 
             delete setupObject;
@@ -593,8 +545,11 @@ eIOnDemandStatus Arris_StreamControl::StreamPause()
 
         if (socketFd != -1)
         {
-            setupObject->SendMessage(socketFd, data, length);
-            status = ON_DEMAND_OK;
+            nptModel.invalidate();
+            if (lscpPipeline.send(socketFd, setupObject->GetReturnTransId(), LSC_PAUSE, data, length))
+            {
+                status = ON_DEMAND_OK;
+            }
         }
 
         delete setupObject;
@@ -606,8 +561,8 @@ eIOnDemandStatus Arris_StreamControl::StreamPause()
 
 void Arris_StreamControl::ReadStreamSocketData()
 {
-    uint8_t *msgData = NULL;
-    uint32_t msgLen  = 0;
+    ui8 msgData[LSC_MSG_SIZE];
+    int32_t msgLen = 0;
     VodLscp_Base *lscpObj;
 
     LOG(DLOGL_REALLY_NOISY, " Current Fail count value is %d", StreamFailCount);
@@ -620,47 +575,34 @@ void Arris_StreamControl::ReadStreamSocketData()
             ptrOnDemand->queueEvent(kOnDemandStreamErrorEvent);
         }
 
-        bool readStatus = lscpBaseObj->ReadMessageFromSocket(GetFD(), &msgData, &msgLen);
-
-        if (readStatus)
+        // replies to pipelined commands may arrive together
+        while ((msgLen = lscpPipeline.receive(GetFD(), msgData, sizeof(msgData))) > 0)
         {
             //Reset it every time we get a successful Socket read
             StreamFailCount = 0;
 
-
             LOG(DLOGL_REALLY_NOISY, "lscpBaseObj->GetMessageTypeObject");
             lscpObj = lscpBaseObj->GetMessageTypeObject(msgData, msgLen);
-
-            if (msgData && msgLen)
+            if (lscpObj)
             {
-                if (lscpObj)
-                {
-                    //parse lscp response
-
-                    LOG(DLOGL_REALLY_NOISY, "lscpObj->ParseLscpMessageBody");
-                    lscpObj->ParseLscpMessageBody(msgData, msgLen);
-                    //Handle lscp response type
-                    HandleInput((void *)lscpObj);
-                }
-                else
-                {
-                    LOG(DLOGL_SIGNIFICANT_EVENT, "warning null lscpObj");
-                }
+                //parse lscp response
+                LOG(DLOGL_REALLY_NOISY, "lscpObj->ParseLscpMessageBody");
+                lscpObj->ParseLscpMessageBody(msgData, msgLen);
+                //Handle lscp response type, HandleInput frees it
+                HandleInput((void *)lscpObj);
             }
             else
             {
-                LOG(DLOGL_SIGNIFICANT_EVENT, "warning msgData: %p  msgLen: %d ", msgData, msgLen);
+                LOG(DLOGL_SIGNIFICANT_EVENT, "warning null lscpObj");
             }
         }
-        else
-        {
 
+        if (msgLen < 0)
+        {
             LOG(DLOGL_SIGNIFICANT_EVENT, "warning ReadMessageFromSocket for stream failed");
             StreamFailCount++;
         }
     }
-
-
 }
 
 void Arris_StreamControl::HandleStreamResp()
@@ -413,107 +413,73 @@ eIOnDemandStatus CloudDvr_SessionControl::HandleInput(void  *ptrMessage)
 void CloudDvr_SessionControl::HandleSessionConfirmResp(VodDsmcc_Base *message)
 {
     FNLOG(DL_MSP_ONDEMAND);
-    VodDsmcc_ClientSessionConfirm *sessConfirm = (VodDsmcc_ClientSessionConfirm *) message;
+    VodDsmcc_CodecSessionConfirm *sessConfirm = (VodDsmcc_CodecSessionConfirm *) message;
     //update tunning param info from response message
     if (NULL != sessConfirm)
     {
         if (sessConfirm->GetResponse() == dsmcc_RspOK)
         {
             LOG(DLOGL_REALLY_NOISY, "Received dsmcc_RspOK");
-            vector<VodDsmcc_ResourceDescriptor> resDesc = sessConfirm->GetResources();
-            vector<VodDsmcc_ResourceDescriptor>::const_iterator itrResDesc;
-            for (itrResDesc = resDesc.begin(); itrResDesc != resDesc.end(); itrResDesc++)
+            const tDsmccSessionConfirmView *view = sessConfirm->GetView();
+            for (ui32 r = 0; r < view->resourceCount; r++)
             {
-                VodDsmcc_ResourceDescriptor desc = *itrResDesc;
-                switch (desc.GetResourceDescriptorType())
+                const tDsmccResourceView *res = &view->resources[r];
+                switch (res->type)
                 {
                 case DSMCC_RESDESC_MPEGPROG:
                 {
-                    VodDsmcc_MPEGProgResData
-                    *descValue = dynamic_cast<VodDsmcc_MPEGProgResData *>(desc.GetDescValue());
-                    if (descValue)
+                    tDsmccMpegProgram program;
+                    if (VodDsmcc_Codec::decode(res, &program))
                     {
-                        mProgramNumber = descValue->GetMPEGProgramNumberValue();
+                        mProgramNumber = program.programNumber;
                         LOG(DLOGL_REALLY_NOISY, "mProgramNumber: %x ", mProgramNumber);
                     }
                 }
                 break;
                 case DSMCC_RESDESC_PHYSICALCHAN:
                 {
-                    VodDsmcc_PhysicalChannelResData
-                    *descValue =
-                        dynamic_cast<VodDsmcc_PhysicalChannelResData *>(desc.GetDescValue());
-                    if (descValue)
+                    tDsmccPhysicalChannel channel;
+                    if (VodDsmcc_Codec::decode(res, &channel))
                     {
-                        mFrequency = descValue->GetChannelIdValue();
+                        mFrequency = channel.channelId;
                         LOG(DLOGL_REALLY_NOISY, "frequency: %x ", mFrequency);
                     }
-                }
-                break;
-                case DSMCC_RESDESC_DOWNSTREAMTRANS:
-                {
-
-                }
-                break;
-                case DSMCC_RESDESC_IP:
-                {
-
                 }
                 break;
                 case DSMCC_RESDESC_ATSCMODMODE:
                 {
-
-                    VodDsmcc_ATSCModulationData
-                    *descValue =
-                        dynamic_cast<VodDsmcc_ATSCModulationData *>(desc.GetDescValue());
-                    if (descValue)
+                    tDsmccAtscModulation modulation;
+                    if (VodDsmcc_Codec::decode(res, &modulation))
                     {
-                        mMode = getCpeModFormat(descValue->GetModulationFormat());
-                        mSymbolRate = descValue->GetSymbolRate();
+                        mMode = getCpeModFormat(modulation.modulationFormat);
+                        mSymbolRate = modulation.symbolRate;
                         LOG(DLOGL_REALLY_NOISY, "mMode: %x mSymbolRate: %x ", mMode, mSymbolRate);
                     }
-                }
-                break;
-                case DSMCC_RESDESC_HEADENDID:
-                {
-
-                }
-                break;
-                case DSMCC_RESDESC_SERVERCA:
-                {
-
                 }
                 break;
                 case DSMCC_RESDESC_CLIENTCA: // for encrypted VOD asset only, N/A to clear VOD
                 {
-                    VodDsmcc_ClientCA
-                    *descValue =
-                        dynamic_cast<VodDsmcc_ClientCA *>(desc.GetDescValue());
-                    if (descValue)
+                    tDsmccClientCa clientCa;
+                    const uint8_t *caData = VodDsmcc_Codec::clientCaInfo(res, &clientCa);
+                    if (caData)
                     {
                         CakMsgRcvResult data;
-                        mCaDescriptorLength = descValue->GetCaInfoLength();
-
-                        uint8_t *caData = descValue->GetCaInfo();
-
-                        if (caData)
+                        mCaDescriptorLength = clientCa.caInfoLength;
+                        if (mpCaDescriptor)
                         {
-                            if (mpCaDescriptor)
-                            {
-                                LOG(DLOGL_ERROR, "Preventing memory leak!!! The mpCaDescriptor should be NULL");
-                                delete []mpCaDescriptor;
-                                mpCaDescriptor = NULL;
-                            }
-
-                            mpCaDescriptor = new uint8_t[mCaDescriptorLength];
-                            if (!mpCaDescriptor)
-                            {
-                                LOG(DLOGL_ERROR, "The mpCaDescriptor is NULL");
-                                break;
-                            }
+                            LOG(DLOGL_ERROR, "Preventing memory leak!!! The mpCaDescriptor should be NULL");
+                            delete []mpCaDescriptor;
+                            mpCaDescriptor = NULL;
+                        }
 
-                            memcpy(mpCaDescriptor, caData, mCaDescriptorLength);
+                        mpCaDescriptor = new uint8_t[mCaDescriptorLength];
+                        if (!mpCaDescriptor)
+                        {
+                            LOG(DLOGL_ERROR, "The mpCaDescriptor is NULL");
+                            break;
                         }
+
+                        memcpy(mpCaDescriptor, caData, mCaDescriptorLength);
                         mEncrypted = true;
                         LOG(DLOGL_MINOR_DEBUG, "caDescriptorLength: %x ", mCaDescriptorLength);
                         LOG(DLOGL_MINOR_DEBUG, " caDescriptor: ");
@@ -557,21 +523,6 @@ void CloudDvr_SessionControl::HandleSessionConfirmResp(VodDsmcc_Base *message)
                             LOG(DLOGL_ERROR, "Error: CiscoCakSessionHandler class allocation  FAILED !!!");
                         }
                     }
-                }
-                break;
-                case DSMCC_RESDESC_ETHERNETINT:
-                {
-
-                }
-                break;
-                case DSMCC_RESDESC_SERVICEGROUP:
-                {
-
-                }
-                break;
-                case DSMCC_RESDESC_VIRTUALCHAN:
-                {
-
                 }
                 break;
                 default:
@@ -579,26 +530,20 @@ void CloudDvr_SessionControl::HandleSessionConfirmResp(VodDsmcc_Base *message)
                 }
             }
 
-            //update streaming info from response message
-            VodDsmcc_UserData userData = sessConfirm->GetUserData();
-            //there is no user user data in this case
-            VodDsmcc_UserPrivateData privateData = userData.GetPrivateDataObj();
-
-            vector<VodDsmcc_Descriptor> Desc = privateData.GetDescriptor();
-            vector<VodDsmcc_Descriptor>::const_iterator itrDesc;
-            for (itrDesc = Desc.begin(); itrDesc != Desc.end(); itrDesc++)
+            //update streaming info from response message, there is no user user data in this case
+            const tDsmccDescriptorList *list = &view->privateData.list;
+            for (ui32 d = 0; d < list->count; d++)
             {
-                VodDsmcc_Descriptor desc = *itrDesc;
-                switch (desc.GetTag())
+                const tDsmccDescriptorView *desc = &list->desc[d];
+                switch (desc->tag)
                 {
                 case GENERIC_IPDESC:
                 {
-                    VodDsmcc_IPType *descType =
-                        dynamic_cast<VodDsmcc_IPType *>(desc.GetValue());
-                    if (NULL != descType)
+                    tDsmccIpDesc ip;
+                    if (VodDsmcc_Codec::decode(desc, &ip))
                     {
-                        mStreamerIp = descType->GetIPAddress();
-                        mStreamerPort = descType->GetIPPortNumber();
+                        mStreamerIp = ip.address;
+                        mStreamerPort = ip.port;
 
                         LOG(DLOGL_REALLY_NOISY, "mStreamerIp: %d mStreamerPort: %d ", mStreamerIp, mStreamerPort);
                     }
@@ -606,11 +551,10 @@ void CloudDvr_SessionControl::HandleSessionConfirmResp(VodDsmcc_Base *message)
                 break;
                 case GENERIC_STREAMHANDLE:
                 {
-                    VodDsmcc_StreamId *descType =
-                        dynamic_cast<VodDsmcc_StreamId *>(desc.GetValue());
-                    if (NULL != descType)
+                    tDsmccU32Desc handle;
+                    if (VodDsmcc_Codec::decode(desc, &handle))
                     {
-                        mStreamHandle = descType->GetStreamHandle();
+                        mStreamHandle = handle.value;
                         LOG(DLOGL_REALLY_NOISY, "mStreamHandle: %x ", mStreamHandle);
                     }
                 }
@@ -618,7 +562,6 @@ void CloudDvr_SessionControl::HandleSessionConfirmResp(VodDsmcc_Base *message)
                 default:
                     break;
                 }
-
             }
 
             if (ptrOnDemand == NULL)
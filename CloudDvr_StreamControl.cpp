@@ -26,6 +26,7 @@
 #include "CloudDvr_StreamControl.h"
 #include "eventLoop.h"
 #include "CCloudDvrConfigFileParser.h"
+#include "vodKeepAlive.h"
 
 #define DEFAULT_RTSP_KEEPALIVE_TIMEOUT 1800 //30 minutes in seconds
 
@@ -44,47 +45,53 @@ void CloudDvr_StreamControl::ResponseGETPOSITION(RTSPClient* rtspClient, int res
 {
     LOG(DLOGL_FUNCTION_CALLS, "");
 
+    // NULL when the request was sent by an earlier session of the connection
+    CloudDvr_StreamControl* pCsc = rtspClient ? ((RTSPClientInterface*)rtspClient)->answered() : NULL;
+
     if ((rtspClient == NULL) || (resultString == NULL))
     {
         LOG(DLOGL_ERROR, "Invalid Parameters. rtspClient:%p resultString:%s", rtspClient, resultString);
     }
-    else
+    else if (pCsc)
     {
-        CloudDvr_StreamControl* pCsc = ((RTSPClientInterface*)rtspClient)->pStreamControl;
-        if (pCsc)
-        {
-            pCsc->processResponseGetPos(resultCode, resultString);
-        }
-        delete[] resultString;
+        pCsc->processResponseGetPos(resultCode, resultString);
     }
+
+    if (resultString)
+        delete[] resultString;
 }
 
 void CloudDvr_StreamControl::ResponseGETSPEED(RTSPClient* rtspClient, int resultCode, char* resultString)
 {
     LOG(DLOGL_FUNCTION_CALLS, "");
 
+    // NULL when the request was sent by an earlier session of the connection
+    CloudDvr_StreamControl* pCsc = rtspClient ? ((RTSPClientInterface*)rtspClient)->answered() : NULL;
+
     if ((rtspClient == NULL) || (resultString == NULL))
     {
         LOG(DLOGL_ERROR, "Invalid Parameters. rtspClient:%p resultString:%s", rtspClient, resultString);
     }
-    else
+    else if (pCsc)
     {
-        CloudDvr_StreamControl* pCsc = ((RTSPClientInterface*)rtspClient)->pStreamControl;
-        if (pCsc)
-        {
-            pCsc->processResponseGetSpeed(resultCode, resultString);
-        }
-        delete[] resultString;
+        pCsc->processResponseGetSpeed(resultCode, resultString);
     }
+
+    if (resultString)
+        delete[] resultString;
 }
 
 void CloudDvr_StreamControl::ResponseKEEPALIVE(RTSPClient* rtspClient, int resultCode, char* resultString)
 {
-    UNUSED_PARAM(rtspClient);
-    UNUSED_PARAM(resultCode);
-
     LOG(DLOGL_FUNCTION_CALLS, "");
 
+    // for the keep-alive RTT of the session, the pointer is only a key there
+    CloudDvr_StreamControl* pCsc = rtspClient ? ((RTSPClientInterface*)rtspClient)->answered() : NULL;
+    if (pCsc)
+    {
+        VodKeepAlive::getInstance()->answered(pCsc, resultCode == RTSP_RESULT_CODE_OK);
+    }
+
     if (resultString)
         delete[] resultString;
 }
@@ -99,7 +106,7 @@ void CloudDvr_StreamControl::ResponsePAUSE(RTSPClient* rtspClient, int resultCod
     }
     else
     {
-        CloudDvr_StreamControl* pCsc = ((RTSPClientInterface*)rtspClient)->pStreamControl;
+        CloudDvr_StreamControl* pCsc = ((RTSPClientInterface*)rtspClient)->answered();
         if (pCsc)
         {
             if (pCsc->ptrOnDemand)
@@ -151,10 +158,10 @@ void CloudDvr_StreamControl::ResponsePLAY(RTSPClient* rtspClient, int resultCode
 
         LOG(DLOGL_SIGNIFICANT_EVENT, "Got a PLAY response from the RTSP streamer");
 
+        CloudDvr_StreamControl* pCsc = ((RTSPClientInterface*)rtspClient)->answered();
         EventCallbackData *evt = new EventCallbackData;
         if (evt != NULL)
         {
-            CloudDvr_StreamControl* pCsc = ((RTSPClientInterface*)rtspClient)->pStreamControl;
             if (pCsc != NULL)
             {
 
@@ -203,7 +210,8 @@ void CloudDvr_StreamControl::processPLAYResponse(void)
     {
         nptPosition = mRtspSession->playStartTime();
         LOG(DLOGL_SIGNIFICANT_EVENT, "nptPosition:%f scale:%f", nptPosition, mRtspSession->scale());
-        numerator = ((int16_t)mRtspSession->scale()) * 100;
+        numerator = (int16_t)(mRtspSession->scale() * 100);
+        nptModel.sync((int32_t)(nptPosition * 1000), numerator, denominator);
         mStatusPlayResponse = true;
     }
     else
@@ -217,7 +225,7 @@ void CloudDvr_StreamControl::processPLAYResponse(void)
 }
 
 CloudDvr_StreamControl::CloudDvr_StreamControl(OnDemand* pOnDemand, void* pClientMetaDataContext,
-        eOnDemandReqType reqType): VOD_StreamControl(pOnDemand, reqType), mRtspSession(NULL), mRtspClient(NULL), mEnv(NULL),
+        eOnDemandReqType reqType): VOD_StreamControl(pOnDemand, reqType), mRtspSession(NULL), mRtspClient(NULL),
     mStatusRespGetPos(RTSP_NO_RESPONSE_YET), mStatusRespGetSpeed(RTSP_NO_RESPONSE_YET)
 {
     LOG(DLOGL_FUNCTION_CALLS, "");
@@ -228,154 +236,50 @@ CloudDvr_StreamControl::CloudDvr_StreamControl(OnDemand* pOnDemand, void* pClien
     }
 
     UNUSED_PARAM(pClientMetaDataContext)
-    mShutDownFlag = 0;
-    mScheduler = BasicTaskScheduler::createNew();
-    mIsAssetUpdatedNPTset = true;
-    time(&mLastGetPosAccessTime);
-    time(&mLastGetPosNetworkQueryTime);
-    time(&mNow);
+    nptModel.setResyncLimit(RTSP_GETPARAMETER_QUERY_INTERVAL * 1000);
     Pause_Mode = false;
     nptPosition = START_NPT;
     mTempNumerator = numerator = 100;
     mTempDenominator = denominator = 100;
 
     mStatusPlayResponse = false;
-    mEventTimer = NULL;
-    mEventLoop = NULL;
+    mRequestSinceKeepAlive = false;
+    mKeepAliveScheduled = false;
 
-    if (pOnDemand != NULL)
-    {
-        //using existing OnDemand Event Loop
-        mEventLoop = pOnDemand->GetEventLoop();
-
-        if (!mEventLoop)
-        {
-            LOG(DLOGL_ERROR, "Failed to get OnDemand EventLoop for RTSP Keep Alive");
-        }
-    }
-    else
+    if (pOnDemand == NULL)
     {
         LOG(DLOGL_ERROR, "Invalid OnDemand pointer");
     }
 
-    if (mScheduler == NULL)
+    // created on the scheduler thread, shared by all the Cloud DVR sessions
+    mRtspSession = CloudDvrRtspTransport::getInstance()->createSession();
+    if (mRtspSession == NULL)
     {
-        LOG(DLOGL_ERROR, "Failed to create the TaskScheduler for Cloud DVR stream controller");
-    }
-    else
-    {
-        mEnv = BasicUsageEnvironment::createNew(*mScheduler);
-        if (mEnv == NULL)
-        {
-            LOG(DLOGL_ERROR, "Failed to create the UsageEnvironment for Cloud DVR stream controller");
-        }
-        else
-        {
-            LOG(DLOGL_MINOR_DEBUG, "Created the UsageEnvironment for Cloud DVR stream controller");
-            // Create a media session object
-            mRtspSession = MediaSession::createNew(*mEnv, NULL);
-            if (mRtspSession == NULL)
-            {
-                LOG(DLOGL_ERROR, "Failed to create the mRtspSession for Cloud DVR stream controller");
-            }
-        }
+        LOG(DLOGL_ERROR, "Failed to create the mRtspSession for Cloud DVR stream controller");
     }
 }
 
-bool CloudDvr_StreamControl::createTaskSchedulerThread(CloudDvr_StreamControl *pInst)
-{
-    LOG(DLOGL_FUNCTION_CALLS, "");
-
-    bool status = true;
-    if (pInst == NULL)
-    {
-        status = false;
-        LOG(DLOGL_ERROR, "Invalid CloudDVR StreamControl Instance.");
-    }
-    else
-    {
-        int ret = 0;
-        pthread_attr_t  RtspClientThreadAttr;
-        pthread_t       RtspClientThread;
-        const char threadName[]  = "RTSP Task Scheduler Thread";
-
-        pthread_attr_init(&RtspClientThreadAttr);
-        pthread_attr_setstacksize(&RtspClientThreadAttr, STACK_SIZE);
-        pthread_attr_setdetachstate(&RtspClientThreadAttr, PTHREAD_CREATE_DETACHED);
-
-        ret = pthread_create(&RtspClientThread, &RtspClientThreadAttr, TaskSchedulerThread, (void*) pInst);
-        if (0 != ret)
-        {
-            LOG(DLOGL_ERROR, ":%m: Error creating TaskSchedulerThread :%d", ret);
-            status = false;
-        }
-        else
-        {
-            ret = pthread_setname_np(RtspClientThread, threadName);
-            if (0 != ret)
-            {
-                LOG(DLOGL_ERROR, "ERROR: %m: Thread Setname Failed.%d", ret);
-                status = false;
-            }
-        }
-        pthread_attr_destroy(&RtspClientThreadAttr);
-    }
-    return status;
-}
-
-//static method
-void *CloudDvr_StreamControl::TaskSchedulerThread(void * arg)
-{
-    LOG(DLOGL_FUNCTION_CALLS, "");
-
-    CloudDvr_StreamControl* pInst = (CloudDvr_StreamControl*) arg;
-    if (pInst)
-    {
-        // All subsequent activity takes place within the event loop:
-        pInst->mEnv->taskScheduler().doEventLoop(&(pInst->mShutDownFlag));
-
-        LOG(DLOGL_NORMAL, "Exiting the TaskSchedulerThread");
-    }
-
-    return NULL;
-}
-
 CloudDvr_StreamControl::~CloudDvr_StreamControl()
 {
     LOG(DLOGL_FUNCTION_CALLS, "");
 
+    StopSessionKeepAliveTimer();
+
+    // no response handler runs for this once release() returns
     if (mRtspClient)
     {
-        LOG(DLOGL_MINOR_DEBUG, "Deleting mRtspClient");
-        Medium::close(mRtspClient);
+        LOG(DLOGL_MINOR_DEBUG, "Releasing mRtspClient");
+        CloudDvrRtspTransport::getInstance()->release(mRtspClient);
         mRtspClient = NULL;
     }
 
     if (mRtspSession)
     {
         LOG(DLOGL_MINOR_DEBUG, "Deleting mRtspSession");
-        Medium::close(mRtspSession);
+        CloudDvrRtspTransport::getInstance()->closeSession(mRtspSession);
         mRtspSession = NULL;
     }
 
-    if (mScheduler)
-    {
-        LOG(DLOGL_MINOR_DEBUG, "Deleting mScheduler");
-        delete mScheduler;
-        mScheduler = NULL;
-    }
-
-    if (mEnv)
-    {
-        LOG(DLOGL_MINOR_DEBUG, "env reclaim");
-        mEnv->reclaim();
-        mEnv = NULL;
-    }
-
-    //not freeing mEventLoop. Because
-    //just using existing OnDemand EventLoop
-    mEventLoop = NULL;
-
     //destroy mMutex_cdvr
     LOG(DLOGL_MINOR_DEBUG, "Destroying mutex");
     pthread_mutex_destroy(&mMutex_cdvr);
@@ -396,43 +300,21 @@ eIOnDemandStatus CloudDvr_StreamControl::StreamSetup(std::string url, std::strin
     {
         if (mRtspClient)
         {
-            Medium::close(mRtspClient);
+            CloudDvrRtspTransport::getInstance()->release(mRtspClient);
             mRtspClient = NULL;
         }
 
-        portNumBits tunnelOverHTTPPortNum = 0;
-        mRtspClient = RTSPClientInterface::createNew(*mEnv, NULL, VERBOSITY_LEVEL, "CloudDVR", tunnelOverHTTPPortNum);
+        LOG(DLOGL_MINOR_DEBUG, " url:%s   sessionId:%s", url.c_str(), sessionId.c_str());
+        mRtspClient = CloudDvrRtspTransport::getInstance()->acquire(url, sessionId, this);
         if (mRtspClient == NULL)
         {
-            LOG(DLOGL_ERROR, "Failed to create the rtspClient for Cloud DVR stream controller");
+            LOG(DLOGL_ERROR, "Failed to set up the rtspClient for Cloud DVR stream controller");
             status = ON_DEMAND_ERROR;
         }
         else
         {
             LOG(DLOGL_MINOR_DEBUG, "rtspClientInterface Available");
-            ((RTSPClientInterface*)mRtspClient)->pStreamControl = this;
-            LOG(DLOGL_MINOR_DEBUG, " url:%s   sessionId:%s", url.c_str(), sessionId.c_str());
-
-            if (!mRtspClient->setURL((char *) url.c_str()))
-            {
-                LOG(DLOGL_ERROR, "Couldn't set URL on the RTSP client");
-                status = ON_DEMAND_ERROR;
-            }
-            else
-            {
-                if (!mRtspClient->setSessionId((char *) sessionId.c_str()))
-                {
-                    LOG(DLOGL_ERROR, "Couldn't set sessionId on the RTSP client");
-                    status = ON_DEMAND_ERROR;
-                }
-            }
-
-            if ((status != ON_DEMAND_ERROR) && (createTaskSchedulerThread(this) == false))
-            {
-                LOG(DLOGL_ERROR, "Failed to create the RTSP Task Scheduler Thread for Cloud DVR stream controller");
-                status = ON_DEMAND_ERROR;
-            }
-
+            mHeadEnd = CloudDvrRtspTransport::headEnd(url);
         }
     }
 
@@ -464,14 +346,14 @@ eIOnDemandStatus CloudDvr_StreamControl::StreamPlay(bool usingStartNPT)
         unlockStreamerMutex();
 
         LOG(DLOGL_NOISE, "startNpt:%f speed = %f", start, scale);
-        int ret =  mRtspClient->sendPlayCommand(*mRtspSession, ResponsePLAY, start, end, scale, NULL);
-        LOG(DLOGL_REALLY_NOISY, "SendPlayCommand ret:%d", ret);
-        if (ret != 0)
+        nptModel.invalidate();
+        if (CloudDvrRtspTransport::getInstance()->sendPlay(mRtspClient, mRtspSession, ResponsePLAY, start, end, scale))
         {
             LOG(DLOGL_SIGNIFICANT_EVENT, "Sent a PlayCommand Request to the server");
             status = ON_DEMAND_OK;
-            time(&mLastGetPosAccessTime);
-            time(&mLastGetPosNetworkQueryTime);
+            lockStreamerMutex();
+            mRequestSinceKeepAlive = true;
+            unlockStreamerMutex();
         }
         else
         {
@@ -491,17 +373,64 @@ void CloudDvr_StreamControl::HandleInput(void *ptrMessage)
     LOG(DLOGL_FUNCTION_CALLS, "ptrMessage: %p", ptrMessage);
 }
 
+// Sends the GET_PARAMETER queries back to back, the second without waiting for the response to the first.
+// scale goes first: its response sets the speed, the position response then syncs nptModel at that speed
+bool CloudDvr_StreamControl::SendGetParameters(bool position, bool scale)
+{
+    bool sent = true;
+
+    lockStreamerMutex();
+    if (scale)
+    {
+        mStatusRespGetSpeed = RTSP_NO_RESPONSE_YET;
+    }
+    if (position)
+    {
+        mStatusRespGetPos = RTSP_NO_RESPONSE_YET;
+    }
+    unlockStreamerMutex();
+
+    if (scale && !CloudDvrRtspTransport::getInstance()->sendGetParameter(mRtspClient, mRtspSession, ResponseGETSPEED, "scale"))
+    {
+        LOG(DLOGL_ERROR, "GET_PARAMETER scale send error");
+        sent = false;
+    }
+    if (position && !CloudDvrRtspTransport::getInstance()->sendGetParameter(mRtspClient, mRtspSession, ResponseGETPOSITION, "position"))
+    {
+        LOG(DLOGL_ERROR, "GET_PARAMETER position send error");
+        sent = false;
+    }
+    if (sent)
+    {
+        lockStreamerMutex();
+        mRequestSinceKeepAlive = true;
+        unlockStreamerMutex();
+    }
+    return sent;
+}
+
 eIOnDemandStatus CloudDvr_StreamControl::SendKeepAlive()
 {
     LOG(DLOGL_FUNCTION_CALLS, "");
 
     eIOnDemandStatus status = ON_DEMAND_OK;
 
-    if (mRtspClient)
+    // set by the requests sent from the callers' threads
+    lockStreamerMutex();
+    bool keptAlive = mRequestSinceKeepAlive;
+    mRequestSinceKeepAlive = false;
+    unlockStreamerMutex();
+
+    if (keptAlive)
+    {
+        LOG(DLOGL_REALLY_NOISY, "Session kept alive by other requests");
+    }
+    else if (mRtspClient)
     {
-        if (mRtspClient->sendGetParameterCommand(*mRtspSession, ResponseKEEPALIVE, NULL) != 0)
+        if (CloudDvrRtspTransport::getInstance()->sendGetParameter(mRtspClient, mRtspSession, ResponseKEEPALIVE, NULL))
         {
             LOG(DLOGL_NOISE, "KeepAlive Message sent");
+            VodKeepAlive::getInstance()->sent(this);
         }
         else
         {
@@ -525,107 +454,72 @@ void CloudDvr_StreamControl::DisplayDebugInfo()
 
 /*SL  queries the middleware very frequently for speed and position.
  *  This causes heavy network traffic if all of those requests are converted into protocol messages.
- *  To avoid this, approximating algorithm is used which keeps track of the position as soon as the streaming starts.
- *   It needs to keep track of NPT and numerator and denominator in all cases of normal play and trick modes(FF/RW).
- *   A precision update is required from streamer to get the actual NPT values. This results in tremendous reduction of network traffic. */
+ *  To avoid this, nptModel predicts the position from the NPT and scale of the last response from the streamer,
+ *  and the streamer is only asked when the model has to be resynced. */
 
 eIOnDemandStatus CloudDvr_StreamControl::StreamGetPosition(float *pNpt)
 {
     eIOnDemandStatus status = ON_DEMAND_ERROR;
     uint32_t waitCount = 0;
-    float nptPos = 0;
-    int16_t num = 0, den = 0;
-    uint32_t  time_elapsed = 1;
+    int32_t nptMs = 0;
 
     LOG(DLOGL_FUNCTION_CALLS, "");
 
-    pthread_mutex_lock(&mMutex_cdvr);
-    nptPos = nptPosition;
-    num = numerator;
-    den = denominator;
-
-    pthread_mutex_unlock(&mMutex_cdvr);
-
-    int speed = 0;
+    if (ptrOnDemand)
+    {
+        float endNPT = 0;
+        ptrOnDemand->GetEndPosition(&endNPT);
+        nptModel.setEnd((int32_t)(endNPT * 1000));
+    }
 
     if (pNpt == NULL || mRtspClient == NULL)
     {
         LOG(DLOGL_ERROR, " ERROR: Invalid input parameters pNpt(%p), mRtspClient(%p)", pNpt, mRtspClient);
         status = ON_DEMAND_INVALID_INPUT_ERROR;
     }
+    else if (nptModel.position(&nptMs))
+    {
+        *pNpt = (float) nptMs / 1000;
+        status = ON_DEMAND_OK;
+        LOG(DLOGL_REALLY_NOISY, "npt=%f", *pNpt);
+    }
     else
     {
-        time(&mNow);
+        int16_t num = 0;
+        uint16_t den = 0;
 
-        if (mIsAssetUpdatedNPTset == true)
+        // after a play or pause request the speed is not known either: both are asked in one round trip
+        if (SendGetParameters(true, !nptModel.speed(&num, &den)))
         {
-            status = ON_DEMAND_OK;
-            speed =  num / den;
-
-            time_elapsed = mNow - mLastGetPosAccessTime;
-
-            LOG(DLOGL_REALLY_NOISY, "speed(%d) npt(%f) time_elapsed(%d)", speed, nptPos, time_elapsed);
-            //Pause_Mode is a base class member
-            if (Pause_Mode)
-            {
-                *pNpt = nptPos;
-            }//handled for +/- 1/2/4/8/16/64x
-            else //Not checking if the speed is supported since unsupported speed modes are not allowed to even be set
-            {
-                int deltaNpt = (speed * time_elapsed);
-                *pNpt = (nptPos + deltaNpt);
-            }
-
-            pthread_mutex_lock(&mMutex_cdvr);
-            nptPosition = *pNpt;
-            pthread_mutex_unlock(&mMutex_cdvr);
-
-            LOG(DLOGL_REALLY_NOISY, "speed:%d npt=%f", speed, nptPosition);
-            time(&mLastGetPosAccessTime);
-        }
-        else
-        {
-            if (mRtspClient->sendGetParameterCommand(*mRtspSession, ResponseGETPOSITION, "position" , NULL) != 0)
+            LOG(DLOGL_SIGNIFICANT_EVENT, "Sent a GetPosition command to the RTSP server..Waiting for the response from server..");
+            while (waitCount < RTSP_TIMEOUT * RTSP_TIMEOUT_OFFSET)
             {
-                time(&mLastGetPosNetworkQueryTime);
-                LOG(DLOGL_SIGNIFICANT_EVENT, "Sent a GetPosition command to the RTSP server..Waiting for the response from server..");
-                while (waitCount < RTSP_TIMEOUT * RTSP_TIMEOUT_OFFSET)
+                if (mStatusRespGetPos == RTSP_RESPONSE_OK)
                 {
-                    if (mStatusRespGetPos == RTSP_RESPONSE_OK)
-                    {
-                        lockStreamerMutex();
-                        *pNpt = nptPosition;
-                        unlockStreamerMutex();
-                        status = ON_DEMAND_OK;
-                        mIsAssetUpdatedNPTset = true;
-                        time(&mLastGetPosAccessTime);
-                        break;
-                    }
-                    else if (mStatusRespGetPos == RTSP_RESPONSE_ERROR)
-                    {
-                        LOG(DLOGL_ERROR, "response error for GetPosition");
-                        break;
-                    }
-
-                    waitCount++;
-                    usleep(HUNDRED_MS);
+                    lockStreamerMutex();
+                    *pNpt = nptPosition;
+                    unlockStreamerMutex();
+                    status = ON_DEMAND_OK;
+                    break;
+                }
+                else if (mStatusRespGetPos == RTSP_RESPONSE_ERROR)
+                {
+                    LOG(DLOGL_ERROR, "response error for GetPosition");
+                    break;
                 }
 
-                lockStreamerMutex();
-                mStatusRespGetPos = RTSP_NO_RESPONSE_YET;		//reset it back for use on next transaction
-                unlockStreamerMutex();
-            }
-            else
-            {
-                LOG(DLOGL_ERROR, "Error: StreamGetPosition\n");
-                status = ON_DEMAND_ERROR;
+                waitCount++;
+                usleep(HUNDRED_MS);
             }
-        }
 
-        //Querying the RTSP server with GETPARAMETER for every RTSP_GETPARAMETER_QUERY_INTERVAL seconds
-        if ((mNow - mLastGetPosNetworkQueryTime) > RTSP_GETPARAMETER_QUERY_INTERVAL)
+            lockStreamerMutex();
+            mStatusRespGetPos = RTSP_NO_RESPONSE_YET;		//reset it back for use on next transaction
+            unlockStreamerMutex();
+        }
+        else
         {
-            mIsAssetUpdatedNPTset = false;
+            LOG(DLOGL_ERROR, "Error: StreamGetPosition\n");
+            status = ON_DEMAND_ERROR;
         }
     }
 
@@ -711,9 +605,14 @@ eIOnDemandStatus CloudDvr_StreamControl::StreamGetSpeed(int16_t *num, uint16_t *
     {
         LOG(DLOGL_ERROR, "Invalid Parameters num:%p den:%p or mRtspClient:%p", num, den, mRtspClient);
     }
+    else if (nptModel.speed(num, den))
+    {
+        status = ON_DEMAND_OK;
+    }
     else
     {
-        if (mRtspClient->sendGetParameterCommand(*mRtspSession, ResponseGETSPEED, "scale" , NULL) != 0)
+        // the position is not known either, the next position poll gets the answer already on its way
+        if (SendGetParameters(true, true))
         {
             LOG(DLOGL_SIGNIFICANT_EVENT, "Sent a GetSpeed command to the RTSP server..Waiting for the response from server..");
             while (waitCount < RTSP_TIMEOUT * RTSP_TIMEOUT_OFFSET)
@@ -765,9 +664,13 @@ eIOnDemandStatus CloudDvr_StreamControl::StreamPause()
 
     if (mRtspClient != NULL)
     {
-        if (mRtspClient->sendPauseCommand(*mRtspSession, ResponsePAUSE) != 0)
+        nptModel.invalidate();
+        if (CloudDvrRtspTransport::getInstance()->sendPause(mRtspClient, mRtspSession, ResponsePAUSE))
         {
             LOG(DLOGL_SIGNIFICANT_EVENT, "Sent a Pause command to the RTSP server");
+            lockStreamerMutex();
+            mRequestSinceKeepAlive = true;
+            unlockStreamerMutex();
         }
         else
         {
@@ -790,15 +693,8 @@ eIOnDemandStatus CloudDvr_StreamControl::StreamTearDown()
 
     eIOnDemandStatus status = ON_DEMAND_OK;
     status = StreamPause();
-    mShutDownFlag = 1;
 
-    //deleting the mEventTimer
-    if (mEventTimer && mEventLoop)
-    {
-        LOG(DLOGL_MINOR_DEBUG, "Deleting RTSP KeepAlive Timer. mEventTimer %p", mEventTimer);
-        mEventLoop->delTimer(mEventTimer);
-        mEventTimer = NULL;
-    }
+    StopSessionKeepAliveTimer();
     return status;
 }
 
@@ -836,6 +732,7 @@ void CloudDvr_StreamControl::processResponseGetPos(int resultCode, char* resultS
         lockStreamerMutex();
         nptPosition = atof(resultString);
         LOG(DLOGL_REALLY_NOISY, "nptPosition %f", nptPosition);
+        nptModel.syncPosition((int32_t)(nptPosition * 1000));
         mStatusRespGetPos = RTSP_RESPONSE_OK;
         unlockStreamerMutex();
 
@@ -869,7 +766,8 @@ void CloudDvr_StreamControl::processResponseGetSpeed(int resultCode, char* resul
         LOG(DLOGL_REALLY_NOISY, "scale %f", scale);
         lockStreamerMutex();
         denominator = 100;
-        numerator = (int16_t)scale * 100;
+        numerator = (int16_t)(scale * 100);
+        nptModel.syncSpeed(numerator, denominator);
         mStatusRespGetSpeed = RTSP_RESPONSE_OK;
         unlockStreamerMutex();
 
@@ -877,26 +775,6 @@ void CloudDvr_StreamControl::processResponseGetSpeed(int resultCode, char* resul
     }
 }
 
-// Implementation of "RTSPClientInterface":
-RTSPClientInterface* RTSPClientInterface::createNew(UsageEnvironment& env, char const* rtspURL,
-        int verbosityLevel, char const* applicationName, portNumBits tunnelOverHTTPPortNum)
-{
-    return new RTSPClientInterface(env, rtspURL, verbosityLevel, applicationName, tunnelOverHTTPPortNum);
-}
-
-RTSPClientInterface::RTSPClientInterface(UsageEnvironment& env, char const* rtspURL,
-        int verbosityLevel, char const* applicationName, portNumBits tunnelOverHTTPPortNum)
-    : RTSPClient(env, rtspURL, verbosityLevel, applicationName, tunnelOverHTTPPortNum, -1)
-{
-    pStreamControl = NULL;
-}
-
-RTSPClientInterface::~RTSPClientInterface()
-{
-    LOG(DLOGL_FUNCTION_CALLS, "");
-    pStreamControl = NULL;
-}
-
 void CloudDvr_StreamControl::StartSessionKeepAliveTimer()
 {
     LOG(DLOGL_FUNCTION_CALLS, "StartSessionKeepAliveTimer");
@@ -914,22 +792,24 @@ void CloudDvr_StreamControl::StartSessionKeepAliveTimer()
 
         LOG(DLOGL_MINOR_DEBUG, "SessionTimeout Value=%d", keepAliveTime);
 
-        // Add the timer to send keepAlive at the interval defined in config.ini(session_timeout)
-        if (mEventLoop)
+        // Schedule the keepAlive at the interval defined in config.ini(session_timeout).
+        // It is due twice per interval and a due following other requests sends nothing:
+        // any request keeps the session alive, and there is at most one interval between two.
+        // The sessions to the same head-end share the wakeups of the scheduler
+        if (mKeepAliveScheduled)
         {
-            mEventTimer = mEventLoop->addTimer(EVENTTIMER_PERSIST,
-                                               keepAliveTime,
-                                               0,
-                                               SessionKeepAliveTimerCallBack,
-                                               this);
-            if (!mEventTimer)
-            {
-                LOG(DLOGL_ERROR, "Failed to add RTSP KeepAlive timer");
-            }
+            LOG(DLOGL_REALLY_NOISY, "RTSP KeepAlive timer already running");
+        }
+        else if (mRtspClient)
+        {
+            VodKeepAlive::getInstance()->add(this, mHeadEnd,
+                                             ((keepAliveTime > 1) ? keepAliveTime / 2 : 1) * 1000,
+                                             SessionKeepAliveDue, true);
+            mKeepAliveScheduled = true;
         }
         else
         {
-            LOG(DLOGL_ERROR, "Invalid RTSP KeepAlive EventLoop: %p", mEventLoop);
+            LOG(DLOGL_ERROR, "No RTSP client for the KeepAlive");
         }
     }
     else
@@ -938,32 +818,27 @@ void CloudDvr_StreamControl::StartSessionKeepAliveTimer()
     }
 }
 
-void CloudDvr_StreamControl::SessionKeepAliveTimerCallBack(int fd, short event, void *arg)
+void CloudDvr_StreamControl::StopSessionKeepAliveTimer()
 {
-    LOG(DLOGL_FUNCTION_CALLS, "SessionKeepAliveTimerCallBack");
-    UNUSED_PARAM(fd);
-    UNUSED_PARAM(event);
+    if (mKeepAliveScheduled)
+    {
+        LOG(DLOGL_MINOR_DEBUG, "Removing RTSP KeepAlive of %p", this);
+        VodKeepAlive::getInstance()->remove(this);
+        mKeepAliveScheduled = false;
+    }
+}
+
+void CloudDvr_StreamControl::SessionKeepAliveDue(void *session)
+{
+    CloudDvr_StreamControl* pCsc = reinterpret_cast<CloudDvr_StreamControl*>(session);
 
-    EventTimer* pTimer = reinterpret_cast<EventTimer*>(arg);
-    if (pTimer)
+    // sent from the OnDemand event loop, as the other requests
+    if (pCsc && pCsc->ptrOnDemand)
     {
-        CloudDvr_StreamControl* pCsc = reinterpret_cast<CloudDvr_StreamControl*>(pTimer->getUserData());
-        if (pCsc)
-        {
-            //send the RTSP KeepAlive command to keep the session active
-            eIOnDemandStatus status = pCsc->SendKeepAlive();
-            if (status != ON_DEMAND_OK)
-            {
-                LOG(DLOGL_ERROR, "RTSP SendKeepAlive returned with Error: %d", status);
-            }
-        }
-        else
-        {
-            LOG(DLOGL_ERROR, "Invalid pCsc: %p", pCsc);
-        }
+        pCsc->ptrOnDemand->queueEvent(kOnDemandEventSessKeepAlive);
     }
     else
     {
-        LOG(DLOGL_ERROR, "Invalid RTSP Keep Alive pTimer: %p", pTimer);
+        LOG(DLOGL_ERROR, "Invalid pCsc: %p", pCsc);
     }
 }
@@ -22,6 +22,7 @@
 #include "BasicUsageEnvironment.hh"
 #include "UsageEnvironment.hh"
 #include "GroupsockHelper.hh"
+#include "cloudDvrRtspTransport.h"
 
 using namespace std;
 
@@ -34,11 +35,9 @@ using namespace std;
 #ifndef UNUSED_PARAM
 #define UNUSED_PARAM(x) 			(void)x;
 #endif
-#define VERBOSITY_LEVEL				0			//TODO: Should be changed to 0 when integrated with msp code
 #define HUNDRED_MS 					100000
 #define RTSP_TIMEOUT 				3			//Maximum time in seconds until the caller thread waits before returning.
 #define CLOUD_KEEP_ALIVE_TIMER		5
-#define STACK_SIZE					(1024*256)
 #define RTSP_TIMEOUT_OFFSET			10
 #define LIBEVENT_ADD_EVENT_SUCCESS	0
 #define LIBEVENT_TIMEOUT_FD			-1
@@ -85,11 +84,6 @@ public:
     void StreamSetNPT(float npt);
     eIOnDemandStatus StreamGetParameter();
 
-    /**
-     * \brief This thread keeps the StreamController socket open and checks it for any responsed or asynchronous messages from the RTSP servers
-     */
-    static void *TaskSchedulerThread(void * arg);
-
     /**
     * \brief    Mutex protection to provide Thread Safety.
     */
@@ -105,6 +99,10 @@ public:
     void setPauseMode(bool isPaused)
     {
         Pause_Mode = isPaused;
+        if (isPaused)
+        {
+            nptModel.syncSpeed(0, 1);
+        }
     };
 
     void HandleStreamResp();
@@ -113,31 +111,15 @@ public:
     void ReadStreamSocketData();
 
     /**
-     * \brief Timer Callback function for triggering KeepAlive command
+     * \brief Called by the keep-alive scheduler, queues the KeepAlive command to the OnDemand event loop
      */
-    static void SessionKeepAliveTimerCallBack(int fd, short event, void *arg);
+    static void SessionKeepAliveDue(void *session);
 private:
 
-
-    /**
-     * \brief The following varibales keep track of the time the last getposotion query was sent to the server
-     * so that after RTSP_GETPARAMETER_QUERY_INTERVAL seconds another query can be sent to sync the npt value with the server's
-     */
-    time_t mLastGetPosNetworkQueryTime;
-    bool mIsAssetUpdatedNPTset;
-
-    /**
-     * \brief This is used to calculate the npt in the approximation algorithm
-     */
-    time_t mNow;
-    time_t mLastGetPosAccessTime;
-
-
     //Member variables that maintain the Session related information
     MediaSession*		mRtspSession;
-    RTSPClient*			mRtspClient;
-    TaskScheduler* 		mScheduler;
-    UsageEnvironment* 	mEnv;
+    RTSPClientInterface*	mRtspClient;
+    std::string			mHeadEnd;			//host:port of the stream URL
 
     //Response status variables 1=OK,-1=ERROR,0=NO RESPONSE YET
     int16_t 	mStatusRespGetPos;
@@ -152,19 +134,18 @@ private:
     //Helps in updating the current npt position
     bool 		mStatusPlayResponse;
 
-    //Used to control the taskscheduler event loop
-    char mShutDownFlag;
+    //Set by every request sent, the next KeepAlive timer tick need not send one; under mMutex_cdvr
+    bool mRequestSinceKeepAlive;
 
     pthread_mutex_t mMutex_cdvr;;
 
-    //EventLoop and Timer variable used to add timer for KeepAlive
-    EventLoop*  mEventLoop;
-    EventTimer* mEventTimer;
+    //Scheduled with the keep-alive scheduler after the first PLAY
+    bool mKeepAliveScheduled;
 
     /**
-     * \brief Function to create the taskscheduler thread
+     * \brief Pipelines the GET_PARAMETER queries for position and/or scale
      */
-    bool createTaskSchedulerThread(CloudDvr_StreamControl *pInst);
+    bool SendGetParameters(bool position, bool scale);
 
     /**
      * \brief RTSP 'response handlers'
@@ -185,22 +166,10 @@ private:
     bool IsCurrentSpeedSupported(float speed);
 
     /**
-     * \brief Timer to trigger the KeepAlive command to have the session active
+     * \brief Schedules the KeepAlive command to have the session active
      */
     void StartSessionKeepAliveTimer();
+    void StopSessionKeepAliveTimer();
 };
 
-class RTSPClientInterface : public RTSPClient
-{
-public:
-    static RTSPClientInterface* createNew(UsageEnvironment& env, char const* rtspURL, int verbosityLevel = 0,
-                                          char const* applicationName = NULL, portNumBits tunnelOverHTTPPortNum = 0);
-protected:
-    RTSPClientInterface(UsageEnvironment& env, char const* rtspURL, int verbosityLevel,
-                        char const* applicationName, portNumBits tunnelOverHTTPPortNum);
-    // called only by createNew();
-    virtual ~RTSPClientInterface();
-public:
-    CloudDvr_StreamControl* pStreamControl;
-};
 #endif
@@ -33,9 +33,9 @@
 ///////////////////////////////////////////////////////////////////////////
 #include "HnOnDemandStreamer.h"
 #include "eventQueue.h"
+#include "MSPWorkerPool.h"
 #include "SeaChange_SessionControl.h"
 #include "SeaChange_StreamControl.h"
-#include "pthread_named.h"
 #include <sail-message-api.h>
 #include <csci-base-message-api.h>
 ///////////////////////////////////////////////////////////////////////////
@@ -62,7 +62,7 @@ HnOnDemandStreamer::HnOnDemandStreamer()
 
     mPsi 	= NULL;  /**< pointer to our PSI instance, NULL if not created yet */
     mPtrAnalogPsi  = NULL;
-    mEventHandlerThread = 0;
+    mEventStrand = NULL;
     mSessionId = 0;
 
     mCallbackList.clear();
@@ -442,19 +442,20 @@ void HnOnDemandStreamer::Eject()
 {
     FNLOG(DL_MSP_ONDEMAND);
 
-    if (mEventHandlerThread)
+    if (mEventStrand)
     {
-        LOG(DLOGL_REALLY_NOISY, "exit thread");
-        queueEvent(kZapperEventExit);  // tell thread to exit first. so that, it don't process any stale callbacks from core modules,that may come during the process of teardown.
+        LOG(DLOGL_REALLY_NOISY, "exit strand");
+        queueEvent(kZapperEventExit);  // tell strand to exit first. so that, it don't process any stale callbacks from core modules,that may come during the process of teardown.
         unLockMutex();
-        pthread_join(mEventHandlerThread, NULL);       // wait for event thread to exit
+        mEventStrand->join();       // wait for exit event to be handled
+        delete mEventStrand;
         lockMutex();
-        mEventHandlerThread = 0;
+        mEventStrand = NULL;
         tearDown();
     }
     else
     {
-        LOG(DLOGL_REALLY_NOISY, "mEventHandlerThread null");
+        LOG(DLOGL_REALLY_NOISY, "mEventStrand null");
     }
 
     unLockMutex();
@@ -546,7 +547,7 @@ eIMediaPlayerStatus HnOnDemandStreamer::loadSource(void)
             LOG(DLOGL_ERROR, "HnOnDemandRFSource load failed");
             mediaPlayerStatus = kMediaPlayerStatus_Error_InvalidURL;
         }
-        else if (mEventHandlerThread == 0)
+        else if (mEventStrand == NULL)
         {
             int err = createEventThread();
             if (!err)
@@ -563,7 +564,7 @@ eIMediaPlayerStatus HnOnDemandStreamer::loadSource(void)
         }
         else
         {
-            LOG(DLOGL_REALLY_NOISY, "createEventThread is not called since mEventHandlerThread is %d", (int)mEventHandlerThread);
+            LOG(DLOGL_REALLY_NOISY, "createEventThread is not called since mEventStrand is %p", mEventStrand);
         }
     }
 
@@ -578,74 +579,49 @@ eIMediaPlayerStatus HnOnDemandStreamer::loadSource(void)
 // return 0 on success
 int HnOnDemandStreamer::createEventThread(void)
 {
-    pthread_attr_t attr;
-    pthread_attr_init(&attr);
-    pthread_attr_setstacksize(&attr, (128 * 1024));
-    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
-
-    // By default the thread is created as joinable.
-    int err  = pthread_create(&mEventHandlerThread, &attr, eventthreadFunc, (void *) this);
-    if (!err)
-    {
-        // failing to set name is not considered an major error
-        int retval = pthread_setname_np(mEventHandlerThread, "MSP_HnOnDemandStreamer_EvntHandlr");
-        if (retval)
-        {
-            LOG(DLOGL_ERROR, "pthread_setname_np error: %d", retval);
-        }
-    }
-    else
-    {
-        LOG(DLOGL_ERROR, "pthread_create error %d", err);
-    }
-
-    pthread_attr_destroy(&attr);
+    // events are handled on the shared MSP worker pool, serially for this instance
+    mEventStrand = new MSPStrand("MSP_HnOnDemandStreamer_EvntHandlr", mThreadEventQueue, eventHandler, eventIdleTimeout, (void *) this);
+    mEventStrand->start();
 
-    return err;
+    return 0;
 }
 
 
 
 /** *********************************************************
 */
-void* HnOnDemandStreamer::eventthreadFunc(void *data)
+bool HnOnDemandStreamer::eventHandler(void *data, Event *evt)
 {
-    // This is a static method running in a pthread and does not have
+    // This is a static method running on an MSP worker pool thread and does not have
     // direct access to class variables.  Access is through data pointer.
 
-    FNLOG(DL_MSP_ONDEMAND);
-
     HnOnDemandStreamer* inst  = (HnOnDemandStreamer*)data;
-    if (!inst)
-    {
-        LOG(DLOGL_ERROR, "HnOnDemandStreamer instance is NULL here");
-        return NULL;
-    }
-
     MSPEventQueue* eventQueue = inst->mThreadEventQueue;
     assert(eventQueue);
 
-    bool done = false;
-    while (!done)
+    inst->lockMutex();
+    bool done = inst->handleEvent(evt);  // call member function to handle event
+    eventQueue->freeEvent(evt);
+    inst->unLockMutex();
+
+    if (done)
     {
-        unsigned int waitTime = 0;
-        if (inst->mOndemandZapperState == kZapperWaitSourceReady)
-        {
-            waitTime = 5;
-            LOG(DLOGL_REALLY_NOISY, "Wait %d seconds for tuner lock", waitTime);
-        }
-        eventQueue->setTimeOutSecs(waitTime);
-        Event* evt = eventQueue->popEventQueue();
-        eventQueue->unSetTimeOut();
-        inst->lockMutex();
-        done = inst->handleEvent(evt);  // call member function to handle event
-        eventQueue->freeEvent(evt);
-        inst->unLockMutex();
+        LOG(DLOGL_REALLY_NOISY, "MSP_HnOnDemandStreamer_EvntHandlr strand exit");
     }
+    return done;
+}
+
+unsigned int HnOnDemandStreamer::eventIdleTimeout(void *data)
+{
+    HnOnDemandStreamer* inst  = (HnOnDemandStreamer*)data;
+    unsigned int waitTime = 0;
 
-    LOG(DLOGL_REALLY_NOISY, "MSP_HnOnDemandStreamer_EvntHandlr thread exit");
-    pthread_exit(NULL);
-    return NULL;
+    if (inst->mOndemandZapperState == kZapperWaitSourceReady)
+    {
+        waitTime = 5;
+        LOG(DLOGL_REALLY_NOISY, "Wait %d seconds for tuner lock", waitTime);
+    }
+    return waitTime;
 }
 
 /** *********************************************************
@@ -12,6 +12,8 @@
 #include "cpe_cam.h"
 #include "InMemoryStream.h"
 
+class MSPStrand;
+
 
 typedef enum
 {
@@ -66,7 +68,8 @@ private:
     eIMediaPlayerStatus DetachCallback(IMediaPlayerStatusCallback cb);
 
     int  createEventThread(void);
-    static void* eventthreadFunc(void *data);
+    static bool eventHandler(void *data, Event *evt);
+    static unsigned int eventIdleTimeout(void *data);
     static void psiCallback(ePsiCallBackState state, void *data);
     static void hnOnDemandRFSourceCB(void *data, eSourceState aSrcState);
     eIMediaPlayerStatus RegisterCCICallback(void* data, CCIcallback_t cb);
@@ -77,7 +80,7 @@ private:
     MSPHnOnDemandStreamerSource *mPtrHnOnDemandStreamerSource;
     eZapperState mOndemandZapperState;
     MSPEventQueue* mThreadEventQueue;
-    pthread_t mEventHandlerThread;
+    MSPStrand* mEventStrand;           // runs mThreadEventQueue on the shared MSP worker pool
     Psi *mPsi;  /**< pointer to our PSI instance, NULL if not created yet */
     AnalogPsi *mPtrAnalogPsi;
     uint32_t mSessionId;
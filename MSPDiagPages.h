@@ -157,6 +157,19 @@ extern "C"
         ///< descriptor is present.
     } DiagComponentsInfo_t;
 
+    /**
+    * This provides the PAT/PMT section cache counters of the PSI module
+    */
+    typedef struct
+    {
+        uint32_t hits;      ///< sections skipped because an identical one was already parsed
+        uint32_t misses;    ///< sections copied and parsed
+        uint32_t entries;   ///< programs currently cached
+        uint32_t warmHits;      ///< channels started from a warm PMT
+        uint32_t warmMisses;    ///< channels that had to wait for the live PMT
+        uint32_t warmStale;     ///< warm PMTs replaced because the live PMT differed
+    } DiagMspPsiCacheInfo;
+
     eCsciMspDiagStatus Csci_Diag_GetMspVodInfo(DiagMspVodInfo *diagInfo);
 
     eCsciMspDiagStatus Csci_Diag_GetMspNetworkInfo(DiagMspNetworkInfo *diagInfo);
@@ -167,6 +180,10 @@ extern "C"
 
     eCsciMspDiagStatus Csci_Diag_GetComponentsInfo(uint32_t *numOfComponents, DiagComponentsInfo_t **diagComponentsInfo);   //added newly
 
+#if PLATFORM_NAME == G6 || PLATFORM_NAME == G8
+    eCsciMspDiagStatus Csci_Diag_GetMspPsiCacheInfo(DiagMspPsiCacheInfo *diagPsiCacheInfo);
+#endif
+
 #if PLATFORM_NAME == IP_CLIENT
     eCsciMspDiagStatus Csci_Diag_GetMspStreamingInfo(DiagMspStreamingInfo *streamingInfo);
 #endif
@@ -23,6 +23,8 @@
 #include <time.h>
 
 #include "MSPMediaShrink.h"
+#include "drivePlacement.h"
+#include "recordingPsiIndex.h"
 #include <string>
 
 using namespace std;
@@ -32,6 +34,7 @@ static int32_t global_fd = -1;
 static pthread_mutex_t mshrink_mutex;
 
 static bool shrinking = false;
+static int shrinkLoadId = 0;    // DrivePlacement id of the running transcode
 //static bool first=true;
 static uint32_t mShrinkCurrentState = 0;
 static bool gIsSystemReady = false;
@@ -66,6 +69,13 @@ static int32_t tries = 0;
 static time_t startTime = 0;
 static time_t stopTime = 0;
 
+static void stopShrinking(void)
+{
+    shrinking = false;
+    DrivePlacement::getInstance()->remove(shrinkLoadId);
+    shrinkLoadId = 0;
+}
+
 tCpeUtilMediaShrinkSessionId lastSessId = 0;
 MSPMediaShrink *MSPMediaShrink::m_pInstance = NULL;
 
@@ -318,7 +328,7 @@ void MSPMediaShrink::turnOffMediaShrink(tCpeUtilMediaShrinkSessionId sess_id, ch
         }
     }
     pthread_mutex_lock(&mshrink_mutex);
-    shrinking = false;
+    stopShrinking();
     processed.clear();
     pthread_mutex_unlock(&mshrink_mutex);
 
@@ -777,6 +787,9 @@ int mshrinkCallBack(tCpeUtilMediaShrinkSessionId sess_id, tCpeUtilMediaShrinkSes
             pthread_mutex_lock(&mshrink_mutex);
             processed.insert(pair<std::string, int32_t>(srcFile, TRANSCODE_INPROGRESS));
             shrinking = true;
+            // reads the recording and writes the transcode next to it
+            uint32_t kbps = (Mbps > 0.0) ? (uint32_t)(Mbps * 1000) : kDrivePlacementStreamKbps;
+            shrinkLoadId = DrivePlacement::getInstance()->add(DrivePlacement::driveOf(srcFile), kDriveLoad_Transcode, kbps, kbps);
             pthread_mutex_unlock(&mshrink_mutex);
 
             if (global_fd >= 0) write(global_fd, &sess_id, sizeof(uint32_t));
@@ -947,7 +960,7 @@ int mshrinkCallBack(tCpeUtilMediaShrinkSessionId sess_id, tCpeUtilMediaShrinkSes
             pthread_mutex_lock(&mshrink_mutex);
 
             deferred.insert(pair<std::string, stRecData_t>(srcFile, recordingData));
-            shrinking = false;
+            stopShrinking();
 
             pthread_mutex_unlock(&mshrink_mutex);
 
@@ -1055,7 +1068,7 @@ int mshrinkCallBack(tCpeUtilMediaShrinkSessionId sess_id, tCpeUtilMediaShrinkSes
                 LOGN(" MediaShrink cpeutil_mediashrink_session_Confirm (eCpeUtilMediaShrinkSessionOp_Close)");
             }
             pthread_mutex_lock(&mshrink_mutex);
-            shrinking = false;
+            stopShrinking();
             pthread_mutex_unlock(&mshrink_mutex);
 
 
@@ -1112,7 +1125,7 @@ int mshrinkCallBack(tCpeUtilMediaShrinkSessionId sess_id, tCpeUtilMediaShrinkSes
             }
         }
         pthread_mutex_lock(&mshrink_mutex);
-        shrinking = false;
+        stopShrinking();
         pthread_mutex_unlock(&mshrink_mutex);
         lastWritten = 0;
 
@@ -1338,7 +1351,7 @@ void *MSPMediaShrink::dispatchLoop()
                                             processed.erase(iter);
                                         }
                                         // Now update the aborted map with the failure count
-                                        shrinking = false;
+                                        stopShrinking();
                                         int32_t failCount = 1;
                                         map<string, int32_t >::iterator iterAbort;
                                         iterAbort = aborted.find(currentFile);
@@ -1554,7 +1567,7 @@ bool MSPMediaShrink::deleteRecording(const char* fileToDelete)
             if (TRANSCODE_INPROGRESS == iterMap->second)
             {
                 LOGE("Deleted Recording %s is TRANSCODE_INPROGRESS (%d) ", fileToDelete, iterMap->second);
-                shrinking = false;
+                stopShrinking();
             }
             processed.erase(iterMap);
         }
@@ -1594,6 +1607,12 @@ bool Msp_Mediashrink_Delete_Recording(const char* fileToDelete)
         }
     }
 
+    if (retStat)
+    {
+        // not left in the saved PSI index for a recording made later under the same name
+        RecordingPsiIndex::getInstance()->remove(fileToDelete);
+    }
+
     return retStat;
 
 }
@@ -3,6 +3,7 @@
 #include <cpe_recmgr.h>
 #include <sail-clm-api.h>
 #include "cpe_hnservermgr.h"
+#include "drivePlacement.h"
 
 #define SCOPELOG(section, scopename)  dlogns::ScopeLog __xscopelog(section, scopename, __FILE__, __LINE__, DLOGL_FUNCTION_CALLS)
 #define FNLOG(section)  dlogns::ScopeLog __xscopelog(section, __PRETTY_FUNCTION__, __FILE__, __LINE__, DLOGL_FUNCTION_CALLS)
@@ -27,6 +28,7 @@ MSPMrdvrStreamerSource::MSPMrdvrStreamerSource(std::string aSrcUrl)
     ptrPlaySession = NULL;
     fileChangeCallbackId = 0;
     m_CCIbyte = DEFAULT_RESTRICTIVE_CCI;
+    mDriveLoadId = 0;
 }
 
 void MSPMrdvrStreamerSource::SetCpeStreamingSessionID(uint32_t sessionId)
@@ -52,6 +54,7 @@ MSPMrdvrStreamerSource::~MSPMrdvrStreamerSource()
         }
         mCpeSrcHandle = 0;
     }
+    DrivePlacement::getInstance()->remove(mDriveLoadId);
 }
 
 eMspStatus MSPMrdvrStreamerSource::load(SourceStateCallback aPlaybackCB, void* aClientContext)
@@ -72,11 +75,7 @@ eMspStatus MSPMrdvrStreamerSource::open(eResMonPriority pri)
     int cpeStatus = kCpe_NoErr;
     unsigned pos = 0;
 
-    tCpeRecDataBase *dvrBlob = NULL;
-    tCpeRecDataBaseType *dvrBlobDbType = NULL;
-    tCpeRecDataBaseType *dvrCADbType = NULL;
-    eBlobType blob_type;
-    uint8_t *CADescBlob = NULL;
+    const tDvrMetadataInfo *metadata = NULL;
     string filepath;
 
     mPgrmHandle = 0;
@@ -185,126 +184,71 @@ eMspStatus MSPMrdvrStreamerSource::open(eResMonPriority pri)
             }
         }
 
-        mspStatus = ReadMrdvrMetaData((char *)filepath.c_str(), &dvrBlob);
-        if (mspStatus != kMspStatus_Ok)
+        metadata = DvrMetadataIndex::getInstance()->acquire(filepath);
+        if (metadata == NULL)
         {
+            mspStatus = kMspStatus_Error;
             LOG(DLOGL_ERROR, "HN Srvmgr Open Rec DB Failed 0x%x\n", mspStatus);
         }
 
+        // read from its drive while served
+        DrivePlacement::getInstance()->remove(mDriveLoadId);
+        mDriveLoadId = DrivePlacement::getInstance()->add(DrivePlacement::driveOf(filepath), kDriveLoad_Stream,
+                       kDrivePlacementStreamKbps, 0);
     }
 
     if (mspStatus == kMspStatus_Ok && cpeStatus == kCpe_NoErr)
     {
-        dvrBlobDbType = GetDecryptCABlob(dvrBlob , &blob_type);
-        if ((dvrBlobDbType == NULL) || (blob_type == kInvalid_Blob))
+        // views into the indexed metadata, the CAM copies what it keeps
+        tCpeRecDataBaseType dvrBlobDbType;
+        tCpeRecDataBaseType dvrCADbType;
+        uint8_t CADescBlob[CA_DESCRIPTOR_LENGTH];
+
+        if (metadata->blobType == kInvalid_Blob)
         {
             LOG(DLOGL_ERROR, "CAM blob fetching from recording failed");
-            delete[] dvrBlob;
-            dvrBlob = NULL;
-            if (dvrBlobDbType)
-            {
-                delete dvrBlobDbType;
-                dvrBlobDbType = NULL;
-            }
+            DvrMetadataIndex::getInstance()->release(metadata);
             return kMspStatus_Error;
         }
+        memset(&dvrBlobDbType, 0, sizeof(dvrBlobDbType));
+        dvrBlobDbType.dataBuf = (uint8_t *) metadata->caBlob;
+        dvrBlobDbType.size = metadata->caBlobSize;
+        memset(&dvrCADbType, 0, sizeof(dvrCADbType));
 
-        if (blob_type == kRTN_Blob)
+        if (metadata->blobType == kRTN_Blob)
         {
             LOG(DLOGL_NOISE, "It's an RTN CA Blob.Hence querying for CA Descriptor from metadata");
-            dvrCADbType = GetDecryptCADesc(dvrBlob);
-            if (dvrCADbType == NULL)
+            if (metadata->caDesc == NULL)
             {
                 LOG(DLOGL_ERROR, "CA Descriptor blob fetching from recording failed");
-
-                delete dvrBlobDbType;
-                dvrBlobDbType = NULL;
-
-                delete[] dvrBlob;
-                dvrBlob = NULL;
-
+                DvrMetadataIndex::getInstance()->release(metadata);
                 return kMspStatus_Error;
             }
+            dvrCADbType.dataBuf = (uint8_t *) metadata->caDesc;
+            dvrCADbType.size = metadata->caDescSize;
         }
-        else if (blob_type == kSARA_Blob)
+        else
         {
             LOG(DLOGL_NOISE, "Its a SARA CA Blob.Hence creating CA descriptor of own");
-            CADescBlob = (uint8_t *)calloc(1, CA_DESCRIPTOR_LENGTH);
-            dvrCADbType =  new tCpeRecDataBaseType ;
-            if ((!dvrCADbType) || (!CADescBlob))
-            {
-                LOG(DLOGL_ERROR, "Out of memory for CA descriptor creation");
-
-                delete dvrBlobDbType;
-                dvrBlobDbType = NULL;
-
-                delete[] dvrBlob;
-                dvrBlob = NULL;
-
-                if (CADescBlob)
-                {
-                    free(CADescBlob);
-                    CADescBlob = NULL;
-                }
-
-                delete dvrCADbType;
-                dvrCADbType = NULL;
-
-                return kMspStatus_Error;
-            }
-
+            memset(CADescBlob, 0, sizeof(CADescBlob));
             CADescBlob[0] = CA_DESCRIPTOR_DEFAULT;
-            dvrCADbType->dataBuf = CADescBlob;
-            dvrCADbType->size = CA_DESCRIPTOR_LENGTH;
+            dvrCADbType.dataBuf = CADescBlob;
+            dvrCADbType.size = CA_DESCRIPTOR_LENGTH;
         }
 
-        uint8_t scramblingMode = GetScramblingMode(dvrBlob);
+        uint8_t scramblingMode = metadata->scramblingMode;
 
-        LOG(DLOGL_REALLY_NOISY, "calling CamDecryptionStart with %p size %d, Inject Default CCI now", dvrBlobDbType->dataBuf, dvrBlobDbType->size);
+        LOG(DLOGL_REALLY_NOISY, "calling CamDecryptionStart with %p size %d, Inject Default CCI now", dvrBlobDbType.dataBuf, dvrBlobDbType.size);
         InjectCCI(DEFAULT_RESTRICTIVE_CCI);  // Inject the default resitrict one, will be overwritten by the real one if any
 
-        mspStatus = CamDecryptionStart(kCpeCam_Dvr_PowerKEYDRM, getCpeProgHandle(), &ptrPlaySession, dvrBlobDbType, dvrCADbType, scramblingMode);
+        mspStatus = CamDecryptionStart(kCpeCam_Dvr_PowerKEYDRM, getCpeProgHandle(), &ptrPlaySession, &dvrBlobDbType, &dvrCADbType, scramblingMode);
         if (mspStatus != kMspStatus_Ok)
         {
             LOG(DLOGL_ERROR, "Cam Decryption for MRDVR serving for the URL %s failed with error code %d", (char *) mSrcUrl.c_str(), mspStatus);
-            delete[] dvrBlob;
-            dvrBlob = NULL;
         }
-        else             //just free the buffer holding DVR metadata
+        else
         {
             LOG(DLOGL_REALLY_NOISY, "Cam Decryption for MRDVR serving started successfully for the URL %s", (char *) mSrcUrl.c_str());
-            delete[] dvrBlob;
-            dvrBlob = NULL;
-        }
-
-        if (dvrBlobDbType)
-        {
-            if (dvrBlobDbType->dataBuf)
-            {
-                free(dvrBlobDbType->dataBuf);
-                dvrBlobDbType->dataBuf = NULL;
-            }
-
-            if (dvrBlobDbType)
-            {
-                delete dvrBlobDbType;
-                dvrBlobDbType = NULL;
-            }
-        }
-
-        if (dvrCADbType)
-        {
-            if (dvrCADbType->dataBuf)
-            {
-                free(dvrCADbType->dataBuf);
-                dvrCADbType->dataBuf = NULL;
-            }
-
-            if (dvrCADbType)
-            {
-                delete dvrCADbType;
-                dvrCADbType = NULL;
-            }
         }
     }
 
@@ -323,11 +267,7 @@ eMspStatus MSPMrdvrStreamerSource::open(eResMonPriority pri)
     }
 
     LOG(DLOGL_REALLY_NOISY, "MSPMrdvrStreamerSource::open returning %d <SH = %p PH = %p>\n", mspStatus, mCpeSrcHandle, mPgrmHandle);
-    if (dvrBlob)
-    {
-        delete[] dvrBlob;
-        dvrBlob = NULL;
-    }
+    DvrMetadataIndex::getInstance()->release(metadata);
 
     return mspStatus;
 }
@@ -634,13 +574,8 @@ int MSPMrdvrStreamerSource::FileChangeCallback(tCpeHnSrvMgrCallbackTypes type, v
 {
     FNLOG(DL_MSP_MRDVR);
 
-    tCpeRecDataBaseType *dvrBlobDbType = NULL;
-    tCpeRecDataBaseType *dvrCADbType = NULL;
     MSPMrdvrStreamerSource *session = NULL;
     eMspStatus status = kMspStatus_Ok;
-    eBlobType blob_type;
-    tCpeRecDataBase *dvrBlob = NULL;
-    uint8_t *CADescBlob = NULL;
     int ret = -1;
     if ((type == eCpeHnSrvMgrCallbackTypes_FileChange))
     {
@@ -656,90 +591,60 @@ int MSPMrdvrStreamerSource::FileChangeCallback(tCpeHnSrvMgrCallbackTypes type, v
                 LOG(DLOGL_ERROR, "HN Srv CAM Stop failed 0x%x\n", status);
             }
 
-            status = ReadMrdvrMetaData(nextFileName + 6, &dvrBlob);
-            if (status != kMspStatus_Ok)
+            const tDvrMetadataInfo *metadata = DvrMetadataIndex::getInstance()->acquire(nextFileName + 6);
+            if (metadata == NULL)
             {
-                LOG(DLOGL_ERROR, "HN Srvmgr Open Rec DB Failed 0x%x\n", status);
+                LOG(DLOGL_ERROR, "HN Srvmgr Open Rec DB Failed 0x%x\n", kMspStatus_Error);
             }
             else
             {
-                dvrBlobDbType = GetDecryptCABlob(dvrBlob , &blob_type);
-                if ((dvrBlobDbType == NULL) || (blob_type == kInvalid_Blob))
+                // views into the indexed metadata, the CAM copies what it keeps
+                tCpeRecDataBaseType dvrBlobDbType;
+                tCpeRecDataBaseType dvrCADbType;
+                uint8_t CADescBlob[CA_DESCRIPTOR_LENGTH];
+
+                memset(&dvrBlobDbType, 0, sizeof(dvrBlobDbType));
+                memset(&dvrCADbType, 0, sizeof(dvrCADbType));
+                if (metadata->blobType == kInvalid_Blob)
                 {
                     LOG(DLOGL_ERROR, "CAM blob fetching from recording failed");
                 }
+                dvrBlobDbType.dataBuf = (uint8_t *) metadata->caBlob;
+                dvrBlobDbType.size = metadata->caBlobSize;
 
-                if (blob_type == kRTN_Blob)
+                if (metadata->blobType == kRTN_Blob)
                 {
                     LOG(DLOGL_REALLY_NOISY, "It's an RTN CA Blob.Hence querying for CA Descriptor from metadata");
-                    dvrCADbType = GetDecryptCADesc(dvrBlob);
-                    if (dvrCADbType == NULL)
-                    {
-                        LOG(DLOGL_ERROR, "CA Descriptor blob fetching from recording failed");
-                    }
+                    dvrCADbType.dataBuf = (uint8_t *) metadata->caDesc;
+                    dvrCADbType.size = metadata->caDescSize;
                 }
-                else if (blob_type == kSARA_Blob)
+                else if (metadata->blobType == kSARA_Blob)
                 {
                     LOG(DLOGL_REALLY_NOISY, "Its a SARA CA Blob.Hence creating CA descriptor of own");
-                    CADescBlob = (uint8_t *)calloc(1, CA_DESCRIPTOR_LENGTH);
-                    dvrCADbType =  new tCpeRecDataBaseType ;
-                    if ((!dvrCADbType) || (!CADescBlob))
-                    {
-                        LOG(DLOGL_EMERGENCY, "Out of memory for CA descriptor creation");
-                    }
-                    else
-                    {
-                        CADescBlob[0] = CA_DESCRIPTOR_DEFAULT;
-                        dvrCADbType->dataBuf = CADescBlob;
-                        dvrCADbType->size = CA_DESCRIPTOR_LENGTH;
-                    }
+                    memset(CADescBlob, 0, sizeof(CADescBlob));
+                    CADescBlob[0] = CA_DESCRIPTOR_DEFAULT;
+                    dvrCADbType.dataBuf = CADescBlob;
+                    dvrCADbType.size = CA_DESCRIPTOR_LENGTH;
                 }
 
-                uint8_t scramblingMode = GetScramblingMode(dvrBlob);
+                uint8_t scramblingMode = metadata->scramblingMode;
 
-                if (dvrBlobDbType != NULL)
-                {
-                    LOG(DLOGL_REALLY_NOISY, "calling CamDecryptionStart with %p size %d", dvrBlobDbType->dataBuf, dvrBlobDbType->size);
-                }
+                LOG(DLOGL_REALLY_NOISY, "calling CamDecryptionStart with %p size %d", dvrBlobDbType.dataBuf, dvrBlobDbType.size);
 
                 IPlaySession* pPlaySession = NULL;
 
-                status = session->CamDecryptionStart(kCpeCam_Dvr_PowerKEYDRM, session->getCpeProgHandle(), &pPlaySession, dvrBlobDbType, dvrCADbType, scramblingMode);
+                status = session->CamDecryptionStart(kCpeCam_Dvr_PowerKEYDRM, session->getCpeProgHandle(), &pPlaySession, &dvrBlobDbType, &dvrCADbType, scramblingMode);
                 if (status != kMspStatus_Ok)
                 {
                     LOG(DLOGL_ERROR, "Cam Decryption for MRDVR serving for the filename %s failed with error code %d", nextFileName, status);
-                    delete[] dvrBlob;
-                    dvrBlob = NULL;
                 }
-                else             //just free the buffer holding DVR metadata
+                else
                 {
                     session->setCAMPlaySession(pPlaySession);
 
                     LOG(DLOGL_REALLY_NOISY, "Cam Decryption for MRDVR serving started successfully for filename: %s", nextFileName);
-                    delete[] dvrBlob;
-                    dvrBlob = NULL;
-                }
-
-                if (dvrBlobDbType)
-                {
-                    if (dvrBlobDbType->dataBuf)
-                    {
-                        free(dvrBlobDbType->dataBuf);
-                        dvrBlobDbType->dataBuf = NULL;
-                    }
-                    delete dvrBlobDbType;
-                    dvrBlobDbType = NULL;
-                }
-                if (dvrCADbType)
-                {
-                    if (dvrCADbType->dataBuf)
-                    {
-                        free(dvrCADbType->dataBuf);
-                        dvrCADbType->dataBuf = NULL;
-                    }
-                    delete dvrCADbType;
-                    dvrCADbType = NULL;
                 }
+                DvrMetadataIndex::getInstance()->release(metadata);
             }
             ret = 0;
         }
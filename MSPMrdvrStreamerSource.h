@@ -100,6 +100,7 @@ private:
     void *mClientContext;
     std::string mFileName;
     uint8_t m_CCIbyte;
+    int mDriveLoadId;           ///< DrivePlacement id of the stream read
 
 };
 
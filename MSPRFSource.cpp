@@ -1318,4 +1318,15 @@ void MSPRFSource::SetCpeStreamingSessionID(uint32_t sessionId)
     (void) sessionId;
     return;
 }
+
+bool MSPRFSource::getTuningParams(tCpeSrcRFTune *tuningParams)const
+{
+    if (!tuningParams || !mTuneParamSet || (mTuningParams.mode == eCpeSrcRFMode_Analog))
+    {
+        return false;
+    }
+
+    *tuningParams = mTuningParams;
+    return true;
+}
 #endif
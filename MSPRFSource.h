@@ -171,6 +171,7 @@ public:
 #if PLATFORM_NAME == G6 || PLATFORM_NAME == G8
     tCpePgrmHandle getCpeProgHandle()const;
     void SetCpeStreamingSessionID(uint32_t sessionId);
+    bool getTuningParams(tCpeSrcRFTune *tuningParams)const;
 #endif
 
 private:
@@ -55,6 +55,12 @@ tCpePgrmHandle MSPSource::getCpeProgHandle()const
     return 0;
 }
 
+bool MSPSource::getTuningParams(tCpeSrcRFTune *tuningParams)const
+{
+    UNUSED_PARAM(tuningParams);
+    return false;
+}
+
 void MSPSource::SetCpeStreamingSessionID(uint32_t sessionId)
 {
     UNUSED_PARAM(sessionId);
@@ -157,6 +157,9 @@ public:
     /* Set method for the streaming session handle - specific for HN streaming source*/
     virtual void SetCpeStreamingSessionID(uint32_t sessionId) = 0;
 
+    /* Get method for the digital RF tuning parameters, false for any other kind of source */
+    virtual bool getTuningParams(tCpeSrcRFTune *tuningParams)const;
+
     virtual eMspStatus InjectCCI(uint8_t CCIbyte);
 #endif
 #if PLATFORM_NAME == IP_CLIENT
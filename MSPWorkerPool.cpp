@@ -0,0 +1,401 @@
+/** @file MSPWorkerPool.cpp
+ *
+ * @brief Shared worker threads and serial strands for controller event queues.
+ *
+ * Locking: the pool mutex guards the ready list, the timer list and the
+ * scheduling flags of every strand.  MSPEventQueue calls the strand listener
+ * with its own mutex held, so the pool never calls into a queue with the pool
+ * mutex held, except for the lock free hasPendingEvents().
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <dlog.h>
+#include "sail-settingsuser-api.h"
+
+#include "MSPWorkerPool.h"
+#include "pthread_named.h"
+#include "monotonicTime.h"
+
+#define LOG(level, msg, args...)  dlog(DL_MSP_MPLAYER, level,"MSPWorkerPool:%s:%d " msg, __FUNCTION__, __LINE__, ##args);
+
+MSPWorkerPool* MSPWorkerPool::mInstance = NULL;
+pthread_mutex_t MSPWorkerPool::mInstanceMutex = PTHREAD_MUTEX_INITIALIZER;
+
+///////////////////////////////////////////////////////////////////////////
+//                      MSPStrand
+///////////////////////////////////////////////////////////////////////////
+
+MSPStrand::MSPStrand(const char *name, MSPEventQueue *queue, MSPStrandEventHandler handler,
+                     MSPStrandIdleTimeout idleTimeout, void *ctx)
+{
+    mName = name;
+    mQueue = queue;
+    mHandler = handler;
+    mIdleTimeout = idleTimeout;
+    mCtx = ctx;
+    mPool = MSPWorkerPool::getInstance();
+
+    mIdleDeadlineMs = 0;
+    mNextWakeMs = 0;
+
+    mStarted = false;
+    mQueued = false;
+    mRunning = false;
+    mRerun = false;
+    mFinished = false;
+    mDetached = false;
+    mTimerArmed = false;
+}
+
+MSPStrand::~MSPStrand()
+{
+    mQueue->setListener(NULL);
+
+    pthread_mutex_lock(&mPool->mMutex);
+    mDetached = true;
+    mPool->removeLocked(this);
+    while (mRunning)
+    {
+        pthread_cond_wait(&mPool->mIdleCond, &mPool->mMutex);
+    }
+    pthread_mutex_unlock(&mPool->mMutex);
+}
+
+void MSPStrand::start(void)
+{
+    mQueue->setListener(this);
+
+    pthread_mutex_lock(&mPool->mMutex);
+    mStarted = true;
+    // first run picks up anything already queued and arms the idle time out
+    mPool->makeReadyLocked(this);
+    pthread_mutex_unlock(&mPool->mMutex);
+}
+
+void MSPStrand::join(void)
+{
+    pthread_mutex_lock(&mPool->mMutex);
+    while (!mFinished && !mDetached)
+    {
+        if (mStarted && !mRunning && mQueue->hasPendingEvents())
+        {
+            // Run it here rather than wait for a worker, the caller may itself
+            // be the worker the strand would have to wait for.
+            if (mQueued)
+            {
+                mPool->mReady.remove(this);
+                mQueued = false;
+            }
+            mRunning = true;
+            mPool->runLocked(this);
+        }
+        else
+        {
+            pthread_cond_wait(&mPool->mIdleCond, &mPool->mMutex);
+        }
+    }
+    pthread_mutex_unlock(&mPool->mMutex);
+}
+
+void MSPStrand::eventQueued(void)
+{
+    pthread_mutex_lock(&mPool->mMutex);
+    mPool->makeReadyLocked(this);
+    pthread_mutex_unlock(&mPool->mMutex);
+}
+
+void MSPStrand::eventScheduled(unsigned long long dueMs)
+{
+    pthread_mutex_lock(&mPool->mMutex);
+    if (!mFinished && !mDetached)
+    {
+        mPool->armTimerLocked(this, dueMs);
+    }
+    pthread_mutex_unlock(&mPool->mMutex);
+}
+
+// Runs with mRunning set and the pool mutex released.  Returns true when the handler is done.
+bool MSPStrand::runBatch(void)
+{
+    unsigned long long nowMs = MSPEventQueue::monotonicMs();
+    unsigned long long dueMs;
+    bool handled = false;
+    bool done = false;
+
+    for (unsigned int i = 0; (i < kMSPStrandBatchSize) && !done; i++)
+    {
+        Event *evt = mQueue->tryPopEventQueue();
+        if (evt == NULL)
+        {
+            break;
+        }
+        handled = true;
+        done = mHandler(mCtx, evt);
+    }
+
+    if (!done && !handled && (mIdleDeadlineMs != 0) && (nowMs >= mIdleDeadlineMs))
+    {
+        handled = true;
+        done = mHandler(mCtx, MSPEventQueue::getTimeOutEvent());
+    }
+
+    if (done)
+    {
+        return true;
+    }
+
+    // like the old event loops, the idle time out restarts after every event
+    if (handled || (mIdleDeadlineMs == 0))
+    {
+        unsigned int idleSecs = mIdleTimeout ? mIdleTimeout(mCtx) : 0;
+        mIdleDeadlineMs = idleSecs ? (MSPEventQueue::monotonicMs() + (idleSecs * 1000ULL)) : 0;
+    }
+
+    mNextWakeMs = mIdleDeadlineMs;
+    if (mQueue->getNextScheduledMs(&dueMs) && ((mNextWakeMs == 0) || (dueMs < mNextWakeMs)))
+    {
+        mNextWakeMs = dueMs;
+    }
+
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////////
+//                      MSPWorkerPool
+///////////////////////////////////////////////////////////////////////////
+
+MSPWorkerPool* MSPWorkerPool::getInstance(void)
+{
+    pthread_mutex_lock(&mInstanceMutex);
+    if (mInstance == NULL)
+    {
+        mInstance = new MSPWorkerPool();
+    }
+    pthread_mutex_unlock(&mInstanceMutex);
+    return mInstance;
+}
+
+MSPWorkerPool::MSPWorkerPool()
+{
+    pthread_mutex_init(&mMutex, NULL);
+
+    pthread_condattr_t condAttr;
+    pthread_condattr_init(&condAttr);
+    pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+    pthread_cond_init(&mWorkCond, &condAttr);
+    pthread_condattr_destroy(&condAttr);
+    pthread_cond_init(&mIdleCond, NULL);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, kMSPWorkerPoolStackSize);
+
+    mThreadCount = 0;
+    unsigned int threads = configuredThreadCount();
+    for (unsigned int i = 0; i < threads; i++)
+    {
+        int err = pthread_create(&mThreads[mThreadCount], &attr, workerFunc, (void *) this);
+        if (err)
+        {
+            LOG(DLOGL_ERROR, "pthread_create error %d", err);
+            continue;
+        }
+
+        char threadName[16];
+        snprintf(threadName, sizeof(threadName), "MSP_Worker_%u", i);
+        // failing to set name is not considered an major error
+        int retval = pthread_setname_np(mThreads[mThreadCount], threadName);
+        if (retval)
+        {
+            LOG(DLOGL_ERROR, "pthread_setname_np error: %d", retval);
+        }
+        mThreadCount++;
+    }
+
+    pthread_attr_destroy(&attr);
+}
+
+// The pool lives as long as the process, like the other MSP singletons
+MSPWorkerPool::~MSPWorkerPool()
+{
+    pthread_mutex_destroy(&mMutex);
+    pthread_cond_destroy(&mWorkCond);
+    pthread_cond_destroy(&mIdleCond);
+}
+
+unsigned int MSPWorkerPool::configuredThreadCount(void)
+{
+    char settingBuffer[10];
+    tSettingsAttributes attr;
+    int tuners = 0;
+    int threads = kMSPWorkerPoolThreads;
+
+    memset(settingBuffer, 0, sizeof(settingBuffer));
+    Settings_Get(NULL, "ciscoSg/media/numTuners", settingBuffer, (size_t) 3, &attr);
+    if ((sscanf(settingBuffer, "%d", &tuners) != 1) || (tuners < 0))
+    {
+        tuners = 0;
+    }
+
+    memset(settingBuffer, 0, sizeof(settingBuffer));
+    Settings_Get(NULL, "ciscoSg/media/mspWorkerThreads", settingBuffer, (size_t) 3, &attr);
+    if (sscanf(settingBuffer, "%d", &threads) != 1)
+    {
+        threads = kMSPWorkerPoolThreads;
+    }
+
+    // a tuner starting a recording blocks its worker for seconds
+    if (threads < tuners + kMSPWorkerPoolSpareThreads)
+    {
+        threads = tuners + kMSPWorkerPoolSpareThreads;
+    }
+    if (threads > kMSPWorkerPoolMaxThreads)
+    {
+        threads = kMSPWorkerPoolMaxThreads;
+    }
+    LOG(DLOGL_NORMAL, "tuners:%d workers:%d", tuners, threads);
+    return threads;
+}
+
+void* MSPWorkerPool::workerFunc(void *data)
+{
+    MSPWorkerPool *inst = (MSPWorkerPool *) data;
+    inst->workerLoop();
+    return NULL;
+}
+
+void MSPWorkerPool::workerLoop(void)
+{
+    struct timespec ts;
+
+    pthread_mutex_lock(&mMutex);
+    for (;;)
+    {
+        unsigned long long nowMs = MSPEventQueue::monotonicMs();
+        while (!mTimers.empty() && (mTimers.begin()->first <= nowMs))
+        {
+            MSPStrand *strand = mTimers.begin()->second;
+            mTimers.erase(mTimers.begin());
+            strand->mTimerArmed = false;
+            makeReadyLocked(strand);
+        }
+
+        if (!mReady.empty())
+        {
+            MSPStrand *strand = mReady.front();
+            mReady.pop_front();
+            strand->mQueued = false;
+            strand->mRunning = true;
+            runLocked(strand);
+            continue;
+        }
+
+        if (mTimers.empty())
+        {
+            pthread_cond_wait(&mWorkCond, &mMutex);
+        }
+        else
+        {
+            unsigned long long wakeMs = mTimers.begin()->first;
+            monotonicDeadlineAt(wakeMs, &ts);
+            pthread_cond_timedwait(&mWorkCond, &mMutex, &ts);
+        }
+    }
+}
+
+void MSPWorkerPool::makeReadyLocked(MSPStrand *strand)
+{
+    if (!strand->mStarted || strand->mFinished || strand->mDetached)
+    {
+        return;
+    }
+    if (strand->mRunning)
+    {
+        strand->mRerun = true;
+        return;
+    }
+    if (!strand->mQueued)
+    {
+        mReady.push_back(strand);
+        strand->mQueued = true;
+        pthread_cond_signal(&mWorkCond);
+    }
+}
+
+void MSPWorkerPool::armTimerLocked(MSPStrand *strand, unsigned long long dueMs)
+{
+    if (strand->mTimerArmed)
+    {
+        if (strand->mTimer->first <= dueMs)
+        {
+            return;
+        }
+        mTimers.erase(strand->mTimer);
+    }
+
+    strand->mTimer = mTimers.insert(std::make_pair(dueMs, strand));
+    strand->mTimerArmed = true;
+
+    // waiting workers sleep until the old earliest timer
+    if (strand->mTimer == mTimers.begin())
+    {
+        pthread_cond_broadcast(&mWorkCond);
+    }
+}
+
+void MSPWorkerPool::disarmTimerLocked(MSPStrand *strand)
+{
+    if (strand->mTimerArmed)
+    {
+        mTimers.erase(strand->mTimer);
+        strand->mTimerArmed = false;
+    }
+}
+
+void MSPWorkerPool::removeLocked(MSPStrand *strand)
+{
+    if (strand->mQueued)
+    {
+        mReady.remove(strand);
+        strand->mQueued = false;
+    }
+    disarmTimerLocked(strand);
+}
+
+// Called with the pool mutex held and strand->mRunning claimed by the caller
+void MSPWorkerPool::runLocked(MSPStrand *strand)
+{
+    pthread_mutex_unlock(&mMutex);
+    bool done = strand->runBatch();
+    pthread_mutex_lock(&mMutex);
+
+    strand->mRunning = false;
+    if (done)
+    {
+        strand->mFinished = true;
+    }
+    finishRunLocked(strand);
+}
+
+void MSPWorkerPool::finishRunLocked(MSPStrand *strand)
+{
+    bool rerun = strand->mRerun;
+    strand->mRerun = false;
+
+    if (strand->mFinished || strand->mDetached)
+    {
+        disarmTimerLocked(strand);
+    }
+    else if (rerun || strand->mQueue->hasPendingEvents())
+    {
+        makeReadyLocked(strand);
+    }
+    else if (strand->mNextWakeMs != 0)
+    {
+        armTimerLocked(strand, strand->mNextWakeMs);
+    }
+
+    pthread_cond_broadcast(&mIdleCond);
+}
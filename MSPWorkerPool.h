@@ -0,0 +1,142 @@
+/** @file MSPWorkerPool.h
+ *
+ * @brief Shared worker threads for the MSP controller event queues.
+ *
+ * Controllers used to run one pthread per instance, blocked in
+ * MSPEventQueue::popEventQueue() for most of its life.  Instead each
+ * controller now owns an MSPStrand bound to its event queue, and a fixed set
+ * of MSPWorkerPool threads runs whichever strands have events.
+ *
+ * A strand is serial: its handler never runs on two threads at once and sees
+ * events in queue order, so controllers keep the ordering guarantees of their
+ * old event thread.  The handler also gets the time out event (eventType -1)
+ * after the strand has been idle for the number of seconds returned by its
+ * idle callback, just like popEventQueue() with setTimeOutSecs().
+ *
+ * Handlers still block at times: a recording start waits up to 5 s for its
+ * CA metadata and the cpe_* calls are synchronous.  The pool therefore has
+ * at least one worker per tuner plus kMSPWorkerPoolSpareThreads, so the
+ * strands of the other tuners keep running while every tuner starts a
+ * recording.  "ciscoSg/media/mspWorkerThreads" can raise it further.
+ */
+
+#ifndef _MSPWORKERPOOL_H_
+#define _MSPWORKERPOOL_H_
+
+#include <list>
+#include <map>
+#include <pthread.h>
+
+#include "eventQueue.h"
+
+#define kMSPWorkerPoolThreads     4              ///< worker threads shared by every strand when not configured
+#define kMSPWorkerPoolSpareThreads 2             ///< workers beyond one per tuner
+#define kMSPWorkerPoolMaxThreads  16
+#define kMSPWorkerPoolStackSize   (256 * 1024)   ///< largest stack any converted controller thread used
+#define kMSPStrandBatchSize       32             ///< events run before a busy strand yields its worker
+
+class MSPWorkerPool;
+
+/// Handles one event for the strand owner, returns true when the strand is done (exit event).
+/// The handler owns the event and must return it with MSPEventQueue::freeEvent().
+typedef bool (*MSPStrandEventHandler)(void *ctx, Event *evt);
+
+/// Seconds the strand may stay idle before the handler gets the time out event, 0 for no time out.
+typedef unsigned int (*MSPStrandIdleTimeout)(void *ctx);
+
+class MSPStrand : public MSPEventQueueListener
+{
+public:
+    MSPStrand(const char *name, MSPEventQueue *queue, MSPStrandEventHandler handler,
+              MSPStrandIdleTimeout idleTimeout, void *ctx);
+    // Detaches from the queue and waits for a running handler to return
+    ~MSPStrand();
+
+    // Start handling events, including the ones already queued
+    void start(void);
+    // Block until the handler returned true.  Runs the strand on the calling
+    // thread when no worker has it, so joining from a worker cannot deadlock.
+    void join(void);
+
+    const char* getName(void) const
+    {
+        return mName;
+    }
+
+    // MSPEventQueueListener
+    void eventQueued(void);
+    void eventScheduled(unsigned long long dueMs);
+
+private:
+    friend class MSPWorkerPool;
+
+    bool runBatch(void);
+
+    const char           *mName;
+    MSPEventQueue        *mQueue;
+    MSPStrandEventHandler mHandler;
+    MSPStrandIdleTimeout  mIdleTimeout;
+    void                 *mCtx;
+    MSPWorkerPool        *mPool;
+
+    // only touched by the thread running the strand
+    unsigned long long    mIdleDeadlineMs;   // 0 when there is no idle time out
+    unsigned long long    mNextWakeMs;       // earliest of idle deadline / next scheduled event, 0 for none
+
+    // guarded by the pool mutex
+    bool                  mStarted;
+    bool                  mQueued;           // in the pool ready list
+    bool                  mRunning;          // a thread is in runBatch()
+    bool                  mRerun;            // woken while running, run again afterwards
+    bool                  mFinished;         // handler returned true
+    bool                  mDetached;         // being destroyed
+    bool                  mTimerArmed;
+    std::multimap<unsigned long long, MSPStrand*>::iterator mTimer;
+
+    MSPStrand(const MSPStrand&);
+    MSPStrand& operator=(const MSPStrand&);
+};
+
+class MSPWorkerPool
+{
+public:
+    static MSPWorkerPool* getInstance(void);
+
+    unsigned int getThreadCount(void) const
+    {
+        return mThreadCount;
+    }
+
+private:
+    friend class MSPStrand;
+
+    MSPWorkerPool();
+    ~MSPWorkerPool();
+
+    static unsigned int configuredThreadCount(void);
+    static void* workerFunc(void *data);
+    void workerLoop(void);
+
+    void makeReadyLocked(MSPStrand *strand);
+    void armTimerLocked(MSPStrand *strand, unsigned long long dueMs);
+    void disarmTimerLocked(MSPStrand *strand);
+    void removeLocked(MSPStrand *strand);
+    void runLocked(MSPStrand *strand);
+    void finishRunLocked(MSPStrand *strand);
+
+    pthread_mutex_t mMutex;
+    pthread_cond_t  mWorkCond;     // ready strand or earlier timer, uses CLOCK_MONOTONIC
+    pthread_cond_t  mIdleCond;     // a strand stopped running, for join() and ~MSPStrand()
+    std::list<MSPStrand*> mReady;
+    std::multimap<unsigned long long, MSPStrand*> mTimers;   // wake up time (CLOCK_MONOTONIC ms) -> strand
+    pthread_t       mThreads[kMSPWorkerPoolMaxThreads];
+    unsigned int    mThreadCount;
+
+    static MSPWorkerPool *mInstance;
+    static pthread_mutex_t mInstanceMutex;
+
+    MSPWorkerPool(const MSPWorkerPool&);
+    MSPWorkerPool& operator=(const MSPWorkerPool&);
+};
+
+#endif
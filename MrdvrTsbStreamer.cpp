@@ -42,12 +42,12 @@
 #include "psi.h"
 #include "AnalogPsi.h"
 #include "eventQueue.h"
+#include "MSPWorkerPool.h"
 #include "IMediaPlayer.h"
 #include "MSPSourceFactory.h"
 #include "MSPPPVSource.h"
 #include "MSPMrdvrStreamerSource.h"
 
-#include "pthread_named.h"
 
 #include "csci-dvr-scheduler-api.h"
 #include "mrdvrserver.h"
@@ -157,8 +157,8 @@ MrdvrTsbStreamer::MrdvrTsbStreamer(IMediaPlayerSession *pIMediaPlayerSession)
     mCBData = NULL;
     mCCICBFn = NULL;
     mCamCaHandle = NULL;
-    mEventHandlerThread = 0;
-    mPsiTimeoutThread = 0;
+    mEventStrand = NULL;
+    mPsiTimeoutTimer = kMSPEventTimerIdInvalid;
     mptrcaStream = NULL;
     pthread_mutexattr_t mta;
     pthread_mutexattr_init(&mta);
@@ -204,19 +204,16 @@ MrdvrTsbStreamer::~MrdvrTsbStreamer()
 
     LOG(DLOGL_REALLY_NOISY, "UNLOCKED mCallbackList mutex");
 
-    if (mPsiTimeoutThread)
-    {
-        pthread_join(mPsiTimeoutThread, NULL);       // wait for PSI timeout thread to exit
-        mPsiTimeoutThread = 0;
-    }
+    StopPSITimeout();
 
-    if (mEventHandlerThread)
+    if (mEventStrand)
     {
-        queueEvent(kDvrEventExit);  // tell thread to exit
+        queueEvent(kDvrEventExit);  // tell strand to exit
         unLockMutex();
-        pthread_join(mEventHandlerThread, NULL);      // wait for event thread to exit
+        mEventStrand->join();       // wait for exit event to be handled
+        delete mEventStrand;
         lockMutex();
-        mEventHandlerThread = 0;
+        mEventStrand = NULL;
     }
 
     if (mptrcaStream)
@@ -335,7 +332,7 @@ eIMediaPlayerStatus MrdvrTsbStreamer::Load(const char* aServiceUrl, const MultiM
 
     FNLOG(DL_MSP_MRDVR);
 
-    if (mState != kDvrStateIdle || mEventHandlerThread != 0)
+    if (mState != kDvrStateIdle || mEventStrand != NULL)
     {
         LOG(DLOGL_ERROR, "Error wrong state: %d", mState);
         return kMediaPlayerStatus_Error_OutOfState;
@@ -355,27 +352,10 @@ eIMediaPlayerStatus MrdvrTsbStreamer::Load(const char* aServiceUrl, const MultiM
         return kMediaPlayerStatus_Error_InvalidURL;
     }
 
-    // create and start the Mrdvr LiveStreaming Event Handler
-    int threadRetvalue;
-    pthread_attr_t attr;
-    pthread_attr_init(&attr);
-    pthread_attr_setstacksize(&attr, (128 * 1024)); //128kb
-
-    // By default the thread is created as joinable.
-    threadRetvalue = pthread_create(&mEventHandlerThread, &attr, eventthreadFunc, (void *) this);
-    if (threadRetvalue)
-    {
-        LOG(DLOGL_ERROR, "pthread_create error %d", threadRetvalue);
-        return kMediaPlayerStatus_Error_Unknown;
-    }
-
-    dlog(DL_MSP_MRDVR, DLOGL_REALLY_NOISY, "Created event thread handle %x", (unsigned int)mEventHandlerThread);
-
-    threadRetvalue = pthread_setname_np(mEventHandlerThread, "Mrdvr LiveStreaming Event Handler");
-    if (threadRetvalue)
-    {
-        LOG(DLOGL_ERROR, "thread naming error %d", threadRetvalue);
-    }
+    // create and start the Mrdvr LiveStreaming Event Handler on the shared MSP worker pool
+    mEventStrand = new MSPStrand("Mrdvr LiveStreaming Event Handler", mThreadEventQueue, eventHandler, eventIdleTimeout, (void *) this);
+    mEventStrand->start();
+    dlog(DL_MSP_MRDVR, DLOGL_REALLY_NOISY, "Started event strand %p", mEventStrand);
 
     mState = kDvrStateStop;
 
@@ -510,11 +490,7 @@ eIMediaPlayerStatus MrdvrTsbStreamer::Stop(bool stopPlay, bool stopPersistentRec
         StopDeletePSI();
     }
 
-    if (mPsiTimeoutThread)
-    {
-        pthread_join(mPsiTimeoutThread, NULL);       // wait for PSI timeout thread to exit
-        mPsiTimeoutThread = 0;
-    }
+    StopPSITimeout();
 
     if (mPtrAnalogPsi)
     {
@@ -560,18 +536,15 @@ void MrdvrTsbStreamer::Eject()
 {
     FNLOG(DL_MSP_MRDVR);
 
-    if (mPsiTimeoutThread)
-    {
-        pthread_join(mPsiTimeoutThread, NULL);       // wait for PSI timeout thread to exit
-        mPsiTimeoutThread = 0;
-    }
-    if (mEventHandlerThread)
+    StopPSITimeout();
+    if (mEventStrand)
     {
-        queueEvent(kDvrEventExit);  // tell thread to exit
+        queueEvent(kDvrEventExit);  // tell strand to exit
         unLockMutex();
-        pthread_join(mEventHandlerThread, NULL);       // wait for event thread to exit
+        mEventStrand->join();       // wait for exit event to be handled
+        delete mEventStrand;
         lockMutex();
-        mEventHandlerThread = 0;
+        mEventStrand = NULL;
     }
 
     if (mptrcaStream)
@@ -1272,35 +1245,35 @@ eMspStatus MrdvrTsbStreamer::queueEvent(eDvrEvent evtyp)
 
 ///   This method listens to the events posted onto mThreadEventQueue
 ///   and calls dispatchEvent member function to process the events read from the queue
-void* MrdvrTsbStreamer::eventthreadFunc(void *aData)
+bool MrdvrTsbStreamer::eventHandler(void *aData, Event *evt)
 {
     bool done = false;
     MrdvrTsbStreamer *inst = (MrdvrTsbStreamer *)aData;
-    Event *evt;
 
-    FNLOG(DL_MSP_MRDVR);
+    inst->lockMutex();
+    dlog(DL_MSP_MRDVR, DLOGL_REALLY_NOISY, "Event strand got event %d ", evt->eventType);
+    done = inst->dispatchEvent(evt);  // call member function to handle event
+    inst->mThreadEventQueue->freeEvent(evt);
+    inst->unLockMutex();
 
-    while (!done)
+    if (done)
     {
-        unsigned int waitTime = 0;
-        if (inst->mState == kDvrWaitSourceReady)
-        {
-            dlog(DL_MSP_MRDVR, DLOGL_NOISE, "Inside Wait for Tuner lock\n");
-            waitTime = TIMEOUT;
-        }
-        inst->mThreadEventQueue->setTimeOutSecs(waitTime);
-        evt = inst->mThreadEventQueue->popEventQueue();
-        inst->mThreadEventQueue->unSetTimeOut();
-        inst->lockMutex();
-        dlog(DL_MSP_MRDVR, DLOGL_REALLY_NOISY, "Event thread got event %d ", evt->eventType);
-        done = inst->dispatchEvent(evt);  // call member function to handle event
-        inst->mThreadEventQueue->freeEvent(evt);
-        inst->unLockMutex();
+        dlog(DL_MSP_MRDVR, DLOGL_REALLY_NOISY, "Exiting MrdvrTsbStreamer event strand\n");
     }
+    return done;
+}
 
-    dlog(DL_MSP_MRDVR, DLOGL_REALLY_NOISY, "Exiting MrdvrTsbStreamer event thread\n");
-    pthread_exit(NULL);
-    return NULL;
+unsigned int MrdvrTsbStreamer::eventIdleTimeout(void *aData)
+{
+    MrdvrTsbStreamer *inst = (MrdvrTsbStreamer *)aData;
+    unsigned int waitTime = 0;
+
+    if (inst->mState == kDvrWaitSourceReady)
+    {
+        dlog(DL_MSP_MRDVR, DLOGL_NOISE, "Inside Wait for Tuner lock\n");
+        waitTime = TIMEOUT;
+    }
+    return waitTime;
 }
 
 
@@ -1474,6 +1447,7 @@ bool MrdvrTsbStreamer::dispatchEvent(Event *aEvt)
 
     case kDvrPSIReadyEvent:
         mPsiReady = true;
+        StopPSITimeout();
         if (IsInMemoryStreaming() == true)
         {
             LOG(DLOGL_EMERGENCY, "SID:%d Doing in memory streaming on PSI Ready Event received", mSessionId);
@@ -2522,86 +2496,32 @@ void MrdvrTsbStreamer::SetEasAudioActive(bool active)
 
 void MrdvrTsbStreamer::StartPSITimeout()
 {
-    // Start Timer for monitoring PSI data
+    // Start Timer for monitoring PSI data.  A DVR timeout event is posted to our
+    // own event queue unless StopPSITimeout() is called first (PSI ready / stop).
 
     FNLOG(DL_MSP_MRDVR);
 
-    int threadRetvalue;
-    pthread_attr_t attr;
-    pthread_attr_init(&attr);
-    //Make the thread as join-able
-    pthread_attr_setstacksize(&attr, (128 * 1024)); //128kb
-
-    threadRetvalue = pthread_create(&mPsiTimeoutThread, &attr, PsiTimerFunc, (void *) this);
-    if (threadRetvalue)
+    if (!mThreadEventQueue)
     {
-        LOG(DLOGL_ERROR, "Error creating PSI Timeout thread: %d", threadRetvalue);
-        threadRetvalue = pthread_attr_destroy(&attr);
-        if (threadRetvalue)
-        {
-            LOG(DLOGL_ERROR, "Error in pthread_attr_destroy for PSI Timeout thread: %d", threadRetvalue);
-        }
+        LOG(DLOGL_ERROR, "error: no event queue");
         return;
     }
 
-    threadRetvalue = pthread_setname_np(mPsiTimeoutThread, "PSI Timeout thread");
-    if (threadRetvalue)
-    {
-        LOG(DLOGL_ERROR, "Error PSI timeout thread setname: %d", threadRetvalue);
-    }
-
-    threadRetvalue = pthread_attr_destroy(&attr);
-    if (threadRetvalue)
-    {
-        LOG(DLOGL_ERROR, "Error in pthread_attr_destroy for PSI Timoueout Thread: %d", threadRetvalue);
-    }
+    StopPSITimeout();
+    mPsiTimeoutTimer = mThreadEventQueue->scheduleEvent(kDvrTimeOutEvent, NULL, PSI_TIMEOUT * 1000);
 }
 
 
-// This method starts a timer to post a DVR timeout event when PSI timeout happens or exit when PSI data is available
-void * MrdvrTsbStreamer::PsiTimerFunc(void *aData)
+// This method cancels the PSI timer if it has not expired yet
+void MrdvrTsbStreamer::StopPSITimeout()
 {
-    FNLOG(DL_MSP_MRDVR);
-
-    bool done = false;
-    MrdvrTsbStreamer *inst = (MrdvrTsbStreamer *)aData;
-
-    struct timeval tv;
-    long secs_start, secs_stop;
-
-
-    if (gettimeofday(&tv, 0) < 0)
-    {
-        LOG(DLOGL_ERROR, "Error gettimeofday");
-    }
-
-    secs_start = tv.tv_sec;
-
-    while (!done)
+    if ((mPsiTimeoutTimer != kMSPEventTimerIdInvalid) && mThreadEventQueue)
     {
-        if (gettimeofday(&tv, 0) < 0)
-        {
-            LOG(DLOGL_ERROR, "Error gettimeofday");
-        }
-
-        secs_stop = tv.tv_sec;
-        if (secs_stop > (secs_start + PSI_TIMEOUT))
-        {
-            LOG(DLOGL_REALLY_NOISY, "PSI timer expired. Post DVR time out event");
-            inst->queueEvent(kDvrTimeOutEvent);
-            done = true;
-        }
-
-        if (inst->mPsiReady == true || inst->mState == kDvrStateStop)
+        if (mThreadEventQueue->cancelScheduledEvent(mPsiTimeoutTimer))
         {
-            LOG(DLOGL_REALLY_NOISY, "Exit PSI timeout thread as PSI data is available [or] Dvr is in stopped state");
-            done = true;
+            LOG(DLOGL_REALLY_NOISY, "PSI timer cancelled");
         }
-        usleep(100000);      // give other threads a chance to run
     }
-
-    LOG(DLOGL_REALLY_NOISY, "PSI Timer Thread Exit");
-    pthread_exit(NULL);
-    return NULL;
+    mPsiTimeoutTimer = kMSPEventTimerIdInvalid;
 }
 
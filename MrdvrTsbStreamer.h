@@ -33,10 +33,10 @@
 #include <cpe_common.h>
 #include "dvr.h"
 #include "cpe_cam.h"
+#include "eventQueue.h"
 class DisplaySession;
+class MSPStrand;
 class MSPRecordSession;
-class MSPEventQueue;
-class Event;
 class MSPFileSource;
 class InMemoryStream;
 #define TSB_DwellTime 10  //dwell time 10 seconds
@@ -119,7 +119,7 @@ public:
     ~MrdvrTsbStreamer();
 
     void StartPSITimeout();
-    static void* PsiTimerFunc(void *aData);
+    void StopPSITimeout();
 
 
     tCpePgrmHandle getCpeProgHandle();
@@ -138,7 +138,8 @@ private:
 
     eMspStatus parseSource(const char *aServiceUrl);
     eDvrState getDvrState(void);
-    static void* eventthreadFunc(void *data);
+    static bool eventHandler(void *data, Event *evt);
+    static unsigned int eventIdleTimeout(void *data);
     static void sourceCB(void *aData, eSourceState aSrcState);
     static void psiCallback(ePsiCallBackState state, void *data);
     static void analogPsiCallback(ePsiCallBackState state, void *data); // For Analog support
@@ -175,7 +176,7 @@ private:
     InMemoryStream *mptrcaStream;
     uint32_t mSessionId;
     MSPEventQueue* mThreadEventQueue;
-    pthread_t mEventHandlerThread;
+    MSPStrand* mEventStrand;           // runs mThreadEventQueue on the shared MSP worker pool
     pthread_mutex_t  mMutex;
     std::list<CallbackInfo*> mCallbackList;
     boost::signals2::connection mRecordSessioncallbackConnection;
@@ -184,7 +185,7 @@ private:
     IMediaPlayerSession *mIMediaPlayerSession;
 
     HnSessionState mReqState;
-    pthread_t mPsiTimeoutThread;
+    tMSPEventTimerId mPsiTimeoutTimer;  // kDvrTimeOutEvent scheduled on mThreadEventQueue while waiting for PSI
     void* mCBData;
     CCIcallback_t mCCICBFn;
     uint8_t m_CCIbyte;
@@ -33,7 +33,7 @@
 #include "csci-meta-charset-api.h"
 #include <memory.h>
 #include <stdlib.h>
-extern unsigned int crctab[256];
+#include "crc32.h"
 
 #define MAX_LINE_SIZE 256
 
@@ -255,10 +255,7 @@ bool MusicAppData::text_IsValidCRC(uint8_t* buf)
     unsigned int crc;
 
     // compute CRC32 over the whole buffer, including the CRC
-    for (crc = TEXT_CRC_SEED; length > 0; length--, buf++)
-    {
-        crc = (crc << 8) ^ (crctab[0xff & ((crc >> 24) ^ (*buf))]);
-    }
+    crc = MSPCrc32::compute(TEXT_CRC_SEED, buf, (length > 0) ? length : 0);
     // the computed CRC32 should be zero
     dlog(DL_MSP_MPLAYER, DLOGL_NOISE, "%s: crc %d", __FUNCTION__, crc);
     if (0 == crc)
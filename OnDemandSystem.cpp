@@ -22,9 +22,9 @@
 
 
 #include "IOnDemandSystem.h"
+#include "vodDnsCache.h"
 #include <arpa/inet.h>
 #include <ctype.h>
-#include <dns_resolve.h>
 
 //#include <dnslookup.h>
 #include <dlog.h>
@@ -52,7 +52,6 @@
 //#define LONG_MAX  ((long)(~0UL>>1))
 //#define LONG_MIN  (-LONG_MAX - 1)
 #define ERANGE      34  /* Math result not representable */
-#define MAX_SERVERS 3
 #define MAX_LINE 254
 #define EXPECTEDTAGS 8
 //This data is based on the User-to-Network Configuration document revision 3.6.1
@@ -195,44 +194,18 @@ bool OnDemandSystemClient::IsSessionControlServerAddressChanged(string address)
 
 string OnDemandSystemClient::GetIpAddressFromDNS(char *hostname)
 {
-    bool gotServerIp = false;
-    tIpAddress *servers[MAX_SERVERS];
-    int numServer, i;
     string returnString = "localhost";
-    (void)hostname;
-    for (i = 0; i < MAX_SERVERS; i++)
+    struct in_addr ip4Addr;
+    char ip[INET_ADDRSTRLEN];
+
+    // the lookups of the on-demand stack share one cache, only the first one waits for the resolver
+    if (hostname && VodDnsCache::getInstance()->resolve(hostname, &ip4Addr))
     {
-        servers[i] = NULL;
+        returnString = inet_ntop(AF_INET, &ip4Addr, ip, sizeof(ip));
     }
-    //TODO: needs to uncomment later
-    //numServer = dns_resolve(hostname, servers);
-    numServer = 1;
-    if (numServer > 0)
+    else
     {
-        for (i = 0; i < numServer; i++)
-        {
-            if (servers[i])
-            {
-                if (servers[i]->sa_family == AF_INET)
-                {
-                    if (!gotServerIp)
-                    {
-                        struct in_addr ip4Addr;
-                        ip4Addr.s_addr = servers[i]->ip.sin_addr.s_addr;
-                        returnString = inet_ntoa(ip4Addr);
-                        //We should save the first IP address, and ignore the rest.
-                        gotServerIp = true;
-                    }
-                }
-                else
-                {
-                    dlog(DL_MSP_ONDEMAND, DLOGL_ERROR, "%s:%d: Error not supporting (%d) AF_INET6", __FUNCTION__, __LINE__,
-                         servers[i]->sa_family);
-                }
-                free(servers[i]);
-                servers[i] = NULL;
-            }
-        }
+        LOG(DLOGL_ERROR, "could not resolve %s", hostname ? hostname : "(null)");
     }
 
     return returnString;
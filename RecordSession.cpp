@@ -13,6 +13,9 @@ Implementation file for RecordSession class
 #include "RecordSession.h"
 #include "languageSelection.h"
 #include "dvr_metadata_reader.h"
+#include "drivePlacement.h"
+#include "tsbConversion.h"
+#include "monotonicTime.h"
 #include <cpe_error.h>
 #include <cpe_common.h>
 #include <misc_platform.h>
@@ -27,6 +30,7 @@ Implementation file for RecordSession class
 #include "csci-dvr-scheduler-api.h"
 
 #include <assert.h>
+#include <errno.h>
 
 
 #ifdef LOG
@@ -111,11 +115,35 @@ void MSPRecordSession::metadataCallback(void)
     }
     else
     {
+        pthread_mutex_lock(&mCaMetaMutex);
         mIsCAMetaWritten = true;
+        pthread_cond_broadcast(&mCaMetaCond);
+        pthread_mutex_unlock(&mCaMetaMutex);
     }
     dlog(DL_MSP_MPLAYER, DLOGL_NOISE, "Writing CA metadata is finished !!!!\n");
 }
 
+/** *********************************************************
+    \returns true once the CA metadata is written, false after timeoutMs
+*/
+bool MSPRecordSession::waitCAMetaData(unsigned int timeoutMs)
+{
+    struct timespec ts;
+    monotonicDeadlineIn(timeoutMs, &ts);
+
+    pthread_mutex_lock(&mCaMetaMutex);
+    while (!mIsCAMetaWritten)
+    {
+        if (pthread_cond_timedwait(&mCaMetaCond, &mCaMetaMutex, &ts) == ETIMEDOUT)
+        {
+            break;
+        }
+    }
+    bool written = mIsCAMetaWritten;
+    pthread_mutex_unlock(&mCaMetaMutex);
+    return written;
+}
+
 
 /** *********************************************************
  *  only used to call through to the proper record session
@@ -141,12 +169,15 @@ void MSPRecordSession::SetTsbFileName(int *tsbHardDrive, unsigned int tsb_number
 
     if (*tsbHardDrive == -1)
     {
-        // Get TSB drive from scheduler
-        *tsbHardDrive = Csci_Dvr_GetTsbDrive();
+        // the drive of the scheduler unless the other one is less loaded
+        *tsbHardDrive = DrivePlacement::getInstance()->chooseDrive(kDriveLoad_Tsb, 0, TSB_VIDEO_BITRATE, Csci_Dvr_GetTsbDrive());
     }
 
     LOG(DLOGL_NOISE, " tsbHardDrive: %d", *tsbHardDrive);
 
+    DrivePlacement::getInstance()->remove(mTsbLoadId);
+    mTsbLoadId = DrivePlacement::getInstance()->add(*tsbHardDrive, kDriveLoad_Tsb, 0, TSB_VIDEO_BITRATE);
+
     snprintf(mtsb_filename, TSB_MAX_FILENAME_SIZE, "/mnt/dvr%d/dvr00%d", *tsbHardDrive, tsb_number + 1);
     LOG(DLOGL_NOISE, "%s : TSB = %s", __FUNCTION__, mtsb_filename);
 }
@@ -665,8 +696,9 @@ eMspStatus MSPRecordSession::startConvert(std::string recfilename, uint32_t nptR
 
     eMspStatus status = kMspStatus_Ok;
     int err;
-    unsigned int timeout_ms = 0;
+    struct timespec start;
 
+    clock_gettime(CLOCK_MONOTONIC, &start);
     Pmt *pmt = NULL;
     if (mPsiptr)
     {
@@ -709,19 +741,13 @@ eMspStatus MSPRecordSession::startConvert(std::string recfilename, uint32_t nptR
     {
     case kRecordSessionStarted:
     {
-        if (mIsCAMetaWritten == false)
-        {
-            /* Wait for CS metadata --- this handles the condition when immediately on channel change recording is started*/
-            while (!mIsCAMetaWritten && (timeout_ms < 50000))
-            {
-                usleep(10000);
-                timeout_ms += 100;
-            }
-            LOG(DLOGL_NOISE, "CA metadata available = %d", mIsCAMetaWritten);
-        }
+        /* Wait for CA metadata --- this handles the condition when immediately on channel change recording is started*/
+        bool caMetaWritten = waitCAMetaData(5000);
+        LOG(DLOGL_NOISE, "CA metadata available = %d", caMetaWritten);
 
-        if (mIsCAMetaWritten)
+        if (caMetaWritten)
         {
+            compactMetaData(false);
             err = cpe_record_TSBConversionStart(mRecHandle, recfilename.c_str(), nptRecordStartTime, nptRecordStopTime);
             if (err != kCpe_NoErr)
             {
@@ -736,6 +762,7 @@ eMspStatus MSPRecordSession::startConvert(std::string recfilename, uint32_t nptR
             {
                 LOG(DLOGL_NOISE, "cpe_record_TSBConversionStart success!");
                 mState = kRecordSessionConversionStarted;
+                addRecordLoad(recfilename);
             }
         }
         else
@@ -756,6 +783,7 @@ eMspStatus MSPRecordSession::startConvert(std::string recfilename, uint32_t nptR
                    "DLOG|MSP|Recording Failure|%s:writing meta data failed, %d",
                    __FUNCTION__, err);
         }
+        addConversionTime(recfilename, nptRecordStartTime, nptRecordStopTime, start);
 
     }
     break;
@@ -806,6 +834,7 @@ eMspStatus MSPRecordSession::stopConvert()
     {
     case kRecordSessionConversionStarted:
     {
+        compactMetaData(false);
         int err = cpe_record_TSBConversionStop(mRecHandle);
         if (err)
         {
@@ -820,6 +849,8 @@ eMspStatus MSPRecordSession::stopConvert()
             LOG(DLOGL_NOISE, "cpe_record_TSBConversionStop  mRecHandle %p success!!", mRecHandle);
             //restoring to original TSB running freely state with no conversion
             mState = kRecordSessionStarted;
+            DrivePlacement::getInstance()->remove(mRecordLoadId);
+            mRecordLoadId = 0;
         }
     }
     break;
@@ -1441,23 +1472,20 @@ eMspStatus MSPRecordSession::getVideoPid(std::string first_fragment_file, bool b
 
 
                     dlog(DL_MSP_DVR, DLOGL_REALLY_NOISY, "Interrupted recording , hence calling up CA ReadMrdvrMetadata passing fragment file  %s", first_fragment_file.c_str());
-                    tCpeRecDataBase *DvrBlobDb = NULL;
-                    tCpeRecDataBaseType *CaDvrBlobdb = NULL;
 
                     //retrieve the DVR metadata of the original fragment.
-                    status = ReadMrdvrMetaData((char *)first_fragment_file.c_str(), &DvrBlobDb);
-                    if (status == kMspStatus_Ok)
+                    const tDvrMetadataInfo *metadata = DvrMetadataIndex::getInstance()->acquire(first_fragment_file);
+                    if (metadata != NULL)
                     {
                         LOG(DLOGL_REALLY_NOISY, "first record fragment for DVR blob retrieval success");
+                        status = kMspStatus_Ok;
 
                         //retrieve the CA blob.
-                        eBlobType dvr_blob;  //unused here though
-                        CaDvrBlobdb  = GetDecryptCABlob(DvrBlobDb , &dvr_blob);
-                        if (CaDvrBlobdb != NULL)
+                        if (metadata->caBlob != NULL)
                         {
 
                             //pass it up to CA
-                            ret_value = mRecordSession->connectDvrMetadata((const uint8_t * const) CaDvrBlobdb->dataBuf, CaDvrBlobdb->size);
+                            ret_value = mRecordSession->connectDvrMetadata((const uint8_t * const) metadata->caBlob, metadata->caBlobSize);
                             if (ret_value != 0)
                             {
                                 dlog(DL_MSP_DVR, DLOGL_ERROR, "RecordSession::%s:%d connectDvrMetadata failed. err=%d", __FUNCTION__, __LINE__, ret_value);
@@ -1466,26 +1494,20 @@ eMspStatus MSPRecordSession::getVideoPid(std::string first_fragment_file, bool b
                             {
                                 dlog(DL_MSP_DVR, DLOGL_REALLY_NOISY, "CA createCaAsset returned %d", ret_value);
                             }
-
-                            dlog(DL_MSP_DVR, DLOGL_NOISE, "Freeing the CAM blob memories allocated");
                         }
                         else
                         {
                             LOG(DLOGL_ERROR, "Unable to fetch the CAM blob from DVR metadata");
 
                         }
+                        DvrMetadataIndex::getInstance()->release(metadata);
                     }
                     else
                     {
                         LOG(DLOGL_ERROR, "Unable to open the first record fragment for DVR blob");
+                        status = kMspStatus_Error;
                     }
 
-                    if (DvrBlobDb != NULL)
-                        delete [] DvrBlobDb;
-
-                    if (CaDvrBlobdb != NULL)
-                        delete CaDvrBlobdb;
-
                 }
 
 
@@ -1714,8 +1736,33 @@ eMspStatus  MSPRecordSession::writeAllMetaData(std::string filename)
     metaDataDBPtr->dbHdr.size = metaDataSize; //size of total database
     metaDataDBPtr->dbHdr.checksum = calculate_checksum((uint8_t*)metaDataDBPtr, metaDataSize);
     metaDataDBPtr->dbHdr.CCI = mCCiValue;
+
+    // CA blob and descriptor updates only append to the journal of the file, see recordMetadataJournal.h
+    tRecMetaEntries entries;
+    RecordMetadataJournal::toEntries((uint8_t *) metaDataDBPtr, metaDataSize, entries);
+
+    pthread_mutex_lock(&mMetaJournalMutex);
+    RecordMetadataJournal *journal = mMetaJournals[filename];
+    if (journal == NULL)
+    {
+        journal = new RecordMetadataJournal(filename, true);
+        mMetaJournals[filename] = journal;
+    }
+    if (!journal->update(entries, mCCiValue))
+    {
+        pthread_mutex_unlock(&mMetaJournalMutex);
+        free(metaDataDBPtr);
+        LOG(DLOGL_NOISE, "metadata of %s journaled", filename.c_str());
+        return kMspStatus_Ok;
+    }
+
     LOG(DLOGL_NOISE, "cpe_record_writemetadat writes metadat with the cci value %u", metaDataDBPtr->dbHdr.CCI);
     err = cpe_record_WriteMetaData(mRecHandle, filename.c_str(), metaDataDBPtr, metaDataSize);
+    if (err == kCpe_NoErr)
+    {
+        journal->baseWritten(metaDataSize);
+    }
+    pthread_mutex_unlock(&mMetaJournalMutex);
 
     //moved to prevent memory leak
     free(metaDataDBPtr);
@@ -1733,6 +1780,56 @@ eMspStatus  MSPRecordSession::writeAllMetaData(std::string filename)
     return kMspStatus_Ok;
 }
 
+/** *********************************************************
+    Writes the base of the metadata files that have records in their journal,
+    while the record handle is still open.  The platform reads the base only:
+    done before a conversion copies the TSB base and when a recording stops,
+    release drops the journals when the handle is closed
+*/
+void MSPRecordSession::compactMetaData(bool release)
+{
+    FNLOG(DL_MSP_DVR);
+
+    pthread_mutex_lock(&mMetaJournalMutex);
+    std::map<std::string, RecordMetadataJournal *>::iterator itr;
+    for (itr = mMetaJournals.begin(); itr != mMetaJournals.end(); ++itr)
+    {
+        RecordMetadataJournal *journal = itr->second;
+        if (journal->hasJournal())
+        {
+            tRecMetaEntries entries;
+            uint32_t cci;
+            std::vector<uint8_t> db;
+
+            journal->getWritten(entries, &cci);
+            RecordMetadataJournal::toDatabase(entries, cci, db);
+            tCpeRecDataBase *metaDataDBPtr = (tCpeRecDataBase *) &db[0];
+            metaDataDBPtr->dbHdr.checksum = calculate_checksum(&db[0], db.size());
+
+            int err = cpe_record_WriteMetaData(mRecHandle, itr->first.c_str(), metaDataDBPtr, db.size());
+            if (err == kCpe_NoErr)
+            {
+                journal->baseWritten(db.size());
+            }
+            else
+            {
+                // the readers still replay the journal
+                LOG(DLOGL_ERROR, "cpe_record_WriteMetaData %s error %d", itr->first.c_str(), err);
+            }
+        }
+        if (release)
+        {
+            journal->logStats();
+            delete journal;
+        }
+    }
+    if (release)
+    {
+        mMetaJournals.clear();
+    }
+    pthread_mutex_unlock(&mMetaJournalMutex);
+}
+
 
 eMspStatus  MSPRecordSession::writeAllAnalogMetaData(std::string filename)
 {
@@ -2164,6 +2261,7 @@ eMspStatus MSPRecordSession::stopTSB(void)
         }
 
 
+        compactMetaData(false);
         err = cpe_record_Stop(mRecHandle);
         if (err != kCpe_NoErr)
         {
@@ -2173,6 +2271,8 @@ eMspStatus MSPRecordSession::stopTSB(void)
                    __FUNCTION__, err);
         }
         mState = kRecordSessionStopped;
+        DrivePlacement::getInstance()->remove(mRecordLoadId);
+        mRecordLoadId = 0;
 
         break;
 
@@ -2189,6 +2289,29 @@ eMspStatus MSPRecordSession::stopTSB(void)
 /** *********************************************************
     \returns
 */
+void MSPRecordSession::addRecordLoad(const std::string &recfilename)
+{
+    int drive = DrivePlacement::driveOf(recfilename);
+    if (drive == -1)
+    {
+        drive = DrivePlacement::driveOf(mtsb_filename);
+    }
+    DrivePlacement::getInstance()->remove(mRecordLoadId);
+    mRecordLoadId = DrivePlacement::getInstance()->add(drive, kDriveLoad_Recording, 0, TSB_VIDEO_BITRATE);
+}
+
+/** *********************************************************
+    Keeps the time the conversion of the buffered range took to start,
+    platform conversion and metadata included
+*/
+void MSPRecordSession::addConversionTime(const std::string &recfilename, uint32_t nptRecordStartTime, uint32_t nptRecordStopTime,
+        const struct timespec &start)
+{
+    uint32_t elapsedMs = monotonicElapsedMs(start);
+    uint32_t bufferMs = (nptRecordStopTime > nptRecordStartTime) ? (nptRecordStopTime - nptRecordStartTime) : 0;
+    TsbConversion::getInstance()->addTime(TsbConversion::modeOf(mtsb_filename, recfilename), bufferMs, elapsedMs);
+}
+
 eMspStatus MSPRecordSession::closeTSB(void)
 {
     FNLOG(DL_MSP_DVR);
@@ -2200,6 +2323,7 @@ eMspStatus MSPRecordSession::closeTSB(void)
     case kRecordSessionOpened:
     case kRecordSessionConfigured:
     {
+        compactMetaData(true);
         int err = cpe_record_Close(mRecHandle);
         if (err != kCpe_NoErr)
         {
@@ -2213,6 +2337,8 @@ eMspStatus MSPRecordSession::closeTSB(void)
         {
             mRecHandle = 0;
             mState = kRecordSessionClosed;
+            DrivePlacement::getInstance()->remove(mTsbLoadId);
+            mTsbLoadId = 0;
         }
     }
     break;
@@ -2306,10 +2432,14 @@ eMspStatus MSPRecordSession::startConvertAnalogTSB(std::string recfilename, uint
     FNLOG(DL_MSP_DVR);
     eMspStatus status = kMspStatus_Ok;
     int err;
+    struct timespec start;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
     switch (mState)
     {
     case kRecordSessionStarted:
     {
+        compactMetaData(false);
         err = cpe_record_TSBConversionStart(mRecHandle, recfilename.c_str(), (uint32_t)nptRecordStartTime, (uint32_t)nptRecordStopTime);
         if (err != kCpe_NoErr)
         {
@@ -2321,6 +2451,7 @@ eMspStatus MSPRecordSession::startConvertAnalogTSB(std::string recfilename, uint
         {
             dlog(DL_MSP_DVR, DLOGL_NORMAL, "RecordSession::%s:%d Call cpe_record_TSBConversionStart(...) success!!!", __FUNCTION__, __LINE__);
             mState = kRecordSessionConversionStarted;
+            addRecordLoad(recfilename);
         }
 
         err = writeAllAnalogMetaData(recfilename);
@@ -2328,6 +2459,7 @@ eMspStatus MSPRecordSession::startConvertAnalogTSB(std::string recfilename, uint
         {
             dlog(DL_MSP_DVR, DLOGL_ERROR, "RecordSession::%s:%d writeAllAnalogMetaData failed. error %d with record handle %d ", __FUNCTION__, __LINE__, err, (int) mRecHandle);
         }
+        addConversionTime(recfilename, nptRecordStartTime, nptRecordStopTime, start);
 
     }
     break;
@@ -2689,6 +2821,19 @@ MSPRecordSession::~MSPRecordSession()
 {
     FNLOG(DL_MSP_DVR);
 
+    std::map<std::string, RecordMetadataJournal *>::iterator itr;
+    for (itr = mMetaJournals.begin(); itr != mMetaJournals.end(); ++itr)
+    {
+        delete itr->second;
+    }
+    mMetaJournals.clear();
+    pthread_mutex_destroy(&mMetaJournalMutex);
+    pthread_cond_destroy(&mCaMetaCond);
+    pthread_mutex_destroy(&mCaMetaMutex);
+
+    DrivePlacement::getInstance()->remove(mRecordLoadId);
+    DrivePlacement::getInstance()->remove(mTsbLoadId);
+
     if (mCaMetaDataPtr != NULL)
     {
         free(mCaMetaDataPtr);
@@ -2735,6 +2880,8 @@ MSPRecordSession::~MSPRecordSession()
 MSPRecordSession::MSPRecordSession()
 {
     FNLOG(DL_MSP_DVR);
+    pthread_condattr_t condAttr;
+
     mState = kRecordSessionIdle;
     mCb = NULL;
     mRecHandle = 0;
@@ -2747,11 +2894,19 @@ MSPRecordSession::MSPRecordSession()
     mCaMetaDataSize = 0;
     mCaDescriptorLength = 0;
     mCaptionDescriptorLength = 0;
+    pthread_mutex_init(&mMetaJournalMutex, NULL);
+    mTsbLoadId = 0;
+    mRecordLoadId = 0;
     mCaSystem = 0;
     mCaPid = 0;
     mSfHandle = NULL;
     mSourceHandle = NULL;
     mIsCAMetaWritten = false;
+    pthread_mutex_init(&mCaMetaMutex, NULL);
+    pthread_condattr_init(&condAttr);
+    pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+    pthread_cond_init(&mCaMetaCond, &condAttr);
+    pthread_condattr_destroy(&condAttr);
     mPsiptr = NULL;
     mPgmNo = -1;
     memset(&mPmtInfo, 0, sizeof(mPmtInfo));
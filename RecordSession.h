@@ -11,6 +11,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <string>
+#include <map>
+#include <pthread.h>
 
 // cpe includes
 #include <cpe_source.h>
@@ -26,6 +28,7 @@
 #include "psi.h"
 #include "AnalogPsi.h"
 #include "Cam.h"
+#include "recordMetadataJournal.h"
 /**
    \class RecordSession
    \brief this class will be the gateway for handling requests to set up the A/V
@@ -212,6 +215,8 @@ private:
     void *mRecvdData;   /**< To store the client context data */
     tCpePgrmHandlePmt  mPmtInfo;
     bool mIsCAMetaWritten;
+    pthread_mutex_t mCaMetaMutex;   ///< signals mIsCAMetaWritten to startConvert()
+    pthread_cond_t  mCaMetaCond;
     Psi  *mPsiptr;
     uint16_t             mPgmNo;
     uint8_t *mRawPmtPtr, *mRawPatPtr;
@@ -244,6 +249,7 @@ private:
     eMspStatus  savePidsMetaData();
     eMspStatus  writeAllMetaData(std::string);
     eMspStatus  writeAllAnalogMetaData(std::string);
+    void        compactMetaData(bool release);
 
     uint32_t mCaMetaDataSize;
     uint8_t *mCaMetaDataPtr;
@@ -252,6 +258,8 @@ private:
     tCpeRecDataBasePidTable *mDbPids;
     uint32_t mDbPidsSize;
     uint32_t mCaptionDescriptorLength;
+    std::map<std::string, RecordMetadataJournal *> mMetaJournals;   ///< by metadata file written
+    pthread_mutex_t mMetaJournalMutex;
 
 // CAM support functions
     static void *secFltCallbackFunction(tCpeSFltCallbackTypes type, void* userdata, void* pCallbackSpecific);
@@ -270,7 +278,13 @@ private:
     unsigned int mScramblingMode;
     static void caDvrMetadataCallback(void *ctx);
     void metadataCallback(void);
+    bool waitCAMetaData(unsigned int timeoutMs);
     void SetTsbFileName(int *tsbHardDrive, unsigned int tsb_number);
+    void addRecordLoad(const std::string &recfilename);
+    void addConversionTime(const std::string &recfilename, uint32_t nptRecordStartTime, uint32_t nptRecordStopTime,
+                           const struct timespec &start);
+    int mTsbLoadId;         ///< DrivePlacement ids of the TSB and of the recording converted from it
+    int mRecordLoadId;
     bool mbIsAnalog;
     int mEntRegId;
     void *mPtrCBData;
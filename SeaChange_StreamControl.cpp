@@ -74,8 +74,7 @@ eIOnDemandStatus SeaChange_StreamControl::StreamPlay(bool usingStartNPT)
     LOG(DLOGL_FUNCTION_CALLS, "usingStartNPT: %d", usingStartNPT);
 
     eIOnDemandStatus status = ON_DEMAND_OK;
-    isAssetUpdatedNPTset = FALSE;
-    isPrecisoNset = FALSE;
+    nptModel.invalidate();
 
     if (!isStreamParametersSet && ptrOnDemand)
     {
@@ -137,7 +136,7 @@ eIOnDemandStatus SeaChange_StreamControl::StreamPlay(bool usingStartNPT)
 
         if (socketFd != -1)
         {
-            setupObject->SendMessage(socketFd, data, length);
+            lscpPipeline.send(socketFd, setupObject->GetReturnTransId(), LSC_PLAY, data, length);
         }
         else
         {
@@ -157,6 +156,28 @@ eIOnDemandStatus SeaChange_StreamControl::StreamPlay(bool usingStartNPT)
 }
 
 
+// a reply from the server is the reference the position polls are answered from until the next one
+static void syncNptModel(NptModel &model, VodLscp_Base *message)
+{
+    if (message->GetReturnStatusCode() != LSC_OK)
+    {
+        model.invalidate();
+    }
+    else if (message->GetNPT() == (i32) NPT_END)
+    {
+        model.syncSpeed(message->GetNum(), message->GetDen());
+    }
+    else if (message->GetMessageId() == LSC_PAUSE_REPLY)
+    {
+        // a paused stream does not move, whatever scale the reply carries
+        model.sync(message->GetNPT(), 0, 1);
+    }
+    else
+    {
+        model.sync(message->GetNPT(), message->GetNum(), message->GetDen());
+    }
+}
+
 void SeaChange_StreamControl::HandleInput(void *ptrMessage)
 {
     LOG(DLOGL_FUNCTION_CALLS, "ptrMessage: %p", ptrMessage);
@@ -173,6 +194,17 @@ void SeaChange_StreamControl::HandleInput(void *ptrMessage)
 
     LOG(DLOGL_NOISE, " Opcode recieved from VOD server is %d", opcode);
 
+    // the position and speed of a reply overtaken by a newer play/pause are stale
+    if ((opcode != LSC_DONE) && (lscpPipeline.complete(message->GetReturnTransId()) == kLscpReply_Superseded))
+    {
+        LOG(DLOGL_NOISE, "superseded reply opcode %d transaction-id %d", opcode, message->GetReturnTransId());
+        pthread_mutex_lock(&mutex_sr);
+        rettransid = message->GetReturnTransId();
+        retstatus = message->GetReturnStatusCode();
+        pthread_mutex_unlock(&mutex_sr);
+        return;
+    }
+
     switch (opcode)
 
     {
@@ -190,6 +222,7 @@ void SeaChange_StreamControl::HandleInput(void *ptrMessage)
         retstatus = message->GetReturnStatusCode();
         server_mode = message->GetMode();
         streamStarted = FALSE;
+        nptModel.invalidate();
         pthread_mutex_unlock(&mutex_sr);
 
         numerator < 0 ? ptrOnDemand->queueEvent(kOnDemandPlayBOFEvent) : ptrOnDemand->queueEvent(kOnDemandPlayEOFEvent);
@@ -200,7 +233,6 @@ void SeaChange_StreamControl::HandleInput(void *ptrMessage)
     case LSC_PLAY_REPLY:
     case LSC_PAUSE_REPLY:
     {
-        time(&start);
         pthread_mutex_lock(&mutex_sr);
         streamStarted = TRUE;
         if (opcode == LSC_PLAY_REPLY)
@@ -217,6 +249,7 @@ void SeaChange_StreamControl::HandleInput(void *ptrMessage)
         rettransid = message->GetReturnTransId();
         retstatus = message->GetReturnStatusCode();
         pthread_mutex_unlock(&mutex_sr);
+        syncNptModel(nptModel, message);
         LOG(DLOGL_NOISE, "Updating values for transaction-id %d having Return status code %d", rettransid, retstatus);
         LOG(DLOGL_NOISE, "Updated NPT to %f", nptPosition);
         LOG(DLOGL_NOISE, "Updated numerator to %d", numerator);
@@ -227,7 +260,6 @@ void SeaChange_StreamControl::HandleInput(void *ptrMessage)
     break;
 
     default:
-        time(&start);
         pthread_mutex_lock(&mutex_sr);
         streamStarted = TRUE;
         dlog(DL_MSP_ONDEMAND, DLOGL_NOISE, "Updating NPT, Num, Den received from Server");
@@ -240,6 +272,7 @@ void SeaChange_StreamControl::HandleInput(void *ptrMessage)
         rettransid = message->GetReturnTransId();
         retstatus = message->GetReturnStatusCode();
         pthread_mutex_unlock(&mutex_sr);
+        syncNptModel(nptModel, message);
         LOG(DLOGL_NOISE, "Updating values for transaction-id %d having Return status code %d",
             rettransid, retstatus);
         LOG(DLOGL_NOISE, "Updated NPT to %f", nptPosition);
@@ -278,12 +311,12 @@ SeaChange_StreamControl::SeaChange_StreamControl(OnDemand* ptrOnDemand,
 {
 
     lscpBaseObj = new VodLscp_Base();
+    if (ptrOnDemand)
+    {
+        lscpPipeline.setEventLoop(ptrOnDemand->GetEventLoop());
+    }
     pClientMetaDataContext = pClientMetaDataContext;
-    isPrecisoNset = FALSE;
-    isAssetUpdatedNPTset = FALSE;
     StreamFailCount = 0;
-    start = 0;
-    end = 0;
 }
 
 SeaChange_StreamControl::~SeaChange_StreamControl()
@@ -293,93 +326,28 @@ SeaChange_StreamControl::~SeaChange_StreamControl()
         delete lscpBaseObj;
         lscpBaseObj = NULL;
     }
+    lscpPipeline.logStats();
+    lscpPipeline.reset();
     Close(socketFd);
     socketFd = -1;
 }
 /*SL  queries the middle ware very frequently for speed and position.
  *  This causes heavy network traffic if all of those requests are converted into protocol messages.
- *  To avoid this, approximating algorithm is used which keeps track of the position as soop as the streaming starts.
- *   It needs to keep track of NPT and numerator and denominator in all cases of normal play and trick modes(FF/RW).
- *   A precision update is required from VOD server to get the actual NPT values. This results in tremendous reduction of network traffic. */
+ *  To avoid this, nptModel predicts the position from the NPT and speed of the last reply from the VOD server,
+ *  and the server is only asked when the model has to be resynced. */
 
 eIOnDemandStatus SeaChange_StreamControl::StreamGetPosition(float *npt)
 {
     eIOnDemandStatus status = ON_DEMAND_ERROR;
+    int32_t nptMs = 0;
+    float endNPT = 0;
 
-    float nptPos = 0;
-    int16_t num = 0, den = 0;
-    bool strmStart;
-    pthread_mutex_lock(&mutex_sr);
-    nptPos = nptPosition;
-    num = numerator;
-    den = denominator;
-    strmStart = streamStarted;
-    static int prevNum = 1;
-    static int prevDen = 1;
-
-    pthread_mutex_unlock(&mutex_sr);
-
-    if (strmStart == TRUE)
+    ptrOnDemand->GetEndPosition(&endNPT);
+    nptModel.setEnd((int32_t)(endNPT * 1000));
+    if (nptModel.position(&nptMs))
     {
-
+        *npt = (float) nptMs / 1000;
         status = ON_DEMAND_OK;
-        if (num != prevNum)
-        {
-            num = prevNum;
-            den = prevDen;
-        }
-
-        if ((num == 1) && (den == 1))
-        {
-            time(&end);
-            *npt = (float)(nptPos + 1000 * (difftime(end, start))) / 1000;
-        }
-        else if ((num == 0))
-        {
-            *npt = (float) nptPos / 1000;
-        }
-        else if ((num == 15) && (den == 2))
-        {
-            time(&end);
-            *npt = (float)(nptPos + 7500 * (difftime(end, start))) / 1000;
-        }
-        else if ((num == -15) && (den == 2))
-        {
-            time(&end);
-            *npt = (float)(nptPos - 7500 * (difftime(end, start))) / 1000;
-        }
-        else
-        {
-            LOG(DLOGL_SIGNIFICANT_EVENT, "Warning: VOD Server returned UnKnown");
-            status = ON_DEMAND_ERROR;
-        }
-
-        float endNPT = 0;
-        ptrOnDemand->GetEndPosition(&endNPT);
-
-        if (((endNPT - (*npt)) < (PRECISION_UPDATE) && (isPrecisoNset == FALSE))
-                || (((*npt) < PRECISION_UPDATE) && (isPrecisoNset == FALSE))) //added braces for G8 Porting
-        {
-            pthread_mutex_lock(&mutex_sr);
-            streamStarted = FALSE;
-            isPrecisoNset = TRUE;
-            pthread_mutex_unlock(&mutex_sr);
-
-        }
-        if (((endNPT > ASSET_UP_NPT) && ((endNPT / (*npt)) < 2))
-                && (isAssetUpdatedNPTset == FALSE))
-        {
-            pthread_mutex_lock(&mutex_sr);
-            streamStarted = FALSE;
-            isAssetUpdatedNPTset = TRUE;
-            pthread_mutex_unlock(&mutex_sr);
-
-        }
-        pthread_mutex_lock(&mutex_sr);
-        nptPosition = (*npt) * 1000;
-        pthread_mutex_unlock(&mutex_sr);
-        time(&start);
-
     }
     else
     {
@@ -398,8 +366,8 @@ eIOnDemandStatus SeaChange_StreamControl::StreamGetPosition(float *npt)
 
             if (socketFd != -1)
             {
-                setupObject->SendMessage(socketFd, data, length);
                 localtransid = setupObject->GetReturnTransId();
+                lscpPipeline.send(socketFd, localtransid, LSC_STATUS, data, length);
             }
 
             delete setupObject;
@@ -449,8 +417,6 @@ eIOnDemandStatus SeaChange_StreamControl::StreamGetPosition(float *npt)
 
         LOG(DLOGL_SIGNIFICANT_EVENT, "Warning: VOD Server did not respond");
     }
-    prevNum = numerator;
-    prevDen = denominator;
     return status;
 }
 
@@ -483,22 +449,10 @@ eIOnDemandStatus SeaChange_StreamControl::StreamGetSpeed(int16_t *num, uint16_t
     eIOnDemandStatus status = ON_DEMAND_ERROR;
 
 
-    int16_t nm = 0, dn = 0;
-    bool strmStart;
-    pthread_mutex_lock(&mutex_sr);
-    nm = numerator;
-    dn = denominator;
-    strmStart = streamStarted;
-    pthread_mutex_unlock(&mutex_sr);
-
-    if (strmStart == TRUE)
+    if (nptModel.speed(num, den))
     {
-        *num = nm;
-        *den = dn;
         status = ON_DEMAND_OK;
-
     }
-
     else
     {
         uint8_t *data;
@@ -516,8 +470,8 @@ eIOnDemandStatus SeaChange_StreamControl::StreamGetSpeed(int16_t *num, uint16_t
 
             if (socketFd != -1)
             {
-                setupObject->SendMessage(socketFd, data, length);
                 localtransid = setupObject->GetReturnTransId();
+                lscpPipeline.send(socketFd, localtransid, LSC_STATUS, data, length);
             }
 
             delete setupObject;
@@ -590,8 +544,11 @@ eIOnDemandStatus SeaChange_StreamControl::StreamPause()
 
         if (socketFd != -1)
         {
-            setupObject->SendMessage(socketFd, data, length);
-            status = ON_DEMAND_OK;
+            nptModel.invalidate();
+            if (lscpPipeline.send(socketFd, setupObject->GetReturnTransId(), LSC_PAUSE, data, length))
+            {
+                status = ON_DEMAND_OK;
+            }
         }
 
         delete setupObject;
@@ -603,8 +560,8 @@ eIOnDemandStatus SeaChange_StreamControl::StreamPause()
 
 void SeaChange_StreamControl::ReadStreamSocketData()
 {
-    uint8_t *msgData = NULL;
-    uint32_t msgLen  = 0;
+    ui8 msgData[LSC_MSG_SIZE];
+    int32_t msgLen = 0;
     VodLscp_Base *lscpObj;
 
     LOG(DLOGL_REALLY_NOISY, " Current Fail count value is %d", StreamFailCount);
@@ -617,47 +574,35 @@ void SeaChange_StreamControl::ReadStreamSocketData()
             ptrOnDemand->queueEvent(kOnDemandStreamErrorEvent);
         }
 
-        bool readStatus = lscpBaseObj->ReadMessageFromSocket(GetFD(), &msgData, &msgLen);
-
-        if (readStatus)
+        // replies to pipelined commands may arrive together
+        while ((msgLen = lscpPipeline.receive(GetFD(), msgData, sizeof(msgData))) > 0)
         {
             //Reset it every time we get a successful Socket read
             StreamFailCount = 0;
 
-
             LOG(DLOGL_REALLY_NOISY, "lscpBaseObj->GetMessageTypeObject");
             lscpObj = lscpBaseObj->GetMessageTypeObject(msgData, msgLen);
-
-            if (msgData && msgLen)
+            if (lscpObj)
             {
-                if (lscpObj)
-                {
-                    //parse lscp response
-
-                    LOG(DLOGL_REALLY_NOISY, "lscpObj->ParseLscpMessageBody");
-                    lscpObj->ParseLscpMessageBody(msgData, msgLen);
-                    //Handle lscp response type
-                    HandleInput((void *)lscpObj);
-                }
-                else
-                {
-                    LOG(DLOGL_ERROR, "warning null lscpObj");
-                }
+                //parse lscp response
+                LOG(DLOGL_REALLY_NOISY, "lscpObj->ParseLscpMessageBody");
+                lscpObj->ParseLscpMessageBody(msgData, msgLen);
+                //Handle lscp response type
+                HandleInput((void *)lscpObj);
+                delete lscpObj;
             }
             else
             {
-                LOG(DLOGL_ERROR, "warning msgData: %p  msgLen: %d ", msgData, msgLen);
+                LOG(DLOGL_ERROR, "warning null lscpObj");
             }
         }
-        else
-        {
 
+        if (msgLen < 0)
+        {
             LOG(DLOGL_ERROR, "warning ReadMessageFromSocket for stream failed");
             StreamFailCount++;
         }
     }
-
-
 }
 
 void SeaChange_StreamControl::HandleStreamResp()
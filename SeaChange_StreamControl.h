@@ -19,10 +19,9 @@
 #include "vod.h"
 #include "ondemand.h"
 #include "lscProtocolclass.h"
+#include "lscpPipeline.h"
 #define HUNDRED_MS 100000
 #define LSC_TIMEOUT 3
-#define PRECISION_UPDATE 180
-#define ASSET_UP_NPT 1500
 
 class OnDemand;
 
@@ -33,7 +32,10 @@ protected:
          * Pointer to LSCP base
          */
     VodLscp_Base *lscpBaseObj;
-    time_t start, end;
+    /*
+         * Commands in flight on the stream control socket
+         */
+    LscpPipeline lscpPipeline;
 public:
 
     eIOnDemandStatus StreamGetParameter();
@@ -70,8 +72,6 @@ public:
 
 private:
 
-    bool isPrecisoNset;
-    bool isAssetUpdatedNPTset;
     int StreamFailCount;
 };
 #endif
@@ -1,5 +1,6 @@
 
 #include "TsbHandler.h"
+#include "RecordSession.h"
 
 #ifdef LOG
 #error  LOG already defined
@@ -30,6 +31,19 @@ TsbHandler::TsbHandler()
         mTsbInfo->tsb_availability[i] = true;
     }
 
+    // TSBs kept allocated on their record drive, as many as the TSBs unless configured lower
+    char poolSettingbuffer[10] = {0};
+    int poolSize = mTsbCount;
+    Settings_Get(NULL, "ciscoSg/media/tsbPoolSize", poolSettingbuffer, (size_t) 3, &attr);
+    if ((sscanf(poolSettingbuffer, "%d", &poolSize) != 1) || (poolSize < 0) || (poolSize > mTsbCount))
+    {
+        poolSize = mTsbCount;
+    }
+    dlog(DL_MSP_MPLAYER, DLOGL_NOISE, "%s[%d] TSB POOL SIZE=%d", __FUNCTION__, __LINE__, poolSize);
+
+    mTsbPool = new TsbPool(poolSize, (uint64_t) TSB_SIZE_IN_SECS * TSB_VIDEO_BITRATE * 1000 / 8);
+    mTsbPool->start();
+
     // Initialising the mutex that protects Mediaplayer shared resources
     pthread_mutexattr_t mta;
     pthread_mutexattr_init(&mta);
@@ -54,7 +68,7 @@ void TsbHandler::unlocktsbhandlermutex()
 }
 
 
-eMspStatus  TsbHandler::get_tsb(unsigned int *tsb_number)
+eMspStatus  TsbHandler::get_tsb(unsigned int *tsb_number, int drive)
 {
     eMspStatus status = kMspStatus_Ok;
     int i;
@@ -63,16 +77,30 @@ eMspStatus  TsbHandler::get_tsb(unsigned int *tsb_number)
 
     locktsbhandlermutex();
 
-    //going through the available TSB's
+    //going through the available TSB's, one already prepared on the drive first
     for (i = 0; i < mTsbCount; i++)
     {
-        if (mTsbInfo->tsb_availability[i] == true)
+        if ((mTsbInfo->tsb_availability[i] == true) && mTsbPool->isReady(drive, i))
         {
-            mTsbInfo->tsb_availability[i] = false;
             break;
         }
     }
     if (i == mTsbCount)
+    {
+        for (i = 0; i < mTsbCount; i++)
+        {
+            if (mTsbInfo->tsb_availability[i] == true)
+            {
+                break;
+            }
+        }
+    }
+    if (i < mTsbCount)
+    {
+        mTsbInfo->tsb_availability[i] = false;
+        mTsbPool->acquire(drive, i);
+    }
+    if (i == mTsbCount)
     {
         dlog(DL_MEDIAPLAYER, DLOGL_ERROR, "%d,%s All TSB's are in use \n", __LINE__, __FUNCTION__);
 
@@ -104,6 +132,7 @@ eMspStatus TsbHandler::release_tsb(unsigned int *tsb_number)
     else
     {
         mTsbInfo->tsb_availability[*tsb_number] = true;
+        mTsbPool->recycle(*tsb_number);
     }
 
     unlocktsbhandlermutex();
@@ -121,3 +150,7 @@ TsbHandler * TsbHandler::getTsbHandlerInstance()
     return mInstance;
 }
 
+TsbPool * TsbHandler::getTsbPool()
+{
+    return mTsbPool;
+}
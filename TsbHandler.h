@@ -8,6 +8,7 @@
 #include "sail-settingsuser-api.h"
 #include "use_common.h"
 #include "MSPScopedPerfCheck.h"
+#include "tsbPool.h"
 
 #if defined(DMALLOC)
 #include "dmalloc.h"
@@ -50,6 +51,7 @@ private:
     TsbHandler(); // private for singleton
     struct tsb_info *mTsbInfo;
     int mTsbCount; //Has to be equal to number of tuners for DVR STBs
+    TsbPool *mTsbPool; //TSB files kept allocated and open ahead of the record sessions
 
     pthread_mutex_t m_TsbHandlerMutex;
 
@@ -58,8 +60,10 @@ public:
     ~TsbHandler();
     static TsbHandler * getTsbHandlerInstance();
     eMspStatus getNumberOfTsbs();
-    eMspStatus get_tsb(unsigned int *tsb_number);
+    // drive of the session when known, a TSB ready on it is preferred
+    eMspStatus get_tsb(unsigned int *tsb_number, int drive = -1);
     eMspStatus release_tsb(unsigned int *tsb_number);
+    TsbPool * getTsbPool();
 
     void locktsbhandlermutex();
     void unlocktsbhandlermutex();
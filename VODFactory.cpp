@@ -17,16 +17,245 @@
 #include "SeaChange_SessionControl.h"
 #include "SeaChange_StreamControl.h"
 #include "VODFactory.h"
+#include "cloudDvrRtspTransport.h"
+#include "vodDnsCache.h"
+#include "monotonicTime.h"
 #include "string.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 
 
 #define LOG(level, msg, args...)  dlog(DL_MSP_MPLAYER, level,"VODFactory:%s:%d " msg, __FUNCTION__, __LINE__, ##args);
 
+// the DSM-CC vendors are told apart by configuration only, a single
+// ClientStatusRequest per SRM tells whether it answers at all
+#define kDsmccProbe     kVodVendorBit(kVodVendor_SeaChange)
+#define kProbeReplyMaxSize  1500
+
+static pthread_once_t gProbeOnce = PTHREAD_ONCE_INIT;
+
+void VODFactory::registerProbes(void)
+{
+    VodVendorProbe *probe = VodVendorProbe::getInstance();
+
+    probe->setProbe(kVodVendor_SeaChange, dsmccStatusProbe);
+    probe->setProbe(kVodVendor_CloudDvr, rtspOptionsProbe);
+}
+
+VodVendorProbe* VODFactory::getProbe(void)
+{
+    pthread_once(&gProbeOnce, registerProbes);
+    return VodVendorProbe::getInstance();
+}
+
+eVodVendor VODFactory::parseVendor(const std::string &srcUrl, const char *key)
+{
+    std::string mfg;
+    size_t pos = srcUrl.find(key);
+
+    if (pos != string::npos)
+    {
+        size_t strPos = srcUrl.find("=", pos);
+        size_t endPos = srcUrl.find("&", pos);
+        mfg = srcUrl.substr(strPos + 1, (endPos == string::npos) ? string::npos : endPos - strPos - 1);
+    }
+
+    LOG(DLOGL_NORMAL, "%s %s", key, mfg.c_str());
+
+    if (mfg == "Arris")
+    {
+        return kVodVendor_Arris;
+    }
+    else if (mfg == "Seachange")
+    {
+        return kVodVendor_SeaChange;
+    }
+    return kVodVendor_None;
+}
+
+std::string VODFactory::srmEndpoint(void)
+{
+    uint32_t srmIpAddr = 0;
+    uint16_t srmPort = 0;
+    char endpoint[32];
+
+    OnDemandSystemClient::getInstance()->GetSrmIpAddress(&srmIpAddr);
+    OnDemandSystemClient::getInstance()->GetSrmPort(&srmPort);
+    snprintf(endpoint, sizeof(endpoint), "%d.%d.%d.%d:%d", (srmIpAddr >> 24) & 0xFF, (srmIpAddr >> 16) & 0xFF,
+             (srmIpAddr >> 8) & 0xFF, srmIpAddr & 0xFF, srmPort);
+    return endpoint;
+}
+
+// ClientStatusRequest to the SRM from a socket of its own, so that the confirm
+// does not reach the session socket of the event loop
+bool VODFactory::dsmccStatusProbe(const std::string &endpoint, uint32_t timeoutMs)
+{
+    std::string::size_type colon = endpoint.rfind(':');
+    if (colon == std::string::npos)
+    {
+        return false;
+    }
+    std::string ip = endpoint.substr(0, colon);
+    uint16_t port = atoi(endpoint.c_str() + colon + 1);
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0)
+    {
+        LOG(DLOGL_ERROR, ":%m: Error creating the probe socket");
+        return false;
+    }
+
+    uint8_t stbMacAddr[MAC_ID_SIZE] = {0};
+    uint8_t clientId[DSMCC_CLIENTID_LEN] = {0};
+    OnDemandSystemClient::getInstance()->GetStbMacAddressAddress(stbMacAddr);
+    uint8_t *ptrId = DsmccUtils::GenerateClientId(stbMacAddr);
+    if (ptrId)
+    {
+        memcpy(clientId, ptrId, DSMCC_CLIENTID_LEN);
+        delete [] ptrId;
+    }
+
+    uint32_t transId = VodDsmcc_Base::getTransId();
+    VodDsmcc_ClientStatusRequest statusObject(dsmcc_ClientStatusRequest, transId, 26, dsmcc_RsnOK, clientId,
+            0x01, 0x00, NULL);
+    uint8_t *data = NULL;
+    uint32_t length = 0;
+    statusObject.PackDsmccMessageBody(&data, &length);
+
+    struct timespec deadline;
+    monotonicDeadlineIn(timeoutMs, &deadline);
+    bool sent = (data != NULL) && statusObject.SendMessage(fd, ip, port, data, length);
+    delete [] data;
+
+    bool answered = false;
+    int waitMs;
+    while (sent && !answered && ((waitMs = monotonicRemainingMs(deadline)) > 0))
+    {
+        struct pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, waitMs) <= 0)
+        {
+            break;
+        }
+
+        uint8_t reply[kProbeReplyMaxSize];
+        ssize_t len = recv(fd, reply, sizeof(reply), 0);
+        if (len < 0)
+        {
+            break;
+        }
+        answered = (len >= DsmccHeaderLayout::Size) &&
+                   (DsmccHeaderLayout::ProtocolDiscriminator::get(reply) == 0x11) &&
+                   (DsmccHeaderLayout::MessageId::get(reply) == dsmcc_ClientStatusConfirm);
+    }
+    close(fd);
+    return answered;
+}
+
+// RTSP OPTIONS to the Cloud DVR head-end
+bool VODFactory::rtspOptionsProbe(const std::string &endpoint, uint32_t timeoutMs)
+{
+    std::string::size_type colon = endpoint.rfind(':');
+    if (colon == std::string::npos)
+    {
+        return false;
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(atoi(endpoint.c_str() + colon + 1));
+    if (!VodDnsCache::getInstance()->resolve(endpoint.substr(0, colon), &addr.sin_addr))
+    {
+        return false;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        LOG(DLOGL_ERROR, ":%m: Error creating the probe socket");
+        return false;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+
+    struct timespec deadline;
+    monotonicDeadlineIn(timeoutMs, &deadline);
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = POLLOUT;
+
+    bool connected = (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) == 0);
+    if (!connected && (errno == EINPROGRESS) && (poll(&pfd, 1, monotonicRemainingMs(deadline)) > 0))
+    {
+        int err = 0;
+        socklen_t errLen = sizeof(err);
+        connected = (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &errLen) == 0) && (err == 0);
+    }
+
+    bool answered = false;
+    static const char request[] = "OPTIONS * RTSP/1.0\r\nCSeq: 1\r\n\r\n";
+    if (connected && (send(fd, request, sizeof(request) - 1, MSG_NOSIGNAL) == (ssize_t)(sizeof(request) - 1)))
+    {
+        char reply[16];
+        size_t got = 0;
+        int waitMs;
+
+        pfd.events = POLLIN;
+        while ((got < 9) && ((waitMs = monotonicRemainingMs(deadline)) > 0) && (poll(&pfd, 1, waitMs) > 0))
+        {
+            ssize_t len = recv(fd, reply + got, sizeof(reply) - got, 0);
+            if (len <= 0)
+            {
+                break;
+            }
+            got += len;
+        }
+        answered = (got >= 9) && (strncmp(reply, "RTSP/1.0 ", 9) == 0);
+    }
+    close(fd);
+    return answered;
+}
+
+void VODFactory::prefetchBackEnds(void)
+{
+    getProbe()->prefetch(srmEndpoint(), kDsmccProbe);
+}
+
+std::string VODFactory::headEndOf(const std::string &srcUrl)
+{
+    return (srcUrl.find("rtsp://") == 0) ? CloudDvrRtspTransport::headEnd(srcUrl) : srmEndpoint();
+}
+
+void VODFactory::invalidateBackEnd(const char *aSrcUrl)
+{
+    getProbe()->invalidate(headEndOf(aSrcUrl ? aSrcUrl : ""));
+    getProbe()->logStats();
+}
+
+bool VODFactory::isBackEndDown(const char *aSrcUrl)
+{
+    std::string headEnd = headEndOf(aSrcUrl ? aSrcUrl : "");
+
+    if (getProbe()->down(headEnd))
+    {
+        LOG(DLOGL_ERROR, "%s did not answer its last probe", headEnd.c_str());
+        return true;
+    }
+    return false;
+}
+
 VOD_SessionControl*  VODFactory :: getVODSessionControlInstance(OnDemand* ptrOnDemand, const char *aSrcUrl)
 {
     VOD_SessionControl *src = NULL;
-    char srmMfg[20] = {0};
-    size_t Pos = -1 , strPos = -1, endPos = -1;
+    size_t Pos = -1;
 
     FNLOG(DL_MEDIAPLAYER);
 
@@ -40,37 +269,39 @@ VOD_SessionControl*  VODFactory :: getVODSessionControlInstance(OnDemand* ptrOnD
     if (Pos == 0)
     {
         LOG(DLOGL_NORMAL, "VOD Session type for the given URL is Cloud DVR");
+        // nothing to choose from, the probe only keeps the latency of the head-end
+        getProbe()->prefetch(CloudDvrRtspTransport::headEnd(srcUrl), kVodVendorBit(kVodVendor_CloudDvr));
         CloudDvr_SessionControl* cloudDvr = new CloudDvr_SessionControl(ptrOnDemand, aSrcUrl, NULL, ePreparingToViewType);
         //Added for fixing the coverity defect
         cloudDvr->CreateDSMCCObj();
         src = cloudDvr;
+        src->SetVendor(kVodVendor_CloudDvr);
     }
     else
     {
-        Pos = srcUrl.find("srmManufacturer=");
-        if (Pos != string::npos)
-        {
-            strPos = srcUrl.find("=", Pos);
-            endPos = srcUrl.find("&", Pos);
-            strcpy(srmMfg, srcUrl.substr(strPos + 1, endPos - strPos - 1).c_str());
-        }
-
-        LOG(DLOGL_NORMAL, "srmManufacturer= %s", srmMfg);
+        eVodVendor vendor = parseVendor(srcUrl, "srmManufacturer=");
 
+        // the SRM does not tell its vendor, the probe only keeps its latency
+        getProbe()->prefetch(srmEndpoint(), kDsmccProbe);
 
-        if (strcmp(srmMfg, "Arris") == 0)
+        if (vendor == kVodVendor_Arris)
         {
             LOG(DLOGL_NORMAL, "VOD Session type for the given URL is ARRIS ");
             src = new Arris_SessionControl(ptrOnDemand, aSrcUrl, NULL, ePreparingToViewType);
         }
-        else if (strcmp(srmMfg, "Seachange") == 0)
+        else if (vendor == kVodVendor_SeaChange)
         {
             LOG(DLOGL_NORMAL, "VOD Session type for the given URL is SEA-CHANGE");
             src = new SeaChange_SessionControl(ptrOnDemand, aSrcUrl, NULL, ePreparingToViewType);
         }
         else
         {
-            LOG(DLOGL_ERROR, " Invalid VOD Session Control type");
+            LOG(DLOGL_ERROR, " Invalid VOD Session Control type, srmManufacturer missing or unknown");
+        }
+
+        if (src)
+        {
+            src->SetVendor(vendor);
         }
     }
     return src;
@@ -79,8 +310,7 @@ VOD_SessionControl*  VODFactory :: getVODSessionControlInstance(OnDemand* ptrOnD
 VOD_StreamControl*  VODFactory :: getVODStreamControlInstance(OnDemand* ptrOnDemand, const char *aSrcUrl)
 {
     VOD_StreamControl *src = NULL;
-    char strMfg[20] = {0};
-    size_t Pos = -1 , strPos = -1, endPos = -1;
+    size_t Pos = -1;
 
     FNLOG(DL_MEDIAPLAYER);
 
@@ -98,23 +328,19 @@ VOD_StreamControl*  VODFactory :: getVODStreamControlInstance(OnDemand* ptrOnDem
     }
     else
     {
-        Pos = srcUrl.find("streamerManufacturer=");
-        if (Pos != string::npos)
+        eVodVendor vendor = parseVendor(srcUrl, "streamerManufacturer=");
+        if ((vendor == kVodVendor_None) && ptrOnDemand && ptrOnDemand->getSessionControl())
         {
-            strPos = srcUrl.find("=", Pos);
-            endPos = srcUrl.find("&", Pos);
-            strcpy(strMfg, srcUrl.substr(strPos + 1, endPos - strPos - 1).c_str());
+            // the streamer of the back-end the session is set up with
+            vendor = ptrOnDemand->getSessionControl()->GetVendor();
         }
 
-        LOG(DLOGL_NORMAL, "streamerManufacturer= %s", strMfg);
-
-
-        if (strcmp(strMfg, "Arris") == 0)
+        if (vendor == kVodVendor_Arris)
         {
             LOG(DLOGL_NORMAL, "VOD Stream type for the given URL is ARRIS ");
             src = new Arris_StreamControl(ptrOnDemand, NULL, ePreparingToViewType);
         }
-        else if (strcmp(strMfg, "Seachange") == 0)
+        else if (vendor == kVodVendor_SeaChange)
         {
             LOG(DLOGL_NORMAL, "VOD Stream type for the given URL is SEA-CHANGE");
             src = new SeaChange_StreamControl(ptrOnDemand, NULL, ePreparingToViewType);
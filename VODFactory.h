@@ -15,14 +15,40 @@
 
 #include "VOD_SessionControl.h"
 #include "VOD_StreamControl.h"
+#include "vodVendorProbe.h"
 
 
+/**
+ * The DSM-CC vendor of a session is the srmManufacturer of the URL, no session
+ * is set up when it is missing or unknown.  The streamer is the
+ * streamerManufacturer of the URL, else the vendor of the session control.
+ * The SRM gets one ClientStatusRequest in the background at boot and as
+ * sessions are set up, which only tells whether it answers (see
+ * VodVendorProbe): a session to an SRM known not to answer fails at once.
+ */
 class VODFactory
 {
 public:
     static VOD_SessionControl* getVODSessionControlInstance(OnDemand* ptrOnDemand, const char *aSrcUrl);
     static VOD_StreamControl*  getVODStreamControlInstance(OnDemand* ptrOnDemand, const char *aSrcUrl);
 
+    /// Probes the SRM in the background, called once at start up
+    static void prefetchBackEnds(void);
+    /// Forgets the back-end selected for the head-end of aSrcUrl, as after a failed session setup
+    static void invalidateBackEnd(const char *aSrcUrl);
+    /// True when the head-end of aSrcUrl did not answer its last probe, the session setup would time out
+    static bool isBackEndDown(const char *aSrcUrl);
+    /// "ip:port" of the SRM
+    static std::string srmEndpoint(void);
+
+private:
+    static VodVendorProbe* getProbe(void);
+    static void registerProbes(void);
+    static eVodVendor parseVendor(const std::string &srcUrl, const char *key);
+    static std::string headEndOf(const std::string &srcUrl);
+
+    static bool dsmccStatusProbe(const std::string &endpoint, uint32_t timeoutMs);
+    static bool rtspOptionsProbe(const std::string &endpoint, uint32_t timeoutMs);
 };
 
 #endif // #ifndef VOD_SOURCE_FACTORY_H
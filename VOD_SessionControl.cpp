@@ -17,6 +17,7 @@
 #include <stdlib.h>
 #include "dlog.h"
 #include "VOD_SessionControl.h"
+#include "dsmccTransport.h"
 #include "vod.h"
 
 
@@ -26,6 +27,7 @@
 
 #define LOG(level, msg, args...)  dlog(DL_MSP_ONDEMAND, level,"VOD_SessCntl(TID:%lx):%s:%d " msg, pthread_self(), __FUNCTION__, __LINE__, ##args);
 #define UNUSED_PARAM(a) (void)a;
+#define kDsmccMaxMessageSize  1500
 
 int              VOD_SessionControl::mPrevVodSessionId;
 ActiveVodSessionMap  VOD_SessionControl::mActiveVodSessionMap;
@@ -72,10 +74,7 @@ VOD_SessionControl::VOD_SessionControl(OnDemand *pOnDemand, eOnDemandReqType req
     OnDemandSystemClient::getInstance()->GetSrmPort(&srmPort);
     LOG(DLOGL_NORMAL, "srmPort:%d ", srmPort);
 
-    if (mSocketFd == -1)
-    {
-        mSocketFd = VodDsmcc_Base::GetSocket(srmPort);
-    }
+    mSocketFd = DsmccTransport::getInstance()->getSocket(srmPort);
 
 
     //get srm ip address
@@ -95,6 +94,7 @@ VOD_SessionControl::VOD_SessionControl(OnDemand *pOnDemand, eOnDemandReqType req
     caEID[EID_SIZE - 1] = '\0';
     mTransId[TRANSID_SIZE - 1] = '\0';
     mEncrypted = false;
+    mVendor = kVodVendor_None;
 }
 
 VOD_SessionControl::~VOD_SessionControl()
@@ -105,7 +105,7 @@ VOD_SessionControl::~VOD_SessionControl()
 
 
     mActiveVodSessionMap.erase(mVodSessionId);
-
+    DsmccTransport::getInstance()->cancelSession(mVodSessionId);
 
     LOG(DLOGL_REALLY_NOISY, "sendMsgInfoList.size(): %d", sendMsgInfoList.size());
 
@@ -133,6 +133,23 @@ VOD_SessionControl::~VOD_SessionControl()
     LOG(DLOGL_REALLY_NOISY, "exit");
 }
 
+void VOD_SessionControl::setOnDemand(OnDemand *pOnDemand)
+{
+    pthread_mutex_lock(&mVodSessionListMutex);
+
+    LOG(DLOGL_NORMAL, "mVodSessionId:%d pOnDemand:%p -> %p", mVodSessionId, ptrOnDemand, pOnDemand);
+    ptrOnDemand = pOnDemand;
+    mActiveVodSessionMap[mVodSessionId] = pOnDemand;
+
+    list<SendMsgInfo *>::iterator itr;
+    for (itr = sendMsgInfoList.begin(); itr != sendMsgInfoList.end(); ++itr)
+    {
+        (*itr)->ptrOnDemand = pOnDemand;
+    }
+
+    pthread_mutex_unlock(&mVodSessionListMutex);
+}
+
 int32_t VOD_SessionControl::GetFD()
 {
     FNLOG(DL_MSP_ONDEMAND);
@@ -142,7 +159,7 @@ int32_t VOD_SessionControl::GetFD()
         OnDemandSystemClient::getInstance()->GetSrmPort(&port);
         LOG(DLOGL_NORMAL, "port: %d", port);
 
-        mSocketFd = VodDsmcc_Base::GetSocket(port);
+        mSocketFd = DsmccTransport::getInstance()->getSocket(port);
         LOG(DLOGL_NORMAL, "mSocketFd: %d", mSocketFd);
 
     }
@@ -202,67 +219,73 @@ void VOD_SessionControl::ReadSessionSocketCallback(int32_t fd, int16_t event, vo
     UNUSED_PARAM(event)
     UNUSED_PARAM(arg)
 
-    uint8_t *msgData = NULL;
-    uint32_t msgLen = 0;
-    VodDsmcc_Base *dsmccObj = NULL;
+    uint8_t msgData[kDsmccMaxMessageSize];
+    int32_t msgLen = 0;
 
     LOG(DLOGL_NOISE, " session response received on fd:%d ", fd);
 
-    int sockFd = GetFD();
-    if (sockFd != -1)
+    if (GetFD() == -1)
     {
-        bool readStatus = VodDsmcc_Base::ReadMessageFromSocket(sockFd, &msgData,
-                          &msgLen);
-        if (readStatus)
+        LOG(DLOGL_ERROR, "Invalid sockFd ");
+        return;
+    }
+
+    // responses to several sessions may be waiting, handle them all in this wake-up
+    DsmccTransport *transport = DsmccTransport::getInstance();
+    while ((msgLen = transport->receive(msgData, sizeof(msgData))) > 0)
+    {
+        LOG(DLOGL_NORMAL, "%s:%d  msgLen:%d ", __FUNCTION__, __LINE__, msgLen);
+        //get dsmcc response message type, session confirms are parsed by the codec
+        tDsmccHeader header;
+        VodDsmcc_Base *dsmccObj;
+        if (VodDsmcc_Codec::parseHeader(msgData, msgLen, &header) && (header.messageId == dsmcc_ClientSessionSetUpConfirm))
+        {
+            dsmccObj = new VodDsmcc_CodecSessionConfirm();
+        }
+        else
         {
-            LOG(DLOGL_NORMAL, "%s:%d  msgLen:%d ", __FUNCTION__, __LINE__, msgLen);
-            //get dsmcc response message type
             dsmccObj = VodDsmcc_Base::GetMessageTypeObject(msgData, msgLen);
+        }
+        if (dsmccObj == NULL)
+        {
+            continue;
+        }
 
-            if (dsmccObj)
-            {
-                //parse dsmcc response
-                status parseStatus = dsmccObj->ParseDsmccMessageBody(msgData, msgLen);
-                if (parseStatus == E_TRUE)
-                {
-
-                    LOG(DLOGL_REALLY_NOISY, "DSMCC- message id:%x : transId %x ", dsmccObj->GetMessageId(), dsmccObj->GetTransactionId());
+        //parse dsmcc response
+        status parseStatus = dsmccObj->ParseDsmccMessageBody(msgData, msgLen);
+        if (parseStatus != E_TRUE)
+        {
+            LOG(DLOGL_ERROR, " ParseDsmccMessageBody failed");
+            delete dsmccObj;
+            continue;
+        }
 
-                    bool found = false;
-                    unsigned int sessId = VOD_SessionControl::getSessionNumber(dsmccObj);
-                    ActiveVodSessionMap::iterator itr;
+        LOG(DLOGL_REALLY_NOISY, "DSMCC- message id:%x : transId %x ", dsmccObj->GetMessageId(), dsmccObj->GetTransactionId());
 
-                    for (itr = mActiveVodSessionMap.begin(); itr != mActiveVodSessionMap.end(); ++itr)
-                    {
-                        LOG(DLOGL_NOISE, " itr->first %d ", itr->first);
-                        if (itr->first == sessId)
-                        {
-                            found = true;
-                            break;
-                        }
-                    }
+        // a response goes to the session that sent the request, indications carry the session id
+        int transSessId = 0;
+        unsigned int sessId;
+        if (transport->findSession(dsmccObj->GetTransactionId(), &transSessId))
+        {
+            sessId = transSessId;
+        }
+        else
+        {
+            sessId = VOD_SessionControl::getSessionNumber(dsmccObj);
+        }
 
-                    LOG(DLOGL_NOISE, "sessId: %d  found: %d", sessId, found);
-                    if (found)
-                    {
-                        itr->second->handleReadSessionData(dsmccObj);
-                    }
-                }
-                else
-                {
-                    LOG(DLOGL_ERROR, " ParseDsmccMessageBody failed");
-                }
-            }
+        ActiveVodSessionMap::iterator itr = mActiveVodSessionMap.find(sessId);
+        LOG(DLOGL_NOISE, "sessId: %d  found: %d", sessId, itr != mActiveVodSessionMap.end());
+        if (itr != mActiveVodSessionMap.end())
+        {
+            // the session handler owns the message from here
+            itr->second->handleReadSessionData(dsmccObj);
         }
         else
         {
-            LOG(DLOGL_ERROR, "warning ReadMessageFromSocket failed");
+            delete dsmccObj;
         }
     }
-    else
-    {
-        LOG(DLOGL_ERROR, "Invalid sockFd ");
-    }
 }
 
 
@@ -293,13 +316,15 @@ eIOnDemandStatus VOD_SessionControl::AddMessageToSendList(SendMsgInfo *msgInfo)
     //if retry count is more then one then add message to send list
     if ((evtLoop != NULL) && (msgInfo->msgRetryCount > 0))
     {
+        uint32_t timeoutMs = DsmccTransport::getInstance()->begin(msgInfo->transId, msgInfo->msgType, mVodSessionId,
+                             msgInfo->msgRetryCount, tMsg * 1000);
         EventTimer* evtTimer = evtLoop->addTimer(EVENTTIMER_TIMEOUT,
-                               tMsg,
-                               0,
+                               timeoutMs / 1000,
+                               (timeoutMs % 1000) * 1000,
                                VOD_SessionControl::ProcessTimeoutCallBack, (void *)msgInfo);
 
 
-        LOG(DLOGL_REALLY_NOISY, "evtLoop->addTimer: evtTimer: %p  transId: %d time: %d secs", evtTimer, msgInfo->transId,  tMsg);
+        LOG(DLOGL_REALLY_NOISY, "evtLoop->addTimer: evtTimer: %p  transId: %d time: %d ms", evtTimer, msgInfo->transId,  timeoutMs);
 
         // add to queue
         msgInfo->evtTimer = evtTimer;
@@ -327,6 +352,8 @@ void VOD_SessionControl::RemoveMessageFromSendList(SendMsgInfo *msgInfo)
     pthread_mutex_lock(&mVodSessionListMutex);
     LOG(DLOGL_REALLY_NOISY, "RemoveMessageFromSendList sendMsgInfoList.size(): %d", sendMsgInfoList.size());
 
+    DsmccTransport::getInstance()->complete(msgInfo->transId);
+
     if (!sendMsgInfoList.empty())
     {
         list<SendMsgInfo *>::iterator itr;
@@ -400,16 +427,20 @@ void VOD_SessionControl::ProcessTimeoutCallBack(int32_t fd, short event, void *a
                     {
                         LOG(DLOGL_REALLY_NOISY, "SendPendingMessage: evtTimer: %p  transId: %d", pEvt, msgInfo->transId);
 
-                        if (((*itr)->msgRetryCount <= 1))
+                        uint32_t timeoutMs = 0;
+                        eDsmccExpireResult expired = DsmccTransport::getInstance()->expire(msgInfo->transId, &timeoutMs);
+                        if (expired != kDsmccExpire_Retransmit)
                         {
-                            objPtr->sendMsgInfoList.remove(*itr);
-                            delete *itr;
-                            *itr = NULL;
+                            // msgInfo is the entry being deleted
+                            OnDemand *ptrOnDemand = msgInfo->ptrOnDemand;
+                            objPtr->sendMsgInfoList.erase(itr);
+                            delete msgInfo;
+                            msgInfo = NULL;
 
-                            if (msgInfo->ptrOnDemand)
+                            if (ptrOnDemand)
                             {
                                 LOG(DLOGL_ERROR, " NOT RECEIVED SERVER RESPONSE  - sending error to service layer !!");
-                                msgInfo->ptrOnDemand->queueEvent(kOnDemandSessionErrorEvent);
+                                ptrOnDemand->queueEvent(kOnDemandSessionErrorEvent);
                             }
                         }
                         else
@@ -422,11 +453,9 @@ void VOD_SessionControl::ProcessTimeoutCallBack(int32_t fd, short event, void *a
 
                             if (evtLoop != NULL)
                             {
-                                uint32_t tMsg = 0;
-                                OnDemandSystemClient::getInstance()->GetmessageTimer(&tMsg);
                                 EventTimer* evtTimer = evtLoop->addTimer(EVENTTIMER_TIMEOUT,
-                                                       tMsg,
-                                                       0,
+                                                       timeoutMs / 1000,
+                                                       (timeoutMs % 1000) * 1000,
                                                        VOD_SessionControl::ProcessTimeoutCallBack, (void *)(*itr));
                                 (*itr)->evtTimer = evtTimer;
                             }
@@ -27,6 +27,8 @@
 #include "vod.h"
 #include "vodUtils.h"
 #include "dsmccProtocol.h"
+#include "dsmccCodec.h"
+#include "vodVendorProbe.h"
 
 using namespace std;
 
@@ -76,6 +78,12 @@ public:
     */
     virtual ~VOD_SessionControl();
 
+    /**
+    * \param pOnDemand the OnDemand taking over the session.
+    * \brief Routes the responses and timeouts of the session to pOnDemand, as a prewarmed session is adopted.
+    */
+    void setOnDemand(OnDemand *pOnDemand);
+
     /**
     * \param UseUrl URL to set-up VOD session.
     * \return status of the SessionSetup operation.
@@ -275,6 +283,20 @@ public:
         return mEncrypted;
     } ;
 
+    /**
+    * \param vendor back-end the factory selected for the session.
+    * \brief The setup latency of the session is reported for vendor.
+    */
+    void SetVendor(eVodVendor vendor)
+    {
+        mVendor = vendor;
+    } ;
+
+    eVodVendor GetVendor()
+    {
+        return mVendor;
+    } ;
+
     /**
     * \param pointer to VodDsmcc_ClientSessionConfirm message type
     * \brief handle function for dsmcc_ClientSessionSetUpConfirm message type
@@ -355,6 +377,7 @@ protected:
     uint8_t caEID[EID_SIZE]; //Entitlement ID
     uint8_t mTransId[TRANSID_SIZE]; // transID used as session ID for cable card VOD call
     bool mEncrypted;  // VOD asset encryption flag
+    eVodVendor mVendor;  // back-end selected by VODFactory
     uint32_t emmCount;  // current EMM count from CAK
     uint32_t mCakresp; // response from Cak (STAT field in diag page)
 
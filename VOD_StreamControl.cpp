@@ -53,6 +53,7 @@ VOD_StreamControl::VOD_StreamControl(OnDemand* pOnDemand, eOnDemandReqType reqTy
 VOD_StreamControl::~VOD_StreamControl()
 {
     dlog(DL_MSP_ONDEMAND, DLOGL_FUNCTION_CALLS, "%s:%i  ~VOD_StreamControl.\n", __FUNCTION__, __LINE__);
+    nptModel.logStats();
 
 }
 
@@ -97,6 +98,11 @@ uint8_t VOD_StreamControl::GetServerMode()
 
 }
 
+void VOD_StreamControl::setOnDemand(OnDemand *pOnDemand)
+{
+    ptrOnDemand = pOnDemand;
+}
+
 void VOD_StreamControl::CloseControlSocket()
 {
     dlog(DL_MSP_ONDEMAND, DLOGL_FUNCTION_CALLS, "%s:%i  CloseControlSocket() Unsupported.\n", __FUNCTION__, __LINE__);
@@ -25,6 +25,7 @@
 #include "ondemand.h"
 
 #include "vod.h"
+#include "nptModel.h"
 
 using namespace std;
 
@@ -58,6 +59,11 @@ protected:
     //For approximating the NPT
     bool streamStarted;
 
+    /*
+     * Answers position and speed polls between server answers
+     */
+    NptModel nptModel;
+
     bool Pause_Mode;
 
 
@@ -129,6 +135,9 @@ public:
 
     void CloseControlSocket();
 
+    /// Hands the stream control over to another OnDemand, as a prewarmed session is adopted
+    void setOnDemand(OnDemand *pOnDemand);
+
     eIOnDemandStatus ResetControlConnection();
     eIOnDemandStatus ConnectConfirmation();
 
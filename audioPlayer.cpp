@@ -10,11 +10,11 @@ Implementation of AudioPlayer - an instance of an IMediaController object
 #include <pthread.h>
 
 #include "dlog.h"
-#include "pthread_named.h"
 
 #include "cpe_error.h"
 #include "cpe_mediamgr.h"
 #include "eventQueue.h"
+#include "MSPWorkerPool.h"
 #include "audioPlayer.h"
 
 
@@ -64,7 +64,7 @@ bool AudioPlayer::mEasAudioActive = false;
  *
  *	Function:	AudioPlayer
  *
- *	Purpose:	Initialize all members, then create an EventQueue and thread
+ *	Purpose:	Initialize all members, then create an EventQueue and strand
  *				for processing audio player events.
  *
  */
@@ -78,7 +78,7 @@ AudioPlayer::AudioPlayer(IMediaPlayerSession *pIMediaPlayerSession) :
     sourceHandle(0),
     audioFp(NULL),
     soundDataSize(0),
-    timerId(0),
+    timerId(kMSPEventTimerIdInvalid),
     mediaPlayerInstance(NULL),
     mIMediaPlayerSession(pIMediaPlayerSession)
 {
@@ -93,15 +93,12 @@ AudioPlayer::AudioPlayer(IMediaPlayerSession *pIMediaPlayerSession) :
     mediaPlayerInstance = IMediaPlayer::getMediaPlayerInstance();
     assert(mediaPlayerInstance);
 
-    // acquire timer resources
-    Timer_init();
-
     // initialize queue and mutex
     apQueue = new MSPEventQueue();
     pthread_mutex_init(&apMutex, NULL);
 
-    // initialize thread machinery
-    createThread();
+    // initialize event strand machinery
+    createStrand();
 }
 
 
@@ -125,12 +122,16 @@ AudioPlayer::~AudioPlayer(void)
     }
     callbackList.clear();
 
+    // if active, cancel timer (it lives in apQueue)
+    cancelTimer();
+
+    // detach from apQueue if Eject() was never called
+    delete apStrand;
+    apStrand = NULL;
+
     delete apQueue;
     pthread_mutex_destroy(&apMutex);
 
-    // if active, cancel timer
-    cancelTimer();
-
     LOG_NORMAL("%s(), exit", __FUNCTION__);
 }
 
@@ -276,7 +277,7 @@ AudioPlayer::completeStopSequence(void)
  *
  *	Function:	Eject
  *
- *	Purpose:	Terminate the audio player thread.
+ *	Purpose:	Terminate the audio player event strand.
  *
  */
 
@@ -285,14 +286,15 @@ AudioPlayer::Eject(void)
 {
     LOG_NORMAL("enter %s()", __FUNCTION__);
 
-    if (apThread)
+    if (apStrand)
     {
         LOG_NORMAL("%s(), queueing exit event", __FUNCTION__);
-        queueEvent(kExitThreadEvent);  			// tell thread to exit
+        queueEvent(kExitThreadEvent);  			// tell strand to exit
         unLockMutex();
-        pthread_join(apThread, NULL);       	// wait for event thread to exit
+        apStrand->join();       				// wait for exit event to be handled
+        delete apStrand;
         lockMutex();
-        apThread = 0;
+        apStrand = NULL;
     }
     else
     {
@@ -1034,9 +1036,9 @@ AudioPlayer::processAudioEvent(void* eventData)
  *
  *	Parameters:	event - an audio player event
  *
- *	Returns:	Boolean.  If false, tells caller( threadFunction() ) to continue
+ *	Returns:	Boolean.  If false, tells caller( eventHandler() ) to continue
  *				processing events.  If true, tells caller to stop processing
- *				events and terminate the thread.
+ *				events and finish the strand.
  *
  */
 
@@ -1078,81 +1080,58 @@ AudioPlayer::processEvent(Event* event)
 
 /********************************************************************************
  *
- *	Function:	createThread
+ *	Function:	createStrand
  *
- *	Purpose:	Create the audio player thread.  Steps:
- *				- set stack size
- *				- spawn the thread
- *				- set thread name
- *
- *				The newly created thread will begin execution
- *				at threadFunction().
+ *	Purpose:	Create the audio player event strand.  Events are handled
+ *				one at a time on the shared MSP worker pool, starting
+ *				at eventHandler().
  */
 
 void
-AudioPlayer::createThread(void)
+AudioPlayer::createStrand(void)
 {
-    int error;
-    pthread_attr_t attr;
-    const char* threadName = "MSP AudioPlayer";
-
-    // set attributes to default and set stack size
-    pthread_attr_init(&attr);
-    pthread_attr_setstacksize(&attr, kStackSize);
-
-    // create thread and error check
-    error = pthread_create(&apThread, &attr, threadFunction, this);
-    if (error)
-    {
-        LOG_ERROR("pthread create error: %d", error);
-    }
-
-    // set thread name and error check
-    error = pthread_setname_np(apThread, threadName);
-    if (error)
-    {
-        LOG_ERROR("pthread set name error: %d", error);
-    }
+    apStrand = new MSPStrand("MSP AudioPlayer", apQueue, eventHandler, NULL, this);
+    apStrand->start();
 }
 
 
 /********************************************************************************
  *
- *	Function:	threadFunction
+ *	Function:	eventHandler
  *
- *	Purpose:	Root function of the audio player thread.  In an infinite loop,
- *				perform a blocking read on the apQueue.  Each time an event
- *				is placed on this queue, process it, delete associated event
- *				data, and repeat.
+ *	Purpose:	Called by the audio player strand for each event placed on
+ *				the apQueue.  Process it, delete associated event data and
+ *				return it to the queue.
  *
- *	Parameters:	data - not used
+ *	Parameters:	data - the AudioPlayer instance
+ *				event - the event to process
+ *
+ *	Returns:	Boolean.  True once the exit event has been processed.
  *
  */
 
-void*
-AudioPlayer::threadFunction(void* data)
+bool
+AudioPlayer::eventHandler(void* data, Event* event)
 {
     AudioPlayer* instance = (AudioPlayer*) data;
     MSPEventQueue* eventQueue = instance->apQueue;
     assert(eventQueue);
 
-    bool finished = false;;
-    while (!finished)
+    instance->lockMutex();
+    bool finished = instance->processEvent(event);
+    if (event->eventData != NULL)
     {
-        Event* event = eventQueue->popEventQueue();
-        instance->lockMutex();
-        finished = instance->processEvent(event);
-        if (event->eventData != NULL)
-        {
-            AudioPlayerEventData* data = (AudioPlayerEventData*) event->eventData;
-            delete data;
-        }
-        eventQueue->freeEvent(event);
-        instance->unLockMutex();
+        AudioPlayerEventData* eventData = (AudioPlayerEventData*) event->eventData;
+        delete eventData;
     }
-    LOG_NORMAL("%s(), exiting audio player thread.", __FUNCTION__);
-    pthread_exit(NULL);
-    return NULL;
+    eventQueue->freeEvent(event);
+    instance->unLockMutex();
+
+    if (finished)
+    {
+        LOG_NORMAL("%s(), exiting audio player strand.", __FUNCTION__);
+    }
+    return finished;
 }
 
 
@@ -1161,7 +1140,7 @@ AudioPlayer::threadFunction(void* data)
  *	Function:	queueEvent
  *
  *	Purpose:	Place an event on the audio player's internal queue.  Refer to
- *				threadFunction() to see where the event is processed.
+ *				eventHandler() to see where the event is processed.
  *
  *				This routine is for events which do not carry a payload.
  *
@@ -1182,12 +1161,12 @@ AudioPlayer::queueEvent(eAudioPlayerEvent type)
  *	Function:	queueEventPlusPayload
  *
  *	Purpose:	Place an event on the audio player's internal queue.  Refer to
- *				threadFunction() to see where the event is processed.
+ *				eventHandler() to see where the event is processed.
  *
  *				This routine is for events which carry a payload.  Notice that
  *				it it necessary to instantiate an AudioPlayerEventData structure
  *				to transport the payload.  Also notice that the
- *				instantiated structure is deleted in threadFunction() AFTER the
+ *				instantiated structure is deleted in eventHandler() AFTER the
  *				event has been processed
  *
  *	Parameters:	type - type of event
@@ -1269,38 +1248,13 @@ AudioPlayer::audioCallback(tCpeSrcCallbackTypes type, void* userdata,
 }
 
 
-/********************************************************************************
- *
- *	Function:	timerCallback
- *
- *	Purpose:	The timer logic will call this routine when the audio player
- *				timer expires.  Simply queue a timer event.
- *
- *	Parameters:	data - pointer to an EventTimer structure.
- *				fd and what are not used
- *
- */
-
-void
-AudioPlayer::timerCallback(evutil_socket_t fd, short what, void* data)
-{
-    (void) fd;
-    (void) what;
-
-    EventTimer* timer = reinterpret_cast <EventTimer*>(data);
-    AudioPlayer* instance = reinterpret_cast <AudioPlayer*>(timer->getUserData()) ;
-
-    LOG_NORMAL("%s, instance: %p", __FUNCTION__, instance);
-
-    instance->queueEvent(kTimerEvent);
-}
-
-
 /********************************************************************************
  *
  *	Function:	startTimer
  *
  *	Purpose:	Start the audio timer using the indicated timer period.
+ *				The timer is scheduled on apQueue, which posts a kTimerEvent
+ *				to the audio player thread when it expires.
  *
  *	Parameters:	seconds - timer will expire in this many seconds
  *
@@ -1309,12 +1263,11 @@ AudioPlayer::timerCallback(evutil_socket_t fd, short what, void* data)
 void
 AudioPlayer::startTimer(int seconds)
 {
-    eTimer_StatusCode result;
-
-    result = Timer_addTimerDuration(seconds, timerCallback,
-                                    this, &timerId);
-    LOG_NORMAL("%s, currentState: %d   result: %d    this: %p",
-               __FUNCTION__, currentState, result, this);
+    assert(apQueue);
+    cancelTimer();
+    timerId = apQueue->scheduleEvent(kTimerEvent, NULL, seconds * 1000);
+    LOG_NORMAL("%s, currentState: %d   timerId: %u    this: %p",
+               __FUNCTION__, currentState, timerId, this);
 }
 
 
@@ -1331,10 +1284,13 @@ void
 AudioPlayer::cancelTimer(void)
 {
     // if a timer is active, cancel it
-    if (timerId)
+    if (timerId != kMSPEventTimerIdInvalid)
     {
-        Timer_deleteTimer(timerId);
-        timerId = 0;
+        if (apQueue)
+        {
+            apQueue->cancelScheduledEvent(timerId);
+        }
+        timerId = kMSPEventTimerIdInvalid;
     }
 }
 
@@ -30,10 +30,9 @@
 
 #include "cpe_source.h"
 #include "cpe_programhandle.h"
-#include "itimer.h"
+#include "eventQueue.h"
 
-class MSPEventQueue;
-class Event;
+class MSPStrand;
 
 
 class AudioPlayer : public IMediaController
@@ -118,7 +117,6 @@ private:
     enum
     {
         kMaxUrlSize = 128,
-        kStackSize = (64 * 1024),
         kAudioHeaderSize = 154
     };
 
@@ -132,20 +130,19 @@ private:
     tCpeSrcMemBuffer sourceBuffer;
     FILE* audioFp;
     uint32_t soundDataSize;
-    intptr_t timerId;
+    tMSPEventTimerId timerId;
     tCpeAudioInfo aiffAudioInfo;
     IMediaPlayer* mediaPlayerInstance;
     std::string srcUrl;
 
     MSPEventQueue* apQueue;
-    pthread_t apThread;
+    MSPStrand* apStrand;
     pthread_mutex_t apMutex;
     std::list<CallbackInfo*> callbackList;
     IMediaPlayerSession *mIMediaPlayerSession;
     static bool mEasAudioActive;
 
-    static void* threadFunction(void* data);
-    static void timerCallback(evutil_socket_t fd, short what, void* data);
+    static bool eventHandler(void* data, Event* event);
     static int audioCallback(tCpeSrcCallbackTypes type,
                              void *userdata,
                              void *pCallbackSpecific);
@@ -153,7 +150,7 @@ private:
     eIMediaPlayerStatus doCallback(eIMediaPlayerSignal sig, eIMediaPlayerStatus stat);
     void queueEvent(eAudioPlayerEvent type);
     void queueEventPlusPayload(eAudioPlayerEvent type, uint32_t data);
-    void createThread(void);
+    void createStrand(void);
     bool processEvent(Event* event);
 
     void enterPrepareSourceState(void);
@@ -0,0 +1,638 @@
+/**
+   \file cloudDvrRtspTransport.cpp
+   \class CloudDvrRtspTransport
+
+Implementation file for the RTSP transport shared by the Cloud DVR stream controls
+*/
+
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "dlog.h"
+#include "pthread_named.h"
+
+#include "cloudDvrRtspTransport.h"
+#include "monotonicTime.h"
+
+#define LOG(level, msg, args...)  dlog(DL_MSP_ONDEMAND, level,"CloudDvrRtspTransport:%s:%d " msg, __FUNCTION__, __LINE__, ##args);
+
+#define kRtspDefaultPort    "554"
+
+CloudDvrRtspTransport* CloudDvrRtspTransport::mInstance = NULL;
+pthread_mutex_t CloudDvrRtspTransport::mInstanceMutex = PTHREAD_MUTEX_INITIALIZER;
+
+CloudDvrRtspTransport* CloudDvrRtspTransport::getInstance(void)
+{
+    pthread_mutex_lock(&mInstanceMutex);
+    if (mInstance == NULL)
+    {
+        mInstance = new CloudDvrRtspTransport();
+    }
+    pthread_mutex_unlock(&mInstanceMutex);
+    return mInstance;
+}
+
+CloudDvrRtspTransport::CloudDvrRtspTransport()
+{
+    pthread_mutex_init(&mMutex, NULL);
+    pthread_cond_init(&mDoneCond, NULL);
+    mScheduler = NULL;
+    mEnv = NULL;
+    mTrigger = 0;
+    mThreadStarted = false;
+    mShutDownFlag = 0;
+    mNextToken = 0;
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+CloudDvrRtspTransport::~CloudDvrRtspTransport()
+{
+    pthread_cond_destroy(&mDoneCond);
+    pthread_mutex_destroy(&mMutex);
+}
+
+// Implementation of "RTSPClientInterface":
+RTSPClientInterface* RTSPClientInterface::createNew(UsageEnvironment& env, char const* rtspURL,
+        int verbosityLevel, char const* applicationName, portNumBits tunnelOverHTTPPortNum)
+{
+    return new RTSPClientInterface(env, rtspURL, verbosityLevel, applicationName, tunnelOverHTTPPortNum);
+}
+
+RTSPClientInterface::RTSPClientInterface(UsageEnvironment& env, char const* rtspURL,
+        int verbosityLevel, char const* applicationName, portNumBits tunnelOverHTTPPortNum)
+    : RTSPClient(env, rtspURL, verbosityLevel, applicationName, tunnelOverHTTPPortNum, -1)
+{
+    pStreamControl = NULL;
+    mToken = 0;
+}
+
+RTSPClientInterface::~RTSPClientInterface()
+{
+    LOG(DLOGL_FUNCTION_CALLS, "");
+    pStreamControl = NULL;
+}
+
+void RTSPClientInterface::sent(void)
+{
+    mInFlight.push_back(mToken);
+}
+
+CloudDvr_StreamControl* RTSPClientInterface::answered(void)
+{
+    if (mInFlight.empty())
+    {
+        return NULL;
+    }
+
+    // the requests of one session all carry the same token, their order does not matter
+    uint32_t token = mInFlight.front();
+    mInFlight.pop_front();
+    if ((token == 0) || (token != mToken))
+    {
+        CloudDvrRtspTransport *transport = CloudDvrRtspTransport::getInstance();
+
+        LOG(DLOGL_MINOR_DEBUG, "response of an earlier session dropped");
+        pthread_mutex_lock(&transport->mMutex);
+        transport->mStats.dropped++;
+        pthread_mutex_unlock(&transport->mMutex);
+        return NULL;
+    }
+    return pStreamControl;
+}
+
+std::string CloudDvrRtspTransport::headEnd(const std::string &url)
+{
+    std::string::size_type start = url.find("://");
+    start = (start == std::string::npos) ? 0 : start + 3;
+
+    std::string::size_type end = url.find('/', start);
+    std::string host = url.substr(start, (end == std::string::npos) ? std::string::npos : end - start);
+
+    std::string::size_type at = host.rfind('@');
+    if (at != std::string::npos)
+    {
+        host.erase(0, at + 1);
+    }
+    if (host.find(':') == std::string::npos)
+    {
+        host += ":" kRtspDefaultPort;
+    }
+    return host;
+}
+
+UsageEnvironment* CloudDvrRtspTransport::getEnv(void)
+{
+    pthread_mutex_lock(&mMutex);
+    if (mEnv == NULL)
+    {
+        mScheduler = BasicTaskScheduler::createNew();
+        if (mScheduler == NULL)
+        {
+            LOG(DLOGL_ERROR, "Failed to create the TaskScheduler for Cloud DVR stream control");
+        }
+        else
+        {
+            mEnv = BasicUsageEnvironment::createNew(*mScheduler);
+            if (mEnv == NULL)
+            {
+                LOG(DLOGL_ERROR, "Failed to create the UsageEnvironment for Cloud DVR stream control");
+            }
+            else
+            {
+                mTrigger = mScheduler->createEventTrigger(TasksTriggered);
+                if (mTrigger == 0)
+                {
+                    LOG(DLOGL_ERROR, "Failed to create the event trigger of the RTSP Task Scheduler");
+                }
+
+                pthread_attr_t attr;
+
+                pthread_attr_init(&attr);
+                pthread_attr_setstacksize(&attr, kRtspSchedulerStackSize);
+                pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+                int ret = pthread_create(&mThread, &attr, SchedulerThread, (void *) this);
+                if (ret != 0)
+                {
+                    LOG(DLOGL_ERROR, ":%m: Error creating the RTSP Task Scheduler Thread :%d", ret);
+                }
+                else
+                {
+                    mThreadStarted = true;
+                    if (pthread_setname_np(mThread, "RTSP Task Scheduler Thread") != 0)
+                    {
+                        LOG(DLOGL_ERROR, "ERROR: %m: Thread Setname Failed.");
+                    }
+                }
+                pthread_attr_destroy(&attr);
+            }
+        }
+    }
+    UsageEnvironment *env = mEnv;
+    pthread_mutex_unlock(&mMutex);
+    return env;
+}
+
+void *CloudDvrRtspTransport::SchedulerThread(void *arg)
+{
+    CloudDvrRtspTransport *transport = (CloudDvrRtspTransport *) arg;
+
+    // All the RTSP activity of every session takes place within this event loop
+    transport->mEnv->taskScheduler().doEventLoop(&transport->mShutDownFlag);
+    LOG(DLOGL_NORMAL, "Exiting the RTSP Task Scheduler Thread");
+    return NULL;
+}
+
+bool CloudDvrRtspTransport::onSchedulerThread(void)
+{
+    pthread_mutex_lock(&mMutex);
+    bool onThread = mThreadStarted && pthread_equal(pthread_self(), mThread);
+    pthread_mutex_unlock(&mMutex);
+    return onThread;
+}
+
+// from the scheduler thread, once triggered
+void CloudDvrRtspTransport::TasksTriggered(void *arg)
+{
+    CloudDvrRtspTransport *transport = (CloudDvrRtspTransport *) arg;
+    std::list<Task> tasks;
+
+    pthread_mutex_lock(&transport->mMutex);
+    tasks.swap(transport->mTasks);
+    pthread_mutex_unlock(&transport->mMutex);
+
+    for (std::list<Task>::iterator itr = tasks.begin(); itr != tasks.end(); ++itr)
+    {
+        itr->fn(itr->arg);
+        if (itr->done)
+        {
+            pthread_mutex_lock(&transport->mMutex);
+            *itr->done = true;
+            pthread_cond_broadcast(&transport->mDoneCond);
+            pthread_mutex_unlock(&transport->mMutex);
+        }
+    }
+}
+
+bool CloudDvrRtspTransport::queue(tRtspTask *fn, void *arg, bool *done)
+{
+    if (getEnv() == NULL)
+    {
+        return false;
+    }
+
+    pthread_mutex_lock(&mMutex);
+    if (!mThreadStarted || (mTrigger == 0))
+    {
+        pthread_mutex_unlock(&mMutex);
+        return false;
+    }
+    Task task;
+    task.fn = fn;
+    task.arg = arg;
+    task.done = done;
+    mTasks.push_back(task);
+    pthread_mutex_unlock(&mMutex);
+
+    // the one scheduler call that is safe from another thread
+    mScheduler->triggerEvent(mTrigger, this);
+    return true;
+}
+
+bool CloudDvrRtspTransport::post(tRtspTask *fn, void *arg)
+{
+    if (onSchedulerThread())
+    {
+        fn(arg);
+        return true;
+    }
+    return queue(fn, arg, NULL);
+}
+
+bool CloudDvrRtspTransport::call(tRtspTask *fn, void *arg)
+{
+    if (onSchedulerThread())
+    {
+        fn(arg);
+        return true;
+    }
+
+    bool done = false;
+    if (!queue(fn, arg, &done))
+    {
+        return false;
+    }
+
+    pthread_mutex_lock(&mMutex);
+    while (!done)
+    {
+        pthread_cond_wait(&mDoneCond, &mMutex);
+    }
+    pthread_mutex_unlock(&mMutex);
+    return true;
+}
+
+// closes the connections idle for too long
+void CloudDvrRtspTransport::pruneIdle(uint64_t now)
+{
+    std::map<std::string, std::vector<IdleConnection> >::iterator itr;
+
+    for (itr = mIdle.begin(); itr != mIdle.end(); ++itr)
+    {
+        std::vector<IdleConnection> &idle = itr->second;
+        while (!idle.empty() && (now - idle.front().sinceMs >= kRtspIdleConnectionSecs * 1000))
+        {
+            LOG(DLOGL_MINOR_DEBUG, "closing idle connection to %s", itr->first.c_str());
+            mHeadEnd.erase(idle.front().client);
+            Medium::close(idle.front().client);
+            idle.erase(idle.begin());
+            mStats.closedIdle++;
+            mStats.idle--;
+        }
+    }
+}
+
+struct ReleaseArgs
+{
+    RTSPClientInterface *client;
+    bool                 keep;
+};
+
+struct AcquireArgs
+{
+    CloudDvrRtspTransport  *transport;
+    const std::string      *url;
+    const std::string      *sessionId;
+    CloudDvr_StreamControl *owner;
+    RTSPClientInterface    *client;
+};
+
+// on the scheduler thread
+void CloudDvrRtspTransport::AcquireTask(void *arg)
+{
+    AcquireArgs *args = (AcquireArgs *) arg;
+    CloudDvrRtspTransport *transport = args->transport;
+    RTSPClientInterface *client = NULL;
+    std::string key = headEnd(*args->url);
+
+    pthread_mutex_lock(&transport->mMutex);
+    transport->pruneIdle(monotonicNowMs());
+    std::vector<IdleConnection> &idle = transport->mIdle[key];
+    if (!idle.empty())
+    {
+        // the most recently used one is the least likely to have been dropped by the head-end
+        client = idle.back().client;
+        idle.pop_back();
+        transport->mStats.reused++;
+        transport->mStats.idle--;
+        LOG(DLOGL_NOISE, "reusing the connection to %s", key.c_str());
+    }
+    else
+    {
+        client = RTSPClientInterface::createNew(*transport->mEnv, NULL, VERBOSITY_LEVEL, "CloudDVR", 0);
+        if (client == NULL)
+        {
+            LOG(DLOGL_ERROR, "Failed to create the rtspClient to %s", key.c_str());
+        }
+        else
+        {
+            transport->mHeadEnd[client] = key;
+            transport->mStats.opened++;
+            LOG(DLOGL_NOISE, "new connection to %s", key.c_str());
+        }
+    }
+
+    if (client)
+    {
+        if (++transport->mNextToken == 0)
+        {
+            transport->mNextToken++;
+        }
+        client->mToken = transport->mNextToken;
+        client->pStreamControl = args->owner;
+    }
+    pthread_mutex_unlock(&transport->mMutex);
+
+    bool ok = (client == NULL);
+    if (client && !client->setURL((char *) args->url->c_str()))
+    {
+        LOG(DLOGL_ERROR, "Couldn't set URL on the RTSP client");
+    }
+    else if (client && !client->setSessionId((char *) args->sessionId->c_str()))
+    {
+        LOG(DLOGL_ERROR, "Couldn't set sessionId on the RTSP client");
+    }
+    else
+    {
+        ok = true;
+    }
+
+    if (!ok)
+    {
+        ReleaseArgs closed;
+        closed.client = client;
+        closed.keep = false;
+        ReleaseTask(&closed);
+        client = NULL;
+    }
+    args->client = client;
+}
+
+RTSPClientInterface* CloudDvrRtspTransport::acquire(const std::string &url, const std::string &sessionId,
+        CloudDvr_StreamControl *owner)
+{
+    AcquireArgs args;
+
+    args.transport = this;
+    args.url = &url;
+    args.sessionId = &sessionId;
+    args.owner = owner;
+    args.client = NULL;
+    if (!call(AcquireTask, &args))
+    {
+        return NULL;
+    }
+    return args.client;
+}
+
+// on the scheduler thread
+void CloudDvrRtspTransport::ReleaseTask(void *arg)
+{
+    ReleaseArgs *args = (ReleaseArgs *) arg;
+    RTSPClientInterface *client = args->client;
+    CloudDvrRtspTransport *transport = getInstance();
+
+    pthread_mutex_lock(&transport->mMutex);
+    // responses still due for the old session find no stream control
+    client->pStreamControl = NULL;
+    client->mToken = 0;
+
+    std::map<RTSPClientInterface*, std::string>::iterator itr = transport->mHeadEnd.find(client);
+    if (itr == transport->mHeadEnd.end())
+    {
+        Medium::close(client);
+    }
+    else if (!args->keep)
+    {
+        transport->mHeadEnd.erase(itr);
+        Medium::close(client);
+    }
+    else if (!client->mInFlight.empty())
+    {
+        // its responses would be read on the next session
+        LOG(DLOGL_MINOR_DEBUG, "closing the connection to %s, %d requests in flight", itr->second.c_str(),
+            (int) client->mInFlight.size());
+        transport->mHeadEnd.erase(itr);
+        Medium::close(client);
+        transport->mStats.closedBusy++;
+    }
+    else
+    {
+        std::vector<IdleConnection> &idle = transport->mIdle[itr->second];
+        IdleConnection conn;
+        conn.client = client;
+        conn.sinceMs = monotonicNowMs();
+        idle.push_back(conn);
+        transport->mStats.idle++;
+
+        if (idle.size() > kRtspMaxIdleConnections)
+        {
+            transport->mHeadEnd.erase(idle.front().client);
+            Medium::close(idle.front().client);
+            idle.erase(idle.begin());
+            transport->mStats.closedIdle++;
+            transport->mStats.idle--;
+        }
+    }
+    transport->pruneIdle(monotonicNowMs());
+    pthread_mutex_unlock(&transport->mMutex);
+}
+
+void CloudDvrRtspTransport::release(RTSPClientInterface *client)
+{
+    ReleaseArgs args;
+
+    args.client = client;
+    args.keep = true;
+    // waited for: the handler of a response may be running for the owner right now
+    if (client && !call(ReleaseTask, &args))
+    {
+        LOG(DLOGL_ERROR, "No RTSP scheduler to release %p", client);
+    }
+}
+
+void CloudDvrRtspTransport::close(RTSPClientInterface *client)
+{
+    ReleaseArgs args;
+
+    args.client = client;
+    args.keep = false;
+    if (client && !call(ReleaseTask, &args))
+    {
+        LOG(DLOGL_ERROR, "No RTSP scheduler to close %p", client);
+    }
+}
+
+struct SessionArgs
+{
+    UsageEnvironment *env;
+    MediaSession     *session;
+};
+
+void CloudDvrRtspTransport::CreateSessionTask(void *arg)
+{
+    SessionArgs *args = (SessionArgs *) arg;
+    args->session = MediaSession::createNew(*args->env, NULL);
+}
+
+void CloudDvrRtspTransport::CloseSessionTask(void *arg)
+{
+    Medium::close((MediaSession *) arg);
+}
+
+MediaSession* CloudDvrRtspTransport::createSession(void)
+{
+    SessionArgs args;
+
+    args.env = getEnv();
+    args.session = NULL;
+    if ((args.env == NULL) || !call(CreateSessionTask, &args))
+    {
+        return NULL;
+    }
+    return args.session;
+}
+
+void CloudDvrRtspTransport::closeSession(MediaSession *session)
+{
+    // after the requests posted for it
+    if (session && !post(CloseSessionTask, session))
+    {
+        LOG(DLOGL_ERROR, "No RTSP scheduler to close %p", session);
+    }
+}
+
+enum eRtspMethod
+{
+    kRtspPlay,
+    kRtspPause,
+    kRtspGetParameter
+};
+
+struct RtspRequest
+{
+    eRtspMethod          method;
+    RTSPClientInterface *client;
+    MediaSession        *session;
+    RTSPClient::responseHandler *handler;
+    double               start;
+    double               end;
+    float                scale;
+    std::string          parameter;
+    bool                 hasParameter;
+};
+
+// on the scheduler thread, the client and the session are released after the requests posted for them
+void CloudDvrRtspTransport::SendTask(void *arg)
+{
+    RtspRequest *request = (RtspRequest *) arg;
+    unsigned cseq = 0;
+
+    // live555 answers a request it could not send right away, with an error
+    request->client->sent();
+    switch (request->method)
+    {
+    case kRtspPlay:
+        cseq = request->client->sendPlayCommand(*request->session, request->handler, request->start, request->end,
+                                                request->scale, NULL);
+        break;
+    case kRtspPause:
+        cseq = request->client->sendPauseCommand(*request->session, request->handler, NULL);
+        break;
+    case kRtspGetParameter:
+        cseq = request->client->sendGetParameterCommand(*request->session, request->handler,
+                request->hasParameter ? request->parameter.c_str() : NULL, NULL);
+        break;
+    }
+    if (cseq == 0)
+    {
+        LOG(DLOGL_ERROR, "request %d to %p not sent", request->method, request->client);
+    }
+    delete request;
+}
+
+bool CloudDvrRtspTransport::sendPlay(RTSPClientInterface *client, MediaSession *session,
+                                     RTSPClient::responseHandler *handler, double start, double end, float scale)
+{
+    RtspRequest *request = new RtspRequest;
+
+    request->method = kRtspPlay;
+    request->client = client;
+    request->session = session;
+    request->handler = handler;
+    request->start = start;
+    request->end = end;
+    request->scale = scale;
+    request->hasParameter = false;
+    if (!post(SendTask, request))
+    {
+        delete request;
+        return false;
+    }
+    return true;
+}
+
+bool CloudDvrRtspTransport::sendPause(RTSPClientInterface *client, MediaSession *session,
+                                      RTSPClient::responseHandler *handler)
+{
+    RtspRequest *request = new RtspRequest;
+
+    request->method = kRtspPause;
+    request->client = client;
+    request->session = session;
+    request->handler = handler;
+    request->hasParameter = false;
+    if (!post(SendTask, request))
+    {
+        delete request;
+        return false;
+    }
+    return true;
+}
+
+bool CloudDvrRtspTransport::sendGetParameter(RTSPClientInterface *client, MediaSession *session,
+        RTSPClient::responseHandler *handler, const char *parameter)
+{
+    RtspRequest *request = new RtspRequest;
+
+    request->method = kRtspGetParameter;
+    request->client = client;
+    request->session = session;
+    request->handler = handler;
+    request->hasParameter = (parameter != NULL);
+    if (parameter)
+    {
+        request->parameter = parameter;
+    }
+    if (!post(SendTask, request))
+    {
+        delete request;
+        return false;
+    }
+    return true;
+}
+
+void CloudDvrRtspTransport::getStats(tRtspTransportStats *stats)
+{
+    pthread_mutex_lock(&mMutex);
+    *stats = mStats;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void CloudDvrRtspTransport::logStats(void)
+{
+    tRtspTransportStats stats;
+
+    getStats(&stats);
+    LOG(DLOGL_NORMAL, "opened:%d reused:%d closedIdle:%d closedBusy:%d dropped:%d idle:%d", stats.opened, stats.reused,
+        stats.closedIdle, stats.closedBusy, stats.dropped, stats.idle);
+}
@@ -0,0 +1,173 @@
+/**
+   \file cloudDvrRtspTransport.h
+   \class CloudDvrRtspTransport
+
+   RTSP transport shared by all the Cloud DVR stream controls.
+
+   One live555 task scheduler thread serves the RTSP connections of every
+   session, rather than one scheduler and thread per session.  live555 is not
+   thread safe: the clients and media sessions are created, used and closed
+   on that thread only, the other threads hand their work to it with post()
+   or call(), woken through an event trigger of the scheduler.
+
+   The RTSP connection of a session that ends is not closed but kept idle for
+   the next session to the same head-end (host and port of the stream URL),
+   which then skips the TCP connect before its first PLAY.  A connection
+   released with requests in flight is closed instead, and each request is
+   tagged with the session it was sent for so that a response of an earlier
+   session never reaches the stream control of the next one.  Idle
+   connections are closed once they have been idle for
+   kRtspIdleConnectionSecs or when a head-end has more than
+   kRtspMaxIdleConnections of them.
+*/
+
+#if !defined(CLOUDDVR_RTSP_TRANSPORT_H)
+#define CLOUDDVR_RTSP_TRANSPORT_H
+
+#include <stdint.h>
+#include <string>
+#include <map>
+#include <vector>
+#include <list>
+#include <deque>
+#include <pthread.h>
+#include "liveMedia.hh"
+#include "BasicUsageEnvironment.hh"
+
+#define kRtspIdleConnectionSecs     30      ///< head-ends drop a connection without a session after a while
+#define kRtspMaxIdleConnections     4       ///< per head-end
+#define kRtspSchedulerStackSize     (1024*256)
+#define VERBOSITY_LEVEL             0
+
+class CloudDvr_StreamControl;
+
+/// Work run on the scheduler thread
+typedef void (tRtspTask)(void *arg);
+
+/// RTSP client of a stream control, the responses are handed to pStreamControl
+class RTSPClientInterface : public RTSPClient
+{
+public:
+    static RTSPClientInterface* createNew(UsageEnvironment& env, char const* rtspURL, int verbosityLevel = 0,
+                                          char const* applicationName = NULL, portNumBits tunnelOverHTTPPortNum = 0);
+protected:
+    RTSPClientInterface(UsageEnvironment& env, char const* rtspURL, int verbosityLevel,
+                        char const* applicationName, portNumBits tunnelOverHTTPPortNum);
+    // called only by createNew();
+    virtual ~RTSPClientInterface();
+public:
+    /// A request of the current session goes out, on the scheduler thread
+    void sent(void);
+    /// Stream control of the session the response is for, NULL when it was sent by an earlier one.
+    /// Called once by every response handler, on the scheduler thread
+    CloudDvr_StreamControl* answered(void);
+
+    CloudDvr_StreamControl* pStreamControl;
+private:
+    friend class CloudDvrRtspTransport;
+
+    uint32_t mToken;                    ///< of the session the client is acquired for, 0 when idle
+    std::deque<uint32_t> mInFlight;     ///< token of every request awaiting its response, oldest first
+};
+
+typedef struct
+{
+    unsigned int opened;         ///< connections created
+    unsigned int reused;         ///< sessions that got an idle connection
+    unsigned int closedIdle;     ///< idle connections closed unused
+    unsigned int closedBusy;     ///< released with requests in flight, closed rather than kept
+    unsigned int dropped;        ///< responses to requests of an earlier session
+    unsigned int idle;
+} tRtspTransportStats;
+
+class CloudDvrRtspTransport
+{
+public:
+    static CloudDvrRtspTransport* getInstance(void);
+
+    /// Environment of the shared scheduler, whose thread is started on first use
+    UsageEnvironment* getEnv(void);
+
+    /// Runs fn(arg) on the scheduler thread after the work posted before it, false when there is no scheduler
+    bool post(tRtspTask *fn, void *arg);
+    /// As post(), returns once fn(arg) has run
+    bool call(tRtspTask *fn, void *arg);
+
+    /// RTSP client for sessionId of owner to url: an idle connection to the same head-end when there is one
+    RTSPClientInterface* acquire(const std::string &url, const std::string &sessionId, CloudDvr_StreamControl *owner);
+    /// The session is over, the connection of client is kept for the next one to its head-end.
+    /// No response reaches the owner once this returns
+    void release(RTSPClientInterface *client);
+    /// As release(), the connection is closed rather than kept
+    void close(RTSPClientInterface *client);
+
+    MediaSession* createSession(void);
+    void closeSession(MediaSession *session);
+
+    /// The requests are sent from the scheduler thread; a request that could not be sent is
+    /// answered with an error. false when there is no scheduler
+    bool sendPlay(RTSPClientInterface *client, MediaSession *session, RTSPClient::responseHandler *handler,
+                  double start, double end, float scale);
+    bool sendPause(RTSPClientInterface *client, MediaSession *session, RTSPClient::responseHandler *handler);
+    /// parameter NULL for an empty GET_PARAMETER, as a keep-alive
+    bool sendGetParameter(RTSPClientInterface *client, MediaSession *session, RTSPClient::responseHandler *handler,
+                          const char *parameter);
+
+    void getStats(tRtspTransportStats *stats);
+    void logStats(void);
+
+    /// "host:port" of an rtsp:// URL
+    static std::string headEnd(const std::string &url);
+
+private:
+    friend class RTSPClientInterface;
+
+    struct IdleConnection
+    {
+        RTSPClientInterface *client;
+        uint64_t             sinceMs;
+    };
+
+    struct Task
+    {
+        tRtspTask *fn;
+        void      *arg;
+        bool      *done;            ///< set once run, for call()
+    };
+
+    CloudDvrRtspTransport();
+    ~CloudDvrRtspTransport();
+
+    static void *SchedulerThread(void *arg);
+    static void TasksTriggered(void *arg);
+    static void AcquireTask(void *arg);
+    static void ReleaseTask(void *arg);
+    static void CreateSessionTask(void *arg);
+    static void CloseSessionTask(void *arg);
+    static void SendTask(void *arg);
+    bool queue(tRtspTask *fn, void *arg, bool *done);
+    bool onSchedulerThread(void);
+    void pruneIdle(uint64_t now);
+
+    pthread_mutex_t   mMutex;
+    pthread_cond_t    mDoneCond;
+    TaskScheduler    *mScheduler;
+    UsageEnvironment *mEnv;
+    EventTriggerId    mTrigger;
+    pthread_t         mThread;
+    bool              mThreadStarted;
+    char              mShutDownFlag;        ///< never set, the scheduler serves the sessions for the life of the process
+    std::list<Task>   mTasks;
+    uint32_t          mNextToken;
+    std::map<std::string, std::vector<IdleConnection> > mIdle;   ///< by head-end, oldest first
+    std::map<RTSPClientInterface*, std::string> mHeadEnd;        ///< of every connection handed out
+    tRtspTransportStats mStats;
+
+    static CloudDvrRtspTransport *mInstance;
+    static pthread_mutex_t mInstanceMutex;
+
+    CloudDvrRtspTransport(const CloudDvrRtspTransport&);
+    CloudDvrRtspTransport& operator=(const CloudDvrRtspTransport&);
+};
+
+#endif
@@ -0,0 +1,181 @@
+/**
+
+\file cloudDvrRtspTransport_test.h -- contains the cxxtest test cases for the Cloud DVR RTSP transport
+
+The requests are sent through the transport, as the stream controls do, to a
+local RtspStandIn, and the responses are waited for on the shared scheduler
+thread.  The owner of the sessions is a token, no stream control is created.
+*/
+
+#if !defined(CLOUDDVR_RTSP_TRANSPORT_TEST_H)
+#define CLOUDDVR_RTSP_TRANSPORT_TEST_H
+
+#include <cxxtest/TestSuite.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cloudDvrRtspTransport.h"
+#include "rtspStandIn.h"
+
+#define kTestResponseTimeoutMs  3000
+#define kTestOwner              ((CloudDvr_StreamControl *) 0x1234)
+
+static volatile int gResponses;
+static volatile int gResultCode;
+static CloudDvr_StreamControl * volatile gOwner;
+static char gResult[32];
+
+static void testResponse(RTSPClient* rtspClient, int resultCode, char* resultString)
+{
+    gOwner = ((RTSPClientInterface *) rtspClient)->answered();
+    gResultCode = resultCode;
+    gResult[0] = '\0';
+    if (resultString)
+    {
+        strncpy(gResult, resultString, sizeof(gResult) - 1);
+        gResult[sizeof(gResult) - 1] = '\0';
+        delete[] resultString;
+    }
+    __sync_fetch_and_add(&gResponses, 1);
+}
+
+static bool waitResponses(int count)
+{
+    for (int waited = 0; waited < kTestResponseTimeoutMs; waited += 10)
+    {
+        if (__sync_fetch_and_add(&gResponses, 0) >= count)
+        {
+            return true;
+        }
+        usleep(10000);
+    }
+    return false;
+}
+
+class cloudDvrRtspTransportTestSuite : public CxxTest::TestSuite
+{
+public:
+
+    void testHeadEnd()
+    {
+        TS_ASSERT_EQUALS(CloudDvrRtspTransport::headEnd("rtsp://10.1.2.3:8554/asset/1"), std::string("10.1.2.3:8554"));
+        TS_ASSERT_EQUALS(CloudDvrRtspTransport::headEnd("rtsp://cdvr.example.net/asset"), std::string("cdvr.example.net:554"));
+        TS_ASSERT_EQUALS(CloudDvrRtspTransport::headEnd("rtsp://user:pw@10.1.2.3/asset"), std::string("10.1.2.3:554"));
+        TS_ASSERT_EQUALS(CloudDvrRtspTransport::headEnd("rtsp://10.1.2.3:8554"), std::string("10.1.2.3:8554"));
+    }
+
+    void testConnectionReusedAcrossSessions()
+    {
+        RtspStandIn server;
+        CloudDvrRtspTransport *transport = CloudDvrRtspTransport::getInstance();
+        tRtspStandInStats stats;
+        tRtspTransportStats before, after;
+
+        TS_ASSERT(server.start());
+        std::string url = server.url("asset");
+        MediaSession *session = transport->createSession();
+        TS_ASSERT(session != NULL);
+        transport->getStats(&before);
+
+        // two sessions one after the other
+        RTSPClientInterface *first = transport->acquire(url, "1", kTestOwner);
+        TS_ASSERT(first != NULL);
+        gResponses = 0;
+        TS_ASSERT(transport->sendPlay(first, session, testResponse, 10.0, -1.0, 1.0f));
+        TS_ASSERT(waitResponses(1));
+        TS_ASSERT_EQUALS(gResultCode, 0);
+        TS_ASSERT_EQUALS(gOwner, kTestOwner);
+        transport->release(first);
+
+        RTSPClientInterface *second = transport->acquire(url, "2", kTestOwner);
+        TS_ASSERT_EQUALS(second, first);
+        gResponses = 0;
+        TS_ASSERT(transport->sendPlay(second, session, testResponse, 20.0, -1.0, 1.0f));
+        TS_ASSERT(waitResponses(1));
+        transport->release(second);
+
+        server.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.connections, 1u);
+        TS_ASSERT_EQUALS(stats.plays, 2u);
+        transport->getStats(&after);
+        TS_ASSERT_EQUALS(after.opened, before.opened + 1);
+        TS_ASSERT_EQUALS(after.reused, before.reused + 1);
+
+        transport->closeSession(session);
+        server.stop();
+    }
+
+    void testBusyConnectionNotKept()
+    {
+        RtspStandIn server;
+        CloudDvrRtspTransport *transport = CloudDvrRtspTransport::getInstance();
+        tRtspTransportStats before, after;
+
+        TS_ASSERT(server.start());
+        std::string url = server.url("asset");
+        server.setDelays(0, 200);
+        MediaSession *session = transport->createSession();
+        transport->getStats(&before);
+
+        // released with its PLAY unanswered
+        RTSPClientInterface *first = transport->acquire(url, "1", kTestOwner);
+        TS_ASSERT(first != NULL);
+        gResponses = 0;
+        TS_ASSERT(transport->sendPlay(first, session, testResponse, 10.0, -1.0, 1.0f));
+        transport->release(first);
+
+        // a connection of its own for the next session, which hears nothing of the first
+        RTSPClientInterface *second = transport->acquire(url, "2", kTestOwner);
+        TS_ASSERT(second != NULL);
+        TS_ASSERT(transport->sendPlay(second, session, testResponse, 20.0, -1.0, 1.0f));
+        TS_ASSERT(waitResponses(1));
+        TS_ASSERT_EQUALS(gResultCode, 0);
+        TS_ASSERT_EQUALS(gOwner, kTestOwner);
+        transport->release(second);
+
+        transport->getStats(&after);
+        TS_ASSERT_EQUALS(after.opened, before.opened + 2);
+        TS_ASSERT_EQUALS(after.closedBusy, before.closedBusy + 1);
+        TS_ASSERT_EQUALS(after.idle, before.idle + 1);
+
+        transport->closeSession(session);
+        server.stop();
+    }
+
+    void testGetParametersPipelined()
+    {
+        RtspStandIn server;
+        CloudDvrRtspTransport *transport = CloudDvrRtspTransport::getInstance();
+        tRtspStandInStats stats;
+
+        TS_ASSERT(server.start());
+        std::string url = server.url("asset");
+        server.setDelays(0, 50);
+        MediaSession *session = transport->createSession();
+
+        RTSPClientInterface *client = transport->acquire(url, "1", kTestOwner);
+        TS_ASSERT(client != NULL);
+        gResponses = 0;
+        TS_ASSERT(transport->sendPlay(client, session, testResponse, 100.0, -1.0, 2.0f));
+        TS_ASSERT(waitResponses(1));
+
+        // sent back to back: the second is on the wire before the first is answered
+        gResponses = 0;
+        TS_ASSERT(transport->sendGetParameter(client, session, testResponse, "scale"));
+        TS_ASSERT(transport->sendGetParameter(client, session, testResponse, "position"));
+        TS_ASSERT(waitResponses(2));
+        TS_ASSERT_EQUALS(gResultCode, 0);
+        TS_ASSERT(atof(gResult) >= 100.0);
+
+        server.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.getParameters, 2u);
+        TS_ASSERT_EQUALS(stats.pipelined, 1u);
+
+        transport->release(client);
+        transport->closeSession(session);
+        server.stop();
+    }
+};
+
+#endif
@@ -0,0 +1,160 @@
+/** @file cloudDvrRtsp_bench.cpp
+ *
+ * @brief Measures the latency of a seek of a Cloud DVR stream.
+ *
+ * A seek is a PLAY with a Range, and the position poll following it has to
+ * ask the server for both the scale and the position.  The seeks are made
+ * against a local RtspStandIn whose connect and response delays stand for
+ * the round trip to a head-end:
+ *  - "fresh, serial": each seek on a new RTSP connection, as each session
+ *    had its own before, the GET_PARAMETER of the scale and the position
+ *    one after the other,
+ *  - "reused, serial": the connection kept by CloudDvrRtspTransport,
+ *  - "reused, pipelined": the two GET_PARAMETER sent back to back, as
+ *    CloudDvr_StreamControl::SendGetParameters() does.
+ * Build with "make cloudDvrRtsp_bench" and run on the target, optionally
+ * with the connect and response delays in ms as arguments.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cloudDvrRtspTransport.h"
+#include "rtspStandIn.h"
+
+#define kBenchSeeks             50
+#define kBenchConnectMs         20
+#define kBenchResponseMs        10
+#define kBenchTimeoutMs         3000
+
+static volatile int gResponses;
+
+static double nowMs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1e3) + (ts.tv_nsec / 1e6);
+}
+
+static void benchResponse(RTSPClient* rtspClient, int resultCode, char* resultString)
+{
+    (void) resultCode;
+    ((RTSPClientInterface *) rtspClient)->answered();
+    delete[] resultString;
+    __sync_fetch_and_add(&gResponses, 1);
+}
+
+static bool waitResponses(int count)
+{
+    double deadline = nowMs() + kBenchTimeoutMs;
+
+    while (__sync_fetch_and_add(&gResponses, 0) < count)
+    {
+        if (nowMs() > deadline)
+        {
+            return false;
+        }
+        usleep(100);
+    }
+    return true;
+}
+
+// one seek and the position poll after it, the PLAY latency in *playMs
+static bool seek(CloudDvrRtspTransport *transport, RTSPClientInterface *client, MediaSession *session, double npt,
+                 bool pipelined, double *playMs)
+{
+    double start = nowMs();
+
+    gResponses = 0;
+    transport->sendPlay(client, session, benchResponse, npt, -1.0, 1.0f);
+    if (!waitResponses(1))
+    {
+        return false;
+    }
+    *playMs = nowMs() - start;
+
+    transport->sendGetParameter(client, session, benchResponse, "scale");
+    if (!pipelined && !waitResponses(2))
+    {
+        return false;
+    }
+    transport->sendGetParameter(client, session, benchResponse, "position");
+    return waitResponses(3);
+}
+
+static void report(const char *method, double playMs, double totalMs)
+{
+    printf("%-20s %12.2f %14.2f\n", method, playMs / kBenchSeeks, totalMs / kBenchSeeks);
+}
+
+int main(int argc, char **argv)
+{
+    RtspStandIn server;
+    CloudDvrRtspTransport *transport = CloudDvrRtspTransport::getInstance();
+    unsigned int connectMs = (argc > 1) ? atoi(argv[1]) : kBenchConnectMs;
+    unsigned int responseMs = (argc > 2) ? atoi(argv[2]) : kBenchResponseMs;
+
+    if (!server.start())
+    {
+        printf("ERROR: the RTSP stand-in did not start\n");
+        return 1;
+    }
+    server.setDelays(connectMs, responseMs);
+
+    MediaSession *session = transport->createSession();
+    if (session == NULL)
+    {
+        printf("ERROR: no RTSP scheduler\n");
+        return 1;
+    }
+    std::string url = server.url("asset");
+
+    printf("connect %u ms, response %u ms, %d seeks\n", connectMs, responseMs, kBenchSeeks);
+    printf("%-20s %12s %14s\n", "method", "PLAY ms", "PLAY+poll ms");
+
+    for (int method = 0; method < 3; method++)
+    {
+        static const char *names[] = { "fresh, serial", "reused, serial", "reused, pipelined" };
+        double playTotal = 0;
+        double start = nowMs();
+
+        for (int i = 0; i < kBenchSeeks; i++)
+        {
+            double playMs = 0;
+            RTSPClientInterface *client = transport->acquire(url, "1", NULL);
+
+            if (client == NULL)
+            {
+                printf("ERROR: no RTSP client\n");
+                return 1;
+            }
+
+            if (!seek(transport, client, session, (i * 37) % 3600, method == 2, &playMs))
+            {
+                printf("ERROR: %s seek timed out\n", names[method]);
+                return 1;
+            }
+            playTotal += playMs;
+
+            if (method == 0)
+            {
+                transport->close(client);
+            }
+            else
+            {
+                transport->release(client);
+            }
+        }
+        report(names[method], playTotal, nowMs() - start);
+    }
+
+    tRtspStandInStats stats;
+    server.getStats(&stats);
+    printf("stand-in: %u connections, %u requests, %u pipelined\n", stats.connections, stats.requests, stats.pipelined);
+
+    transport->closeSession(session);
+    server.stop();
+    return 0;
+}
@@ -0,0 +1,413 @@
+/**
+*  \file crc32.cpp
+*
+*  CRC-32/MPEG-2 implementations, see crc32.h.
+*/
+
+#include <string.h>
+#include <pthread.h>
+#include <dlog.h>
+
+#include "crc32.h"
+
+#if defined(MSP_CRC32_HAVE_PCLMUL)
+#include <cpuid.h>
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <wmmintrin.h>
+#endif
+
+#if defined(MSP_CRC32_HAVE_ARMV8)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#if !defined(HWCAP_CRC32)
+#define HWCAP_CRC32 (1 << 7)
+#endif
+#endif
+
+#define LOG(level, msg, args...)  dlog(DL_MSP_PSI, level,"MSPCrc32:%s:%d " msg, __FUNCTION__, __LINE__, ##args);
+
+#define kCrc32Poly              0x04C11DB7
+#define kCrc32SelfTestSize      1024
+
+///////////////////////////////////////////////////////////////////////////
+//                      Tables
+///////////////////////////////////////////////////////////////////////////
+
+// crcTable[0] is the original byte table, crcTable[k][i] is the CRC of byte i
+// followed by k zero bytes.  Built from crcTable[0] by init().
+static unsigned int crcTable[8][256] =
+{
+    {
+        0x00000000L, 0x04c11db7L, 0x09823b6eL, 0x0d4326d9L,
+        0x130476dcL, 0x17c56b6bL, 0x1a864db2L, 0x1e475005L,
+        0x2608edb8L, 0x22c9f00fL, 0x2f8ad6d6L, 0x2b4bcb61L,
+        0x350c9b64L, 0x31cd86d3L, 0x3c8ea00aL, 0x384fbdbdL,
+        0x4c11db70L, 0x48d0c6c7L, 0x4593e01eL, 0x4152fda9L,
+        0x5f15adacL, 0x5bd4b01bL, 0x569796c2L, 0x52568b75L,
+        0x6a1936c8L, 0x6ed82b7fL, 0x639b0da6L, 0x675a1011L,
+        0x791d4014L, 0x7ddc5da3L, 0x709f7b7aL, 0x745e66cdL,
+        0x9823b6e0L, 0x9ce2ab57L, 0x91a18d8eL, 0x95609039L,
+        0x8b27c03cL, 0x8fe6dd8bL, 0x82a5fb52L, 0x8664e6e5L,
+        0xbe2b5b58L, 0xbaea46efL, 0xb7a96036L, 0xb3687d81L,
+        0xad2f2d84L, 0xa9ee3033L, 0xa4ad16eaL, 0xa06c0b5dL,
+        0xd4326d90L, 0xd0f37027L, 0xddb056feL, 0xd9714b49L,
+        0xc7361b4cL, 0xc3f706fbL, 0xceb42022L, 0xca753d95L,
+        0xf23a8028L, 0xf6fb9d9fL, 0xfbb8bb46L, 0xff79a6f1L,
+        0xe13ef6f4L, 0xe5ffeb43L, 0xe8bccd9aL, 0xec7dd02dL,
+        0x34867077L, 0x30476dc0L, 0x3d044b19L, 0x39c556aeL,
+        0x278206abL, 0x23431b1cL, 0x2e003dc5L, 0x2ac12072L,
+        0x128e9dcfL, 0x164f8078L, 0x1b0ca6a1L, 0x1fcdbb16L,
+        0x018aeb13L, 0x054bf6a4L, 0x0808d07dL, 0x0cc9cdcaL,
+        0x7897ab07L, 0x7c56b6b0L, 0x71159069L, 0x75d48ddeL,
+        0x6b93dddbL, 0x6f52c06cL, 0x6211e6b5L, 0x66d0fb02L,
+        0x5e9f46bfL, 0x5a5e5b08L, 0x571d7dd1L, 0x53dc6066L,
+        0x4d9b3063L, 0x495a2dd4L, 0x44190b0dL, 0x40d816baL,
+        0xaca5c697L, 0xa864db20L, 0xa527fdf9L, 0xa1e6e04eL,
+        0xbfa1b04bL, 0xbb60adfcL, 0xb6238b25L, 0xb2e29692L,
+        0x8aad2b2fL, 0x8e6c3698L, 0x832f1041L, 0x87ee0df6L,
+        0x99a95df3L, 0x9d684044L, 0x902b669dL, 0x94ea7b2aL,
+        0xe0b41de7L, 0xe4750050L, 0xe9362689L, 0xedf73b3eL,
+        0xf3b06b3bL, 0xf771768cL, 0xfa325055L, 0xfef34de2L,
+        0xc6bcf05fL, 0xc27dede8L, 0xcf3ecb31L, 0xcbffd686L,
+        0xd5b88683L, 0xd1799b34L, 0xdc3abdedL, 0xd8fba05aL,
+        0x690ce0eeL, 0x6dcdfd59L, 0x608edb80L, 0x644fc637L,
+        0x7a089632L, 0x7ec98b85L, 0x738aad5cL, 0x774bb0ebL,
+        0x4f040d56L, 0x4bc510e1L, 0x46863638L, 0x42472b8fL,
+        0x5c007b8aL, 0x58c1663dL, 0x558240e4L, 0x51435d53L,
+        0x251d3b9eL, 0x21dc2629L, 0x2c9f00f0L, 0x285e1d47L,
+        0x36194d42L, 0x32d850f5L, 0x3f9b762cL, 0x3b5a6b9bL,
+        0x0315d626L, 0x07d4cb91L, 0x0a97ed48L, 0x0e56f0ffL,
+        0x1011a0faL, 0x14d0bd4dL, 0x19939b94L, 0x1d528623L,
+        0xf12f560eL, 0xf5ee4bb9L, 0xf8ad6d60L, 0xfc6c70d7L,
+        0xe22b20d2L, 0xe6ea3d65L, 0xeba91bbcL, 0xef68060bL,
+        0xd727bbb6L, 0xd3e6a601L, 0xdea580d8L, 0xda649d6fL,
+        0xc423cd6aL, 0xc0e2d0ddL, 0xcda1f604L, 0xc960ebb3L,
+        0xbd3e8d7eL, 0xb9ff90c9L, 0xb4bcb610L, 0xb07daba7L,
+        0xae3afba2L, 0xaafbe615L, 0xa7b8c0ccL, 0xa379dd7bL,
+        0x9b3660c6L, 0x9ff77d71L, 0x92b45ba8L, 0x9675461fL,
+        0x8832161aL, 0x8cf30badL, 0x81b02d74L, 0x857130c3L,
+        0x5d8a9099L, 0x594b8d2eL, 0x5408abf7L, 0x50c9b640L,
+        0x4e8ee645L, 0x4a4ffbf2L, 0x470cdd2bL, 0x43cdc09cL,
+        0x7b827d21L, 0x7f436096L, 0x7200464fL, 0x76c15bf8L,
+        0x68860bfdL, 0x6c47164aL, 0x61043093L, 0x65c52d24L,
+        0x119b4be9L, 0x155a565eL, 0x18197087L, 0x1cd86d30L,
+        0x029f3d35L, 0x065e2082L, 0x0b1d065bL, 0x0fdc1becL,
+        0x3793a651L, 0x3352bbe6L, 0x3e119d3fL, 0x3ad08088L,
+        0x2497d08dL, 0x2056cd3aL, 0x2d15ebe3L, 0x29d4f654L,
+        0xc5a92679L, 0xc1683bceL, 0xcc2b1d17L, 0xc8ea00a0L,
+        0xd6ad50a5L, 0xd26c4d12L, 0xdf2f6bcbL, 0xdbee767cL,
+        0xe3a1cbc1L, 0xe760d676L, 0xea23f0afL, 0xeee2ed18L,
+        0xf0a5bd1dL, 0xf464a0aaL, 0xf9278673L, 0xfde69bc4L,
+        0x89b8fd09L, 0x8d79e0beL, 0x803ac667L, 0x84fbdbd0L,
+        0x9abc8bd5L, 0x9e7d9662L, 0x933eb0bbL, 0x97ffad0cL,
+        0xafb010b1L, 0xab710d06L, 0xa6322bdfL, 0xa2f33668L,
+        0xbcb4666dL, 0xb8757bdaL, 0xb5365d03L, 0xb1f740b4L
+    }
+};
+
+static pthread_once_t sInitOnce = PTHREAD_ONCE_INIT;
+static MSPCrc32::eImpl sImpl = MSPCrc32::kImplSlicingBy8;
+static bool sSupported[MSPCrc32::kImplCount];
+
+#if defined(MSP_CRC32_HAVE_PCLMUL)
+// x^n mod P, for the folding constants
+static unsigned int xPowMod(unsigned int n)
+{
+    unsigned int r = 1;
+    while (n--)
+    {
+        r = (r & 0x80000000) ? ((r << 1) ^ kCrc32Poly) : (r << 1);
+    }
+    return r;
+}
+
+static unsigned long long sFold128Hi, sFold128Lo;    // x^192, x^128 mod P
+static unsigned long long sFold512Hi, sFold512Lo;    // x^576, x^512 mod P
+#endif
+
+///////////////////////////////////////////////////////////////////////////
+//                      Member implementation
+///////////////////////////////////////////////////////////////////////////
+
+void MSPCrc32::init(void)
+{
+    for (int k = 1; k < 8; k++)
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            unsigned int prev = crcTable[k - 1][i];
+            crcTable[k][i] = (prev << 8) ^ crcTable[0][prev >> 24];
+        }
+    }
+
+    sSupported[kImplBytewise] = true;
+    sSupported[kImplSlicingBy8] = true;
+
+#if defined(MSP_CRC32_HAVE_PCLMUL)
+    unsigned int eax, ebx, ecx, edx;
+    if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_PCLMUL) && (ecx & bit_SSSE3))
+    {
+        sFold128Hi = xPowMod(192);
+        sFold128Lo = xPowMod(128);
+        sFold512Hi = xPowMod(576);
+        sFold512Lo = xPowMod(512);
+        sSupported[kImplPclmul] = true;
+    }
+#endif
+
+#if defined(MSP_CRC32_HAVE_ARMV8)
+    if (getauxval(AT_HWCAP) & HWCAP_CRC32)
+    {
+        sSupported[kImplArmv8] = true;
+    }
+#endif
+
+    // Only trust a hardware path once it agrees with the table on every
+    // length and alignment of a pseudo random buffer.
+    static unsigned char testBuf[kCrc32SelfTestSize + 8];
+    unsigned int seed = 0x12345678;
+    for (unsigned int i = 0; i < sizeof(testBuf); i++)
+    {
+        seed = (seed * 1103515245) + 12345;
+        testBuf[i] = seed >> 16;
+    }
+
+    sImpl = kImplSlicingBy8;
+    for (int impl = kImplCount - 1; impl > kImplSlicingBy8; impl--)
+    {
+        bool pass = sSupported[impl];
+        for (size_t len = 0; pass && (len <= kCrc32SelfTestSize); len += (len < 300) ? 1 : 61)
+        {
+            for (size_t offset = 0; pass && (offset < 8); offset += 3)
+            {
+                unsigned int expected = bytewise(0xFFFFFFFF, testBuf + offset, len);
+                pass = (dispatch((eImpl) impl, 0xFFFFFFFF, testBuf + offset, len) == expected);
+            }
+        }
+
+        if (pass)
+        {
+            sImpl = (eImpl) impl;
+            break;
+        }
+        if (sSupported[impl])
+        {
+            LOG(DLOGL_ERROR, "%s CRC self test failed, not used", getImplName((eImpl) impl));
+            sSupported[impl] = false;
+        }
+    }
+
+    LOG(DLOGL_NORMAL, "using %s CRC32", getImplName(sImpl));
+}
+
+unsigned int MSPCrc32::compute(unsigned int crc, const void *buf, size_t len)
+{
+    pthread_once(&sInitOnce, init);
+
+    return dispatch(sImpl, crc, (const unsigned char *) buf, len);
+}
+
+unsigned int MSPCrc32::computeWith(eImpl impl, unsigned int crc, const void *buf, size_t len)
+{
+    pthread_once(&sInitOnce, init);
+
+    return dispatch(isSupported(impl) ? impl : kImplSlicingBy8, crc, (const unsigned char *) buf, len);
+}
+
+unsigned int MSPCrc32::dispatch(eImpl impl, unsigned int crc, const unsigned char *buf, size_t len)
+{
+    switch (impl)
+    {
+    case kImplBytewise:
+        return bytewise(crc, buf, len);
+#if defined(MSP_CRC32_HAVE_PCLMUL)
+    case kImplPclmul:
+        return pclmul(crc, buf, len);
+#endif
+#if defined(MSP_CRC32_HAVE_ARMV8)
+    case kImplArmv8:
+        return armv8(crc, buf, len);
+#endif
+    default:
+        return slicingBy8(crc, buf, len);
+    }
+}
+
+bool MSPCrc32::isSupported(eImpl impl)
+{
+    pthread_once(&sInitOnce, init);
+
+    return (impl >= 0) && (impl < kImplCount) && sSupported[impl];
+}
+
+MSPCrc32::eImpl MSPCrc32::getImpl(void)
+{
+    pthread_once(&sInitOnce, init);
+
+    return sImpl;
+}
+
+const char* MSPCrc32::getImplName(eImpl impl)
+{
+    switch (impl)
+    {
+    case kImplBytewise:
+        return "bytewise";
+    case kImplSlicingBy8:
+        return "slicing-by-8";
+    case kImplPclmul:
+        return "pclmulqdq";
+    case kImplArmv8:
+        return "armv8";
+    default:
+        return "unknown";
+    }
+}
+
+unsigned int MSPCrc32::bytewise(unsigned int crc, const unsigned char *buf, size_t len)
+{
+    for (; len > 0; len--)
+    {
+        crc = (crc << 8) ^ crcTable[0][0xff & ((crc >> 24) ^ (*buf++))];
+    }
+    return crc;
+}
+
+// Eight bytes per step: the first four are folded into the CRC register and
+// all eight looked up in parallel in the shifted tables.
+unsigned int MSPCrc32::slicingBy8(unsigned int crc, const unsigned char *buf, size_t len)
+{
+    while (len >= 8)
+    {
+        crc ^= ((unsigned int) buf[0] << 24) | ((unsigned int) buf[1] << 16) |
+               ((unsigned int) buf[2] << 8) | buf[3];
+        crc = crcTable[7][crc >> 24] ^ crcTable[6][(crc >> 16) & 0xff] ^
+              crcTable[5][(crc >> 8) & 0xff] ^ crcTable[4][crc & 0xff] ^
+              crcTable[3][buf[4]] ^ crcTable[2][buf[5]] ^
+              crcTable[1][buf[6]] ^ crcTable[0][buf[7]];
+        buf += 8;
+        len -= 8;
+    }
+
+    return bytewise(crc, buf, len);
+}
+
+#if defined(MSP_CRC32_HAVE_PCLMUL)
+// The CRC register is kept as a 128 bit polynomial with the first message
+// byte in the top bits, so carry-less products need no bit reflection.
+// Folding by D bits replaces hi * x^(D+64) + lo * x^D with the 96 bit
+// products of hi and lo by those powers reduced mod P.
+__attribute__((target("pclmul,ssse3")))
+static inline __m128i fold(__m128i value, __m128i constants, __m128i next)
+{
+    __m128i hi = _mm_clmulepi64_si128(value, constants, 0x11);
+    __m128i lo = _mm_clmulepi64_si128(value, constants, 0x00);
+    return _mm_xor_si128(_mm_xor_si128(hi, lo), next);
+}
+
+__attribute__((target("pclmul,ssse3")))
+static inline __m128i loadBigEndian(const unsigned char *buf, __m128i byteSwap)
+{
+    return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *) buf), byteSwap);
+}
+
+__attribute__((target("pclmul,ssse3")))
+unsigned int MSPCrc32::pclmul(unsigned int crc, const unsigned char *buf, size_t len)
+{
+    if (len < 64)
+    {
+        return slicingBy8(crc, buf, len);
+    }
+
+    const __m128i byteSwap = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    const __m128i fold128 = _mm_set_epi64x(sFold128Hi, sFold128Lo);
+    __m128i value;
+
+    if (len >= 128)
+    {
+        const __m128i fold512 = _mm_set_epi64x(sFold512Hi, sFold512Lo);
+        __m128i v0 = _mm_xor_si128(loadBigEndian(buf, byteSwap), _mm_set_epi32(crc, 0, 0, 0));
+        __m128i v1 = loadBigEndian(buf + 16, byteSwap);
+        __m128i v2 = loadBigEndian(buf + 32, byteSwap);
+        __m128i v3 = loadBigEndian(buf + 48, byteSwap);
+        buf += 64;
+        len -= 64;
+
+        while (len >= 64)
+        {
+            v0 = fold(v0, fold512, loadBigEndian(buf, byteSwap));
+            v1 = fold(v1, fold512, loadBigEndian(buf + 16, byteSwap));
+            v2 = fold(v2, fold512, loadBigEndian(buf + 32, byteSwap));
+            v3 = fold(v3, fold512, loadBigEndian(buf + 48, byteSwap));
+            buf += 64;
+            len -= 64;
+        }
+
+        value = fold(v0, fold128, v1);
+        value = fold(value, fold128, v2);
+        value = fold(value, fold128, v3);
+    }
+    else
+    {
+        value = _mm_xor_si128(loadBigEndian(buf, byteSwap), _mm_set_epi32(crc, 0, 0, 0));
+        buf += 16;
+        len -= 16;
+    }
+
+    while (len >= 16)
+    {
+        value = fold(value, fold128, loadBigEndian(buf, byteSwap));
+        buf += 16;
+        len -= 16;
+    }
+
+    // value * x^32 mod P is the CRC of everything folded so far
+    unsigned char folded[16];
+    _mm_storeu_si128((__m128i *) folded, _mm_shuffle_epi8(value, byteSwap));
+    crc = slicingBy8(0, folded, sizeof(folded));
+
+    return slicingBy8(crc, buf, len);
+}
+#endif
+
+#if defined(MSP_CRC32_HAVE_ARMV8)
+// The ARMv8 instructions implement the bit reflected CRC-32, which is the
+// MPEG-2 CRC with every data byte, the seed and the result bit reversed.
+static inline unsigned int reverseBits32(unsigned int value)
+{
+    unsigned int result;
+    __asm__("rbit %w0, %w1" : "=r"(result) : "r"(value));
+    return result;
+}
+
+static inline unsigned long long reverseBitsInBytes64(unsigned long long value)
+{
+    unsigned long long result;
+    __asm__("rbit %0, %1" : "=r"(result) : "r"(value));
+    return __builtin_bswap64(result);
+}
+
+__attribute__((target("arch=armv8-a+crc")))
+unsigned int MSPCrc32::armv8(unsigned int crc, const unsigned char *buf, size_t len)
+{
+    unsigned int reflected = reverseBits32(crc);
+
+    while (len >= 8)
+    {
+        unsigned long long data;
+        memcpy(&data, buf, sizeof(data));
+        reflected = __crc32d(reflected, reverseBitsInBytes64(data));
+        buf += 8;
+        len -= 8;
+    }
+    while (len > 0)
+    {
+        reflected = __crc32b(reflected, reverseBits32(*buf) >> 24);
+        buf++;
+        len--;
+    }
+
+    return reverseBits32(reflected);
+}
+#endif
@@ -0,0 +1,99 @@
+/** @file crc32_bench.cpp
+ *
+ * @brief Checks every MSPCrc32 implementation available on this CPU against
+ *        the original byte table and measures them on PSI sized sections.
+ *
+ * PSI sections are at most 1024 bytes (PAT/PMT/CAT) or 4096 bytes (private
+ * sections such as the application data tables).
+ * Build with "make crc32_bench" and run on the target.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "crc32.h"
+
+#define kBenchBufferSize    (4096 + 16)
+#define kBenchBytes         (256 * 1024 * 1024)
+
+static double nowSecs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+// every length up to 4096 at every alignment, continuing from random seeds
+static bool validate(MSPCrc32::eImpl impl, const unsigned char *buf)
+{
+    for (size_t offset = 0; offset < 16; offset++)
+    {
+        for (size_t len = 0; len <= 4096; len++)
+        {
+            unsigned int seed = (len & 1) ? 0xFFFFFFFF : (unsigned int) rand();
+            unsigned int expected = MSPCrc32::computeWith(MSPCrc32::kImplBytewise, seed, buf + offset, len);
+            unsigned int actual = MSPCrc32::computeWith(impl, seed, buf + offset, len);
+            if (actual != expected)
+            {
+                printf("ERROR: %s offset %u len %u: 0x%08x expected 0x%08x\n", MSPCrc32::getImplName(impl),
+                       (unsigned int) offset, (unsigned int) len, actual, expected);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+int main(void)
+{
+    static const size_t sectionSizes[] = { 188, 1024, 4096 };
+    static unsigned char buf[kBenchBufferSize];
+    bool ok = true;
+
+    srand(1);
+    for (size_t i = 0; i < sizeof(buf); i++)
+    {
+        buf[i] = rand() >> 8;
+    }
+
+    printf("selected: %s\n", MSPCrc32::getImplName(MSPCrc32::getImpl()));
+
+    printf("%-14s %-10s %-12s %-8s\n", "impl", "section", "MB/s", "speedup");
+    for (int impl = 0; impl < MSPCrc32::kImplCount; impl++)
+    {
+        if (!MSPCrc32::isSupported((MSPCrc32::eImpl) impl))
+        {
+            continue;
+        }
+        if (!validate((MSPCrc32::eImpl) impl, buf))
+        {
+            ok = false;
+            continue;
+        }
+
+        for (size_t i = 0; i < sizeof(sectionSizes) / sizeof(sectionSizes[0]); i++)
+        {
+            size_t len = sectionSizes[i];
+            unsigned int iterations = kBenchBytes / len;
+            volatile unsigned int sink = 0;
+            double secs[2];
+
+            for (int pass = 0; pass < 2; pass++)
+            {
+                MSPCrc32::eImpl run = pass ? (MSPCrc32::eImpl) impl : MSPCrc32::kImplBytewise;
+                double start = nowSecs();
+                for (unsigned int n = 0; n < iterations; n++)
+                {
+                    sink += MSPCrc32::computeWith(run, 0xFFFFFFFF, buf + (n & 7), len);
+                }
+                secs[pass] = nowSecs() - start;
+            }
+
+            printf("%-14s %-10u %-12.1f %-8.2f\n", MSPCrc32::getImplName((MSPCrc32::eImpl) impl), (unsigned int) len,
+                   ((double) iterations * len) / (secs[1] * 1e6), secs[0] / secs[1]);
+        }
+    }
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,225 @@
+/**
+   \file drivePlacement.cpp
+   \class DrivePlacement
+
+Implementation file for the placement of the TSBs and recordings on the record drives
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <dlog.h>
+
+#include "drivePlacement.h"
+
+#define LOG(level, msg, args...)  dlog(DL_MSP_DVR, level,"DrivePlacement:%s:%d " msg, __FUNCTION__, __LINE__, ##args);
+
+static const char *kindNames[kDriveLoad_Kinds] = { "recording", "tsb", "stream", "transcode" };
+
+DrivePlacement* DrivePlacement::mInstance = NULL;
+pthread_mutex_t DrivePlacement::mInstanceMutex = PTHREAD_MUTEX_INITIALIZER;
+
+DrivePlacement* DrivePlacement::getInstance(void)
+{
+    pthread_mutex_lock(&mInstanceMutex);
+    if (mInstance == NULL)
+    {
+        mInstance = new DrivePlacement();
+    }
+    pthread_mutex_unlock(&mInstanceMutex);
+    return mInstance;
+}
+
+DrivePlacement::DrivePlacement(const char *mountFormat)
+{
+    pthread_mutex_init(&mMutex, NULL);
+    mMountFormat = mountFormat;
+    mNextId = 1;
+    memset(mLoads, 0, sizeof(mLoads));
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+DrivePlacement::~DrivePlacement()
+{
+    pthread_mutex_destroy(&mMutex);
+}
+
+bool DrivePlacement::driveMounted(const char *mount)
+{
+    struct stat st;
+    struct stat parent;
+    std::string up = std::string(mount) + "/..";
+
+    // a mount point is on another device than its parent directory
+    return (stat(mount, &st) == 0) && S_ISDIR(st.st_mode) &&
+           (stat(up.c_str(), &parent) == 0) && (st.st_dev != parent.st_dev);
+}
+
+int DrivePlacement::driveOf(const std::string &path)
+{
+    size_t pos = path.find("mnt/dvr");
+    if ((pos == std::string::npos) || (pos + 7 >= path.size()))
+    {
+        return -1;
+    }
+    int drive = path[pos + 7] - '0';
+    return ((drive >= 0) && (drive < kDrivePlacementMaxDrives)) ? drive : -1;
+}
+
+uint32_t DrivePlacement::loadLocked(int drive)
+{
+    unsigned int sessions = 0;
+    for (int kind = 0; kind < kDriveLoad_Kinds; kind++)
+    {
+        sessions += mLoads[drive].sessions[kind];
+    }
+    return mLoads[drive].writeKbps + mLoads[drive].readKbps + (sessions * kDrivePlacementSeekKbps);
+}
+
+int DrivePlacement::chooseDrive(eDriveLoadKind kind, uint32_t readKbps, uint32_t writeKbps, int preferred)
+{
+    bool mounted[kDrivePlacementMaxDrives];
+    char mount[64];
+
+    // stat() outside the lock, a drive spinning up may take a while
+    for (int drive = 0; drive < kDrivePlacementMaxDrives; drive++)
+    {
+        snprintf(mount, sizeof(mount), mMountFormat.c_str(), drive);
+        mounted[drive] = driveMounted(mount);
+    }
+
+    pthread_mutex_lock(&mMutex);
+    uint32_t added = readKbps + writeKbps + kDrivePlacementSeekKbps;
+    int best = -1;
+    uint32_t bestLoad = 0;
+    for (int drive = 0; drive < kDrivePlacementMaxDrives; drive++)
+    {
+        uint32_t load = loadLocked(drive) + added;
+        if (mounted[drive] && ((best == -1) || (load < bestLoad)))
+        {
+            best = drive;
+            bestLoad = load;
+        }
+    }
+
+    mStats.placements++;
+    int drive = best;
+    if (best == -1)
+    {
+        mStats.noDrive++;
+        drive = ((preferred >= 0) && (preferred < kDrivePlacementMaxDrives)) ? preferred : 0;
+        LOG(DLOGL_ERROR, "no record drive mounted, %s on drive %d", kindNames[kind], drive);
+    }
+    else if ((preferred >= 0) && (preferred < kDrivePlacementMaxDrives) && (preferred != best) && mounted[preferred])
+    {
+        if (loadLocked(preferred) + added <= bestLoad + kDrivePlacementMarginKbps)
+        {
+            drive = preferred;
+        }
+        else
+        {
+            mStats.moved++;
+            LOG(DLOGL_NOISE, "%s on drive %d, drive %d has %u kbps", kindNames[kind], best, preferred, loadLocked(preferred));
+        }
+    }
+
+    uint32_t load = loadLocked(drive) + added;
+    if (load > kDrivePlacementDriveKbps)
+    {
+        mStats.overloaded++;
+        LOG(DLOGL_ERROR, "drive %d loaded to %u kbps with a new %s", drive, load, kindNames[kind]);
+    }
+    pthread_mutex_unlock(&mMutex);
+    return drive;
+}
+
+int DrivePlacement::add(int drive, eDriveLoadKind kind, uint32_t readKbps, uint32_t writeKbps)
+{
+    if ((drive < 0) || (drive >= kDrivePlacementMaxDrives) || (kind >= kDriveLoad_Kinds))
+    {
+        LOG(DLOGL_NOISE, "%s not on a record drive (%d)", (kind < kDriveLoad_Kinds) ? kindNames[kind] : "?", drive);
+        return 0;
+    }
+
+    Session session;
+    session.drive = drive;
+    session.kind = kind;
+    session.readKbps = readKbps;
+    session.writeKbps = writeKbps;
+
+    pthread_mutex_lock(&mMutex);
+    int id = mNextId++;
+    if (mNextId <= 0)
+    {
+        mNextId = 1;
+    }
+    mSessions[id] = session;
+    mLoads[drive].sessions[kind]++;
+    mLoads[drive].readKbps += readKbps;
+    mLoads[drive].writeKbps += writeKbps;
+    LOG(DLOGL_REALLY_NOISY, "%s %d on drive %d: read %u write %u kbps", kindNames[kind], id, drive, readKbps, writeKbps);
+    pthread_mutex_unlock(&mMutex);
+    return id;
+}
+
+void DrivePlacement::remove(int id)
+{
+    if (id == 0)
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&mMutex);
+    std::map<int, Session>::iterator itr = mSessions.find(id);
+    if (itr != mSessions.end())
+    {
+        tDriveLoad &load = mLoads[itr->second.drive];
+        load.sessions[itr->second.kind]--;
+        load.readKbps -= itr->second.readKbps;
+        load.writeKbps -= itr->second.writeKbps;
+        mSessions.erase(itr);
+    }
+    else
+    {
+        LOG(DLOGL_ERROR, "no session %d", id);
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+void DrivePlacement::getLoad(int drive, tDriveLoad *load)
+{
+    memset(load, 0, sizeof(*load));
+    if ((drive < 0) || (drive >= kDrivePlacementMaxDrives))
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&mMutex);
+    *load = mLoads[drive];
+    load->loadKbps = loadLocked(drive);
+    pthread_mutex_unlock(&mMutex);
+}
+
+void DrivePlacement::getStats(tDrivePlacementStats *stats)
+{
+    pthread_mutex_lock(&mMutex);
+    *stats = mStats;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void DrivePlacement::logLoads(void)
+{
+    tDrivePlacementStats stats;
+    tDriveLoad load;
+
+    for (int drive = 0; drive < kDrivePlacementMaxDrives; drive++)
+    {
+        getLoad(drive, &load);
+        LOG(DLOGL_NORMAL, "drive %d: recordings:%u tsbs:%u streams:%u transcodes:%u write:%u read:%u load:%u kbps",
+            drive, load.sessions[kDriveLoad_Recording], load.sessions[kDriveLoad_Tsb], load.sessions[kDriveLoad_Stream],
+            load.sessions[kDriveLoad_Transcode], load.writeKbps, load.readKbps, load.loadKbps);
+    }
+    getStats(&stats);
+    LOG(DLOGL_NORMAL, "placements:%u moved:%u overloaded:%u noDrive:%u",
+        stats.placements, stats.moved, stats.overloaded, stats.noDrive);
+}
@@ -0,0 +1,117 @@
+/**
+   \file drivePlacement.h
+   \class DrivePlacement
+
+   Placement of the TSBs and recordings on the record drives.
+
+   A drive streams well until its sessions together ask for more than it can
+   seek and transfer; then the recordings on it drop packets.  The TSBs,
+   persistent recordings, MRDVR streams and MediaShrink transcodes each
+   register here the bandwidth they read and write on their drive for as
+   long as they run, and a new TSB or recording goes to the mounted drive
+   that has the least load once it is added.
+
+   The load of a drive is what its sessions transfer plus a seek cost for
+   each of them, every session moving the heads away from the others.  The
+   drive the platform prefers is kept while it is within
+   kDrivePlacementMarginKbps of the best one, so a box with little going on
+   places everything as before.
+*/
+
+#if !defined(DRIVE_PLACEMENT_H)
+#define DRIVE_PLACEMENT_H
+
+#include <stdint.h>
+#include <string>
+#include <map>
+#include <pthread.h>
+
+#define kDrivePlacementMaxDrives     2
+#define kDrivePlacementMountFormat   "/mnt/dvr%d"
+#define kDrivePlacementDriveKbps     100000  ///< what a drive sustains for a mix of sessions
+#define kDrivePlacementSeekKbps      4000    ///< transfer lost to seeking per session on a drive
+#define kDrivePlacementMarginKbps    8000    ///< load the preferred drive may have over the best one
+#define kDrivePlacementStreamKbps    17000   ///< an HD stream, TSB_VIDEO_BITRATE
+
+typedef enum
+{
+    kDriveLoad_Recording,
+    kDriveLoad_Tsb,
+    kDriveLoad_Stream,          ///< MRDVR serving a recording or TSB
+    kDriveLoad_Transcode,       ///< MediaShrink
+    kDriveLoad_Kinds
+} eDriveLoadKind;
+
+typedef struct
+{
+    unsigned int sessions[kDriveLoad_Kinds];
+    uint32_t     writeKbps;
+    uint32_t     readKbps;
+    uint32_t     loadKbps;      ///< transfer and seek cost
+} tDriveLoad;
+
+typedef struct
+{
+    unsigned int placements;
+    unsigned int moved;         ///< placed away from the preferred drive
+    unsigned int overloaded;    ///< placed on a drive past kDrivePlacementDriveKbps
+    unsigned int noDrive;       ///< nothing mounted, preferred drive taken
+} tDrivePlacementStats;
+
+class DrivePlacement
+{
+public:
+    static DrivePlacement* getInstance(void);
+
+    /// The unit test uses its own placement, the sessions the one of getInstance()
+    explicit DrivePlacement(const char *mountFormat = kDrivePlacementMountFormat);
+    virtual ~DrivePlacement();
+
+    /// Drive for a new session reading readKbps and writing writeKbps.
+    /// preferred is the drive of the platform, -1 when it has none
+    int chooseDrive(eDriveLoadKind kind, uint32_t readKbps, uint32_t writeKbps, int preferred);
+
+    /// A session of kind runs on drive: returns the id to remove() it with,
+    /// 0 when the drive is not known
+    int add(int drive, eDriveLoadKind kind, uint32_t readKbps, uint32_t writeKbps);
+    /// The session of id stopped, 0 is ignored
+    void remove(int id);
+
+    /// Record drive of a file path or URL ("/mnt/dvr1/...", "avfs://mnt/dvr0/..."),
+    /// -1 when it has none
+    static int driveOf(const std::string &path);
+
+    void getLoad(int drive, tDriveLoad *load);
+    void getStats(tDrivePlacementStats *stats);
+    void logLoads(void);
+
+protected:
+    /// True when the drive is mounted on mount, overridden by the unit test
+    virtual bool driveMounted(const char *mount);
+
+private:
+    struct Session
+    {
+        int            drive;
+        eDriveLoadKind kind;
+        uint32_t       readKbps;
+        uint32_t       writeKbps;
+    };
+
+    uint32_t loadLocked(int drive);
+
+    pthread_mutex_t mMutex;
+    std::string     mMountFormat;
+    std::map<int, Session> mSessions;
+    int             mNextId;
+    tDriveLoad      mLoads[kDrivePlacementMaxDrives];
+    tDrivePlacementStats mStats;
+
+    static DrivePlacement *mInstance;
+    static pthread_mutex_t mInstanceMutex;
+
+    DrivePlacement(const DrivePlacement&);
+    DrivePlacement& operator=(const DrivePlacement&);
+};
+
+#endif
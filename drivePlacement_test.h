@@ -0,0 +1,265 @@
+/**
+
+\file drivePlacement_test.h -- contains the cxxtest test cases for the drive placement
+
+The drives are simulated: the test says which ones are mounted, and a day of
+recordings, MRDVR streams and transcodes is played against the placement and
+against the record drive of the platform alone.
+*/
+
+#if !defined(DRIVE_PLACEMENT_TEST_H)
+#define DRIVE_PLACEMENT_TEST_H
+
+#include <cxxtest/TestSuite.h>
+#include <string.h>
+#include <vector>
+
+#include "drivePlacement.h"
+
+class TestDrivePlacement : public DrivePlacement
+{
+public:
+    TestDrivePlacement()
+    {
+        mMounted[0] = true;
+        mMounted[1] = true;
+    }
+
+    bool mMounted[kDrivePlacementMaxDrives];
+
+protected:
+    bool driveMounted(const char *mount)
+    {
+        int drive = DrivePlacement::driveOf(mount);
+        return (drive >= 0) && mMounted[drive];
+    }
+};
+
+class drivePlacementTestSuite : public CxxTest::TestSuite
+{
+    struct SimSession
+    {
+        int end;
+        int id;
+        int drive;
+    };
+
+    struct SimResult
+    {
+        uint32_t peakKbps;
+        int minutesOver;            ///< minutes a drive was past kDrivePlacementDriveKbps
+    };
+
+    static uint32_t simRandom(uint32_t *seed)
+    {
+        *seed = (*seed * 1103515245) + 12345;
+        return (*seed >> 16) & 0x7fff;
+    }
+
+    // A day by the minute, the same sessions whatever the drives.  The
+    // scheduler asks for drive 0; place tells whether the placement is
+    // asked or drive 0 is taken
+    static SimResult simulateDay(TestDrivePlacement &placement, bool place)
+    {
+        std::vector<SimSession> sessions;
+        std::vector<int> recordingDrives;
+        SimResult result;
+        uint32_t seed = 1;
+
+        memset(&result, 0, sizeof(result));
+        for (int t = 0; t < 24 * 60; t++)
+        {
+            for (unsigned int i = 0; i < sessions.size();)
+            {
+                if (sessions[i].end == t)
+                {
+                    placement.remove(sessions[i].id);
+                    sessions.erase(sessions.begin() + i);
+                }
+                else
+                {
+                    i++;
+                }
+            }
+
+            // a recording every 30 minutes on average, up to 3 tuners
+            unsigned int recordings = 0;
+            for (int drive = 0; drive < kDrivePlacementMaxDrives; drive++)
+            {
+                tDriveLoad load;
+                placement.getLoad(drive, &load);
+                recordings += load.sessions[kDriveLoad_Recording];
+            }
+            uint32_t draw = simRandom(&seed);
+            uint32_t duration = 30 + (simRandom(&seed) % 90);
+            if (((draw % 30) == 0) && (recordings < 3))
+            {
+                int drive = place ? placement.chooseDrive(kDriveLoad_Recording, 0, 2 * kDrivePlacementStreamKbps, 0) : 0;
+                SimSession tsb = { (int)(t + duration), placement.add(drive, kDriveLoad_Tsb, 0, kDrivePlacementStreamKbps), drive };
+                SimSession recording = { (int)(t + duration), placement.add(drive, kDriveLoad_Recording, 0, kDrivePlacementStreamKbps), drive };
+                sessions.push_back(tsb);
+                sessions.push_back(recording);
+                recordingDrives.push_back(drive);
+            }
+
+            // MRDVR clients watch the recordings where they are
+            draw = simRandom(&seed);
+            duration = 20 + (simRandom(&seed) % 40);
+            if (((draw % 30) == 0) && !recordingDrives.empty())
+            {
+                int drive = recordingDrives[simRandom(&seed) % recordingDrives.size()];
+                SimSession stream = { (int)(t + duration), placement.add(drive, kDriveLoad_Stream, kDrivePlacementStreamKbps, 0), drive };
+                sessions.push_back(stream);
+            }
+
+            // a transcode every 4 hours for an hour, on the drive of an old recording
+            if (((t % 240) == 0) && !recordingDrives.empty())
+            {
+                int drive = recordingDrives[0];
+                SimSession transcode = { t + 60, placement.add(drive, kDriveLoad_Transcode, 6000, 6000), drive };
+                sessions.push_back(transcode);
+            }
+
+            for (int drive = 0; drive < kDrivePlacementMaxDrives; drive++)
+            {
+                tDriveLoad load;
+                placement.getLoad(drive, &load);
+                if (load.loadKbps > result.peakKbps)
+                {
+                    result.peakKbps = load.loadKbps;
+                }
+                if (load.loadKbps > kDrivePlacementDriveKbps)
+                {
+                    result.minutesOver++;
+                }
+            }
+        }
+
+        for (unsigned int i = 0; i < sessions.size(); i++)
+        {
+            placement.remove(sessions[i].id);
+        }
+        return result;
+    }
+
+public:
+
+    void testDriveOf()
+    {
+        TS_ASSERT_EQUALS(DrivePlacement::driveOf("/mnt/dvr1/dvr002"), 1);
+        TS_ASSERT_EQUALS(DrivePlacement::driveOf("avfs://mnt/dvr0/J07IJ0gG"), 0);
+        TS_ASSERT_EQUALS(DrivePlacement::driveOf("/mnt/dvr7/x"), -1);
+        TS_ASSERT_EQUALS(DrivePlacement::driveOf("sadvr://J07IJ0gG"), -1);
+        TS_ASSERT_EQUALS(DrivePlacement::driveOf("/mnt/dvr"), -1);
+    }
+
+    void testLoadCounters()
+    {
+        TestDrivePlacement placement;
+        tDriveLoad load;
+
+        int tsb = placement.add(1, kDriveLoad_Tsb, 0, 17000);
+        int stream = placement.add(1, kDriveLoad_Stream, 17000, 0);
+        int transcode = placement.add(1, kDriveLoad_Transcode, 6000, 6000);
+        TS_ASSERT(tsb != 0);
+        TS_ASSERT_EQUALS(placement.add(-1, kDriveLoad_Stream, 17000, 0), 0);
+
+        placement.getLoad(1, &load);
+        TS_ASSERT_EQUALS(load.sessions[kDriveLoad_Tsb], 1u);
+        TS_ASSERT_EQUALS(load.sessions[kDriveLoad_Stream], 1u);
+        TS_ASSERT_EQUALS(load.sessions[kDriveLoad_Transcode], 1u);
+        TS_ASSERT_EQUALS(load.writeKbps, 23000u);
+        TS_ASSERT_EQUALS(load.readKbps, 23000u);
+        TS_ASSERT_EQUALS(load.loadKbps, 46000u + (3 * kDrivePlacementSeekKbps));
+
+        placement.remove(tsb);
+        placement.remove(stream);
+        placement.remove(transcode);
+        placement.remove(0);
+        placement.getLoad(1, &load);
+        TS_ASSERT_EQUALS(load.loadKbps, 0u);
+        TS_ASSERT_EQUALS(load.sessions[kDriveLoad_Tsb], 0u);
+    }
+
+    void testSpreadAndPreferred()
+    {
+        TestDrivePlacement placement;
+        tDrivePlacementStats stats;
+
+        // nothing running: the drive of the platform
+        TS_ASSERT_EQUALS(placement.chooseDrive(kDriveLoad_Tsb, 0, 17000, 1), 1);
+        int tsb1 = placement.add(1, kDriveLoad_Tsb, 0, 17000);
+
+        // a second TSB goes to the idle drive
+        TS_ASSERT_EQUALS(placement.chooseDrive(kDriveLoad_Tsb, 0, 17000, 1), 0);
+        int tsb0 = placement.add(0, kDriveLoad_Tsb, 0, 17000);
+
+        // a transcode more is within the margin
+        int transcode = placement.add(1, kDriveLoad_Transcode, 2000, 2000);
+        TS_ASSERT_EQUALS(placement.chooseDrive(kDriveLoad_Tsb, 0, 17000, 1), 1);
+
+        // the streams of drive 0 push the recording to drive 1
+        int stream1 = placement.add(0, kDriveLoad_Stream, 17000, 0);
+        int stream2 = placement.add(0, kDriveLoad_Stream, 17000, 0);
+        TS_ASSERT_EQUALS(placement.chooseDrive(kDriveLoad_Recording, 0, 34000, 0), 1);
+
+        placement.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.placements, 4u);
+        TS_ASSERT_EQUALS(stats.moved, 2u);
+        TS_ASSERT_EQUALS(stats.overloaded, 0u);
+        placement.remove(tsb1);
+        placement.remove(tsb0);
+        placement.remove(transcode);
+        placement.remove(stream1);
+        placement.remove(stream2);
+    }
+
+    void testMountedDrivesOnly()
+    {
+        TestDrivePlacement placement;
+        tDrivePlacementStats stats;
+        std::vector<int> ids;
+
+        placement.mMounted[1] = false;
+        for (int i = 0; i < 5; i++)
+        {
+            int drive = placement.chooseDrive(kDriveLoad_Tsb, 0, 17000, 1);
+            TS_ASSERT_EQUALS(drive, 0);
+            ids.push_back(placement.add(drive, kDriveLoad_Tsb, 0, 17000));
+        }
+
+        placement.mMounted[0] = false;
+        TS_ASSERT_EQUALS(placement.chooseDrive(kDriveLoad_Tsb, 0, 17000, 1), 1);
+        TS_ASSERT_EQUALS(placement.chooseDrive(kDriveLoad_Tsb, 0, 17000, -1), 0);
+
+        placement.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.noDrive, 2u);
+        // the fifth TSB takes drive 0 to 105000 kbps, past what it sustains, and a sixth further
+        TS_ASSERT_EQUALS(stats.overloaded, 2u);
+        for (unsigned int i = 0; i < ids.size(); i++)
+        {
+            placement.remove(ids[i]);
+        }
+    }
+
+    void testSimulatedDay()
+    {
+        TestDrivePlacement single;
+        TestDrivePlacement placed;
+        tDrivePlacementStats stats;
+
+        SimResult singleResult = simulateDay(single, false);
+        SimResult placedResult = simulateDay(placed, true);
+
+        // the streams follow the recordings and still pile up at times,
+        // but spread the drives are past what they sustain far less often
+        TS_ASSERT(singleResult.minutesOver > 0);
+        TS_ASSERT(placedResult.minutesOver * 2 < singleResult.minutesOver);
+        TS_ASSERT(placedResult.peakKbps < singleResult.peakKbps);
+
+        placed.getStats(&stats);
+        TS_ASSERT(stats.moved > 0);
+    }
+};
+
+#endif
@@ -0,0 +1,513 @@
+/** @file dsmccCodec.cpp
+ *
+ * @brief Table driven DSM-CC codec working in place on the message buffer.
+ */
+
+#include "dlog.h"
+#include "dsmccCodec.h"
+
+#define DSMCC_CONFIRM_FIXED_SIZE   (DSMCC_SESSIONID_LEN + 2 + DSMCC_SERVERID_LEN + 2)
+
+#define DSMCC_FIELD(T, member)  { sizeof(((T *) 0)->member), offsetof(T, member) }
+
+const tDsmccField DsmccSchema<tDsmccMpegProgram>::Fields[] =
+{
+    DSMCC_FIELD(tDsmccMpegProgram, programNumberType),
+    DSMCC_FIELD(tDsmccMpegProgram, programNumber),
+    DSMCC_FIELD(tDsmccMpegProgram, pmtPidType),
+    DSMCC_FIELD(tDsmccMpegProgram, pmtPid),
+    DSMCC_FIELD(tDsmccMpegProgram, caPid),
+    DSMCC_FIELD(tDsmccMpegProgram, esCount),
+    DSMCC_FIELD(tDsmccMpegProgram, pcrPidType),
+    DSMCC_FIELD(tDsmccMpegProgram, pcrPid)
+};
+const ui32 DsmccSchema<tDsmccMpegProgram>::FieldCount = 8;
+const ui32 DsmccSchema<tDsmccMpegProgram>::WireSize = MPEG_DESC_SIZE;
+
+const tDsmccField DsmccSchema<tDsmccPhysicalChannel>::Fields[] =
+{
+    DSMCC_FIELD(tDsmccPhysicalChannel, channelIdType),
+    DSMCC_FIELD(tDsmccPhysicalChannel, channelId),
+    DSMCC_FIELD(tDsmccPhysicalChannel, direction)
+};
+const ui32 DsmccSchema<tDsmccPhysicalChannel>::FieldCount = 3;
+const ui32 DsmccSchema<tDsmccPhysicalChannel>::WireSize = PHY_CHANNEL_DESC_SIZE;
+
+const tDsmccField DsmccSchema<tDsmccDownstreamTransport>::Fields[] =
+{
+    DSMCC_FIELD(tDsmccDownstreamTransport, bandwidthType),
+    DSMCC_FIELD(tDsmccDownstreamTransport, bandwidth),
+    DSMCC_FIELD(tDsmccDownstreamTransport, transportIdType),
+    DSMCC_FIELD(tDsmccDownstreamTransport, transportId)
+};
+const ui32 DsmccSchema<tDsmccDownstreamTransport>::FieldCount = 4;
+const ui32 DsmccSchema<tDsmccDownstreamTransport>::WireSize = DSTSSTREAM_DESC_SIZE;
+
+const tDsmccField DsmccSchema<tDsmccAtscModulation>::Fields[] =
+{
+    DSMCC_FIELD(tDsmccAtscModulation, transmissionSystem),
+    DSMCC_FIELD(tDsmccAtscModulation, innerCodingMode),
+    DSMCC_FIELD(tDsmccAtscModulation, splitBitstreamMode),
+    DSMCC_FIELD(tDsmccAtscModulation, modulationFormat),
+    DSMCC_FIELD(tDsmccAtscModulation, symbolRate),
+    DSMCC_FIELD(tDsmccAtscModulation, reserved),
+    DSMCC_FIELD(tDsmccAtscModulation, interleaveDepth),
+    DSMCC_FIELD(tDsmccAtscModulation, modulationMode),
+    DSMCC_FIELD(tDsmccAtscModulation, forwardErrorCorrection)
+};
+const ui32 DsmccSchema<tDsmccAtscModulation>::FieldCount = 9;
+const ui32 DsmccSchema<tDsmccAtscModulation>::WireSize = ATSCMODULATION_DESC_SIZE;
+
+const tDsmccField DsmccSchema<tDsmccClientCa>::Fields[] =
+{
+    DSMCC_FIELD(tDsmccClientCa, caSystemId),
+    DSMCC_FIELD(tDsmccClientCa, caInfoLength)
+};
+const ui32 DsmccSchema<tDsmccClientCa>::FieldCount = 2;
+const ui32 DsmccSchema<tDsmccClientCa>::WireSize = CA_DESC_SIZE;
+
+const tDsmccField DsmccSchema<tDsmccIpDesc>::Fields[] =
+{
+    DSMCC_FIELD(tDsmccIpDesc, port),
+    DSMCC_FIELD(tDsmccIpDesc, address)
+};
+const ui32 DsmccSchema<tDsmccIpDesc>::FieldCount = 2;
+const ui32 DsmccSchema<tDsmccIpDesc>::WireSize = IP_PORT_SIZE;
+
+const tDsmccField DsmccSchema<tDsmccU32Desc>::Fields[] =
+{
+    DSMCC_FIELD(tDsmccU32Desc, value)
+};
+const ui32 DsmccSchema<tDsmccU32Desc>::FieldCount = 1;
+const ui32 DsmccSchema<tDsmccU32Desc>::WireSize = SIZE_FOUR_BYTE;
+
+namespace
+{
+
+bool parseDescriptors(ByteReader &reader, ui8 count, tDsmccDescriptorList *list)
+{
+    if (count > DSMCC_CODEC_MAX_DESCRIPTORS)
+    {
+        dlog(DL_MSP_ONDEMAND, DLOGL_ERROR, "%s: %u descriptors, %u supported", __FUNCTION__, count, DSMCC_CODEC_MAX_DESCRIPTORS);
+        return false;
+    }
+    list->count = count;
+    for (ui32 i = 0; i < count; i++)
+    {
+        tDsmccDescriptorView *desc = &list->desc[i];
+        desc->tag = reader.get1();
+        desc->len = reader.get1();
+        desc->value = reader.view(desc->len);
+    }
+    return reader.ok();
+}
+
+bool parsePrivateData(const ui8 *data, ui32 length, tDsmccPrivateDataView *pd)
+{
+    ByteReader reader(data, length);
+
+    memset(pd, 0, sizeof(*pd));
+    pd->list.protocolId = reader.get1();
+    pd->list.version = reader.get1();
+    if (pd->list.protocolId == SSP_PROTOCOL_ID_2)
+    {
+        if (pd->list.version != SSP_VERSION_1)
+        {
+            dlog(DL_MSP_ONDEMAND, DLOGL_ERROR, "%s: unsupported SSP 2 version %d", __FUNCTION__, pd->list.version);
+            return false;
+        }
+        pd->serviceGateway = reader.view(SERVICE_GW_SIZE);
+        pd->serviceGatewayDataLength = reader.get4();
+        pd->service = reader.view(SERVICE_SIZE);
+        pd->serviceDataLength = reader.get4();
+    }
+    else if (pd->list.protocolId != SSP_PROTOCOL_ID_1)
+    {
+        dlog(DL_MSP_ONDEMAND, DLOGL_ERROR, "%s: unsupported SSP protocol %d", __FUNCTION__, pd->list.protocolId);
+        return false;
+    }
+
+    if (!parseDescriptors(reader, reader.get1(), &pd->list))
+    {
+        return false;
+    }
+    pd->padLength = reader.left();
+    pd->pad = reader.view(pd->padLength);
+    return reader.ok();
+}
+
+void encodeDescriptors(ByteWriter &writer, const tDsmccDescriptorList *list)
+{
+    writer.put1(list->count);
+    for (ui32 i = 0; (i < list->count) && (i < DSMCC_CODEC_MAX_DESCRIPTORS); i++)
+    {
+        writer.put1(list->desc[i].tag);
+        writer.put1(list->desc[i].len);
+        writer.putBytes(list->desc[i].value, list->desc[i].len);
+    }
+}
+
+void encodePrivateData(ByteWriter &writer, const tDsmccPrivateDataView *pd)
+{
+    writer.put1(pd->list.protocolId);
+    writer.put1(pd->list.version);
+    if (pd->list.protocolId == SSP_PROTOCOL_ID_2)
+    {
+        writer.putBytes(pd->serviceGateway, SERVICE_GW_SIZE);
+        writer.put4(pd->serviceGatewayDataLength);
+        writer.putBytes(pd->service, SERVICE_SIZE);
+        writer.put4(pd->serviceDataLength);
+    }
+    encodeDescriptors(writer, &pd->list);
+    writer.putBytes(pd->pad, pd->padLength);
+}
+
+// user data with an empty user user data unless given, privateDataCount is filled in once the private data is written
+void encodeUserData(ByteWriter &writer, const ui8 *uuData, ui16 uuDataCount, const tDsmccPrivateDataView *pd, bool hasPrivateData)
+{
+    writer.put2(uuDataCount);
+    writer.putBytes(uuData, uuDataCount);
+
+    ui8 *count = writer.pos();
+    writer.put2(0);
+    if (hasPrivateData)
+    {
+        ui8 *start = writer.pos();
+        encodePrivateData(writer, pd);
+        if (writer.ok())
+        {
+            Utils::Put2Byte(count, writer.pos() - start);
+        }
+    }
+}
+
+void encodeHeader(ui8 *buf, ui8 protocolDiscriminator, ui8 dsmccType, ui16 messageId, ui32 transactionId,
+                  ui8 adaptationLength, ui16 messageLength)
+{
+    DsmccHeaderLayout::ProtocolDiscriminator::put(buf, protocolDiscriminator);
+    DsmccHeaderLayout::DsmccType::put(buf, dsmccType);
+    DsmccHeaderLayout::MessageId::put(buf, messageId);
+    DsmccHeaderLayout::TransactionId::put(buf, transactionId);
+    DsmccHeaderLayout::Reserved::put(buf, 0xff);
+    DsmccHeaderLayout::AdaptationLength::put(buf, adaptationLength);
+    DsmccHeaderLayout::MessageLength::put(buf, messageLength);
+}
+
+}
+
+bool VodDsmcc_Codec::decodeFields(const tDsmccField *fields, ui32 count, ui32 wireSize, const ui8 *data, ui32 length, void *out)
+{
+    if (!data || (length < wireSize))
+    {
+        return false;
+    }
+
+    ui8 *base = (ui8 *) out;
+    for (ui32 i = 0; i < count; i++)
+    {
+        switch (fields[i].size)
+        {
+        case 1:
+            *(ui8 *)(base + fields[i].offset) = data[0];
+            break;
+        case 2:
+            *(ui16 *)(base + fields[i].offset) = Utils::Load2Byte(data);
+            break;
+        default:
+            *(ui32 *)(base + fields[i].offset) = Utils::Load4Byte(data);
+            break;
+        }
+        data += fields[i].size;
+    }
+    return true;
+}
+
+ui32 VodDsmcc_Codec::encodeFields(const tDsmccField *fields, ui32 count, ui32 wireSize, const void *in, ui8 *buf, ui32 size)
+{
+    if (!buf || (size < wireSize))
+    {
+        return 0;
+    }
+
+    const ui8 *base = (const ui8 *) in;
+    ui8 *pos = buf;
+    for (ui32 i = 0; i < count; i++)
+    {
+        switch (fields[i].size)
+        {
+        case 1:
+            Utils::Store1Byte(pos, *(const ui8 *)(base + fields[i].offset));
+            break;
+        case 2:
+            Utils::Store2Byte(pos, *(const ui16 *)(base + fields[i].offset));
+            break;
+        default:
+            Utils::Store4Byte(pos, *(const ui32 *)(base + fields[i].offset));
+            break;
+        }
+        pos += fields[i].size;
+    }
+    return pos - buf;
+}
+
+ui32 VodDsmcc_Codec::resourceWireSize(ui16 type)
+{
+    switch (type)
+    {
+    case DSMCC_RESDESC_MPEGPROG:
+        return DsmccSchema<tDsmccMpegProgram>::WireSize;
+    case DSMCC_RESDESC_PHYSICALCHAN:
+        return DsmccSchema<tDsmccPhysicalChannel>::WireSize;
+    case DSMCC_RESDESC_DOWNSTREAMTRANS:
+        return DsmccSchema<tDsmccDownstreamTransport>::WireSize;
+    case DSMCC_RESDESC_ATSCMODMODE:
+        return DsmccSchema<tDsmccAtscModulation>::WireSize;
+    default:
+        return 0;
+    }
+}
+
+bool VodDsmcc_Codec::parseHeader(const ui8 *data, ui32 length, tDsmccHeader *header)
+{
+    ByteReader reader(data, length);
+    const ui8 *hdr = reader.fixed<DsmccHeaderLayout>();
+    if (!hdr)
+    {
+        dlog(DL_MSP_ONDEMAND, DLOGL_ERROR, "%s: bad DSMCC message length %u", __FUNCTION__, length);
+        return false;
+    }
+
+    header->protocolDiscriminator = DsmccHeaderLayout::ProtocolDiscriminator::get(hdr);
+    header->dsmccType = DsmccHeaderLayout::DsmccType::get(hdr);
+    header->messageId = DsmccHeaderLayout::MessageId::get(hdr);
+    header->transactionId = DsmccHeaderLayout::TransactionId::get(hdr);
+    header->adaptationLength = DsmccHeaderLayout::AdaptationLength::get(hdr);
+    header->messageLength = DsmccHeaderLayout::MessageLength::get(hdr);
+
+    if ((length != (ui32) header->messageLength + DSMCC_MSG_HEADER_SIZE) ||
+            (header->adaptationLength > header->messageLength))
+    {
+        dlog(DL_MSP_ONDEMAND, DLOGL_ERROR, "%s: bad DSMCC message length %u", __FUNCTION__, length);
+        return false;
+    }
+    return true;
+}
+
+bool VodDsmcc_Codec::parseSessionConfirm(const ui8 *data, ui32 length, tDsmccSessionConfirmView *view)
+{
+    if (!data || !view || !parseHeader(data, length, &view->header))
+    {
+        return false;
+    }
+
+    ByteReader reader(data + DSMCC_MSG_HEADER_SIZE, view->header.messageLength);
+    view->adaptation = reader.view(view->header.adaptationLength);
+    if (reader.left() < DSMCC_CONFIRM_FIXED_SIZE)
+    {
+        dlog(DL_MSP_ONDEMAND, DLOGL_ERROR, "%s: message too short", __FUNCTION__);
+        return false;
+    }
+
+    view->sessionId = reader.view(DSMCC_SESSIONID_LEN);
+    view->response = reader.get2();
+    view->serverId = reader.view(DSMCC_SERVERID_LEN);
+    view->resourceCount = reader.get2();
+    if (view->resourceCount > DSMCC_CODEC_MAX_RESOURCES)
+    {
+        dlog(DL_MSP_ONDEMAND, DLOGL_ERROR, "%s: %u resources, %u supported", __FUNCTION__, view->resourceCount, DSMCC_CODEC_MAX_RESOURCES);
+        return false;
+    }
+
+    for (ui32 i = 0; (i < view->resourceCount) && reader.ok(); i++)
+    {
+        tDsmccResourceView *res = &view->resources[i];
+        res->requestId = reader.get2();
+        res->type = reader.get2();
+        res->num = reader.get2();
+        res->associationTag = reader.get2();
+        res->flags = reader.get1();
+        res->status = reader.get1();
+        res->length = reader.get2();
+        res->dataFieldCount = reader.get2();
+
+        // known types are as long as their fields, others as resourceLength says after the data field count
+        res->dataLength = resourceWireSize(res->type);
+        if (res->type == DSMCC_RESDESC_CLIENTCA)
+        {
+            const ui8 *ca = reader.pos();
+            res->dataLength = (reader.left() >= CA_DESC_SIZE) ? (CA_DESC_SIZE + ((ca[4] << 8) | ca[5])) : CA_DESC_SIZE;
+        }
+        else if (res->dataLength == 0)
+        {
+            res->dataLength = (res->length > 2) ? (res->length - 2) : 0;
+        }
+        res->data = reader.view(res->dataLength);
+    }
+
+    view->uuData = NULL;
+    view->uuDataCount = 0;
+    view->privateDataCount = 0;
+    memset(&view->privateData, 0, sizeof(view->privateData));
+    if (reader.ok() && reader.left())
+    {
+        view->uuDataCount = reader.get2();
+        view->uuData = reader.view(view->uuDataCount);
+        view->privateDataCount = reader.get2();
+        const ui8 *privateData = reader.view(view->privateDataCount);
+        if (privateData && view->privateDataCount &&
+                !parsePrivateData(privateData, view->privateDataCount, &view->privateData))
+        {
+            return false;
+        }
+    }
+
+    if (!reader.ok() || reader.left())
+    {
+        dlog(DL_MSP_ONDEMAND, DLOGL_ERROR, "%s: malformed message, %u bytes left", __FUNCTION__, reader.left());
+        return false;
+    }
+    return true;
+}
+
+bool VodDsmcc_Codec::parseDescriptorList(const tDsmccDescriptorView *desc, tDsmccDescriptorList *list)
+{
+    if (!desc || !desc->value || !list)
+    {
+        return false;
+    }
+
+    ByteReader reader(desc->value, desc->len);
+    list->protocolId = reader.get1();
+    list->version = reader.get1();
+    return parseDescriptors(reader, reader.get1(), list);
+}
+
+const tDsmccResourceView* VodDsmcc_Codec::findResource(const tDsmccSessionConfirmView *view, ui16 type)
+{
+    for (ui32 i = 0; (i < view->resourceCount) && (i < DSMCC_CODEC_MAX_RESOURCES); i++)
+    {
+        if (view->resources[i].type == type)
+        {
+            return &view->resources[i];
+        }
+    }
+    return NULL;
+}
+
+const tDsmccDescriptorView* VodDsmcc_Codec::findDescriptor(const tDsmccDescriptorList *list, ui8 tag)
+{
+    for (ui32 i = 0; (i < list->count) && (i < DSMCC_CODEC_MAX_DESCRIPTORS); i++)
+    {
+        if (list->desc[i].tag == tag)
+        {
+            return &list->desc[i];
+        }
+    }
+    return NULL;
+}
+
+const ui8* VodDsmcc_Codec::clientCaInfo(const tDsmccResourceView *res, tDsmccClientCa *ca)
+{
+    if (!decode(res, ca) || (res->dataLength < (ui32) CA_DESC_SIZE + ca->caInfoLength))
+    {
+        return NULL;
+    }
+    return res->data + CA_DESC_SIZE;
+}
+
+ui32 VodDsmcc_Codec::encodeSessionConfirm(const tDsmccSessionConfirmView *view, ui8 *buf, ui32 size)
+{
+    ByteWriter writer(buf, size);
+    const tDsmccHeader &header = view->header;
+
+    writer.putBytes(NULL, DSMCC_MSG_HEADER_SIZE);
+    writer.putBytes(view->adaptation, header.adaptationLength);
+    writer.putBytes(view->sessionId, DSMCC_SESSIONID_LEN);
+    writer.put2(view->response);
+    writer.putBytes(view->serverId, DSMCC_SERVERID_LEN);
+    writer.put2(view->resourceCount);
+    for (ui32 i = 0; (i < view->resourceCount) && (i < DSMCC_CODEC_MAX_RESOURCES); i++)
+    {
+        const tDsmccResourceView *res = &view->resources[i];
+        writer.put2(res->requestId);
+        writer.put2(res->type);
+        writer.put2(res->num);
+        writer.put2(res->associationTag);
+        writer.put1(res->flags);
+        writer.put1(res->status);
+        writer.put2(res->length);
+        writer.put2(res->dataFieldCount);
+        writer.putBytes(res->data, res->dataLength);
+    }
+    if (view->uuDataCount || view->privateDataCount)
+    {
+        encodeUserData(writer, view->uuData, view->uuDataCount, &view->privateData, (view->privateDataCount != 0));
+    }
+
+    if (!writer.ok() || (writer.written() - DSMCC_MSG_HEADER_SIZE > 0xFFFF))
+    {
+        return 0;
+    }
+    encodeHeader(buf, header.protocolDiscriminator, header.dsmccType, header.messageId, header.transactionId,
+                 header.adaptationLength, writer.written() - DSMCC_MSG_HEADER_SIZE);
+    return writer.written();
+}
+
+ui32 VodDsmcc_Codec::encodeSessionSetup(const tDsmccSessionSetup *setup, ui8 *buf, ui32 size)
+{
+    ByteWriter writer(buf, size);
+
+    writer.putBytes(NULL, DSMCC_MSG_HEADER_SIZE);
+    writer.putBytes(setup->sessionId, DSMCC_SESSIONID_LEN);
+    writer.put2(0xFFFF);
+    writer.putBytes(setup->clientId, DSMCC_CLIENTID_LEN);
+    writer.putBytes(setup->serverId, DSMCC_SERVERID_LEN);
+    encodeUserData(writer, NULL, 0, &setup->privateData, true);
+
+    if (!writer.ok() || (writer.written() - DSMCC_MSG_HEADER_SIZE > 0xFFFF))
+    {
+        return 0;
+    }
+    encodeHeader(buf, 0x11, DSMCC_SESSMSG_TYPE, dsmcc_ClientSessionSetUpRequest, setup->transactionId,
+                 0, writer.written() - DSMCC_MSG_HEADER_SIZE);
+    return writer.written();
+}
+
+ui32 VodDsmcc_Codec::encodeDescriptorList(const tDsmccDescriptorList *list, ui8 *buf, ui32 size)
+{
+    ByteWriter writer(buf, size);
+
+    writer.put1(list->protocolId);
+    writer.put1(list->version);
+    encodeDescriptors(writer, list);
+    return writer.written();
+}
+
+VodDsmcc_CodecSessionConfirm::VodDsmcc_CodecSessionConfirm()
+{
+    memset(&mView, 0, sizeof(mView));
+}
+
+status VodDsmcc_CodecSessionConfirm::ParseDsmccMessageBody(ui8 * data, ui32 length)
+{
+    ui8 *body;
+    ui32 bodyLength;
+
+    // the header fields of VodDsmcc_Base
+    if (ParseDsmccMessageHdr(data, length, &body, &bodyLength) != E_TRUE)
+    {
+        return E_FALSE;
+    }
+
+    mMessage.assign(data, data + length);
+    if (!VodDsmcc_Codec::parseSessionConfirm(&mMessage[0], length, &mView))
+    {
+        memset(&mView, 0, sizeof(mView));
+        return E_FALSE;
+    }
+
+    SetSessionId(VodDsmcc_SessionId((ui8 *) mView.sessionId));
+    SetResponse(mView.response);
+    SetServerId((ui8 *) mView.serverId);
+    return E_TRUE;
+}
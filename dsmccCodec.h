@@ -0,0 +1,264 @@
+/** @file dsmccCodec.h
+ *
+ * @brief Table driven DSM-CC codec working in place on the message buffer.
+ *
+ * VodDsmcc_Codec parses a ClientSessionSetUpConfirm in one pass over the
+ * receive buffer into a tDsmccSessionConfirmView: fixed size arrays of
+ * resource and descriptor views pointing into that buffer, with no object
+ * or heap allocation per field.  The type specific fields of a resource or
+ * descriptor are decoded on demand through a field table (DsmccSchema<T>),
+ * the same table encodes them again.
+ *
+ * Encoding writes into a buffer owned by the caller and returns the number
+ * of bytes written, 0 when the buffer is too small.
+ *
+ * The views point into the message: the message buffer must outlive them.
+ * VodDsmcc_CodecSessionConfirm is the confirm handed to the session
+ * controls: it keeps one copy of the message for its view, as the receive
+ * buffer is reused before the session handles the confirm.
+ */
+
+#ifndef _DSMCC_CODEC_H_
+#define _DSMCC_CODEC_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+#include "dsmccProtocol.h"
+
+#define DSMCC_CODEC_MAX_RESOURCES     16
+#define DSMCC_CODEC_MAX_DESCRIPTORS   32
+
+// DSM-CC message header
+typedef struct
+{
+    ui8  protocolDiscriminator;
+    ui8  dsmccType;
+    ui16 messageId;
+    ui32 transactionId;
+    ui8  adaptationLength;
+    ui16 messageLength;        // bytes after the header, adaptation header included
+} tDsmccHeader;
+
+// resource descriptor: common header and a view of its type specific fields
+typedef struct
+{
+    ui16 requestId;
+    ui16 type;                 // DSMCC_RESDESC_*
+    ui16 num;
+    ui16 associationTag;
+    ui8  flags;
+    ui8  status;
+    ui16 length;
+    ui16 dataFieldCount;
+    const ui8 *data;
+    ui32 dataLength;
+} tDsmccResourceView;
+
+// tag/length/value descriptor of the user data
+typedef struct
+{
+    ui8 tag;
+    ui8 len;
+    const ui8 *value;
+} tDsmccDescriptorView;
+
+// protocol id, version and descriptors, as in the user data and in APPREQ/APPRES/VENREQ values
+typedef struct
+{
+    ui8 protocolId;
+    ui8 version;
+    ui8 count;
+    tDsmccDescriptorView desc[DSMCC_CODEC_MAX_DESCRIPTORS];
+} tDsmccDescriptorList;
+
+// user private data, SSP 1 or SSP 2 version 1
+typedef struct
+{
+    tDsmccDescriptorList list;
+    const ui8 *serviceGateway;         // SSP 2 only
+    ui32 serviceGatewayDataLength;
+    const ui8 *service;
+    ui32 serviceDataLength;
+    const ui8 *pad;                    // bytes after the descriptors, up to privateDataCount
+    ui32 padLength;
+} tDsmccPrivateDataView;
+
+typedef struct
+{
+    tDsmccHeader header;
+    const ui8 *adaptation;             // header.adaptationLength bytes
+    const ui8 *sessionId;              // DSMCC_SESSIONID_LEN bytes
+    ui16 response;
+    const ui8 *serverId;               // DSMCC_SERVERID_LEN bytes
+    ui16 resourceCount;
+    tDsmccResourceView resources[DSMCC_CODEC_MAX_RESOURCES];
+    const ui8 *uuData;                 // user user data, not interpreted
+    ui16 uuDataCount;
+    ui16 privateDataCount;             // 0 when there is no private data
+    tDsmccPrivateDataView privateData;
+} tDsmccSessionConfirmView;
+
+// ClientSessionSetUpRequest, the identifiers are DSMCC_*_LEN bytes each
+typedef struct
+{
+    ui32 transactionId;
+    const ui8 *sessionId;
+    const ui8 *clientId;
+    const ui8 *serverId;
+    tDsmccPrivateDataView privateData;
+} tDsmccSessionSetup;
+
+// type specific fields, decoded through DsmccSchema<T>
+typedef struct
+{
+    ui16 programNumberType;
+    ui16 programNumber;
+    ui16 pmtPidType;
+    ui16 pmtPid;
+    ui16 caPid;
+    ui16 esCount;
+    ui16 pcrPidType;
+    ui16 pcrPid;
+} tDsmccMpegProgram;
+
+typedef struct
+{
+    ui16 channelIdType;
+    ui32 channelId;            // frequency
+    ui16 direction;
+} tDsmccPhysicalChannel;
+
+typedef struct
+{
+    ui16 bandwidthType;
+    ui32 bandwidth;
+    ui16 transportIdType;
+    ui32 transportId;
+} tDsmccDownstreamTransport;
+
+typedef struct
+{
+    ui8  transmissionSystem;
+    ui8  innerCodingMode;
+    ui8  splitBitstreamMode;
+    ui8  modulationFormat;
+    ui32 symbolRate;
+    ui8  reserved;
+    ui8  interleaveDepth;
+    ui8  modulationMode;
+    ui8  forwardErrorCorrection;
+} tDsmccAtscModulation;
+
+// header of the client CA resource, caInfoLength bytes of CA info follow it
+typedef struct
+{
+    ui32 caSystemId;
+    ui16 caInfoLength;
+} tDsmccClientCa;
+
+typedef struct
+{
+    ui16 port;
+    ui32 address;
+} tDsmccIpDesc;
+
+// stream handle, keep alive and other 4 byte values
+typedef struct
+{
+    ui32 value;
+} tDsmccU32Desc;
+
+// one field of a schema: size on the wire (1, 2 or 4) and offset in the struct
+typedef struct
+{
+    ui8  size;
+    ui16 offset;
+} tDsmccField;
+
+// field table of T, specialized for each of the structs above
+template <class T> struct DsmccSchema;
+
+#define DSMCC_DECLARE_SCHEMA(T) \
+    template <> struct DsmccSchema<T> \
+    { \
+        static const tDsmccField Fields[]; \
+        static const ui32 FieldCount; \
+        static const ui32 WireSize; \
+    }
+
+DSMCC_DECLARE_SCHEMA(tDsmccMpegProgram);
+DSMCC_DECLARE_SCHEMA(tDsmccPhysicalChannel);
+DSMCC_DECLARE_SCHEMA(tDsmccDownstreamTransport);
+DSMCC_DECLARE_SCHEMA(tDsmccAtscModulation);
+DSMCC_DECLARE_SCHEMA(tDsmccClientCa);
+DSMCC_DECLARE_SCHEMA(tDsmccIpDesc);
+DSMCC_DECLARE_SCHEMA(tDsmccU32Desc);
+
+class VodDsmcc_Codec
+{
+public:
+    static bool parseHeader(const ui8 *data, ui32 length, tDsmccHeader *header);
+    static bool parseSessionConfirm(const ui8 *data, ui32 length, tDsmccSessionConfirmView *view);
+    // descriptors nested in an APPREQ, APPRES or VENREQ value
+    static bool parseDescriptorList(const tDsmccDescriptorView *desc, tDsmccDescriptorList *list);
+
+    static const tDsmccResourceView* findResource(const tDsmccSessionConfirmView *view, ui16 type);
+    static const tDsmccDescriptorView* findDescriptor(const tDsmccDescriptorList *list, ui8 tag);
+    // CA info of a client CA resource, caInfoLength bytes, NULL when the resource is short
+    static const ui8* clientCaInfo(const tDsmccResourceView *res, tDsmccClientCa *ca);
+
+    static ui32 encodeSessionConfirm(const tDsmccSessionConfirmView *view, ui8 *buf, ui32 size);
+    static ui32 encodeSessionSetup(const tDsmccSessionSetup *setup, ui8 *buf, ui32 size);
+    // protocol id, version, count and descriptors, the value of an APPREQ/APPRES/VENREQ descriptor
+    static ui32 encodeDescriptorList(const tDsmccDescriptorList *list, ui8 *buf, ui32 size);
+
+    // type specific fields of a resource or descriptor
+    template <class T> static bool decode(const ui8 *data, ui32 length, T *out)
+    {
+        return decodeFields(DsmccSchema<T>::Fields, DsmccSchema<T>::FieldCount, DsmccSchema<T>::WireSize, data, length, out);
+    }
+    template <class T> static bool decode(const tDsmccResourceView *res, T *out)
+    {
+        return res && decode(res->data, res->dataLength, out);
+    }
+    template <class T> static bool decode(const tDsmccDescriptorView *desc, T *out)
+    {
+        return desc && decode(desc->value, desc->len, out);
+    }
+    template <class T> static ui32 encode(const T *in, ui8 *buf, ui32 size)
+    {
+        return encodeFields(DsmccSchema<T>::Fields, DsmccSchema<T>::FieldCount, DsmccSchema<T>::WireSize, in, buf, size);
+    }
+
+    // wire size of the type specific fields of a resource type, 0 when it is not known
+    static ui32 resourceWireSize(ui16 type);
+
+private:
+    static bool decodeFields(const tDsmccField *fields, ui32 count, ui32 wireSize, const ui8 *data, ui32 length, void *out);
+    static ui32 encodeFields(const tDsmccField *fields, ui32 count, ui32 wireSize, const void *in, ui8 *buf, ui32 size);
+};
+
+// ClientSessionSetUpConfirm parsed by the codec, session id and response are
+// set as the class parser sets them; GetResources() and GetUserData() are empty
+class VodDsmcc_CodecSessionConfirm: public VodDsmcc_ClientSessionConfirm
+{
+public:
+    VodDsmcc_CodecSessionConfirm();
+    status ParseDsmccMessageBody(ui8 * data, ui32 length);
+
+    const tDsmccSessionConfirmView* GetView()
+    {
+        return &mView;
+    }
+
+private:
+    // the view points into mMessage
+    VodDsmcc_CodecSessionConfirm(const VodDsmcc_CodecSessionConfirm&);
+    VodDsmcc_CodecSessionConfirm& operator=(const VodDsmcc_CodecSessionConfirm&);
+
+    std::vector<ui8> mMessage;
+    tDsmccSessionConfirmView mView;
+};
+
+#endif
@@ -0,0 +1,521 @@
+/** @file dsmccCodec_bench.cpp
+ *
+ * @brief Compares VodDsmcc_Codec with the VodDsmcc_* message classes.
+ *
+ * Two ClientSessionSetUpConfirm messages are built in memory with the layout
+ * the SRMs send: a SeaChange one (MPEG program, physical channel, ATSC
+ * modulation, downstream transport and client CA resources, SSP 1 private
+ * data with IP, stream handle, vendor and application descriptors) and an
+ * Arris one (SSP 2.3 private data behind a service gateway).  For each the
+ * benchmark times:
+ *  - parsing with GetMessageTypeObject()/ParseDsmccMessageBody() and reading
+ *    the tuning and stream server parameters as HandleSessionConfirmResp()
+ *    does, against parseSessionConfirm() and decode<>(),
+ *  - encoding the message back from the view, checked byte for byte,
+ * and it times the ClientSessionSetUpRequest of SeaChange_SessionControl
+ * built with the classes against encodeSessionSetup(), whose output must be
+ * the same.
+ * Build with "make dsmccCodec_bench" and run on the target.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#include "dsmccCodec.h"
+
+#define kBenchIterations   200000
+#define kBenchProgram      0x0003
+#define kBenchFrequency    555000000
+#define kBenchSymbolRate   5360537
+#define kBenchServerIp     0x0A0B0C0D
+#define kBenchServerPort   5540
+
+static double nowSecs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+static void put1(std::vector<ui8> &buf, ui8 n)
+{
+    buf.push_back(n);
+}
+
+static void put2(std::vector<ui8> &buf, ui16 n)
+{
+    buf.push_back(n >> 8);
+    buf.push_back(n);
+}
+
+static void put4(std::vector<ui8> &buf, ui32 n)
+{
+    put2(buf, n >> 16);
+    put2(buf, n);
+}
+
+static void putResource(std::vector<ui8> &buf, ui16 requestId, ui16 type, ui16 fieldCount, const std::vector<ui8> &data)
+{
+    put2(buf, requestId);
+    put2(buf, type);
+    put2(buf, requestId);
+    put2(buf, 0);
+    put1(buf, 0x20);
+    put1(buf, 0x01);
+    put2(buf, data.size() + 2);
+    put2(buf, fieldCount);
+    buf.insert(buf.end(), data.begin(), data.end());
+}
+
+static void putResources(std::vector<ui8> &buf, bool encrypted)
+{
+    std::vector<ui8> data;
+
+    put2(buf, encrypted ? 5 : 4);
+
+    put2(data, 0);
+    put2(data, kBenchProgram);
+    put2(data, 0);
+    put2(data, 0x1E0);
+    put2(data, 0x1FFF);
+    put2(data, 2);
+    put2(data, 0);
+    put2(data, 0x1E1);
+    putResource(buf, 1, DSMCC_RESDESC_MPEGPROG, 5, data);
+
+    data.clear();
+    put2(data, 0);
+    put4(data, kBenchFrequency);
+    put2(data, 0);
+    putResource(buf, 2, DSMCC_RESDESC_PHYSICALCHAN, 2, data);
+
+    data.clear();
+    put1(data, 0x01);
+    put1(data, 0x0F);
+    put1(data, 0x00);
+    put1(data, 0x10);
+    put4(data, kBenchSymbolRate);
+    put1(data, 0);
+    put1(data, 0x05);
+    put1(data, 0x00);
+    put1(data, 0x01);
+    putResource(buf, 3, DSMCC_RESDESC_ATSCMODMODE, 9, data);
+
+    data.clear();
+    put2(data, 0);
+    put4(data, 3750000);
+    put2(data, 0);
+    put4(data, 0x1234);
+    putResource(buf, 4, DSMCC_RESDESC_DOWNSTREAMTRANS, 2, data);
+
+    if (encrypted)
+    {
+        data.clear();
+        put4(data, 0x0E00);
+        put2(data, 64);
+        for (int i = 0; i < 64; i++)
+        {
+            put1(data, i);
+        }
+        putResource(buf, 5, DSMCC_RESDESC_CLIENTCA, 3, data);
+    }
+}
+
+// IP, stream handle, vendor (keep alive) and application response (billing id, time remaining) descriptors
+static void putDescriptors(std::vector<ui8> &buf)
+{
+    put1(buf, 4);
+
+    put1(buf, GENERIC_IPDESC);
+    put1(buf, IP_PORT_SIZE);
+    put2(buf, kBenchServerPort);
+    put4(buf, kBenchServerIp);
+
+    put1(buf, GENERIC_STREAMHANDLE);
+    put1(buf, 4);
+    put4(buf, 0x00012345);
+
+    put1(buf, GENERIC_VENREQ);
+    put1(buf, 3 + 2 + 4);
+    put1(buf, 0x01);
+    put1(buf, 0x01);
+    put1(buf, 1);
+    put1(buf, VENREQ_KEEPALIVE);
+    put1(buf, 4);
+    put4(buf, 300);
+
+    put1(buf, GENERIC_APPRES);
+    put1(buf, 3 + 2 * (2 + 4));
+    put1(buf, 0x80);
+    put1(buf, 0x01);
+    put1(buf, 2);
+    put1(buf, APPREQ_BILLINGID);
+    put1(buf, 4);
+    put4(buf, 0x00000777);
+    put1(buf, APPREQ_TIMEREMAINING);
+    put1(buf, 4);
+    put4(buf, 86400);
+}
+
+static std::vector<ui8> makeConfirm(bool arris)
+{
+    std::vector<ui8> msg, privateData;
+    static const ui8 mac[MAC_ID_SIZE] = { 0x00, 0x1B, 0xD7, 0x11, 0x22, 0x33 };
+
+    put1(msg, 0x11);
+    put1(msg, DSMCC_SESSMSG_TYPE);
+    put2(msg, dsmcc_ClientSessionSetUpConfirm);
+    put4(msg, 0x80000042);
+    put1(msg, 0xFF);
+    put1(msg, 0);
+    put2(msg, 0);
+
+    msg.insert(msg.end(), mac, mac + MAC_ID_SIZE);
+    put4(msg, 0x42);
+    put2(msg, dsmcc_RspOK);
+    msg.insert(msg.end(), DSMCC_SERVERID_LEN - 4, 0);
+    put4(msg, kBenchServerIp);
+    putResources(msg, !arris);
+
+    if (arris)
+    {
+        std::vector<ui8> descriptors;
+        putDescriptors(descriptors);
+
+        put1(privateData, SSP_PROTOCOL_ID_2);
+        put1(privateData, SSP_VERSION_1);
+        privateData.insert(privateData.end(), SERVICE_GW_SIZE, 0);
+        memcpy(&privateData[2], "ARRIS_GW", 8);
+        put4(privateData, SERVICE_SIZE + 4 + descriptors.size());
+        privateData.insert(privateData.end(), SERVICE_SIZE, 0);
+        memcpy(&privateData[privateData.size() - SERVICE_SIZE], "VOD", 3);
+        put4(privateData, descriptors.size());
+        privateData.insert(privateData.end(), descriptors.begin(), descriptors.end());
+    }
+    else
+    {
+        put1(privateData, SSP_PROTOCOL_ID_1);
+        put1(privateData, 0x01);
+        putDescriptors(privateData);
+    }
+    put2(msg, 0);
+    put2(msg, privateData.size());
+    msg.insert(msg.end(), privateData.begin(), privateData.end());
+
+    msg[10] = (msg.size() - DSMCC_MSG_HEADER_SIZE) >> 8;
+    msg[11] = (msg.size() - DSMCC_MSG_HEADER_SIZE);
+    return msg;
+}
+
+typedef struct
+{
+    ui16 program;
+    ui32 frequency;
+    ui32 symbolRate;
+    ui32 caInfoLength;
+    ui32 serverIp;
+    ui16 serverPort;
+} tBenchTuning;
+
+// what HandleSessionConfirmResp() takes from the message objects
+static bool parseWithClasses(ui8 *msg, ui32 length, tBenchTuning *tuning)
+{
+    VodDsmcc_Base *base = VodDsmcc_Base::GetMessageTypeObject(msg, length);
+    if (!base)
+    {
+        return false;
+    }
+    VodDsmcc_ClientSessionConfirm *confirm = (VodDsmcc_ClientSessionConfirm *) base;
+    bool ok = (confirm->ParseDsmccMessageBody(msg, length) == E_TRUE);
+
+    vector<VodDsmcc_ResourceDescriptor> resDesc = confirm->GetResources();
+    vector<VodDsmcc_ResourceDescriptor>::const_iterator itrResDesc;
+    for (itrResDesc = resDesc.begin(); itrResDesc != resDesc.end(); itrResDesc++)
+    {
+        VodDsmcc_ResourceDescriptor desc = *itrResDesc;
+        switch (desc.GetResourceDescriptorType())
+        {
+        case DSMCC_RESDESC_MPEGPROG:
+        {
+            VodDsmcc_MPEGProgResData *value = dynamic_cast<VodDsmcc_MPEGProgResData *>(desc.GetDescValue());
+            if (value)
+            {
+                tuning->program = value->GetMPEGProgramNumberValue();
+            }
+            break;
+        }
+        case DSMCC_RESDESC_PHYSICALCHAN:
+        {
+            VodDsmcc_PhysicalChannelResData *value = dynamic_cast<VodDsmcc_PhysicalChannelResData *>(desc.GetDescValue());
+            if (value)
+            {
+                tuning->frequency = value->GetChannelIdValue();
+            }
+            break;
+        }
+        case DSMCC_RESDESC_ATSCMODMODE:
+        {
+            VodDsmcc_ATSCModulationData *value = dynamic_cast<VodDsmcc_ATSCModulationData *>(desc.GetDescValue());
+            if (value)
+            {
+                tuning->symbolRate = value->GetSymbolRate();
+            }
+            break;
+        }
+        case DSMCC_RESDESC_CLIENTCA:
+        {
+            VodDsmcc_ClientCA *value = dynamic_cast<VodDsmcc_ClientCA *>(desc.GetDescValue());
+            if (value)
+            {
+                tuning->caInfoLength = value->GetCaInfoLength();
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    VodDsmcc_UserData userData = confirm->GetUserData();
+    VodDsmcc_UserPrivateData privateData = userData.GetPrivateDataObj();
+    vector<VodDsmcc_Descriptor> desc = privateData.GetDescriptor();
+    vector<VodDsmcc_Descriptor>::const_iterator itrDesc;
+    for (itrDesc = desc.begin(); itrDesc != desc.end(); itrDesc++)
+    {
+        VodDsmcc_Descriptor d = *itrDesc;
+        if (d.GetTag() == GENERIC_IPDESC)
+        {
+            VodDsmcc_IPType *ip = dynamic_cast<VodDsmcc_IPType *>(d.GetValue());
+            if (ip)
+            {
+                tuning->serverIp = ip->GetIPAddress();
+                tuning->serverPort = ip->GetIPPortNumber();
+            }
+        }
+    }
+
+    delete base;
+    return ok;
+}
+
+static bool parseWithCodec(const ui8 *msg, ui32 length, tDsmccSessionConfirmView *view, tBenchTuning *tuning)
+{
+    tDsmccMpegProgram program;
+    tDsmccPhysicalChannel channel;
+    tDsmccAtscModulation modulation;
+    tDsmccClientCa ca;
+    tDsmccIpDesc ip;
+
+    if (!VodDsmcc_Codec::parseSessionConfirm(msg, length, view))
+    {
+        return false;
+    }
+    if (VodDsmcc_Codec::decode(VodDsmcc_Codec::findResource(view, DSMCC_RESDESC_MPEGPROG), &program))
+    {
+        tuning->program = program.programNumber;
+    }
+    if (VodDsmcc_Codec::decode(VodDsmcc_Codec::findResource(view, DSMCC_RESDESC_PHYSICALCHAN), &channel))
+    {
+        tuning->frequency = channel.channelId;
+    }
+    if (VodDsmcc_Codec::decode(VodDsmcc_Codec::findResource(view, DSMCC_RESDESC_ATSCMODMODE), &modulation))
+    {
+        tuning->symbolRate = modulation.symbolRate;
+    }
+    if (VodDsmcc_Codec::decode(VodDsmcc_Codec::findResource(view, DSMCC_RESDESC_CLIENTCA), &ca))
+    {
+        tuning->caInfoLength = ca.caInfoLength;
+    }
+    if (VodDsmcc_Codec::decode(VodDsmcc_Codec::findDescriptor(&view->privateData.list, GENERIC_IPDESC), &ip))
+    {
+        tuning->serverIp = ip.address;
+        tuning->serverPort = ip.port;
+    }
+    return true;
+}
+
+// ClientSessionSetUpRequest as SeaChange_SessionControl builds it
+static void setupWithClasses(const ui8 *assetId, const ui8 *nodeGroup, const ui8 *sessionId, ui8 *clientId, ui8 *serverId,
+                             ui8 **msg, ui32 *length)
+{
+    vector<VodDsmcc_Descriptor> seaReqDesc;
+    seaReqDesc.push_back(VodDsmcc_Descriptor(VENREQ_FUNCTION, 0x01, new VodDsmcc_FunctionDesc(0x02)));
+    seaReqDesc.push_back(VodDsmcc_Descriptor(VENREQ_SUBFUNCTION, 0x01, new VodDsmcc_SubFunctionDesc(0x02)));
+
+    vector<VodDsmcc_Descriptor> appReqDesc;
+    appReqDesc.push_back(VodDsmcc_Descriptor(APPREQ_BILLINGID, 0x04, new VodDsmcc_BillingIdDesc(0x777)));
+    appReqDesc.push_back(VodDsmcc_Descriptor(APPREQ_PURCHASETIME, 0x04, new VodDsmcc_PurchaseTimeDesc(1000)));
+    appReqDesc.push_back(VodDsmcc_Descriptor(APPREQ_TIMEREMAINING, 0x04, new VodDsmcc_TimeRemainingDesc(86400)));
+
+    vector<VodDsmcc_Descriptor> privateDesc;
+    privateDesc.push_back(VodDsmcc_Descriptor(GENERIC_ASSETID, 0x08, new VodDsmcc_AssetId((ui8 *) assetId)));
+    privateDesc.push_back(VodDsmcc_Descriptor(GENERIC_NODEGROUPID, 0x06, new VodDsmcc_NodeGroupId((ui8 *) nodeGroup)));
+    privateDesc.push_back(VodDsmcc_Descriptor(GENERIC_VENREQ, 0x09, new VodDsmcc_SeaReqData(0x01, 0x01, 0x02, seaReqDesc)));
+    privateDesc.push_back(VodDsmcc_Descriptor(GENERIC_APPREQ, 0x15, new VodDsmcc_AppReqData(0x80, 0x01, 0x03, appReqDesc)));
+
+    VodDsmcc_UserPrivateData userPrivateData(0x01, 0x01, 0x04, privateDesc);
+    userPrivateData.SetPadBytes(0);
+    VodDsmcc_UserData userData;
+    userData.SetUuDataCount(0);
+    userData.SetPrivateDataCount(55);
+    userData.SetPrivateDataObj(userPrivateData);
+
+    VodDsmcc_SessionId dsmccSessionId((ui8 *) sessionId);
+    VodDsmcc_ClientSessionSetup *setup = new VodDsmcc_ClientSessionSetup(dsmcc_ClientSessionSetUpRequest, 0x80000042, 111,
+            dsmccSessionId, clientId, serverId, userData);
+    setup->PackDsmccMessageBody(msg, length);
+    delete setup;
+}
+
+static ui32 setupWithCodec(const ui8 *assetId, const ui8 *nodeGroup, const ui8 *sessionId, const ui8 *clientId, const ui8 *serverId,
+                           ui8 *buf, ui32 size)
+{
+    tDsmccSessionSetup setup;
+    tDsmccDescriptorList list;
+    ui8 funcs[2] = { 0x02, 0x02 };
+    ui8 vendor[16];
+    ui8 app[32];
+    ui8 values[12];
+
+    memset(&setup, 0, sizeof(setup));
+    setup.transactionId = 0x80000042;
+    setup.sessionId = sessionId;
+    setup.clientId = clientId;
+    setup.serverId = serverId;
+
+    list.protocolId = 0x01;
+    list.version = 0x01;
+    list.count = 2;
+    list.desc[0].tag = VENREQ_FUNCTION;
+    list.desc[0].len = 1;
+    list.desc[0].value = &funcs[0];
+    list.desc[1].tag = VENREQ_SUBFUNCTION;
+    list.desc[1].len = 1;
+    list.desc[1].value = &funcs[1];
+    ui32 vendorLength = VodDsmcc_Codec::encodeDescriptorList(&list, vendor, sizeof(vendor));
+
+    static const ui8 appTags[3] = { APPREQ_BILLINGID, APPREQ_PURCHASETIME, APPREQ_TIMEREMAINING };
+    static const ui32 appValues[3] = { 0x777, 1000, 86400 };
+    list.protocolId = 0x80;
+    list.count = 3;
+    for (int i = 0; i < 3; i++)
+    {
+        tDsmccU32Desc value = { appValues[i] };
+        VodDsmcc_Codec::encode(&value, values + 4 * i, 4);
+        list.desc[i].tag = appTags[i];
+        list.desc[i].len = 4;
+        list.desc[i].value = values + 4 * i;
+    }
+    ui32 appLength = VodDsmcc_Codec::encodeDescriptorList(&list, app, sizeof(app));
+
+    tDsmccDescriptorList &desc = setup.privateData.list;
+    desc.protocolId = SSP_PROTOCOL_ID_1;
+    desc.version = 0x01;
+    desc.count = 4;
+    desc.desc[0].tag = GENERIC_ASSETID;
+    desc.desc[0].len = ASSET_ID_SIZE;
+    desc.desc[0].value = assetId;
+    desc.desc[1].tag = GENERIC_NODEGROUPID;
+    desc.desc[1].len = NODE_GROUP_SIZE;
+    desc.desc[1].value = nodeGroup;
+    desc.desc[2].tag = GENERIC_VENREQ;
+    desc.desc[2].len = vendorLength;
+    desc.desc[2].value = vendor;
+    desc.desc[3].tag = GENERIC_APPREQ;
+    desc.desc[3].len = appLength;
+    desc.desc[3].value = app;
+    return VodDsmcc_Codec::encodeSessionSetup(&setup, buf, size);
+}
+
+static void report(const char *message, const char *phase, double secs)
+{
+    printf("%-10s %-22s %10.2f\n", message, phase, secs * 1e9 / kBenchIterations);
+}
+
+int main(void)
+{
+    static const char *names[] = { "SeaChange", "Arris" };
+    ui8 out[1024];
+
+    printf("%-10s %-22s %10s\n", "message", "phase", "ns/message");
+    for (int m = 0; m < 2; m++)
+    {
+        std::vector<ui8> msg = makeConfirm(m == 1);
+        tBenchTuning classes, codec;
+        tDsmccSessionConfirmView view;
+
+        memset(&classes, 0, sizeof(classes));
+        memset(&codec, 0, sizeof(codec));
+        if (!parseWithClasses(&msg[0], msg.size(), &classes) || !parseWithCodec(&msg[0], msg.size(), &view, &codec) ||
+                memcmp(&classes, &codec, sizeof(classes)) || (codec.frequency != kBenchFrequency) ||
+                (codec.serverPort != kBenchServerPort))
+        {
+            printf("ERROR: %s message parsed differently\n", names[m]);
+            return 1;
+        }
+        ui32 length = VodDsmcc_Codec::encodeSessionConfirm(&view, out, sizeof(out));
+        if ((length != msg.size()) || memcmp(out, &msg[0], length))
+        {
+            printf("ERROR: %s message encoded back differently\n", names[m]);
+            return 1;
+        }
+
+        double start = nowSecs();
+        for (int i = 0; i < kBenchIterations; i++)
+        {
+            parseWithClasses(&msg[0], msg.size(), &classes);
+        }
+        report(names[m], "parse, classes", nowSecs() - start);
+
+        start = nowSecs();
+        for (int i = 0; i < kBenchIterations; i++)
+        {
+            parseWithCodec(&msg[0], msg.size(), &view, &codec);
+        }
+        report(names[m], "parse, codec", nowSecs() - start);
+
+        start = nowSecs();
+        for (int i = 0; i < kBenchIterations; i++)
+        {
+            VodDsmcc_Codec::parseSessionConfirm(&msg[0], msg.size(), &view);
+            VodDsmcc_Codec::encodeSessionConfirm(&view, out, sizeof(out));
+        }
+        report(names[m], "round trip, codec", nowSecs() - start);
+    }
+
+    static const ui8 assetId[ASSET_ID_SIZE] = { 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x0F, 0xB0 };
+    static const ui8 nodeGroup[NODE_GROUP_SIZE] = { 0x00, 0x00, 0x00, 0x00, 0x02, 0x5A };
+    ui8 sessionId[DSMCC_SESSIONID_LEN] = { 0x00, 0x1B, 0xD7, 0x11, 0x22, 0x33, 0x00, 0x00, 0x00, 0x42 };
+    ui8 clientId[DSMCC_CLIENTID_LEN] = { 0x2D };
+    ui8 serverId[DSMCC_SERVERID_LEN] = { 0x2D };
+    ui8 *setup = NULL;
+    ui32 setupLength = 0;
+
+    setupWithClasses(assetId, nodeGroup, sessionId, clientId, serverId, &setup, &setupLength);
+    ui32 length = setupWithCodec(assetId, nodeGroup, sessionId, clientId, serverId, out, sizeof(out));
+    if (!setup || (length != setupLength) || memcmp(out, setup, length))
+    {
+        printf("ERROR: setup request encoded differently\n");
+        return 1;
+    }
+    delete [] setup;
+
+    double start = nowSecs();
+    for (int i = 0; i < kBenchIterations; i++)
+    {
+        setupWithClasses(assetId, nodeGroup, sessionId, clientId, serverId, &setup, &setupLength);
+        delete [] setup;
+    }
+    report("SeaChange", "setup, classes", nowSecs() - start);
+
+    start = nowSecs();
+    for (int i = 0; i < kBenchIterations; i++)
+    {
+        setupWithCodec(assetId, nodeGroup, sessionId, clientId, serverId, out, sizeof(out));
+    }
+    report("SeaChange", "setup, codec", nowSecs() - start);
+
+    return 0;
+}
@@ -0,0 +1,243 @@
+/**
+
+\file dsmccCodec_test.h -- contains the cxxtest test cases for the DSM-CC codec
+
+The messages are built in memory with the codec's own structs: a session
+confirm with MPEG program, physical channel and client CA resources and SSP 1
+private data.  Every truncation and a fixed seed of byte corruptions must be
+rejected or parsed within the message.
+*/
+
+#if !defined(DSMCC_CODEC_TEST_H)
+#define DSMCC_CODEC_TEST_H
+
+#include <cxxtest/TestSuite.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "dsmccCodec.h"
+
+class dsmccCodecTestSuite : public CxxTest::TestSuite
+{
+public:
+
+    static void putResource(tDsmccSessionConfirmView *view, ui16 type, const ui8 *data, ui32 length)
+    {
+        tDsmccResourceView *res = &view->resources[view->resourceCount++];
+        memset(res, 0, sizeof(*res));
+        res->requestId = view->resourceCount;
+        res->type = type;
+        res->length = length + 2;
+        res->data = data;
+        res->dataLength = length;
+    }
+
+    // encodes a confirm from values into msg, the view must stay valid as long as values does
+    static void makeConfirm(std::vector<ui8> &msg, ui8 *values)
+    {
+        static const ui8 sessionId[DSMCC_SESSIONID_LEN] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 };
+        static const ui8 serverId[DSMCC_SERVERID_LEN] = { 0x2D };
+        tDsmccSessionConfirmView view;
+        tDsmccMpegProgram program = { 0, 7, 0, 0x1E0, 0x1FFF, 2, 0, 0x1E1 };
+        tDsmccPhysicalChannel channel = { 0, 555000000, 0 };
+        tDsmccClientCa ca = { 0x0E00, 16 };
+        tDsmccIpDesc ip = { 5540, 0x0A000001 };
+
+        memset(&view, 0, sizeof(view));
+        view.header.protocolDiscriminator = 0x11;
+        view.header.dsmccType = DSMCC_SESSMSG_TYPE;
+        view.header.messageId = dsmcc_ClientSessionSetUpConfirm;
+        view.header.transactionId = 0x1234;
+        view.sessionId = sessionId;
+        view.serverId = serverId;
+
+        ui8 *pos = values;
+        putResource(&view, DSMCC_RESDESC_MPEGPROG, pos, VodDsmcc_Codec::encode(&program, pos, 64));
+        pos += MPEG_DESC_SIZE;
+        putResource(&view, DSMCC_RESDESC_PHYSICALCHAN, pos, VodDsmcc_Codec::encode(&channel, pos, 64));
+        pos += PHY_CHANNEL_DESC_SIZE;
+        VodDsmcc_Codec::encode(&ca, pos, 64);
+        memset(pos + CA_DESC_SIZE, 0xCA, ca.caInfoLength);
+        putResource(&view, DSMCC_RESDESC_CLIENTCA, pos, CA_DESC_SIZE + ca.caInfoLength);
+        pos += CA_DESC_SIZE + ca.caInfoLength;
+
+        view.privateDataCount = 1;
+        view.privateData.list.protocolId = SSP_PROTOCOL_ID_1;
+        view.privateData.list.version = 1;
+        view.privateData.list.count = 1;
+        view.privateData.list.desc[0].tag = GENERIC_IPDESC;
+        view.privateData.list.desc[0].len = VodDsmcc_Codec::encode(&ip, pos, 64);
+        view.privateData.list.desc[0].value = pos;
+
+        msg.resize(512);
+        msg.resize(VodDsmcc_Codec::encodeSessionConfirm(&view, &msg[0], msg.size()));
+    }
+
+    void test_round_trip(void)
+    {
+        std::vector<ui8> msg;
+        ui8 values[128];
+        tDsmccSessionConfirmView view;
+        tDsmccMpegProgram program;
+        tDsmccPhysicalChannel channel;
+        tDsmccClientCa ca;
+        tDsmccIpDesc ip;
+
+        makeConfirm(msg, values);
+        TS_ASSERT(msg.size() > DSMCC_MSG_HEADER_SIZE);
+        TS_ASSERT(VodDsmcc_Codec::parseSessionConfirm(&msg[0], msg.size(), &view));
+        TS_ASSERT(view.header.transactionId == 0x1234);
+        TS_ASSERT(view.resourceCount == 3);
+
+        // views point into the message
+        const tDsmccResourceView *res = VodDsmcc_Codec::findResource(&view, DSMCC_RESDESC_CLIENTCA);
+        TS_ASSERT(res && (res->data > &msg[0]) && (res->data + res->dataLength <= &msg[0] + msg.size()));
+        TS_ASSERT(VodDsmcc_Codec::decode(res, &ca) && (ca.caInfoLength == 16) && (res->dataLength == CA_DESC_SIZE + 16));
+
+        TS_ASSERT(VodDsmcc_Codec::decode(VodDsmcc_Codec::findResource(&view, DSMCC_RESDESC_MPEGPROG), &program));
+        TS_ASSERT((program.programNumber == 7) && (program.pcrPid == 0x1E1));
+        TS_ASSERT(VodDsmcc_Codec::decode(VodDsmcc_Codec::findResource(&view, DSMCC_RESDESC_PHYSICALCHAN), &channel));
+        TS_ASSERT(channel.channelId == 555000000);
+        TS_ASSERT(VodDsmcc_Codec::findResource(&view, DSMCC_RESDESC_ATSCMODMODE) == NULL);
+        TS_ASSERT(VodDsmcc_Codec::decode(VodDsmcc_Codec::findDescriptor(&view.privateData.list, GENERIC_IPDESC), &ip));
+        TS_ASSERT((ip.port == 5540) && (ip.address == 0x0A000001));
+
+        ui8 out[512];
+        TS_ASSERT(VodDsmcc_Codec::encodeSessionConfirm(&view, out, sizeof(out)) == msg.size());
+        TS_ASSERT(memcmp(out, &msg[0], msg.size()) == 0);
+        TS_ASSERT(VodDsmcc_Codec::encodeSessionConfirm(&view, out, msg.size() - 1) == 0);
+    }
+
+    void test_confirm_object(void)
+    {
+        std::vector<ui8> msg;
+        ui8 values[128];
+        tDsmccMpegProgram program;
+        tDsmccClientCa ca;
+
+        makeConfirm(msg, values);
+        VodDsmcc_CodecSessionConfirm *confirm = new VodDsmcc_CodecSessionConfirm();
+        TS_ASSERT(confirm->ParseDsmccMessageBody(&msg[0], msg.size()) == E_TRUE);
+
+        // the confirm keeps its own copy, the receive buffer is reused
+        memset(&msg[0], 0, msg.size());
+        VodDsmcc_SessionId sessionId = confirm->GetSessionId();
+        TS_ASSERT(confirm->GetMessageId() == dsmcc_ClientSessionSetUpConfirm);
+        TS_ASSERT(confirm->GetTransactionId() == 0x1234);
+        TS_ASSERT(confirm->GetResponse() == 0);
+        TS_ASSERT(sessionId.GetSessionId()[DSMCC_SESSIONID_LEN - 1] == 10);
+
+        const tDsmccSessionConfirmView *view = confirm->GetView();
+        TS_ASSERT(VodDsmcc_Codec::decode(VodDsmcc_Codec::findResource(view, DSMCC_RESDESC_MPEGPROG), &program));
+        TS_ASSERT(program.programNumber == 7);
+        const ui8 *caInfo = VodDsmcc_Codec::clientCaInfo(VodDsmcc_Codec::findResource(view, DSMCC_RESDESC_CLIENTCA), &ca);
+        TS_ASSERT(caInfo && (ca.caInfoLength == 16) && (caInfo[0] == 0xCA) && (caInfo[15] == 0xCA));
+        TS_ASSERT(VodDsmcc_Codec::clientCaInfo(VodDsmcc_Codec::findResource(view, DSMCC_RESDESC_ATSCMODMODE), &ca) == NULL);
+
+        VodDsmcc_Base *base = confirm;
+        delete base;
+
+        // a confirm the codec rejects is not handed on
+        makeConfirm(msg, values);
+        confirm = new VodDsmcc_CodecSessionConfirm();
+        // low byte of the resource count
+        msg[DSMCC_MSG_HEADER_SIZE + DSMCC_SESSIONID_LEN + 2 + DSMCC_SERVERID_LEN + 1] = DSMCC_CODEC_MAX_RESOURCES + 1;
+        TS_ASSERT(confirm->ParseDsmccMessageBody(&msg[0], msg.size()) == E_FALSE);
+        delete confirm;
+    }
+
+    void test_truncated(void)
+    {
+        std::vector<ui8> msg;
+        ui8 values[128];
+        tDsmccSessionConfirmView view;
+
+        makeConfirm(msg, values);
+        for (ui32 length = 0; length < msg.size(); length++)
+        {
+            // exact copy so a read past the end is caught by valgrind
+            std::vector<ui8> cut(msg.begin(), msg.begin() + length);
+            TS_ASSERT(!VodDsmcc_Codec::parseSessionConfirm(cut.empty() ? NULL : &cut[0], length, &view));
+
+            // header saying the message is that long
+            if (length >= DSMCC_MSG_HEADER_SIZE)
+            {
+                cut[10] = (length - DSMCC_MSG_HEADER_SIZE) >> 8;
+                cut[11] = (length - DSMCC_MSG_HEADER_SIZE);
+                bool parsed = VodDsmcc_Codec::parseSessionConfirm(&cut[0], length, &view);
+                // only the optional user data may be left out
+                TS_ASSERT(!parsed || (view.privateDataCount == 0));
+            }
+        }
+    }
+
+    void test_corrupted(void)
+    {
+        std::vector<ui8> msg;
+        ui8 values[128];
+
+        makeConfirm(msg, values);
+        srand(11);
+        for (int round = 0; round < 2000; round++)
+        {
+            std::vector<ui8> bad(msg);
+            tDsmccSessionConfirmView view;
+
+            int mutations = 1 + rand() % 4;
+            for (int i = 0; i < mutations; i++)
+            {
+                bad[DSMCC_MSG_HEADER_SIZE + rand() % (bad.size() - DSMCC_MSG_HEADER_SIZE)] = rand();
+            }
+            if (!VodDsmcc_Codec::parseSessionConfirm(&bad[0], bad.size(), &view))
+            {
+                continue;
+            }
+            for (ui32 i = 0; i < view.resourceCount; i++)
+            {
+                const tDsmccResourceView *res = &view.resources[i];
+                TS_ASSERT(res->data && (res->data + res->dataLength <= &bad[0] + bad.size()));
+            }
+            for (ui32 i = 0; i < view.privateData.list.count; i++)
+            {
+                const tDsmccDescriptorView *desc = &view.privateData.list.desc[i];
+                TS_ASSERT(desc->value && (desc->value + desc->len <= &bad[0] + bad.size()));
+            }
+        }
+    }
+
+    void test_nested_descriptors(void)
+    {
+        tDsmccDescriptorList list, parsed;
+        ui8 keepAlive[4];
+        ui8 value[32];
+        tDsmccU32Desc interval = { 300 };
+        tDsmccU32Desc decoded;
+
+        memset(&list, 0, sizeof(list));
+        list.protocolId = 0x01;
+        list.version = 0x01;
+        list.count = 1;
+        list.desc[0].tag = VENREQ_KEEPALIVE;
+        list.desc[0].len = VodDsmcc_Codec::encode(&interval, keepAlive, sizeof(keepAlive));
+        list.desc[0].value = keepAlive;
+
+        tDsmccDescriptorView venreq;
+        venreq.tag = GENERIC_VENREQ;
+        venreq.len = VodDsmcc_Codec::encodeDescriptorList(&list, value, sizeof(value));
+        venreq.value = value;
+        TS_ASSERT(venreq.len == 3 + 2 + 4);
+
+        TS_ASSERT(VodDsmcc_Codec::parseDescriptorList(&venreq, &parsed));
+        TS_ASSERT(VodDsmcc_Codec::decode(VodDsmcc_Codec::findDescriptor(&parsed, VENREQ_KEEPALIVE), &decoded));
+        TS_ASSERT(decoded.value == 300);
+
+        venreq.len--;
+        TS_ASSERT(!VodDsmcc_Codec::parseDescriptorList(&venreq, &parsed));
+    }
+
+};
+
+
+#endif
@@ -17,6 +17,7 @@
 #include <netinet/in.h>
 #include "dlog.h"
 #include "dsmccProtocol.h"
+#include "vodDnsCache.h"
 
 #define MSGBODY_BUFFER_LEN  300
 //###################################################################################
@@ -115,10 +116,10 @@ bool VodDsmcc_Base::SendMessage(i32 socket, string ip, ui16 port, ui8 *data,
         addr.sin_port = htons(port); // TBI, use provided port
         // use my IP address
         dlog(DL_MSP_ONDEMAND, DLOGL_NOISE, "VodDsmcc_Base::GetSocket() IPAddr: %s:", ip.c_str());
-        if (inet_aton(ip.c_str(), &addr.sin_addr) == 0)
+        if (!VodDnsCache::getInstance()->resolve(ip, &addr.sin_addr))
         {
             dlog(DL_MSP_ONDEMAND, DLOGL_ERROR,
-                 "VodDsmcc_Base::GetSocket() inet_aton() failed  \n");
+                 "VodDsmcc_Base::GetSocket() %s does not resolve  \n", ip.c_str());
             return status;
         }
 
@@ -290,26 +291,15 @@ status VodDsmcc_Base::ParseDsmccMessageHdr(ui8 * data, ui32 length,
         // remember the start of the message
         start = data;
 
-        // protocol discriminator type
-        data = Utils::Get1Byte(data, &ProtocolDiscriminator);
-
-        // dsm-cc type
-        data = Utils::Get1Byte(data, &DsmccType);
-
-        // message ID
-        data = Utils::Get2Byte(data, &MessageId);
-
-        // transaction ID
-        data = Utils::Get4Byte(data, &TransactionId);
-
-        // reserved
-        data = Utils::Get1Byte(data, &Reserved);
-
-        // adaptation header length
-        data = Utils::Get1Byte(data, &AdaptationLength);
-
-        // message length
-        data = Utils::Get2Byte(data, &MessageLength);
+        ProtocolDiscriminator = DsmccHeaderLayout::ProtocolDiscriminator::get(data);
+        DsmccType = DsmccHeaderLayout::DsmccType::get(data);
+        MessageId = DsmccHeaderLayout::MessageId::get(data);
+        TransactionId = DsmccHeaderLayout::TransactionId::get(data);
+        Reserved = DsmccHeaderLayout::Reserved::get(data);
+        AdaptationLength = DsmccHeaderLayout::AdaptationLength::get(data);
+        // message length (length of all data that follows this field)
+        MessageLength = DsmccHeaderLayout::MessageLength::get(data);
+        data += DsmccHeaderLayout::Size;
 
         dlog(DL_MSP_ONDEMAND, DLOGL_FUNCTION_CALLS, "Message ID \n");
 
@@ -365,27 +355,15 @@ status VodDsmcc_Base::CreateDsmccMessageHeader(ui8 * msgData,
         ui8 * work = buffer;
 
         // first, we add the standard message header fields
-
-        // Protocol Discriminator Type
-        work = Utils::Put1Byte(work, ProtocolDiscriminator);
-
-        // DSM-CC Type
-        work = Utils::Put1Byte(work, DsmccType);
-
-        // Message ID
-        work = Utils::Put2Byte(work, MessageId);
-
-        // Transaction ID
-        work = Utils::Put4Byte(work, TransactionId);
-
-        // Reserved
-        work = Utils::Put1Byte(work, 0xff);
-
-        // Adaptation length
-        work = Utils::Put1Byte(work, AdaptationLength);
-
+        DsmccHeaderLayout::ProtocolDiscriminator::put(work, ProtocolDiscriminator);
+        DsmccHeaderLayout::DsmccType::put(work, DsmccType);
+        DsmccHeaderLayout::MessageId::put(work, MessageId);
+        DsmccHeaderLayout::TransactionId::put(work, TransactionId);
+        DsmccHeaderLayout::Reserved::put(work, 0xff);
+        DsmccHeaderLayout::AdaptationLength::put(work, AdaptationLength);
         // Message length (length of all data that follows this field)
-        work = Utils::Put2Byte(work, (adaptHeaderLength + msgDataLength));
+        DsmccHeaderLayout::MessageLength::put(work, (adaptHeaderLength + msgDataLength));
+        work += DsmccHeaderLayout::Size;
 
         // adaptation header
         if (adaptHeader)
@@ -440,9 +418,14 @@ status VodDsmcc_Base::CloseSocket(i32 fd)
 
 ui32 VodDsmcc_Base::getTransId()
 {
-    srand(time(0));
-    static ui32 transid = rand() % 100 + 1;
-    return ++transid;
+    // sessions share the transport and their responses are matched by transaction id,
+    // the id must be unique across threads
+    static ui32 transid = 0;
+    if (transid == 0)
+    {
+        __sync_bool_compare_and_swap(&transid, 0, (ui32)(time(0) % 100) + 1);
+    }
+    return __sync_add_and_fetch(&transid, 1);
 }
 
 i32 VodDsmcc_Base::GetSocket(ui16 port)
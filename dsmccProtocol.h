@@ -164,6 +164,20 @@ using namespace std;
 //DSMCC message header length
 #define DSMCC_MSG_HEADER_SIZE   12
 
+//DSMCC message header fields
+struct DsmccHeaderLayout
+{
+    typedef VodField<0, ui8>   ProtocolDiscriminator;
+    typedef VodField<1, ui8>   DsmccType;
+    typedef VodField<2, ui16>  MessageId;
+    typedef VodField<4, ui32>  TransactionId;
+    typedef VodField<8, ui8>   Reserved;
+    typedef VodField<9, ui8>   AdaptationLength;
+    typedef VodField<10, ui16> MessageLength;
+    enum { Size = DSMCC_MSG_HEADER_SIZE };
+};
+VOD_LAYOUT_CHECK(DsmccHeaderLayout, MessageLength);
+
 
 #define FUNCTION_DESC_SIZE          1
 #define SUBFUNCTION_DESC_SIZE       1
@@ -0,0 +1,286 @@
+/**
+   \file dsmccTransport.cpp
+   \class DsmccTransport
+
+Implementation file for the shared DSM-CC session signalling transport
+*/
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <dlog.h>
+
+#include "dsmccTransport.h"
+#include "monotonicTime.h"
+#include "dsmccProtocol.h"
+
+#define LOG(level, msg, args...)  dlog(DL_MSP_ONDEMAND, level,"DsmccTransport:%s:%d " msg, __FUNCTION__, __LINE__, ##args);
+
+DsmccTransport* DsmccTransport::mInstance = NULL;
+pthread_mutex_t DsmccTransport::mInstanceMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static const uint32_t kLatencyBucketMs[kDsmccLatencyBuckets - 1] = { 10, 20, 50, 100, 200, 500, 1000, 2000, 5000 };
+static const char *kTxnTypeName[kDsmccTxn_Types] = { "setup", "release", "status", "reset", "other" };
+
+DsmccTransport* DsmccTransport::getInstance(void)
+{
+    pthread_mutex_lock(&mInstanceMutex);
+    if (mInstance == NULL)
+    {
+        mInstance = new DsmccTransport();
+    }
+    pthread_mutex_unlock(&mInstanceMutex);
+    return mInstance;
+}
+
+DsmccTransport::DsmccTransport()
+{
+    pthread_mutex_init(&mMutex, NULL);
+    mSocketFd = -1;
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+DsmccTransport::~DsmccTransport()
+{
+    pthread_mutex_destroy(&mMutex);
+}
+
+int32_t DsmccTransport::getSocket(uint16_t port)
+{
+    pthread_mutex_lock(&mMutex);
+    if (mSocketFd == -1)
+    {
+        mSocketFd = VodDsmcc_Base::GetSocket(port);
+        LOG(DLOGL_NORMAL, "port:%d socket:%d", port, mSocketFd);
+    }
+    int32_t fd = mSocketFd;
+    pthread_mutex_unlock(&mMutex);
+    return fd;
+}
+
+int32_t DsmccTransport::receive(uint8_t *buf, uint32_t size)
+{
+    if (mSocketFd == -1)
+    {
+        return 0;
+    }
+
+    ssize_t got = recv(mSocketFd, buf, size, MSG_DONTWAIT);
+    if (got < 0)
+    {
+        if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+        {
+            LOG(DLOGL_ERROR, "recv error:%d", errno);
+        }
+        return 0;
+    }
+    return got;
+}
+
+eDsmccTxnType DsmccTransport::txnType(uint16_t msgId)
+{
+    switch (msgId)
+    {
+    case dsmcc_ClientSessionSetUpRequest:
+    case dsmcc_ClientSessionSetUpConfirm:
+        return kDsmccTxn_SessionSetup;
+    case dsmcc_ClientReleaseRequest:
+    case dsmcc_ClientReleaseConfirm:
+        return kDsmccTxn_Release;
+    case dsmcc_ClientStatusRequest:
+    case dsmcc_ClientStatusConfirm:
+        return kDsmccTxn_Status;
+    case dsmcc_ClientResetRequest:
+    case dsmcc_ClientResetConfirm:
+        return kDsmccTxn_Reset;
+    default:
+        return kDsmccTxn_Other;
+    }
+}
+
+uint32_t DsmccTransport::timeoutMs(const Transaction &txn)
+{
+    uint32_t timeout = txn.timerMs;
+    for (uint8_t i = 1; (i < txn.sends) && (timeout < txn.timerMs * kDsmccTransportMaxBackoff); i++)
+    {
+        timeout *= 2;
+    }
+    if (timeout > txn.timerMs * kDsmccTransportMaxBackoff)
+    {
+        timeout = txn.timerMs * kDsmccTransportMaxBackoff;
+    }
+    return timeout;
+}
+
+void DsmccTransport::addLatency(eDsmccTxnType type, uint32_t ms)
+{
+    tDsmccLatencyHistogram *hist = &mStats.latency[type];
+    int bucket = 0;
+
+    while ((bucket < kDsmccLatencyBuckets - 1) && (ms > kLatencyBucketMs[bucket]))
+    {
+        bucket++;
+    }
+    hist->buckets[bucket]++;
+    if ((hist->count == 0) || (ms < hist->minMs))
+    {
+        hist->minMs = ms;
+    }
+    if (ms > hist->maxMs)
+    {
+        hist->maxMs = ms;
+    }
+    hist->totalMs += ms;
+    hist->count++;
+}
+
+uint32_t DsmccTransport::begin(uint32_t transId, uint16_t msgId, int sessionId, uint8_t attempts, uint32_t timerMs)
+{
+    uint32_t timeout = 0;
+
+    pthread_mutex_lock(&mMutex);
+    mStats.sent++;
+    if (attempts > 0)
+    {
+        Transaction txn;
+        txn.sessionId = sessionId;
+        txn.msgId = msgId;
+        txn.attemptsLeft = attempts;
+        txn.sends = 1;
+        txn.timerMs = timerMs ? timerMs : kDsmccTransportDefaultTimeoutMs;
+        txn.firstSentMs = monotonicNowMs();
+        mInFlight[transId] = txn;
+
+        mStats.inFlight = mInFlight.size();
+        if (mStats.inFlight > mStats.maxInFlight)
+        {
+            mStats.maxInFlight = mStats.inFlight;
+        }
+        timeout = timeoutMs(txn);
+        LOG(DLOGL_REALLY_NOISY, "transId:%x msgId:%x sessionId:%d inFlight:%d timeout:%d ms",
+            transId, msgId, sessionId, mStats.inFlight, timeout);
+    }
+    pthread_mutex_unlock(&mMutex);
+    return timeout;
+}
+
+eDsmccExpireResult DsmccTransport::expire(uint32_t transId, uint32_t *nextTimeoutMs)
+{
+    eDsmccExpireResult result = kDsmccExpire_NotInFlight;
+
+    pthread_mutex_lock(&mMutex);
+    std::map<uint32_t, Transaction>::iterator itr = mInFlight.find(transId);
+    if (itr != mInFlight.end())
+    {
+        Transaction &txn = itr->second;
+        if (txn.attemptsLeft <= 1)
+        {
+            LOG(DLOGL_ERROR, "transId:%x msgId:%x gave up after %d sends", transId, txn.msgId, txn.sends);
+            mInFlight.erase(itr);
+            mStats.inFlight = mInFlight.size();
+            mStats.timeouts++;
+            result = kDsmccExpire_GiveUp;
+        }
+        else
+        {
+            txn.attemptsLeft--;
+            txn.sends++;
+            mStats.sent++;
+            mStats.retransmits++;
+            *nextTimeoutMs = timeoutMs(txn);
+            result = kDsmccExpire_Retransmit;
+        }
+    }
+    pthread_mutex_unlock(&mMutex);
+    return result;
+}
+
+bool DsmccTransport::complete(uint32_t transId)
+{
+    bool found = false;
+
+    pthread_mutex_lock(&mMutex);
+    std::map<uint32_t, Transaction>::iterator itr = mInFlight.find(transId);
+    if (itr != mInFlight.end())
+    {
+        uint32_t latency = monotonicNowMs() - itr->second.firstSentMs;
+        addLatency(txnType(itr->second.msgId), latency);
+        LOG(DLOGL_REALLY_NOISY, "transId:%x msgId:%x sends:%d latency:%d ms", transId, itr->second.msgId, itr->second.sends, latency);
+        mInFlight.erase(itr);
+        mStats.inFlight = mInFlight.size();
+        mStats.completed++;
+        found = true;
+    }
+    else
+    {
+        mStats.unmatched++;
+    }
+    pthread_mutex_unlock(&mMutex);
+    return found;
+}
+
+bool DsmccTransport::findSession(uint32_t transId, int *sessionId)
+{
+    bool found = false;
+
+    pthread_mutex_lock(&mMutex);
+    std::map<uint32_t, Transaction>::iterator itr = mInFlight.find(transId);
+    if (itr != mInFlight.end())
+    {
+        *sessionId = itr->second.sessionId;
+        found = true;
+    }
+    pthread_mutex_unlock(&mMutex);
+    return found;
+}
+
+void DsmccTransport::cancelSession(int sessionId)
+{
+    pthread_mutex_lock(&mMutex);
+    std::map<uint32_t, Transaction>::iterator itr = mInFlight.begin();
+    while (itr != mInFlight.end())
+    {
+        if (itr->second.sessionId == sessionId)
+        {
+            mInFlight.erase(itr++);
+        }
+        else
+        {
+            ++itr;
+        }
+    }
+    mStats.inFlight = mInFlight.size();
+    pthread_mutex_unlock(&mMutex);
+}
+
+void DsmccTransport::getStats(tDsmccTransportStats *stats)
+{
+    pthread_mutex_lock(&mMutex);
+    *stats = mStats;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void DsmccTransport::logStats(void)
+{
+    tDsmccTransportStats stats;
+
+    getStats(&stats);
+    LOG(DLOGL_NORMAL, "inFlight:%d max:%d sent:%d retransmits:%d timeouts:%d completed:%d unmatched:%d",
+        stats.inFlight, stats.maxInFlight, stats.sent, stats.retransmits, stats.timeouts, stats.completed, stats.unmatched);
+
+    for (int type = 0; type < kDsmccTxn_Types; type++)
+    {
+        const tDsmccLatencyHistogram *hist = &stats.latency[type];
+        if (hist->count == 0)
+        {
+            continue;
+        }
+        LOG(DLOGL_NORMAL, "%s: count:%d min:%d avg:%d max:%d ms, <=10:%d <=20:%d <=50:%d <=100:%d <=200:%d <=500:%d <=1000:%d <=2000:%d <=5000:%d >5000:%d",
+            kTxnTypeName[type], hist->count, hist->minMs, (uint32_t)(hist->totalMs / hist->count), hist->maxMs,
+            hist->buckets[0], hist->buckets[1], hist->buckets[2], hist->buckets[3], hist->buckets[4],
+            hist->buckets[5], hist->buckets[6], hist->buckets[7], hist->buckets[8], hist->buckets[9]);
+    }
+}
@@ -0,0 +1,131 @@
+/**
+   \file dsmccTransport.h
+   \class DsmccTransport
+
+   DSM-CC session signalling transport shared by all VOD sessions.
+
+   One UDP socket carries the requests of every session to the SRM; any
+   number of transactions are in flight on it at once and a response is
+   matched to its request by transaction id, whatever its session id says.
+   For each transaction in flight the transport keeps the session that sent
+   it, its retransmit schedule and when it was first sent:
+
+    - begin() when a request is sent gives the time to its first retransmit,
+    - expire() when that time is up says whether to send it again and when
+      the next retransmit is due, doubling the wait up to 4 times the
+      configured message timer, or that the transaction gave up,
+    - complete() when the response arrives records the request to response
+      latency in the histogram of the request type.
+
+   The socket is drained by receive() until it is empty, so responses that
+   arrive together are handled in one wake-up of the event loop.
+*/
+
+#if !defined(DSMCC_TRANSPORT_H)
+#define DSMCC_TRANSPORT_H
+
+#include <stdint.h>
+#include <map>
+#include <pthread.h>
+
+#define kDsmccTransportDefaultTimeoutMs  2000   ///< when OnDemandSystemClient has no message timer
+#define kDsmccTransportMaxBackoff        4      ///< retransmit wait is at most this many message timers
+#define kDsmccLatencyBuckets             10     ///< up to 10, 20, 50, 100, 200, 500, 1000, 2000, 5000 ms and above
+
+/// Request types with their own latency histogram
+typedef enum
+{
+    kDsmccTxn_SessionSetup,
+    kDsmccTxn_Release,
+    kDsmccTxn_Status,
+    kDsmccTxn_Reset,
+    kDsmccTxn_Other,
+    kDsmccTxn_Types
+} eDsmccTxnType;
+
+typedef enum
+{
+    kDsmccExpire_Retransmit,     ///< send the request again
+    kDsmccExpire_GiveUp,         ///< out of retries, the transaction is over
+    kDsmccExpire_NotInFlight     ///< completed or cancelled since the timer was armed
+} eDsmccExpireResult;
+
+typedef struct
+{
+    unsigned int count;
+    unsigned int buckets[kDsmccLatencyBuckets];
+    unsigned int minMs;
+    unsigned int maxMs;
+    uint64_t     totalMs;
+} tDsmccLatencyHistogram;
+
+typedef struct
+{
+    unsigned int inFlight;
+    unsigned int maxInFlight;
+    unsigned int sent;
+    unsigned int retransmits;
+    unsigned int timeouts;        ///< transactions that gave up
+    unsigned int completed;
+    unsigned int unmatched;       ///< responses with no transaction in flight: late, duplicate or to an untracked request
+    tDsmccLatencyHistogram latency[kDsmccTxn_Types];
+} tDsmccTransportStats;
+
+class DsmccTransport
+{
+public:
+    static DsmccTransport* getInstance(void);
+
+    /// Socket bound to port, opened on first use and shared from then on
+    int32_t getSocket(uint16_t port);
+    /// Next datagram waiting on the socket without blocking, 0 when there is none
+    int32_t receive(uint8_t *buf, uint32_t size);
+
+    /// Tracks transId sent by sessionId, attempts is the number of timer expiries before giving up and
+    /// timerMs the configured message timer, 0 for the default.
+    /// Returns the time to the first retransmit in ms, 0 when attempts is 0 and it is not tracked
+    uint32_t begin(uint32_t transId, uint16_t msgId, int sessionId, uint8_t attempts, uint32_t timerMs);
+    /// The retransmit timer of transId expired, *nextTimeoutMs is set when it is to be sent again
+    eDsmccExpireResult expire(uint32_t transId, uint32_t *nextTimeoutMs);
+    /// The response to transId arrived, false when it is not in flight
+    bool complete(uint32_t transId);
+    /// Session that sent transId, false when it is not in flight
+    bool findSession(uint32_t transId, int *sessionId);
+    /// Forget the transactions of a session that is going away
+    void cancelSession(int sessionId);
+
+    void getStats(tDsmccTransportStats *stats);
+    void logStats(void);
+
+    static eDsmccTxnType txnType(uint16_t msgId);
+
+private:
+    struct Transaction
+    {
+        int          sessionId;
+        uint16_t     msgId;
+        uint8_t      attemptsLeft;
+        uint8_t      sends;
+        uint32_t     timerMs;
+        uint64_t     firstSentMs;
+    };
+
+    DsmccTransport();
+    ~DsmccTransport();
+
+    static uint32_t timeoutMs(const Transaction &txn);
+    void addLatency(eDsmccTxnType type, uint32_t ms);
+
+    pthread_mutex_t mMutex;
+    int32_t         mSocketFd;
+    std::map<uint32_t, Transaction> mInFlight;
+    tDsmccTransportStats mStats;
+
+    static DsmccTransport *mInstance;
+    static pthread_mutex_t mInstanceMutex;
+
+    DsmccTransport(const DsmccTransport&);
+    DsmccTransport& operator=(const DsmccTransport&);
+};
+
+#endif
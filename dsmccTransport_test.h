@@ -0,0 +1,125 @@
+/**
+
+\file dsmccTransport_test.h -- contains the cxxtest test cases for the shared DSM-CC transport
+
+The transport is the process wide one, used without its socket: the test
+drives begin(), expire() and complete() as VOD_SessionControl does on send,
+timer expiry and response.  Each test uses its own transaction ids and
+checks the statistics as differences, so the tests do not depend on order.
+*/
+
+#if !defined(DSMCC_TRANSPORT_TEST_H)
+#define DSMCC_TRANSPORT_TEST_H
+
+#include <cxxtest/TestSuite.h>
+
+#include "dsmccTransport.h"
+#include "dsmccProtocol.h"
+
+#define kTestTimerMs    100
+
+class dsmccTransportTestSuite : public CxxTest::TestSuite
+{
+public:
+
+    void testDemuxByTransactionId()
+    {
+        DsmccTransport *transport = DsmccTransport::getInstance();
+        tDsmccTransportStats before, after;
+        int sessionId = 0;
+
+        transport->getStats(&before);
+        TS_ASSERT_EQUALS(transport->begin(0x1001, dsmcc_ClientSessionSetUpRequest, 1, 3, kTestTimerMs), kTestTimerMs);
+        TS_ASSERT_EQUALS(transport->begin(0x1002, dsmcc_ClientStatusRequest, 2, 3, kTestTimerMs), kTestTimerMs);
+        TS_ASSERT_EQUALS(transport->begin(0x1003, dsmcc_ClientReleaseRequest, 1, 3, kTestTimerMs), kTestTimerMs);
+
+        // the session that sent the request, whatever the response says
+        TS_ASSERT(transport->findSession(0x1002, &sessionId));
+        TS_ASSERT_EQUALS(sessionId, 2);
+        TS_ASSERT(transport->findSession(0x1001, &sessionId));
+        TS_ASSERT_EQUALS(sessionId, 1);
+        TS_ASSERT(!transport->findSession(0x1004, &sessionId));
+
+        // responses in any order, a duplicate is not matched
+        TS_ASSERT(transport->complete(0x1003));
+        TS_ASSERT(!transport->findSession(0x1003, &sessionId));
+        TS_ASSERT(!transport->complete(0x1003));
+        TS_ASSERT(transport->complete(0x1002));
+
+        transport->getStats(&after);
+        TS_ASSERT_EQUALS(after.sent - before.sent, 3);
+        TS_ASSERT_EQUALS(after.completed - before.completed, 2);
+        TS_ASSERT_EQUALS(after.unmatched - before.unmatched, 1);
+        TS_ASSERT_EQUALS(after.inFlight, before.inFlight + 1);
+        TS_ASSERT(after.maxInFlight >= before.inFlight + 3);
+        TS_ASSERT_EQUALS(after.latency[kDsmccTxn_Release].count - before.latency[kDsmccTxn_Release].count, 1);
+        TS_ASSERT_EQUALS(after.latency[kDsmccTxn_Status].count - before.latency[kDsmccTxn_Status].count, 1);
+
+        // a session going away takes its transactions with it
+        transport->cancelSession(1);
+        TS_ASSERT(!transport->findSession(0x1001, &sessionId));
+        transport->getStats(&after);
+        TS_ASSERT_EQUALS(after.inFlight, before.inFlight);
+    }
+
+    void testUntracked()
+    {
+        DsmccTransport *transport = DsmccTransport::getInstance();
+        tDsmccTransportStats before, after;
+        int sessionId = 0;
+        uint32_t next = 0;
+
+        transport->getStats(&before);
+        TS_ASSERT_EQUALS(transport->begin(0x2001, dsmcc_ClientResetRequest, 3, 0, kTestTimerMs), 0);
+        TS_ASSERT(!transport->findSession(0x2001, &sessionId));
+        TS_ASSERT_EQUALS(transport->expire(0x2001, &next), kDsmccExpire_NotInFlight);
+
+        transport->getStats(&after);
+        TS_ASSERT_EQUALS(after.sent - before.sent, 1);
+        TS_ASSERT_EQUALS(after.inFlight, before.inFlight);
+    }
+
+    void testTimeoutBackoff()
+    {
+        DsmccTransport *transport = DsmccTransport::getInstance();
+        tDsmccTransportStats before, after;
+        uint32_t next = 0;
+
+        transport->getStats(&before);
+        TS_ASSERT_EQUALS(transport->begin(0x3001, dsmcc_ClientSessionSetUpRequest, 4, 4, kTestTimerMs), kTestTimerMs);
+
+        // doubling up to kDsmccTransportMaxBackoff message timers
+        TS_ASSERT_EQUALS(transport->expire(0x3001, &next), kDsmccExpire_Retransmit);
+        TS_ASSERT_EQUALS(next, 2 * kTestTimerMs);
+        TS_ASSERT_EQUALS(transport->expire(0x3001, &next), kDsmccExpire_Retransmit);
+        TS_ASSERT_EQUALS(next, 4 * kTestTimerMs);
+        TS_ASSERT_EQUALS(transport->expire(0x3001, &next), kDsmccExpire_Retransmit);
+        TS_ASSERT_EQUALS(next, kDsmccTransportMaxBackoff * kTestTimerMs);
+
+        // out of attempts, a late response is not matched
+        TS_ASSERT_EQUALS(transport->expire(0x3001, &next), kDsmccExpire_GiveUp);
+        TS_ASSERT_EQUALS(transport->expire(0x3001, &next), kDsmccExpire_NotInFlight);
+        TS_ASSERT(!transport->complete(0x3001));
+
+        transport->getStats(&after);
+        TS_ASSERT_EQUALS(after.sent - before.sent, 4);
+        TS_ASSERT_EQUALS(after.retransmits - before.retransmits, 3);
+        TS_ASSERT_EQUALS(after.timeouts - before.timeouts, 1);
+        TS_ASSERT_EQUALS(after.unmatched - before.unmatched, 1);
+        TS_ASSERT_EQUALS(after.completed, before.completed);
+        TS_ASSERT_EQUALS(after.inFlight, before.inFlight);
+    }
+
+    void testCompletedBeforeTimer()
+    {
+        DsmccTransport *transport = DsmccTransport::getInstance();
+        uint32_t next = 0;
+
+        // no message timer configured
+        TS_ASSERT_EQUALS(transport->begin(0x4001, dsmcc_ClientSessionSetUpRequest, 5, 2, 0), kDsmccTransportDefaultTimeoutMs);
+        TS_ASSERT(transport->complete(0x4001));
+        TS_ASSERT_EQUALS(transport->expire(0x4001, &next), kDsmccExpire_NotInFlight);
+    }
+};
+
+#endif
@@ -42,9 +42,13 @@
 #include "psi.h"
 #include "AnalogPsi.h"
 #include "eventQueue.h"
+#include "MSPWorkerPool.h"
 
 #include "IMediaPlayer.h"
 #include "TsbHandler.h"
+#include "drivePlacement.h"
+#include "tsbConversion.h"
+#include "monotonicTime.h"
 #include "MSPSourceFactory.h"
 #include "MSPPPVSource.h"
 #include "pthread_named.h"
@@ -94,35 +98,35 @@ bool Dvr::mEasAudioActive = false;
 
 /** *********************************************************
 */
-void* Dvr::eventthreadFunc(void *aData)
+bool Dvr::eventHandler(void *aData, Event *evt)
 {
     bool done = false;
     Dvr *inst = (Dvr *)aData;
-    Event *evt;
 
-    FNLOG(DL_MSP_DVR);
+    inst->lockMutex();
+    dlog(DL_MSP_DVR, DLOGL_REALLY_NOISY, "Event strand got event %d ", evt->eventType);
+    done = inst->dispatchEvent(evt);  // call member function to handle event
+    inst->mThreadEventQueue->freeEvent(evt);
+    inst->unLockMutex();
 
-    while (!done)
+    if (done)
     {
-        unsigned int waitTime = 0;
-        if (inst->mState == kDvrWaitSourceReady)
-        {
-            dlog(DL_MSP_DVR, DLOGL_REALLY_NOISY, "Inside Wait for Tuner lock\n");
-            waitTime = TIMEOUT;
-        }
-        inst->mThreadEventQueue->setTimeOutSecs(waitTime);
-        evt = inst->mThreadEventQueue->popEventQueue();
-        inst->mThreadEventQueue->unSetTimeOut();
-        inst->lockMutex();
-        dlog(DL_MSP_DVR, DLOGL_REALLY_NOISY, "Event thread got event %d ", evt->eventType);
-        done = inst->dispatchEvent(evt);  // call member function to handle event
-        inst->mThreadEventQueue->freeEvent(evt);
-        inst->unLockMutex();
+        dlog(DL_MSP_DVR, DLOGL_NOISE, "Exiting Dvr event strand\n");
     }
+    return done;
+}
 
-    dlog(DL_MSP_DVR, DLOGL_NOISE, "Exiting Dvr event thread\n");
-    pthread_exit(NULL);
-    return NULL;
+unsigned int Dvr::eventIdleTimeout(void *aData)
+{
+    Dvr *inst = (Dvr *)aData;
+    unsigned int waitTime = 0;
+
+    if (inst->mState == kDvrWaitSourceReady)
+    {
+        dlog(DL_MSP_DVR, DLOGL_REALLY_NOISY, "Inside Wait for Tuner lock\n");
+        waitTime = TIMEOUT;
+    }
+    return waitTime;
 }
 
 void Dvr::StartDwellTimerForTsb()
@@ -1151,26 +1155,12 @@ eIMediaPlayerStatus Dvr::Load(const char* aServiceUrl, const MultiMediaEvent **p
     dlog(DL_MSP_DVR, DLOGL_REALLY_NOISY, "%s, %d, Start TV time", __FUNCTION__, __LINE__);
     gettimeofday(&tv_start, 0);
 
-    if ((status == kMspStatus_Ok || status == kMspStatus_Loading) && (mEventHandlerThread == 0))
+    if ((status == kMspStatus_Ok || status == kMspStatus_Loading) && (mEventStrand == NULL))
     {
-        int threadRetvalue;
-        pthread_attr_t attr;
-        pthread_attr_init(&attr);
-        pthread_attr_setstacksize(&attr, (128 * 1024)); //128kb
-
-        // By default the thread is created as joinable.
-        threadRetvalue = pthread_create(&mEventHandlerThread, &attr, eventthreadFunc, (void *) this);
-        if (threadRetvalue)
-        {
-            LOG(DLOGL_ERROR, "pthread_create error %d", threadRetvalue);
-        }
-        dlog(DL_MSP_MPLAYER, DLOGL_REALLY_NOISY, "Created event thread handle %x", (unsigned int)mEventHandlerThread);
-
-        threadRetvalue = pthread_setname_np(mEventHandlerThread, "DVR Cntrl Event Handler");
-        if (threadRetvalue)
-        {
-            LOG(DLOGL_ERROR, "thread naming error %d", threadRetvalue);
-        }
+        // events are handled on the shared MSP worker pool, serially for this instance
+        mEventStrand = new MSPStrand("DVR Cntrl Event Handler", mThreadEventQueue, eventHandler, eventIdleTimeout, (void *) this);
+        mEventStrand->start();
+        dlog(DL_MSP_MPLAYER, DLOGL_REALLY_NOISY, "Started event strand %p", mEventStrand);
 
         mState = kDvrStateStop;
 
@@ -1192,13 +1182,14 @@ void Dvr::Eject()
         mDwellTimerThread = 0;
     }
 
-    if (mEventHandlerThread)
+    if (mEventStrand)
     {
-        queueEvent(kDvrEventExit);  // tell thread to exit
+        queueEvent(kDvrEventExit);  // tell strand to exit
         unLockMutex();
-        pthread_join(mEventHandlerThread, NULL);       // wait for event thread to exit
+        mEventStrand->join();       // wait for exit event to be handled
+        delete mEventStrand;
         lockMutex();
-        mEventHandlerThread = 0;
+        mEventStrand = NULL;
     }
 
 
@@ -1521,6 +1512,13 @@ void Dvr::SetRecordDrive()
             mTsbHardDrive = 1;
             LOG(DLOGL_MINOR_DEBUG, "external");
         }
+        else if (mTsbHardDrive == -1)
+        {
+            // no TSB to convert yet: the TSB and the recording from it go to the less loaded drive
+            mTsbHardDrive = DrivePlacement::getInstance()->chooseDrive(kDriveLoad_Recording, 0, 2 * TSB_VIDEO_BITRATE,
+                            Csci_Dvr_GetTsbDrive());
+            LOG(DLOGL_MINOR_DEBUG, "no drive specified in record URL, placed on drive %d", mTsbHardDrive);
+        }
         else
         {
             LOG(DLOGL_MINOR_DEBUG, "no drive specified in record URL");
@@ -1538,6 +1536,9 @@ void Dvr::SetRecordDrive()
     }
 
     LOG(DLOGL_MINOR_DEBUG, "mTsbHardDrive: %d", mTsbHardDrive);
+
+    // have the TSBs of the drive created ahead of the next sessions
+    TsbHandler::getTsbHandlerInstance()->getTsbPool()->prepareDrive(mTsbHardDrive);
 }
 
 
@@ -1612,6 +1613,10 @@ eMspStatus Dvr::StartPersistentRecording()
 
     SetRecordFilename();  // sets mRecFile to full path.  //setting the record file path here,so that path of recording URL has been set,after TSB has been created (as both should be on same drive)
 
+    // on the drive of the TSB the platform converts in place instead of copying what is buffered
+    mRecFile = TsbConversion::getInstance()->placeRecording(mPtrRecSession->GetTsbFileName(), mRecFile,
+               nptRecordStopTimeMs - nptRecordStartTimeMs);
+
     LOG(DLOGL_NOISE, "nptRecordStartTimeMs: %d  nptRecordStopTimeMs: %d", nptRecordStartTimeMs, nptRecordStopTimeMs);
 
     status = mPtrRecSession->startConvert(mRecFile, nptRecordStartTimeMs, nptRecordStopTimeMs);
@@ -2878,13 +2883,14 @@ Dvr::~Dvr()
         mDwellTimerThread = 0;
     }
 
-    if (mEventHandlerThread)
+    if (mEventStrand)
     {
-        queueEvent(kDvrEventExit);  // tell thread to exit
+        queueEvent(kDvrEventExit);  // tell strand to exit
         unLockMutex();
-        pthread_join(mEventHandlerThread, NULL);      // wait for event thread to exit
+        mEventStrand->join();       // wait for exit event to be handled
+        delete mEventStrand;
         lockMutex();
-        mEventHandlerThread = 0;
+        mEventStrand = NULL;
     }
 
     if (mPtrFileSource != NULL)
@@ -2977,7 +2983,7 @@ Dvr::Dvr(IMediaPlayerSession *pIMediaPlayerSession)
     mPtrDispSession  = NULL;
     mPtrPsi = new Psi();
     mPtrRecSession = NULL;
-    mEventHandlerThread = 0;
+    mEventStrand = NULL;
     mDwellTimerThread = 0;
 
     mScreenRect.x = 0;
@@ -3611,9 +3617,16 @@ eMspStatus Dvr::StartTSBRecordSession(std::string first_fragment_file)
 
     LOG(DLOGL_MINOR_DEBUG, "get_tsb mTsbNumber: %d", mTsbNumber);
 
+    if (mTsbHardDrive == -1)
+    {
+        // as MSPRecordSession::open would, so that a TSB ready on the drive is taken
+        mTsbHardDrive = DrivePlacement::getInstance()->chooseDrive(kDriveLoad_Tsb, 0, TSB_VIDEO_BITRATE, Csci_Dvr_GetTsbDrive());
+    }
+    tsbhandler->getTsbPool()->prepareDrive(mTsbHardDrive);
+
     if (mPtrRecSession == NULL) //sometimes, Record session might be attempted to create more than once,if previous attempt failed.
     {
-        eMspStatus status = tsbhandler->get_tsb(&mTsbNumber);
+        eMspStatus status = tsbhandler->get_tsb(&mTsbNumber, mTsbHardDrive);
         if (status != kMspStatus_Ok)
         {
             LOG(DLOGL_ERROR, "Error: No available TSB");
@@ -3625,6 +3638,9 @@ eMspStatus Dvr::StartTSBRecordSession(std::string first_fragment_file)
 
     if (mPtrRecSession && mPtrLiveSource)
     {
+        struct timespec openStart;
+        clock_gettime(CLOCK_MONOTONIC, &openStart);
+
         LOG(DLOGL_MINOR_DEBUG, "mPtrRecSession: %p  call open with mTsbHardDrive: %d  mTsbNumber: %d" ,
             mPtrRecSession, mTsbHardDrive, mTsbNumber);
 
@@ -3644,6 +3660,7 @@ eMspStatus Dvr::StartTSBRecordSession(std::string first_fragment_file)
         if (status != kMspStatus_Ok)
         {
             LOG(DLOGL_ERROR, "Error: mPtrRecSession->open ");
+            tsbhandler->getTsbPool()->recordOpen(mTsbNumber, 0, false);
             return status;
         }
 
@@ -3669,6 +3686,9 @@ eMspStatus Dvr::StartTSBRecordSession(std::string first_fragment_file)
             status = mPtrRecSession->start();
         }
 
+        // open latency of the TSB, from a ready buffer of the pool or not
+        tsbhandler->getTsbPool()->recordOpen(mTsbNumber, monotonicElapsedMs(openStart), (status == kMspStatus_Ok));
+
         if (status != kMspStatus_Ok)
         {
             LOG(DLOGL_ERROR, "Error: Unable to start TSB!");
@@ -3714,6 +3734,9 @@ eMspStatus Dvr::StopRecordSession()
             LOG(DLOGL_ERROR, "Error release_tsb status: %d  mTsbNumber: %d", status, mTsbNumber);
         }
         mTsbNumber = 0xffff;
+        tsbhandler->getTsbPool()->logStats();
+        DrivePlacement::getInstance()->logLoads();
+        TsbConversion::getInstance()->logStats();
     }
 
     return kMspStatus_Ok;
@@ -34,6 +34,7 @@
 class DisplaySession;
 class MSPRecordSession;
 class MSPEventQueue;
+class MSPStrand;
 class Event;
 class MSPFileSource;
 #define TSB_DwellTime 10  //dwell time 10 seconds
@@ -208,7 +209,8 @@ private:
     eDvrState getDvrState(void);
 
     static void* dwellTimerFun(void *data);
-    static void* eventthreadFunc(void *data);
+    static bool eventHandler(void *data, Event *evt);
+    static unsigned int eventIdleTimeout(void *data);
     static void sourceCB(void *aData, eSourceState aSrcState);
     static void mediaCB(void *clientInst, tCpeMediaCallbackTypes type);
     static void psiCallback(ePsiCallBackState state, void *data);
@@ -266,7 +268,7 @@ private:
     bool mEnaAudio;
     int mPackets;  // number of packets sent to JS
     MSPEventQueue* mThreadEventQueue;
-    pthread_t mEventHandlerThread;
+    MSPStrand* mEventStrand;           // runs mThreadEventQueue on the shared MSP worker pool
     pthread_t mDwellTimerThread;
     pthread_mutex_t  mMutex;
     std::list<CallbackInfo*> mCallbackList;
@@ -0,0 +1,373 @@
+/**
+   \file dvrMetadataIndex.cpp
+   \class DvrMetadataIndex
+
+Implementation file for the indexed recording metadata
+*/
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <dlog.h>
+#include <cpe_recmgr.h>
+
+#include "dvrMetadataIndex.h"
+#include "recordingPsiIndex.h"
+#include "recordMetadataJournal.h"
+#include "pmt.h"
+
+#define LOG(level, msg, args...)  dlog(DL_MSP_DVR, level,"DvrMetadataIndex:%s:%d " msg, __FUNCTION__, __LINE__, ##args);
+
+DvrMetadataIndex* DvrMetadataIndex::mInstance = NULL;
+pthread_mutex_t DvrMetadataIndex::mInstanceMutex = PTHREAD_MUTEX_INITIALIZER;
+
+DvrMetadataIndex* DvrMetadataIndex::getInstance(void)
+{
+    pthread_mutex_lock(&mInstanceMutex);
+    if (mInstance == NULL)
+    {
+        mInstance = new DvrMetadataIndex();
+    }
+    pthread_mutex_unlock(&mInstanceMutex);
+    return mInstance;
+}
+
+DvrMetadataIndex::DvrMetadataIndex(unsigned int maxFiles)
+{
+    pthread_mutex_init(&mMutex, NULL);
+    mMaxFiles = maxFiles;
+    mUseCount = 0;
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+DvrMetadataIndex::~DvrMetadataIndex()
+{
+    // entries still acquired are left to their holders
+    std::map<std::string, Entry *>::iterator itr;
+    for (itr = mEntries.begin(); itr != mEntries.end(); ++itr)
+    {
+        if (itr->second->refs == 0)
+        {
+            destroy(itr->second);
+        }
+        else
+        {
+            itr->second->cached = false;
+        }
+    }
+    mEntries.clear();
+    pthread_mutex_destroy(&mMutex);
+}
+
+int64_t DvrMetadataIndex::nowSecs(void)
+{
+    return time(NULL);
+}
+
+bool DvrMetadataIndex::getFileStamp(const std::string &file, int64_t *mtime, int64_t *size, bool *journaled)
+{
+    struct stat st;
+
+    if (stat(file.c_str(), &st) != 0)
+    {
+        return false;
+    }
+    *mtime = RecordMetadataJournal::mtimeNs(st);
+    *size = st.st_size;
+    *journaled = RecordMetadataJournal::addStamp(file, mtime, size);
+    return true;
+}
+
+const tDvrMetadataInfo* DvrMetadataIndex::acquire(const std::string &file)
+{
+    int64_t mtime, size;
+    bool journaled;
+    bool exists = getFileStamp(file, &mtime, &size, &journaled);
+
+    pthread_mutex_lock(&mMutex);
+    std::map<std::string, Entry *>::iterator itr = mEntries.find(file);
+    if (itr != mEntries.end())
+    {
+        Entry *entry = itr->second;
+        if (exists && (entry->mtime == mtime) && (entry->size == size))
+        {
+            mStats.hits++;
+            entry->refs++;
+            entry->lastUse = ++mUseCount;
+            pthread_mutex_unlock(&mMutex);
+            return entry;
+        }
+        dropLocked(entry);
+    }
+    if (!exists)
+    {
+        mStats.failures++;
+        pthread_mutex_unlock(&mMutex);
+        LOG(DLOGL_ERROR, "no metadata file %s", file.c_str());
+        return NULL;
+    }
+    mStats.misses++;
+    pthread_mutex_unlock(&mMutex);
+
+    // the file is read without the lock, another acquire() of it may index it too
+    Entry *entry = build(file, mtime, size, journaled);
+
+    pthread_mutex_lock(&mMutex);
+    if (entry == NULL)
+    {
+        mStats.failures++;
+        pthread_mutex_unlock(&mMutex);
+        return NULL;
+    }
+    entry->refs = 1;
+    entry->lastUse = ++mUseCount;
+    if (!isSettled(mtime))
+    {
+        // the caller's copy only, destroyed by release()
+        mStats.unsettled++;
+        pthread_mutex_unlock(&mMutex);
+        return entry;
+    }
+    itr = mEntries.find(file);
+    if (itr != mEntries.end())
+    {
+        dropLocked(itr->second);
+    }
+    entry->cached = true;
+    mEntries[file] = entry;
+    evictLocked();
+    pthread_mutex_unlock(&mMutex);
+    return entry;
+}
+
+void DvrMetadataIndex::release(const tDvrMetadataInfo *info)
+{
+    if (info == NULL)
+    {
+        return;
+    }
+
+    Entry *entry = static_cast<Entry *>(const_cast<tDvrMetadataInfo *>(info));
+    pthread_mutex_lock(&mMutex);
+    if ((--entry->refs == 0) && !entry->cached)
+    {
+        destroy(entry);
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+void DvrMetadataIndex::dropLocked(Entry *entry)
+{
+    mEntries.erase(entry->file);
+    entry->cached = false;
+    if (entry->refs == 0)
+    {
+        destroy(entry);
+    }
+}
+
+void DvrMetadataIndex::evictLocked(void)
+{
+    while (mEntries.size() > mMaxFiles)
+    {
+        Entry *oldest = NULL;
+        std::map<std::string, Entry *>::iterator itr;
+        for (itr = mEntries.begin(); itr != mEntries.end(); ++itr)
+        {
+            if ((itr->second->refs == 0) && ((oldest == NULL) || (itr->second->lastUse < oldest->lastUse)))
+            {
+                oldest = itr->second;
+            }
+        }
+        if (oldest == NULL)
+        {
+            // all in use
+            break;
+        }
+        dropLocked(oldest);
+        mStats.evictions++;
+    }
+}
+
+bool DvrMetadataIndex::isSettled(int64_t mtime)
+{
+    return (nowSecs() - (mtime / 1000000000)) >= kDvrMetadataIndexSettleSecs;
+}
+
+DvrMetadataIndex::Entry* DvrMetadataIndex::build(const std::string &file, int64_t mtime, int64_t size, bool journaled)
+{
+    Entry *entry = new Entry;
+    entry->file = file;
+    entry->mtime = mtime;
+    entry->size = size;
+    entry->refs = 0;
+    entry->lastUse = 0;
+    entry->cached = false;
+
+    int fd = open(file.c_str(), O_RDONLY);
+    struct stat st;
+    if ((fd < 0) || (fstat(fd, &st) != 0) || (st.st_size < (off_t) sizeof(tCpeRecDataBase)))
+    {
+        LOG(DLOGL_ERROR, "error: file: %s fd: %d", file.c_str(), fd);
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+        delete entry;
+        return NULL;
+    }
+
+    entry->data.resize(st.st_size);
+    ssize_t result = pread(fd, &entry->data[0], st.st_size, 0);
+    close(fd);
+    if (result != st.st_size)
+    {
+        LOG(DLOGL_ERROR, "error read %s read %d bytes - expected %d", file.c_str(), (int) result, (int) st.st_size);
+        delete entry;
+        return NULL;
+    }
+    if (journaled)
+    {
+        RecordMetadataJournal::apply(file, entry->data);
+    }
+
+    if (!index(entry, &entry->data[0], entry->data.size()))
+    {
+        LOG(DLOGL_ERROR, "%s is not a metadata database", file.c_str());
+        destroy(entry);
+        return NULL;
+    }
+    return entry;
+}
+
+bool DvrMetadataIndex::index(Entry *entry, const uint8_t *db, size_t size)
+{
+    const tCpeRecDataBase *base = (const tCpeRecDataBase *) db;
+
+    entry->blobType = kInvalid_Blob;
+    entry->caBlob = NULL;
+    entry->caBlobSize = 0;
+    entry->caDesc = NULL;
+    entry->caDescSize = 0;
+    entry->pmtTag = 0;
+    entry->pmt = NULL;
+    entry->pmtSize = 0;
+    entry->scramblingMode = 0;
+    entry->cci = 0;
+
+    if ((size < sizeof(tCpeRecDataBase)) || (base->dbHdr.dbCounts > kCpeRec_DataBaseEntries))
+    {
+        return false;
+    }
+    entry->cci = base->dbHdr.CCI;
+
+    // the same picks as GetDecryptCABlob(), GetDecryptCADesc() and GetScramblingMode()
+    for (int i = 0; i < base->dbHdr.dbCounts; i++)
+    {
+        uint32_t tag = base->dbEntry[i].tag;
+        uint32_t offset = base->dbEntry[i].offset;
+        uint32_t length = base->dbEntry[i].size;
+
+        if ((offset > size) || (length > size - offset))
+        {
+            LOG(DLOGL_ERROR, "%s tag 0x%x offset 0x%x size %d past the end", entry->file.c_str(), tag, offset, length);
+            continue;
+        }
+
+        switch (tag)
+        {
+        case kRecMetaTag_CaBlob:
+        case kRecMetaTag_SaraCaBlob:
+            if (entry->caBlob == NULL)
+            {
+                entry->blobType = (tag == kRecMetaTag_CaBlob) ? kRTN_Blob : kSARA_Blob;
+                entry->caBlob = db + offset;
+                entry->caBlobSize = length;
+            }
+            break;
+
+        case kRecMetaTag_CaDescriptor:
+            entry->caDesc = db + offset;
+            entry->caDescSize = length;
+            break;
+
+        case kRecMetaTag_MspPmt:
+        case kRecMetaTag_SaraPmt:
+            entry->pmtTag = tag;
+            entry->pmt = db + offset;
+            entry->pmtSize = length;
+            pmtScramblingMode(tag, db + offset, length, &entry->scramblingMode);
+            break;
+
+        default:
+            break;
+        }
+    }
+    return true;
+}
+
+void DvrMetadataIndex::destroy(Entry *entry)
+{
+    delete entry;
+}
+
+bool DvrMetadataIndex::pmtScramblingMode(uint32_t tag, const uint8_t *pmtData, uint32_t size, uint8_t *mode)
+{
+    tCpePgrmHandleMpegDesc cakDescriptor;
+    tCpePgrmHandleMpegDesc cakSystemDescriptor;
+    bool found = false;
+    Pmt pmt;
+
+    // the parsers only read the buffer
+    if (tag == kRecMetaTag_MspPmt)
+    {
+        pmt.populateMSPMetaData((uint8_t *) pmtData, size);
+    }
+    else
+    {
+        pmt.populateFromSaraMetaData((uint8_t *) pmtData, size);
+    }
+
+    std::list<tPid>* videoList = pmt.getVideoPidList();
+    if (videoList->size())
+    {
+        std::list<tPid>::iterator iter = videoList->begin();
+        cakDescriptor.tag = 0x9;
+        cakDescriptor.dataLen = 0;
+        cakDescriptor.data = NULL;
+        if (pmt.getDescriptor(&cakDescriptor, (*iter).pid) == kMspStatus_Ok)
+        {
+            // now get the CA system descriptor
+            cakSystemDescriptor.tag = 0x65;
+            cakSystemDescriptor.dataLen = 0;
+            cakSystemDescriptor.data = NULL;
+            if (pmt.getDescriptor(&cakSystemDescriptor, (*iter).pid) == kMspStatus_Ok)
+            {
+                *mode = cakSystemDescriptor.data[0];
+                found = true;
+                pmt.releaseDescriptor(&cakSystemDescriptor);
+            }
+        }
+        pmt.releaseDescriptor(&cakDescriptor);
+    }
+    return found;
+}
+
+void DvrMetadataIndex::getStats(tDvrMetadataIndexStats *stats)
+{
+    pthread_mutex_lock(&mMutex);
+    *stats = mStats;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void DvrMetadataIndex::logStats(void)
+{
+    tDvrMetadataIndexStats stats;
+
+    getStats(&stats);
+    LOG(DLOGL_NORMAL, "hits:%d misses:%d unsettled:%d failures:%d evictions:%d",
+        stats.hits, stats.misses, stats.unsettled, stats.failures, stats.evictions);
+}
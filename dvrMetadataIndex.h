@@ -0,0 +1,136 @@
+/**
+   \file dvrMetadataIndex.h
+   \class DvrMetadataIndex
+
+   Indexed metadata of the recordings being served or played.
+
+   Every MRDVR serve request, segment change and resumed recording used to
+   read the whole metadata database of the file with ReadMrdvrMetaData(),
+   then walk it once for the CA blob, once for the CA descriptor and once
+   more to parse the PMT for the scrambling mode, allocating a copy of each.
+
+   The index reads the metadata file once, with its journal applied (see
+   recordMetadataJournal.h), and keeps, per file, where the CA blob, the CA
+   descriptor and the PMT are in the copy together with the scrambling
+   mode, so acquire() of a file seen before is a stat() and a map lookup and
+   hands out pointers into the copy without allocating.  An entry is used
+   while the file keeps the modification time and size it was indexed with.
+   The file is not mapped: the record session rewrites the metadata of a
+   recording in progress, and a mapped file cut meanwhile would fault its
+   readers.
+
+   An entry of a file that changed within the last
+   kDvrMetadataIndexSettleSecs is not kept, the next acquire() reads it
+   again: a rewrite of the same size within the timestamp granularity of
+   the drive would not change its stamp.
+
+   The data stays valid until release(), even when the file changes or the
+   entry is dropped from the cache meanwhile.
+*/
+
+#if !defined(DVR_METADATA_INDEX_H)
+#define DVR_METADATA_INDEX_H
+
+#include <stdint.h>
+#include <string>
+#include <map>
+#include <vector>
+#include <pthread.h>
+
+#define kDvrMetadataIndexMaxFiles     64     ///< files kept indexed, least recently used is dropped first
+#define kDvrMetadataIndexSettleSecs   10     ///< files changed more recently are not kept
+
+typedef enum
+{
+    kInvalid_Blob = -1,
+    kSARA_Blob,
+    kRTN_Blob
+} eBlobType;
+
+/**
+   What the players and the MRDVR server read from the metadata of a file.
+   The data points into the copy of the file, NULL and 0 for an entry it does not have
+*/
+typedef struct
+{
+    eBlobType      blobType;
+    const uint8_t *caBlob;
+    uint32_t       caBlobSize;
+    const uint8_t *caDesc;          ///< RTN CA descriptor
+    uint32_t       caDescSize;
+    uint32_t       pmtTag;          ///< MSP or SARA PMT
+    const uint8_t *pmt;
+    uint32_t       pmtSize;
+    uint8_t        scramblingMode;
+    uint8_t        cci;
+} tDvrMetadataInfo;
+
+typedef struct
+{
+    unsigned int hits;
+    unsigned int misses;            ///< not indexed or file changed since
+    unsigned int unsettled;         ///< of these, files changed within kDvrMetadataIndexSettleSecs, not kept
+    unsigned int failures;
+    unsigned int evictions;
+} tDvrMetadataIndexStats;
+
+class DvrMetadataIndex
+{
+public:
+    static DvrMetadataIndex* getInstance(void);
+
+    /// The unit test uses its own index, the players the one of getInstance()
+    explicit DvrMetadataIndex(unsigned int maxFiles = kDvrMetadataIndexMaxFiles);
+    virtual ~DvrMetadataIndex();
+
+    /// The metadata of file, indexed on first use or when it changed; NULL when
+    /// the file is missing or not a metadata database.  Valid until release()
+    const tDvrMetadataInfo* acquire(const std::string &file);
+    void release(const tDvrMetadataInfo *info);
+
+    /// Scrambling mode of the CA system descriptor of the first video of a PMT
+    /// entry, false when it has none
+    static bool pmtScramblingMode(uint32_t tag, const uint8_t *pmt, uint32_t size, uint8_t *mode);
+
+    void getStats(tDvrMetadataIndexStats *stats);
+    void logStats(void);
+
+protected:
+    /// Wall clock in seconds, overridden by the unit test
+    virtual int64_t nowSecs(void);
+
+private:
+    struct Entry : public tDvrMetadataInfo
+    {
+        std::string          file;
+        int64_t              mtime;        ///< nanoseconds, see RecordMetadataJournal::mtimeNs()
+        int64_t              size;
+        std::vector<uint8_t> data;         ///< the file read with its journal applied
+        unsigned int         refs;
+        unsigned int         lastUse;
+        bool                 cached;       ///< in mEntries
+    };
+
+    static bool getFileStamp(const std::string &file, int64_t *mtime, int64_t *size, bool *journaled);
+    Entry* build(const std::string &file, int64_t mtime, int64_t size, bool journaled);
+    /// True when the file of stamp mtime has not changed for kDvrMetadataIndexSettleSecs
+    bool isSettled(int64_t mtime);
+    static bool index(Entry *entry, const uint8_t *db, size_t size);
+    static void destroy(Entry *entry);
+    void dropLocked(Entry *entry);
+    void evictLocked(void);
+
+    pthread_mutex_t mMutex;
+    std::map<std::string, Entry *> mEntries;
+    unsigned int    mMaxFiles;
+    unsigned int    mUseCount;         ///< lastUse clock for the LRU
+    tDvrMetadataIndexStats mStats;
+
+    static DvrMetadataIndex *mInstance;
+    static pthread_mutex_t mInstanceMutex;
+
+    DvrMetadataIndex(const DvrMetadataIndex&);
+    DvrMetadataIndex& operator=(const DvrMetadataIndex&);
+};
+
+#endif
@@ -0,0 +1,245 @@
+/** @file dvrMetadataIndex_bench.cpp
+ *
+ * @brief Measures the metadata lookups of the players with and without the index.
+ *
+ * 500 recordings are written to a directory (argument 1, /tmp by default),
+ * each with an MSP PMT, a 2KB CA blob, a CA descriptor and the caption
+ * service entry.  Every recording is then looked up kBenchRounds times:
+ *  - reading the whole file and copying the CA blob, the CA descriptor and
+ *    parsing the PMT for the scrambling mode, what ReadMrdvrMetaData(),
+ *    GetDecryptCABlob(), GetDecryptCADesc() and GetScramblingMode() did
+ *    for each serve request before the index,
+ *  - with DvrMetadataIndex::acquire() and release(), the first round
+ *    reading and indexing the files, the following ones hitting the cache.
+ * The index holds kDvrMetadataIndexMaxFiles files, so a second pass is
+ * made with a cache large enough for all the recordings.
+ * Build with "make dvrMetadataIndex_bench" and run on the target.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+
+#include <cpe_recmgr.h>
+#include <cpe_programhandle.h>
+
+#include "dvrMetadataIndex.h"
+#include "recordingPsiIndex.h"
+#include "recordMetadataJournal.h"
+
+#define kBenchRecordings   500
+#define kBenchRounds       10
+#define kBenchCaBlobSize   2048
+
+// the files are written before the run: keep them all
+class BenchDvrMetadataIndex : public DvrMetadataIndex
+{
+public:
+    explicit BenchDvrMetadataIndex(unsigned int maxFiles) : DvrMetadataIndex(maxFiles) {}
+
+protected:
+    int64_t nowSecs(void)
+    {
+        return time(NULL) + kDvrMetadataIndexSettleSecs;
+    }
+};
+
+static double nowSecs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+static void putBytes(std::vector<uint8_t> &buf, const void *data, uint32_t size)
+{
+    buf.insert(buf.end(), (const uint8_t *) data, (const uint8_t *) data + size);
+}
+
+// video and two audios, CA and CA system descriptors on the video
+static std::vector<uint8_t> makeMspPmt(void)
+{
+    std::vector<uint8_t> pmt;
+    tCpePgrmHandlePmt header;
+    tCpePgrmHandleMpegDesc desc;
+    tCpePgrmHandleEsData es;
+    uint8_t mode = 2;
+
+    memset(&header, 0, sizeof(header));
+    header.clockPid = 0x100;
+    header.esCount = 3;
+    putBytes(pmt, &header, sizeof(header));
+
+    memset(&es, 0, sizeof(es));
+    es.streamType = kCpeStreamType_H264_Video;
+    es.pid = 0x100;
+    es.descCount = 2;
+    es.ppEsDesc = (tCpePgrmHandleMpegDesc **) 1;
+    putBytes(pmt, &es, sizeof(es));
+    memset(&desc, 0, sizeof(desc));
+    desc.tag = 0x09;
+    desc.dataLen = 4;
+    putBytes(pmt, &desc, sizeof(desc));
+    putBytes(pmt, "\x0e\x00\xe0\x40", 4);
+    desc.tag = 0x65;
+    desc.dataLen = 1;
+    putBytes(pmt, &desc, sizeof(desc));
+    putBytes(pmt, &mode, 1);
+
+    for (int i = 0; i < 2; i++)
+    {
+        memset(&es, 0, sizeof(es));
+        es.streamType = kCpeStreamType_GI_Audio;
+        es.pid = 0x101 + i;
+        putBytes(pmt, &es, sizeof(es));
+    }
+    return pmt;
+}
+
+// the old lookup: whole file in, CA blob and descriptor copied, PMT parsed
+static bool readLookup(const std::string &file, uint8_t *mode)
+{
+    struct stat st;
+    if (stat(file.c_str(), &st) != 0)
+    {
+        return false;
+    }
+    uint8_t *db = new uint8_t[st.st_size];
+    FILE *fp = fopen(file.c_str(), "rb");
+    if ((fp == NULL) || (fread(db, st.st_size, 1, fp) != 1))
+    {
+        if (fp != NULL)
+        {
+            fclose(fp);
+        }
+        delete [] db;
+        return false;
+    }
+    fclose(fp);
+
+    tCpeRecDataBase *base = (tCpeRecDataBase *) db;
+    uint8_t *caBlob = NULL;
+    uint8_t *caDesc = NULL;
+    for (int i = 0; i < base->dbHdr.dbCounts; i++)
+    {
+        if ((base->dbEntry[i].tag == kRecMetaTag_CaBlob) && (caBlob == NULL))
+        {
+            caBlob = new uint8_t[base->dbEntry[i].size];
+            memcpy(caBlob, db + base->dbEntry[i].offset, base->dbEntry[i].size);
+        }
+    }
+    for (int i = 0; i < base->dbHdr.dbCounts; i++)
+    {
+        if ((base->dbEntry[i].tag == kRecMetaTag_CaDescriptor) && (caDesc == NULL))
+        {
+            caDesc = new uint8_t[base->dbEntry[i].size];
+            memcpy(caDesc, db + base->dbEntry[i].offset, base->dbEntry[i].size);
+        }
+    }
+    for (int i = 0; i < base->dbHdr.dbCounts; i++)
+    {
+        if (base->dbEntry[i].tag == kRecMetaTag_MspPmt)
+        {
+            DvrMetadataIndex::pmtScramblingMode(kRecMetaTag_MspPmt, db + base->dbEntry[i].offset,
+                                                base->dbEntry[i].size, mode);
+        }
+    }
+    delete [] caBlob;
+    delete [] caDesc;
+    delete [] db;
+    return true;
+}
+
+static double indexRun(const std::vector<std::string> &files, unsigned int maxFiles, double *firstRoundMs)
+{
+    BenchDvrMetadataIndex index(maxFiles);
+    tDvrMetadataIndexStats stats;
+    double start = nowSecs();
+
+    for (int round = 0; round < kBenchRounds; round++)
+    {
+        for (unsigned int i = 0; i < files.size(); i++)
+        {
+            const tDvrMetadataInfo *info = index.acquire(files[i]);
+            if ((info == NULL) || (info->scramblingMode != 2))
+            {
+                printf("error indexing %s\n", files[i].c_str());
+                exit(1);
+            }
+            index.release(info);
+        }
+        if (round == 0)
+        {
+            *firstRoundMs = (nowSecs() - start) * 1000;
+        }
+    }
+    double secs = nowSecs() - start;
+    index.getStats(&stats);
+    printf("index of %3u files: %8.3f ms  first round %8.3f ms  (hits %u misses %u evictions %u)\n",
+           maxFiles, secs * 1000, *firstRoundMs, stats.hits, stats.misses, stats.evictions);
+    return secs;
+}
+
+int main(int argc, char **argv)
+{
+    std::string dir = (argc > 1) ? argv[1] : "/tmp";
+    std::vector<std::string> files;
+    tRecMetaEntries entries;
+    std::vector<uint8_t> db;
+    char name[64];
+
+    entries[kRecMetaTag_MspPmt] = makeMspPmt();
+    entries[kRecMetaTag_CaBlob].assign(kBenchCaBlobSize, 0x5a);
+    entries[kRecMetaTag_CaDescriptor].assign(12, 0x0e);
+    entries[kRecMetaTag_CaptionService].assign(8, 0x86);
+    RecordMetadataJournal::toDatabase(entries, 0, db);
+
+    for (int i = 0; i < kBenchRecordings; i++)
+    {
+        snprintf(name, sizeof(name), "/mdiBench%03d", i);
+        files.push_back(dir + name);
+        FILE *fp = fopen(files.back().c_str(), "wb");
+        if ((fp == NULL) || (fwrite(&db[0], db.size(), 1, fp) != 1))
+        {
+            printf("error writing %s\n", files.back().c_str());
+            return 1;
+        }
+        fclose(fp);
+    }
+
+    double start = nowSecs();
+    for (int round = 0; round < kBenchRounds; round++)
+    {
+        for (unsigned int i = 0; i < files.size(); i++)
+        {
+            uint8_t mode = 0;
+            if (!readLookup(files[i], &mode) || (mode != 2))
+            {
+                printf("error reading %s\n", files[i].c_str());
+                return 1;
+            }
+        }
+    }
+    double readSecs = nowSecs() - start;
+    unsigned int lookups = kBenchRounds * kBenchRecordings;
+    printf("%u lookups over %d recordings of %u bytes\n", lookups, kBenchRecordings, (unsigned int) db.size());
+    printf("read and walk:      %8.3f ms  %6.2f us each\n", readSecs * 1000, readSecs * 1e6 / lookups);
+
+    double firstRoundMs;
+    double secs = indexRun(files, kDvrMetadataIndexMaxFiles, &firstRoundMs);
+    printf("                    %6.2f us each\n", secs * 1e6 / lookups);
+    secs = indexRun(files, kBenchRecordings, &firstRoundMs);
+    printf("                    %6.2f us each, %6.2f us once indexed\n", secs * 1e6 / lookups,
+           ((secs * 1000) - firstRoundMs) * 1000 / (lookups - kBenchRecordings));
+
+    for (unsigned int i = 0; i < files.size(); i++)
+    {
+        unlink(files[i].c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,298 @@
+/**
+
+\file dvrMetadataIndex_test.h -- contains the cxxtest test cases for the DVR metadata index
+
+The metadata files are written to a temporary directory; the clock of the
+index is moved by the test to have them kept or read again.
+*/
+
+#if !defined(DVR_METADATA_INDEX_TEST_H)
+#define DVR_METADATA_INDEX_TEST_H
+
+#include <cxxtest/TestSuite.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <cpe_recmgr.h>
+#include <cpe_programhandle.h>
+
+#include "dvrMetadataIndex.h"
+#include "recordingPsiIndex.h"
+#include "recordMetadataJournal.h"
+
+class TestDvrMetadataIndex : public DvrMetadataIndex
+{
+public:
+    explicit TestDvrMetadataIndex(unsigned int maxFiles = kDvrMetadataIndexMaxFiles) :
+        DvrMetadataIndex(maxFiles)
+    {
+        mNow = time(NULL) + 100;
+    }
+
+    int64_t mNow;
+
+protected:
+    int64_t nowSecs(void)
+    {
+        return mNow;
+    }
+};
+
+class dvrMetadataIndexTestSuite : public CxxTest::TestSuite
+{
+    char mDir[32];
+
+    static void putBytes(std::vector<uint8_t> &buf, const void *data, uint32_t size)
+    {
+        buf.insert(buf.end(), (const uint8_t *) data, (const uint8_t *) data + size);
+    }
+
+    // MSP PMT metadata with the CA and CA system descriptors on the video
+    static std::vector<uint8_t> mspPmt(uint8_t scramblingMode)
+    {
+        std::vector<uint8_t> pmt;
+        tCpePgrmHandlePmt header;
+        tCpePgrmHandleMpegDesc desc;
+        tCpePgrmHandleEsData es;
+
+        memset(&header, 0, sizeof(header));
+        header.clockPid = 0x100;
+        header.esCount = 1;
+        putBytes(pmt, &header, sizeof(header));
+
+        memset(&es, 0, sizeof(es));
+        es.streamType = kCpeStreamType_H264_Video;
+        es.pid = 0x100;
+        es.descCount = 2;
+        es.ppEsDesc = (tCpePgrmHandleMpegDesc **) 1;    // only tells descriptors follow
+        putBytes(pmt, &es, sizeof(es));
+
+        memset(&desc, 0, sizeof(desc));
+        desc.tag = 0x09;
+        desc.dataLen = 4;
+        putBytes(pmt, &desc, sizeof(desc));
+        putBytes(pmt, "\x0e\x00\xe0\x40", 4);
+        desc.tag = 0x65;
+        desc.dataLen = 1;
+        putBytes(pmt, &desc, sizeof(desc));
+        putBytes(pmt, &scramblingMode, 1);
+        return pmt;
+    }
+
+    std::string write(const char *name, const tRecMetaEntries &entries, uint32_t cci)
+    {
+        std::string file = std::string(mDir) + "/" + name;
+        std::string tmp = file + ".tmp";
+        std::vector<uint8_t> db;
+
+        // replaced, not rewritten in place, like a recording converted again
+        RecordMetadataJournal::toDatabase(entries, cci, db);
+        FILE *fp = fopen(tmp.c_str(), "wb");
+        TS_ASSERT(fp != NULL);
+        fwrite(&db[0], db.size(), 1, fp);
+        fclose(fp);
+        TS_ASSERT_EQUALS(rename(tmp.c_str(), file.c_str()), 0);
+        return file;
+    }
+
+    static tRecMetaEntries rtnEntries(uint8_t value)
+    {
+        tRecMetaEntries entries;
+        entries[kRecMetaTag_MspPmt] = mspPmt(2);
+        entries[kRecMetaTag_CaBlob].assign(2048, value);
+        entries[kRecMetaTag_CaDescriptor].assign(12, 0x0e);
+        entries[kRecMetaTag_CaptionService].assign(8, 0x86);
+        return entries;
+    }
+
+public:
+
+    void setUp()
+    {
+        strcpy(mDir, "/tmp/dvrMetaXXXXXX");
+        TS_ASSERT(mkdtemp(mDir) != NULL);
+    }
+
+    void tearDown()
+    {
+        std::string cmd = std::string("rm -rf ") + mDir;
+        TS_ASSERT_EQUALS(system(cmd.c_str()), 0);
+    }
+
+    void testMappedAndCached()
+    {
+        TestDvrMetadataIndex index;
+        tDvrMetadataIndexStats stats;
+        std::string file = write("rec1", rtnEntries(7), 3);
+
+        const tDvrMetadataInfo *info = index.acquire(file);
+        TS_ASSERT(info != NULL);
+        TS_ASSERT_EQUALS(info->blobType, kRTN_Blob);
+        TS_ASSERT_EQUALS(info->caBlobSize, 2048u);
+        TS_ASSERT_EQUALS(info->caBlob[2047], 7);
+        TS_ASSERT_EQUALS(info->caDescSize, 12u);
+        TS_ASSERT_EQUALS(info->pmtTag, (uint32_t) kRecMetaTag_MspPmt);
+        TS_ASSERT_EQUALS(info->scramblingMode, 2);
+        TS_ASSERT_EQUALS(info->cci, 3);
+
+        const tDvrMetadataInfo *again = index.acquire(file);
+        TS_ASSERT(again == info);
+        index.release(again);
+        index.release(info);
+
+        index.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.hits, 1u);
+        TS_ASSERT_EQUALS(stats.misses, 1u);
+        TS_ASSERT_EQUALS(stats.unsettled, 0u);
+    }
+
+    void testChangedWhileHeld()
+    {
+        TestDvrMetadataIndex index;
+        std::string file = write("rec1", rtnEntries(7), 0);
+
+        const tDvrMetadataInfo *old = index.acquire(file);
+        TS_ASSERT(old != NULL);
+
+        tRecMetaEntries entries = rtnEntries(8);
+        entries[kRecMetaTag_CaBlob].resize(1000);
+        write("rec1", entries, 0);
+
+        const tDvrMetadataInfo *info = index.acquire(file);
+        TS_ASSERT(info != NULL);
+        TS_ASSERT(info != old);
+        TS_ASSERT_EQUALS(info->caBlobSize, 1000u);
+        TS_ASSERT_EQUALS(info->caBlob[0], 8);
+        // the one held is still the file it was indexed from
+        TS_ASSERT_EQUALS(old->caBlobSize, 2048u);
+        TS_ASSERT_EQUALS(old->caBlob[0], 7);
+        index.release(old);
+        index.release(info);
+    }
+
+    void testRecentAndJournaledRead()
+    {
+        TestDvrMetadataIndex index;
+        tDvrMetadataIndexStats stats;
+        tRecMetaEntries entries = rtnEntries(7);
+        std::string file = write("rec1", entries, 0);
+
+        // still written by its record session
+        index.mNow = time(NULL);
+        const tDvrMetadataInfo *info = index.acquire(file);
+        TS_ASSERT(info != NULL);
+        TS_ASSERT_EQUALS(info->caBlob[0], 7);
+        index.release(info);
+
+        // a CA update in the journal
+        index.mNow += 100;
+        {
+            RecordMetadataJournal journal(file, true);
+            journal.update(entries, 0);
+            journal.baseWritten(0);
+            entries[kRecMetaTag_CaBlob].assign(2048, 9);
+            TS_ASSERT(!journal.update(entries, 0));
+        }
+        info = index.acquire(file);
+        TS_ASSERT(info != NULL);
+        TS_ASSERT_EQUALS(info->caBlob[0], 9);
+        TS_ASSERT_EQUALS(info->scramblingMode, 2);
+        index.release(info);
+
+        index.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.misses, 2u);
+        TS_ASSERT_EQUALS(stats.unsettled, 1u);
+    }
+
+    void testRecentNotKept()
+    {
+        TestDvrMetadataIndex index;
+        tDvrMetadataIndexStats stats;
+        struct timespec times[2];
+        std::string file = write("rec1", rtnEntries(7), 0);
+
+        times[0].tv_sec = times[1].tv_sec = 1500000000;
+        times[0].tv_nsec = times[1].tv_nsec = 0;
+        TS_ASSERT_EQUALS(utimensat(AT_FDCWD, file.c_str(), times, 0), 0);
+        index.mNow = 1500000001;
+        const tDvrMetadataInfo *info = index.acquire(file);
+        TS_ASSERT(info != NULL);
+        TS_ASSERT_EQUALS(info->caBlob[0], 7);
+
+        // rewritten with the same size and the same stamp, as within a timestamp tick
+        write("rec1", rtnEntries(8), 0);
+        TS_ASSERT_EQUALS(utimensat(AT_FDCWD, file.c_str(), times, 0), 0);
+        const tDvrMetadataInfo *again = index.acquire(file);
+        TS_ASSERT(again != NULL);
+        TS_ASSERT_EQUALS(again->caBlob[0], 8);
+        TS_ASSERT_EQUALS(info->caBlob[0], 7);
+        index.release(again);
+        index.release(info);
+
+        // settled, then kept
+        index.mNow += kDvrMetadataIndexSettleSecs;
+        index.release(index.acquire(file));
+        index.release(index.acquire(file));
+
+        index.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.hits, 1u);
+        TS_ASSERT_EQUALS(stats.misses, 3u);
+        TS_ASSERT_EQUALS(stats.unsettled, 2u);
+    }
+
+    void testEviction()
+    {
+        TestDvrMetadataIndex index(2);
+        tDvrMetadataIndexStats stats;
+        std::string file1 = write("rec1", rtnEntries(1), 0);
+        std::string file2 = write("rec2", rtnEntries(2), 0);
+        std::string file3 = write("rec3", rtnEntries(3), 0);
+
+        const tDvrMetadataInfo *held = index.acquire(file1);
+        index.release(index.acquire(file2));
+        index.release(index.acquire(file3));
+
+        // rec2 went, rec1 is held
+        index.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.evictions, 1u);
+        index.release(index.acquire(file1));
+        index.release(index.acquire(file2));
+        index.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.hits, 1u);
+        TS_ASSERT_EQUALS(stats.misses, 4u);
+        TS_ASSERT_EQUALS(held->caBlob[0], 1);
+        index.release(held);
+    }
+
+    void testSaraAndBadFiles()
+    {
+        TestDvrMetadataIndex index;
+        tDvrMetadataIndexStats stats;
+        tRecMetaEntries entries;
+
+        entries[kRecMetaTag_SaraCaBlob].assign(100, 5);
+        const tDvrMetadataInfo *info = index.acquire(write("sara", entries, 0));
+        TS_ASSERT(info != NULL);
+        TS_ASSERT_EQUALS(info->blobType, kSARA_Blob);
+        TS_ASSERT(info->caDesc == NULL);
+        TS_ASSERT_EQUALS(info->scramblingMode, 0);
+        index.release(info);
+
+        std::string bad = std::string(mDir) + "/bad";
+        FILE *fp = fopen(bad.c_str(), "wb");
+        fwrite("not metadata", 12, 1, fp);
+        fclose(fp);
+        TS_ASSERT(index.acquire(bad) == NULL);
+        TS_ASSERT(index.acquire(std::string(mDir) + "/none") == NULL);
+
+        index.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.failures, 2u);
+    }
+};
+
+#endif
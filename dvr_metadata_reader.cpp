@@ -1,8 +1,10 @@
 #include <stdlib.h>
 #include "dvr_metadata_reader.h"
+#include "recordMetadataJournal.h"
 #include "dlog.h"
 #include <cstring>
 #include <cstdio>
+#include <vector>
 #define LOG(level, msg, args...)  dlog(DL_MSP_DVR, level,"dvr:%s:%d " msg, __FUNCTION__, __LINE__, ##args);
 
 
@@ -76,6 +78,17 @@ eMspStatus ReadMrdvrMetaData(char * filename, tCpeRecDataBase **metabuf)
     else
     {
         LOG(DLOGL_NOISE, " Number of database entries in metadata file is %d", tempDbBuf->dbHdr.dbCounts);
+
+        // CA updates the record session appended after the database
+        std::vector<uint8_t> db(dbBuf, dbBuf + metasize);
+        int records = RecordMetadataJournal::apply(filename, db);
+        if (records > 0)
+        {
+            LOG(DLOGL_NOISE, " %d journaled updates applied, metadata size %d", records, db.size());
+            delete [] dbBuf;
+            dbBuf = new uint8_t [db.size() + 1024];
+            memcpy(dbBuf, &db[0], db.size());
+        }
         *metabuf = (tCpeRecDataBase *)dbBuf;
 
     }
@@ -184,85 +197,22 @@ tCpeRecDataBaseType* GetDecryptCADesc(tCpeRecDataBase *dataBase)
 
 uint8_t GetScramblingMode(tCpeRecDataBase *dataBase)
 {
-    tCpeRecDataBaseType *dbTypeCADesc = NULL;
-    uint8_t *sectionAddress;
-    dbTypeCADesc = new tCpeRecDataBaseType;
     uint8_t  scramblingMode = 0;
 
-    if (dbTypeCADesc == NULL)
-    {
-        return scramblingMode;
-    }
-
     LOG(DLOGL_NOISE, " %s:%d DB section count is %d", __FUNCTION__, __LINE__, dataBase->dbHdr.dbCounts);
     for (int i = 0; i < dataBase->dbHdr.dbCounts; i++)
     {
-        sectionAddress = (uint8_t *)(dataBase) + dataBase->dbEntry[i].offset;
+        uint8_t *sectionAddress = (uint8_t *)(dataBase) + dataBase->dbEntry[i].offset;
         // tag 0x1FAB is for RTN and 0x102 is for sara
         if ((dataBase->dbEntry[i].tag == 0x1FAB) || (dataBase->dbEntry[i].tag == 0x102))
         {
-            tCpePgrmHandleMpegDesc cakDescriptor;
-            tCpePgrmHandleMpegDesc cakSystemDescriptor;
-            eMspStatus status = kMspStatus_Ok;
-            Pmt *ptrPmt = new Pmt();
-            if (ptrPmt)
-            {
-                if (dataBase->dbEntry[i].tag == 0x1FAB)
-                {
-                    ptrPmt->populateMSPMetaData(sectionAddress, dataBase->dbEntry[i].size);
-                }
-                else
-                {
-                    ptrPmt->populateFromSaraMetaData(sectionAddress, dataBase->dbEntry[i].size);
-                }
-                std::list<tPid>* videoList = ptrPmt->getVideoPidList();
-                if (videoList->size())
-                {
-                    std::list<tPid>::iterator iter = videoList->begin();
-                    cakDescriptor.tag = 0x9;
-                    cakDescriptor.dataLen = 0;
-                    cakDescriptor.data = NULL;
-                    status = ptrPmt->getDescriptor(&cakDescriptor, (*iter).pid);
-                    if (status == kMspStatus_Ok)
-                    {
-                        // now get the CA system descriptor
-                        cakSystemDescriptor.tag = 0x65;
-                        cakSystemDescriptor.dataLen = 0;
-                        cakSystemDescriptor.data = NULL;
-
-                        status = ptrPmt->getDescriptor(&cakSystemDescriptor, (*iter).pid);
-                        LOG(DLOGL_NOISE, "ptrPmt->getDescriptor pid:%d status: %d\n", (*iter).pid, status);
-                        if (status == kMspStatus_Ok)
-                        {
-                            scramblingMode = cakSystemDescriptor.data[0];
-                            ptrPmt->releaseDescriptor(&cakSystemDescriptor);
-                        }
-                    }
-                    ptrPmt->releaseDescriptor(&cakDescriptor);
-                }
-            }
-            else
-            {
-                LOG(DLOGL_ERROR, "Unable to allocate memory for Pmt structure");
-                delete dbTypeCADesc;
-                dbTypeCADesc = NULL;
-                return scramblingMode;
-
-            }
-
-            delete ptrPmt;
+            DvrMetadataIndex::pmtScramblingMode(dataBase->dbEntry[i].tag, sectionAddress, dataBase->dbEntry[i].size, &scramblingMode);
         }
         else
         {
             LOG(DLOGL_NOISE, " %s:%d Meta data not handled here tag 0x%x \n", __FUNCTION__, __LINE__, dataBase->dbEntry[i].tag);
         }
-
     }
 
-    //freeing up the dynamically allocated memories.
-    delete dbTypeCADesc;
-    dbTypeCADesc = NULL;
-
     return scramblingMode;
 }
-
@@ -24,14 +24,7 @@
 #include "eventQueue.h"
 #include "MspCommon.h"
 #include "pmt.h"
-
-
-typedef enum
-{
-    kInvalid_Blob = -1,
-    kSARA_Blob,
-    kRTN_Blob
-} eBlobType;
+#include "dvrMetadataIndex.h"
 
 
 
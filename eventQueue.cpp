@@ -12,116 +12,550 @@
 
 #include <iostream>
 #include <pthread.h>
-#include <sys/time.h>
+#include <time.h>
 #include <errno.h>
 #if defined(DMALLOC)
 #include "dmalloc.h"
 #endif
 
 #include "eventQueue.h"
+#include "monotonicTime.h"
 #define kTimeOut -1
 
 using namespace std;
 
+///////////////////////////////////////////////////////////////////////////
+//                      Atomic helpers
+///////////////////////////////////////////////////////////////////////////
 
-MSPEventQueue::MSPEventQueue()
+// Older toolchains only have the __sync builtins, which are full barriers.
+#if defined(__ATOMIC_ACQUIRE)
+static inline unsigned int loadAcquire(volatile unsigned int *ptr)
 {
-    mWaitTimeSecs = 0;
-    pthread_mutex_init(&mMutex, NULL);
-    pthread_cond_init(&mCond, NULL);
+    return __atomic_load_n(ptr, __ATOMIC_ACQUIRE);
 }
 
-MSPEventQueue::~MSPEventQueue()
+static inline void storeRelease(volatile unsigned int *ptr, unsigned int value)
 {
-    Event* p = NULL;
-    pthread_mutex_lock(&mMutex);
+    __atomic_store_n(ptr, value, __ATOMIC_RELEASE);
+}
+#else
+static inline unsigned int loadAcquire(volatile unsigned int *ptr)
+{
+    unsigned int value = *ptr;
+    __sync_synchronize();
+    return value;
+}
+
+static inline void storeRelease(volatile unsigned int *ptr, unsigned int value)
+{
+    __sync_synchronize();
+    *ptr = value;
+}
+#endif
+
+///////////////////////////////////////////////////////////////////////////
+//                      EventRing implementation
+///////////////////////////////////////////////////////////////////////////
 
-    std::list<Event*>::iterator iterList = mQueue.begin();
-    while (iterList != mQueue.end())
+MSPEventQueue::EventRing::EventRing(unsigned int capacity)
+{
+    // capacity is always a power of 2 here, see MSPEventQueue constructor
+    mCells = new Cell[capacity];
+    mMask = capacity - 1;
+    for (unsigned int i = 0; i < capacity; i++)
     {
-        p = (Event*) *iterList;
-        if (p)
+        mCells[i].sequence = i;
+        mCells[i].event = NULL;
+    }
+    mEnqueuePos = 0;
+    mDequeuePos = 0;
+}
+
+MSPEventQueue::EventRing::~EventRing()
+{
+    delete [] mCells;
+    mCells = NULL;
+}
+
+bool MSPEventQueue::EventRing::push(Event* event)
+{
+    Cell* cell;
+    unsigned int pos = mEnqueuePos;
+
+    for (;;)
+    {
+        cell = &mCells[pos & mMask];
+        unsigned int seq = loadAcquire(&cell->sequence);
+        int diff = (int)(seq - pos);
+        if (diff == 0)
+        {
+            if (__sync_bool_compare_and_swap(&mEnqueuePos, pos, pos + 1))
+            {
+                break;
+            }
+            pos = mEnqueuePos;
+        }
+        else if (diff < 0)
+        {
+            return false;  // ring is full
+        }
+        else
         {
-            delete p;
-            p = NULL;
+            pos = mEnqueuePos;
         }
-        iterList = mQueue.erase(iterList);
     }
 
-    pthread_mutex_unlock(&mMutex);
+    cell->event = event;
+    storeRelease(&cell->sequence, pos + 1);
+    return true;
+}
+
+Event* MSPEventQueue::EventRing::pop(void)
+{
+    Cell* cell;
+    unsigned int pos = mDequeuePos;
+
+    for (;;)
+    {
+        cell = &mCells[pos & mMask];
+        unsigned int seq = loadAcquire(&cell->sequence);
+        int diff = (int)(seq - (pos + 1));
+        if (diff == 0)
+        {
+            if (__sync_bool_compare_and_swap(&mDequeuePos, pos, pos + 1))
+            {
+                break;
+            }
+            pos = mDequeuePos;
+        }
+        else if (diff < 0)
+        {
+            return NULL;  // ring is empty
+        }
+        else
+        {
+            pos = mDequeuePos;
+        }
+    }
+
+    Event* event = cell->event;
+    cell->event = NULL;
+    storeRelease(&cell->sequence, pos + mMask + 1);
+    return event;
+}
+
+bool MSPEventQueue::EventRing::isEmpty(void) const
+{
+    unsigned int pos = mDequeuePos;
+    unsigned int seq = loadAcquire(const_cast<volatile unsigned int *>(&mCells[pos & mMask].sequence));
+    return ((int)(seq - (pos + 1)) < 0);
+}
+
+///////////////////////////////////////////////////////////////////////////
+//                      MSPEventQueue implementation
+///////////////////////////////////////////////////////////////////////////
+
+Event MSPEventQueue::sTimeOutEvent = { (unsigned int) kTimeOut, NULL, 0 };
+
+unsigned int MSPEventQueue::roundUpPowerOf2(unsigned int value)
+{
+    unsigned int result = 2;
+    while (result < value)
+    {
+        result <<= 1;
+    }
+    return result;
+}
+
+MSPEventQueue::MSPEventQueue(unsigned int capacity)
+    : mCapacity(roundUpPowerOf2(capacity)),
+      mPool(new Event[mCapacity]),
+      mFreePool(mCapacity)
+{
+    for (unsigned int i = 0; i < mCapacity; i++)
+    {
+        mFreePool.push(&mPool[i]);
+    }
+    for (int lane = 0; lane < kMSPEventPriorityCount; lane++)
+    {
+        mLanes[lane] = new EventLane(mCapacity);
+    }
+    for (int slot = 0; slot < kMSPTimerWheelSlots; slot++)
+    {
+        mTimerWheel[slot] = NULL;
+    }
+    mTimerTick = monotonicMs() / kMSPTimerWheelTickMs;
+    mNextTimerId = kMSPEventTimerIdInvalid;
+    mTimerCount = 0;
+    mListener = NULL;
+    mCoalescedCount = 0;
+    mWaiting = 0;
+    mWaitTimeMs = 0;
+
+    pthread_condattr_t condAttr;
+    pthread_condattr_init(&condAttr);
+    pthread_condattr_setclock(&condAttr, CLOCK_MONOTONIC);
+    pthread_mutex_init(&mMutex, NULL);
+    pthread_cond_init(&mCond, &condAttr);
+    pthread_condattr_destroy(&condAttr);
+}
+
+MSPEventQueue::~MSPEventQueue()
+{
+    flushQueue();
+
+    std::map<tMSPEventTimerId, ScheduledEvent*>::iterator iter;
+    for (iter = mTimers.begin(); iter != mTimers.end(); iter++)
+    {
+        delete iter->second;
+    }
+    mTimers.clear();
+
     pthread_mutex_destroy(&mMutex);
     pthread_cond_destroy(&mCond);
+
+    for (int lane = 0; lane < kMSPEventPriorityCount; lane++)
+    {
+        delete mLanes[lane];
+        mLanes[lane] = NULL;
+    }
+
+    delete [] mPool;
+    mPool = NULL;
+}
+
+void MSPEventQueue::setEventPriority(unsigned int eventType, eMSPEventPriority priority)
+{
+    if ((priority >= kMSPEventPriorityHigh) && (priority < kMSPEventPriorityCount))
+    {
+        mEventClasses[eventType].priority = priority;
+    }
+}
+
+void MSPEventQueue::setEventCoalescing(unsigned int eventType, bool coalesce)
+{
+    mEventClasses[eventType].coalesce = coalesce;
+}
+
+unsigned int MSPEventQueue::getCoalescedCount() const
+{
+    return mCoalescedCount;
+}
+
+bool MSPEventQueue::isPooled(const Event* event) const
+{
+    return (event >= mPool) && (event < (mPool + mCapacity));
 }
 
+bool MSPEventQueue::isSuperseded(const Event* event) const
+{
+    if (event->coalesceGen == 0)
+    {
+        return false;
+    }
+
+    std::map<unsigned int, EventClass>::const_iterator iter = mEventClasses.find(event->eventType);
+    if (iter == mEventClasses.end())
+    {
+        return false;
+    }
 
+    return (event->coalesceGen != loadAcquire(const_cast<volatile unsigned int *>(&iter->second.generation)));
+}
+
+Event* MSPEventQueue::allocEvent(void)
+{
+    Event* event = mFreePool.pop();
+    if (event == NULL)
+    {
+        // pool exhausted (consumer is holding on to events), fall back to the heap
+        event = new Event;
+    }
+    return event;
+}
 
 void MSPEventQueue::dispatchEvent(unsigned int eventType, void *eventData)
 {
-    Event* event = new Event;
+    Event* event = allocEvent();
 
     if (event)
     {
         event->eventType = eventType;
         event->eventData = eventData;
+        postEvent(event, false);
+    }
+}
 
-        pthread_mutex_lock(&mMutex);
-        mQueue.push_back(event);
+void MSPEventQueue::postEvent(Event* event, bool locked)
+{
+    EventLane* lane = mLanes[kMSPEventPriorityNormal];
+
+    event->coalesceGen = 0;
+
+    if (!mEventClasses.empty())
+    {
+        std::map<unsigned int, EventClass>::iterator iter = mEventClasses.find(event->eventType);
+        if (iter != mEventClasses.end())
+        {
+            lane = mLanes[iter->second.priority];
+            if (iter->second.coalesce)
+            {
+                // 0 is reserved for "not coalesced"
+                unsigned int gen = __sync_add_and_fetch(&iter->second.generation, 1);
+                if (gen == 0)
+                {
+                    gen = __sync_add_and_fetch(&iter->second.generation, 1);
+                }
+                event->coalesceGen = gen;
+            }
+        }
+    }
+
+    // Once anything has spilled into the overflow list, keep posting there
+    // until it drains so that events from one producer stay in order.
+    if ((loadAcquire(&lane->overflowCount) != 0) || !lane->ring.push(event))
+    {
+        if (!locked)
+        {
+            pthread_mutex_lock(&mMutex);
+        }
+        lane->overflow.push_back(event);
+        __sync_add_and_fetch(&lane->overflowCount, 1);
         pthread_cond_signal(&mCond);
+        if (!locked)
+        {
+            pthread_mutex_unlock(&mMutex);
+        }
+    }
+    else
+    {
+        // Pairs with the increment of mWaiting in popEventQueue(): either the
+        // consumer sees our event when it re-checks the lanes, or we see it waiting.
+        __sync_synchronize();
+        if ((mWaiting != 0) && !locked)
+        {
+            pthread_mutex_lock(&mMutex);
+            pthread_cond_signal(&mCond);
+            pthread_mutex_unlock(&mMutex);
+        }
+    }
+
+    // Called with mMutex held like eventScheduled(), so a strand that cleared
+    // the listener is never notified after setListener(NULL) returned.
+    if (mListener)
+    {
+        if (!locked)
+        {
+            pthread_mutex_lock(&mMutex);
+        }
+        if (mListener)
+        {
+            mListener->eventQueued();
+        }
+        if (!locked)
+        {
+            pthread_mutex_unlock(&mMutex);
+        }
+    }
+}
+
+Event* MSPEventQueue::popLane(EventLane* lane, bool locked)
+{
+    // ring entries are always older than the lane's overflow list
+    Event* p = lane->ring.pop();
+
+    if ((p == NULL) && (loadAcquire(&lane->overflowCount) != 0))
+    {
+        if (!locked)
+        {
+            pthread_mutex_lock(&mMutex);
+        }
+        if (!lane->overflow.empty())
+        {
+            p = lane->overflow.front();
+            lane->overflow.pop_front();
+            __sync_sub_and_fetch(&lane->overflowCount, 1);
+        }
+        if (!locked)
+        {
+            pthread_mutex_unlock(&mMutex);
+        }
+    }
+
+    return p;
+}
+
+Event* MSPEventQueue::tryPop(bool locked)
+{
+    for (int lane = 0; lane < kMSPEventPriorityCount; lane++)
+    {
+        Event* p;
+        while ((p = popLane(mLanes[lane], locked)) != NULL)
+        {
+            if (!isSuperseded(p))
+            {
+                return p;
+            }
+            __sync_add_and_fetch(&mCoalescedCount, 1);
+            freeEvent(p);
+        }
+    }
+
+    return NULL;
+}
+
+bool MSPEventQueue::getNextScheduledMs(unsigned long long *dueMs)
+{
+    unsigned long long tick = 0;
+    bool pending;
+
+    pthread_mutex_lock(&mMutex);
+    pending = nextTimerTickLocked(&tick);
+    pthread_mutex_unlock(&mMutex);
+
+    if (pending && dueMs)
+    {
+        *dueMs = tick * kMSPTimerWheelTickMs;
+    }
+    return pending;
+}
+
+Event* MSPEventQueue::getTimeOutEvent(void)
+{
+    return &sTimeOutEvent;
+}
+
+Event* MSPEventQueue::tryPopEventQueue(void)
+{
+    Event* p = NULL;
+
+    if (loadAcquire(&mTimerCount) != 0)
+    {
+        pthread_mutex_lock(&mMutex);
+        expireTimersLocked(monotonicMs() / kMSPTimerWheelTickMs);
+        p = tryPop(true);
         pthread_mutex_unlock(&mMutex);
     }
+    else
+    {
+        p = tryPop(false);
+    }
+
+    return p;
+}
+
+bool MSPEventQueue::hasPendingEvents(void) const
+{
+    for (int lane = 0; lane < kMSPEventPriorityCount; lane++)
+    {
+        if (!mLanes[lane]->ring.isEmpty() || (loadAcquire(const_cast<volatile unsigned int *>(&mLanes[lane]->overflowCount)) != 0))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void MSPEventQueue::setListener(MSPEventQueueListener* listener)
+{
+    pthread_mutex_lock(&mMutex);
+    mListener = listener;
+    pthread_mutex_unlock(&mMutex);
 }
 
 Event* MSPEventQueue::popEventQueue(void)
 {
     Event* p = NULL;
-    int rc = 0;
+    unsigned long long deadlineMs = 0;
+    unsigned long long nowMs;
+    unsigned long long timerTick;
     struct timespec ts;
-    struct timeval tp;
+
+    if (loadAcquire(&mTimerCount) == 0)
+    {
+        p = tryPop(false);
+        if (p != NULL)
+        {
+            return p;
+        }
+    }
+
     pthread_mutex_lock(&mMutex);
 
-    //   pthread_cond_wait can return from the call even though no call to signal or broadcast on the condition occurred it called as "Spurious-wakeup". 
-    //   Since the return from pthread_cond_timedwait() or pthread_cond_wait() does not imply anything about the value of this predicate, 
+    __sync_add_and_fetch(&mWaiting, 1);
+
+    nowMs = monotonicMs();
+    if (mWaitTimeMs != 0)
+    {
+        deadlineMs = nowMs + mWaitTimeMs;
+    }
+
+    //   pthread_cond_wait can return from the call even though no call to signal or broadcast on the condition occurred it called as "Spurious-wakeup".
+    //   Since the return from pthread_cond_timedwait() or pthread_cond_wait() does not imply anything about the value of this predicate,
     //   the predicate should be re-evaluated upon such return.
-    while ((mQueue.size() == 0) && (rc != ETIMEDOUT))
+    for (;;)
     {
-        if (mWaitTimeSecs != 0)
+        if (mTimerCount != 0)
         {
-            rc = gettimeofday(&tp, NULL);
-            ts.tv_sec = tp.tv_sec;
-            ts.tv_nsec = tp.tv_usec * 1000;
-            ts.tv_sec = ts.tv_sec + mWaitTimeSecs;
-            rc = pthread_cond_timedwait(&mCond, &mMutex, &ts);
+            expireTimersLocked(nowMs / kMSPTimerWheelTickMs);
         }
-        else
+
+        p = tryPop(true);
+        if ((p != NULL) || ((deadlineMs != 0) && (nowMs >= deadlineMs)))
         {
-            rc = pthread_cond_wait(&mCond, &mMutex);
+            break;
         }
-    }
 
-    if (rc == ETIMEDOUT)
-    {
-        p = new Event();
-        if (p)
+        unsigned long long wakeMs = deadlineMs;
+        if (nextTimerTickLocked(&timerTick))
         {
-            p->eventType = kTimeOut;
-            p->eventData = NULL;
+            unsigned long long timerMs = timerTick * kMSPTimerWheelTickMs;
+            if ((wakeMs == 0) || (timerMs < wakeMs))
+            {
+                wakeMs = timerMs;
+            }
         }
-    }
-    else
-    {
-        p = (Event*) mQueue.front();
-        mQueue.pop_front();
+
+        if (wakeMs != 0)
+        {
+            monotonicDeadlineAt(wakeMs, &ts);
+            pthread_cond_timedwait(&mCond, &mMutex, &ts);
+        }
+        else
+        {
+            pthread_cond_wait(&mCond, &mMutex);
+        }
+
+        nowMs = monotonicMs();
     }
 
+    __sync_sub_and_fetch(&mWaiting, 1);
+
     pthread_mutex_unlock(&mMutex);
 
+    if (p == NULL)
+    {
+        p = &sTimeOutEvent;
+    }
+
     return (Event*) p;
 }
 
 
 void  MSPEventQueue::freeEvent(Event* event)
 {
-    if (event)
+    if ((event == NULL) || (event == &sTimeOutEvent))
+    {
+        return;
+    }
+
+    if (isPooled(event))
+    {
+        event->eventData = NULL;
+        mFreePool.push(event);   // can not fail, the free ring is as large as the pool
+    }
+    else
     {
         delete event;
         event = NULL;
@@ -130,31 +564,202 @@ void  MSPEventQueue::freeEvent(Event* event)
 
 void MSPEventQueue::setTimeOutSecs(unsigned int waitTime)
 {
-    mWaitTimeSecs = waitTime;
+    mWaitTimeMs = waitTime * 1000;
+}
+
+void MSPEventQueue::setTimeOutMsecs(unsigned int waitTimeMs)
+{
+    mWaitTimeMs = waitTimeMs;
 }
 
 void MSPEventQueue::unSetTimeOut()
 {
-    mWaitTimeSecs = 0;
+    mWaitTimeMs = 0;
 }
 
+///////////////////////////////////////////////////////////////////////////
+//                      Scheduled events (timer wheel)
+///////////////////////////////////////////////////////////////////////////
 
+unsigned long long MSPEventQueue::monotonicMs(void)
+{
+    return monotonicNowMs();
+}
 
-void MSPEventQueue::flushQueue()
+void MSPEventQueue::linkTimerLocked(ScheduledEvent* timer)
 {
-    Event* p = NULL;
+    ScheduledEvent** slot = &mTimerWheel[timer->expiryTick & (kMSPTimerWheelSlots - 1)];
+
+    timer->prev = NULL;
+    timer->next = *slot;
+    if (*slot)
+    {
+        (*slot)->prev = timer;
+    }
+    *slot = timer;
+}
+
+void MSPEventQueue::unlinkTimerLocked(ScheduledEvent* timer)
+{
+    if (timer->prev)
+    {
+        timer->prev->next = timer->next;
+    }
+    else
+    {
+        mTimerWheel[timer->expiryTick & (kMSPTimerWheelSlots - 1)] = timer->next;
+    }
+    if (timer->next)
+    {
+        timer->next->prev = timer->prev;
+    }
+    timer->prev = NULL;
+    timer->next = NULL;
+}
+
+tMSPEventTimerId MSPEventQueue::scheduleEvent(unsigned int eventType, void *eventData, unsigned int delayMs)
+{
+    ScheduledEvent* timer = new ScheduledEvent;
+    unsigned long long nowMs = monotonicMs();
+
+    timer->eventType = eventType;
+    timer->eventData = eventData;
+    timer->prev = NULL;
+    timer->next = NULL;
+
+    pthread_mutex_lock(&mMutex);
+
+    if (mTimerCount == 0)
+    {
+        // nothing pending, the wheel can jump straight to now
+        mTimerTick = nowMs / kMSPTimerWheelTickMs;
+    }
+
+    // round up so the event never fires early, and never into a tick already expired
+    timer->expiryTick = (nowMs + delayMs + kMSPTimerWheelTickMs - 1) / kMSPTimerWheelTickMs;
+    if (timer->expiryTick <= mTimerTick)
+    {
+        timer->expiryTick = mTimerTick + 1;
+    }
+
+    do
+    {
+        mNextTimerId++;
+    }
+    while ((mNextTimerId == kMSPEventTimerIdInvalid) || (mTimers.find(mNextTimerId) != mTimers.end()));
+    timer->id = mNextTimerId;
+
+    linkTimerLocked(timer);
+    mTimers[timer->id] = timer;
+    __sync_add_and_fetch(&mTimerCount, 1);
+
+    // let a waiting consumer recompute its wake up time
+    pthread_cond_signal(&mCond);
+    if (mListener)
+    {
+        mListener->eventScheduled(timer->expiryTick * kMSPTimerWheelTickMs);
+    }
+    pthread_mutex_unlock(&mMutex);
+
+    return timer->id;
+}
+
+bool MSPEventQueue::cancelScheduledEvent(tMSPEventTimerId timerId)
+{
+    bool cancelled = false;
+
     pthread_mutex_lock(&mMutex);
 
-    std::list<Event*>::iterator iterList = mQueue.begin();
-    while (iterList != mQueue.end())
+    std::map<tMSPEventTimerId, ScheduledEvent*>::iterator iter = mTimers.find(timerId);
+    if (iter != mTimers.end())
+    {
+        ScheduledEvent* timer = iter->second;
+        unlinkTimerLocked(timer);
+        mTimers.erase(iter);
+        __sync_sub_and_fetch(&mTimerCount, 1);
+        delete timer;
+        cancelled = true;
+    }
+
+    pthread_mutex_unlock(&mMutex);
+
+    return cancelled;
+}
+
+void MSPEventQueue::expireTimersLocked(unsigned long long nowTick)
+{
+    if (nowTick <= mTimerTick)
+    {
+        return;
+    }
+
+    unsigned long long ticks = nowTick - mTimerTick;
+    if (ticks > kMSPTimerWheelSlots)
+    {
+        ticks = kMSPTimerWheelSlots;   // one revolution visits every slot
+    }
+
+    for (unsigned long long i = 1; i <= ticks; i++)
+    {
+        ScheduledEvent* timer = mTimerWheel[(mTimerTick + i) & (kMSPTimerWheelSlots - 1)];
+        while (timer)
+        {
+            ScheduledEvent* next = timer->next;
+            if (timer->expiryTick <= nowTick)
+            {
+                unlinkTimerLocked(timer);
+                mTimers.erase(timer->id);
+                __sync_sub_and_fetch(&mTimerCount, 1);
+
+                Event* event = allocEvent();
+                event->eventType = timer->eventType;
+                event->eventData = timer->eventData;
+                postEvent(event, true);
+
+                delete timer;
+            }
+            timer = next;
+        }
+    }
+
+    mTimerTick = nowTick;
+}
+
+bool MSPEventQueue::nextTimerTickLocked(unsigned long long *tick) const
+{
+    if (mTimerCount == 0)
+    {
+        return false;
+    }
+
+    for (unsigned long long i = 1; i <= kMSPTimerWheelSlots; i++)
     {
-        p = (Event*) *iterList;
-        if (p)
+        unsigned long long candidate = mTimerTick + i;
+        for (ScheduledEvent* timer = mTimerWheel[candidate & (kMSPTimerWheelSlots - 1)]; timer != NULL; timer = timer->next)
         {
-            delete p;
-            p = NULL;
+            if (timer->expiryTick <= candidate)
+            {
+                *tick = candidate;
+                return true;
+            }
         }
-        iterList = mQueue.erase(iterList);
+    }
+
+    // everything pending is more than one revolution away, check back then
+    *tick = mTimerTick + kMSPTimerWheelSlots;
+    return true;
+}
+
+
+
+void MSPEventQueue::flushQueue()
+{
+    Event* p = NULL;
+    pthread_mutex_lock(&mMutex);
+
+    while ((p = tryPop(true)) != NULL)
+    {
+        freeEvent(p);
     }
 
     pthread_mutex_unlock(&mMutex);
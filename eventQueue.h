@@ -11,8 +11,29 @@
  * -- support the asynchronous event queue driven.
  * -- support immediate event dispatch
  * -- schedule of event timer in msec, and cancel of pending scheduled events.
- * Note: for the scheduled event timer to worked, the platform needs to
- *       have the GMain loop running in the GMainContext
+ *
+ * Scheduled events are kept in a hashed timer wheel driven by
+ * CLOCK_MONOTONIC and are fired by the thread blocked in popEventQueue(),
+ * so no extra thread or GMain/libevent loop is needed and wall clock changes
+ * (NTP/STT time set) do not affect them or the popEventQueue() time out.
+ *
+ * Instead of a thread blocking in popEventQueue(), a queue can be drained by
+ * an MSPEventQueueListener (see MSPStrand in MSPWorkerPool.h), which is told
+ * when events become available and when scheduled events are due, and pulls
+ * them with tryPopEventQueue().
+ *
+ * Events are carried in a bounded, lock-free ring (multi-producer safe) and
+ * the Event objects themselves come from a per-queue pool, so posting and
+ * popping an event does not touch the heap or the queue mutex in the common
+ * case.  The mutex is only taken to park/wake the consumer thread and for the
+ * overflow list used when the ring is full.
+ *
+ * Each queue has three priority lanes; popEventQueue() always drains the
+ * highest non-empty lane first and keeps FIFO order inside a lane.  An event
+ * type can also be marked as coalesced, in which case only the newest pending
+ * event of that type is delivered and older ones are dropped.  Event types
+ * are assigned to lanes / coalescing by the owner of the queue, before any
+ * event of that type is dispatched (normally right after creating the queue).
  */
 
 #ifndef _EVENTQUEUE_
@@ -20,13 +41,32 @@
 
 #include <map>
 #include <list>
+#include <pthread.h>
+#include <stddef.h>
+
+#define kMSPEventQueueDefaultCapacity 64   ///< ring/pool size used when none is given (rounded up to a power of 2)
+
+#define kMSPTimerWheelSlots   256          ///< number of buckets in the timer wheel (power of 2)
+#define kMSPTimerWheelTickMs  10           ///< timer resolution, one wheel revolution is 2.56 seconds
+
+typedef unsigned int tMSPEventTimerId;
+#define kMSPEventTimerIdInvalid 0
 
 struct Event
 {
     unsigned int eventType ;
     void *eventData;
+    unsigned int coalesceGen;   ///< internal to MSPEventQueue, 0 when the type is not coalesced
 };
 
+typedef enum
+{
+    kMSPEventPriorityHigh,      ///< exit/teardown events that must not wait behind anything else
+    kMSPEventPriorityNormal,    ///< default lane for every event type
+    kMSPEventPriorityLow,       ///< high rate status updates (PSI/CCI updates, notifications)
+    kMSPEventPriorityCount
+} eMSPEventPriority;
+
 struct CallBackTimer
 {
     Event* evt;
@@ -34,26 +74,171 @@ struct CallBackTimer
 };
 
 
+/**
+ * Notified by MSPEventQueue instead of waking a thread blocked in popEventQueue().
+ * Both calls may come from any thread, including with the queue lock held, so
+ * implementations must only schedule work and never call back into the queue.
+ */
+// Called with the queue mutex held: a listener must not call back into the queue
+// other than hasPendingEvents()
+class MSPEventQueueListener
+{
+public:
+    virtual ~MSPEventQueueListener() {}
+    // an event has been queued
+    virtual void eventQueued(void) = 0;
+    // a scheduled event becomes due at dueMs (CLOCK_MONOTONIC milliseconds)
+    virtual void eventScheduled(unsigned long long dueMs) = 0;
+};
+
+
 class MSPEventQueue
 {
 public:
     void dispatchEvent(unsigned int eventType, void *eventData = NULL);
     void freeEvent(Event* event);
     Event* popEventQueue(void);
+    // Non blocking pop (expires due scheduled events first), NULL when nothing is pending
+    Event* tryPopEventQueue(void);
+    // true when an event can be popped right now (scheduled events not yet due excluded)
+    bool hasPendingEvents(void) const;
     void flushQueue(void);
 
+    // Hand the queue to a listener instead of a popEventQueue() thread, NULL to detach.
+    // Returns after any notification of the old listener has returned.
+    void setListener(MSPEventQueueListener* listener);
+
     // Set time out in seconds
     void setTimeOutSecs(unsigned int waitTime);
+    // Set time out in milliseconds
+    void setTimeOutMsecs(unsigned int waitTimeMs);
     void unSetTimeOut();
 
+    // Dispatch eventType/eventData on this queue once delayMs have elapsed.
+    // The event goes through the same lanes/coalescing as dispatchEvent().
+    tMSPEventTimerId scheduleEvent(unsigned int eventType, void *eventData, unsigned int delayMs);
+    // Cancel a scheduled event.  Returns false when it already fired (its event
+    // may still be pending in the queue) or the id is unknown.  eventData is
+    // never released by the queue.
+    bool cancelScheduledEvent(tMSPEventTimerId timerId);
+    // CLOCK_MONOTONIC ms at which the next scheduled event is due, false when none is pending
+    bool getNextScheduledMs(unsigned long long *dueMs);
+
+    // The event popEventQueue() returns on time out, freeEvent() ignores it
+    static Event* getTimeOutEvent(void);
+    static unsigned long long monotonicMs(void);
+
+    // Lane the given event type is queued on (kMSPEventPriorityNormal by default)
+    void setEventPriority(unsigned int eventType, eMSPEventPriority priority);
+    // Deliver only the newest pending event of this type.  Only for events whose
+    // eventData is NULL or not owned by the event, dropped events are not released.
+    void setEventCoalescing(unsigned int eventType, bool coalesce);
+    // Number of events dropped so far because a newer event of the same type was queued
+    unsigned int getCoalescedCount() const;
+
     ~MSPEventQueue();
-    MSPEventQueue();
+    MSPEventQueue(unsigned int capacity = kMSPEventQueueDefaultCapacity);
 
 private:
-    std::list <Event*>    mQueue;
+    /**
+     * Bounded multi-producer/multi-consumer ring of Event pointers.
+     * Each cell carries a sequence number that tells producers and consumers
+     * whether the cell is free or filled for their current lap, so push/pop
+     * only need a single CAS on the shared position.
+     */
+    class EventRing
+    {
+    public:
+        explicit EventRing(unsigned int capacity);
+        ~EventRing();
+
+        bool push(Event* event);
+        Event* pop(void);
+        bool isEmpty(void) const;
+
+    private:
+        struct Cell
+        {
+            volatile unsigned int sequence;
+            Event* event;
+        };
+
+        Cell* mCells;
+        unsigned int mMask;
+        char mPad0[64];                      // keep producer and consumer positions on separate cache lines
+        volatile unsigned int mEnqueuePos;
+        char mPad1[64];
+        volatile unsigned int mDequeuePos;
+
+        EventRing(const EventRing&);
+        EventRing& operator=(const EventRing&);
+    };
+
+    struct EventLane
+    {
+        explicit EventLane(unsigned int capacity) : ring(capacity), overflowCount(0) {}
+
+        EventRing             ring;            // events waiting to be popped
+        std::list <Event*>    overflow;        // events posted while ring was full, guarded by mMutex
+        volatile unsigned int overflowCount;   // overflow.size(), readable without the lock
+    };
+
+    struct EventClass
+    {
+        EventClass() : priority(kMSPEventPriorityNormal), coalesce(false), generation(0) {}
+
+        eMSPEventPriority     priority;
+        bool                  coalesce;
+        volatile unsigned int generation;      // coalesceGen of the newest dispatched event
+    };
+
+    struct ScheduledEvent
+    {
+        tMSPEventTimerId   id;
+        unsigned int       eventType;
+        void*              eventData;
+        unsigned long long expiryTick;
+        ScheduledEvent*    prev;
+        ScheduledEvent*    next;
+    };
+
+    void linkTimerLocked(ScheduledEvent* timer);
+    void unlinkTimerLocked(ScheduledEvent* timer);
+    void expireTimersLocked(unsigned long long nowTick);
+    bool nextTimerTickLocked(unsigned long long *tick) const;
+
+    Event* allocEvent(void);
+    void postEvent(Event* event, bool locked);
+    Event* popLane(EventLane* lane, bool locked);
+    Event* tryPop(bool locked);
+    bool isSuperseded(const Event* event) const;
+    bool isPooled(const Event* event) const;
+
+    static unsigned int roundUpPowerOf2(unsigned int value);
+
+    unsigned int          mCapacity;
+    Event*                mPool;           // backing storage for pooled events
+    EventRing             mFreePool;       // pooled events available to dispatchEvent()
+    EventLane*            mLanes[kMSPEventPriorityCount];
+    std::map <unsigned int, EventClass> mEventClasses;   // per event type lane/coalescing, see setEventPriority()
+    volatile unsigned int mCoalescedCount;
+    volatile unsigned int mWaiting;        // number of threads parked in popEventQueue()
     pthread_mutex_t  mMutex;
-    pthread_cond_t mCond;
-    unsigned int mWaitTimeSecs;
+    pthread_cond_t mCond;                  // uses CLOCK_MONOTONIC
+    unsigned int mWaitTimeMs;
+
+    ScheduledEvent*       mTimerWheel[kMSPTimerWheelSlots];     // guarded by mMutex
+    std::map <tMSPEventTimerId, ScheduledEvent*> mTimers;      // id lookup for cancel, guarded by mMutex
+    unsigned long long    mTimerTick;      // last wheel tick that has been expired
+    tMSPEventTimerId      mNextTimerId;
+    volatile unsigned int mTimerCount;     // mTimers.size(), readable without the lock
+
+    MSPEventQueueListener* volatile mListener;
+
+    static Event sTimeOutEvent;            // returned by popEventQueue() on time out, never freed
+
+    MSPEventQueue(const MSPEventQueue&);
+    MSPEventQueue& operator=(const MSPEventQueue&);
 };
 
 #endif
@@ -0,0 +1,197 @@
+/** @file eventQueue_bench.cpp
+ *
+ * @brief Micro benchmark of MSPEventQueue against the original
+ *        std::list/mutex based queue.
+ *
+ * N producer threads post events while one consumer thread pops and frees
+ * them, which is how every MSP controller thread uses the queue.  Two load
+ * shapes are measured:
+ *  - burst: producers post short bursts and let the consumer catch up, which
+ *    is what the controllers see in the field (the ring never fills).
+ *  - flood: producers post without pause, so the ring fills and the queue
+ *    runs on its overflow list.
+ * Build with "make eventQueue_bench" and run on the target.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <list>
+
+#include "eventQueue.h"
+
+#define kBenchEventsPerProducer  200000
+#define kBenchExitEvent          0xFFFF
+#define kBenchBurstSize          16
+
+/**
+ * The pre-pool MSPEventQueue, kept here verbatim (minus time out support)
+ * so both implementations are measured with the same harness.
+ */
+class ListEventQueue
+{
+public:
+    ListEventQueue()
+    {
+        pthread_mutex_init(&mMutex, NULL);
+        pthread_cond_init(&mCond, NULL);
+    }
+    ~ListEventQueue()
+    {
+        pthread_mutex_destroy(&mMutex);
+        pthread_cond_destroy(&mCond);
+    }
+    void dispatchEvent(unsigned int eventType, void *eventData = NULL)
+    {
+        Event* event = new Event;
+        event->eventType = eventType;
+        event->eventData = eventData;
+        pthread_mutex_lock(&mMutex);
+        mQueue.push_back(event);
+        pthread_cond_signal(&mCond);
+        pthread_mutex_unlock(&mMutex);
+    }
+    Event* popEventQueue(void)
+    {
+        pthread_mutex_lock(&mMutex);
+        while (mQueue.size() == 0)
+        {
+            pthread_cond_wait(&mCond, &mMutex);
+        }
+        Event* p = mQueue.front();
+        mQueue.pop_front();
+        pthread_mutex_unlock(&mMutex);
+        return p;
+    }
+    void freeEvent(Event* event)
+    {
+        delete event;
+    }
+
+private:
+    std::list <Event*> mQueue;
+    pthread_mutex_t mMutex;
+    pthread_cond_t mCond;
+};
+
+template <class Q>
+struct BenchContext
+{
+    Q* queue;
+    unsigned int producers;
+    bool burst;
+    volatile unsigned long received;
+};
+
+template <class Q>
+static void* producerFunc(void *data)
+{
+    BenchContext<Q>* ctx = (BenchContext<Q>*) data;
+    for (unsigned int i = 0; i < kBenchEventsPerProducer; i++)
+    {
+        ctx->queue->dispatchEvent(i & 0xFF, NULL);
+        if (ctx->burst && ((i % kBenchBurstSize) == (kBenchBurstSize - 1)))
+        {
+            unsigned long target = ((unsigned long)(i + 1) * ctx->producers) - (kBenchBurstSize * ctx->producers);
+            while (__sync_fetch_and_add(&ctx->received, 0) < target)
+            {
+                sched_yield();
+            }
+        }
+    }
+    ctx->queue->dispatchEvent(kBenchExitEvent, NULL);
+    return NULL;
+}
+
+template <class Q>
+static void* consumerFunc(void *data)
+{
+    BenchContext<Q>* ctx = (BenchContext<Q>*) data;
+    unsigned int exits = 0;
+    while (exits < ctx->producers)
+    {
+        Event* evt = ctx->queue->popEventQueue();
+        if (evt->eventType == kBenchExitEvent)
+        {
+            exits++;
+        }
+        else
+        {
+            __sync_add_and_fetch(&ctx->received, 1);
+        }
+        ctx->queue->freeEvent(evt);
+    }
+    return NULL;
+}
+
+static double nowSecs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+template <class Q>
+static double runBench(Q* queue, unsigned int producers, bool burst)
+{
+    BenchContext<Q> ctx;
+    pthread_t consumer;
+    pthread_t threads[16];
+
+    ctx.queue = queue;
+    ctx.producers = producers;
+    ctx.burst = burst;
+    ctx.received = 0;
+
+    double start = nowSecs();
+    pthread_create(&consumer, NULL, consumerFunc<Q>, &ctx);
+    for (unsigned int i = 0; i < producers; i++)
+    {
+        pthread_create(&threads[i], NULL, producerFunc<Q>, &ctx);
+    }
+    for (unsigned int i = 0; i < producers; i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_join(consumer, NULL);
+    double elapsed = nowSecs() - start;
+
+    if (ctx.received != (unsigned long) producers * kBenchEventsPerProducer)
+    {
+        printf("ERROR: received %lu events, expected %lu\n", ctx.received,
+               (unsigned long) producers * kBenchEventsPerProducer);
+        exit(1);
+    }
+    return elapsed;
+}
+
+int main(void)
+{
+    static const unsigned int producerCounts[] = { 1, 2, 4, 8 };
+
+    for (int mode = 0; mode < 2; mode++)
+    {
+        bool burst = (mode == 0);
+
+        printf("%s\n", burst ? "burst" : "flood");
+        printf("%-10s %-16s %-16s %-8s\n", "producers", "list ns/event", "ring ns/event", "speedup");
+        for (unsigned int i = 0; i < sizeof(producerCounts) / sizeof(producerCounts[0]); i++)
+        {
+            unsigned int producers = producerCounts[i];
+            double events = (double) producers * kBenchEventsPerProducer;
+
+            ListEventQueue listQueue;
+            double listSecs = runBench(&listQueue, producers, burst);
+
+            MSPEventQueue ringQueue;
+            double ringSecs = runBench(&ringQueue, producers, burst);
+
+            printf("%-10u %-16.1f %-16.1f %-8.2f\n", producers,
+                   (listSecs * 1e9) / events, (ringSecs * 1e9) / events, listSecs / ringSecs);
+        }
+    }
+
+    return 0;
+}
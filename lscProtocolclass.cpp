@@ -8,6 +8,7 @@
 #include <netdb.h>
 
 #include "lscProtocolclass.h"
+#include "vodDnsCache.h"
 
 #define Close(x) do{dlog(DL_MSP_ONDEMAND, DLOGL_MINOR_DEBUG,"%s:%s:%d ZZClose=%d",__FILE__,__FUNCTION__,__LINE__, x); close(x); (x)=-1;}while(0)
 
@@ -394,20 +395,12 @@ status VodLscp_Base::ParseLscpMessageHdr(ui8 * data, ui32 length,
         // remember the start of the message
         start = data;
 
-        // protocol version
-        data = Utils::Get1Byte(data, &version);
-
-        // transaction-id
-        data = Utils::Get1Byte(data, &transactionid);
-
-        // op-code / message ID
-        data = Utils::Get1Byte(data, &opcode);
-
-        // status code
-        data = Utils::Get1Byte(data, &statuscode);
-
-        // Stream - handle
-        data = Utils::Get4Byte(data, &streamhandle);
+        version = LscpHeaderLayout::Version::get(data);
+        transactionid = LscpHeaderLayout::TransactionId::get(data);
+        opcode = LscpHeaderLayout::Opcode::get(data);
+        statuscode = LscpHeaderLayout::StatusCode::get(data);
+        streamhandle = LscpHeaderLayout::StreamHandle::get(data);
+        data += LscpHeaderLayout::Size;
 
         //
         *newData = data;
@@ -448,21 +441,12 @@ status VodLscp_Base::CreateLscpMessageHeader(ui8 * msgData, ui32 msgDataLength,
         ui8 * work = buffer;
 
         // We add the standard message header fields
-
-        // Version
-        work = Utils::Put1Byte(work, version);
-
-        // Transaction -id
-        work = Utils::Put1Byte(work, transactionid);
-
-        // Opcode / Message ID
-        work = Utils::Put1Byte(work, opcode);
-
-        // Statuscode
-        work = Utils::Put1Byte(work, statuscode);
-
-        // Stream Handle
-        work = Utils::Put4Byte(work, streamhandle);
+        LscpHeaderLayout::Version::put(work, version);
+        LscpHeaderLayout::TransactionId::put(work, transactionid);
+        LscpHeaderLayout::Opcode::put(work, opcode);
+        LscpHeaderLayout::StatusCode::put(work, statuscode);
+        LscpHeaderLayout::StreamHandle::put(work, streamhandle);
+        work += LscpHeaderLayout::Size;
 
         // Message length (length of all data that follows this field)
         // work = Utils::Put2Byte(work, msgDataLength);
@@ -590,7 +574,6 @@ i32 VodLscp_Base::GetSocket(string ip, ui16 portno)
 {
     i32 sockfd = -1;
     struct sockaddr_in serv_addr;
-    struct hostent *server;
 
     //assuming recv and send port number the same, for testing.
     if (portno == 0)
@@ -615,8 +598,8 @@ i32 VodLscp_Base::GetSocket(string ip, ui16 portno)
 
     dlog(DL_MSP_ONDEMAND, DLOGL_MINOR_DEBUG, "%s:%s:%d ZZOpen fd %d", __FILE__, __FUNCTION__, __LINE__, sockfd);
 
-    server = gethostbyname(ip.c_str());
-    if (server == NULL)
+    bzero((char *) &serv_addr, sizeof(serv_addr));
+    if (!VodDnsCache::getInstance()->resolve(ip, &serv_addr.sin_addr))
     {
         dlog(DL_MSP_ONDEMAND, DLOGL_FUNCTION_CALLS,
              "VodLscp_Base::GetSocket() No such server host known");
@@ -624,10 +607,7 @@ i32 VodLscp_Base::GetSocket(string ip, ui16 portno)
         return -1;
     }
 
-    bzero((char *) &serv_addr, sizeof(serv_addr));
     serv_addr.sin_family = AF_INET;
-    bcopy((char *) server->h_addr, (char *) &serv_addr.sin_addr.s_addr,
-          server->h_length);
     serv_addr.sin_port = htons(portno);
 
     if (connect(sockfd, (const sockaddr*) &serv_addr, sizeof(serv_addr)) < 0)
@@ -81,6 +81,18 @@ typedef enum
 #define LSCP_MSG_BODY_SIZE 12
 #define LSC_MSG_SIZE      20
 
+//LSC header fields
+struct LscpHeaderLayout
+{
+    typedef VodField<0, ui8>  Version;
+    typedef VodField<1, ui8>  TransactionId;
+    typedef VodField<2, ui8>  Opcode;
+    typedef VodField<3, ui8>  StatusCode;
+    typedef VodField<4, ui32> StreamHandle;
+    enum { Size = LSC_HEADER_SIZE };
+};
+VOD_LAYOUT_CHECK(LscpHeaderLayout, StreamHandle);
+
 //#define LSCP_SESSMSG_TYPE		0x?
 //#define LSCP_SESSIONID_LEN		0x?
 //#define LSCP_CLIENTID_LEN 		0x?
@@ -0,0 +1,324 @@
+/**
+   \file lscpPipeline.cpp
+   \class LscpPipeline
+
+Implementation file for the asynchronous LSCP command pipeline
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <dlog.h>
+
+#include "lscpPipeline.h"
+#include "monotonicTime.h"
+
+#define LOG(level, msg, args...)  dlog(DL_MSP_ONDEMAND, level,"LscpPipeline:%s:%d " msg, __FUNCTION__, __LINE__, ##args);
+
+LscpPipeline::LscpPipeline()
+{
+    pthread_mutex_init(&mMutex, NULL);
+    mEventLoop = NULL;
+    mTimer = NULL;
+    mMotionInFlight = false;
+    mMotionTransId = 0;
+    mMotionSeq = 0;
+    mHeldFd = -1;
+    mHeldTransId = 0;
+    mHeldOpcode = 0;
+    mHeldData = NULL;
+    mHeldLength = 0;
+    mRxLength = 0;
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+LscpPipeline::~LscpPipeline()
+{
+    reset();
+    pthread_mutex_destroy(&mMutex);
+}
+
+void LscpPipeline::setEventLoop(EventLoop *evtLoop)
+{
+    pthread_mutex_lock(&mMutex);
+    mEventLoop = evtLoop;
+    pthread_mutex_unlock(&mMutex);
+}
+
+bool LscpPipeline::isMotion(ui8 opcode)
+{
+    return (opcode == LSC_PLAY) || (opcode == LSC_PAUSE) || (opcode == LSC_RESUME) || (opcode == LSC_JUMP);
+}
+
+bool LscpPipeline::send(int32_t fd, ui8 transId, ui8 opcode, ui8 *data, ui32 length)
+{
+    bool status = true;
+
+    pthread_mutex_lock(&mMutex);
+    prune();
+    if (isMotion(opcode))
+    {
+        mMotionSeq++;
+    }
+
+    if (isMotion(opcode) && mMotionInFlight)
+    {
+        if (mHeldData)
+        {
+            LOG(DLOGL_NOISE, "opcode:%x transId:%d replaces held opcode:%x transId:%d", opcode, transId, mHeldOpcode, mHeldTransId);
+            free(mHeldData);
+            mStats.cancelled++;
+        }
+        mHeldFd = fd;
+        mHeldTransId = transId;
+        mHeldOpcode = opcode;
+        mHeldData = data;
+        mHeldLength = length;
+        mStats.held++;
+    }
+    else
+    {
+        status = transmit(fd, transId, opcode, data, length);
+    }
+    pthread_mutex_unlock(&mMutex);
+    return status;
+}
+
+bool LscpPipeline::transmit(int32_t fd, ui8 transId, ui8 opcode, ui8 *data, ui32 length)
+{
+    bool status = false;
+
+    if (fd < 0)
+    {
+        LOG(DLOGL_ERROR, "Invalid socket");
+    }
+    else if (::write(fd, data, length) != (ssize_t) length)
+    {
+        LOG(DLOGL_ERROR, "Socket send error:%d opcode:%x", errno, opcode);
+    }
+    else
+    {
+        Command cmd;
+        cmd.opcode = opcode;
+        cmd.motionSeq = mMotionSeq;
+        cmd.sentMs = monotonicNowMs();
+        mInFlight[transId] = cmd;
+        mStats.sent++;
+        if (isMotion(opcode))
+        {
+            mMotionInFlight = true;
+            mMotionTransId = transId;
+            armTimer();
+        }
+        LOG(DLOGL_NOISE, "opcode:%x transId:%d in flight:%d", opcode, transId, mInFlight.size());
+        status = true;
+    }
+    free(data);
+    return status;
+}
+
+void LscpPipeline::sendHeld(void)
+{
+    if (mHeldData)
+    {
+        ui8 *data = mHeldData;
+        mHeldData = NULL;
+        transmit(mHeldFd, mHeldTransId, mHeldOpcode, data, mHeldLength);
+    }
+}
+
+// commands not answered in time are lost, their transaction ids get reused
+void LscpPipeline::prune(void)
+{
+    uint64_t now = monotonicNowMs();
+    std::map<ui8, Command>::iterator itr = mInFlight.begin();
+
+    while (itr != mInFlight.end())
+    {
+        if (now - itr->second.sentMs >= kLscpReplyTimeoutSecs * 1000)
+        {
+            LOG(DLOGL_MINOR_EVENT, "no reply to opcode:%x transId:%d", itr->second.opcode, itr->first);
+            if (mMotionInFlight && (itr->first == mMotionTransId))
+            {
+                mMotionInFlight = false;
+            }
+            mInFlight.erase(itr++);
+            mStats.timedOut++;
+        }
+        else
+        {
+            ++itr;
+        }
+    }
+}
+
+eLscpReplyMatch LscpPipeline::complete(ui8 transId)
+{
+    eLscpReplyMatch match = kLscpReply_Unmatched;
+
+    pthread_mutex_lock(&mMutex);
+    std::map<ui8, Command>::iterator itr = mInFlight.find(transId);
+    if (itr == mInFlight.end())
+    {
+        mStats.unmatched++;
+    }
+    else
+    {
+        uint32_t latency = monotonicNowMs() - itr->second.sentMs;
+        if (itr->second.opcode <= LSC_PLAY)
+        {
+            tLscpLatency *lat = &mStats.latency[itr->second.opcode];
+            lat->count++;
+            lat->totalMs += latency;
+            if (latency > lat->maxMs)
+            {
+                lat->maxMs = latency;
+            }
+        }
+
+        match = (itr->second.motionSeq == mMotionSeq) ? kLscpReply_Current : kLscpReply_Superseded;
+        if (match == kLscpReply_Superseded)
+        {
+            mStats.superseded++;
+        }
+        LOG(DLOGL_NOISE, "opcode:%x transId:%d latency:%d ms %s", itr->second.opcode, transId, latency,
+            (match == kLscpReply_Current) ? "current" : "superseded");
+        mInFlight.erase(itr);
+
+        if (mMotionInFlight && (transId == mMotionTransId))
+        {
+            mMotionInFlight = false;
+            disarmTimer();
+            sendHeld();
+        }
+    }
+    pthread_mutex_unlock(&mMutex);
+    return match;
+}
+
+int32_t LscpPipeline::receive(int32_t fd, ui8 *buf, ui32 size)
+{
+    if (mRxLength < LSC_MSG_SIZE)
+    {
+        ssize_t got = recv(fd, mRxBuffer + mRxLength, sizeof(mRxBuffer) - mRxLength, MSG_DONTWAIT);
+        if (got == 0)
+        {
+            LOG(DLOGL_ERROR, "connection closed");
+            return -1;
+        }
+        if (got < 0)
+        {
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+            {
+                return 0;
+            }
+            LOG(DLOGL_ERROR, "recv error:%d", errno);
+            return -1;
+        }
+        mRxLength += got;
+        if (mRxLength < LSC_MSG_SIZE)
+        {
+            return 0;
+        }
+    }
+
+    ui32 length = (size < LSC_MSG_SIZE) ? size : LSC_MSG_SIZE;
+    memcpy(buf, mRxBuffer, length);
+    mRxLength -= LSC_MSG_SIZE;
+    memmove(mRxBuffer, mRxBuffer + LSC_MSG_SIZE, mRxLength);
+    return length;
+}
+
+void LscpPipeline::reset(void)
+{
+    pthread_mutex_lock(&mMutex);
+    disarmTimer();
+    mInFlight.clear();
+    mMotionInFlight = false;
+    if (mHeldData)
+    {
+        free(mHeldData);
+        mHeldData = NULL;
+    }
+    mRxLength = 0;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void LscpPipeline::armTimer(void)
+{
+    if (mEventLoop && !mTimer)
+    {
+        mTimer = mEventLoop->addTimer(EVENTTIMER_TIMEOUT, kLscpReplyTimeoutSecs, 0, LscpPipeline::TimeoutCallBack, (void *) this);
+    }
+}
+
+void LscpPipeline::disarmTimer(void)
+{
+    if (mEventLoop && mTimer)
+    {
+        mEventLoop->delTimer(mTimer);
+    }
+    mTimer = NULL;
+}
+
+void LscpPipeline::TimeoutCallBack(int32_t fd, short event, void *arg)
+{
+    (void) fd;
+    (void) event;
+
+    EventTimer* pEvt = (EventTimer*) arg;
+    if (NULL != pEvt)
+    {
+        LscpPipeline *pipeline = (LscpPipeline *) pEvt->getUserData();
+        if (pipeline)
+        {
+            pthread_mutex_lock(&pipeline->mMutex);
+            if (pipeline->mTimer == pEvt)
+            {
+                pipeline->mTimer = NULL;
+                // drops the overdue command in flight and lets the held one go
+                pipeline->prune();
+                if (!pipeline->mMotionInFlight)
+                {
+                    pipeline->sendHeld();
+                }
+                else
+                {
+                    pipeline->armTimer();
+                }
+            }
+            pthread_mutex_unlock(&pipeline->mMutex);
+        }
+        delete pEvt;
+        pEvt = NULL;
+    }
+}
+
+void LscpPipeline::getStats(tLscpPipelineStats *stats)
+{
+    pthread_mutex_lock(&mMutex);
+    *stats = mStats;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void LscpPipeline::logStats(void)
+{
+    static const char *opcodeName[LSC_PLAY + 1] = { "", "pause", "resume", "status", "reset", "jump", "play" };
+    tLscpPipelineStats stats;
+
+    getStats(&stats);
+    LOG(DLOGL_NORMAL, "sent:%d held:%d cancelled:%d superseded:%d timedOut:%d unmatched:%d",
+        stats.sent, stats.held, stats.cancelled, stats.superseded, stats.timedOut, stats.unmatched);
+    for (int opcode = LSC_PAUSE; opcode <= LSC_PLAY; opcode++)
+    {
+        const tLscpLatency *lat = &stats.latency[opcode];
+        if (lat->count)
+        {
+            LOG(DLOGL_NORMAL, "%s: count:%d avg:%d max:%d ms", opcodeName[opcode], lat->count,
+                (uint32_t)(lat->totalMs / lat->count), lat->maxMs);
+        }
+    }
+}
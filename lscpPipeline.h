@@ -0,0 +1,127 @@
+/**
+   \file lscpPipeline.h
+   \class LscpPipeline
+
+   Asynchronous LSCP command pipeline of a stream control connection.
+
+   Commands are written to the stream control socket without waiting for the
+   replies of the ones before, and a reply is matched to its command by
+   transaction id.  Speed and position commands (play, pause, resume, jump)
+   are "latest wins": while one is waiting for its reply a new one is held
+   rather than sent, and a newer one replaces the held one, so a burst of
+   FF/REW key presses costs the server at most one command in flight and the
+   last one pressed.  The held command is sent when the reply to the one in
+   flight arrives, or when that reply is overdue.  A reply to a command sent
+   before the latest speed or position command is reported as superseded:
+   its position and speed are stale.
+
+   The socket is a TCP stream: receive() reads what is there and hands out
+   whole messages.  All the server messages are LSC_MSG_SIZE bytes long.
+
+   The timer that sends an overdue held command runs on the OnDemand event
+   loop, as does receive(); send() may be called from any thread.
+*/
+
+#if !defined(LSCP_PIPELINE_H)
+#define LSCP_PIPELINE_H
+
+#include <stdint.h>
+#include <map>
+#include <pthread.h>
+#include <eventLoop.h>
+
+#include "lscProtocolclass.h"
+
+#define kLscpReplyTimeoutSecs   3                   ///< a command not answered by then is lost
+#define kLscpRxBufferSize       (LSC_MSG_SIZE * 8)
+
+typedef enum
+{
+    kLscpReply_Current,      ///< reply to the latest speed/position command or to a command sent after it
+    kLscpReply_Superseded,   ///< reply to a command sent before the latest speed/position command
+    kLscpReply_Unmatched     ///< unsolicited, late or duplicate
+} eLscpReplyMatch;
+
+typedef struct
+{
+    unsigned int count;
+    unsigned int maxMs;
+    uint64_t     totalMs;
+} tLscpLatency;
+
+typedef struct
+{
+    unsigned int sent;
+    unsigned int held;           ///< speed/position commands held behind the one in flight
+    unsigned int cancelled;      ///< held commands replaced by a newer one before being sent
+    unsigned int superseded;     ///< replies to commands overtaken by a newer speed/position command
+    unsigned int timedOut;
+    unsigned int unmatched;
+    tLscpLatency latency[LSC_PLAY + 1];   ///< by request opcode
+} tLscpPipelineStats;
+
+class LscpPipeline
+{
+public:
+    LscpPipeline();
+    ~LscpPipeline();
+
+    /// Event loop of the overdue command timer
+    void setEventLoop(EventLoop *evtLoop);
+
+    /// Sends a command packed by PackLscpMessageBody() on fd, or holds it behind the speed/position
+    /// command in flight.  Takes data, which is freed once sent or cancelled.  False when the write failed
+    bool send(int32_t fd, ui8 transId, ui8 opcode, ui8 *data, ui32 length);
+    /// Next whole message from fd into buf: its length, 0 when there is none yet, -1 when the connection failed
+    int32_t receive(int32_t fd, ui8 *buf, ui32 size);
+    /// A reply to transId arrived: records its latency and sends the held command when it was the one in flight
+    eLscpReplyMatch complete(ui8 transId);
+    /// Forget the commands in flight, the connection is gone
+    void reset(void);
+
+    void getStats(tLscpPipelineStats *stats);
+    void logStats(void);
+
+private:
+    struct Command
+    {
+        ui8      opcode;
+        uint32_t motionSeq;      ///< latest speed/position command when this one was sent
+        uint64_t sentMs;
+    };
+
+    static bool isMotion(ui8 opcode);
+    static void TimeoutCallBack(int32_t fd, short event, void *arg);
+
+    bool transmit(int32_t fd, ui8 transId, ui8 opcode, ui8 *data, ui32 length);
+    void sendHeld(void);
+    void prune(void);
+    void armTimer(void);
+    void disarmTimer(void);
+
+    pthread_mutex_t mMutex;
+    EventLoop      *mEventLoop;
+    EventTimer     *mTimer;
+
+    std::map<ui8, Command> mInFlight;
+    bool            mMotionInFlight;
+    ui8             mMotionTransId;
+    uint32_t        mMotionSeq;
+
+    // held speed/position command
+    int32_t         mHeldFd;
+    ui8             mHeldTransId;
+    ui8             mHeldOpcode;
+    ui8            *mHeldData;
+    ui32            mHeldLength;
+
+    ui8             mRxBuffer[kLscpRxBufferSize];
+    ui32            mRxLength;
+
+    tLscpPipelineStats mStats;
+
+    LscpPipeline(const LscpPipeline&);
+    LscpPipeline& operator=(const LscpPipeline&);
+};
+
+#endif
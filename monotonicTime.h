@@ -0,0 +1,62 @@
+/** @file monotonicTime.h
+ *
+ * @brief CLOCK_MONOTONIC helpers.
+ *
+ * The event queue timers, the worker pool and the modules timing out on
+ * their own condition variables (created with pthread_condattr_setclock()
+ * on CLOCK_MONOTONIC) read the clock and build their deadlines here, so
+ * wall clock changes (NTP/STT time set) do not move them.
+ */
+
+#ifndef _MONOTONIC_TIME_H_
+#define _MONOTONIC_TIME_H_
+
+#include <stdint.h>
+#include <time.h>
+
+/// Milliseconds on CLOCK_MONOTONIC
+static inline uint64_t monotonicNowMs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t) now.tv_sec * 1000) + (now.tv_nsec / 1000000);
+}
+
+/// Deadline at CLOCK_MONOTONIC atMs, for pthread_cond_timedwait()
+static inline void monotonicDeadlineAt(uint64_t atMs, struct timespec *deadline)
+{
+    deadline->tv_sec = atMs / 1000;
+    deadline->tv_nsec = (atMs % 1000) * 1000000;
+}
+
+/// Deadline timeoutMs from now, for pthread_cond_timedwait()
+static inline void monotonicDeadlineIn(uint32_t timeoutMs, struct timespec *deadline)
+{
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += timeoutMs / 1000;
+    deadline->tv_nsec += (timeoutMs % 1000) * 1000000;
+    if (deadline->tv_nsec >= 1000000000)
+    {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000;
+    }
+}
+
+/// Milliseconds left until deadline, 0 when it is past
+static inline int monotonicRemainingMs(const struct timespec &deadline)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long ms = ((deadline.tv_sec - now.tv_sec) * 1000) + ((deadline.tv_nsec - now.tv_nsec) / 1000000);
+    return (ms > 0) ? (int) ms : 0;
+}
+
+/// Milliseconds since start, taken with clock_gettime(CLOCK_MONOTONIC)
+static inline uint64_t monotonicElapsedMs(const struct timespec &start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t)(now.tv_sec - start.tv_sec) * 1000) + ((now.tv_nsec - start.tv_nsec) / 1000000);
+}
+
+#endif
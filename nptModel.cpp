@@ -0,0 +1,243 @@
+/**
+   \file nptModel.cpp
+   \class NptModel
+
+Implementation file for the local NPT model of a VOD stream
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <dlog.h>
+
+#include "nptModel.h"
+#include "monotonicTime.h"
+
+#define LOG(level, msg, args...)  dlog(DL_MSP_ONDEMAND, level,"NptModel:%s:%d " msg, __FUNCTION__, __LINE__, ##args);
+
+NptModel::NptModel()
+{
+    pthread_mutex_init(&mMutex, NULL);
+    mPositionKnown = false;
+    mSpeedKnown = false;
+    mSyncNptMs = 0;
+    mSyncTimeMs = 0;
+    mNum = 1;
+    mDen = 1;
+    mEndMs = 0;
+    mResyncMs = kNptResyncMinMs;
+    mResyncLimitMs = kNptResyncMaxMs;
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+NptModel::~NptModel()
+{
+    pthread_mutex_destroy(&mMutex);
+}
+
+uint64_t NptModel::nowMs(void)
+{
+    return monotonicNowMs();
+}
+
+// position at now from the last sync, within the asset
+int32_t NptModel::predict(uint64_t now)
+{
+    int64_t npt = mSyncNptMs + ((int64_t)(now - mSyncTimeMs) * mNum) / mDen;
+
+    if (npt < 0)
+    {
+        npt = 0;
+    }
+    if ((mEndMs > 0) && (npt > mEndMs))
+    {
+        npt = mEndMs;
+    }
+    return (int32_t) npt;
+}
+
+void NptModel::sync(int32_t nptMs, int16_t num, uint16_t den)
+{
+    if (den == 0)
+    {
+        LOG(DLOGL_ERROR, "invalid speed %d/%d", num, den);
+        invalidate();
+        return;
+    }
+
+    pthread_mutex_lock(&mMutex);
+    uint64_t now = nowMs();
+
+    // a prediction at an unchanged speed can be checked, anything else starts over
+    if (mPositionKnown && mSpeedKnown && ((int32_t) num * mDen == (int32_t) mNum * den))
+    {
+        uint32_t drift = abs(predict(now) - nptMs);
+        if (drift > mStats.maxDriftMs)
+        {
+            mStats.maxDriftMs = drift;
+        }
+        if (drift > kNptDriftToleranceMs)
+        {
+            LOG(DLOGL_MINOR_EVENT, "drift:%d ms after %d ms", drift, (uint32_t)(now - mSyncTimeMs));
+            mStats.drifts++;
+            mResyncMs = kNptResyncMinMs;
+        }
+        else
+        {
+            mResyncMs = (mResyncMs * 2 < mResyncLimitMs) ? mResyncMs * 2 : mResyncLimitMs;
+        }
+    }
+    else
+    {
+        mResyncMs = kNptResyncMinMs;
+    }
+
+    mSyncNptMs = nptMs;
+    mSyncTimeMs = now;
+    mNum = num;
+    mDen = den;
+    mPositionKnown = true;
+    mSpeedKnown = true;
+    mStats.syncs++;
+    LOG(DLOGL_REALLY_NOISY, "npt:%d ms speed:%d/%d resync in %d ms", nptMs, num, den, mResyncMs);
+    pthread_mutex_unlock(&mMutex);
+}
+
+void NptModel::syncPosition(int32_t nptMs)
+{
+    pthread_mutex_lock(&mMutex);
+    bool speedKnown = mSpeedKnown;
+    int16_t num = mNum;
+    uint16_t den = mDen;
+    if (!speedKnown)
+    {
+        mSyncNptMs = nptMs;
+        mSyncTimeMs = nowMs();
+        mPositionKnown = true;
+    }
+    pthread_mutex_unlock(&mMutex);
+
+    if (speedKnown)
+    {
+        sync(nptMs, num, den);
+    }
+}
+
+void NptModel::syncSpeed(int16_t num, uint16_t den)
+{
+    pthread_mutex_lock(&mMutex);
+    mPositionKnown = false;
+    mSpeedKnown = (den != 0);
+    mNum = num;
+    mDen = den ? den : 1;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void NptModel::invalidate(void)
+{
+    pthread_mutex_lock(&mMutex);
+    mPositionKnown = false;
+    mSpeedKnown = false;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void NptModel::setEnd(int32_t endMs)
+{
+    pthread_mutex_lock(&mMutex);
+    mEndMs = (endMs > 0) ? endMs : 0;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void NptModel::setResyncLimit(uint32_t maxMs)
+{
+    pthread_mutex_lock(&mMutex);
+    mResyncLimitMs = (maxMs > kNptResyncMinMs) ? maxMs : kNptResyncMinMs;
+    if (mResyncMs > mResyncLimitMs)
+    {
+        mResyncMs = mResyncLimitMs;
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+bool NptModel::position(int32_t *nptMs)
+{
+    bool known = false;
+
+    pthread_mutex_lock(&mMutex);
+    uint64_t now = nowMs();
+    uint64_t sinceSync = now - mSyncTimeMs;
+
+    if (mPositionKnown && mSpeedKnown && (sinceSync < mResyncMs))
+    {
+        int32_t npt = predict(now);
+        known = true;
+
+        if (mNum != 0)
+        {
+            // play time left to the end the stream is moving towards
+            int64_t left = -1;
+            if (mNum < 0)
+            {
+                left = npt;
+            }
+            else if (mEndMs > 0)
+            {
+                left = mEndMs - npt;
+            }
+
+            if (left == 0)
+            {
+                known = false;
+            }
+            else if ((left > 0) && ((left * mDen) / abs(mNum) < kNptEdgeMs) && (sinceSync >= kNptResyncMinMs))
+            {
+                known = false;
+            }
+        }
+
+        if (known)
+        {
+            *nptMs = npt;
+        }
+    }
+
+    if (known)
+    {
+        mStats.localAnswers++;
+    }
+    else
+    {
+        mStats.serverQueries++;
+    }
+    pthread_mutex_unlock(&mMutex);
+    return known;
+}
+
+bool NptModel::speed(int16_t *num, uint16_t *den)
+{
+    pthread_mutex_lock(&mMutex);
+    bool known = mSpeedKnown;
+    if (known)
+    {
+        *num = mNum;
+        *den = mDen;
+    }
+    pthread_mutex_unlock(&mMutex);
+    return known;
+}
+
+void NptModel::getStats(tNptModelStats *stats)
+{
+    pthread_mutex_lock(&mMutex);
+    *stats = mStats;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void NptModel::logStats(void)
+{
+    tNptModelStats stats;
+
+    getStats(&stats);
+    LOG(DLOGL_NORMAL, "local:%d server:%d syncs:%d drifts:%d maxDrift:%d ms",
+        stats.localAnswers, stats.serverQueries, stats.syncs, stats.drifts, stats.maxDriftMs);
+}
@@ -0,0 +1,96 @@
+/**
+   \file nptModel.h
+   \class NptModel
+
+   Local model of the normal play time of a VOD stream.
+
+   The UI polls the position about once a second for the progress bar.  The
+   model answers those polls without asking the server: it is synced with the
+   NPT and speed of a server answer (LSCP reply or RTSP response) and the
+   monotonic time it arrived, and predicts
+
+        npt = syncNpt + (now - syncTime) * num / den
+
+   It has to be resynced with the server
+    - when nothing is known: before the first answer and after a speed or
+      position change is requested, until the answer to it arrives,
+    - once the resync interval is up.  Each resync measures the drift of the
+      prediction: within tolerance the interval doubles up to its limit,
+      beyond it the interval drops back to the minimum,
+    - when the prediction is within a few seconds of play time of the start
+      or the end of the asset it is moving towards, so the server has the say
+      on where the stream stops.
+*/
+
+#if !defined(NPT_MODEL_H)
+#define NPT_MODEL_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#define kNptResyncMinMs         5000        ///< resync interval after a drift and near the asset ends
+#define kNptResyncMaxMs         60000       ///< default limit of the resync interval
+#define kNptDriftToleranceMs    1000        ///< drift up to this keeps growing the resync interval
+#define kNptEdgeMs              10000       ///< wall clock time to an asset end under which the minimum interval applies
+
+typedef struct
+{
+    unsigned int localAnswers;   ///< positions predicted without the server
+    unsigned int serverQueries;  ///< positions the server had to be asked for
+    unsigned int syncs;
+    unsigned int drifts;         ///< syncs that found the prediction off by more than the tolerance
+    unsigned int maxDriftMs;
+} tNptModelStats;
+
+class NptModel
+{
+public:
+    NptModel();
+    virtual ~NptModel();
+
+    /// Server answer: the stream is at nptMs and plays at num/den
+    void sync(int32_t nptMs, int16_t num, uint16_t den);
+    /// Server answer without a speed, the speed of the last sync is kept
+    void syncPosition(int32_t nptMs);
+    /// Server answer without a position, the position is unknown until the next sync
+    void syncSpeed(int16_t num, uint16_t den);
+    /// A speed or position change was requested or the stream stopped: nothing is known until the next sync
+    void invalidate(void);
+
+    /// End of the asset in ms, 0 when not known
+    void setEnd(int32_t endMs);
+    /// Limit of the resync interval, kNptResyncMaxMs by default
+    void setResyncLimit(uint32_t maxMs);
+
+    /// Predicted position, false when the server has to be asked
+    bool position(int32_t *nptMs);
+    /// Speed of the last sync, false when the server has to be asked
+    bool speed(int16_t *num, uint16_t *den);
+
+    void getStats(tNptModelStats *stats);
+    void logStats(void);
+
+protected:
+    /// Monotonic clock in ms, overridden by the unit test
+    virtual uint64_t nowMs(void);
+
+private:
+    int32_t predict(uint64_t now);
+
+    pthread_mutex_t mMutex;
+    bool            mPositionKnown;
+    bool            mSpeedKnown;
+    int32_t         mSyncNptMs;
+    uint64_t        mSyncTimeMs;
+    int16_t         mNum;
+    uint16_t        mDen;
+    int32_t         mEndMs;
+    uint32_t        mResyncMs;
+    uint32_t        mResyncLimitMs;
+    tNptModelStats  mStats;
+
+    NptModel(const NptModel&);
+    NptModel& operator=(const NptModel&);
+};
+
+#endif
@@ -0,0 +1,177 @@
+/**
+
+\file nptModel_test.h -- contains the cxxtest test cases for the local NPT model
+
+The model runs on a clock the test sets.  A stream is synced, polled every
+second as the UI does and resynced whenever the model asks for the server,
+with the server position following the speed exactly or with a drift.
+*/
+
+#if !defined(NPT_MODEL_TEST_H)
+#define NPT_MODEL_TEST_H
+
+#include <cxxtest/TestSuite.h>
+
+#include "nptModel.h"
+
+class TestNptModel : public NptModel
+{
+public:
+    TestNptModel() : mNow(1000000) {}
+
+    uint64_t mNow;
+
+protected:
+    uint64_t nowMs(void)
+    {
+        return mNow;
+    }
+};
+
+class nptModelTestSuite : public CxxTest::TestSuite
+{
+public:
+
+    void testNothingKnown()
+    {
+        TestNptModel model;
+        int32_t npt;
+        int16_t num;
+        uint16_t den;
+
+        TS_ASSERT(!model.position(&npt));
+        TS_ASSERT(!model.speed(&num, &den));
+
+        model.sync(10000, 1, 1);
+        TS_ASSERT(model.position(&npt));
+        model.invalidate();
+        TS_ASSERT(!model.position(&npt));
+        TS_ASSERT(!model.speed(&num, &den));
+    }
+
+    void testPrediction()
+    {
+        TestNptModel model;
+        int32_t npt = 0;
+
+        model.sync(10000, 1, 1);
+        model.mNow += 2500;
+        TS_ASSERT(model.position(&npt));
+        TS_ASSERT_EQUALS(npt, 12500);
+
+        model.sync(npt, 15, 2);
+        model.mNow += 1000;
+        TS_ASSERT(model.position(&npt));
+        TS_ASSERT_EQUALS(npt, 20000);
+
+        model.sync(npt, -15, 2);
+        model.mNow += 2000;
+        TS_ASSERT(model.position(&npt));
+        TS_ASSERT_EQUALS(npt, 5000);
+
+        model.sync(npt, 0, 1);
+        model.mNow += 4000;
+        TS_ASSERT(model.position(&npt));
+        TS_ASSERT_EQUALS(npt, 5000);
+    }
+
+    void testResyncIntervalGrows()
+    {
+        TestNptModel model;
+        tNptModelStats stats;
+        int32_t npt = 0;
+        int32_t server = 600000;
+
+        model.setResyncLimit(40000);
+        model.sync(server, 1, 1);
+
+        // 10 minutes of 1 s polls with a server that plays exactly at speed
+        for (int i = 0; i < 600; i++)
+        {
+            model.mNow += 1000;
+            server += 1000;
+            if (!model.position(&npt))
+            {
+                model.sync(server, 1, 1);
+            }
+            else
+            {
+                TS_ASSERT_EQUALS(npt, server);
+            }
+        }
+
+        model.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.drifts, 0u);
+        // 5, 10, 20, 40 s then every 40 s
+        TS_ASSERT_LESS_THAN(stats.serverQueries, 20u);
+        TS_ASSERT_EQUALS(stats.localAnswers + stats.serverQueries, 600u);
+    }
+
+    void testDriftShrinksInterval()
+    {
+        TestNptModel model;
+        tNptModelStats stats;
+        int32_t npt = 0;
+
+        model.sync(0, 1, 1);
+        model.mNow += 4000;
+        model.sync(4000, 1, 1);
+        model.mNow += 9000;
+        TS_ASSERT(model.position(&npt));
+
+        // the server is 3 s behind the prediction
+        model.sync(10000, 1, 1);
+        model.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.drifts, 1u);
+        TS_ASSERT_EQUALS(stats.maxDriftMs, 3000u);
+
+        model.mNow += kNptResyncMinMs;
+        TS_ASSERT(!model.position(&npt));
+    }
+
+    void testAssetEnds()
+    {
+        TestNptModel model;
+        int32_t npt = 0;
+
+        model.setEnd(100000);
+
+        // FF at 7.5x reaches the end in 4 s of wall clock: the server is asked after kNptResyncMinMs
+        model.sync(70000, 15, 2);
+        model.mNow += 1000;
+        TS_ASSERT(model.position(&npt));
+        model.mNow += kNptResyncMinMs;
+        TS_ASSERT(!model.position(&npt));
+
+        // rewind down to the start
+        model.sync(3000, -15, 2);
+        model.mNow += 1000;
+        TS_ASSERT(!model.position(&npt));
+
+        // paused near the end stays local
+        model.sync(99000, 0, 1);
+        model.mNow += kNptResyncMinMs - 1;
+        TS_ASSERT(model.position(&npt));
+        TS_ASSERT_EQUALS(npt, 99000);
+    }
+
+    void testSpeedOnly()
+    {
+        TestNptModel model;
+        int32_t npt = 0;
+        int16_t num = 0;
+        uint16_t den = 0;
+
+        model.syncSpeed(0, 1);
+        TS_ASSERT(model.speed(&num, &den));
+        TS_ASSERT_EQUALS(num, 0);
+        TS_ASSERT(!model.position(&npt));
+
+        model.syncPosition(42000);
+        model.mNow += 3000;
+        TS_ASSERT(model.position(&npt));
+        TS_ASSERT_EQUALS(npt, 42000);
+    }
+};
+
+#endif
@@ -38,6 +38,10 @@
 #include "zapper.h"
 #include "eventQueue.h"
 #include "SeaChange_StreamControl.h"
+#include "vodSessionPrewarm.h"
+#include "vodKeepAlive.h"
+#include "dsmccTransport.h"
+#include "monotonicTime.h"
 #include "pthread_named.h"
 #include <sail-message-api.h>
 #include <csci-base-message-api.h>
@@ -113,7 +117,6 @@ OnDemand::OnDemand()
     vodSessContrl = NULL;
 
     mStreamSocketEvent = NULL;
-    mEventTimer = NULL;
 
     tunerController =  NULL;
 
@@ -127,6 +130,11 @@ OnDemand::OnDemand()
     mPendingSpeed = false;
     mPendingPosition = false;
 
+    mSpeculative = false;
+    mAdoptedBy = NULL;
+    mPrewarmState = kOnDemandStateInit;
+    mSetupStartMs = 0;
+
     pthread_mutex_init(&mStopMutex, NULL);
     pthread_cond_init(&mStopCond, NULL);
 
@@ -188,6 +196,8 @@ OnDemand::OnDemand()
             LOG(DLOGL_ERROR, "pthread_create error %d\n", err);
         }
 
+        // the back-end of the SRM is known before the first session
+        VODFactory::prefetchBackEnds();
     }
     else
     {
@@ -226,6 +236,9 @@ OnDemand::~OnDemand()
     mCallbackList.clear();
 
 
+    // no keep-alive due for this once it is gone
+    VodKeepAlive::getInstance()->remove(this);
+
     LOG(DLOGL_REALLY_NOISY, "delete tunerController\n");
     delete tunerController;
     tunerController = NULL;
@@ -262,49 +275,10 @@ void* OnDemand::evtloopthreadFunc(void *data)
 /** *********************************************************
  *
  */
-void OnDemand::SessionKeepAliveTimerCallBack(int fd, short event, void *arg)
+void OnDemand::sessionKeepAliveDue(void *session)
 {
-    // TODO: Test this - verify EventTimer is returned in args
-    UNUSED_PARAM(fd)
-    UNUSED_PARAM(event)
-
-    EventTimer* pEvt = (EventTimer*) arg;
-
-    if (pEvt)
-    {
-        EventCallbackData *sessKeepAliveEvt = (EventCallbackData *) pEvt->getUserData();
-
-        if (sessKeepAliveEvt)
-        {
-            bool result = OnDemand::checkOnDemandInstActive(sessKeepAliveEvt);
-            if (result)
-            {
-                OnDemand *onDemandInst = sessKeepAliveEvt->objPtr;
-                if (onDemandInst)
-                {
-                    onDemandInst->lockMutex();
-                    onDemandInst->HandleCallback(sessKeepAliveEvt->odEvtType);
-                    onDemandInst->unLockMutex();
-                }
-                else
-                {
-                    LOG(DLOGL_ERROR, "Null onDemandInst");
-                }
-            }
-            else
-            {
-                LOG(DLOGL_ERROR, "OnDemand session is not active ");
-            }
-        }
-        else
-        {
-            LOG(DLOGL_ERROR, "Null sessKeepAliveEvt");
-        }
-    }
-    else
-    {
-        LOG(DLOGL_ERROR, " Null pEvt");
-    }
+    // from the keep-alive thread, sent from the event loop
+    ((OnDemand *) session)->queueEvent(kOnDemandKeepAliveTimerEvent);
 }
 
 
@@ -470,12 +444,24 @@ eIMediaPlayerStatus OnDemand::Load(const char* serviceUrl,
 
     eIMediaPlayerStatus status = kMediaPlayerStatus_Error_Unknown;
 
-    status = setupSessionAndStreamControllers(serviceUrl);
+    // the session set up while the asset was focused, if any
+    OnDemand *warm = mSpeculative ? NULL : VodSessionPrewarm::getInstance()->take(mSrcUrl);
+    bool adopted = false;
+    if (warm)
+    {
+        adopted = adoptPrewarmedSession(warm);
+        if (!adopted)
+        {
+            VodSessionPrewarm::getInstance()->discard(warm);
+        }
+    }
+
+    status = adopted ? kMediaPlayerStatus_Ok : setupSessionAndStreamControllers(serviceUrl);
     if (status == kMediaPlayerStatus_Ok)
     {
         // Must start event thread after setup so that there is at least one
         // event registered.
-        int err = startEventThread();
+        int err = adopted ? 0 : startEventThread();
         if (!err)
         {
             onDemandState.Change(kOnDemandStatePreparingToView);  // wait for Play
@@ -528,6 +514,142 @@ eIMediaPlayerStatus OnDemand::setupSessionAndStreamControllers(const char* servi
     return kMediaPlayerStatus_Ok;
 }
 
+/** *********************************************************
+    Takes over the session and stream controls of warm, set up ahead of Load.
+    Events already queued for warm are passed on by its HandleCallback, warm
+    is freed once they are through.
+ */
+bool OnDemand::adoptPrewarmedSession(OnDemand *warm)
+{
+    warm->lockMutex();
+    eOnDemandState warmState = warm->onDemandState.Get();
+    bool usable = warm->vodSessContrl &&
+                  ((warmState == kOnDemandStateSessionPending) || (warmState == kOnDemandSessionServerReady));
+    if (usable)
+    {
+        vodSessContrl = warm->vodSessContrl;
+        vodStreamContrl = warm->vodStreamContrl;
+        warm->vodSessContrl = NULL;
+        warm->vodStreamContrl = NULL;
+
+        vodSessContrl->setOnDemand(this);
+        if (vodStreamContrl)
+        {
+            vodStreamContrl->setOnDemand(this);
+        }
+        warm->mAdoptedBy = this;
+        mPrewarmState = warmState;
+        mSetupStartMs = warm->mSetupStartMs;
+        warm->mSetupStartMs = 0;
+    }
+    warm->unLockMutex();
+
+    if (!usable)
+    {
+        LOG(DLOGL_ERROR, "prewarmed session %p not usable in state: %d", warm, warmState);
+        return false;
+    }
+
+    // active before the events of warm are passed on, or they would be dropped
+    LOG(DLOGL_NORMAL, "adopted session of %p in state: %d", warm, warmState);
+    startEventThread();
+    warm->stopEventThread();
+    delete warm;
+    if (warmState == kOnDemandSessionServerReady)
+    {
+        // the keep-alive of warm went with it
+        StartSessionKeepAliveTimer();
+    }
+    return true;
+}
+
+void OnDemand::startSetupClock()
+{
+    mSetupStartMs = monotonicNowMs();
+}
+
+// setup latency per back-end vendor, for mixed-vendor head-ends
+void OnDemand::recordSetup(bool ok)
+{
+    if (!mSetupStartMs || !vodSessContrl)
+    {
+        return;
+    }
+
+    VodVendorProbe::getInstance()->recordSetup(vodSessContrl->GetVendor(), monotonicNowMs() - mSetupStartMs, ok);
+    mSetupStartMs = 0;
+}
+
+// static
+OnDemand* OnDemand::openPrewarmedSession(const std::string &url)
+{
+    OnDemand *session = new OnDemand();
+
+    session->lockMutex();
+    session->mSpeculative = true;
+    eIMediaPlayerStatus status = session->Load(url.c_str(), NULL);
+    if (status != kMediaPlayerStatus_Ok)
+    {
+        session->unLockMutex();
+        delete session;
+        return NULL;
+    }
+
+    session->startSetupClock();
+    status = session->vodSessContrl ? session->vodSessContrl->SessionSetup(session->mSrcUrl) : kMediaPlayerStatus_Error_OutOfState;
+    if (status == kMediaPlayerStatus_Ok)
+    {
+        session->onDemandState.Change(kOnDemandStateSessionPending);
+    }
+    session->unLockMutex();
+
+    if (status != kMediaPlayerStatus_Ok)
+    {
+        LOG(DLOGL_ERROR, "SessionSetup error: 0x%x", status);
+        closePrewarmedSession(session);
+        return NULL;
+    }
+    return session;
+}
+
+// static
+void OnDemand::closePrewarmedSession(OnDemand *session)
+{
+    session->lockMutex();
+    session->Stop(true, false);
+    session->unLockMutex();
+    delete session;
+}
+
+/** *********************************************************
+ */
+eIMediaPlayerStatus OnDemand::PrewarmSession(const char* serviceUrl)
+{
+    FNLOG(DL_MSP_ONDEMAND);
+
+    if (!serviceUrl)
+    {
+        LOG(DLOGL_ERROR, "Error null serviceUrl");
+        return kMediaPlayerStatus_Error_InvalidParameter;
+    }
+
+    VodSessionPrewarm *pool = VodSessionPrewarm::getInstance();
+    pool->setSessionOps(openPrewarmedSession, closePrewarmedSession);
+    return pool->prewarm(serviceUrl) ? kMediaPlayerStatus_Ok : kMediaPlayerStatus_Error_Unknown;
+}
+
+/** *********************************************************
+ */
+void OnDemand::ReleasePrewarmedSession(const char* serviceUrl)
+{
+    FNLOG(DL_MSP_ONDEMAND);
+
+    if (serviceUrl)
+    {
+        VodSessionPrewarm::getInstance()->release(serviceUrl);
+    }
+}
+
 
 // static
 void OnDemand::tunerCallback(eZapperState state, void *data)
@@ -625,8 +747,31 @@ eIMediaPlayerStatus OnDemand::Play(const char* outputUrl,
 
     // TODO: This may need to change if CMOD provides NPT in milliseconds
     mStartNptMs = nptStartTime * 1000;   // convert seconds to ms
-    if (vodSessContrl)
+    if (vodSessContrl && (mPrewarmState == kOnDemandSessionServerReady))
+    {
+        // confirmed while the asset was focused, straight to tuning
+        LOG(DLOGL_NOISE, "prewarmed session ready");
+        mPrewarmState = kOnDemandStateInit;
+        onDemandState.Change(kOnDemandStateSessionPending);
+        queueEvent(kOnDemandSetupRespEvent);
+    }
+    else if (vodSessContrl && (mPrewarmState == kOnDemandStateSessionPending))
+    {
+        // the confirm is on its way
+        LOG(DLOGL_NOISE, "prewarmed session pending");
+        mPrewarmState = kOnDemandStateInit;
+        onDemandState.Change(kOnDemandStateSessionPending);
+    }
+    else if (vodSessContrl && VODFactory::isBackEndDown(mSrcUrl.c_str()))
+    {
+        // no setup left to time out, the error barker shows at once
+        LOG(DLOGL_ERROR, "back-end down, no session setup");
+        onDemandState.Change(kOnDemandStateSessionPending);
+        queueEvent(kOnDemandSessionErrorEvent);
+    }
+    else if (vodSessContrl)
     {
+        startSetupClock();
         eIMediaPlayerStatus errStatus = vodSessContrl->SessionSetup(mSrcUrl);
 
         if (!errStatus)
@@ -690,7 +835,12 @@ eIMediaPlayerStatus OnDemand::Stop(bool stopPlay, bool stopPersistentRecord)
 
     if (vodSessContrl)
     {
-        if ((onDemandState.Get() >= kOnDemandSessionServerReady) && (onDemandState.Get() <= kOnDemandStateStopPending))
+        eOnDemandState currentState = onDemandState.Get();
+
+        // a speculative setup is released before its confirm too, it would hold head-end capacity until the SRM drops it
+        if (((currentState >= kOnDemandSessionServerReady) && (currentState <= kOnDemandStateStopPending)) ||
+                (mSpeculative && (currentState == kOnDemandStateSessionPending)) ||
+                (mPrewarmState == kOnDemandSessionServerReady))
         {
             vodSessContrl->SessionTeardown();
         }
@@ -1038,20 +1188,8 @@ void OnDemand::StartSessionKeepAliveTimer()
     OnDemandSystemClient::getInstance()->GetSessionInProgressTimer(&keepAliveTime);
     LOG(DLOGL_REALLY_NOISY, "OnDemand::%s  SIP timer value: %d", __FUNCTION__, keepAliveTime);
 
-    EventCallbackData *timerEvt = new EventCallbackData;
-
-    if (timerEvt)
-    {
-        timerEvt->objPtr = this;
-        timerEvt->odEvtType = kOnDemandKeepAliveTimerEvent;
-
-        // event_new and event_add for timer
-        mEventTimer = mEventLoop->addTimer(EVENTTIMER_PERSIST,
-                                           keepAliveTime,
-                                           0,
-                                           SessionKeepAliveTimerCallBack,
-                                           timerEvt);
-    }
+    // batched with the other sessions to the SRM, the SRM does not answer a SessionInProgress
+    VodKeepAlive::getInstance()->add(this, VODFactory::srmEndpoint(), keepAliveTime * 1000, sessionKeepAliveDue, false);
 }
 
 
@@ -1148,10 +1286,31 @@ void OnDemand::HandleCallback(eOnDemandEvent onDemandEvt)
 
     bool invalidStateForAction = false;
 
+    if (mAdoptedBy && (onDemandEvt != kOnDemandStopControllerEvent))
+    {
+        // queued before the session was handed over
+        LOG(DLOGL_MINOR_EVENT, "pass event %d on to %p", onDemandEvt, mAdoptedBy);
+        mAdoptedBy->queueEvent(onDemandEvt);
+        return;
+    }
+
     switch (onDemandEvt)
     {
     case kOnDemandSetupRespEvent:
-        if (currentState == kOnDemandStateSessionPending)
+        recordSetup(true);
+        if (mSpeculative && (currentState == kOnDemandStateSessionPending))
+        {
+            // tuning parameters are in, held until Load, kept alive at the SRM meanwhile
+            LOG(DLOGL_NORMAL, "prewarmed session ready: %s", mSrcUrl.c_str());
+            onDemandState.Change(kOnDemandSessionServerReady);
+            StartSessionKeepAliveTimer();
+        }
+        else if ((currentState == kOnDemandStatePreparingToView) && (mPrewarmState == kOnDemandStateSessionPending))
+        {
+            mPrewarmState = kOnDemandSessionServerReady;
+            StartSessionKeepAliveTimer();
+        }
+        else if (currentState == kOnDemandStateSessionPending)
         {
             onDemandState.Change(kOnDemandSessionServerReady);
             // load tuning params, start session keep alive, and start stream play
@@ -1420,13 +1579,16 @@ void OnDemand::HandleCallback(eOnDemandEvent onDemandEvt)
 
         LOG(DLOGL_MINOR_EVENT, "VOD Session Keep Alive Timer");
 
-        if (vodSessContrl && (currentState == kOnDemandStateStreaming))
+        // streaming, or set up ahead of Load and held or adopted
+        if (vodSessContrl && ((currentState == kOnDemandStateStreaming) ||
+                              (mSpeculative && (currentState == kOnDemandSessionServerReady)) ||
+                              (mPrewarmState == kOnDemandSessionServerReady)))
         {
             LOG(DLOGL_MINOR_EVENT, " vodSessContrl->SendKeepAlive");
-            vodSessContrl->SendKeepAlive();
-
-            // mEventLoop->delTimer(pEvt);
-
+            if (vodSessContrl->SendKeepAlive() == ON_DEMAND_OK)
+            {
+                VodKeepAlive::getInstance()->sent(this);
+            }
         }
         else
         {
@@ -1437,6 +1599,15 @@ void OnDemand::HandleCallback(eOnDemandEvent onDemandEvt)
         break;
 
 
+    case kOnDemandEventSessKeepAlive:
+        // keep-alive of the stream control, due on its own server
+        if (vodStreamContrl)
+        {
+            vodStreamContrl->SendKeepAlive();
+        }
+        break;
+
+
     case kOnDemandStreamReadEvent:
         LOG(DLOGL_MINOR_EVENT, "kOnDemandStreamReadEvent");
         if (vodStreamContrl)
@@ -1448,8 +1619,22 @@ void OnDemand::HandleCallback(eOnDemandEvent onDemandEvt)
         // TODO: Verify this is the correct meaning of maxForwardCount
         uint8_t maxForwardCount = 0;
         OnDemandSystemClient::getInstance()->GetMaxForwardCount(&maxForwardCount);
-        if (vodSessContrl && (sessionSetupRetryCount < maxForwardCount))
+        recordSetup(false);
+        if (mSpeculative)
+        {
+            // no retries ahead of Load, the pool drops it
+            LOG(DLOGL_ERROR, "prewarmed session setup failed: %s", mSrcUrl.c_str());
+            onDemandState.Change(kOnDemandStateStopped);
+        }
+        else if ((currentState == kOnDemandStatePreparingToView) && (mPrewarmState != kOnDemandStateInit))
+        {
+            // the adopted session failed, Play sets up a new one
+            LOG(DLOGL_ERROR, "adopted session failed");
+            mPrewarmState = kOnDemandStateInit;
+        }
+        else if (vodSessContrl && (sessionSetupRetryCount < maxForwardCount) && !VODFactory::isBackEndDown(mSrcUrl.c_str()))
         {
+            startSetupClock();
             eIMediaPlayerStatus errStatus = vodSessContrl->SessionSetup(mSrcUrl);
 
             if (!errStatus)
@@ -1467,6 +1652,8 @@ void OnDemand::HandleCallback(eOnDemandEvent onDemandEvt)
         else
         {
             LOG(DLOGL_ERROR, "Callback signal for Session Setup > retry Count error");
+            // probed again for the next session
+            VODFactory::invalidateBackEnd(mSrcUrl.c_str());
             DoCallback(kMediaPlayerSignal_Problem, kMediaPlayerStatus_ServerError);
         }
     }
@@ -1510,16 +1697,7 @@ void OnDemand::HandleCallback(eOnDemandEvent onDemandEvt)
         }
 
 
-        if (mEventTimer && mEventLoop)
-        {
-            EventCallbackData *userData = (EventCallbackData *)mEventTimer->getUserData();
-            if (userData)
-            {
-                delete userData;
-            }
-            LOG(DLOGL_MINOR_DEBUG, "Ondemand:HandleCallback:mEventLoop->delTimer(mEventTimer) %p", mEventTimer);
-            mEventLoop->delTimer(mEventTimer);
-        }
+        VodKeepAlive::getInstance()->remove(this);
 
         if (vodStreamContrl)
         {
@@ -1538,6 +1716,7 @@ void OnDemand::HandleCallback(eOnDemandEvent onDemandEvt)
             LOG(DLOGL_MINOR_DEBUG, "delete sessionControl: %p", vodSessContrl);
             delete vodSessContrl;
             vodSessContrl = NULL;
+            DsmccTransport::getInstance()->logStats();
         }
 
         LOG(DLOGL_REALLY_NOISY, "Ondemand:HandleCallback:signal done");
@@ -2042,6 +2221,11 @@ tCpePgrmHandle OnDemand::getCpeProgHandle()
     return 0;
 }
 
+VOD_SessionControl* OnDemand::getSessionControl()
+{
+    return vodSessContrl;
+}
+
 void OnDemand::SetCpeStreamingSessionID(uint32_t sessionId)
 {
     (void) sessionId;
@@ -192,7 +192,14 @@ public:
 
     static void GetMspVodInfo(DiagMspVodInfo *msgInfo);
 
+    /// Sets up the VOD session of serviceUrl ahead of Load, as the guide focuses the asset
+    static eIMediaPlayerStatus PrewarmSession(const char* serviceUrl);
+    /// Releases the session set up for serviceUrl, as the guide moves the focus away
+    static void ReleasePrewarmedSession(const char* serviceUrl);
+
     tCpePgrmHandle getCpeProgHandle();
+    /// Session control of the session, NULL before setupSessionAndStreamControllers()
+    VOD_SessionControl* getSessionControl();
     virtual void SetCpeStreamingSessionID(uint32_t sessionId);
     void InjectCCI(uint8_t CCIbyte);
     void handleReadSessionData(void *pMsg);
@@ -219,7 +226,7 @@ protected:
     void HandleSocketReadEvent(eOnDemandEvent onDemandEvt);
     void StartSessionKeepAliveTimer();
 
-    static void SessionKeepAliveTimerCallBack(int fd, short event, void *arg);
+    static void sessionKeepAliveDue(void *session);
     static void stream_read_callback(evutil_socket_t fd, short event, void *arg);
     static void sourceReadyCB(void *data, eSourceState aState);
 
@@ -229,6 +236,13 @@ protected:
 
     virtual eIMediaPlayerStatus loadTuningParamsAndPlay();
 
+    static OnDemand* openPrewarmedSession(const std::string &url);
+    static void closePrewarmedSession(OnDemand *session);
+    bool adoptPrewarmedSession(OnDemand *warm);
+
+    void startSetupClock();
+    void recordSetup(bool ok);
+
     std::string mSrcUrl;  /**< url of source as passed to load */
     std::string mDestUrl;  /**< destination url as passed to Play */
 
@@ -261,6 +275,11 @@ protected:
     bool mPendingPlayResponse;
     bool mPendingSpeed, mPendingPosition;
 
+    bool mSpeculative;              // set up ahead of Load, stops at kOnDemandSessionServerReady
+    OnDemand *mAdoptedBy;           // the controller its session was handed over to
+    eOnDemandState mPrewarmState;   // of the adopted session until Play, kOnDemandStateInit when none
+    uint64_t mSetupStartMs;         // of the session setup in flight, 0 when none
+
     // pthread_t eventHandlerThread;
     static pthread_t evtloopHandlerThread;
     pthread_mutex_t  mMutex;
@@ -276,8 +295,6 @@ protected:
     static EventLoop* mEventLoop;
     EventTimer* mDummyLongTimer;
 
-    EventTimer* mEventTimer;
-
     struct event* mStreamSocketEvent;
 
 
@@ -41,10 +41,101 @@ Implementation file for psi class
 
 #define PRINTD(msg, args...)  dlog(DL_MSP_PSI, DLOGL_REALLY_NOISY, "Pmt: " msg, ##args);
 
+#define kPmtStorageChunkSize  1024  ///< a PMT with a few streams fits in one chunk
+#define kPmtStorageAlign      8
+
+///////////////////////////////////////////////////////////////////////////
+//                      PmtStorage
+///////////////////////////////////////////////////////////////////////////
+
+PmtStorage::PmtStorage()
+{
+    mRefCount = 1;
+    mData = NULL;
+    mSize = 0;
+    mChunkUsed = 0;
+}
+
+PmtStorage::~PmtStorage()
+{
+    for (unsigned int i = 0; i < mChunks.size(); i++)
+    {
+        free(mChunks[i]);
+    }
+    free(mData);
+}
+
+PmtStorage* PmtStorage::create(const uint8_t *data, uint32_t size)
+{
+    PmtStorage *storage = new PmtStorage();
+
+    if (data && size)
+    {
+        storage->mData = (uint8_t *)malloc(size);
+        if (storage->mData == NULL)
+        {
+            LOG(DLOGL_EMERGENCY, "Error malloc %u bytes", size);
+            delete storage;
+            return NULL;
+        }
+        memcpy(storage->mData, data, size);
+        storage->mSize = size;
+    }
+    return storage;
+}
+
+void PmtStorage::ref(void)
+{
+    __sync_add_and_fetch(&mRefCount, 1);
+}
+
+void PmtStorage::unref(void)
+{
+    if (__sync_sub_and_fetch(&mRefCount, 1) == 0)
+    {
+        delete this;
+    }
+}
+
+void* PmtStorage::alloc(size_t size)
+{
+    uint8_t *chunk;
+
+    size = (size + kPmtStorageAlign - 1) & ~(size_t)(kPmtStorageAlign - 1);
+    if (size > kPmtStorageChunkSize / 2)
+    {
+        // own chunk, kept ahead of the one being filled
+        chunk = (uint8_t *)calloc(1, size);
+        if (chunk)
+        {
+            mChunks.insert(mChunks.begin(), chunk);
+        }
+        return chunk;
+    }
+
+    if (mChunks.empty() || (mChunkUsed + size > kPmtStorageChunkSize))
+    {
+        chunk = (uint8_t *)calloc(1, kPmtStorageChunkSize);
+        if (chunk == NULL)
+        {
+            return NULL;
+        }
+        mChunks.push_back(chunk);
+        mChunkUsed = 0;
+    }
+
+    chunk = mChunks.back() + mChunkUsed;
+    mChunkUsed += size;
+    return chunk;
+}
+
 ///////////////////////////////////////////////////////////////////////////
 //                      Member functions implementation
 ///////////////////////////////////////////////////////////////////////////
 
+std::multimap<const uint8_t*, PmtStorage*> Pmt::mDescriptorRefs;
+pthread_mutex_t Pmt::mDescriptorRefsMutex = PTHREAD_MUTEX_INITIALIZER;
+
 
 /** *********************************************************
 */
@@ -66,7 +157,7 @@ void Pmt::printPmtInfo()
         PRINTD("  +- Pgm Desc[%d]------", pgmDescIdx);
         PRINTD("  | Tag      :0x%02x ",   pgmDesc->tag);
         PRINTD("  | Data Len :0x%02x ",   pgmDesc->dataLen);
-        PRINTD("  | Data     :%s ",       pgmDesc->data);
+        PRINTD("  | Data     :%.*s ",     pgmDesc->dataLen, pgmDesc->data);
     }
     PRINTD("  +- Pgm Desc End------");
 
@@ -90,7 +181,7 @@ void Pmt::printPmtInfo()
             PRINTD("  .+- ES Desc[%u]------", esDescIdx + 1);
             PRINTD("  .| Tag      :0x%02x ",  esDesc->tag);
             PRINTD("  .| Data Len :0x%02x ",  esDesc->dataLen);
-            PRINTD("  .| Data     :%s ",      esDesc->data);
+            PRINTD("  .| Data     :%.*s ",    esDesc->dataLen, esDesc->data);
         }
         PRINTD("  .+- ES Desc End------");
     }
@@ -136,8 +227,7 @@ eMspStatus Pmt::getDescriptor(tCpePgrmHandleMpegDesc *descriptor, uint16_t pid)
             if (mPmtInfo.ppPgmDesc[pgmdescount]->tag == descriptor->tag)
             {
                 descriptor->dataLen = mPmtInfo.ppPgmDesc[pgmdescount]->dataLen;
-                descriptor->data = (uint8_t *)malloc(descriptor->dataLen);
-                memcpy(descriptor->data, mPmtInfo.ppPgmDesc[pgmdescount]->data, descriptor->dataLen);
+                descriptor->data = mPmtInfo.ppPgmDesc[pgmdescount]->data;
                 status = kMspStatus_Ok;
             }
         }
@@ -153,8 +243,7 @@ eMspStatus Pmt::getDescriptor(tCpePgrmHandleMpegDesc *descriptor, uint16_t pid)
                     if (mPmtInfo.ppEsData[escount]->ppEsDesc[esdescount]->tag == descriptor->tag)
                     {
                         descriptor->dataLen = mPmtInfo.ppEsData[escount]->ppEsDesc[esdescount]->dataLen;
-                        descriptor->data = (uint8_t *)malloc(descriptor->dataLen);
-                        memcpy(descriptor->data, mPmtInfo.ppEsData[escount]->ppEsDesc[esdescount]->data, descriptor->dataLen);
+                        descriptor->data = mPmtInfo.ppEsData[escount]->ppEsDesc[esdescount]->data;
                         status = kMspStatus_Ok;
                     }
                 }
@@ -162,6 +251,14 @@ eMspStatus Pmt::getDescriptor(tCpePgrmHandleMpegDesc *descriptor, uint16_t pid)
         }
     }
 
+    if ((status == kMspStatus_Ok) && mStorage)
+    {
+        mStorage->ref();
+        pthread_mutex_lock(&mDescriptorRefsMutex);
+        mDescriptorRefs.insert(std::make_pair((const uint8_t *) descriptor->data, mStorage));
+        pthread_mutex_unlock(&mDescriptorRefsMutex);
+    }
+
     LOG(DLOGL_REALLY_NOISY, "pid: %d  status: %d",  pid, status);
 
     return status;
@@ -169,19 +266,32 @@ eMspStatus Pmt::getDescriptor(tCpePgrmHandleMpegDesc *descriptor, uint16_t pid)
 
 
 /** *********************************************************
+ Drops the storage reference taken by getDescriptor(), the caller may have
+ got the data from an earlier Pmt
  */
 void Pmt::releaseDescriptor(tCpePgrmHandleMpegDesc *descriptor)
 {
-    FNLOG(DL_MSP_PSI);
+    PmtStorage *storage = NULL;
 
-    if (descriptor)
+    if (descriptor == NULL)
     {
-        if (descriptor->data)
-        {
-            free(descriptor->data);
-            descriptor->data = NULL;
-        }
+        return;
+    }
+
+    pthread_mutex_lock(&mDescriptorRefsMutex);
+    std::multimap<const uint8_t*, PmtStorage*>::iterator iter = mDescriptorRefs.find((const uint8_t *) descriptor->data);
+    if (iter != mDescriptorRefs.end())
+    {
+        storage = iter->second;
+        mDescriptorRefs.erase(iter);
     }
+    pthread_mutex_unlock(&mDescriptorRefsMutex);
+
+    if (storage)
+    {
+        storage->unref();
+    }
+    descriptor->data = NULL;
 }
 
 
@@ -199,6 +309,42 @@ Pmt::Pmt()
 {
     memset(&mPmtInfo, 0, sizeof(mPmtInfo));
     memset(&mTsParams, 0, sizeof(mTsParams));
+    mStorage = NULL;
+}
+
+/** *********************************************************
+ */
+Pmt::Pmt(const Pmt &pmt)
+{
+    mPmtInfo = pmt.mPmtInfo;
+    mTsParams = pmt.mTsParams;
+    mVideoPid = pmt.mVideoPid;
+    mAudioPid = pmt.mAudioPid;
+    mStorage = pmt.mStorage;
+    if (mStorage)
+    {
+        mStorage->ref();
+    }
+}
+
+/** *********************************************************
+ */
+Pmt& Pmt::operator=(const Pmt &pmt)
+{
+    if (pmt.mStorage)
+    {
+        pmt.mStorage->ref();
+    }
+    if (mStorage)
+    {
+        mStorage->unref();
+    }
+    mPmtInfo = pmt.mPmtInfo;
+    mTsParams = pmt.mTsParams;
+    mVideoPid = pmt.mVideoPid;
+    mAudioPid = pmt.mAudioPid;
+    mStorage = pmt.mStorage;
+    return *this;
 }
 
 /** *********************************************************
@@ -250,83 +396,226 @@ uint32_t Pmt::getTransportID(void)
  */
 void Pmt::freePmtInfo()
 {
-    int i, j;
-    tCpePgrmHandleMpegDesc  *pDescInfo;
-    tCpePgrmHandleEsData    *pEsInfo;
     dlog(DL_MSP_MPLAYER, DLOGL_REALLY_NOISY, "Freeing PMT Info");
 
-    if (mPmtInfo.ppPgmDesc)
+    // every descriptor and ES structure lives in the storage
+    if (mStorage)
+    {
+        mStorage->unref();
+        mStorage = NULL;
+    }
+
+    mPmtInfo.ppPgmDesc = NULL;
+    mPmtInfo.ppEsData = NULL;
+    mPmtInfo.pgmDescCount = 0;
+    mPmtInfo.esCount = 0;
+}
+
+/** *********************************************************
+ */
+void* Pmt::allocInfo(size_t size)
+{
+    if (mStorage == NULL)
+    {
+        mStorage = PmtStorage::create(NULL, 0);
+    }
+
+    void *info = mStorage ? mStorage->alloc(size) : NULL;
+    if (info == NULL)
     {
-        for (i = 0; i < mPmtInfo.pgmDescCount; i++)
+        LOG(DLOGL_EMERGENCY, "Error allocating %d bytes", (int) size);
+    }
+    return info;
+}
+
+/** *********************************************************
+ The descriptor data are views into a copy of the section kept in mStorage.
+ */
+eMspStatus Pmt::parseSection(const uint8_t *section, uint32_t sectionLength)
+{
+    FNLOG(DL_MSP_PSI);
+
+    uint8_t        descTag;
+    uint8_t        descLen;
+    uint8_t       *pPmtEnd;
+    int            pgmInfoLen;
+    uint8_t       *pPgmInfoEnd;
+    uint16_t       esInfoLen;
+    uint8_t       *pEsInfoEnd;
+
+    tCpePgrmHandleMpegDesc  *pDescInfo;
+    tCpePgrmHandleEsData    *pEsDataInfo;
+
+    freePmtInfo();
+    memset(&mPmtInfo, 0, sizeof(tCpePgrmHandlePmt));
+    mVideoPid.clear();
+    mAudioPid.clear();
+
+    // PCR_PID and program_info_length follow the table header
+    if ((section == NULL) || (sectionLength < (kAppTableHeaderFromSectionLength + 4 + kAppTableCRCSize)))
+    {
+        LOG(DLOGL_ERROR, "Error: section %p length %u", section, sectionLength);
+        return kMspStatus_PsiError;
+    }
+
+    mStorage = PmtStorage::create(section, (sizeof(tTableHeader) - kAppTableHeaderFromSectionLength) + sectionLength);
+    if (mStorage == NULL)
+    {
+        return kMspStatus_Error;
+    }
+
+    uint8_t *pSecFilterBuf = mStorage->getData() + sizeof(tTableHeader);     // get past table header
+    pPmtEnd = pSecFilterBuf + (sectionLength - (kAppTableHeaderFromSectionLength + kAppTableCRCSize));
+
+    // Clock Pid
+    mTsParams.pidTable.clockPid = (*pSecFilterBuf++ & 0x1F) << 8;
+    mTsParams.pidTable.clockPid |= *pSecFilterBuf++;
+    mPmtInfo.clockPid = mTsParams.pidTable.clockPid;
+
+    dlog(DL_MSP_PSI, DLOGL_REALLY_NOISY, "PCR PID : 0x%x\n", mTsParams.pidTable.clockPid);
+
+    // program_info_length
+    pgmInfoLen = (*pSecFilterBuf++ & 0x0F) << 8;
+    pgmInfoLen |= *pSecFilterBuf++;
+    pPgmInfoEnd = pSecFilterBuf + pgmInfoLen;
+    if (pPgmInfoEnd > pPmtEnd)
+    {
+        dlog(DL_MSP_PSI, DLOGL_REALLY_NOISY, "%s:%d PMT parse length error \n", __FUNCTION__, __LINE__);
+        freePmtInfo();
+        return kMspStatus_PsiError;
+    }
+
+    if (pgmInfoLen != 0)
+    {
+        mPmtInfo.ppPgmDesc = (tCpePgrmHandleMpegDesc **)allocInfo(kAppMaxProgramDesciptors * sizeof(tCpePgrmHandleMpegDesc *));
+        while ((pSecFilterBuf + 2 <= pPgmInfoEnd) && (mPmtInfo.pgmDescCount < kAppMaxProgramDesciptors))
         {
-            pDescInfo = mPmtInfo.ppPgmDesc[i];
-            if (pDescInfo)
+            descTag = *pSecFilterBuf++;
+            descLen = *pSecFilterBuf++;
+            pDescInfo = (tCpePgrmHandleMpegDesc *)allocInfo(sizeof(tCpePgrmHandleMpegDesc));
+            if ((mPmtInfo.ppPgmDesc == NULL) || (pDescInfo == NULL) || (pSecFilterBuf + descLen > pPgmInfoEnd))
             {
-                if (pDescInfo->data)
-                {
-                    free(pDescInfo->data);
-                    pDescInfo->data = NULL;
-                }
-                free(pDescInfo);
-                mPmtInfo.ppPgmDesc[i] = NULL;
+                LOG(DLOGL_ERROR, "Error: program descriptor 0x%x length %d", descTag, descLen);
+                freePmtInfo();
+                return kMspStatus_PsiError;
             }
+
+            pDescInfo->tag = descTag;
+            pDescInfo->dataLen = descLen;
+            pDescInfo->data = pSecFilterBuf;
+            mPmtInfo.ppPgmDesc[mPmtInfo.pgmDescCount] = pDescInfo;
+            mPmtInfo.pgmDescCount++;
+            pSecFilterBuf += descLen;
         }
-        free(mPmtInfo.ppPgmDesc);
-        mPmtInfo.ppPgmDesc = NULL;
     }
-    else
+
+    // ES Info
+    pSecFilterBuf = pPgmInfoEnd;
+
+    mPmtInfo.ppEsData = (tCpePgrmHandleEsData **)allocInfo(kAppMaxEsCount * sizeof(tCpePgrmHandleEsData *));
+    pEsDataInfo = (tCpePgrmHandleEsData *)allocInfo(kAppMaxEsCount * sizeof(tCpePgrmHandleEsData));
+    if ((mPmtInfo.ppEsData == NULL) || (pEsDataInfo == NULL))
     {
-        LOG(DLOGL_NOISE, "PMT program descriptor is NULL");
+        freePmtInfo();
+        return kMspStatus_Error;
     }
 
-    if (mPmtInfo.ppEsData)
+    while ((pSecFilterBuf + 5 <= pPmtEnd) && (mPmtInfo.esCount < kAppMaxEsCount))
     {
-        for (i = 0; i < mPmtInfo.esCount; i++)
+        uint16_t pid;
+        tPid avpid;
+
+        uint8_t streamType = *pSecFilterBuf++;
+        pEsDataInfo->reserved[0] = *pSecFilterBuf >> 5;
+        pid = (*pSecFilterBuf++ & 0x1F) << 8;
+        pid |= *pSecFilterBuf++ & 0xFF;
+        pEsDataInfo->streamType = streamType;
+        pEsDataInfo->pid = pid;
+
+        dlog(DL_MSP_PSI, DLOGL_REALLY_NOISY, "Stream Type : 0x%x -  PID : 0x%x\n", streamType, pid);
+
+        switch (streamType)
+        {
+        case kCpeStreamType_MPEG1_Video:
+        case kCpeStreamType_MPEG2_Video:
+        case kCpeStreamType_H264_Video:
+        case kCpeStreamType_GI_Video:
+        case kCpeStreamType_VC1_Video:
+
+            mTsParams.pidTable.videoStreamType = streamType;
+            mTsParams.pidTable.videoPid = pid;
+            avpid.pid = pid;
+            avpid.streamType = streamType;
+            mVideoPid.push_back(avpid);
+            break;
+
+        case kCpeStreamType_MPEG1_Audio:
+        case kCpeStreamType_MPEG2_Audio:
+        case kCpeStreamType_AAC_Audio:
+        case kCpeStreamType_AACplus_Audio:
+        case kCpeStreamType_DDPlus_Audio:
+        case kCpeStreamType_GI_Audio:
+
+            mTsParams.pidTable.audioStreamType = streamType;
+            mTsParams.pidTable.audioPid = pid;
+            avpid.pid = pid;
+            avpid.streamType = streamType;
+            mAudioPid.push_back(avpid);
+            break;
+        }
+
+        // ES_info_length
+        pEsDataInfo->reserved[1] = *pSecFilterBuf >> 4;
+        esInfoLen = (*pSecFilterBuf++ & 0xF) << 8;
+        esInfoLen |= *pSecFilterBuf++;
+        pEsInfoEnd = pSecFilterBuf + esInfoLen;
+        if (pEsInfoEnd > pPmtEnd)
+        {
+            LOG(DLOGL_ERROR, "Error: pid 0x%x ES_info_length %d", pid, esInfoLen);
+            freePmtInfo();
+            return kMspStatus_PsiError;
+        }
+
+        if (esInfoLen != 0)
         {
-            pEsInfo = mPmtInfo.ppEsData[i];
-            if (pEsInfo)
+            pEsDataInfo->ppEsDesc = (tCpePgrmHandleMpegDesc **)allocInfo(kMaxESDescriptors * sizeof(tCpePgrmHandleMpegDesc *));
+            while ((pSecFilterBuf + 2 <= pEsInfoEnd) && (pEsDataInfo->descCount < kMaxESDescriptors))
             {
-                if (pEsInfo->ppEsDesc)
+                descTag = *pSecFilterBuf++;
+                descLen = *pSecFilterBuf++;
+                pDescInfo = (tCpePgrmHandleMpegDesc *)allocInfo(sizeof(tCpePgrmHandleMpegDesc));
+                if ((pEsDataInfo->ppEsDesc == NULL) || (pDescInfo == NULL) || (pSecFilterBuf + descLen > pEsInfoEnd))
                 {
-                    for (j = 0; j < pEsInfo->descCount; j++)
-                    {
-                        pDescInfo = pEsInfo->ppEsDesc[j];
-                        if (pDescInfo)
-                        {
-                            if (pDescInfo->data)
-                            {
-                                free(pDescInfo->data);
-                                pDescInfo->data = NULL;
-                            }
-                            free(pDescInfo);
-                            pEsInfo->ppEsDesc[j] = NULL;
-                        }
-                    }
-                    free(pEsInfo->ppEsDesc);
-                    pEsInfo->ppEsDesc = NULL;
+                    LOG(DLOGL_ERROR, "Error: pid 0x%x descriptor 0x%x length %d", pid, descTag, descLen);
+                    freePmtInfo();
+                    return kMspStatus_PsiError;
                 }
-                else
-                {
-                    LOG(DLOGL_NOISE, " PMT ES descriptor is NULL for the PMT es element no %d", i);
-                }
-                free(pEsInfo);
-                mPmtInfo.ppEsData[i] = NULL;
-            }
-            else
-            {
-                LOG(DLOGL_NOISE, "PMT EsInfo is NULL for the PMT es element no %d", i);
+
+                pDescInfo->tag = descTag;
+                pDescInfo->dataLen = descLen;
+                pDescInfo->data = pSecFilterBuf;
+                pSecFilterBuf += descLen;
+                pEsDataInfo->ppEsDesc[pEsDataInfo->descCount] = pDescInfo;
+                pEsDataInfo->descCount++;
             }
         }
-        free(mPmtInfo.ppEsData);
-        mPmtInfo.ppEsData = NULL;
+        pSecFilterBuf = pEsInfoEnd;
+
+        mPmtInfo.ppEsData[mPmtInfo.esCount] = pEsDataInfo++;
+        mPmtInfo.esCount++;
     }
-    else
+
+    if ((mTsParams.pidTable.audioPid == 0) && (mTsParams.pidTable.videoPid == 0))
     {
-        LOG(DLOGL_NOISE, " PMT ES descriptor pointer is NULL");
+        dlog(DL_MSP_PSI, DLOGL_REALLY_NOISY, "%s:%d  No Audio & video PID found in PMT Continuing  \n", __FUNCTION__, __LINE__);
+        freePmtInfo();
+        return kMspStatus_PsiError;
     }
 
-    mPmtInfo.pgmDescCount = 0;
-    mPmtInfo.esCount = 0;
+    dlog(DL_MSP_PSI, DLOGL_REALLY_NOISY, "%s:%d Found AudPid=0x%x VidPid=0x%x \n", __FUNCTION__, __LINE__, mTsParams.pidTable.audioPid, mTsParams.pidTable.videoPid);
+    printPmtInfo();
+
+    return kMspStatus_Ok;
 }
 
 
@@ -390,33 +679,24 @@ eMspStatus Pmt::populateCaptionServiceMetadata(uint8_t *buffer, uint32_t size)
             {
                 LOG(DLOGL_NORMAL, "Found video pid 0x%x, will add CSD for it, size %d", mPmtInfo.ppEsData[i]->pid, size);
 
-                // add one elementary stream for language
-                mPmtInfo.ppEsData[i]->descCount = 1;
-                mPmtInfo.ppEsData[i]->ppEsDesc = (tCpePgrmHandleMpegDesc **)malloc(sizeof(tCpePgrmHandleMpegDesc *));
-
-                //  esData->descCount = 1;
-                //   esData->ppEsDesc = (tCpePgrmHandleMpegDesc **) malloc(sizeof(tCpePgrmHandleMpegDesc *));
-
-                // Create mpeg descriptor for the audio language
-                tCpePgrmHandleMpegDesc *mpegDesc = (tCpePgrmHandleMpegDesc *)malloc(sizeof(tCpePgrmHandleMpegDesc));
-                if (mpegDesc == NULL)
+                // the CSD is the only descriptor of the video stream
+                tCpePgrmHandleMpegDesc **ppEsDesc = (tCpePgrmHandleMpegDesc **)allocInfo(sizeof(tCpePgrmHandleMpegDesc *));
+                tCpePgrmHandleMpegDesc *mpegDesc = (tCpePgrmHandleMpegDesc *)allocInfo(sizeof(tCpePgrmHandleMpegDesc));
+                uint8_t *data = (uint8_t *)allocInfo(size);
+                if ((ppEsDesc == NULL) || (mpegDesc == NULL) || (data == NULL))
                 {
                     LOG(DLOGL_ERROR, "Error: Null mpegDesc");
                     return kMspStatus_Error;
                 }
-
-                mPmtInfo.ppEsData[i]->ppEsDesc[0] = mpegDesc;
-
+                memcpy(data, buffer, size);
 
                 mpegDesc->tag     =  0x86;
                 mpegDesc->dataLen =  size;
-                mpegDesc->data    = (uint8_t *)malloc(size);
-                if (mpegDesc->data == NULL)
-                {
-                    LOG(DLOGL_ERROR, "Error: Null mpegDesc");
-                    return kMspStatus_Error;
-                }
-                memcpy(mpegDesc->data, buffer, size);
+                mpegDesc->data    =  data;
+                ppEsDesc[0] = mpegDesc;
+
+                mPmtInfo.ppEsData[i]->ppEsDesc = ppEsDesc;
+                mPmtInfo.ppEsData[i]->descCount = 1;
 
                 break;
             }
@@ -556,8 +836,8 @@ eMspStatus Pmt::populateFromSaraMetaData(uint8_t *buffer, uint32_t size)
 
             if (cpeStreamType != MSP_PMT_INVALID_STREAM_TYPE)
             {
-                // calloc ensures reserved bytes are zeroed out and other values are zero
-                tCpePgrmHandleEsData *esData = (tCpePgrmHandleEsData *)calloc(1, sizeof(tCpePgrmHandleEsData));
+                // storage is zeroed, so are the reserved bytes and other values
+                tCpePgrmHandleEsData *esData = (tCpePgrmHandleEsData *)allocInfo(sizeof(tCpePgrmHandleEsData));
                 if (esData == NULL)
                 {
                     LOG(DLOGL_ERROR, "Error: Null tCpePgrmHandleEsData");
@@ -574,26 +854,26 @@ eMspStatus Pmt::populateFromSaraMetaData(uint8_t *buffer, uint32_t size)
                         cpeStreamType == kCpeStreamType_AACplus_Audio || cpeStreamType == kCpeStreamType_LPCM)
 
                 {
+                    const int AUDIO_LANG_BYTE_SIZE  = 4;    // size of lang code (three chars plus null byte)
+                    const int AUDIO_LANG_TAG        = 0x0a; // from inspecting RTN metadata
+
                     // add one elementary stream for language
-                    esData->descCount = 1;
-                    esData->ppEsDesc = (tCpePgrmHandleMpegDesc **) malloc(sizeof(tCpePgrmHandleMpegDesc *));
+                    esData->ppEsDesc = (tCpePgrmHandleMpegDesc **)allocInfo(sizeof(tCpePgrmHandleMpegDesc *));
 
                     // Create mpeg descriptor for the audio language
-                    tCpePgrmHandleMpegDesc *mpegDesc = (tCpePgrmHandleMpegDesc *)malloc(sizeof(tCpePgrmHandleMpegDesc));
-                    if (mpegDesc == NULL)
+                    tCpePgrmHandleMpegDesc *mpegDesc = (tCpePgrmHandleMpegDesc *)allocInfo(sizeof(tCpePgrmHandleMpegDesc));
+                    if ((esData->ppEsDesc == NULL) || (mpegDesc == NULL))
                     {
                         LOG(DLOGL_ERROR, "Error: Null mpegDesc");
                         return kMspStatus_Error;
                     }
 
+                    esData->descCount = 1;
                     esData->ppEsDesc[0] = mpegDesc;
 
-                    const int AUDIO_LANG_BYTE_SIZE  = 4;    // size of lang code (three chars plus null byte)
-                    const int AUDIO_LANG_TAG        = 0x0a; // from inspecting RTN metadata
-
                     mpegDesc->tag     =  AUDIO_LANG_TAG;
                     mpegDesc->dataLen =  AUDIO_LANG_BYTE_SIZE;
-                    mpegDesc->data    = (uint8_t *)malloc(AUDIO_LANG_BYTE_SIZE);
+                    mpegDesc->data    = (uint8_t *)allocInfo(AUDIO_LANG_BYTE_SIZE);
                     if (mpegDesc->data == NULL)
                     {
                         LOG(DLOGL_EMERGENCY, "Error: Null mpegDesc->data");
@@ -627,7 +907,12 @@ eMspStatus Pmt::populateFromSaraMetaData(uint8_t *buffer, uint32_t size)
     LOG(DLOGL_NOISE, "mPmtInfo.esCount: %d", mPmtInfo.esCount);
 
     //allocating memory for esdesc ptrs
-    mPmtInfo.ppEsData = (tCpePgrmHandleEsData **)calloc(1, (mPmtInfo.esCount * sizeof(tCpePgrmHandleEsData *)));
+    mPmtInfo.ppEsData = (tCpePgrmHandleEsData **)allocInfo(mPmtInfo.esCount * sizeof(tCpePgrmHandleEsData *));
+    if (mPmtInfo.ppEsData == NULL)
+    {
+        mPmtInfo.esCount = 0;
+        return kMspStatus_Error;
+    }
 
     for (int i = 0; i < mPmtInfo.esCount; i++)
     {
@@ -648,6 +933,10 @@ eMspStatus Pmt::populateFromSaraMetaData(uint8_t *buffer, uint32_t size)
 
 
 /** *********************************************************
+ The metadata is the tCpePgrmHandlePmt followed by each program descriptor and
+ its data, then each ES and its descriptors and their data.  The structures
+ are copied to the storage (they are not aligned in the metadata), the data
+ are views into a copy of the metadata.
  */
 eMspStatus Pmt::populateMSPMetaData(uint8_t *buffer, uint32_t size)
 {
@@ -655,83 +944,133 @@ eMspStatus Pmt::populateMSPMetaData(uint8_t *buffer, uint32_t size)
 
     int i, j;
 
-    UNUSED_PARAM(size);
-
-    uint8_t *metaptr = buffer;
+    if ((buffer == NULL) || (size < sizeof(tCpePgrmHandlePmt)))
+    {
+        LOG(DLOGL_ERROR, "Error: buffer: %p  size: %d", buffer, size);
+        return kMspStatus_BadParameters;
+    }
 
-    //allocating and copying the base mpmtinfo structure
-    unsigned int data_size = sizeof(tCpePgrmHandlePmt);
-    memcpy(&mPmtInfo, metaptr, data_size);
+    freePmtInfo();
+    mStorage = PmtStorage::create(buffer, size);
+    if (mStorage == NULL)
+    {
+        return kMspStatus_Error;
+    }
 
-    metaptr += data_size;
+    uint8_t *metaptr = mStorage->getData();
+    uint8_t *metaEnd = metaptr + size;
 
+    //copying the base mpmtinfo structure
+    memcpy(&mPmtInfo, metaptr, sizeof(tCpePgrmHandlePmt));
+    metaptr += sizeof(tCpePgrmHandlePmt);
 
     PRINTD(" -----------------PMT Structure Info------------------------- ");
     PRINTD("   Version No      :0x%x ", mPmtInfo.versionNumber);
     PRINTD("   Clock PID       :0x%x ", mPmtInfo.clockPid);
     PRINTD("   Pgm Descs Count :%d",    mPmtInfo.pgmDescCount);
 
+    int pgmDescCount = mPmtInfo.pgmDescCount;
+    int esCount = mPmtInfo.esCount;
+    mPmtInfo.pgmDescCount = 0;
+    mPmtInfo.esCount = 0;
+    mPmtInfo.ppPgmDesc = (tCpePgrmHandleMpegDesc **)allocInfo(pgmDescCount * sizeof(tCpePgrmHandleMpegDesc *));
+    mPmtInfo.ppEsData = (tCpePgrmHandleEsData **)allocInfo(esCount * sizeof(tCpePgrmHandleEsData *));
+    if ((mPmtInfo.ppPgmDesc == NULL) || (mPmtInfo.ppEsData == NULL))
+    {
+        freePmtInfo();
+        return kMspStatus_Error;
+    }
 
-    //allocating and copying program descriptors
-    data_size = (sizeof(tCpePgrmHandleMpegDesc));   //copying program descriptors
-    mPmtInfo.ppPgmDesc = (tCpePgrmHandleMpegDesc **)malloc(mPmtInfo.pgmDescCount * sizeof(tCpePgrmHandleMpegDesc *)); //allocating memory for pgmdesc ptrs memory
-    for (i = 0; i < mPmtInfo.pgmDescCount; i++)
+    //copying program descriptors
+    for (i = 0; i < pgmDescCount; i++)
     {
-        mPmtInfo.ppPgmDesc[i] = (tCpePgrmHandleMpegDesc *)malloc(data_size);
-        memcpy((void *)mPmtInfo.ppPgmDesc[i], (void *)metaptr, data_size);
-        metaptr += data_size;
-        mPmtInfo.ppPgmDesc[i]->data = (uint8_t *)malloc(mPmtInfo.ppPgmDesc[i]->dataLen);
-        memcpy((void *)mPmtInfo.ppPgmDesc[i]->data, (void *)metaptr, mPmtInfo.ppPgmDesc[i]->dataLen); //copying program descriptor's data
-        metaptr += mPmtInfo.ppPgmDesc[i]->dataLen;
+        tCpePgrmHandleMpegDesc *pDescInfo = (tCpePgrmHandleMpegDesc *)allocInfo(sizeof(tCpePgrmHandleMpegDesc));
+        if ((pDescInfo == NULL) || (metaptr + sizeof(tCpePgrmHandleMpegDesc) > metaEnd))
+        {
+            break;
+        }
+        memcpy(pDescInfo, metaptr, sizeof(tCpePgrmHandleMpegDesc));
+        metaptr += sizeof(tCpePgrmHandleMpegDesc);
+        if (metaptr + pDescInfo->dataLen > metaEnd)
+        {
+            break;
+        }
+        pDescInfo->data = metaptr;
+        metaptr += pDescInfo->dataLen;
 
+        mPmtInfo.ppPgmDesc[i] = pDescInfo;
+        mPmtInfo.pgmDescCount++;
 
         PRINTD("  +- Pgm Desc[%u]------", i + 1);
-        PRINTD("  | Tag      :0x%02x ", mPmtInfo.ppPgmDesc[i]->tag);
-        PRINTD("  | Data Len :0x%02x ", mPmtInfo.ppPgmDesc[i]->dataLen);
+        PRINTD("  | Tag      :0x%02x ", pDescInfo->tag);
+        PRINTD("  | Data Len :0x%02x ", pDescInfo->dataLen);
     }
 
-    data_size = sizeof(tCpePgrmHandleEsData);
-    mPmtInfo.ppEsData = (tCpePgrmHandleEsData **)malloc(mPmtInfo.esCount * sizeof(tCpePgrmHandleEsData *)); //allocating memory for esdesc ptrs
-
-    for (i = 0; i < mPmtInfo.esCount; i++)
+    for (i = 0; (i < esCount) && (mPmtInfo.pgmDescCount == pgmDescCount); i++)
     {
-        mPmtInfo.ppEsData[i] = (tCpePgrmHandleEsData *)malloc(data_size);
-        memcpy((void *)mPmtInfo.ppEsData[i], (void *)metaptr, data_size);    //copying ES data
-
+        tCpePgrmHandleEsData *pEsInfo = (tCpePgrmHandleEsData *)allocInfo(sizeof(tCpePgrmHandleEsData));
+        if ((pEsInfo == NULL) || (metaptr + sizeof(tCpePgrmHandleEsData) > metaEnd))
+        {
+            break;
+        }
+        memcpy(pEsInfo, metaptr, sizeof(tCpePgrmHandleEsData));    //copying ES data
+        metaptr += sizeof(tCpePgrmHandleEsData);
 
         PRINTD("  ...ES Data[%u]------", i + 1);
-        PRINTD("  . Stream Type   :0x%02x ", mPmtInfo.ppEsData[i]->streamType);
-        PRINTD("  . PID           :0x%xu ", mPmtInfo.ppEsData[i]->pid);
-        PRINTD("  . Reserved      :%s", mPmtInfo.ppEsData[i]->reserved);
-        PRINTD("  . ES Desc Count :%u", mPmtInfo.ppEsData[i]->descCount);
-
-        metaptr += data_size;
-        if (mPmtInfo.ppEsData[i]->ppEsDesc != NULL)
+        PRINTD("  . Stream Type   :0x%02x ", pEsInfo->streamType);
+        PRINTD("  . PID           :0x%xu ", pEsInfo->pid);
+        PRINTD("  . Reserved      :%s", pEsInfo->reserved);
+        PRINTD("  . ES Desc Count :%u", pEsInfo->descCount);
+
+        // the recorded pointer only tells whether descriptors follow
+        int descCount = (pEsInfo->ppEsDesc != NULL) ? pEsInfo->descCount : 0;
+        pEsInfo->ppEsDesc = NULL;
+        pEsInfo->descCount = 0;
+        if (descCount)
         {
-            mPmtInfo.ppEsData[i]->ppEsDesc = (tCpePgrmHandleMpegDesc **)malloc(mPmtInfo.ppEsData[i]->descCount * sizeof(tCpePgrmHandleMpegDesc *));
-            for (j = 0; j < mPmtInfo.ppEsData[i]->descCount; j++)
+            pEsInfo->ppEsDesc = (tCpePgrmHandleMpegDesc **)allocInfo(descCount * sizeof(tCpePgrmHandleMpegDesc *));
+            if (pEsInfo->ppEsDesc == NULL)
             {
-                mPmtInfo.ppEsData[i]->ppEsDesc[j] = (tCpePgrmHandleMpegDesc *)malloc(sizeof(tCpePgrmHandleMpegDesc));
-                memcpy((void *)mPmtInfo.ppEsData[i]->ppEsDesc[j], (void *)metaptr, sizeof(tCpePgrmHandleMpegDesc)); //copying ES descriptor
-                metaptr += sizeof(tCpePgrmHandleMpegDesc);
-
-                mPmtInfo.ppEsData[i]->ppEsDesc[j]->data = (uint8_t *)malloc(mPmtInfo.ppEsData[i]->ppEsDesc[j]->dataLen);
-                memcpy((void *)mPmtInfo.ppEsData[i]->ppEsDesc[j]->data, (void *)metaptr, mPmtInfo.ppEsData[i]->ppEsDesc[j]->dataLen); //copying ES descriptor data;
-                metaptr += mPmtInfo.ppEsData[i]->ppEsDesc[j]->dataLen;
+                break;
             }
         }
-    }
+        for (j = 0; j < descCount; j++)
+        {
+            tCpePgrmHandleMpegDesc *pDescInfo = (tCpePgrmHandleMpegDesc *)allocInfo(sizeof(tCpePgrmHandleMpegDesc));
+            if ((pDescInfo == NULL) || (metaptr + sizeof(tCpePgrmHandleMpegDesc) > metaEnd))
+            {
+                break;
+            }
+            memcpy(pDescInfo, metaptr, sizeof(tCpePgrmHandleMpegDesc)); //copying ES descriptor
+            metaptr += sizeof(tCpePgrmHandleMpegDesc);
+            if (metaptr + pDescInfo->dataLen > metaEnd)
+            {
+                break;
+            }
+            pDescInfo->data = metaptr;
+            metaptr += pDescInfo->dataLen;
 
-    createAudioVideoListsFromPmtInfo();
+            pEsInfo->ppEsDesc[j] = pDescInfo;
+            pEsInfo->descCount++;
+        }
+
+        mPmtInfo.ppEsData[i] = pEsInfo;
+        mPmtInfo.esCount++;
+        if (pEsInfo->descCount != descCount)
+        {
+            break;
+        }
+    }
 
-    dlog(DL_MSP_PSI, DLOGL_REALLY_NOISY, "Buffer data reading MSP metadata %p %p %d", metaptr, buffer, size);
-    if ((unsigned int)(metaptr - buffer) >  size)
+    if ((mPmtInfo.pgmDescCount != pgmDescCount) || (mPmtInfo.esCount != esCount))
     {
+        // keep what was read, like before, the recording may still play
         dlog(DL_MSP_PSI, DLOGL_ERROR, "Buffer overrun reading MSP metadata %p %p %d", metaptr, buffer, size);
     }
 
+    createAudioVideoListsFromPmtInfo();
+
     printPmtInfo();
 
     return kMspStatus_Ok;
 }
-
@@ -13,6 +13,9 @@
 #include <stdbool.h>
 #include <string>
 #include<list>
+#include <map>
+#include <vector>
+#include <pthread.h>
 
 // cpe includes
 #include <cpe_source.h>
@@ -66,10 +69,61 @@ tPat;
 
 
 
+/**
+   \class PmtStorage
+   \brief Immutable memory behind a Pmt
+
+   Holds one copy of the PMT section (or recording metadata) the Pmt was built
+   from, which descriptor data points into, and a bump allocator for the
+   tCpePgrmHandlePmt structures, so building a Pmt takes a couple of
+   allocations instead of several per elementary stream and releasing it is a
+   single unref().  The content does not change once the Pmt is built, copies
+   of a Pmt share it by reference.
+*/
+class PmtStorage
+{
+public:
+    /// Storage with a copy of size bytes at data (none when data is NULL)
+    static PmtStorage* create(const uint8_t *data, uint32_t size);
+
+    void ref(void);
+    void unref(void);
+
+    uint8_t* getData(void) const
+    {
+        return mData;
+    }
+    uint32_t getSize(void) const
+    {
+        return mSize;
+    }
+
+    /// Zeroed memory released with the storage
+    void* alloc(size_t size);
+
+private:
+    PmtStorage();
+    ~PmtStorage();
+
+    volatile int          mRefCount;
+    uint8_t              *mData;
+    uint32_t              mSize;
+    std::vector<uint8_t*> mChunks;
+    size_t                mChunkUsed;       // bytes used in mChunks.back()
+
+    PmtStorage(const PmtStorage&);
+    PmtStorage& operator=(const PmtStorage&);
+};
+
+
 /**
    \class Pmt
    \brief To store PMT info and send
 
+   Descriptor data in mPmtInfo points into the PmtStorage of the Pmt: it is
+   valid as long as the Pmt or a copy of it.  getDescriptor() takes a
+   reference on the storage for the data it returns, so the data stays valid
+   after the Pmt is replaced, until releaseDescriptor() is called on any Pmt.
 */
 
 class Pmt
@@ -81,6 +135,10 @@ private:
     tCpeMediaTransportStreamParam mTsParams;
     std::list<tPid> mVideoPid;
     std::list<tPid> mAudioPid;
+    PmtStorage        *mStorage;  // memory behind mPmtInfo, NULL when empty
+    // descriptor data handed out by getDescriptor() -> the storage it holds, one entry per reference
+    static std::multimap<const uint8_t*, PmtStorage*> mDescriptorRefs;
+    static pthread_mutex_t mDescriptorRefsMutex;
     friend class DisplaySession;
     friend class Psi;
     friend class RecordSession;
@@ -89,6 +147,17 @@ public:
 
     Pmt();
     ~Pmt();
+    // copies share the descriptors and section of the original
+    Pmt(const Pmt &pmt);
+    Pmt& operator=(const Pmt &pmt);
+
+    /*!  \fn   eMspStatus parseSection(const uint8_t *section, uint32_t sectionLength)
+     \brief builds the PMT info from a PMT section, replacing the current one
+     @param const uint8_t *section : PMT section, starting at table_id
+     @param uint32_t sectionLength : section_length field of the section
+     @return eMspStatus
+     */
+    eMspStatus parseSection(const uint8_t *section, uint32_t sectionLength);
 
     /*!  \fn   std::list<tPid> * getVideoPidList(void)
      \brief To send the list of video PIDS with along with stream type
@@ -107,7 +176,8 @@ public:
 
 
     /*!  \fn   void     getDescriptor(tCpePgrmHandleMpegDesc *descriptor, uint16_t pid)
-     \brief to send descriptor data for particular pid and tag
+     \brief to send descriptor data for particular pid and tag, the data is not copied but
+            stays valid until releaseDescriptor()
      @param tCpePgrmHandleMpegDesc *descriptor : type of descriptor to fill the data
      @param uint16_t pid : PID number to find out the descriptor
      @return None
@@ -115,7 +185,7 @@ public:
     eMspStatus getDescriptor(tCpePgrmHandleMpegDesc *descriptor, uint16_t pid);
 
     /*!  \fn   void     releaseDescriptor(tCpePgrmHandleMpegDesc *descriptor)
-      \brief to release the descriptor data
+      \brief to release the descriptor data, whichever Pmt returned it
       @param tCpePgrmHandleMpegDesc *descriptor : type of descriptor data to be released
       @return None
       */
@@ -143,6 +213,7 @@ private:
     uint32_t   getTransportID(void);
     void       printPmtInfo(void);
     void       freePmtInfo(void);
+    void*      allocInfo(size_t size);
 
 };
 
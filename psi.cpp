@@ -24,10 +24,12 @@ Implementation file for psi class
 
 #include <dlog.h>
 #include "eventQueue.h"
+#include "MSPWorkerPool.h"
 #include "crc32.h"
+#include "psiSectionCache.h"
+#include "recordingPsiIndex.h"
 #include "MusicAppData.h"
 
-#include"pthread_named.h"
 #include "psiUtils.h"
 
 ///////////////////////////////////////////////////////////////////////////
@@ -51,43 +53,35 @@ Implementation file for psi class
 /** *********************************************************
 */
 
-void* Psi::eventthreadFunc(void *data)
+bool Psi::eventHandler(void *data, Event *evt)
 {
-    // eventthreadFunc is static class method running in a pthread
+    // eventHandler is static class method running on an MSP worker pool thread,
+    // never on two threads at once for the same instance
 
-    FNLOG(DL_MSP_PSI);
+    Psi *inst = (Psi *)data;
+    bool done = false;
+
+    LOG(DLOGL_REALLY_NOISY, "dispatch event %d", evt->eventType);
+    inst->lockMutex();
+    done = inst->dispatchEvent(evt);  // call member function in class instance to handle event
+    inst->psiThreadEventQueue->freeEvent(evt);
+    inst->unlockMutex();
+
+    return done;
+}
 
+/** *********************************************************
+*/
+unsigned int Psi::eventIdleTimeout(void *data)
+{
     Psi *inst = (Psi *)data;
-    if (inst)
-    {
-        MSPEventQueue* eventQueue = inst->psiThreadEventQueue;
-        if (eventQueue)
-        {
-            bool done = false;
+    unsigned int waitTime = 0;
 
-            while (!done)
-            {
-                unsigned int waitTime = 0;
-                if (inst->mState == kPsiWaitForPat || inst->mState == kPsiWaitForPmt)
-                {
-                    waitTime = 5;
-                }
-                eventQueue->setTimeOutSecs(waitTime);
-                Event *evt = eventQueue->popEventQueue();
-                eventQueue->unSetTimeOut();
-                if (evt)
-                {
-                    LOG(DLOGL_REALLY_NOISY, "dispatch event %d", evt->eventType);
-                    inst->lockMutex();
-                    done = inst->dispatchEvent(evt);  // call member function in class instance to handle event
-                    eventQueue->freeEvent(evt);
-                    inst->unlockMutex();
-                }
-            }
-        }
+    if (inst->mState == kPsiWaitForPat || inst->mState == kPsiWaitForPmt)
+    {
+        waitTime = 5;
     }
-    pthread_exit(NULL);
-    return NULL;
+    return waitTime;
 }
 
 /** *********************************************************
@@ -131,12 +125,15 @@ bool Psi::dispatchEvent(Event *evt)
         break;
 
     case kPsiStartEvent:
-        // mPmtPid needs to be zero (PAT PID number) when here
-        // since we may be re-starting PSI on a different channel, reset it here
-        mPmtPid = 0;
+        // we may be re-starting PSI on a different channel, reset mPmtPid here
+        // unless decode already started from the warm PMT, which keeps its PID until the PAT is read
+        if (!mPmtWarm)
+        {
+            mPmtPid = 0;
+        }
         LOG(DLOGL_REALLY_NOISY, "kPsiStartEvent, mPmtPid %d", mPmtPid);
 
-        status = startSectionFilter(mPmtPid);
+        status = startSectionFilter(0);     // PAT PID
         if (status != kMspStatus_Ok)
         {
             callbackToClient(kPSIError);
@@ -187,6 +184,18 @@ bool Psi::dispatchEvent(Event *evt)
         callbackToClient(kPSIReady);
         break;
 
+    case kPsiWarmPMTReadyEvent:
+        // the PAT/PMT section filters keep running to verify the warm PMT
+        LOG(DLOGL_NOISE, "Warm PMT ready, PMT pid 0x%x", mPmtPid);
+        callbackToClient(kPSIReady);
+        break;
+
+    case kPsiPMTVerifiedEvent:
+        LOG(DLOGL_REALLY_NOISY, "Live PMT matches warm PMT - wait for update");
+        status = startSectionFilter(mPmtPid, true);
+        mState = kPsiWaitForUpdate;
+        break;
+
     case kPsiRevUpdateEvent:
         //psiStop();
         LOG(DLOGL_REALLY_NOISY, "Change in PMT revision.But not audio/video Pids");
@@ -325,10 +334,7 @@ eMspStatus Psi::processCaptionServiceMetaDataDescriptor(uint8_t *buffer, uint32_
 
 eMspStatus Psi::psiStart(std::string recordUrl)
 {
-    tCpeRecDataBase *metabuf;
-    FILE *fp;
     std::string recfile;
-    size_t result = 0;
 
     FNLOG(DL_MSP_PSI);
 
@@ -345,153 +351,71 @@ eMspStatus Psi::psiStart(std::string recordUrl)
     mPmt->mAudioPid.clear();
     // ToDO:Move all free to one common function
     freePsi();
+    mTuneKeyValid = false;      // only RF sources have a warm PMT
+    mPmtWarm = false;
+    mPmtSectionCrc = 0;
 
-    if (psiEventHandlerThread)
+    if (psiEventStrand)
     {
-        LOG(DLOGL_NORMAL, ":  PSI event thread already started for this session");
+        LOG(DLOGL_NORMAL, ":  PSI event strand already started for this session");
     }
-
     else                            //RF source case
     {
-
-        pthread_attr_t attr;
-        pthread_attr_init(&attr);  // sets default - thread is joinable
-
-        //TODO: Consider if 256 KB is really needed
-        const int THREAD_STACK_SIZE = 256 * 1024; // 256K
-
-        pthread_attr_setstacksize(&attr, THREAD_STACK_SIZE);
-
-        int threadRetvalue = pthread_create(&psiEventHandlerThread,
-                                            &attr,
-                                            eventthreadFunc,
-                                            (void *) this);
-
-        if (!threadRetvalue)
-        {
-            threadRetvalue = pthread_setname_np(psiEventHandlerThread, "MSP_PSI_Event_Handler");
-            if (threadRetvalue)
-            {
-                LOG(DLOGL_ERROR, "Error setting threadname retVal: %d", threadRetvalue);
-            }
-
-        }
-        else
-        {
-            LOG(DLOGL_ERROR, "pthread_create error %d\n", threadRetvalue);
-            unlockMutex();
-            return kMspStatus_PsiThreadError;
-        }
-
+        psiEventStrand = new MSPStrand("MSP_PSI_Event_Handler", psiThreadEventQueue,
+                                       eventHandler, eventIdleTimeout, (void *) this);
+        psiEventStrand->start();
     }
 
     recfile = recordUrl.substr(strlen("avfs://"));
 
-    const char* recFilename =  recfile.c_str();
-
-    LOG(DLOGL_NOISE, "open %s", recFilename);
-
-    fp = fopen(recFilename, "rb");
-    if (!fp)
+    // the metadata of a recording seen before comes from the index, without reading the file
+    std::vector<uint8_t> records;
+    RecordingPsiIndex *recIndex = RecordingPsiIndex::getInstance();
+    if (!recIndex->lookup(recfile, records))
     {
-        LOG(DLOGL_ERROR, "error opening %s", recFilename);
-        unlockMutex();
-        return kMspStatus_Error;
-    }
-
-    // obtain file size:
-    fseek(fp, 0, SEEK_END);
-
-    int metasize = ftell(fp);
-    if (metasize <= 0)
-    {
-        LOG(DLOGL_ERROR, "error: file: %s size: %d", recFilename, metasize);
-        fclose(fp);
-        fp = NULL;
-        unlockMutex();
-        return kMspStatus_Error;
-    }
-
-    // TODO: check this - why adding 1024 bytes?
-    metabuf = (tCpeRecDataBase *)malloc(metasize + 1024);
-    if (!metabuf)
-    {
-        LOG(DLOGL_ERROR, "error allocating %d bytes", metasize + 1024);
-        fclose(fp);
-        fp = NULL;
-        unlockMutex();
-        return kMspStatus_OutofMemory;
-    }
-
-    rewind(fp);
-
-    result = fread(metabuf, 1, (unsigned int)metasize, fp);
-    if (result != (unsigned int)metasize)
-    {
-        LOG(DLOGL_ERROR, "error fread %s read %d bytes - expected %d", recFilename, result, metasize);
-        free(metabuf);
-        metabuf = NULL;
-        fclose(fp);
-        fp = NULL;
-        unlockMutex();
-        return kMspStatus_Error;
-    }
-
-    fclose(fp);
-    fp = NULL;
-
-    LOG(DLOGL_REALLY_NOISY, "dbHdr.dbCounts: %d", metabuf->dbHdr.dbCounts);
-
-    if (metabuf->dbHdr.dbCounts > kCpeRec_DataBaseEntries)
-    {
-        LOG(DLOGL_ERROR, "Error dbCounts: %d > kCpeRec_DataBaseEntries", metabuf->dbHdr.dbCounts);
-        free(metabuf);
-        metabuf = NULL;
-        unlockMutex();
-        return kMspStatus_Error;
+        LOG(DLOGL_NOISE, "read %s", recfile.c_str());
+        eMspStatus status = recIndex->indexRecording(recfile, records);
+        if (status != kMspStatus_Ok)
+        {
+            unlockMutex();
+            return status;
+        }
     }
 
     bool createSaraCaDescriptor = false;
+    tRecordingMetaEntry entry;
+    uint32_t pos = 0;
 
-    for (int i = 0; i < metabuf->dbHdr.dbCounts; i++)
+    while (RecordingPsiIndex::nextEntry(records, &pos, &entry))
     {
-        uint32_t offset         =  metabuf->dbEntry[i].offset;
-        uint8_t *sectionAddress = (uint8_t *)(metabuf) + offset;
-        uint32_t tag            =   metabuf->dbEntry[i].tag;
-        uint32_t metadataSize   =  metabuf->dbEntry[i].size;
-
-        LOG(DLOGL_REALLY_NOISY, "[%d] tag: 0x%x  offset: 0x%x  sectionAddress: %p  metadataSize: %d",
-            i,  tag, offset, sectionAddress, metadataSize);
+        LOG(DLOGL_REALLY_NOISY, "tag: 0x%x  data: %p  metadataSize: %d", entry.tag, entry.data, entry.size);
 
-        switch (tag)
+        switch (entry.tag)
         {
-        case 0x1FAB:
-            processMSPMetaData(sectionAddress, metadataSize);
+        case kRecMetaTag_MspPmt:
+            processMSPMetaData(entry.data, entry.size);
             break;
 
-        case 0x102:   // old SARA tag
-            processSaraMetaData(sectionAddress, metadataSize);
+        case kRecMetaTag_SaraPmt:
+            processSaraMetaData(entry.data, entry.size);
             break;
 
-        case 0x1FAC:
-            processCaMetaDataBlob(sectionAddress, metadataSize);
+        case kRecMetaTag_CaBlob:
+            processCaMetaDataBlob(entry.data, entry.size);
             break;
 
-        case 0x101:  // old SARA tag
-            processCaMetaDataBlob(sectionAddress, metadataSize);
+        case kRecMetaTag_SaraCaBlob:
+            processCaMetaDataBlob(entry.data, entry.size);
             createSaraCaDescriptor = true;
             break;
 
-        case 0x1FAD:
-            processCaMetaDataDescriptor(sectionAddress, metadataSize);
+        case kRecMetaTag_CaDescriptor:
+            processCaMetaDataDescriptor(entry.data, entry.size);
             break;
 
-        case 0x1FAE:
-            processCaptionServiceMetaDataDescriptor(sectionAddress, metadataSize);
+        case kRecMetaTag_CaptionService:
+            processCaptionServiceMetaDataDescriptor(entry.data, entry.size);
             break;
-
-        default:
-            LOG(DLOGL_ERROR, "warning: unknown metadata tag: 0x%x offset: 0x%x", tag, offset);
         }
     }
 
@@ -500,9 +424,6 @@ eMspStatus Psi::psiStart(std::string recordUrl)
         createSaraCaMetaDataDescriptor();
     }
 
-    free(metabuf);
-    metabuf = NULL;
-
     LOG(DLOGL_NOISE, "Queueing File source Ready event");
     queueEvent(kPsiFileSrcPMTReady);
 
@@ -533,6 +454,9 @@ eMspStatus Psi::psiStart(const MSPSource *aSource)
     mPmt->mAudioPid.clear();
     // ToDO:Move all free to one common function
     freePsi();
+    mTuneKeyValid = false;      // only RF sources have a warm PMT
+    mPmtWarm = false;
+    mPmtSectionCrc = 0;
 
 
     if (!aSource)
@@ -542,41 +466,15 @@ eMspStatus Psi::psiStart(const MSPSource *aSource)
         return kMspStatus_Error;
     }
 
-    if (psiEventHandlerThread)
+    if (psiEventStrand)
     {
-        LOG(DLOGL_NORMAL, ":  PSI event thread already started for this channel");
+        LOG(DLOGL_NORMAL, ":  PSI event strand already started for this channel");
     }
     else                            //RF source case
     {
-        pthread_attr_t attr;
-        pthread_attr_init(&attr);  // sets default - thread is joinable
-
-        //TODO: Consider if 256 KB is really needed
-        const int THREAD_STACK_SIZE = 256 * 1024; // 256K
-
-        pthread_attr_setstacksize(&attr, THREAD_STACK_SIZE);
-
-        int threadRetvalue = pthread_create(&psiEventHandlerThread,
-                                            &attr,
-                                            eventthreadFunc,
-                                            (void *) this);
-
-        if (!threadRetvalue)
-        {
-            threadRetvalue = pthread_setname_np(psiEventHandlerThread, "MSP_PSI_Event_Handler");
-            if (threadRetvalue)
-            {
-                LOG(DLOGL_ERROR, "Error setting threadname retVal: %d", threadRetvalue);
-            }
-
-        }
-        else
-        {
-            LOG(DLOGL_ERROR, "pthread_create error %d\n", threadRetvalue);
-            unlockMutex();
-            return kMspStatus_PsiThreadError;
-        }
-
+        psiEventStrand = new MSPStrand("MSP_PSI_Event_Handler", psiThreadEventQueue,
+                                       eventHandler, eventIdleTimeout, (void *) this);
+        psiEventStrand->start();
     }
 
     if (aSource->isDvrSource())      //MRDVR Remote file source case
@@ -599,6 +497,21 @@ eMspStatus Psi::psiStart(const MSPSource *aSource)
     {
         mPgmNo     = aSource->getProgramNumber();
         mSrcHandle = aSource->getCpeSrcHandle();
+
+        // a revisited channel starts from its warm PMT, the live PAT/PMT verify it
+        tCpeSrcRFTune tuningParams;
+        mTuneKeyValid = aSource->getTuningParams(&tuningParams);
+        if (mTuneKeyValid)
+        {
+            mTuneKey.frequencyHz = tuningParams.frequencyHz;
+            mTuneKey.symbolRate = tuningParams.symbolRate;
+            mTuneKey.mode = tuningParams.mode;
+            mTuneKey.programNumber = mPgmNo;
+            if (loadWarmPmt())
+            {
+                queueEvent(kPsiWarmPMTReadyEvent);
+            }
+        }
         queueEvent(kPsiStartEvent);
     }
 
@@ -677,6 +590,153 @@ eMspStatus Psi::ParsePsiRemoteSource(const MSPSource *aSource)
 
 
 
+/** *********************************************************
+ Same state machine as for a section filter, the sections are rebuilt from
+ the transport packets given to feedTsPackets().
+*/
+eMspStatus Psi::psiStartTsFeed(uint16_t pgmNo)
+{
+    FNLOG(DL_MSP_PSI);
+
+    if (mPmt == NULL)
+    {
+        LOG(DLOGL_ERROR, "Error: null mPmt");
+        return kMspStatus_Error;
+    }
+    lockMutex();
+
+    mPmt->freePmtInfo();
+    mPmt->mVideoPid.clear();
+    mPmt->mAudioPid.clear();
+    freePsi();
+    mTuneKeyValid = false;
+    mPmtWarm = false;
+    mPmtSectionCrc = 0;
+
+    mPgmNo = pgmNo;
+    mTsReassembler = new TsSectionReassembler(tsSectionCallback, (void *) this);
+
+    if (psiEventStrand == NULL)
+    {
+        psiEventStrand = new MSPStrand("MSP_PSI_Event_Handler", psiThreadEventQueue,
+                                       eventHandler, eventIdleTimeout, (void *) this);
+        psiEventStrand->start();
+    }
+    queueEvent(kPsiStartEvent);
+
+    unlockMutex();
+
+    return kMspStatus_Ok;
+}
+
+/** *********************************************************
+ */
+eMspStatus Psi::feedTsPackets(const uint8_t *data, uint32_t size)
+{
+    eMspStatus status = kMspStatus_Ok;
+
+    if ((data == NULL) || (size == 0))
+    {
+        return kMspStatus_BadParameters;
+    }
+
+    // the whole batch is reassembled under one lock, like one section filter callback
+    lockMutex();
+    if (mTsReassembler)
+    {
+        mTsReassembler->pushBytes(data, size);
+    }
+    else
+    {
+        LOG(DLOGL_ERROR, "Error: PSI not started with psiStartTsFeed");
+        status = kMspStatus_Error;
+    }
+    unlockMutex();
+
+    return status;
+}
+
+/** *********************************************************
+ Called by the reassembler with the Psi mutex held, as the section filter callback is.
+*/
+void Psi::tsSectionCallback(void *ctx, uint16_t pid, const uint8_t *section, uint32_t size)
+{
+    Psi *inst = (Psi *) ctx;
+    tCpeSFltBuffer sfltBuff;
+
+    LOG(DLOGL_REALLY_NOISY, "pid 0x%x table 0x%x size %u", pid, section[0], size);
+
+    memset(&sfltBuff, 0, sizeof(sfltBuff));
+    sfltBuff.pBuffer = (uint8_t *) section;
+    sfltBuff.length = size;
+    inst->setCallbackData(&sfltBuff);
+}
+
+/** *********************************************************
+ Fills mPmt from the warm PAT/PMT of the program being started.
+ Called with the Psi mutex held, before the section filters are started.
+*/
+bool Psi::loadWarmPmt(void)
+{
+    uint8_t *pat = NULL;
+    uint8_t *pmt = NULL;
+    uint32_t patSize = 0;
+    uint32_t pmtSize = 0;
+    uint16_t pmtPid = 0;
+
+    if (!PsiSectionCache::getInstance()->lookupWarmPmt(mTuneKey, &pmtPid, &pat, &patSize, &pmt, &pmtSize))
+    {
+        return false;
+    }
+
+    tTableHeader patHdr, pmtHdr;
+    getSectionHeader(pat, &patHdr);
+    getSectionHeader(pmt, &pmtHdr);
+
+    mPSecFilterBuf = pmt;
+    eMspStatus status = collectPmtData(pmtHdr.SectionLength);
+    mPSecFilterBuf = NULL;
+
+    if ((status != kMspStatus_Ok) || !PsiSectionCache::getSectionCrc(pmt, pmtSize, &mWarmPmtCrc))
+    {
+        LOG(DLOGL_ERROR, "Warm PMT of pgm %d not usable", mPgmNo);
+        mPmt->freePmtInfo();
+        mPmt->mVideoPid.clear();
+        mPmt->mAudioPid.clear();
+        free(pat);
+        free(pmt);
+        return false;
+    }
+
+    mPmt->mPmtInfo.versionNumber = pmtHdr.VersionNumber;
+    mPmt->mTsParams.transportID = patHdr.TransportStreamID;
+    mPmt->mTsParams.progNumber = mPgmNo;
+    mPmtPid = pmtPid;
+
+    // freePsi() already released the previous channel's sections
+    mRawPatPtr = pat;
+    mRawPatSize = patSize;
+    mRawPmtPtr = pmt;
+    mRawPmtSize = pmtSize;
+    mCurrentPMTCRC = crc32(0xFFFFFFFF, (char *)(mRawPmtPtr + kPMT_HeaderSize), (mRawPmtSize - kPMT_HeaderSize));
+    PsiSectionCache::getSectionCrc(mRawPmtPtr, mRawPmtSize, &mPmtSectionCrc);
+    mPmtWarm = true;
+
+    LOG(DLOGL_SIGNIFICANT_EVENT, "Starting pgm %d from warm PMT, pid 0x%x version %d", mPgmNo, mPmtPid, pmtHdr.VersionNumber);
+    return true;
+}
+
+/** *********************************************************
+ Remembers the PAT and the given PMT section as the warm PMT of the program.
+*/
+void Psi::storeWarmPmt(const uint8_t *pmt, uint32_t pmtSize)
+{
+    if (mTuneKeyValid && mRawPatPtr)
+    {
+        PsiSectionCache::getInstance()->storeWarmPmt(mTuneKey, mPmtPid, mRawPatPtr, mRawPatSize, pmt, pmtSize);
+    }
+}
+
 /** *********************************************************
  */
 eMspStatus Psi::startSectionFilter(uint16_t pid, bool aPsiUpdateFlag)
@@ -699,6 +759,16 @@ eMspStatus Psi::startSectionFilter(uint16_t pid, bool aPsiUpdateFlag)
 
     eMspStatus status = kMspStatus_Ok;
 
+    if (mTsReassembler)
+    {
+        // sections come from feedTsPackets(), CRCs are checked by the reassembler
+        mTsReassembler->disableAllPids();
+        mTsReassembler->enablePid(pid);
+        mState = kPsiStateOpened;
+        mSfStarted = true;
+        return status;
+    }
+
     // OPEN
     // Open a section filter to read mpeg section data.
     // Actual data is received in callback.
@@ -811,6 +881,12 @@ eMspStatus Psi::psiStop()
     eMspStatus status = kMspStatus_Ok;
     FNLOG(DL_MSP_PSI);
 
+    if (mTsReassembler)
+    {
+        mTsReassembler->disableAllPids();
+        mSfStarted = false;
+    }
+
     if (mPgrmHandleSf)
     {
         if (mSfStarted)
@@ -917,6 +993,7 @@ Psi::Psi()
     mState          = kPsiStateIdle;
     mSfStarted      = false;
     mPmt            = new Pmt();
+    mTsReassembler  = NULL;
     m_ppsiUtils = psiUtils::getpsiUtilsInstance();
 
     caMetaDataSize = 0;
@@ -926,8 +1003,15 @@ Psi::Psi()
 
     // create event queue for scan thread
     psiThreadEventQueue = new MSPEventQueue();
-
-    psiEventHandlerThread = 0;
+    psiThreadEventQueue->setEventPriority(kPsiExitEvent, kMSPEventPriorityHigh);
+    // the section data lives in mPSecFilterBuf, so only the newest callback event can be parsed
+    psiThreadEventQueue->setEventCoalescing(kPsiSFCallbackEvent, true);
+    psiThreadEventQueue->setEventPriority(kPsiUpdateEvent, kMSPEventPriorityLow);
+    psiThreadEventQueue->setEventCoalescing(kPsiUpdateEvent, true);
+    psiThreadEventQueue->setEventPriority(kPsiRevUpdateEvent, kMSPEventPriorityLow);
+    psiThreadEventQueue->setEventCoalescing(kPsiRevUpdateEvent, true);
+
+    psiEventStrand = NULL;
     mSfCbIdError = 0;
     mSfCbIdSectionData = 0;
     mSfCbIdTimeOut = 0;
@@ -939,6 +1023,11 @@ Psi::Psi()
     mRawPatPtr = NULL;
     mRawPatSize = 0;
     mCurrentPMTCRC = 0;
+    memset(&mTuneKey, 0, sizeof(mTuneKey));
+    mTuneKeyValid = false;
+    mPmtWarm = false;
+    mWarmPmtCrc = 0;
+    mPmtSectionCrc = 0;
 
     pthread_mutex_init(&mPsiMutex, NULL);
     musicPid = 0;
@@ -984,6 +1073,9 @@ void Psi::freePsi()
         mRawPatPtr = NULL;
     }
 
+    delete mTsReassembler;
+    mTsReassembler = NULL;
+
     // mState = kPsiStateClosed;
 
 }
@@ -996,14 +1088,14 @@ Psi::~Psi()
 
     mDeletePsiRequested = true;
 
-    if (psiEventHandlerThread)
+    if (psiEventStrand)
     {
-        LOG(DLOGL_REALLY_NOISY, "wait for PSI thread to exit");
-        queueEvent(kPsiExitEvent);  // tell thread to exit
-
-        pthread_join(psiEventHandlerThread, NULL);       // wait for event thread to exit
+        LOG(DLOGL_REALLY_NOISY, "wait for PSI strand to exit");
+        queueEvent(kPsiExitEvent);  // tell strand to exit
 
-        psiEventHandlerThread = 0;
+        psiEventStrand->join();        // wait for exit event to be handled
+        delete psiEventStrand;
+        psiEventStrand = NULL;
     }
 
     delete psiThreadEventQueue;
@@ -1181,6 +1273,8 @@ void Psi::setCallbackData(tCpeSFltBuffer *pSfltBuff)
     LOG(DLOGL_REALLY_NOISY, "Version number %d", header->VersionNumber);
 
     bool allocMem = false;
+    uint32_t sectionCrc = 0;
+    uint16_t cachedPmtPid = 0;
 
     // TODO: Why all the pre-filtering checks.
     //       Determine if allocations don't always happen.
@@ -1190,8 +1284,36 @@ void Psi::setCallbackData(tCpeSFltBuffer *pSfltBuff)
     {
         if (tableID == kAppPatId)
         {
-            allocMem = true;
             psiStop();
+            if (mPmt && PsiSectionCache::getSectionCrc(pSfltBuff->pBuffer, pSfltBuff->length, &sectionCrc) &&
+                    PsiSectionCache::getInstance()->lookupPat(header->TransportStreamID, mPgmNo, header->VersionNumber, sectionCrc, &cachedPmtPid))
+            {
+                // Same PAT as already parsed for this program, go straight to the PMT.
+                // Only the raw copy handed out by getRawPat() is kept.
+                LOG(DLOGL_NOISE, "Found cached PAT, PMT pid 0x%x", cachedPmtPid);
+                if ((mRawPatPtr == NULL) || (mRawPatSize < pSfltBuff->length))
+                {
+                    free(mRawPatPtr);
+                    mRawPatPtr = (uint8_t *)malloc(pSfltBuff->length);   // this is freed after during PSI destructor call
+                }
+                if (mRawPatPtr == NULL)
+                {
+                    LOG(DLOGL_EMERGENCY, "Error malloc %d bytes", pSfltBuff->length);
+                    return;
+                }
+                memcpy(mRawPatPtr, pSfltBuff->pBuffer, pSfltBuff->length);
+                mRawPatSize = pSfltBuff->length;
+
+                mPmt->mTsParams.transportID = header->TransportStreamID;
+                mPmt->mTsParams.progNumber = mPgmNo;
+                mPmtPid = cachedPmtPid;
+                mState = kPsiWaitForPmt;
+                mSectFileReadAttempts = 0;
+                queueEvent(kPsiPATReadyEvent);
+                return;
+            }
+
+            allocMem = true;
             mState = kPsiProcessingPAT;
             LOG(DLOGL_NOISE, "Found PAT");
         }
@@ -1207,12 +1329,44 @@ void Psi::setCallbackData(tCpeSFltBuffer *pSfltBuff)
             psiStop();
             mState = kPsiProcessingPMT;
             LOG(DLOGL_NOISE, "Found PMT");
+
+            if (mPmtWarm)
+            {
+                // decode already started from the warm PMT, the live PMT only has to confirm it
+                mPmtWarm = false;
+                if (PsiSectionCache::getSectionCrc(pSfltBuff->pBuffer, pSfltBuff->length, &sectionCrc) &&
+                        (sectionCrc == mWarmPmtCrc))
+                {
+                    PsiSectionCache::getInstance()->storePmt(mPmt->mTsParams.transportID, mPmt->mTsParams.progNumber,
+                            header->VersionNumber, sectionCrc);
+                    allocMem = false;
+                    queueEvent(kPsiPMTVerifiedEvent);
+                }
+                else
+                {
+                    // parsed as an update, decode is only restarted if the A/V PIDs changed
+                    LOG(DLOGL_NORMAL, "Live PMT differs from warm PMT");
+                    PsiSectionCache::getInstance()->countWarmPmtStale();
+                    mState = kPsiProcessingPMTUpdate;
+                }
+            }
         }
         else
             LOG(DLOGL_ERROR, "Wrong table ID %d for PSI state %d", tableID, mState);
     }
     else if (mState == kPsiWaitForUpdate)
     {
+        // compared with the PMT of this instance: another tuner on the same program may
+        // already have put a newer version in the section cache
+        if (mPmt && (tableID == kAppPmtId) && (header->VersionNumber == mPmt->mPmtInfo.versionNumber) &&
+                PsiSectionCache::getSectionCrc(pSfltBuff->pBuffer, pSfltBuff->length, &sectionCrc) &&
+                (sectionCrc == mPmtSectionCrc))
+        {
+            // the PMT in use sent again, leave the filter running
+            LOG(DLOGL_REALLY_NOISY, "Duplicate PMT version %d", header->VersionNumber);
+            return;
+        }
+
         if (mPmt && (tableID == kAppPmtId) && (header->VersionNumber != mPmt->mPmtInfo.versionNumber))
         {
             psiStop();
@@ -1231,6 +1385,13 @@ void Psi::setCallbackData(tCpeSFltBuffer *pSfltBuff)
             {
                 mState =  kPsiUpdatePMTRevision;
                 mPmt->mPmtInfo.versionNumber = header->VersionNumber;
+                if (PsiSectionCache::getSectionCrc(pSfltBuff->pBuffer, pSfltBuff->length, &sectionCrc))
+                {
+                    mPmtSectionCrc = sectionCrc;
+                    PsiSectionCache::getInstance()->storePmt(mPmt->mTsParams.transportID, mPmt->mTsParams.progNumber,
+                            header->VersionNumber, sectionCrc);
+                }
+                storeWarmPmt(pSfltBuff->pBuffer, pSfltBuff->length);
                 queueEvent(kPsiRevUpdateEvent);
             }
         }
@@ -1362,6 +1523,11 @@ eMspStatus Psi::parseSectionFilterCallBackData()
             if (status == kMspStatus_Ok)
             {
                 LOG(DLOGL_REALLY_NOISY, "Success: Pgm num %d found after %d attempts", mPgmNo, mSectFileReadAttempts);
+                uint32_t sectionCrc;
+                if (PsiSectionCache::getSectionCrc(mRawPatPtr, mRawPatSize, &sectionCrc))
+                {
+                    PsiSectionCache::getInstance()->storePat(tableHdr->TransportStreamID, mPgmNo, tableHdr->VersionNumber, sectionCrc, mPmtPid);
+                }
                 mState = kPsiWaitForPmt;
                 mSectFileReadAttempts = 0;
                 queueEvent(kPsiPATReadyEvent);
@@ -1403,12 +1569,14 @@ eMspStatus Psi::parseSectionFilterCallBackData()
             {
                 LOG(DLOGL_NORMAL, "Updating the PMT by deleting the older one");
                 uint32_t progNumber = mPmt->mTsParams.progNumber;
+                uint32_t transportID = mPmt->mTsParams.transportID;
                 tempVideoPid = mPmt->mVideoPid;
                 tempAudioPid = mPmt->mAudioPid;
+                // descriptors handed out by the old PMT hold its storage
                 delete mPmt;
-                mPmt = NULL;
                 mPmt = new Pmt();
                 mPmt->mTsParams.progNumber = progNumber;
+                mPmt->mTsParams.transportID = transportID;
             }
 
             status = collectPmtData(tableHdr->SectionLength);
@@ -1426,6 +1594,14 @@ eMspStatus Psi::parseSectionFilterCallBackData()
             if (status == kMspStatus_Ok)
             {
                 mSectFileReadAttempts = 0;
+                uint32_t sectionCrc;
+                if (PsiSectionCache::getSectionCrc(mRawPmtPtr, mRawPmtSize, &sectionCrc))
+                {
+                    mPmtSectionCrc = sectionCrc;
+                    PsiSectionCache::getInstance()->storePmt(mPmt->mTsParams.transportID, mPmt->mTsParams.progNumber,
+                            tableHdr->VersionNumber, sectionCrc);
+                }
+                storeWarmPmt(mRawPmtPtr, mRawPmtSize);
                 if (mState == kPsiProcessingPMTUpdate)
                 {
                     // psiStop();
@@ -1521,6 +1697,7 @@ eMspStatus Psi::collectPatData(uint32_t sectionLength)
     int size = (sectionLength - (kAppTableHeaderFromSectionLength + kAppTableCRCSize)) / sizeof(tPat);
 
     tPat* patData = m_ppsiUtils->getPatData(mPSecFilterBuf);
+    bool found = false;
 
     for (int idx = 0; idx < size; idx++, patData++)
     {
@@ -1529,8 +1706,9 @@ eMspStatus Psi::collectPatData(uint32_t sectionLength)
         if (patData && mPmt && (programData.ProgNumber == mPgmNo))
         {
             LOG(DLOGL_REALLY_NOISY, "Pgm No : 0x%x -  PID : 0x%x", programData.ProgNumber, programData.PID);
-            mPmtPid = programData.PID;     // the only place  mPmtPid is set
+            mPmtPid = programData.PID;     // the only place  mPmtPid is set from a live PAT
             mPmt->mTsParams.progNumber = programData.ProgNumber;
+            found = true;
             LOG(DLOGL_REALLY_NOISY, "Found PMT Pid = 0x%x for mPgmNo: %d", mPmtPid, mPgmNo);
             break;
         }
@@ -1538,7 +1716,7 @@ eMspStatus Psi::collectPatData(uint32_t sectionLength)
 
     eMspStatus status;
 
-    if (mPmtPid)
+    if (found && mPmtPid)
     {
         status = kMspStatus_Ok;
     }
@@ -1557,201 +1735,27 @@ eMspStatus Psi::collectPmtData(uint32_t sectionLength)
 {
     FNLOG(DL_MSP_PSI);
 
-    eMspStatus status = kMspStatus_Ok;
-
-    uint8_t* pSecFilterBuf = mPSecFilterBuf;
-
-
-    uint8_t        descTag;
-    uint8_t        descLen;
-    int            totalPmtLen;
-    uint8_t       *pPmtEnd;
-    int            pgmInfoLen;
-    uint8_t       *pPgmInfoEnd;
-    uint16_t       esInfoLen;
-    uint8_t       *pEsInfoEnd;
-
-    tCpePgrmHandleMpegDesc  *pDescInfo;
-    tCpePgrmHandleEsData    *pEsDataInfo;
-
     if (mPmt == NULL)
     {
         LOG(DLOGL_ERROR, "%sError: Null pmt data ", __FILE__);
         return kMspStatus_Error;
     }
-    memset(&(mPmt->mPmtInfo), 0, sizeof(tCpePgrmHandlePmt));
-
-    pSecFilterBuf += sizeof(tTableHeader);     // get past table header
-    totalPmtLen = (sectionLength - (kAppTableHeaderFromSectionLength + kAppTableCRCSize));
-    pPmtEnd = pSecFilterBuf + totalPmtLen;
 
-    // Clock Pid
-    mPmt->mTsParams.pidTable.clockPid = (*pSecFilterBuf++ & 0x1F) << 8;
-    mPmt->mTsParams.pidTable.clockPid |= *pSecFilterBuf++;
-    mPmt->mPmtInfo.clockPid = mPmt->mTsParams.pidTable.clockPid;
-
-    dlog(DL_MSP_PSI, DLOGL_REALLY_NOISY, "PCR PID : 0x%x\n", mPmt->mTsParams.pidTable.clockPid);
-
-    // program_info_length
-    pgmInfoLen = (*pSecFilterBuf++ & 0x0F) << 8;
-    pgmInfoLen |= *pSecFilterBuf++;
-    pPgmInfoEnd = pSecFilterBuf + pgmInfoLen;
-    if (pPgmInfoEnd > pPmtEnd)
+    eMspStatus status = mPmt->parseSection(mPSecFilterBuf, sectionLength);
+    if (status != kMspStatus_Ok)
     {
-        dlog(DL_MSP_PSI, DLOGL_REALLY_NOISY, "%s:%d PMT parse length error \n", __FUNCTION__, __LINE__);
-        return kMspStatus_PsiError;
+        return status;
     }
 
-    dlog(DL_MSP_PSI, DLOGL_REALLY_NOISY, "%s:%d program_info_length \n", __FUNCTION__, __LINE__);
-
-    mPmt->mPmtInfo.pgmDescCount = 0;
-    if (pgmInfoLen == 0)
+    for (int i = 0; i < mPmt->mPmtInfo.esCount; i++)
     {
-        mPmt->mPmtInfo.ppPgmDesc = NULL;
-        dlog(DL_MSP_PSI, DLOGL_REALLY_NOISY, "%s:%d pPmtInfo->ppPgmDesc = NULL; \n", __FUNCTION__, __LINE__);
-    }
-    else
-    {
-        mPmt->mPmtInfo.ppPgmDesc = (tCpePgrmHandleMpegDesc **)calloc(kAppMaxProgramDesciptors, sizeof(tCpePgrmHandleMpegDesc *));
-        LOG(DLOGL_REALLY_NOISY, "Program descriptor base pointer is %p", mPmt->mPmtInfo.ppPgmDesc);
-        while ((pSecFilterBuf < pPgmInfoEnd) && (mPmt->mPmtInfo.pgmDescCount < kAppMaxProgramDesciptors))
-        {
-            descTag = *pSecFilterBuf++;
-            descLen = *pSecFilterBuf++;
-            pDescInfo = (tCpePgrmHandleMpegDesc *)calloc(1, sizeof(tCpePgrmHandleMpegDesc));
-            if (pDescInfo)
-            {
-                pDescInfo->tag = descTag;
-                pDescInfo->dataLen = descLen;
-                pDescInfo->data = (uint8_t *)calloc(1, descLen);
-                memcpy(pDescInfo->data, pSecFilterBuf, descLen);
-
-                mPmt->mPmtInfo.ppPgmDesc[mPmt->mPmtInfo.pgmDescCount] = pDescInfo;
-                mPmt->mPmtInfo.pgmDescCount++;
-                pSecFilterBuf += descLen;
-            }
-            else
-            {
-                LOG(DLOGL_REALLY_NOISY, "%sError: Null pDescInfo ", __FILE__);
-                return kMspStatus_PsiError;
-            }
-        }
-    }
-
-    dlog(DL_MSP_PSI, DLOGL_REALLY_NOISY, "%s:%d ES Info \n", __FUNCTION__, __LINE__);
-
-    // ES Info
-    pSecFilterBuf = pPgmInfoEnd;
-
-    mPmt->mPmtInfo.esCount = 0;
-    mPmt->mPmtInfo.ppEsData = (tCpePgrmHandleEsData **)calloc(kAppMaxEsCount, sizeof(tCpePgrmHandleEsData *));
-    while ((pSecFilterBuf < pPmtEnd) && (mPmt->mPmtInfo.esCount < kAppMaxEsCount))
-    {
-        uint16_t pid;
-        tPid avpid;
-
-        pEsDataInfo = (tCpePgrmHandleEsData *)calloc(1, sizeof(tCpePgrmHandleEsData));
-        if (pEsDataInfo == NULL)
-        {
-            LOG(DLOGL_REALLY_NOISY, "%sError: Null pEsDataInfo ", __FILE__);
-            return kMspStatus_PsiError;
-        }
-        uint8_t streamType = *pSecFilterBuf++;
-        pEsDataInfo->reserved[0] = *pSecFilterBuf >> 5;
-        pid = (*pSecFilterBuf++ & 0x1F) << 8;
-        pid |= *pSecFilterBuf++ & 0xFF;
-        pEsDataInfo->streamType = streamType;
-        pEsDataInfo->pid = pid;
-
-        dlog(DL_MSP_PSI, DLOGL_REALLY_NOISY, "Stream Type : 0x%x -  PID : 0x%x\n", streamType, pid);
-
-        switch (streamType)
-        {
-        case kCpeStreamType_MPEG1_Video:
-        case kCpeStreamType_MPEG2_Video:
-        case kCpeStreamType_H264_Video:
-        case kCpeStreamType_GI_Video:
-        case kCpeStreamType_VC1_Video:
-
-            mPmt->mTsParams.pidTable.videoStreamType = streamType;
-            mPmt->mTsParams.pidTable.videoPid = pid;
-            avpid.pid = pid;
-            avpid.streamType = streamType;
-            mPmt->mVideoPid.push_back(avpid);
-            break;
-
-        case kCpeStreamType_MPEG1_Audio:
-        case kCpeStreamType_MPEG2_Audio:
-        case kCpeStreamType_AAC_Audio:
-        case kCpeStreamType_AACplus_Audio:
-        case kCpeStreamType_DDPlus_Audio:
-        case kCpeStreamType_GI_Audio:
-
-            mPmt->mTsParams.pidTable.audioStreamType = streamType;
-            mPmt->mTsParams.pidTable.audioPid = pid;
-            avpid.pid = pid;
-            avpid.streamType = streamType;
-            mPmt->mAudioPid.push_back(avpid);
-            break;
-        case kText_DCII:
-            musicPid = pid;
-            break;
-        }
-
-        // ES_info_length
-        pEsDataInfo->reserved[1] = *pSecFilterBuf >> 4;
-        esInfoLen = (*pSecFilterBuf++ & 0xF) << 8;
-        esInfoLen |= *pSecFilterBuf++;
-        pEsDataInfo->reserved[2] = 0; // ??
-
-        pEsDataInfo->descCount = 0;
-        if (esInfoLen == 0)
+        if (mPmt->mPmtInfo.ppEsData[i]->streamType == kText_DCII)
         {
-            pEsDataInfo->ppEsDesc = NULL;
+            musicPid = mPmt->mPmtInfo.ppEsData[i]->pid;
         }
-        else
-        {
-            pEsInfoEnd = pSecFilterBuf + esInfoLen;
-            pEsDataInfo->ppEsDesc = (tCpePgrmHandleMpegDesc **)calloc(kMaxESDescriptors, sizeof(tCpePgrmHandleMpegDesc *));
-            while ((pSecFilterBuf < pEsInfoEnd) && (pEsDataInfo->descCount < kMaxESDescriptors))
-            {
-                descTag = *pSecFilterBuf++;
-                descLen = *pSecFilterBuf++;
-                pDescInfo = (tCpePgrmHandleMpegDesc *)calloc(1, sizeof(tCpePgrmHandleMpegDesc));
-                pDescInfo->tag = descTag;
-                pDescInfo->dataLen = descLen;
-                pDescInfo->data = (uint8_t *)calloc(1, descLen);
-                memcpy(pDescInfo->data, pSecFilterBuf, descLen);
-
-                pSecFilterBuf += descLen;
-                pEsDataInfo->ppEsDesc[pEsDataInfo->descCount] = pDescInfo;
-                pEsDataInfo->descCount++;
-            }
-        }
-        mPmt->mPmtInfo.ppEsData[mPmt->mPmtInfo.esCount] = pEsDataInfo;
-        mPmt->mPmtInfo.esCount = mPmt->mPmtInfo.esCount + 1;
     }
 
-    dlog(DL_MSP_PSI, DLOGL_REALLY_NOISY, "%s:%d PMT PARSE END  \n", __FUNCTION__, __LINE__);
-
-    if ((mPmt->mTsParams.pidTable.audioPid) || (mPmt->mTsParams.pidTable.videoPid))
-    {
-        dlog(DL_MSP_PSI, DLOGL_REALLY_NOISY, "%s:%d Found AudPid=0x%x VidPid=0x%x \n", __FUNCTION__, __LINE__, mPmt->mTsParams.pidTable.audioPid, mPmt->mTsParams.pidTable.videoPid);
-
-        mPmt->printPmtInfo();
-
-    }
-    else
-    {
-        dlog(DL_MSP_PSI, DLOGL_REALLY_NOISY, "%s:%d  No Audio & video PID found in PMT Continuing  \n", __FUNCTION__, __LINE__);
-        mPmt->freePmtInfo();
-        return kMspStatus_PsiError;
-
-    }
-
-    return status;
-
-
+    return kMspStatus_Ok;
 }
 
 
@@ -2026,14 +2030,7 @@ eMspStatus Psi::getRawPat(uint8_t **PatPtr)
 
 unsigned int Psi::crc32(unsigned int seed, const char *buf, unsigned int len)
 {
-    unsigned int crc, index;
-
-    for (crc = seed; len > 0; len--)
-    {
-        index = 0xff & ((crc >> 24) ^ (*buf++));
-        crc = (crc << 8) ^ (crctab[index]);
-    }
-    return crc;
+    return MSPCrc32::compute(seed, buf, len);
 }
 
 
@@ -22,6 +22,8 @@
 #include "MSPSource.h"
 #include "pmt.h"
 #include "psiUtils.h"
+#include "psiSectionCache.h"
+#include "tsSectionReassembler.h"
 
 // cpe includes
 #include <cpe_source.h>
@@ -31,6 +33,7 @@
 #include <cpe_recmgr.h>
 
 class MSPEventQueue;
+class MSPStrand;
 class Event;
 
 
@@ -150,6 +153,8 @@ private:
                   kPsiRevUpdateEvent,
                   kPsiGetRemoteFilePmt,
                   kPsiFileSrcPMTReady,
+                  kPsiWarmPMTReadyEvent,
+                  kPsiPMTVerifiedEvent,
                   kPsiExitEvent
                  } ePsiEvent;
 
@@ -179,7 +184,7 @@ private:
     uint8_t   *mRawPmtPtr, *mRawPatPtr;
     unsigned int mRawPmtSize, mRawPatSize;
     MSPEventQueue* psiThreadEventQueue;
-    pthread_t psiEventHandlerThread;
+    MSPStrand* psiEventStrand;          /**< runs psiThreadEventQueue on the shared MSP worker pool */
     pthread_mutex_t  mPsiMutex;
     psiUtils *m_ppsiUtils; //Creating object to access psi utils
 
@@ -197,6 +202,21 @@ public:
     eMspStatus psiStart(const MSPSource *aSource);
     eMspStatus psiStart(std::string recordUrl);
 
+    /*!  \fn   eMspStatus  psiStartTsFeed(uint16_t pgmNo)
+     \brief To start the Psi processing on transport packets given to feedTsPackets() instead of a section filter
+     @param uint16_t pgmNo: Requested program number
+     @return eMspStatus
+     */
+    eMspStatus psiStartTsFeed(uint16_t pgmNo);
+
+    /*!  \fn   eMspStatus  feedTsPackets(const uint8_t *data, uint32_t size)
+     \brief Gives transport stream bytes to a Psi started with psiStartTsFeed(), in any size
+     @param const uint8_t *data: transport stream, packets may be split between calls
+     @param uint32_t size: number of bytes
+     @return eMspStatus
+     */
+    eMspStatus feedTsPackets(const uint8_t *data, uint32_t size);
+
 
     /**  \fn   eMspStatus  psiStop(void)
      \brief To stop the Psi processing, called by meadia controller
@@ -256,7 +276,8 @@ public:
 private:
 
     uint32_t musicPid;
-    static void* eventthreadFunc(void *data);
+    static bool eventHandler(void *data, Event *evt);
+    static unsigned int eventIdleTimeout(void *data);
     bool  dispatchEvent(Event *evt);
     eMspStatus queueEvent(ePsiEvent evtyp);
 
@@ -322,9 +343,23 @@ private:
 // MRDVR support routines
     eMspStatus ParsePsiRemoteSource(const MSPSource *aSource);
 
+// Transport packet feed, the reassembler stands in for the section filter
+    static void tsSectionCallback(void *ctx, uint16_t pid, const uint8_t *section, uint32_t size);
+    TsSectionReassembler *mTsReassembler;   /**< set between psiStartTsFeed() and the next start or exit */
+
     bool mDeletePsiRequested;
     unsigned int mCurrentPMTCRC;
 
+// Warm PMT support, see psiSectionCache.h
+    bool loadWarmPmt(void);
+    void storeWarmPmt(const uint8_t *pmt, uint32_t pmtSize);
+
+    tPsiTuneKey mTuneKey;           /**< tuning params + program number, valid when mTuneKeyValid */
+    bool mTuneKeyValid;
+    bool mPmtWarm;                  /**< mPmt came from the warm cache and the live PMT has not been seen yet */
+    uint32_t mWarmPmtCrc;           /**< CRC_32 field of the warm PMT section */
+    uint32_t mPmtSectionCrc;        /**< CRC_32 field of the PMT section in use, 0 when not known */
+
 
 public:
     unsigned int crc32(unsigned int seed, const char *buf, unsigned int len);
@@ -0,0 +1,312 @@
+/**
+   \file psiSectionCache.cpp
+   \class PsiSectionCache
+
+Implementation file for the PSI section cache
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <dlog.h>
+
+#include "psiSectionCache.h"
+
+#define LOG(level, msg, args...)  dlog(DL_MSP_PSI, level,"PsiSectionCache:%s:%d " msg, __FUNCTION__, __LINE__, ##args);
+
+#define kPsiSectionHeaderSize  3   ///< table_id and section_length, section_length counts the bytes after them
+#define kPsiSectionCrcSize     4
+
+PsiSectionCache* PsiSectionCache::mInstance = NULL;
+pthread_mutex_t PsiSectionCache::mInstanceMutex = PTHREAD_MUTEX_INITIALIZER;
+
+PsiSectionCache* PsiSectionCache::getInstance(void)
+{
+    pthread_mutex_lock(&mInstanceMutex);
+    if (mInstance == NULL)
+    {
+        mInstance = new PsiSectionCache();
+    }
+    pthread_mutex_unlock(&mInstanceMutex);
+    return mInstance;
+}
+
+PsiSectionCache::PsiSectionCache()
+{
+    pthread_mutex_init(&mMutex, NULL);
+    mUseCount = 0;
+    mHits = 0;
+    mMisses = 0;
+    mWarmHits = 0;
+    mWarmMisses = 0;
+    mWarmStale = 0;
+}
+
+// The cache lives as long as the process, like the other MSP singletons
+PsiSectionCache::~PsiSectionCache()
+{
+    pthread_mutex_destroy(&mMutex);
+}
+
+bool PsiSectionCache::getSectionCrc(const uint8_t *buf, uint32_t length, uint32_t *crc)
+{
+    if ((buf == NULL) || (crc == NULL) || (length < kPsiSectionHeaderSize))
+    {
+        return false;
+    }
+
+    uint32_t sectionLength = ((buf[1] & 0x0F) << 8) | buf[2];
+    uint32_t sectionEnd = kPsiSectionHeaderSize + sectionLength;
+
+    if ((sectionLength < kPsiSectionCrcSize) || (sectionEnd > length))
+    {
+        return false;
+    }
+
+    const uint8_t *p = buf + sectionEnd - kPsiSectionCrcSize;
+    *crc = (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+    return true;
+}
+
+bool PsiSectionCache::lookupPat(uint16_t transportId, uint16_t programNumber, uint8_t version, uint32_t crc, uint16_t *pmtPid)
+{
+    bool hit = false;
+
+    pthread_mutex_lock(&mMutex);
+    Entry *entry = findLocked(makeKey(transportId, programNumber));
+    if (entry && entry->patValid && (entry->patVersion == version) && (entry->patCrc == crc))
+    {
+        entry->lastUse = ++mUseCount;
+        *pmtPid = entry->pmtPid;
+        hit = true;
+        mHits++;
+    }
+    else
+    {
+        mMisses++;
+    }
+    pthread_mutex_unlock(&mMutex);
+
+    LOG(DLOGL_REALLY_NOISY, "tsid 0x%x pgm %d version %d crc 0x%08x: %s", transportId, programNumber, version, crc, hit ? "hit" : "miss");
+    return hit;
+}
+
+void PsiSectionCache::storePat(uint16_t transportId, uint16_t programNumber, uint8_t version, uint32_t crc, uint16_t pmtPid)
+{
+    pthread_mutex_lock(&mMutex);
+    Entry *entry = findOrAddLocked(makeKey(transportId, programNumber));
+    if (entry->patValid && (entry->pmtPid != pmtPid))
+    {
+        // the program moved, the PMT seen on the old PID is not its PMT any more
+        entry->pmtValid = false;
+    }
+    entry->patValid = true;
+    entry->patVersion = version;
+    entry->patCrc = crc;
+    entry->pmtPid = pmtPid;
+    pthread_mutex_unlock(&mMutex);
+}
+
+bool PsiSectionCache::lookupPmt(uint16_t transportId, uint16_t programNumber, uint8_t version, uint32_t crc)
+{
+    bool hit = false;
+
+    pthread_mutex_lock(&mMutex);
+    Entry *entry = findLocked(makeKey(transportId, programNumber));
+    if (entry && entry->pmtValid && (entry->pmtVersion == version) && (entry->pmtCrc == crc))
+    {
+        entry->lastUse = ++mUseCount;
+        hit = true;
+        mHits++;
+    }
+    else
+    {
+        mMisses++;
+    }
+    pthread_mutex_unlock(&mMutex);
+
+    LOG(DLOGL_REALLY_NOISY, "tsid 0x%x pgm %d version %d crc 0x%08x: %s", transportId, programNumber, version, crc, hit ? "hit" : "miss");
+    return hit;
+}
+
+void PsiSectionCache::storePmt(uint16_t transportId, uint16_t programNumber, uint8_t version, uint32_t crc)
+{
+    pthread_mutex_lock(&mMutex);
+    Entry *entry = findOrAddLocked(makeKey(transportId, programNumber));
+    entry->pmtValid = true;
+    entry->pmtVersion = version;
+    entry->pmtCrc = crc;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void PsiSectionCache::storeWarmPmt(const tPsiTuneKey &key, uint16_t pmtPid, const uint8_t *pat, uint32_t patSize,
+                                   const uint8_t *pmt, uint32_t pmtSize)
+{
+    if ((pat == NULL) || (patSize == 0) || (pmt == NULL) || (pmtSize == 0))
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&mMutex);
+    std::list<WarmEntry>::iterator iter;
+    for (iter = mWarmPmts.begin(); iter != mWarmPmts.end(); iter++)
+    {
+        if (isSameTuneKey(iter->key, key))
+        {
+            break;
+        }
+    }
+
+    if (iter != mWarmPmts.end())
+    {
+        mWarmPmts.splice(mWarmPmts.begin(), mWarmPmts, iter);
+    }
+    else
+    {
+        if (mWarmPmts.size() >= kPsiWarmPmtCacheSize)
+        {
+            mWarmPmts.pop_back();
+        }
+        mWarmPmts.push_front(WarmEntry());
+        mWarmPmts.front().key = key;
+    }
+
+    WarmEntry &entry = mWarmPmts.front();
+    entry.pmtPid = pmtPid;
+    entry.pat.assign(pat, pat + patSize);
+    entry.pmt.assign(pmt, pmt + pmtSize);
+    pthread_mutex_unlock(&mMutex);
+
+    LOG(DLOGL_REALLY_NOISY, "freq %u pgm %d: PMT pid 0x%x, %u bytes", key.frequencyHz, key.programNumber, pmtPid, pmtSize);
+}
+
+bool PsiSectionCache::lookupWarmPmt(const tPsiTuneKey &key, uint16_t *pmtPid, uint8_t **pat, uint32_t *patSize,
+                                    uint8_t **pmt, uint32_t *pmtSize)
+{
+    bool hit = false;
+
+    pthread_mutex_lock(&mMutex);
+    std::list<WarmEntry>::iterator iter;
+    for (iter = mWarmPmts.begin(); iter != mWarmPmts.end(); iter++)
+    {
+        if (isSameTuneKey(iter->key, key))
+        {
+            break;
+        }
+    }
+
+    if (iter != mWarmPmts.end())
+    {
+        *pat = (uint8_t *)malloc(iter->pat.size());
+        *pmt = (uint8_t *)malloc(iter->pmt.size());
+        if (*pat && *pmt)
+        {
+            memcpy(*pat, &iter->pat[0], iter->pat.size());
+            *patSize = iter->pat.size();
+            memcpy(*pmt, &iter->pmt[0], iter->pmt.size());
+            *pmtSize = iter->pmt.size();
+            *pmtPid = iter->pmtPid;
+            mWarmPmts.splice(mWarmPmts.begin(), mWarmPmts, iter);
+            hit = true;
+        }
+        else
+        {
+            LOG(DLOGL_EMERGENCY, "Error malloc %d bytes", (int)(iter->pat.size() + iter->pmt.size()));
+            free(*pat);
+            free(*pmt);
+            *pat = NULL;
+            *pmt = NULL;
+        }
+    }
+
+    if (hit)
+    {
+        mWarmHits++;
+    }
+    else
+    {
+        mWarmMisses++;
+    }
+    pthread_mutex_unlock(&mMutex);
+
+    LOG(DLOGL_NOISE, "freq %u pgm %d: %s", key.frequencyHz, key.programNumber, hit ? "hit" : "miss");
+    return hit;
+}
+
+void PsiSectionCache::countWarmPmtStale(void)
+{
+    pthread_mutex_lock(&mMutex);
+    mWarmStale++;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void PsiSectionCache::flush(void)
+{
+    pthread_mutex_lock(&mMutex);
+    mEntries.clear();
+    mWarmPmts.clear();
+    pthread_mutex_unlock(&mMutex);
+}
+
+void PsiSectionCache::getStats(DiagMspPsiCacheInfo *info)
+{
+    pthread_mutex_lock(&mMutex);
+    info->hits = mHits;
+    info->misses = mMisses;
+    info->entries = mEntries.size();
+    info->warmHits = mWarmHits;
+    info->warmMisses = mWarmMisses;
+    info->warmStale = mWarmStale;
+    pthread_mutex_unlock(&mMutex);
+}
+
+PsiSectionCache::Entry* PsiSectionCache::findLocked(uint32_t key)
+{
+    std::map<uint32_t, Entry>::iterator iter = mEntries.find(key);
+    return (iter != mEntries.end()) ? &iter->second : NULL;
+}
+
+PsiSectionCache::Entry* PsiSectionCache::findOrAddLocked(uint32_t key)
+{
+    Entry *entry = findLocked(key);
+
+    if (entry == NULL)
+    {
+        if (mEntries.size() >= kPsiSectionCacheMaxPrograms)
+        {
+            std::map<uint32_t, Entry>::iterator oldest = mEntries.begin();
+            for (std::map<uint32_t, Entry>::iterator iter = mEntries.begin(); iter != mEntries.end(); iter++)
+            {
+                if (iter->second.lastUse < oldest->second.lastUse)
+                {
+                    oldest = iter;
+                }
+            }
+            LOG(DLOGL_NOISE, "drop tsid 0x%x pgm %d", oldest->first >> 16, oldest->first & 0xFFFF);
+            mEntries.erase(oldest);
+        }
+
+        entry = &mEntries[key];
+        memset(entry, 0, sizeof(Entry));
+    }
+
+    entry->lastUse = ++mUseCount;
+    return entry;
+}
+
+eCsciMspDiagStatus Csci_Diag_GetMspPsiCacheInfo(DiagMspPsiCacheInfo *diagPsiCacheInfo)
+{
+    eCsciMspDiagStatus status = kCsciMspDiagStat_OK;
+
+    if (diagPsiCacheInfo)
+    {
+        memset(diagPsiCacheInfo, '\0', sizeof(DiagMspPsiCacheInfo));
+        PsiSectionCache::getInstance()->getStats(diagPsiCacheInfo);
+    }
+    else
+    {
+        LOG(DLOGL_ERROR, "NULL diag info pointer from Diag module to MSP");
+        status = kCsciMspDiagStat_InvalidInput;
+    }
+
+    return status;
+}
@@ -0,0 +1,138 @@
+/**
+   \file psiSectionCache.h
+   \class PsiSectionCache
+
+   Process wide record of the PAT/PMT sections Psi has already parsed, keyed
+   by (transport_stream_id, program_number).
+
+   Each entry remembers the version_number and CRC_32 field of the last PAT
+   and PMT parsed for the program, plus the PMT PID found in that PAT.  The
+   section filter callback looks a new section up before copying it or
+   posting it to the Psi strand:
+    - a PAT that is known for the program gives the PMT PID straight away,
+      so it is not copied or parsed again (channel changes on the same
+      transport stream),
+    - a PMT identical to the one in use is a duplicate and is dropped.
+   The CRC_32 field covers the whole section, version included, so comparing
+   it is enough to tell the section did not change without computing a CRC.
+
+   The cache also keeps the raw PAT and PMT of the last programs tuned, keyed
+   by RF tuning parameters and program number (the warm PMTs).  Psi starts a
+   revisited channel from its warm PMT before any section has been received
+   and lets the live PMT confirm or replace it.
+*/
+
+#if !defined(PSI_SECTION_CACHE_H)
+#define PSI_SECTION_CACHE_H
+
+#include <stdint.h>
+#include <map>
+#include <list>
+#include <vector>
+#include <pthread.h>
+
+#include "MSPDiagPages.h"
+
+#define kPsiSectionCacheMaxPrograms  64   ///< programs remembered, least recently used is dropped first
+#define kPsiWarmPmtCacheSize         16   ///< warm PMTs remembered, least recently used is dropped first
+
+/**
+   Identifies a program independently of its PSI: what the tuner was set to
+   and the program number looked for in the PAT.
+*/
+typedef struct
+{
+    uint32_t frequencyHz;
+    uint32_t symbolRate;
+    uint32_t mode;
+    uint16_t programNumber;
+} tPsiTuneKey;
+
+class PsiSectionCache
+{
+public:
+    static PsiSectionCache* getInstance(void);
+
+    /// CRC_32 field of the section in buf, false when length does not hold the section
+    static bool getSectionCrc(const uint8_t *buf, uint32_t length, uint32_t *crc);
+
+    /// true (a hit) when this PAT was parsed before for programNumber, pmtPid is the PMT PID found then
+    bool lookupPat(uint16_t transportId, uint16_t programNumber, uint8_t version, uint32_t crc, uint16_t *pmtPid);
+    /// Remember a PAT successfully parsed for programNumber
+    void storePat(uint16_t transportId, uint16_t programNumber, uint8_t version, uint32_t crc, uint16_t pmtPid);
+
+    /// true (a hit) when the PMT last parsed for the program has this version and CRC
+    bool lookupPmt(uint16_t transportId, uint16_t programNumber, uint8_t version, uint32_t crc);
+    /// Remember a PMT successfully parsed for the program
+    void storePmt(uint16_t transportId, uint16_t programNumber, uint8_t version, uint32_t crc);
+
+    /// Remember the PAT and PMT sections a program was last started with
+    void storeWarmPmt(const tPsiTuneKey &key, uint16_t pmtPid, const uint8_t *pat, uint32_t patSize,
+                      const uint8_t *pmt, uint32_t pmtSize);
+    /// Warm PAT/PMT of the program, the sections are malloc'ed copies the caller frees
+    bool lookupWarmPmt(const tPsiTuneKey &key, uint16_t *pmtPid, uint8_t **pat, uint32_t *patSize,
+                       uint8_t **pmt, uint32_t *pmtSize);
+    /// A warm PMT turned out to differ from the live one
+    void countWarmPmtStale(void);
+
+    /// Forget everything, the counters are kept
+    void flush(void);
+
+    void getStats(DiagMspPsiCacheInfo *info);
+
+private:
+    struct Entry
+    {
+        bool         patValid;
+        uint8_t      patVersion;
+        uint32_t     patCrc;
+        uint16_t     pmtPid;
+        bool         pmtValid;
+        uint8_t      pmtVersion;
+        uint32_t     pmtCrc;
+        unsigned int lastUse;
+    };
+
+    PsiSectionCache();
+    ~PsiSectionCache();
+
+    static uint32_t makeKey(uint16_t transportId, uint16_t programNumber)
+    {
+        return (((uint32_t) transportId) << 16) | programNumber;
+    }
+
+    struct WarmEntry
+    {
+        tPsiTuneKey          key;
+        uint16_t             pmtPid;
+        std::vector<uint8_t> pat;
+        std::vector<uint8_t> pmt;
+    };
+
+    static bool isSameTuneKey(const tPsiTuneKey &a, const tPsiTuneKey &b)
+    {
+        return (a.frequencyHz == b.frequencyHz) && (a.symbolRate == b.symbolRate) &&
+               (a.mode == b.mode) && (a.programNumber == b.programNumber);
+    }
+
+    Entry* findLocked(uint32_t key);
+    Entry* findOrAddLocked(uint32_t key);
+
+    pthread_mutex_t mMutex;
+    std::map<uint32_t, Entry> mEntries;
+    unsigned int    mUseCount;         // lastUse clock for the LRU
+    unsigned int    mHits;
+    unsigned int    mMisses;
+    std::list<WarmEntry> mWarmPmts;    // most recently used first
+    unsigned int    mWarmHits;
+    unsigned int    mWarmMisses;
+    unsigned int    mWarmStale;
+
+    static PsiSectionCache *mInstance;
+    static pthread_mutex_t mInstanceMutex;
+
+    PsiSectionCache(const PsiSectionCache&);
+    PsiSectionCache& operator=(const PsiSectionCache&);
+};
+
+#endif
@@ -113,6 +113,48 @@ public:
 
     }
 
+    /**
+      *
+      * \brief descriptors are views into the section, shared by copies of the Pmt
+      */
+
+    void test_pmt_parse_section(void)
+    {
+        // PCR 0x100, one program descriptor, H.264 video 0x101 with a CSD, AC-3 audio 0x102
+        uint8_t section[] = {0x02, 0xb0, 0x00, 0x00, 0x01, 0xc1, 0x00, 0x00, 0xe1, 0x00, 0xf0, 0x04, 0x09, 0x02, 0xaa, 0xbb,
+                             0x1b, 0xe1, 0x01, 0xf0, 0x05, 0x86, 0x03, 0x01, 0x02, 0x03,
+                             0x81, 0xe1, 0x02, 0xf0, 0x00,
+                             0x00, 0x00, 0x00, 0x00
+                            };
+        uint32_t sectionLength = sizeof(section) - 3;
+        section[2] = sectionLength;
+
+        Pmt *pmt = new Pmt();
+        TS_ASSERT(pmt->parseSection(section, sectionLength) == kMspStatus_Ok);
+        TS_ASSERT(pmt->getPcrpid() == 0x100);
+        TS_ASSERT(pmt->getVideoPidList()->size() == 1);
+        TS_ASSERT(pmt->getAudioPidList()->size() == 1);
+
+        tCpePgrmHandleMpegDesc desc;
+        desc.tag = 0x86;
+        TS_ASSERT(pmt->getDescriptor(&desc, 0x101) == kMspStatus_Ok);
+        TS_ASSERT(desc.dataLen == 3);
+
+        Pmt copy(*pmt);
+        delete pmt;
+        TS_ASSERT(desc.data[2] == 0x03);
+        desc.tag = 0x09;
+        TS_ASSERT(copy.getDescriptor(&desc, kPid) == kMspStatus_Ok);
+        TS_ASSERT(desc.data[1] == 0xbb);
+        copy.releaseDescriptor(&desc);
+        TS_ASSERT(desc.data == NULL);
+
+        // a descriptor running past program_info_length
+        section[13] = 0x20;
+        Pmt bad;
+        TS_ASSERT(bad.parseSection(section, sectionLength) == kMspStatus_PsiError);
+    }
+
 };
 
 
@@ -0,0 +1,376 @@
+/**
+   \file recordMetadataJournal.cpp
+   \class RecordMetadataJournal
+
+Implementation file for the journal of the recording metadata
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <dlog.h>
+
+#include <cpe_recmgr.h>
+
+#include "crc32.h"
+#include "recordingPsiIndex.h"
+#include "recordMetadataJournal.h"
+
+#define LOG(level, msg, args...)  dlog(DL_MSP_DVR, level,"RecMetaJournal:%s:%d " msg, __FUNCTION__, __LINE__, ##args);
+
+RecordMetadataJournal::RecordMetadataJournal(const std::string &metadataFile, bool journaling)
+{
+    mFile = metadataFile;
+    mJournal = journalFile(metadataFile);
+    mJournaling = journaling;
+    mFd = -1;
+    mHaveBase = false;
+    mBasePending = false;
+    mCci = 0;
+    mBaseSize = 0;
+    mJournalSize = 0;
+    mSeq = 0;
+    memset(&mStats, 0, sizeof(mStats));
+
+    // left by an earlier session of the file (TSB files are reused), the first write is a base
+    if ((unlink(mJournal.c_str()) == 0))
+    {
+        LOG(DLOGL_NOISE, "dropped %s", mJournal.c_str());
+    }
+}
+
+RecordMetadataJournal::~RecordMetadataJournal()
+{
+    if (mFd >= 0)
+    {
+        close(mFd);
+    }
+}
+
+std::string RecordMetadataJournal::journalFile(const std::string &metadataFile)
+{
+    return metadataFile + kRecMetaJournalSuffix;
+}
+
+int64_t RecordMetadataJournal::mtimeNs(const struct stat &st)
+{
+    // a rewrite within the second of the last one still changes the stamp
+    return ((int64_t) st.st_mtim.tv_sec * 1000000000) + st.st_mtim.tv_nsec;
+}
+
+bool RecordMetadataJournal::addStamp(const std::string &metadataFile, int64_t *mtime, int64_t *size)
+{
+    struct stat st;
+
+    if (stat(journalFile(metadataFile).c_str(), &st) != 0)
+    {
+        return false;
+    }
+    if (mtimeNs(st) > *mtime)
+    {
+        *mtime = mtimeNs(st);
+    }
+    *size += ((int64_t) st.st_size) << 32;
+    return true;
+}
+
+bool RecordMetadataJournal::isJournaled(uint32_t tag)
+{
+    // MSP reads these through ReadMrdvrMetaData() and the indexes, which replay the journal
+    return (tag == kRecMetaTag_CaBlob) || (tag == kRecMetaTag_CaDescriptor);
+}
+
+bool RecordMetadataJournal::toEntries(const uint8_t *db, uint32_t size, tRecMetaEntries &entries)
+{
+    const tCpeRecDataBase *base = (const tCpeRecDataBase *) db;
+
+    entries.clear();
+    if ((db == NULL) || (size < sizeof(tCpeRecDataBase)) || (base->dbHdr.dbCounts > kCpeRec_DataBaseEntries))
+    {
+        return false;
+    }
+
+    for (int i = 0; i < base->dbHdr.dbCounts; i++)
+    {
+        uint32_t offset = base->dbEntry[i].offset;
+        uint32_t length = base->dbEntry[i].size;
+        if ((offset > size) || (length > size - offset))
+        {
+            LOG(DLOGL_ERROR, "tag 0x%x offset 0x%x size %d past the end", base->dbEntry[i].tag, offset, length);
+            return false;
+        }
+        entries[base->dbEntry[i].tag].assign(db + offset, db + offset + length);
+    }
+    return true;
+}
+
+void RecordMetadataJournal::toDatabase(const tRecMetaEntries &entries, uint32_t cci, std::vector<uint8_t> &db)
+{
+    tCpeRecDataBase header;
+
+    memset(&header, 0, sizeof(header));
+    db.assign(sizeof(header), 0);
+    for (tRecMetaEntries::const_iterator itr = entries.begin(); itr != entries.end(); ++itr)
+    {
+        if (header.dbHdr.dbCounts >= kCpeRec_DataBaseEntries)
+        {
+            LOG(DLOGL_ERROR, "no entry left for tag 0x%x", itr->first);
+            break;
+        }
+        int i = header.dbHdr.dbCounts++;
+        header.dbEntry[i].tag = itr->first;
+        header.dbEntry[i].offset = db.size();
+        header.dbEntry[i].size = itr->second.size();
+        db.insert(db.end(), itr->second.begin(), itr->second.end());
+    }
+    header.dbHdr.version = kCpeRec_DataBaseVersion;
+    header.dbHdr.size = db.size();
+    header.dbHdr.CCI = cci;
+    memcpy(&db[0], &header, sizeof(header));
+}
+
+uint32_t RecordMetadataJournal::recordCrc(const tRecord &record, const uint8_t *data)
+{
+    uint32_t crc = MSPCrc32::compute(0xFFFFFFFF, &record.tag, 3 * sizeof(uint32_t));
+    return MSPCrc32::compute(crc, data, record.size);
+}
+
+void RecordMetadataJournal::replay(const std::string &journal, tRecMetaEntries &entries, int *records)
+{
+    *records = 0;
+
+    FILE *fp = fopen(journal.c_str(), "rb");
+    if (fp == NULL)
+    {
+        return;
+    }
+
+    tRecord record;
+    std::vector<uint8_t> data;
+    while (fread(&record, sizeof(record), 1, fp) == 1)
+    {
+        if (record.magic != kRecMetaJournalMagic)
+        {
+            LOG(DLOGL_ERROR, "%s: bad record after %d", journal.c_str(), *records);
+            break;
+        }
+        data.resize(record.size);
+        if ((record.size > 0) && (fread(&data[0], record.size, 1, fp) != 1))
+        {
+            // cut by a crash while appended
+            LOG(DLOGL_ERROR, "%s: record %d cut", journal.c_str(), record.seq);
+            break;
+        }
+        if (recordCrc(record, data.empty() ? NULL : &data[0]) != record.crc)
+        {
+            LOG(DLOGL_ERROR, "%s: record %d corrupt", journal.c_str(), record.seq);
+            break;
+        }
+        entries[record.tag] = data;
+        (*records)++;
+    }
+    fclose(fp);
+}
+
+int RecordMetadataJournal::apply(const std::string &metadataFile, std::vector<uint8_t> &db)
+{
+    tRecMetaEntries journaled;
+    int records;
+
+    if ((db.size() < sizeof(tCpeRecDataBase)) ||
+            (((tCpeRecDataBase *) &db[0])->dbHdr.dbCounts > kCpeRec_DataBaseEntries))
+    {
+        return -1;
+    }
+
+    replay(journalFile(metadataFile), journaled, &records);
+    if (records == 0)
+    {
+        return 0;
+    }
+
+    // the entries in the order of the base, replaced by the journal, then the ones only in the journal
+    tCpeRecDataBase header;
+    memcpy(&header, &db[0], sizeof(header));
+    std::vector<uint8_t> rebuilt(sizeof(tCpeRecDataBase), 0);
+    int count = 0;
+    for (int i = 0; i < header.dbHdr.dbCounts; i++)
+    {
+        uint32_t tag = header.dbEntry[i].tag;
+        uint32_t offset = header.dbEntry[i].offset;
+        uint32_t length = header.dbEntry[i].size;
+
+        header.dbEntry[count].tag = tag;
+        header.dbEntry[count].offset = rebuilt.size();
+        tRecMetaEntries::iterator itr = journaled.find(tag);
+        if (itr != journaled.end())
+        {
+            rebuilt.insert(rebuilt.end(), itr->second.begin(), itr->second.end());
+            journaled.erase(itr);
+        }
+        else if ((offset <= db.size()) && (length <= db.size() - offset))
+        {
+            rebuilt.insert(rebuilt.end(), db.begin() + offset, db.begin() + offset + length);
+        }
+        else
+        {
+            LOG(DLOGL_ERROR, "%s: tag 0x%x offset 0x%x size %d past the end", metadataFile.c_str(), tag, offset, length);
+            return -1;
+        }
+        header.dbEntry[count].size = rebuilt.size() - header.dbEntry[count].offset;
+        count++;
+    }
+    for (tRecMetaEntries::iterator itr = journaled.begin(); itr != journaled.end(); ++itr)
+    {
+        if (count >= kCpeRec_DataBaseEntries)
+        {
+            LOG(DLOGL_ERROR, "%s: no entry left for tag 0x%x", metadataFile.c_str(), itr->first);
+            break;
+        }
+        header.dbEntry[count].tag = itr->first;
+        header.dbEntry[count].offset = rebuilt.size();
+        header.dbEntry[count].size = itr->second.size();
+        rebuilt.insert(rebuilt.end(), itr->second.begin(), itr->second.end());
+        count++;
+    }
+
+    // the checksum stays the one of the base, the readers do not check it
+    header.dbHdr.dbCounts = count;
+    header.dbHdr.size = rebuilt.size();
+    memcpy(&rebuilt[0], &header, sizeof(header));
+    db.swap(rebuilt);
+    return records;
+}
+
+bool RecordMetadataJournal::append(uint32_t tag, const std::vector<uint8_t> &data)
+{
+    if (mFd < 0)
+    {
+        mFd = open(mJournal.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+        if (mFd < 0)
+        {
+            LOG(DLOGL_ERROR, "%s: open: %m", mJournal.c_str());
+            return false;
+        }
+    }
+
+    tRecord record;
+    record.magic = kRecMetaJournalMagic;
+    record.tag = tag;
+    record.size = data.size();
+    record.seq = mSeq;
+    record.crc = recordCrc(record, data.empty() ? NULL : &data[0]);
+
+    // one write per record, a crash cuts at most the last one
+    std::vector<uint8_t> buf(sizeof(record) + data.size());
+    memcpy(&buf[0], &record, sizeof(record));
+    if (!data.empty())
+    {
+        memcpy(&buf[sizeof(record)], &data[0], data.size());
+    }
+    ssize_t written = write(mFd, &buf[0], buf.size());
+    if (written != (ssize_t) buf.size())
+    {
+        LOG(DLOGL_ERROR, "%s: write %d of %d: %m", mJournal.c_str(), (int) written, (int) buf.size());
+        return false;
+    }
+
+    mSeq++;
+    mJournalSize += buf.size();
+    mStats.appends++;
+    mStats.journalBytes += buf.size();
+    return true;
+}
+
+bool RecordMetadataJournal::update(const tRecMetaEntries &entries, uint32_t cci)
+{
+    bool changed = false;
+    bool needBase = !mHaveBase || mBasePending || (cci != mCci);
+
+    mStats.writes++;
+
+    // entries the platform reads, and removed ones, are only in the base
+    for (tRecMetaEntries::const_iterator itr = entries.begin(); itr != entries.end(); ++itr)
+    {
+        tRecMetaEntries::iterator written = mWritten.find(itr->first);
+        if (!(mJournaling && isJournaled(itr->first)) && ((written == mWritten.end()) || (written->second != itr->second)))
+        {
+            needBase = true;
+        }
+    }
+    for (tRecMetaEntries::iterator itr = mWritten.begin(); itr != mWritten.end(); ++itr)
+    {
+        if (entries.find(itr->first) == entries.end())
+        {
+            needBase = true;
+        }
+    }
+
+    // the journal gets the changes even before a base while it has records, so it is never older
+    for (tRecMetaEntries::const_iterator itr = entries.begin(); itr != entries.end(); ++itr)
+    {
+        tRecMetaEntries::iterator written = mWritten.find(itr->first);
+        if ((written != mWritten.end()) && (written->second == itr->second))
+        {
+            continue;
+        }
+        changed = true;
+        mStats.changedBytes += itr->second.size();
+        if (mJournaling && isJournaled(itr->first) && mHaveBase && (!needBase || (mJournalSize > 0)))
+        {
+            if (!append(itr->first, itr->second))
+            {
+                needBase = true;
+            }
+        }
+    }
+
+    uint64_t limit = (uint64_t) mBaseSize * kRecMetaJournalCompactRatio;
+    if (mJournalSize >= ((limit > kRecMetaJournalMinCompactBytes) ? limit : kRecMetaJournalMinCompactBytes))
+    {
+        needBase = true;
+    }
+
+    if (!changed && !needBase)
+    {
+        mStats.unchanged++;
+    }
+    mWritten = entries;
+    mCci = cci;
+    mBasePending = needBase;
+    return needBase;
+}
+
+void RecordMetadataJournal::baseWritten(uint32_t size)
+{
+    mHaveBase = true;
+    mBasePending = false;
+    mBaseSize = size;
+    mStats.compactions++;
+    mStats.baseBytes += size;
+
+    if (mFd >= 0)
+    {
+        close(mFd);
+        mFd = -1;
+    }
+    if (mJournalSize > 0)
+    {
+        if ((unlink(mJournal.c_str()) != 0) && (errno != ENOENT))
+        {
+            LOG(DLOGL_ERROR, "%s: unlink: %m", mJournal.c_str());
+        }
+        mJournalSize = 0;
+    }
+}
+
+void RecordMetadataJournal::logStats(void)
+{
+    LOG(DLOGL_NORMAL, "%s writes:%d unchanged:%d appends:%d compactions:%d bytes changed:%llu journal:%llu base:%llu",
+        mFile.c_str(), mStats.writes, mStats.unchanged, mStats.appends, mStats.compactions,
+        (unsigned long long) mStats.changedBytes, (unsigned long long) mStats.journalBytes,
+        (unsigned long long) mStats.baseBytes);
+}
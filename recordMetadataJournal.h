@@ -0,0 +1,136 @@
+/**
+   \file recordMetadataJournal.h
+   \class RecordMetadataJournal
+
+   Append-only journal of the metadata of a recording or TSB.
+
+   MSPRecordSession used to rewrite the whole metadata database of the file
+   with cpe_record_WriteMetaData() on every CA blob, CA descriptor or CCI
+   update, on the drive that is recording, even when nothing changed.  The
+   database written by the platform is the base; a journal made with
+   journaling on appends the CA blob and CA descriptor to
+   "<metadata file>.mdj" when they change:
+
+    - update() is given the whole metadata set of each write.  It appends the
+      journaled entries that changed and tells whether the base must be
+      written: on the first write of the file, when an entry the platform
+      reads or the CCI changed, or when the journal passed
+      kRecMetaJournalCompactRatio times the base (compaction),
+    - baseWritten() removes the journal once the base is written.  The
+      changed entries are appended before the base is written, so a journal
+      left by a crash in between never holds older entries than the base,
+    - apply() is used by the readers of the metadata files: it replays the
+      journal of a file over its database, the last record of a tag wins and
+      a record cut by a crash ends the replay.
+
+   The platform reads the base only, the TSB conversion copies it into the
+   recording: MSPRecordSession writes the base of the files with a journal
+   before it starts a conversion and when the recording stops.
+*/
+
+#if !defined(RECORD_METADATA_JOURNAL_H)
+#define RECORD_METADATA_JOURNAL_H
+
+#include <stdint.h>
+#include <string>
+#include <map>
+#include <vector>
+#include <sys/stat.h>
+
+#define kRecMetaJournalSuffix           ".mdj"
+#define kRecMetaJournalMagic            0x4D444A52      ///< "MDJR"
+#define kRecMetaJournalMinCompactBytes  (16 * 1024)     ///< journal always allowed to grow this far
+#define kRecMetaJournalCompactRatio     4               ///< compaction once the journal is this many bases
+
+/// Metadata entries by tag
+typedef std::map<uint32_t, std::vector<uint8_t> > tRecMetaEntries;
+
+typedef struct
+{
+    unsigned int writes;            ///< update() calls
+    unsigned int unchanged;         ///< writes with nothing to write
+    unsigned int appends;           ///< records appended
+    unsigned int compactions;       ///< bases written
+    uint64_t     changedBytes;      ///< payload of the entries that changed
+    uint64_t     journalBytes;      ///< written to the journal
+    uint64_t     baseBytes;         ///< written to the base
+} tRecMetaJournalStats;
+
+class RecordMetadataJournal
+{
+public:
+    /// Without journaling update() asks for the base on every change
+    RecordMetadataJournal(const std::string &metadataFile, bool journaling);
+    ~RecordMetadataJournal();
+
+    static std::string journalFile(const std::string &metadataFile);
+    /// Modification time of st in nanoseconds, the stamp the indexes compare
+    static int64_t mtimeNs(const struct stat &st);
+    /// Folds the journal of metadataFile, when it has one, into the stamp of
+    /// the file: the later mtimeNs(), the journal size in the upper half of size
+    static bool addStamp(const std::string &metadataFile, int64_t *mtime, int64_t *size);
+    /// True for the tags a journal made with journaling on appends
+    static bool isJournaled(uint32_t tag);
+
+    /// Entries of a metadata database of size bytes
+    static bool toEntries(const uint8_t *db, uint32_t size, tRecMetaEntries &entries);
+    /// Database of the entries, all but the checksum of the header filled in
+    static void toDatabase(const tRecMetaEntries &entries, uint32_t cci, std::vector<uint8_t> &db);
+    /// Replays the journal of metadataFile over its database db.  Returns the
+    /// records applied, 0 without journal, -1 when db is not a database
+    static int apply(const std::string &metadataFile, std::vector<uint8_t> &db);
+
+    /// Appends the changed journaled entries of the set, true when the base must be written
+    bool update(const tRecMetaEntries &entries, uint32_t cci);
+    /// The base was written with the last set given to update()
+    void baseWritten(uint32_t size);
+    /// Last set given to update(), to write the base when compacting on close
+    void getWritten(tRecMetaEntries &entries, uint32_t *cci) const
+    {
+        entries = mWritten;
+        *cci = mCci;
+    }
+    /// Records in the journal that the base does not have
+    bool hasJournal(void) const
+    {
+        return mJournalSize > 0;
+    }
+
+    void getStats(tRecMetaJournalStats *stats) const
+    {
+        *stats = mStats;
+    }
+    void logStats(void);
+
+private:
+    typedef struct
+    {
+        uint32_t magic;
+        uint32_t tag;
+        uint32_t size;
+        uint32_t seq;
+        uint32_t crc;       ///< of tag, size, seq and the data
+    } tRecord;
+
+    static uint32_t recordCrc(const tRecord &record, const uint8_t *data);
+    static void replay(const std::string &journal, tRecMetaEntries &entries, int *records);
+    bool append(uint32_t tag, const std::vector<uint8_t> &data);
+
+    std::string     mFile;
+    std::string     mJournal;
+    bool            mJournaling;
+    int             mFd;
+    bool            mHaveBase;          ///< mWritten is in the base
+    bool            mBasePending;       ///< base to write with the last set
+    uint32_t        mCci;
+    uint32_t        mBaseSize;
+    uint64_t        mJournalSize;
+    uint32_t        mSeq;
+    tRecMetaEntries mWritten;           ///< last set in the base or the journal
+    tRecMetaJournalStats mStats;
+
+    RecordMetadataJournal(const RecordMetadataJournal&);
+    RecordMetadataJournal& operator=(const RecordMetadataJournal&);
+};
+
+#endif
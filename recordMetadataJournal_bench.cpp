@@ -0,0 +1,172 @@
+/** @file recordMetadataJournal_bench.cpp
+ *
+ * @brief Measures the metadata writes of a record session with and without the journal.
+ *
+ * A 3 hour TSB is simulated in a directory (argument 1, /tmp by default): the
+ * CA blob (2KB) changes every 10 seconds, as on a channel with a short key
+ * period, and the PMT, hence the PID table, every 15 minutes.  The same
+ * sequence is written twice:
+ *  - rewriting the whole database on each update, what writeAllMetaData()
+ *    did before the journal,
+ *  - through RecordMetadataJournal, the base being written only when
+ *    update() asks for it.
+ * For both the bytes written, the write amplification (bytes written for
+ * each byte of metadata that changed) and the time are printed, then the
+ * time to read the metadata back with the journal applied.  The base is
+ * written with fopen()/fwrite() here, cpe_record_WriteMetaData() also
+ * rewrites the whole file.
+ * Build with "make recordMetadataJournal_bench" and run on the target.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+
+#include <cpe_recmgr.h>
+
+#include "recordingPsiIndex.h"
+#include "recordMetadataJournal.h"
+
+#define kBenchDurationSecs    (3 * 3600)
+#define kBenchCaPeriodSecs    10
+#define kBenchPmtPeriodSecs   (15 * 60)
+#define kBenchCaBlobSize      2048
+#define kBenchReads           1000
+
+static double nowSecs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+// metadata set of the session at second t
+static void makeEntries(tRecMetaEntries &entries, int t)
+{
+    int pmtVersion = t / kBenchPmtPeriodSecs;
+    int caVersion = t / kBenchCaPeriodSecs;
+
+    entries[kCpeRec_PIDTableTag].assign(sizeof(tCpeRecDataBasePidTable), (uint8_t) pmtVersion);
+    std::vector<uint8_t> &blob = entries[kRecMetaTag_CaBlob];
+    blob.resize(kBenchCaBlobSize);
+    for (unsigned int i = 0; i < blob.size(); i++)
+    {
+        blob[i] = (uint8_t)(caVersion * 31 + i);
+    }
+    entries[kRecMetaTag_CaDescriptor].assign(12, (uint8_t) pmtVersion);
+    entries[kRecMetaTag_CaptionService].assign(8, 0x86);
+}
+
+static bool writeFile(const std::string &file, const std::vector<uint8_t> &db)
+{
+    FILE *fp = fopen(file.c_str(), "wb");
+    if (fp == NULL)
+    {
+        return false;
+    }
+    bool ok = (fwrite(&db[0], db.size(), 1, fp) == 1);
+    return (fclose(fp) == 0) && ok;
+}
+
+static off_t fileSize(const std::string &file)
+{
+    struct stat st;
+    return (stat(file.c_str(), &st) == 0) ? st.st_size : 0;
+}
+
+int main(int argc, char **argv)
+{
+    std::string dir = (argc > 1) ? argv[1] : "/tmp";
+    std::string fullFile = dir + "/mdjBenchFull";
+    std::string journalFile = dir + "/mdjBenchJournal";
+    tRecMetaEntries entries;
+    tRecMetaEntries previous;
+    std::vector<uint8_t> db;
+    uint64_t changedBytes = 0;
+    uint64_t fullBytes = 0;
+    unsigned int updates = 0;
+
+    // full rewrites
+    double start = nowSecs();
+    for (int t = 0; t < kBenchDurationSecs; t += kBenchCaPeriodSecs)
+    {
+        makeEntries(entries, t);
+        for (tRecMetaEntries::iterator itr = entries.begin(); itr != entries.end(); ++itr)
+        {
+            if (previous[itr->first] != itr->second)
+            {
+                changedBytes += itr->second.size();
+            }
+        }
+        previous = entries;
+        RecordMetadataJournal::toDatabase(entries, 0, db);
+        if (!writeFile(fullFile, db))
+        {
+            printf("error writing %s\n", fullFile.c_str());
+            return 1;
+        }
+        fullBytes += db.size();
+        updates++;
+    }
+    double fullSecs = nowSecs() - start;
+
+    // journal
+    tRecMetaJournalStats stats;
+    start = nowSecs();
+    {
+        RecordMetadataJournal journal(journalFile, true);
+        for (int t = 0; t < kBenchDurationSecs; t += kBenchCaPeriodSecs)
+        {
+            makeEntries(entries, t);
+            if (journal.update(entries, 0))
+            {
+                RecordMetadataJournal::toDatabase(entries, 0, db);
+                if (!writeFile(journalFile, db))
+                {
+                    printf("error writing %s\n", journalFile.c_str());
+                    return 1;
+                }
+                journal.baseWritten(db.size());
+            }
+        }
+        journal.getStats(&stats);
+    }
+    double journalSecs = nowSecs() - start;
+    uint64_t journalBytes = stats.journalBytes + stats.baseBytes;
+
+    printf("%u updates over %d s, %llu bytes of metadata changed\n", updates, kBenchDurationSecs,
+           (unsigned long long) changedBytes);
+    printf("full rewrites: %10llu bytes  amplification %5.2f  %8.3f ms\n",
+           (unsigned long long) fullBytes, (double) fullBytes / changedBytes, fullSecs * 1000);
+    printf("journal:       %10llu bytes  amplification %5.2f  %8.3f ms  (%u appends, %u bases)\n",
+           (unsigned long long) journalBytes, (double) journalBytes / changedBytes, journalSecs * 1000,
+           stats.appends, stats.compactions);
+    printf("left on disk:  base %lld bytes, journal %lld bytes\n",
+           (long long) fileSize(journalFile), (long long) fileSize(RecordMetadataJournal::journalFile(journalFile)));
+
+    // what ReadMrdvrMetaData() does now
+    start = nowSecs();
+    for (int i = 0; i < kBenchReads; i++)
+    {
+        db.resize(fileSize(journalFile));
+        FILE *fp = fopen(journalFile.c_str(), "rb");
+        if ((fp == NULL) || (fread(&db[0], db.size(), 1, fp) != 1))
+        {
+            printf("error reading %s\n", journalFile.c_str());
+            return 1;
+        }
+        fclose(fp);
+        RecordMetadataJournal::apply(journalFile, db);
+    }
+    printf("read with the journal applied: %.3f ms each\n", (nowSecs() - start) * 1000 / kBenchReads);
+
+    unlink(fullFile.c_str());
+    unlink(journalFile.c_str());
+    unlink(RecordMetadataJournal::journalFile(journalFile).c_str());
+    return 0;
+}
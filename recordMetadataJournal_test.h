@@ -0,0 +1,256 @@
+/**
+
+\file recordMetadataJournal_test.h -- contains the cxxtest test cases for the metadata journal
+
+The metadata file is written by the test the way cpe_record_WriteMetaData()
+would, whenever update() asks for the base.
+*/
+
+#if !defined(RECORD_METADATA_JOURNAL_TEST_H)
+#define RECORD_METADATA_JOURNAL_TEST_H
+
+#include <cxxtest/TestSuite.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <cpe_recmgr.h>
+
+#include "recordingPsiIndex.h"
+#include "recordMetadataJournal.h"
+
+class recordMetadataJournalTestSuite : public CxxTest::TestSuite
+{
+    char mDir[32];
+    std::string mFile;
+
+    static std::vector<uint8_t> entry(uint8_t value, uint32_t size)
+    {
+        return std::vector<uint8_t>(size, value);
+    }
+
+    void writeBase(RecordMetadataJournal &journal, const tRecMetaEntries &entries, uint32_t cci)
+    {
+        std::vector<uint8_t> db;
+        RecordMetadataJournal::toDatabase(entries, cci, db);
+        FILE *fp = fopen(mFile.c_str(), "wb");
+        TS_ASSERT(fp != NULL);
+        fwrite(&db[0], db.size(), 1, fp);
+        fclose(fp);
+        journal.baseWritten(db.size());
+    }
+
+    // what ReadMrdvrMetaData() returns
+    tRecMetaEntries readBack(uint32_t *cci)
+    {
+        std::vector<uint8_t> db;
+        tRecMetaEntries entries;
+        struct stat st;
+
+        TS_ASSERT_EQUALS(stat(mFile.c_str(), &st), 0);
+        db.resize(st.st_size);
+        FILE *fp = fopen(mFile.c_str(), "rb");
+        TS_ASSERT_EQUALS(fread(&db[0], db.size(), 1, fp), 1u);
+        fclose(fp);
+
+        TS_ASSERT(RecordMetadataJournal::apply(mFile, db) >= 0);
+        TS_ASSERT(RecordMetadataJournal::toEntries(&db[0], db.size(), entries));
+        TS_ASSERT_EQUALS(((tCpeRecDataBase *) &db[0])->dbHdr.size, db.size());
+        *cci = ((tCpeRecDataBase *) &db[0])->dbHdr.CCI;
+        return entries;
+    }
+
+    static off_t fileSize(const std::string &path)
+    {
+        struct stat st;
+        return (stat(path.c_str(), &st) == 0) ? st.st_size : -1;
+    }
+
+public:
+
+    void setUp()
+    {
+        strcpy(mDir, "/tmp/recMetaXXXXXX");
+        TS_ASSERT(mkdtemp(mDir) != NULL);
+        mFile = std::string(mDir) + "/dvr001";
+    }
+
+    void tearDown()
+    {
+        std::string cmd = std::string("rm -rf ") + mDir;
+        TS_ASSERT_EQUALS(system(cmd.c_str()), 0);
+    }
+
+    void testCaUpdatesAppended()
+    {
+        RecordMetadataJournal journal(mFile, true);
+        tRecMetaEntries entries;
+        tRecMetaJournalStats stats;
+        uint32_t cci;
+
+        entries[kCpeRec_PIDTableTag] = entry(1, 100);
+        entries[kRecMetaTag_CaBlob] = entry(2, 2048);
+        TS_ASSERT(journal.update(entries, 3));
+        writeBase(journal, entries, 3);
+        TS_ASSERT(!journal.hasJournal());
+
+        // nothing changed
+        TS_ASSERT(!journal.update(entries, 3));
+
+        entries[kRecMetaTag_CaBlob] = entry(3, 2048);
+        entries[kRecMetaTag_CaDescriptor] = entry(4, 20);
+        TS_ASSERT(!journal.update(entries, 3));
+        TS_ASSERT(journal.hasJournal());
+        entries[kRecMetaTag_CaBlob] = entry(5, 1000);
+        TS_ASSERT(!journal.update(entries, 3));
+
+        TS_ASSERT(readBack(&cci) == entries);
+        TS_ASSERT_EQUALS(cci, 3u);
+
+        journal.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.writes, 4u);
+        TS_ASSERT_EQUALS(stats.unchanged, 1u);
+        TS_ASSERT_EQUALS(stats.appends, 3u);
+        TS_ASSERT_EQUALS(stats.compactions, 1u);
+    }
+
+    void testWithoutJournaling()
+    {
+        RecordMetadataJournal journal(mFile, false);
+        tRecMetaEntries entries;
+        tRecMetaJournalStats stats;
+        uint32_t cci;
+
+        entries[kCpeRec_PIDTableTag] = entry(1, 100);
+        entries[kRecMetaTag_CaBlob] = entry(2, 2048);
+        TS_ASSERT(journal.update(entries, 3));
+        writeBase(journal, entries, 3);
+
+        // what the record session does: CA updates go to the base, the rest is skipped
+        TS_ASSERT(!journal.update(entries, 3));
+        entries[kRecMetaTag_CaBlob] = entry(3, 2048);
+        TS_ASSERT(journal.update(entries, 3));
+        writeBase(journal, entries, 3);
+        entries[kRecMetaTag_CaDescriptor] = entry(4, 20);
+        TS_ASSERT(journal.update(entries, 3));
+        writeBase(journal, entries, 3);
+
+        TS_ASSERT(!journal.hasJournal());
+        TS_ASSERT_EQUALS(fileSize(RecordMetadataJournal::journalFile(mFile)), -1);
+        TS_ASSERT(readBack(&cci) == entries);
+
+        journal.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.unchanged, 1u);
+        TS_ASSERT_EQUALS(stats.appends, 0u);
+        TS_ASSERT_EQUALS(stats.compactions, 3u);
+    }
+
+    void testPlatformEntriesRewriteBase()
+    {
+        RecordMetadataJournal journal(mFile, true);
+        tRecMetaEntries entries;
+        uint32_t cci;
+
+        entries[kCpeRec_PIDTableTag] = entry(1, 100);
+        entries[kRecMetaTag_CaBlob] = entry(2, 2048);
+        journal.update(entries, 0);
+        writeBase(journal, entries, 0);
+        entries[kRecMetaTag_CaBlob] = entry(3, 2048);
+        journal.update(entries, 0);
+
+        // new PMT: the CA blob goes to the journal too, then the base
+        entries[kRecMetaTag_CaBlob] = entry(4, 2048);
+        entries[kCpeRec_PIDTableTag] = entry(5, 120);
+        TS_ASSERT(journal.update(entries, 0));
+        TS_ASSERT(readBack(&cci)[kRecMetaTag_CaBlob] == entries[kRecMetaTag_CaBlob]);
+        writeBase(journal, entries, 0);
+        TS_ASSERT(!journal.hasJournal());
+        TS_ASSERT_EQUALS(fileSize(RecordMetadataJournal::journalFile(mFile)), -1);
+
+        // CCI and a removed entry
+        TS_ASSERT(journal.update(entries, 2));
+        writeBase(journal, entries, 2);
+        entries.erase(kRecMetaTag_CaBlob);
+        TS_ASSERT(journal.update(entries, 2));
+        writeBase(journal, entries, 2);
+        TS_ASSERT(readBack(&cci) == entries);
+        TS_ASSERT_EQUALS(cci, 2u);
+    }
+
+    void testCompaction()
+    {
+        RecordMetadataJournal journal(mFile, true);
+        tRecMetaEntries entries;
+        tRecMetaJournalStats stats;
+        uint32_t cci;
+        int appends = 0;
+
+        entries[kCpeRec_PIDTableTag] = entry(1, 100);
+        entries[kRecMetaTag_CaBlob] = entry(0, 2048);
+        journal.update(entries, 0);
+        writeBase(journal, entries, 0);
+
+        // the base is about 2.3KB: compacted once the journal passes 16KB
+        while (!journal.update(entries, 0))
+        {
+            entries[kRecMetaTag_CaBlob] = entry(++appends, 2048);
+        }
+        TS_ASSERT_EQUALS(appends, 8);
+        TS_ASSERT(readBack(&cci) == entries);
+        writeBase(journal, entries, 0);
+        TS_ASSERT(readBack(&cci) == entries);
+
+        journal.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.compactions, 2u);
+        TS_ASSERT_EQUALS(stats.appends, 8u);
+    }
+
+    void testBaseWriteFailed()
+    {
+        RecordMetadataJournal journal(mFile, true);
+        tRecMetaEntries entries;
+
+        entries[kCpeRec_PIDTableTag] = entry(1, 100);
+        entries[kRecMetaTag_CaBlob] = entry(2, 2048);
+        TS_ASSERT(journal.update(entries, 0));
+        // not written: asked again with the same set
+        TS_ASSERT(journal.update(entries, 0));
+        writeBase(journal, entries, 0);
+        TS_ASSERT(!journal.update(entries, 0));
+    }
+
+    void testTornRecordAndStaleJournal()
+    {
+        tRecMetaEntries entries;
+        tRecMetaEntries expected;
+        uint32_t cci;
+        std::string journalFile = RecordMetadataJournal::journalFile(mFile);
+
+        {
+            RecordMetadataJournal journal(mFile, true);
+            entries[kCpeRec_PIDTableTag] = entry(1, 100);
+            entries[kRecMetaTag_CaBlob] = entry(2, 2048);
+            journal.update(entries, 0);
+            writeBase(journal, entries, 0);
+            entries[kRecMetaTag_CaBlob] = entry(3, 2048);
+            journal.update(entries, 0);
+            expected = entries;
+            entries[kRecMetaTag_CaBlob] = entry(4, 2048);
+            journal.update(entries, 0);
+        }
+
+        // a crash cut the last record
+        off_t size = fileSize(journalFile);
+        TS_ASSERT_EQUALS(truncate(journalFile.c_str(), size - 100), 0);
+        TS_ASSERT(readBack(&cci) == expected);
+
+        // the file is reused by the next session
+        RecordMetadataJournal journal(mFile, true);
+        TS_ASSERT_EQUALS(fileSize(journalFile), -1);
+        TS_ASSERT(journal.update(expected, 0));
+    }
+};
+
+#endif
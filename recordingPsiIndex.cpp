@@ -0,0 +1,660 @@
+/**
+   \file recordingPsiIndex.cpp
+   \class RecordingPsiIndex
+
+Implementation file for the recorded file PSI index
+*/
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <dlog.h>
+#include <cpe_recmgr.h>
+
+#include "recordingPsiIndex.h"
+#include "pmt.h"
+#include "crc32.h"
+#include "recordMetadataJournal.h"
+#include "monotonicTime.h"
+
+#define LOG(level, msg, args...)  dlog(DL_MSP_PSI, level,"RecordingPsiIndex:%s:%d " msg, __FUNCTION__, __LINE__, ##args);
+
+#define kRecordingPsiIndexMagic    0x4D505349   ///< "MPSI"
+#define kRecordingPsiIndexVersion  2          ///< 2: mtime in nanoseconds
+
+RecordingPsiIndex* RecordingPsiIndex::mInstance = NULL;
+pthread_mutex_t RecordingPsiIndex::mInstanceMutex = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t RecordingPsiIndex::mScanMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void putBytes(std::vector<uint8_t> &buf, const void *data, uint32_t size)
+{
+    buf.insert(buf.end(), (const uint8_t *) data, (const uint8_t *) data + size);
+}
+
+static bool getBytes(const std::vector<uint8_t> &buf, uint32_t *pos, void *data, uint32_t size)
+{
+    if ((size > buf.size()) || (*pos > buf.size() - size))
+    {
+        return false;
+    }
+    memcpy(data, &buf[*pos], size);
+    *pos += size;
+    return true;
+}
+
+RecordingPsiIndex* RecordingPsiIndex::getInstance(void)
+{
+    pthread_mutex_lock(&mInstanceMutex);
+    if (mInstance == NULL)
+    {
+        mInstance = new RecordingPsiIndex();
+        mInstance->load(mInstance->mIndexFile.c_str());
+    }
+    pthread_mutex_unlock(&mInstanceMutex);
+    return mInstance;
+}
+
+RecordingPsiIndex::RecordingPsiIndex()
+{
+    pthread_condattr_t attr;
+
+    pthread_mutex_init(&mMutex, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&mSaveCond, &attr);
+    pthread_condattr_destroy(&attr);
+    mUseCount = 0;
+    mDirty = false;
+    mIndexFile = kRecordingPsiIndexFile;
+    mSaveThreadStarted = false;
+    mSaveDelayMs = kRecordingPsiIndexSaveDelayMs;
+    memset(&mStats, 0, sizeof(mStats));
+    mScanFiles = NULL;
+    mScanNext = 0;
+    mScanIndexed = 0;
+}
+
+// The index lives as long as the process, like the other MSP singletons
+RecordingPsiIndex::~RecordingPsiIndex()
+{
+    pthread_cond_destroy(&mSaveCond);
+    pthread_mutex_destroy(&mMutex);
+}
+
+bool RecordingPsiIndex::getFileStamp(const std::string &file, int64_t *mtime, int64_t *size)
+{
+    struct stat st;
+
+    if (stat(file.c_str(), &st) != 0)
+    {
+        return false;
+    }
+    *mtime = RecordMetadataJournal::mtimeNs(st);
+    *size = st.st_size;
+    RecordMetadataJournal::addStamp(file, mtime, size);
+    return true;
+}
+
+unsigned int RecordingPsiIndex::scanRecordings(const std::vector<std::string> &files, unsigned int threads)
+{
+    pthread_t tid[kRecordingPsiIndexMaxThreads];
+    unsigned int started = 0;
+
+    if (files.empty())
+    {
+        return 0;
+    }
+    if (threads > kRecordingPsiIndexMaxThreads)
+    {
+        threads = kRecordingPsiIndexMaxThreads;
+    }
+    if (threads > files.size())
+    {
+        threads = files.size();
+    }
+
+    // one scan at a time, the threads share the position in files
+    pthread_mutex_lock(&mScanMutex);
+    mScanFiles = &files;
+    mScanNext = 0;
+    mScanIndexed = 0;
+
+    // the calling thread is one of the scanners
+    for (unsigned int i = 1; i < threads; i++)
+    {
+        if (pthread_create(&tid[started], NULL, scanThread, (void *) this) != 0)
+        {
+            LOG(DLOGL_ERROR, "Error creating scan thread %d, going on with %d", i, started + 1);
+            break;
+        }
+        started++;
+    }
+    scanThread((void *) this);
+    for (unsigned int i = 0; i < started; i++)
+    {
+        pthread_join(tid[i], NULL);
+    }
+
+    unsigned int indexed = mScanIndexed;
+    mScanFiles = NULL;
+    pthread_mutex_unlock(&mScanMutex);
+
+    LOG(DLOGL_NORMAL, "%d recordings, %d indexed on %d threads", (int) files.size(), indexed, started + 1);
+
+    pthread_mutex_lock(&mMutex);
+    bool dirty = mDirty;
+    std::string indexFile = mIndexFile;
+    pthread_mutex_unlock(&mMutex);
+    if (dirty)
+    {
+        save(indexFile.c_str());
+    }
+    return indexed;
+}
+
+void* RecordingPsiIndex::scanThread(void *ctx)
+{
+    RecordingPsiIndex *index = (RecordingPsiIndex *) ctx;
+    const std::vector<std::string> &files = *index->mScanFiles;
+
+    for (;;)
+    {
+        unsigned int i = __sync_fetch_and_add(&index->mScanNext, 1);
+        if (i >= files.size())
+        {
+            break;
+        }
+
+        int64_t mtime, size;
+        if (!getFileStamp(files[i], &mtime, &size))
+        {
+            LOG(DLOGL_NOISE, "no file %s", files[i].c_str());
+            continue;
+        }
+
+        pthread_mutex_lock(&index->mMutex);
+        bool current = index->isCurrentLocked(files[i], mtime, size);
+        pthread_mutex_unlock(&index->mMutex);
+        if (current)
+        {
+            continue;
+        }
+
+        // read and parsed without the lock, lookups go on meanwhile
+        Entry entry;
+        if (readRecording(files[i], &entry) == kMspStatus_Ok)
+        {
+            pthread_mutex_lock(&index->mMutex);
+            index->mStats.filesRead++;
+            index->storeLocked(files[i], entry);
+            pthread_mutex_unlock(&index->mMutex);
+            __sync_fetch_and_add(&index->mScanIndexed, 1);
+        }
+    }
+    return NULL;
+}
+
+bool RecordingPsiIndex::lookup(const std::string &file, std::vector<uint8_t> &records)
+{
+    int64_t mtime, size;
+    bool hit = false;
+
+    bool exists = getFileStamp(file, &mtime, &size);
+
+    pthread_mutex_lock(&mMutex);
+    if (exists && isCurrentLocked(file, mtime, size))
+    {
+        Entry &entry = mEntries[file];
+        entry.lastUse = ++mUseCount;
+        records = entry.records;
+        hit = true;
+        mStats.hits++;
+    }
+    else
+    {
+        mStats.misses++;
+    }
+    pthread_mutex_unlock(&mMutex);
+
+    LOG(DLOGL_REALLY_NOISY, "%s: %s", file.c_str(), hit ? "hit" : "miss");
+    return hit;
+}
+
+eMspStatus RecordingPsiIndex::indexRecording(const std::string &file, std::vector<uint8_t> &records)
+{
+    Entry entry;
+
+    eMspStatus status = readRecording(file, &entry);
+    if (status != kMspStatus_Ok)
+    {
+        return status;
+    }
+    records = entry.records;
+
+    pthread_mutex_lock(&mMutex);
+    mStats.filesRead++;
+    storeLocked(file, entry);
+    pthread_mutex_unlock(&mMutex);
+    return kMspStatus_Ok;
+}
+
+bool RecordingPsiIndex::lookupPids(const std::string &file, tRecordingPids *pids)
+{
+    int64_t mtime, size;
+    bool hit = false;
+
+    bool exists = getFileStamp(file, &mtime, &size);
+
+    pthread_mutex_lock(&mMutex);
+    if (exists && isCurrentLocked(file, mtime, size))
+    {
+        Entry &entry = mEntries[file];
+        entry.lastUse = ++mUseCount;
+        *pids = entry.pids;
+        hit = true;
+        mStats.hits++;
+    }
+    else
+    {
+        mStats.misses++;
+    }
+    pthread_mutex_unlock(&mMutex);
+    return hit;
+}
+
+void RecordingPsiIndex::remove(const std::string &file)
+{
+    pthread_mutex_lock(&mMutex);
+    if (mEntries.erase(file))
+    {
+        changedLocked();
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+bool RecordingPsiIndex::nextEntry(std::vector<uint8_t> &records, uint32_t *pos, tRecordingMetaEntry *entry)
+{
+    uint32_t header[2];
+
+    if (!getBytes(records, pos, header, sizeof(header)))
+    {
+        return false;
+    }
+    uint32_t padded = (header[1] + 7) & ~7;
+    if ((padded < header[1]) || (padded > records.size() - *pos))
+    {
+        return false;
+    }
+
+    entry->tag = header[0];
+    entry->size = header[1];
+    entry->data = header[1] ? &records[*pos] : NULL;
+    *pos += padded;
+    return true;
+}
+
+eMspStatus RecordingPsiIndex::readRecording(const std::string &file, Entry *entry)
+{
+    FILE *fp = fopen(file.c_str(), "rb");
+    if (!fp)
+    {
+        LOG(DLOGL_ERROR, "error opening %s", file.c_str());
+        return kMspStatus_Error;
+    }
+
+    // the stamp is taken from the file read, a file replaced meanwhile is seen as changed later
+    struct stat st;
+    if ((fstat(fileno(fp), &st) != 0) || (st.st_size <= 0))
+    {
+        LOG(DLOGL_ERROR, "error: file: %s size: %d", file.c_str(), (int) st.st_size);
+        fclose(fp);
+        return kMspStatus_Error;
+    }
+    entry->mtime = RecordMetadataJournal::mtimeNs(st);
+    entry->size = st.st_size;
+    RecordMetadataJournal::addStamp(file, &entry->mtime, &entry->size);
+
+    // at least a whole database header, whatever the file holds
+    uint32_t metasize = st.st_size;
+    std::vector<uint8_t> buf((metasize > sizeof(tCpeRecDataBase)) ? metasize : sizeof(tCpeRecDataBase), 0);
+    size_t result = fread(&buf[0], 1, metasize, fp);
+    fclose(fp);
+    if (result != metasize)
+    {
+        LOG(DLOGL_ERROR, "error fread %s read %d bytes - expected %d", file.c_str(), (int) result, metasize);
+        return kMspStatus_Error;
+    }
+
+    tCpeRecDataBase *metabuf = (tCpeRecDataBase *) &buf[0];
+    if (metabuf->dbHdr.dbCounts > kCpeRec_DataBaseEntries)
+    {
+        LOG(DLOGL_ERROR, "Error %s dbCounts: %d > kCpeRec_DataBaseEntries", file.c_str(), metabuf->dbHdr.dbCounts);
+        return kMspStatus_Error;
+    }
+
+    // CA updates the record session appended after the database
+    if (RecordMetadataJournal::apply(file, buf) > 0)
+    {
+        metabuf = (tCpeRecDataBase *) &buf[0];
+        metasize = buf.size();
+    }
+
+    entry->records.clear();
+    for (int i = 0; i < metabuf->dbHdr.dbCounts; i++)
+    {
+        uint32_t header[2];
+        uint32_t offset = metabuf->dbEntry[i].offset;
+
+        header[0] = metabuf->dbEntry[i].tag;
+        header[1] = metabuf->dbEntry[i].size;
+
+        switch (header[0])
+        {
+        case kRecMetaTag_MspPmt:
+        case kRecMetaTag_SaraPmt:
+        case kRecMetaTag_CaBlob:
+        case kRecMetaTag_SaraCaBlob:
+        case kRecMetaTag_CaDescriptor:
+        case kRecMetaTag_CaptionService:
+            if ((offset > metasize) || (header[1] > metasize - offset))
+            {
+                LOG(DLOGL_ERROR, "Error %s tag 0x%x offset 0x%x size %d past the end", file.c_str(), header[0], offset, header[1]);
+                return kMspStatus_Error;
+            }
+            putBytes(entry->records, header, sizeof(header));
+            putBytes(entry->records, &buf[offset], header[1]);
+            entry->records.resize((entry->records.size() + 7) & ~7, 0);
+            break;
+
+        default:
+            LOG(DLOGL_ERROR, "warning: unknown metadata tag: 0x%x offset: 0x%x", header[0], offset);
+        }
+    }
+
+    summarize(entry);
+    return kMspStatus_Ok;
+}
+
+void RecordingPsiIndex::summarize(Entry *entry)
+{
+    Pmt pmt;
+    tRecordingMetaEntry meta;
+    uint32_t pos = 0;
+
+    memset(&entry->pids, 0, sizeof(entry->pids));
+    while (nextEntry(entry->records, &pos, &meta))
+    {
+        if (meta.tag == kRecMetaTag_MspPmt)
+        {
+            pmt.populateMSPMetaData(meta.data, meta.size);
+        }
+        else if (meta.tag == kRecMetaTag_SaraPmt)
+        {
+            pmt.populateFromSaraMetaData(meta.data, meta.size);
+        }
+    }
+
+    std::list<tPid> *videoList = pmt.getVideoPidList();
+    std::list<tPid> *audioList = pmt.getAudioPidList();
+    if (!videoList->empty())
+    {
+        entry->pids.videoPid = videoList->front().pid;
+        entry->pids.videoStreamType = videoList->front().streamType;
+    }
+    if (!audioList->empty())
+    {
+        entry->pids.audioPid = audioList->front().pid;
+        entry->pids.audioStreamType = audioList->front().streamType;
+        entry->pids.audioCount = audioList->size();
+    }
+}
+
+bool RecordingPsiIndex::isCurrentLocked(const std::string &file, int64_t mtime, int64_t size)
+{
+    std::map<std::string, Entry>::iterator iter = mEntries.find(file);
+    return (iter != mEntries.end()) && (iter->second.mtime == mtime) && (iter->second.size == size);
+}
+
+void RecordingPsiIndex::storeLocked(const std::string &file, Entry &entry)
+{
+    if ((mEntries.find(file) == mEntries.end()) && (mEntries.size() >= kRecordingPsiIndexMaxEntries))
+    {
+        std::map<std::string, Entry>::iterator oldest = mEntries.begin();
+        for (std::map<std::string, Entry>::iterator iter = mEntries.begin(); iter != mEntries.end(); iter++)
+        {
+            if (iter->second.lastUse < oldest->second.lastUse)
+            {
+                oldest = iter;
+            }
+        }
+        LOG(DLOGL_NOISE, "drop %s", oldest->first.c_str());
+        mEntries.erase(oldest);
+    }
+
+    Entry &stored = mEntries[file];
+    stored.mtime = entry.mtime;
+    stored.size = entry.size;
+    stored.pids = entry.pids;
+    stored.records.swap(entry.records);
+    stored.lastUse = ++mUseCount;
+    changedLocked();
+}
+
+void RecordingPsiIndex::changedLocked(void)
+{
+    mDirty = true;
+    if (!mSaveThreadStarted)
+    {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, saveThread, (void *) this) != 0)
+        {
+            LOG(DLOGL_ERROR, ":%m: Error creating the save thread, the index is saved by scans only");
+            return;
+        }
+        pthread_detach(thread);
+        mSaveThreadStarted = true;
+        if (pthread_setname_np(thread, "MSP PsiIndex") != 0)
+        {
+            LOG(DLOGL_ERROR, "ERROR: %m: Thread Setname Failed.");
+        }
+    }
+    pthread_cond_signal(&mSaveCond);
+}
+
+// Lives as long as the index: waits for a change, lets the ones that follow
+// it within mSaveDelayMs gather and saves them in one write
+void* RecordingPsiIndex::saveThread(void *ctx)
+{
+    RecordingPsiIndex *index = (RecordingPsiIndex *) ctx;
+    struct timespec deadline;
+
+    pthread_mutex_lock(&index->mMutex);
+    for (;;)
+    {
+        while (!index->mDirty)
+        {
+            pthread_cond_wait(&index->mSaveCond, &index->mMutex);
+        }
+
+        monotonicDeadlineIn(index->mSaveDelayMs, &deadline);
+        while (pthread_cond_timedwait(&index->mSaveCond, &index->mMutex, &deadline) != ETIMEDOUT)
+        {
+        }
+
+        // a scan may have saved it meanwhile
+        if (index->mDirty)
+        {
+            std::string indexFile = index->mIndexFile;
+            pthread_mutex_unlock(&index->mMutex);
+            index->save(indexFile.c_str());
+            pthread_mutex_lock(&index->mMutex);
+        }
+    }
+    return NULL;
+}
+
+/*
+   File layout, native byte order (the index never leaves the box):
+     magic, version, entry count                      3 x uint32_t
+     per entry: path length, path, mtime, size, pids, records length, records
+     CRC32/MPEG-2 of everything before it             uint32_t
+   It is written to a temporary file renamed over the index, so a crash
+   leaves the old index or the new one.
+*/
+eMspStatus RecordingPsiIndex::save(const char *path)
+{
+    std::vector<uint8_t> buf;
+    uint32_t word;
+
+    pthread_mutex_lock(&mMutex);
+    word = kRecordingPsiIndexMagic;
+    putBytes(buf, &word, sizeof(word));
+    word = kRecordingPsiIndexVersion;
+    putBytes(buf, &word, sizeof(word));
+    word = mEntries.size();
+    putBytes(buf, &word, sizeof(word));
+    for (std::map<std::string, Entry>::iterator iter = mEntries.begin(); iter != mEntries.end(); iter++)
+    {
+        word = iter->first.size();
+        putBytes(buf, &word, sizeof(word));
+        putBytes(buf, iter->first.data(), word);
+        putBytes(buf, &iter->second.mtime, sizeof(iter->second.mtime));
+        putBytes(buf, &iter->second.size, sizeof(iter->second.size));
+        putBytes(buf, &iter->second.pids, sizeof(iter->second.pids));
+        word = iter->second.records.size();
+        putBytes(buf, &word, sizeof(word));
+        if (word)
+        {
+            putBytes(buf, &iter->second.records[0], word);
+        }
+    }
+    mDirty = false;
+    pthread_mutex_unlock(&mMutex);
+
+    word = MSPCrc32::compute(0xFFFFFFFF, &buf[0], buf.size());
+    putBytes(buf, &word, sizeof(word));
+
+    std::string tmpPath = std::string(path) + ".tmp";
+    FILE *fp = fopen(tmpPath.c_str(), "wb");
+    if (!fp)
+    {
+        LOG(DLOGL_ERROR, "error opening %s", tmpPath.c_str());
+        return kMspStatus_Error;
+    }
+    bool written = (fwrite(&buf[0], 1, buf.size(), fp) == buf.size());
+    written = (fflush(fp) == 0) && written;
+    written = (fsync(fileno(fp)) == 0) && written;
+    fclose(fp);
+
+    if (!written || (rename(tmpPath.c_str(), path) != 0))
+    {
+        LOG(DLOGL_ERROR, "error writing %s", path);
+        unlink(tmpPath.c_str());
+        return kMspStatus_Error;
+    }
+
+    LOG(DLOGL_NOISE, "%s: %d bytes", path, (int) buf.size());
+    return kMspStatus_Ok;
+}
+
+eMspStatus RecordingPsiIndex::load(const char *path)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+    {
+        LOG(DLOGL_NOISE, "no index %s", path);
+        return kMspStatus_Error;
+    }
+
+    std::vector<uint8_t> buf;
+    uint8_t chunk[4096];
+    size_t result;
+    while ((result = fread(chunk, 1, sizeof(chunk), fp)) > 0)
+    {
+        putBytes(buf, chunk, result);
+    }
+    fclose(fp);
+
+    uint32_t word;
+    uint32_t crc = 0;
+    uint32_t pos = 0;
+    uint32_t count = 0;
+    if (buf.size() >= 4 * sizeof(uint32_t))
+    {
+        memcpy(&crc, &buf[buf.size() - sizeof(crc)], sizeof(crc));
+    }
+    if ((buf.size() < 4 * sizeof(uint32_t)) ||
+            (MSPCrc32::compute(0xFFFFFFFF, &buf[0], buf.size() - sizeof(crc)) != crc) ||
+            !getBytes(buf, &pos, &word, sizeof(word)) || (word != kRecordingPsiIndexMagic) ||
+            !getBytes(buf, &pos, &word, sizeof(word)) || (word != kRecordingPsiIndexVersion) ||
+            !getBytes(buf, &pos, &count, sizeof(count)))
+    {
+        LOG(DLOGL_ERROR, "%s is not a valid index, ignored", path);
+        return kMspStatus_Error;
+    }
+    buf.resize(buf.size() - sizeof(uint32_t));
+
+    std::map<std::string, Entry> entries;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t length;
+
+        if (!getBytes(buf, &pos, &length, sizeof(length)) || (length > buf.size() - pos))
+        {
+            LOG(DLOGL_ERROR, "%s truncated at entry %d, ignored", path, i);
+            return kMspStatus_Error;
+        }
+        Entry &entry = entries[std::string((const char *) &buf[pos], length)];
+        pos += length;
+
+        if (!getBytes(buf, &pos, &entry.mtime, sizeof(entry.mtime)) ||
+                !getBytes(buf, &pos, &entry.size, sizeof(entry.size)) ||
+                !getBytes(buf, &pos, &entry.pids, sizeof(entry.pids)) ||
+                !getBytes(buf, &pos, &length, sizeof(length)) || (length > buf.size() - pos))
+        {
+            LOG(DLOGL_ERROR, "%s truncated at entry %d, ignored", path, i);
+            return kMspStatus_Error;
+        }
+        entry.records.assign(buf.begin() + pos, buf.begin() + pos + length);
+        entry.lastUse = 0;
+        pos += length;
+    }
+
+    pthread_mutex_lock(&mMutex);
+    mEntries.swap(entries);
+    mDirty = false;
+    pthread_mutex_unlock(&mMutex);
+
+    LOG(DLOGL_NORMAL, "%s: %d recordings", path, count);
+    return kMspStatus_Ok;
+}
+
+void RecordingPsiIndex::setIndexFile(const char *path, uint32_t saveDelayMs)
+{
+    pthread_mutex_lock(&mMutex);
+    mIndexFile = path;
+    mSaveDelayMs = saveDelayMs;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void RecordingPsiIndex::flush(void)
+{
+    pthread_mutex_lock(&mMutex);
+    if (!mEntries.empty())
+    {
+        mEntries.clear();
+        changedLocked();
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+void RecordingPsiIndex::getStats(tRecordingPsiIndexStats *stats)
+{
+    pthread_mutex_lock(&mMutex);
+    *stats = mStats;
+    stats->entries = mEntries.size();
+    pthread_mutex_unlock(&mMutex);
+}
@@ -0,0 +1,158 @@
+/**
+   \file recordingPsiIndex.h
+   \class RecordingPsiIndex
+
+   Process wide index of the PSI metadata of recorded files, so a recording
+   is started or previewed without reading its metadata file again.
+
+   For each recording the index keeps the metadata entries Psi::psiStart()
+   uses (MSP/SARA PMT, CA blob and descriptor, caption service descriptor)
+   and a summary of its first video and audio PIDs.  An entry is only used
+   while the file has the modification time and size it was indexed with,
+   so a recording that was rewritten or replaced is read again; the
+   modification time is kept in nanoseconds, a rewrite of the same size
+   within a second is still seen.
+
+    - scanRecordings() indexes a list of recordings on several threads.  MSP
+      does not own the recording list and does not call it: it is there for
+      the owner of the list to index it in the background, ahead of the
+      first psiStart() of each recording,
+    - psiStart() of a recording looks the index up first and indexes the
+      file on a miss,
+    - the index is saved to and loaded from a file so it survives a reboot;
+      it is loaded on first use and saved at the end of a scan, by save(),
+      and by a save thread kRecordingPsiIndexSaveDelayMs after it changed
+      (a miss indexed by psiStart(), a recording deleted), so the misses
+      of a guide page go in one write.
+*/
+
+#if !defined(RECORDING_PSI_INDEX_H)
+#define RECORDING_PSI_INDEX_H
+
+#include <stdint.h>
+#include <string>
+#include <map>
+#include <vector>
+#include <pthread.h>
+#include <sys/types.h>
+
+#include "MspCommon.h"
+
+#define kRecordingPsiIndexFile        "/mnt/dvr0/.mspPsiIndex"
+#define kRecordingPsiIndexMaxEntries  2048   ///< recordings remembered, least recently used is dropped first
+#define kRecordingPsiIndexMaxThreads  8
+#define kRecordingPsiIndexSaveDelayMs 10000  ///< changes gathered before the save thread writes the index
+
+/// Metadata tags of a recording database that Psi uses
+#define kRecMetaTag_MspPmt            0x1FAB
+#define kRecMetaTag_SaraPmt           0x102
+#define kRecMetaTag_CaBlob            0x1FAC
+#define kRecMetaTag_SaraCaBlob        0x101
+#define kRecMetaTag_CaDescriptor      0x1FAD
+#define kRecMetaTag_CaptionService    0x1FAE
+
+/**
+   First video and audio components of a recording, 0 when there is none
+*/
+typedef struct
+{
+    uint16_t videoPid;
+    uint16_t videoStreamType;
+    uint16_t audioPid;
+    uint16_t audioStreamType;
+    uint16_t audioCount;
+} tRecordingPids;
+
+/**
+   One metadata entry of a recording: a view into the records returned by lookup()
+*/
+typedef struct
+{
+    uint32_t tag;
+    uint32_t size;
+    uint8_t *data;
+} tRecordingMetaEntry;
+
+typedef struct
+{
+    unsigned int hits;
+    unsigned int misses;       ///< not indexed or file changed since
+    unsigned int entries;
+    unsigned int filesRead;    ///< metadata files read by scans and misses
+} tRecordingPsiIndexStats;
+
+class RecordingPsiIndex
+{
+public:
+    static RecordingPsiIndex* getInstance(void);
+
+    /// Index the recordings that are not indexed yet on up to threads threads, returns the number indexed
+    unsigned int scanRecordings(const std::vector<std::string> &files, unsigned int threads);
+
+    /// Copies the metadata records of file into records, false when it is not indexed or changed since
+    bool lookup(const std::string &file, std::vector<uint8_t> &records);
+    /// Reads file and indexes it, records gets its metadata records as with lookup()
+    eMspStatus indexRecording(const std::string &file, std::vector<uint8_t> &records);
+    /// Video and audio PIDs of file, false when it is not indexed or changed since
+    bool lookupPids(const std::string &file, tRecordingPids *pids);
+    /// Forget a recording, e.g. when it is deleted
+    void remove(const std::string &file);
+
+    /// Walks records, returns false at the end.  *pos starts at 0
+    static bool nextEntry(std::vector<uint8_t> &records, uint32_t *pos, tRecordingMetaEntry *entry);
+
+    eMspStatus load(const char *path);
+    eMspStatus save(const char *path);
+    /// Where scanRecordings() and the save thread save the index, kRecordingPsiIndexFile by default
+    void setIndexFile(const char *path, uint32_t saveDelayMs = kRecordingPsiIndexSaveDelayMs);
+
+    void flush(void);
+    void getStats(tRecordingPsiIndexStats *stats);
+
+private:
+    struct Entry
+    {
+        int64_t              mtime;        // nanoseconds, see RecordMetadataJournal::mtimeNs()
+        int64_t              size;
+        tRecordingPids       pids;
+        std::vector<uint8_t> records;
+        unsigned int         lastUse;
+    };
+
+    RecordingPsiIndex();
+    ~RecordingPsiIndex();
+
+    static void* scanThread(void *ctx);
+    static void* saveThread(void *ctx);
+    static bool getFileStamp(const std::string &file, int64_t *mtime, int64_t *size);
+    static eMspStatus readRecording(const std::string &file, Entry *entry);
+    static void summarize(Entry *entry);
+
+    bool isCurrentLocked(const std::string &file, int64_t mtime, int64_t size);
+    void storeLocked(const std::string &file, Entry &entry);
+    void changedLocked(void);
+
+    pthread_mutex_t mMutex;
+    std::map<std::string, Entry> mEntries;
+    unsigned int    mUseCount;         // lastUse clock for the LRU
+    bool            mDirty;            // changed since loaded or saved
+    std::string     mIndexFile;
+    pthread_cond_t  mSaveCond;         // CLOCK_MONOTONIC, wakes the save thread
+    bool            mSaveThreadStarted;
+    uint32_t        mSaveDelayMs;
+    tRecordingPsiIndexStats mStats;
+
+    // scan in progress, shared by the scan threads
+    const std::vector<std::string> *mScanFiles;
+    unsigned int    mScanNext;
+    unsigned int    mScanIndexed;
+
+    static RecordingPsiIndex *mInstance;
+    static pthread_mutex_t mInstanceMutex;
+    static pthread_mutex_t mScanMutex;
+
+    RecordingPsiIndex(const RecordingPsiIndex&);
+    RecordingPsiIndex& operator=(const RecordingPsiIndex&);
+};
+
+#endif
@@ -0,0 +1,244 @@
+/** @file recordingPsiIndex_bench.cpp
+ *
+ * @brief Measures RecordingPsiIndex on a synthetic library of recordings.
+ *
+ * 500 metadata files are written to a directory (argument 1, /tmp by
+ * default), each with an MSP PMT, a CA blob, a CA descriptor and a caption
+ * service descriptor like a recording made by this code.  The benchmark then
+ * times:
+ *  - reading every file one after the other, what psiStart() of each
+ *    recording did before the index,
+ *  - a batch scan of the library on 1 to 8 threads,
+ *  - looking every recording up in the index, its metadata and its PIDs,
+ *  - saving the index and loading it back, as across a reboot.
+ * The files are in the page cache after they are written; on the target,
+ * run it again after "echo 3 > /proc/sys/vm/drop_caches" between the
+ * phases for numbers with a cold disk.
+ * Build with "make recordingPsiIndex_bench" and run on the target.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <string>
+#include <vector>
+
+#include <cpe_recmgr.h>
+#include <cpe_programhandle.h>
+
+#include "recordingPsiIndex.h"
+
+#define kBenchRecordings   500
+#define kBenchCaBlobSize   2048
+
+static double nowSecs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+static void putBytes(std::vector<uint8_t> &buf, const void *data, uint32_t size)
+{
+    buf.insert(buf.end(), (const uint8_t *) data, (const uint8_t *) data + size);
+}
+
+// MSP PMT metadata as recorded: the PMT header, its descriptors, then each ES and its descriptors
+static void makeMspPmt(std::vector<uint8_t> &pmt, uint16_t videoPid)
+{
+    tCpePgrmHandlePmt header;
+    tCpePgrmHandleMpegDesc desc;
+    tCpePgrmHandleEsData es;
+    static const uint8_t language[] = { 'e', 'n', 'g', 0 };
+
+    memset(&header, 0, sizeof(header));
+    header.clockPid = videoPid;
+    header.pgmDescCount = 1;
+    header.esCount = 3;
+    putBytes(pmt, &header, sizeof(header));
+
+    memset(&desc, 0, sizeof(desc));
+    desc.tag = 0x09;
+    desc.dataLen = 4;
+    putBytes(pmt, &desc, sizeof(desc));
+    putBytes(pmt, "\x0e\x00\xe0\x40", 4);
+
+    for (int i = 0; i < 3; i++)
+    {
+        memset(&es, 0, sizeof(es));
+        es.streamType = (i == 0) ? kCpeStreamType_H264_Video : kCpeStreamType_GI_Audio;
+        es.pid = videoPid + i;
+        es.descCount = (i == 0) ? 0 : 1;
+        es.ppEsDesc = (i == 0) ? NULL : (tCpePgrmHandleMpegDesc **) 1;    // only tells descriptors follow
+        putBytes(pmt, &es, sizeof(es));
+        if (i != 0)
+        {
+            desc.tag = 0x0a;
+            desc.dataLen = sizeof(language);
+            putBytes(pmt, &desc, sizeof(desc));
+            putBytes(pmt, language, sizeof(language));
+        }
+    }
+}
+
+static bool writeRecording(const std::string &file, uint16_t videoPid)
+{
+    std::vector<uint8_t> entries[4];
+    static const uint32_t tags[] = { kRecMetaTag_MspPmt, kRecMetaTag_CaBlob, kRecMetaTag_CaDescriptor, kRecMetaTag_CaptionService };
+
+    makeMspPmt(entries[0], videoPid);
+    entries[1].assign(kBenchCaBlobSize, videoPid & 0xFF);
+    entries[2].assign(12, 0x0e);
+    entries[3].assign(8, 0x86);
+
+    std::vector<uint8_t> buf(sizeof(tCpeRecDataBase), 0);
+    tCpeRecDataBase db;
+    memset(&db, 0, sizeof(db));
+    db.dbHdr.dbCounts = 4;
+    for (int i = 0; i < 4; i++)
+    {
+        db.dbEntry[i].tag = tags[i];
+        db.dbEntry[i].offset = buf.size();
+        db.dbEntry[i].size = entries[i].size();
+        buf.insert(buf.end(), entries[i].begin(), entries[i].end());
+    }
+    memcpy(&buf[0], &db, sizeof(db));
+
+    FILE *fp = fopen(file.c_str(), "wb");
+    if (!fp)
+    {
+        return false;
+    }
+    bool ok = (fwrite(&buf[0], 1, buf.size(), fp) == buf.size());
+    fclose(fp);
+    return ok;
+}
+
+static void report(const char *phase, double secs, unsigned int count)
+{
+    printf("%-24s %10.2f %12.1f\n", phase, secs * 1000, secs * 1e6 / count);
+}
+
+int main(int argc, char *argv[])
+{
+    std::string dir = std::string((argc > 1) ? argv[1] : "/tmp") + "/recordingPsiIndexBench";
+    std::string indexFile = dir + "/index";
+    std::vector<std::string> files;
+    RecordingPsiIndex *index = RecordingPsiIndex::getInstance();
+
+    mkdir(dir.c_str(), 0755);
+    for (unsigned int i = 0; i < kBenchRecordings; i++)
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "/rec%04u", i);
+        files.push_back(dir + name);
+        if (!writeRecording(files.back(), 0x100 + 0x10 * (i % 64)))
+        {
+            printf("ERROR: cannot write %s\n", files.back().c_str());
+            return 1;
+        }
+    }
+    index->setIndexFile(indexFile.c_str());
+    index->flush();
+
+    printf("%d recordings\n", kBenchRecordings);
+    printf("%-24s %10s %12s\n", "phase", "ms", "us/recording");
+
+    // every start reads its file, as without the index
+    std::vector<uint8_t> records;
+    double start = nowSecs();
+    for (unsigned int i = 0; i < files.size(); i++)
+    {
+        if (index->indexRecording(files[i], records) != kMspStatus_Ok)
+        {
+            printf("ERROR: cannot read %s\n", files[i].c_str());
+            return 1;
+        }
+    }
+    report("read one by one", nowSecs() - start, files.size());
+
+    static const unsigned int threads[] = { 1, 2, 4, 8 };
+    for (unsigned int t = 0; t < sizeof(threads) / sizeof(threads[0]); t++)
+    {
+        char phase[32];
+
+        index->flush();
+        start = nowSecs();
+        unsigned int indexed = index->scanRecordings(files, threads[t]);
+        double secs = nowSecs() - start;
+        if (indexed != files.size())
+        {
+            printf("ERROR: %u of %u indexed\n", indexed, (unsigned int) files.size());
+            return 1;
+        }
+        snprintf(phase, sizeof(phase), "scan, %u threads", threads[t]);
+        report(phase, secs, files.size());
+    }
+
+    start = nowSecs();
+    if (index->scanRecordings(files, 4) != 0)
+    {
+        printf("ERROR: an unchanged library was indexed again\n");
+        return 1;
+    }
+    report("rescan, unchanged", nowSecs() - start, files.size());
+
+    start = nowSecs();
+    for (unsigned int i = 0; i < files.size(); i++)
+    {
+        if (!index->lookup(files[i], records))
+        {
+            printf("ERROR: %s not in the index\n", files[i].c_str());
+            return 1;
+        }
+    }
+    report("lookup metadata", nowSecs() - start, files.size());
+
+    start = nowSecs();
+    for (unsigned int i = 0; i < files.size(); i++)
+    {
+        tRecordingPids pids;
+        if (!index->lookupPids(files[i], &pids) || (pids.videoPid != 0x100 + 0x10 * (i % 64)) || (pids.audioCount != 2))
+        {
+            printf("ERROR: %s bad PIDs\n", files[i].c_str());
+            return 1;
+        }
+    }
+    report("lookup PIDs", nowSecs() - start, files.size());
+
+    start = nowSecs();
+    if (index->save(indexFile.c_str()) != kMspStatus_Ok)
+    {
+        printf("ERROR: cannot save %s\n", indexFile.c_str());
+        return 1;
+    }
+    report("save", nowSecs() - start, files.size());
+
+    index->flush();
+    start = nowSecs();
+    if (index->load(indexFile.c_str()) != kMspStatus_Ok)
+    {
+        printf("ERROR: cannot load %s\n", indexFile.c_str());
+        return 1;
+    }
+    report("load", nowSecs() - start, files.size());
+
+    tRecordingPsiIndexStats stats;
+    index->getStats(&stats);
+    if (stats.entries != files.size())
+    {
+        printf("ERROR: %u entries loaded\n", stats.entries);
+        return 1;
+    }
+
+    for (unsigned int i = 0; i < files.size(); i++)
+    {
+        unlink(files[i].c_str());
+    }
+    unlink(indexFile.c_str());
+    rmdir(dir.c_str());
+    return 0;
+}
@@ -0,0 +1,206 @@
+/**
+
+\file recordingPsiIndex_test.h -- contains the cxxtest test cases for the recording PSI index
+
+The metadata files and the saved index are written to a temporary directory.
+The index is the process wide one; each test starts it empty and has it
+saved there after 50 ms instead of kRecordingPsiIndexSaveDelayMs.
+*/
+
+#if !defined(RECORDING_PSI_INDEX_TEST_H)
+#define RECORDING_PSI_INDEX_TEST_H
+
+#include <cxxtest/TestSuite.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <cpe_recmgr.h>
+#include <cpe_programhandle.h>
+
+#include "recordingPsiIndex.h"
+#include "recordMetadataJournal.h"
+
+#define kTestSaveDelayMs   50
+#define kTestEmptyIndex    16      ///< magic, version, count and CRC of an index of no recording
+
+class recordingPsiIndexTestSuite : public CxxTest::TestSuite
+{
+    char mDir[32];
+
+    static void putBytes(std::vector<uint8_t> &buf, const void *data, uint32_t size)
+    {
+        buf.insert(buf.end(), (const uint8_t *) data, (const uint8_t *) data + size);
+    }
+
+    // MSP PMT metadata of an H.264 video and an audio
+    static std::vector<uint8_t> mspPmt(uint16_t videoPid)
+    {
+        std::vector<uint8_t> pmt;
+        tCpePgrmHandlePmt header;
+        tCpePgrmHandleEsData es;
+
+        memset(&header, 0, sizeof(header));
+        header.clockPid = videoPid;
+        header.esCount = 2;
+        putBytes(pmt, &header, sizeof(header));
+
+        memset(&es, 0, sizeof(es));
+        es.streamType = kCpeStreamType_H264_Video;
+        es.pid = videoPid;
+        putBytes(pmt, &es, sizeof(es));
+        es.streamType = kCpeStreamType_GI_Audio;
+        es.pid = videoPid + 1;
+        putBytes(pmt, &es, sizeof(es));
+        return pmt;
+    }
+
+    // written in place with the modification time given, a rewrite within the same second as needed
+    std::string write(const char *name, uint16_t videoPid, uint8_t blob, long nsec)
+    {
+        std::string file = std::string(mDir) + "/" + name;
+        tRecMetaEntries entries;
+        std::vector<uint8_t> db;
+
+        entries[kRecMetaTag_MspPmt] = mspPmt(videoPid);
+        entries[kRecMetaTag_CaBlob].assign(2048, blob);
+        RecordMetadataJournal::toDatabase(entries, 0, db);
+        FILE *fp = fopen(file.c_str(), "wb");
+        TS_ASSERT(fp != NULL);
+        fwrite(&db[0], db.size(), 1, fp);
+        fclose(fp);
+
+        struct timespec times[2];
+        times[0].tv_sec = times[1].tv_sec = 1500000000;
+        times[0].tv_nsec = times[1].tv_nsec = nsec;
+        TS_ASSERT_EQUALS(utimensat(AT_FDCWD, file.c_str(), times, 0), 0);
+        return file;
+    }
+
+    // waits for the save thread to write file larger than minSize
+    static bool waitSaved(const std::string &file, off_t minSize)
+    {
+        for (int i = 0; i < 200; i++)
+        {
+            struct stat st;
+            if ((stat(file.c_str(), &st) == 0) && (st.st_size > minSize))
+            {
+                return true;
+            }
+            usleep(10 * 1000);
+        }
+        return false;
+    }
+
+    static uint8_t caBlobOf(std::vector<uint8_t> &records)
+    {
+        tRecordingMetaEntry entry;
+        uint32_t pos = 0;
+
+        while (RecordingPsiIndex::nextEntry(records, &pos, &entry))
+        {
+            if (entry.tag == kRecMetaTag_CaBlob)
+            {
+                return entry.data[0];
+            }
+        }
+        return 0;
+    }
+
+public:
+
+    void setUp()
+    {
+        strcpy(mDir, "/tmp/psiIndexXXXXXX");
+        TS_ASSERT(mkdtemp(mDir) != NULL);
+        RecordingPsiIndex::getInstance()->setIndexFile((std::string(mDir) + "/index").c_str(), kTestSaveDelayMs);
+        RecordingPsiIndex::getInstance()->flush();
+    }
+
+    void tearDown()
+    {
+        RecordingPsiIndex::getInstance()->flush();
+        std::string cmd = std::string("rm -rf ") + mDir;
+        TS_ASSERT_EQUALS(system(cmd.c_str()), 0);
+    }
+
+    void testLookupAndPids()
+    {
+        RecordingPsiIndex *index = RecordingPsiIndex::getInstance();
+        std::vector<uint8_t> records;
+        tRecordingPids pids;
+        std::string file = write("rec1", 0x100, 7, 0);
+
+        TS_ASSERT(!index->lookup(file, records));
+        TS_ASSERT(!index->lookupPids(file, &pids));
+        TS_ASSERT_EQUALS(index->indexRecording(file, records), kMspStatus_Ok);
+        TS_ASSERT_EQUALS(caBlobOf(records), 7);
+
+        records.clear();
+        TS_ASSERT(index->lookup(file, records));
+        TS_ASSERT_EQUALS(caBlobOf(records), 7);
+        TS_ASSERT(index->lookupPids(file, &pids));
+        TS_ASSERT_EQUALS(pids.videoPid, 0x100);
+        TS_ASSERT_EQUALS(pids.videoStreamType, kCpeStreamType_H264_Video);
+        TS_ASSERT_EQUALS(pids.audioPid, 0x101);
+        TS_ASSERT_EQUALS(pids.audioCount, 1);
+
+        TS_ASSERT_EQUALS(index->indexRecording(std::string(mDir) + "/none", records), kMspStatus_Error);
+    }
+
+    void testRewriteWithinSecond()
+    {
+        RecordingPsiIndex *index = RecordingPsiIndex::getInstance();
+        std::vector<uint8_t> records;
+        std::string file = write("rec1", 0x100, 7, 100);
+
+        TS_ASSERT_EQUALS(index->indexRecording(file, records), kMspStatus_Ok);
+
+        // same size, same second
+        write("rec1", 0x100, 8, 200);
+        TS_ASSERT(!index->lookup(file, records));
+        TS_ASSERT_EQUALS(index->indexRecording(file, records), kMspStatus_Ok);
+        TS_ASSERT(index->lookup(file, records));
+        TS_ASSERT_EQUALS(caBlobOf(records), 8);
+    }
+
+    void testRemove()
+    {
+        RecordingPsiIndex *index = RecordingPsiIndex::getInstance();
+        std::vector<uint8_t> records;
+        tRecordingPids pids;
+        std::string file = write("rec1", 0x100, 7, 0);
+
+        TS_ASSERT_EQUALS(index->indexRecording(file, records), kMspStatus_Ok);
+        index->remove(file);
+        TS_ASSERT(!index->lookupPids(file, &pids));
+    }
+
+    void testSavedAfterMiss()
+    {
+        RecordingPsiIndex *index = RecordingPsiIndex::getInstance();
+        std::vector<uint8_t> records;
+        std::string indexFile = std::string(mDir) + "/index";
+        std::string copy = std::string(mDir) + "/copy";
+        std::string file = write("rec1", 0x100, 7, 0);
+
+        // a miss of psiStart(), no scan and no save() after it
+        TS_ASSERT(!index->lookup(file, records));
+        TS_ASSERT_EQUALS(index->indexRecording(file, records), kMspStatus_Ok);
+        TS_ASSERT(waitSaved(indexFile, kTestEmptyIndex));
+        TS_ASSERT_EQUALS(rename(indexFile.c_str(), copy.c_str()), 0);
+
+        // forgetting it is saved as well
+        index->flush();
+        TS_ASSERT(waitSaved(indexFile, kTestEmptyIndex - 1));
+
+        TS_ASSERT_EQUALS(index->load(copy.c_str()), kMspStatus_Ok);
+        TS_ASSERT(index->lookup(file, records));
+        TS_ASSERT_EQUALS(caBlobOf(records), 7);
+    }
+};
+
+#endif
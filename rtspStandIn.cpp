@@ -0,0 +1,373 @@
+/**
+   \file rtspStandIn.cpp
+   \class RtspStandIn
+
+Implementation file for the local stand-in of a cloud DVR RTSP head-end
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "rtspStandIn.h"
+
+#define kStandInSessionId   "CDVR0001"
+
+static uint64_t nowMs(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return ((uint64_t) now.tv_sec * 1000) + (now.tv_nsec / 1000000);
+}
+
+static void sleepMs(unsigned int ms)
+{
+    if (ms)
+    {
+        usleep(ms * 1000);
+    }
+}
+
+// value of header name in request, empty when there is none
+static std::string header(const std::string &request, const char *name)
+{
+    std::string::size_type pos = 0;
+    size_t len = strlen(name);
+
+    while ((pos = request.find("\r\n", pos)) != std::string::npos)
+    {
+        pos += 2;
+        if ((request.compare(pos, len, name) == 0) && (request[pos + len] == ':'))
+        {
+            std::string::size_type start = request.find_first_not_of(' ', pos + len + 1);
+            std::string::size_type end = request.find("\r\n", pos);
+            if ((start == std::string::npos) || (end == std::string::npos) || (start > end))
+            {
+                return "";
+            }
+            return request.substr(start, end - start);
+        }
+    }
+    return "";
+}
+
+// length of the first complete request of buf with its body, 0 when more is to come
+static size_t requestLength(const std::string &buf)
+{
+    std::string::size_type end = buf.find("\r\n\r\n");
+
+    if (end == std::string::npos)
+    {
+        return 0;
+    }
+    size_t length = end + 4 + atoi(header(buf.substr(0, end + 2), "Content-Length").c_str());
+    return (buf.size() >= length) ? length : 0;
+}
+
+RtspStandIn::RtspStandIn()
+{
+    pthread_mutex_init(&mMutex, NULL);
+    mListenFd = -1;
+    mPort = 0;
+    mRunning = false;
+    mConnectMs = 0;
+    mResponseMs = 0;
+    mNpt = 0;
+    mNptTimeMs = nowMs();
+    mScale = 1;
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+RtspStandIn::~RtspStandIn()
+{
+    stop();
+    pthread_mutex_destroy(&mMutex);
+}
+
+bool RtspStandIn::start(void)
+{
+    struct sockaddr_in addr;
+    socklen_t addrLen = sizeof(addr);
+    int on = 1;
+
+    mListenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (mListenFd < 0)
+    {
+        return false;
+    }
+    setsockopt(mListenFd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    if ((bind(mListenFd, (struct sockaddr *) &addr, sizeof(addr)) < 0) ||
+            (listen(mListenFd, 8) < 0) ||
+            (getsockname(mListenFd, (struct sockaddr *) &addr, &addrLen) < 0))
+    {
+        close(mListenFd);
+        mListenFd = -1;
+        return false;
+    }
+    mPort = ntohs(addr.sin_port);
+
+    mRunning = true;
+    if (pthread_create(&mAcceptThread, NULL, AcceptThread, this) != 0)
+    {
+        mRunning = false;
+        close(mListenFd);
+        mListenFd = -1;
+        return false;
+    }
+    return true;
+}
+
+void RtspStandIn::stop(void)
+{
+    if (!mRunning)
+    {
+        return;
+    }
+
+    mRunning = false;
+    pthread_join(mAcceptThread, NULL);
+    close(mListenFd);
+    mListenFd = -1;
+
+    // the connection threads see the end of their streams
+    pthread_mutex_lock(&mMutex);
+    for (size_t i = 0; i < mFds.size(); i++)
+    {
+        shutdown(mFds[i], SHUT_RDWR);
+    }
+    std::vector<pthread_t> threads = mThreads;
+    pthread_mutex_unlock(&mMutex);
+
+    for (size_t i = 0; i < threads.size(); i++)
+    {
+        pthread_join(threads[i], NULL);
+    }
+
+    pthread_mutex_lock(&mMutex);
+    for (size_t i = 0; i < mFds.size(); i++)
+    {
+        close(mFds[i]);
+    }
+    mFds.clear();
+    mThreads.clear();
+    pthread_mutex_unlock(&mMutex);
+}
+
+std::string RtspStandIn::url(const char *asset)
+{
+    char url[64];
+
+    snprintf(url, sizeof(url), "rtsp://127.0.0.1:%d/%s", mPort, asset);
+    return url;
+}
+
+void RtspStandIn::setDelays(unsigned int connectMs, unsigned int responseMs)
+{
+    pthread_mutex_lock(&mMutex);
+    mConnectMs = connectMs;
+    mResponseMs = responseMs;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void RtspStandIn::getStats(tRtspStandInStats *stats)
+{
+    pthread_mutex_lock(&mMutex);
+    *stats = mStats;
+    pthread_mutex_unlock(&mMutex);
+}
+
+struct StandInConnection
+{
+    RtspStandIn *server;
+    int          fd;
+};
+
+void *RtspStandIn::AcceptThread(void *arg)
+{
+    RtspStandIn *server = (RtspStandIn *) arg;
+
+    while (server->mRunning)
+    {
+        struct pollfd pfd;
+        pfd.fd = server->mListenFd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, 50) <= 0)
+        {
+            continue;
+        }
+
+        int fd = accept(server->mListenFd, NULL, NULL);
+        if (fd < 0)
+        {
+            continue;
+        }
+        int on = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+        StandInConnection *conn = new StandInConnection;
+        conn->server = server;
+        conn->fd = fd;
+
+        pthread_t thread;
+        pthread_mutex_lock(&server->mMutex);
+        server->mStats.connections++;
+        if (pthread_create(&thread, NULL, ConnectionThread, conn) == 0)
+        {
+            server->mThreads.push_back(thread);
+            server->mFds.push_back(fd);
+        }
+        else
+        {
+            close(fd);
+            delete conn;
+        }
+        pthread_mutex_unlock(&server->mMutex);
+    }
+    return NULL;
+}
+
+void *RtspStandIn::ConnectionThread(void *arg)
+{
+    StandInConnection *conn = (StandInConnection *) arg;
+
+    conn->server->serve(conn->fd);
+    delete conn;
+    return NULL;
+}
+
+void RtspStandIn::serve(int fd)
+{
+    std::string buf;
+    char data[2048];
+
+    pthread_mutex_lock(&mMutex);
+    unsigned int connectMs = mConnectMs;
+    pthread_mutex_unlock(&mMutex);
+    sleepMs(connectMs);
+
+    while (true)
+    {
+        size_t length = requestLength(buf);
+        if (length == 0)
+        {
+            ssize_t n = recv(fd, data, sizeof(data), 0);
+            if (n <= 0)
+            {
+                break;
+            }
+            buf.append(data, n);
+            continue;
+        }
+
+        std::string request = buf.substr(0, length);
+        buf.erase(0, length);
+
+        pthread_mutex_lock(&mMutex);
+        unsigned int responseMs = mResponseMs;
+        pthread_mutex_unlock(&mMutex);
+        sleepMs(responseMs);
+
+        // whatever the client sent without waiting for this answer
+        ssize_t n;
+        while ((n = recv(fd, data, sizeof(data), MSG_DONTWAIT)) > 0)
+        {
+            buf.append(data, n);
+        }
+
+        std::string response = answer(request);
+
+        pthread_mutex_lock(&mMutex);
+        if (requestLength(buf) > 0)
+        {
+            mStats.pipelined++;
+        }
+        pthread_mutex_unlock(&mMutex);
+
+        if (send(fd, response.data(), response.size(), MSG_NOSIGNAL) != (ssize_t) response.size())
+        {
+            break;
+        }
+    }
+}
+
+// stream position, called with mMutex held
+double RtspStandIn::positionNow(void)
+{
+    uint64_t now = nowMs();
+    double npt = mNpt + ((now - mNptTimeMs) / 1000.0) * mScale;
+
+    mNpt = (npt > 0) ? npt : 0;
+    mNptTimeMs = now;
+    return mNpt;
+}
+
+std::string RtspStandIn::answer(const std::string &request)
+{
+    std::string method = request.substr(0, request.find(' '));
+    std::string cseq = header(request, "CSeq");
+    std::string headers;
+    std::string body;
+    char line[64];
+
+    pthread_mutex_lock(&mMutex);
+    mStats.requests++;
+    double npt = positionNow();
+
+    if (method == "PLAY")
+    {
+        mStats.plays++;
+        std::string range = header(request, "Range");
+        std::string scale = header(request, "Scale");
+        if ((range.compare(0, 4, "npt=") == 0) && (range.compare(4, 3, "now") != 0) && (range[4] != '-'))
+        {
+            mNpt = npt = atof(range.c_str() + 4);
+        }
+        mScale = scale.empty() ? 1 : atof(scale.c_str());
+        snprintf(line, sizeof(line), "Range: npt=%.3f-\r\n", npt);
+        headers += line;
+        snprintf(line, sizeof(line), "Scale: %.2f\r\n", mScale);
+        headers += line;
+    }
+    else if (method == "PAUSE")
+    {
+        mStats.pauses++;
+        mScale = 0;
+    }
+    else if (method == "GET_PARAMETER")
+    {
+        mStats.getParameters++;
+        std::string query = request.substr(request.find("\r\n\r\n") + 4);
+        if (query.compare(0, 8, "position") == 0)
+        {
+            snprintf(line, sizeof(line), "%.3f\r\n", npt);
+            body = line;
+        }
+        else if (query.compare(0, 5, "scale") == 0)
+        {
+            snprintf(line, sizeof(line), "%.2f\r\n", mScale);
+            body = line;
+        }
+    }
+    pthread_mutex_unlock(&mMutex);
+
+    std::string response = "RTSP/1.0 200 OK\r\nCSeq: " + cseq + "\r\nSession: " kStandInSessionId "\r\n" + headers;
+    if (!body.empty())
+    {
+        snprintf(line, sizeof(line), "Content-Type: text/parameters\r\nContent-Length: %u\r\n", (unsigned int) body.size());
+        response += line;
+    }
+    return response + "\r\n" + body;
+}
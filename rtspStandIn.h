@@ -0,0 +1,78 @@
+/**
+   \file rtspStandIn.h
+   \class RtspStandIn
+
+   Local stand-in for a cloud DVR RTSP head-end, for the unit test and the
+   benchmark of the Cloud DVR RTSP transport.
+
+   It listens on an ephemeral loopback port and answers every request with
+   200 OK, one connection per thread, in the order the requests arrive on it.
+   The stream it plays follows the PLAY Range and Scale headers and PAUSE, a
+   GET_PARAMETER for "position" or "scale" is answered with the bare value in
+   the body, as the head-ends do.  The connect and response delays stand for
+   the round trip to a remote head-end.
+*/
+
+#if !defined(RTSP_STAND_IN_H)
+#define RTSP_STAND_IN_H
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <pthread.h>
+
+typedef struct
+{
+    unsigned int connections;
+    unsigned int requests;
+    unsigned int plays;
+    unsigned int pauses;
+    unsigned int getParameters;
+    unsigned int pipelined;      ///< requests that were already received when the one before them was answered
+} tRtspStandInStats;
+
+class RtspStandIn
+{
+public:
+    RtspStandIn();
+    ~RtspStandIn();
+
+    /// Listens on 127.0.0.1 and starts serving, false on a socket error
+    bool start(void);
+    /// Closes all the connections and waits for their threads
+    void stop(void);
+
+    /// rtsp:// URL of asset on this server
+    std::string url(const char *asset);
+    /// Delay before the first request of a connection is read and before each response
+    void setDelays(unsigned int connectMs, unsigned int responseMs);
+
+    void getStats(tRtspStandInStats *stats);
+
+private:
+    static void *AcceptThread(void *arg);
+    static void *ConnectionThread(void *arg);
+    void serve(int fd);
+    std::string answer(const std::string &request);
+    double positionNow(void);
+
+    pthread_mutex_t      mMutex;
+    int                  mListenFd;
+    unsigned short       mPort;
+    volatile bool        mRunning;
+    pthread_t            mAcceptThread;
+    std::vector<pthread_t> mThreads;
+    std::vector<int>     mFds;
+    unsigned int         mConnectMs;
+    unsigned int         mResponseMs;
+
+    double               mNpt;          ///< of the stream at mNptTimeMs, in seconds
+    uint64_t             mNptTimeMs;
+    double               mScale;        ///< 0 when paused
+    tRtspStandInStats    mStats;
+
+    RtspStandIn(const RtspStandIn&);
+    RtspStandIn& operator=(const RtspStandIn&);
+};
+
+#endif
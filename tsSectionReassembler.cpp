@@ -0,0 +1,333 @@
+/**
+   \file tsSectionReassembler.cpp
+   \class TsSectionReassembler
+
+Implementation file for the transport packet to section reassembler
+*/
+
+#include <string.h>
+#include <dlog.h>
+
+#include "tsSectionReassembler.h"
+#include "crc32.h"
+
+#define LOG(level, msg, args...)  dlog(DL_MSP_PSI, level,"TsSectionReassembler:%s:%d " msg, __FUNCTION__, __LINE__, ##args);
+
+#define kTsSectionHeaderSize  3     ///< table_id and section_length
+#define kTsStuffingByte       0xFF
+
+TsSectionReassembler::TsSectionReassembler(TsSectionCallback callback, void *ctx)
+{
+    mCallback = callback;
+    mCtx = ctx;
+    memset(mPidMask, 0, sizeof(mPidMask));
+    mCarryLength = 0;
+    mInSync = false;
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+TsSectionReassembler::~TsSectionReassembler()
+{
+}
+
+void TsSectionReassembler::enablePid(uint16_t pid)
+{
+    pid &= kTsMaxPid;
+    if (isPidEnabled(pid))
+    {
+        return;
+    }
+
+    mPidMask[pid >> 5] |= (1 << (pid & 31));
+
+    PidState &state = mPids[pid];
+    if (state.section.empty())
+    {
+        state.section.resize(kTsMaxSectionSize);
+    }
+    dropSection(state);
+    state.lastCc = -1;
+}
+
+void TsSectionReassembler::disablePid(uint16_t pid)
+{
+    pid &= kTsMaxPid;
+    mPidMask[pid >> 5] &= ~(1 << (pid & 31));
+
+    // the state is kept, the callback may be running on it
+    std::map<uint16_t, PidState>::iterator iter = mPids.find(pid);
+    if (iter != mPids.end())
+    {
+        dropSection(iter->second);
+        iter->second.lastCc = -1;
+    }
+}
+
+void TsSectionReassembler::disableAllPids(void)
+{
+    for (std::map<uint16_t, PidState>::iterator iter = mPids.begin(); iter != mPids.end(); iter++)
+    {
+        disablePid(iter->first);
+    }
+}
+
+void TsSectionReassembler::reset(void)
+{
+    for (std::map<uint16_t, PidState>::iterator iter = mPids.begin(); iter != mPids.end(); iter++)
+    {
+        dropSection(iter->second);
+        iter->second.lastCc = -1;
+    }
+    mCarryLength = 0;
+    mInSync = false;
+}
+
+unsigned int TsSectionReassembler::pushBytes(const uint8_t *data, uint32_t size)
+{
+    unsigned int packets = 0;
+    uint32_t pos = 0;
+
+    if (data == NULL)
+    {
+        return 0;
+    }
+
+    if (mCarryLength)
+    {
+        uint32_t length = kTsPacketSize - mCarryLength;
+        if (length > size)
+        {
+            length = size;
+        }
+        memcpy(mCarry + mCarryLength, data, length);
+        mCarryLength += length;
+        pos = length;
+
+        if (mCarryLength < kTsPacketSize)
+        {
+            return 0;
+        }
+
+        mCarryLength = 0;
+        if (mInSync || (pos == size) || (data[pos] == kTsSyncByte))
+        {
+            mInSync = true;
+            processPacket(mCarry);
+            packets++;
+        }
+    }
+
+    // whole packets are parsed where they are
+    while (pos + kTsPacketSize <= size)
+    {
+        if ((data[pos] == kTsSyncByte) &&
+                (mInSync || (pos + kTsPacketSize == size) || (data[pos + kTsPacketSize] == kTsSyncByte)))
+        {
+            mInSync = true;
+            processPacket(data + pos);
+            packets++;
+            pos += kTsPacketSize;
+            continue;
+        }
+
+        if (mInSync)
+        {
+            LOG(DLOGL_NOISE, "sync lost at byte %u", pos);
+            mInSync = false;
+            mStats.syncLosses++;
+        }
+        pos++;
+    }
+
+    // keep the start of the next packet
+    if ((pos < size) && (data[pos] != kTsSyncByte) && mInSync)
+    {
+        mInSync = false;
+        mStats.syncLosses++;
+    }
+    if (!mInSync)
+    {
+        while ((pos < size) && (data[pos] != kTsSyncByte))
+        {
+            pos++;
+        }
+    }
+    if (pos < size)
+    {
+        mCarryLength = size - pos;
+        memcpy(mCarry, data + pos, mCarryLength);
+    }
+
+    return packets;
+}
+
+void TsSectionReassembler::processPacket(const uint8_t *packet)
+{
+    uint16_t pid = ((packet[1] & 0x1F) << 8) | packet[2];
+
+    if (!isPidEnabled(pid))
+    {
+        return;
+    }
+    mStats.packets++;
+
+    PidState &state = mPids[pid];
+
+    if (packet[1] & 0x80)
+    {
+        // transport_error_indicator
+        mStats.badPackets++;
+        dropSection(state);
+        return;
+    }
+
+    uint8_t adaptationControl = (packet[3] >> 4) & 0x3;
+    int cc = packet[3] & 0xF;
+    uint32_t offset = 4;
+    bool discontinuity = false;
+
+    if (adaptationControl & 0x2)
+    {
+        uint8_t adaptationLength = packet[4];
+        offset = 5 + adaptationLength;
+        if (offset > kTsPacketSize)
+        {
+            mStats.badPackets++;
+            dropSection(state);
+            return;
+        }
+        discontinuity = (adaptationLength != 0) && (packet[5] & 0x80);
+    }
+
+    if (!(adaptationControl & 0x1) || (offset == kTsPacketSize))
+    {
+        // no payload, the continuity_counter does not move
+        return;
+    }
+
+    if ((state.lastCc >= 0) && !discontinuity)
+    {
+        if (cc == state.lastCc)
+        {
+            return;     // duplicate packet
+        }
+        if (cc != ((state.lastCc + 1) & 0xF))
+        {
+            LOG(DLOGL_NOISE, "pid 0x%x continuity %d after %d", pid, cc, state.lastCc);
+            mStats.ccErrors++;
+            dropSection(state);
+        }
+    }
+    state.lastCc = cc;
+
+    const uint8_t *payload = packet + offset;
+    uint32_t length = kTsPacketSize - offset;
+
+    if (packet[1] & 0x40)
+    {
+        // payload_unit_start_indicator: the pointer_field gives where the next section starts
+        uint32_t pointer = payload[0];
+        payload++;
+        length--;
+        if (pointer > length)
+        {
+            mStats.badPackets++;
+            dropSection(state);
+            return;
+        }
+
+        if (state.collecting)
+        {
+            if (!collect(pid, state, payload, pointer, false))
+            {
+                return;
+            }
+            if (state.collecting)
+            {
+                // shorter than its section_length
+                mStats.badPackets++;
+                dropSection(state);
+            }
+        }
+        collect(pid, state, payload + pointer, length - pointer, true);
+    }
+    else if (state.collecting)
+    {
+        collect(pid, state, payload, length, false);
+    }
+}
+
+bool TsSectionReassembler::collect(uint16_t pid, PidState &state, const uint8_t *data, uint32_t length, bool canStart)
+{
+    while (length > 0)
+    {
+        if (!state.collecting)
+        {
+            // a section only starts after a pointer_field, stuffing runs to the end of the packet
+            if (!canStart || (data[0] == kTsStuffingByte))
+            {
+                return true;
+            }
+            state.collecting = true;
+            state.length = 0;
+            state.needed = 0;
+        }
+
+        uint32_t wanted = (state.needed == 0) ? (kTsSectionHeaderSize - state.length) : (state.needed - state.length);
+        uint32_t copied = (wanted < length) ? wanted : length;
+        memcpy(&state.section[state.length], data, copied);
+        state.length += copied;
+        data += copied;
+        length -= copied;
+
+        if ((state.needed == 0) && (state.length == kTsSectionHeaderSize))
+        {
+            state.needed = kTsSectionHeaderSize + (((state.section[1] & 0x0F) << 8) | state.section[2]);
+            if (state.needed > kTsMaxSectionSize)
+            {
+                mStats.badPackets++;
+                dropSection(state);
+                return true;
+            }
+        }
+
+        if ((state.needed != 0) && (state.length == state.needed))
+        {
+            if (!deliver(pid, state))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool TsSectionReassembler::deliver(uint16_t pid, PidState &state)
+{
+    const uint8_t *section = &state.section[0];
+    uint32_t size = state.length;
+
+    state.collecting = false;
+
+    // the CRC_32 of a correct section makes the CRC of the whole section 0
+    if ((section[1] & 0x80) && (MSPCrc32::compute(0xFFFFFFFF, section, size) != 0))
+    {
+        LOG(DLOGL_NOISE, "pid 0x%x table 0x%x: bad CRC", pid, section[0]);
+        mStats.crcErrors++;
+        return true;
+    }
+
+    mStats.sections++;
+    if (mCallback)
+    {
+        mCallback(mCtx, pid, section, size);
+    }
+    return isPidEnabled(pid);
+}
+
+void TsSectionReassembler::dropSection(PidState &state)
+{
+    state.collecting = false;
+    state.length = 0;
+    state.needed = 0;
+}
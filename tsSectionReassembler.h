@@ -0,0 +1,108 @@
+/**
+   \file tsSectionReassembler.h
+   \class TsSectionReassembler
+
+   Rebuilds ISO/IEC 13818-1 sections from a stream of 188 byte transport
+   packets, for PSI that is not read through a platform section filter
+   (MRDVR and in-memory streams).
+
+    - the input is a byte stream: packets may be split across pushBytes()
+      calls, sync is searched for and confirmed on the next packet after a
+      loss,
+    - a section starts at the pointer_field of a packet with
+      payload_unit_start_indicator set, and may span several packets or share
+      a packet with the end of the previous section and further sections,
+    - a continuity_counter gap drops the section being collected, a
+      duplicate packet is ignored,
+    - sections with section_syntax_indicator set are only delivered when
+      their CRC_32 is correct, like a section filter with CRC checking on.
+
+   Only the PIDs enabled are looked at.  Whole packets are parsed in place in
+   the caller's buffer, only the section bytes are copied.  Not thread safe,
+   the owner serializes the calls; the callback may enable or disable PIDs.
+*/
+
+#if !defined(TS_SECTION_REASSEMBLER_H)
+#define TS_SECTION_REASSEMBLER_H
+
+#include <stdint.h>
+#include <map>
+#include <vector>
+
+#define kTsPacketSize           188
+#define kTsSyncByte             0x47
+#define kTsMaxPid               0x1FFF
+#define kTsMaxSectionSize       4096    ///< private sections, PSI sections are at most 1024
+
+/// Called for each complete section: size bytes from table_id to the end of the section
+typedef void (*TsSectionCallback)(void *ctx, uint16_t pid, const uint8_t *section, uint32_t size);
+
+typedef struct
+{
+    unsigned int packets;           ///< packets on enabled PIDs
+    unsigned int sections;          ///< sections delivered
+    unsigned int syncLosses;
+    unsigned int ccErrors;          ///< continuity_counter gaps, the section in progress is dropped
+    unsigned int crcErrors;
+    unsigned int badPackets;        ///< transport_error_indicator, bad adaptation field or pointer_field, oversized section
+} tTsSectionStats;
+
+class TsSectionReassembler
+{
+public:
+    TsSectionReassembler(TsSectionCallback callback, void *ctx);
+    ~TsSectionReassembler();
+
+    void enablePid(uint16_t pid);
+    /// Drops the section being collected on pid
+    void disablePid(uint16_t pid);
+    void disableAllPids(void);
+    bool isPidEnabled(uint16_t pid) const
+    {
+        return (mPidMask[pid >> 5] >> (pid & 31)) & 1;
+    }
+
+    /// Processes size bytes of transport stream, returns the number of complete packets seen
+    unsigned int pushBytes(const uint8_t *data, uint32_t size);
+
+    /// Forgets partial packets and sections, the enabled PIDs and counters are kept
+    void reset(void);
+
+    void getStats(tTsSectionStats *stats) const
+    {
+        *stats = mStats;
+    }
+
+private:
+    struct PidState
+    {
+        std::vector<uint8_t> section;
+        uint32_t             length;        // bytes collected
+        uint32_t             needed;        // section size, 0 until section_length is read
+        int                  lastCc;        // -1 until the first packet
+        bool                 collecting;
+    };
+
+    void processPacket(const uint8_t *packet);
+    // returns false when the PID was disabled by the callback
+    bool collect(uint16_t pid, PidState &state, const uint8_t *data, uint32_t length, bool canStart);
+    bool deliver(uint16_t pid, PidState &state);
+    static void dropSection(PidState &state);
+
+    TsSectionCallback mCallback;
+    void             *mCtx;
+
+    uint32_t         mPidMask[(kTsMaxPid + 1) / 32];
+    std::map<uint16_t, PidState> mPids;
+
+    uint8_t          mCarry[kTsPacketSize];     // packet split across pushBytes() calls
+    uint32_t         mCarryLength;
+    bool             mInSync;
+
+    tTsSectionStats  mStats;
+
+    TsSectionReassembler(const TsSectionReassembler&);
+    TsSectionReassembler& operator=(const TsSectionReassembler&);
+};
+
+#endif
@@ -0,0 +1,166 @@
+/** @file tsSectionReassembler_bench.cpp
+ *
+ * @brief Measures TsSectionReassembler on a synthetic single program capture.
+ *
+ * Two streams are used: one like a recording, where PAT/PMT are a few packets
+ * among audio/video packets on other PIDs, and one made of PSI only.  Each is
+ * pushed in the buffer sizes a reader typically uses (one packet, 7 packets
+ * as in an RTP/UDP datagram, 64KB file reads).
+ * Build with "make tsSectionReassembler_bench" and run on the target.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#include "tsSectionReassembler.h"
+#include "crc32.h"
+
+#define kBenchStreamPackets  (16 * 1024)
+#define kBenchBytes          (512 * 1024 * 1024)
+#define kBenchPmtPid         0x100
+#define kBenchVideoPid       0x101
+
+static double nowSecs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+static void onSection(void *ctx, uint16_t pid, const uint8_t *section, uint32_t size)
+{
+    (void) pid;
+    (void) section;
+    *(unsigned int *) ctx += size;
+}
+
+static std::vector<uint8_t> makeSection(uint8_t tableId, uint32_t payloadSize)
+{
+    std::vector<uint8_t> section(3 + 5 + payloadSize + 4);
+    uint32_t sectionLength = section.size() - 3;
+
+    section[0] = tableId;
+    section[1] = 0xB0 | (sectionLength >> 8);
+    section[2] = sectionLength & 0xFF;
+    section[5] = 0xC1;
+    for (uint32_t i = 8; i < section.size() - 4; i++)
+    {
+        section[i] = rand() >> 8;
+    }
+
+    unsigned int crc = MSPCrc32::compute(0xFFFFFFFF, &section[0], section.size() - 4);
+    section[section.size() - 4] = crc >> 24;
+    section[section.size() - 3] = crc >> 16;
+    section[section.size() - 2] = crc >> 8;
+    section[section.size() - 1] = crc;
+    return section;
+}
+
+static void addPackets(std::vector<uint8_t> &ts, uint16_t pid, const uint8_t *payload, uint32_t size, uint8_t *cc, bool section)
+{
+    uint32_t pos = 0;
+    bool first = true;
+
+    while (pos < size)
+    {
+        uint8_t packet[kTsPacketSize];
+        uint32_t offset = 4;
+
+        memset(packet, 0xFF, sizeof(packet));
+        packet[0] = kTsSyncByte;
+        packet[1] = (pid >> 8) & 0x1F;
+        packet[2] = pid & 0xFF;
+        packet[3] = 0x10 | ((*cc)++ & 0xF);
+        if (first && section)
+        {
+            packet[1] |= 0x40;
+            packet[offset++] = 0;
+        }
+        first = false;
+
+        uint32_t length = kTsPacketSize - offset;
+        if (length > size - pos)
+        {
+            length = size - pos;
+        }
+        memcpy(packet + offset, payload + pos, length);
+        pos += length;
+        ts.insert(ts.end(), packet, packet + kTsPacketSize);
+    }
+}
+
+// PAT and PMT every psiInterval packets, video packets in between
+static void buildStream(std::vector<uint8_t> &ts, unsigned int psiInterval)
+{
+    std::vector<uint8_t> pat = makeSection(0x00, 4);
+    std::vector<uint8_t> pmt = makeSection(0x02, 300);
+    uint8_t video[kTsPacketSize - 4];
+    uint8_t patCc = 0, pmtCc = 0, videoCc = 0;
+    unsigned int cycles = 0;
+
+    // whole multiples of 16 cycles, the continuity counters follow on when the stream is pushed again
+    memset(video, 0x55, sizeof(video));
+    do
+    {
+        addPackets(ts, 0, &pat[0], pat.size(), &patCc, true);
+        addPackets(ts, kBenchPmtPid, &pmt[0], pmt.size(), &pmtCc, true);
+        for (unsigned int i = 3; i < psiInterval; i++)
+        {
+            addPackets(ts, kBenchVideoPid, video, sizeof(video), &videoCc, false);
+        }
+        cycles++;
+    }
+    while ((ts.size() < kBenchStreamPackets * kTsPacketSize) || (cycles % 16));
+}
+
+int main(void)
+{
+    static const uint32_t chunkSizes[] = { kTsPacketSize, 7 * kTsPacketSize, 64 * 1024 };
+    static const unsigned int psiIntervals[] = { 400, 3 };
+
+    srand(1);
+
+    printf("%-10s %-8s %-10s %-12s\n", "stream", "chunk", "MB/s", "Mpackets/s");
+    for (unsigned int s = 0; s < sizeof(psiIntervals) / sizeof(psiIntervals[0]); s++)
+    {
+        std::vector<uint8_t> ts;
+        buildStream(ts, psiIntervals[s]);
+
+        for (unsigned int c = 0; c < sizeof(chunkSizes) / sizeof(chunkSizes[0]); c++)
+        {
+            unsigned int received = 0;
+            TsSectionReassembler reassembler(onSection, &received);
+            reassembler.enablePid(0);
+            reassembler.enablePid(kBenchPmtPid);
+
+            unsigned long long bytes = 0;
+            double start = nowSecs();
+            while (bytes < kBenchBytes)
+            {
+                for (uint32_t pos = 0; pos < ts.size(); pos += chunkSizes[c])
+                {
+                    uint32_t length = (pos + chunkSizes[c] <= ts.size()) ? chunkSizes[c] : (ts.size() - pos);
+                    reassembler.pushBytes(&ts[pos], length);
+                }
+                bytes += ts.size();
+            }
+            double secs = nowSecs() - start;
+
+            tTsSectionStats stats;
+            reassembler.getStats(&stats);
+            if (stats.ccErrors || stats.crcErrors || stats.syncLosses || stats.badPackets || (received == 0))
+            {
+                printf("ERROR: cc %u crc %u sync %u bad %u\n", stats.ccErrors, stats.crcErrors, stats.syncLosses, stats.badPackets);
+                return 1;
+            }
+
+            printf("%-10s %-8u %-10.1f %-12.2f\n", (psiIntervals[s] > 3) ? "recording" : "psi-only", chunkSizes[c],
+                   bytes / secs / (1024 * 1024), bytes / kTsPacketSize / secs / 1e6);
+        }
+    }
+
+    return 0;
+}
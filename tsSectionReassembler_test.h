@@ -0,0 +1,353 @@
+/**
+
+\file tsSectionReassembler_test.h -- contains the cxxtest test cases for the TS section reassembler
+
+The captures are built in memory: a PAT and a PMT long enough to span packets,
+repeated with running continuity counters, like a recording of a single
+program.  The fuzz cases cut, drop, duplicate and corrupt the capture with a
+fixed seed and check that only correct sections come out.
+*/
+
+#if !defined(TS_SECTION_REASSEMBLER_TEST_H)
+#define TS_SECTION_REASSEMBLER_TEST_H
+
+#include <cxxtest/TestSuite.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#include "tsSectionReassembler.h"
+#include "crc32.h"
+
+#define kTestPmtPid   0x100
+
+class tsSectionReassemblerTestSuite : public CxxTest::TestSuite
+{
+public:
+
+    struct Received
+    {
+        std::vector< std::vector<uint8_t> > sections;
+        std::vector<uint16_t> pids;
+    };
+
+    static void onSection(void *ctx, uint16_t pid, const uint8_t *section, uint32_t size)
+    {
+        Received *received = (Received *) ctx;
+        received->sections.push_back(std::vector<uint8_t>(section, section + size));
+        received->pids.push_back(pid);
+    }
+
+    // section with the given payload and a correct CRC_32
+    static std::vector<uint8_t> makeSection(uint8_t tableId, uint32_t payloadSize, uint8_t fill)
+    {
+        std::vector<uint8_t> section(3 + 5 + payloadSize + 4);
+        uint32_t sectionLength = section.size() - 3;
+
+        section[0] = tableId;
+        section[1] = 0xB0 | (sectionLength >> 8);
+        section[2] = sectionLength & 0xFF;
+        section[3] = 0x00;
+        section[4] = 0x01;
+        section[5] = 0xC1;
+        for (uint32_t i = 8; i < section.size() - 4; i++)
+        {
+            section[i] = fill + i;
+        }
+
+        unsigned int crc = MSPCrc32::compute(0xFFFFFFFF, &section[0], section.size() - 4);
+        section[section.size() - 4] = crc >> 24;
+        section[section.size() - 3] = crc >> 16;
+        section[section.size() - 2] = crc >> 8;
+        section[section.size() - 1] = crc;
+        return section;
+    }
+
+    // packetizes sections back to back on pid, a new section starts where the previous ends
+    static void packetize(std::vector<uint8_t> &ts, uint16_t pid, const std::vector<uint8_t> &sections, uint8_t *cc)
+    {
+        uint32_t pos = 0;
+        bool first = true;
+
+        while (pos < sections.size())
+        {
+            uint8_t packet[kTsPacketSize];
+            uint32_t offset = 4;
+
+            memset(packet, 0xFF, sizeof(packet));
+            packet[0] = kTsSyncByte;
+            packet[1] = (pid >> 8) & 0x1F;
+            packet[2] = pid & 0xFF;
+            packet[3] = 0x10 | (*cc & 0xF);
+            (*cc)++;
+
+            if (first)
+            {
+                packet[1] |= 0x40;
+                packet[offset++] = 0;
+                first = false;
+            }
+
+            uint32_t length = kTsPacketSize - offset;
+            if (length > sections.size() - pos)
+            {
+                length = sections.size() - pos;
+            }
+            memcpy(packet + offset, &sections[pos], length);
+            pos += length;
+            ts.insert(ts.end(), packet, packet + kTsPacketSize);
+        }
+    }
+
+    static void buildCapture(std::vector<uint8_t> &ts, std::vector<uint8_t> &pat, std::vector<uint8_t> &pmt, int repeat)
+    {
+        uint8_t patCc = 0;
+        uint8_t pmtCc = 0;
+
+        pat = makeSection(0x00, 4, 0x10);
+        pmt = makeSection(0x02, 400, 0x20);     // three packets
+        for (int i = 0; i < repeat; i++)
+        {
+            packetize(ts, 0, pat, &patCc);
+            packetize(ts, kTestPmtPid, pmt, &pmtCc);
+        }
+    }
+
+    void test_whole_packets(void)
+    {
+        std::vector<uint8_t> ts, pat, pmt;
+        Received received;
+        TsSectionReassembler reassembler(onSection, &received);
+
+        buildCapture(ts, pat, pmt, 4);
+        reassembler.enablePid(0);
+        reassembler.enablePid(kTestPmtPid);
+        TS_ASSERT(reassembler.pushBytes(&ts[0], ts.size()) == ts.size() / kTsPacketSize);
+
+        TS_ASSERT(received.sections.size() == 8);
+        for (unsigned int i = 0; i < received.sections.size(); i++)
+        {
+            TS_ASSERT(received.sections[i] == ((i & 1) ? pmt : pat));
+            TS_ASSERT(received.pids[i] == ((i & 1) ? kTestPmtPid : 0));
+        }
+    }
+
+    void test_sections_sharing_packets(void)
+    {
+        std::vector<uint8_t> ts, all;
+        Received received;
+        TsSectionReassembler reassembler(onSection, &received);
+        uint8_t cc = 0;
+
+        // three sections back to back, the pointer_field of a packet points at the first start in it,
+        // the next ones follow the end of the previous section
+        for (int i = 0; i < 3; i++)
+        {
+            std::vector<uint8_t> section = makeSection(0x02, 100 + 50 * i, i);
+            all.insert(all.end(), section.begin(), section.end());
+        }
+
+        uint32_t pos = 0;
+        std::vector<uint32_t> starts;
+        for (int i = 0; i < 3; i++)
+        {
+            starts.push_back(pos);
+            pos += 3 + (((all[pos + 1] & 0x0F) << 8) | all[pos + 2]);
+        }
+        pos = 0;
+        while (pos < all.size())
+        {
+            uint8_t packet[kTsPacketSize];
+            memset(packet, 0xFF, sizeof(packet));
+            packet[0] = kTsSyncByte;
+            packet[1] = (kTestPmtPid >> 8) & 0x1F;
+            packet[2] = kTestPmtPid & 0xFF;
+            packet[3] = 0x10 | (cc++ & 0xF);
+
+            uint32_t end = pos + kTsPacketSize - 5;
+            uint32_t next = 0;
+            bool start = false;
+            for (unsigned int i = 0; i < starts.size(); i++)
+            {
+                if ((starts[i] >= pos) && (starts[i] < end))
+                {
+                    next = starts[i];
+                    start = true;
+                    break;
+                }
+            }
+            uint32_t offset = 4;
+            if (start)
+            {
+                packet[1] |= 0x40;
+                packet[offset++] = next - pos;
+            }
+            uint32_t length = kTsPacketSize - offset;
+            if (length > all.size() - pos)
+            {
+                length = all.size() - pos;
+            }
+            memcpy(packet + offset, &all[pos], length);
+            pos += length;
+            ts.insert(ts.end(), packet, packet + kTsPacketSize);
+        }
+        reassembler.enablePid(kTestPmtPid);
+        reassembler.pushBytes(&ts[0], ts.size());
+        TS_ASSERT(received.sections.size() == 3);
+        for (unsigned int i = 0; i < received.sections.size(); i++)
+        {
+            TS_ASSERT(received.sections[i].size() == 3 + 5 + 100 + 50 * i + 4);
+        }
+    }
+
+    void test_split_and_sync_loss(void)
+    {
+        std::vector<uint8_t> ts, pat, pmt;
+        Received received;
+        TsSectionReassembler reassembler(onSection, &received);
+
+        buildCapture(ts, pat, pmt, 8);
+
+        // garbage ahead of the capture and between two halves
+        std::vector<uint8_t> stream(37, 0x47);
+        stream.insert(stream.end(), ts.begin(), ts.begin() + 4 * kTsPacketSize);
+        stream.insert(stream.end(), 55, 0x00);
+        stream.insert(stream.end(), ts.begin() + 4 * kTsPacketSize, ts.end());
+
+        reassembler.enablePid(0);
+        reassembler.enablePid(kTestPmtPid);
+        srand(3);
+        uint32_t pos = 0;
+        while (pos < stream.size())
+        {
+            uint32_t length = 1 + (rand() % 400);
+            if (length > stream.size() - pos)
+            {
+                length = stream.size() - pos;
+            }
+            reassembler.pushBytes(&stream[pos], length);
+            pos += length;
+        }
+
+        tTsSectionStats stats;
+        reassembler.getStats(&stats);
+        TS_ASSERT(stats.syncLosses >= 1);
+        TS_ASSERT(received.sections.size() == 16);
+        for (unsigned int i = 0; i < received.sections.size(); i++)
+        {
+            TS_ASSERT(received.sections[i] == ((i & 1) ? pmt : pat));
+        }
+    }
+
+    void test_continuity(void)
+    {
+        std::vector<uint8_t> ts, pat, pmt;
+        Received received;
+        TsSectionReassembler reassembler(onSection, &received);
+
+        buildCapture(ts, pat, pmt, 2);
+
+        // packets: PAT, PMT x3, PAT, PMT x3 - duplicate the first PMT packet, drop the second PMT's middle packet
+        std::vector<uint8_t> stream;
+        stream.insert(stream.end(), ts.begin(), ts.begin() + 2 * kTsPacketSize);
+        stream.insert(stream.end(), ts.begin() + kTsPacketSize, ts.begin() + 5 * kTsPacketSize);
+        stream.insert(stream.end(), ts.begin() + 6 * kTsPacketSize, ts.end());
+
+        reassembler.enablePid(0);
+        reassembler.enablePid(kTestPmtPid);
+        reassembler.pushBytes(&stream[0], stream.size());
+
+        tTsSectionStats stats;
+        reassembler.getStats(&stats);
+        TS_ASSERT(stats.ccErrors == 1);
+        TS_ASSERT(received.sections.size() == 3);
+        TS_ASSERT(received.sections[1] == pmt);
+    }
+
+    void test_fuzz(void)
+    {
+        std::vector<uint8_t> ts, pat, pmt;
+
+        buildCapture(ts, pat, pmt, 64);
+        srand(7);
+
+        for (int round = 0; round < 200; round++)
+        {
+            std::vector<uint8_t> stream(ts);
+            Received received;
+            TsSectionReassembler reassembler(onSection, &received);
+
+            int mutations = 1 + rand() % 16;
+            for (int i = 0; i < mutations; i++)
+            {
+                uint32_t pos = rand() % stream.size();
+                switch (rand() % 4)
+                {
+                case 0:
+                    stream[pos] ^= 1 << (rand() % 8);
+                    break;
+                case 1:
+                    stream[pos] = rand();
+                    break;
+                case 2:
+                {
+                    uint32_t length = rand() % 200;
+                    if (length > stream.size() - pos)
+                    {
+                        length = stream.size() - pos;
+                    }
+                    stream.erase(stream.begin() + pos, stream.begin() + pos + length);
+                    break;
+                }
+                default:
+                {
+                    // repeat up to a packet
+                    uint32_t length = rand() % kTsPacketSize;
+                    if (length > stream.size() - pos)
+                    {
+                        length = stream.size() - pos;
+                    }
+                    std::vector<uint8_t> copy(stream.begin() + pos, stream.begin() + pos + length);
+                    stream.insert(stream.begin() + pos, copy.begin(), copy.end());
+                    break;
+                }
+                }
+                if (stream.empty())
+                {
+                    stream = ts;
+                }
+            }
+
+            reassembler.enablePid(0);
+            reassembler.enablePid(kTestPmtPid);
+            uint32_t pos = 0;
+            while (pos < stream.size())
+            {
+                uint32_t length = 1 + (rand() % 1000);
+                if (length > stream.size() - pos)
+                {
+                    length = stream.size() - pos;
+                }
+                reassembler.pushBytes(&stream[pos], length);
+                pos += length;
+            }
+
+            // whatever is damaged, a delivered section has a correct CRC and a sane length
+            for (unsigned int i = 0; i < received.sections.size(); i++)
+            {
+                std::vector<uint8_t> &section = received.sections[i];
+                TS_ASSERT(section.size() >= 3);
+                TS_ASSERT(section.size() == 3 + ((((uint32_t) section[1] & 0x0F) << 8) | section[2]));
+                if (section[1] & 0x80)
+                {
+                    TS_ASSERT(MSPCrc32::compute(0xFFFFFFFF, &section[0], section.size()) == 0);
+                }
+            }
+        }
+    }
+
+};
+
+
+#endif
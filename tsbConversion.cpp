@@ -0,0 +1,146 @@
+/**
+   \file tsbConversion.cpp
+   \class TsbConversion
+
+Implementation file for the conversion of the TSB into a persistent recording
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/statvfs.h>
+#include <dlog.h>
+
+#include "tsbConversion.h"
+#include "drivePlacement.h"
+
+#define LOG(level, msg, args...)  dlog(DL_MSP_DVR, level,"TsbConversion:%s:%d " msg, __FUNCTION__, __LINE__, ##args);
+
+static const char *modeNames[kTsbConvert_Modes] = { "adopt", "copy" };
+
+TsbConversion* TsbConversion::mInstance = NULL;
+pthread_mutex_t TsbConversion::mInstanceMutex = PTHREAD_MUTEX_INITIALIZER;
+
+TsbConversion* TsbConversion::getInstance(void)
+{
+    pthread_mutex_lock(&mInstanceMutex);
+    if (mInstance == NULL)
+    {
+        mInstance = new TsbConversion();
+    }
+    pthread_mutex_unlock(&mInstanceMutex);
+    return mInstance;
+}
+
+TsbConversion::TsbConversion()
+{
+    pthread_mutex_init(&mMutex, NULL);
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+TsbConversion::~TsbConversion()
+{
+    pthread_mutex_destroy(&mMutex);
+}
+
+uint64_t TsbConversion::freeBytes(const char *mount)
+{
+    struct statvfs fs;
+    if (statvfs(mount, &fs) != 0)
+    {
+        return 0;
+    }
+    return (uint64_t) fs.f_bavail * fs.f_frsize;
+}
+
+eTsbConvertMode TsbConversion::modeOf(const std::string &tsbFile, const std::string &recFile)
+{
+    int tsbDrive = DrivePlacement::driveOf(tsbFile);
+    int recDrive = DrivePlacement::driveOf(recFile);
+
+    // a recording with no drive is made on the one of the TSB
+    return ((recDrive == -1) || (recDrive == tsbDrive)) ? kTsbConvert_Adopt : kTsbConvert_Copy;
+}
+
+std::string TsbConversion::placeRecording(const std::string &tsbFile, const std::string &recFile, uint32_t bufferMs)
+{
+    int tsbDrive = DrivePlacement::driveOf(tsbFile);
+    int recDrive = DrivePlacement::driveOf(recFile);
+    if ((tsbDrive == -1) || (recDrive == -1) || (tsbDrive == recDrive))
+    {
+        return recFile;
+    }
+
+    char mount[64];
+    snprintf(mount, sizeof(mount), kDrivePlacementMountFormat, tsbDrive);
+    uint64_t needed = ((uint64_t) kDrivePlacementStreamKbps * 1000 / 8) * ((bufferMs / 1000) + kTsbConversionReserveSecs);
+    uint64_t available = freeBytes(mount);
+    if (available < needed)
+    {
+        pthread_mutex_lock(&mMutex);
+        mStats.noRoom++;
+        pthread_mutex_unlock(&mMutex);
+        LOG(DLOGL_NORMAL, "%s copied, TSB drive %d has %llu MB free for %llu MB", recFile.c_str(), tsbDrive,
+            (unsigned long long)(available >> 20), (unsigned long long)(needed >> 20));
+        return recFile;
+    }
+
+    std::string placed = recFile;
+    placed[placed.find("mnt/dvr") + 7] = '0' + tsbDrive;
+    pthread_mutex_lock(&mMutex);
+    mStats.relocated++;
+    pthread_mutex_unlock(&mMutex);
+    LOG(DLOGL_NOISE, "%s asked on drive %d, converted in place as %s", recFile.c_str(), recDrive, placed.c_str());
+    return placed;
+}
+
+void TsbConversion::addTime(eTsbConvertMode mode, uint32_t bufferMs, uint32_t elapsedMs)
+{
+    if (mode >= kTsbConvert_Modes)
+    {
+        return;
+    }
+
+    unsigned int bucket = bufferMs / (kTsbConversionBucketMins * 60 * 1000);
+    if (bucket >= kTsbConversionBuckets)
+    {
+        bucket = kTsbConversionBuckets - 1;
+    }
+
+    pthread_mutex_lock(&mMutex);
+    tTsbConversionTime &time = mStats.times[mode][bucket];
+    time.conversions++;
+    time.totalMs += elapsedMs;
+    if (elapsedMs > time.maxMs)
+    {
+        time.maxMs = elapsedMs;
+    }
+    pthread_mutex_unlock(&mMutex);
+    LOG(DLOGL_NORMAL, "%s of %u s buffered started in %u ms", modeNames[mode], bufferMs / 1000, elapsedMs);
+}
+
+void TsbConversion::getStats(tTsbConversionStats *stats)
+{
+    pthread_mutex_lock(&mMutex);
+    *stats = mStats;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void TsbConversion::logStats(void)
+{
+    tTsbConversionStats stats;
+
+    getStats(&stats);
+    for (int mode = 0; mode < kTsbConvert_Modes; mode++)
+    {
+        for (int bucket = 0; bucket < kTsbConversionBuckets; bucket++)
+        {
+            const tTsbConversionTime &time = stats.times[mode][bucket];
+            if (time.conversions > 0)
+            {
+                LOG(DLOGL_NORMAL, "%s, %d+ minutes buffered: conversions:%u average:%u max:%u ms", modeNames[mode],
+                    bucket * kTsbConversionBucketMins, time.conversions, time.totalMs / time.conversions, time.maxMs);
+            }
+        }
+    }
+    LOG(DLOGL_NORMAL, "relocated:%u noRoom:%u", stats.relocated, stats.noRoom);
+}
@@ -0,0 +1,92 @@
+/**
+   \file tsbConversion.h
+   \class TsbConversion
+
+   Conversion of the TSB into a persistent recording when Record is hit
+   in the middle of a show.
+
+   cpe_record_TSBConversionStart() turns the buffered range into the
+   recording.  When the recording file is on the drive of the TSB the
+   platform keeps the blocks already written and only writes the new
+   index and metadata; on another drive it has to copy the whole range
+   first, about 3.8GB for half an hour at TSB_VIDEO_BITRATE, while the
+   tuner keeps recording.
+
+   placeRecording() moves a recording asked on another drive onto the
+   drive of its TSB, unless that drive lacks the room for what is
+   buffered and kTsbConversionReserveSecs more, in which case the
+   recording stays where it was asked and is copied.  The time of each
+   conversion is kept by mode and by buffer length, in buckets of
+   kTsbConversionBucketMins.
+*/
+
+#if !defined(TSB_CONVERSION_H)
+#define TSB_CONVERSION_H
+
+#include <stdint.h>
+#include <string>
+#include <pthread.h>
+
+#define kTsbConversionBuckets       4       ///< under 30, 60 and 90 minutes buffered, and longer
+#define kTsbConversionBucketMins    30
+#define kTsbConversionReserveSecs   3600    ///< room left for the rest of the show once converted
+
+typedef enum
+{
+    kTsbConvert_Adopt,          ///< recording on the drive of the TSB, blocks kept
+    kTsbConvert_Copy,           ///< recording on another drive, buffered range copied
+    kTsbConvert_Modes
+} eTsbConvertMode;
+
+typedef struct
+{
+    unsigned int conversions;
+    uint32_t     totalMs;
+    uint32_t     maxMs;
+} tTsbConversionTime;
+
+typedef struct
+{
+    tTsbConversionTime times[kTsbConvert_Modes][kTsbConversionBuckets];
+    unsigned int relocated;     ///< recordings moved to the drive of their TSB
+    unsigned int noRoom;        ///< left on another drive, the TSB drive being full
+} tTsbConversionStats;
+
+class TsbConversion
+{
+public:
+    static TsbConversion* getInstance(void);
+
+    /// The unit test uses its own conversion, the record sessions the one of getInstance()
+    TsbConversion();
+    virtual ~TsbConversion();
+
+    /// Recording file to convert bufferMs of tsbFile into: recFile, or
+    /// recFile on the drive of the TSB when it was asked on another one
+    std::string placeRecording(const std::string &tsbFile, const std::string &recFile, uint32_t bufferMs);
+
+    /// kTsbConvert_Adopt when both files are on the same record drive
+    static eTsbConvertMode modeOf(const std::string &tsbFile, const std::string &recFile);
+
+    /// A conversion of bufferMs took elapsedMs to start
+    void addTime(eTsbConvertMode mode, uint32_t bufferMs, uint32_t elapsedMs);
+
+    void getStats(tTsbConversionStats *stats);
+    void logStats(void);
+
+protected:
+    /// Bytes free on the drive mounted on mount, overridden by the unit test
+    virtual uint64_t freeBytes(const char *mount);
+
+private:
+    pthread_mutex_t     mMutex;
+    tTsbConversionStats mStats;
+
+    static TsbConversion *mInstance;
+    static pthread_mutex_t mInstanceMutex;
+
+    TsbConversion(const TsbConversion&);
+    TsbConversion& operator=(const TsbConversion&);
+};
+
+#endif
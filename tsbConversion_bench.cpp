@@ -0,0 +1,160 @@
+/** @file tsbConversion_bench.cpp
+ *
+ * @brief Measures converting 30, 60 and 90 minutes of TSB into a recording,
+ * keeping the blocks written against copying them.
+ *
+ * A file of the size the TSB has for each buffer length at
+ * kDrivePlacementStreamKbps is written to the TSB directory (argument 1,
+ * /tmp by default), synced and dropped from the page cache.  It is then
+ * made into a recording of the recording directory (argument 2, the TSB
+ * directory by default):
+ *  - in place, linking the blocks already on the drive to the recording
+ *    and writing the recording metadata, what the platform can do when
+ *    the recording is on the drive of the TSB,
+ *  - copied, reading the buffer back and writing it to the recording
+ *    before the metadata, what a recording on another drive takes.
+ * Give a directory of the other record drive as argument 2 to have the
+ * copy cross the drives; linking is then not possible and only the copy
+ * is measured.  Argument 3 lowers the bitrate for a small disk.
+ * Build with "make tsbConversion_bench" and run on the target.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "drivePlacement.h"
+
+#define kBenchBlockSize     (1024 * 1024)
+#define kBenchMetadataSize  4096
+
+static double nowSecs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+static bool writeFile(const std::string &file, uint64_t size, const std::vector<char> &block)
+{
+    int fd = open(file.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        return false;
+    }
+    for (uint64_t done = 0; done < size;)
+    {
+        size_t chunk = (size - done < block.size()) ? (size_t)(size - done) : block.size();
+        if (write(fd, &block[0], chunk) != (ssize_t) chunk)
+        {
+            close(fd);
+            return false;
+        }
+        done += chunk;
+    }
+    fsync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+    return true;
+}
+
+static bool copyFile(const std::string &from, const std::string &to, std::vector<char> &block)
+{
+    int in = open(from.c_str(), O_RDONLY);
+    int out = open(to.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    bool ok = (in >= 0) && (out >= 0);
+    ssize_t got;
+
+    posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+    while (ok && ((got = read(in, &block[0], block.size())) > 0))
+    {
+        ok = (write(out, &block[0], got) == got);
+    }
+    if (out >= 0)
+    {
+        fsync(out);
+        posix_fadvise(out, 0, 0, POSIX_FADV_DONTNEED);
+        close(out);
+    }
+    if (in >= 0)
+    {
+        close(in);
+    }
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    std::string tsbDir = (argc > 1) ? argv[1] : "/tmp";
+    std::string recDir = (argc > 2) ? argv[2] : tsbDir;
+    uint32_t kbps = (argc > 3) ? atoi(argv[3]) : kDrivePlacementStreamKbps;
+    std::string tsb = tsbDir + "/tcBenchTsb";
+    std::string rec = recDir + "/tcBenchRec";
+    std::string meta = recDir + "/tcBenchRec.meta";
+    std::vector<char> metadata(kBenchMetadataSize, 0x5a);
+    std::vector<char> block(kBenchBlockSize, 0x47);
+    static const int minutes[] = { 30, 60, 90 };
+
+    printf("TSB in %s, recording in %s, %u kbps\n", tsbDir.c_str(), recDir.c_str(), kbps);
+    for (unsigned int i = 0; i < sizeof(minutes) / sizeof(minutes[0]); i++)
+    {
+        uint64_t size = ((uint64_t) kbps * 1000 / 8) * minutes[i] * 60;
+        double start = nowSecs();
+        if (!writeFile(tsb, size, block))
+        {
+            printf("error writing %s: %s\n", tsb.c_str(), strerror(errno));
+            return 1;
+        }
+        double writeSecs = nowSecs() - start;
+
+        // in place: the blocks of the TSB become the recording, the metadata is new
+        double adoptMs = -1;
+        start = nowSecs();
+        if (link(tsb.c_str(), rec.c_str()) == 0)
+        {
+            if (!writeFile(meta, metadata.size(), metadata))
+            {
+                printf("error writing %s\n", meta.c_str());
+                return 1;
+            }
+            adoptMs = (nowSecs() - start) * 1000;
+            unlink(rec.c_str());
+            unlink(meta.c_str());
+        }
+        else if (errno != EXDEV)
+        {
+            printf("error linking %s: %s\n", rec.c_str(), strerror(errno));
+            return 1;
+        }
+
+        start = nowSecs();
+        if (!copyFile(tsb, rec, block) || !writeFile(meta, metadata.size(), metadata))
+        {
+            printf("error copying to %s: %s\n", rec.c_str(), strerror(errno));
+            return 1;
+        }
+        double copyMs = (nowSecs() - start) * 1000;
+        unlink(rec.c_str());
+        unlink(meta.c_str());
+        unlink(tsb.c_str());
+
+        printf("%2d minutes, %5llu MB (written at %.0f MB/s): ", minutes[i], (unsigned long long)(size >> 20),
+               (size >> 20) / writeSecs);
+        if (adoptMs >= 0)
+        {
+            printf("in place %8.3f ms  ", adoptMs);
+        }
+        else
+        {
+            printf("in place   other drive  ");
+        }
+        printf("copied %10.1f ms\n", copyMs);
+    }
+    return 0;
+}
@@ -0,0 +1,106 @@
+/**
+
+\file tsbConversion_test.h -- contains the cxxtest test cases for the TSB conversion
+
+The free space of the record drives is simulated by the test.
+*/
+
+#if !defined(TSB_CONVERSION_TEST_H)
+#define TSB_CONVERSION_TEST_H
+
+#include <cxxtest/TestSuite.h>
+
+#include "tsbConversion.h"
+#include "drivePlacement.h"
+
+class TestTsbConversion : public TsbConversion
+{
+public:
+    TestTsbConversion()
+    {
+        mFree = 0;
+    }
+
+    uint64_t mFree;
+
+protected:
+    uint64_t freeBytes(const char *mount)
+    {
+        (void) mount;
+        return mFree;
+    }
+};
+
+class tsbConversionTestSuite : public CxxTest::TestSuite
+{
+    // what an hour buffered and the reserve take at the TSB bitrate
+    static uint64_t hourRoom(void)
+    {
+        return ((uint64_t) kDrivePlacementStreamKbps * 1000 / 8) * (3600 + kTsbConversionReserveSecs);
+    }
+
+public:
+
+    void testModeOf()
+    {
+        TS_ASSERT_EQUALS(TsbConversion::modeOf("/mnt/dvr0/dvr002", "/mnt/dvr0/J07IJ0gG"), kTsbConvert_Adopt);
+        TS_ASSERT_EQUALS(TsbConversion::modeOf("/mnt/dvr0/dvr002", "/mnt/dvr1/J07IJ0gG"), kTsbConvert_Copy);
+        TS_ASSERT_EQUALS(TsbConversion::modeOf("/mnt/dvr1/dvr001", "J07IJ0gG"), kTsbConvert_Adopt);
+    }
+
+    void testPlaceRecording()
+    {
+        TestTsbConversion conversion;
+        tTsbConversionStats stats;
+
+        // the TSB drive holds what is buffered: the recording follows the TSB
+        conversion.mFree = hourRoom();
+        TS_ASSERT_EQUALS(conversion.placeRecording("/mnt/dvr0/dvr002", "/mnt/dvr1/J07IJ0gG", 3600 * 1000),
+                         std::string("/mnt/dvr0/J07IJ0gG"));
+        TS_ASSERT_EQUALS(conversion.placeRecording("/mnt/dvr1/dvr001", "/mnt/dvr0/J07IJ0gH", 3600 * 1000),
+                         std::string("/mnt/dvr1/J07IJ0gH"));
+
+        // already there, or nothing to go by
+        TS_ASSERT_EQUALS(conversion.placeRecording("/mnt/dvr0/dvr002", "/mnt/dvr0/J07IJ0gG", 3600 * 1000),
+                         std::string("/mnt/dvr0/J07IJ0gG"));
+        TS_ASSERT_EQUALS(conversion.placeRecording("", "/mnt/dvr1/J07IJ0gG", 3600 * 1000),
+                         std::string("/mnt/dvr1/J07IJ0gG"));
+
+        // a longer buffer than the TSB drive has room for is copied where it was asked
+        TS_ASSERT_EQUALS(conversion.placeRecording("/mnt/dvr0/dvr002", "/mnt/dvr1/J07IJ0gG", 3601 * 1000),
+                         std::string("/mnt/dvr1/J07IJ0gG"));
+        conversion.mFree = 0;
+        TS_ASSERT_EQUALS(conversion.placeRecording("/mnt/dvr0/dvr002", "/mnt/dvr1/J07IJ0gG", 0),
+                         std::string("/mnt/dvr1/J07IJ0gG"));
+
+        conversion.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.relocated, 2u);
+        TS_ASSERT_EQUALS(stats.noRoom, 2u);
+    }
+
+    void testTimes()
+    {
+        TestTsbConversion conversion;
+        tTsbConversionStats stats;
+
+        conversion.addTime(kTsbConvert_Adopt, 10 * 60 * 1000, 40);
+        conversion.addTime(kTsbConvert_Adopt, 30 * 60 * 1000, 50);
+        conversion.addTime(kTsbConvert_Adopt, 45 * 60 * 1000, 70);
+        conversion.addTime(kTsbConvert_Copy, 60 * 60 * 1000, 90000);
+        conversion.addTime(kTsbConvert_Copy, 90 * 60 * 1000, 130000);
+        conversion.addTime(kTsbConvert_Copy, 200 * 60 * 1000, 250000);
+        conversion.addTime(kTsbConvert_Modes, 0, 1);
+
+        conversion.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.times[kTsbConvert_Adopt][0].conversions, 1u);
+        TS_ASSERT_EQUALS(stats.times[kTsbConvert_Adopt][1].conversions, 2u);
+        TS_ASSERT_EQUALS(stats.times[kTsbConvert_Adopt][1].totalMs, 120u);
+        TS_ASSERT_EQUALS(stats.times[kTsbConvert_Adopt][1].maxMs, 70u);
+        TS_ASSERT_EQUALS(stats.times[kTsbConvert_Copy][1].conversions, 0u);
+        TS_ASSERT_EQUALS(stats.times[kTsbConvert_Copy][2].conversions, 1u);
+        TS_ASSERT_EQUALS(stats.times[kTsbConvert_Copy][3].conversions, 2u);
+        TS_ASSERT_EQUALS(stats.times[kTsbConvert_Copy][3].maxMs, 250000u);
+    }
+};
+
+#endif
@@ -0,0 +1,449 @@
+/**
+   \file tsbPool.cpp
+   \class TsbPool
+
+Implementation file for the pool of the TSB buffers
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <dlog.h>
+#include "pthread_named.h"
+
+#include "tsbPool.h"
+#include "monotonicTime.h"
+
+#define LOG(level, msg, args...)  dlog(DL_MSP_DVR, level,"TsbPool:%s:%d " msg, __FUNCTION__, __LINE__, ##args);
+
+TsbPool::TsbPool(unsigned int buffers, uint64_t bufferBytes, const char *mountFormat)
+{
+    pthread_mutex_init(&mMutex, NULL);
+    pthread_cond_init(&mCond, NULL);
+    mThreadStarted = false;
+    mExit = false;
+    mBufferCount = (buffers < kTsbPoolMaxBuffers) ? buffers : kTsbPoolMaxBuffers;
+    mBufferBytes = bufferBytes;
+    mMountFormat = mountFormat;
+
+    for (int drive = 0; drive < kTsbPoolMaxDrives; drive++)
+    {
+        mDrivePrepared[drive] = false;
+        for (unsigned int tsb = 0; tsb < kTsbPoolMaxBuffers; tsb++)
+        {
+            mBuffers[drive][tsb].fd = -1;
+            mBuffers[drive][tsb].ready = false;
+        }
+    }
+    for (unsigned int tsb = 0; tsb < kTsbPoolMaxBuffers; tsb++)
+    {
+        mTsbs[tsb].inUse = false;
+        mTsbs[tsb].ready = false;
+        mTsbs[tsb].drive = -1;
+    }
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+TsbPool::~TsbPool()
+{
+    pthread_mutex_lock(&mMutex);
+    mExit = true;
+    bool started = mThreadStarted;
+    pthread_cond_broadcast(&mCond);
+    pthread_mutex_unlock(&mMutex);
+
+    if (started)
+    {
+        pthread_join(mThread, NULL);
+    }
+
+    for (int drive = 0; drive < kTsbPoolMaxDrives; drive++)
+    {
+        for (unsigned int tsb = 0; tsb < kTsbPoolMaxBuffers; tsb++)
+        {
+            if (mBuffers[drive][tsb].fd >= 0)
+            {
+                close(mBuffers[drive][tsb].fd);
+            }
+        }
+    }
+    pthread_cond_destroy(&mCond);
+    pthread_mutex_destroy(&mMutex);
+}
+
+uint64_t TsbPool::nowMs(void)
+{
+    return monotonicNowMs();
+}
+
+bool TsbPool::driveMounted(const char *mount)
+{
+    struct stat st;
+    struct stat parent;
+    std::string up = std::string(mount) + "/..";
+
+    // a mount point is on another device than its parent directory
+    return (stat(mount, &st) == 0) && S_ISDIR(st.st_mode) &&
+           (stat(up.c_str(), &parent) == 0) && (st.st_dev != parent.st_dev);
+}
+
+void TsbPool::start(void)
+{
+    pthread_mutex_lock(&mMutex);
+    if (!mThreadStarted)
+    {
+        if (pthread_create(&mThread, NULL, PrepareThread, this) != 0)
+        {
+            LOG(DLOGL_ERROR, ":%m: Error creating the TSB pool thread");
+        }
+        else
+        {
+            mThreadStarted = true;
+            if (pthread_setname_np(mThread, "TSB Pool") != 0)
+            {
+                LOG(DLOGL_ERROR, "ERROR: %m: Thread Setname Failed.");
+            }
+        }
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+void *TsbPool::PrepareThread(void *arg)
+{
+    TsbPool *pool = (TsbPool *) arg;
+
+    pthread_mutex_lock(&pool->mMutex);
+    while (!pool->mExit)
+    {
+        if (pool->mPending.empty())
+        {
+            pthread_cond_wait(&pool->mCond, &pool->mMutex);
+            continue;
+        }
+        pthread_mutex_unlock(&pool->mMutex);
+        pool->runPending();
+        pthread_mutex_lock(&pool->mMutex);
+    }
+    pthread_mutex_unlock(&pool->mMutex);
+    return NULL;
+}
+
+std::string TsbPool::bufferPath(int drive, unsigned int tsb)
+{
+    char path[64];
+
+    // same name as MSPRecordSession::SetTsbFileName()
+    snprintf(path, sizeof(path), mMountFormat.c_str(), drive);
+    snprintf(path + strlen(path), sizeof(path) - strlen(path), "/dvr00%d", tsb + 1);
+    return path;
+}
+
+// called with mMutex held
+void TsbPool::queue(int drive, unsigned int tsb, bool drop)
+{
+    for (std::list<Job>::iterator itr = mPending.begin(); itr != mPending.end(); ++itr)
+    {
+        if ((itr->drive == drive) && (itr->tsb == tsb) && (itr->drop == drop))
+        {
+            return;
+        }
+    }
+
+    Job job;
+    job.drive = drive;
+    job.tsb = tsb;
+    job.drop = drop;
+    mPending.push_back(job);
+    pthread_cond_broadcast(&mCond);
+}
+
+void TsbPool::prepareDrive(int drive)
+{
+    if ((drive < 0) || (drive >= kTsbPoolMaxDrives))
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&mMutex);
+    if (!mDrivePrepared[drive])
+    {
+        unsigned int count = 0;
+        mDrivePrepared[drive] = true;
+        for (unsigned int tsb = 0; tsb < mBufferCount; tsb++)
+        {
+            // the numbers that have a drive keep their buffer there
+            if (mTsbs[tsb].drive == -1)
+            {
+                mTsbs[tsb].drive = drive;
+                queue(drive, tsb, false);
+                count++;
+            }
+        }
+        LOG(DLOGL_NORMAL, "drive %d: %d buffers of %llu bytes", drive, count, (unsigned long long) mBufferBytes);
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+// reserves the blocks of the buffer and opens it, true when it is ready
+bool TsbPool::prepare(int drive, unsigned int tsb, bool *created)
+{
+    char mount[32];
+    struct stat st;
+    struct statvfs fs;
+    std::string path = bufferPath(drive, tsb);
+
+    *created = true;
+
+    // never fills the root file system when the drive is not mounted
+    snprintf(mount, sizeof(mount), mMountFormat.c_str(), drive);
+    if (!driveMounted(mount))
+    {
+        LOG(DLOGL_ERROR, "%s: no drive", mount);
+        return false;
+    }
+
+    // the recorder creates the file, the pool only works on one it left
+    int fd = open(path.c_str(), O_RDWR);
+    if (fd < 0)
+    {
+        *created = (errno != ENOENT);
+        if (*created)
+        {
+            LOG(DLOGL_ERROR, "%s: open: %m", path.c_str());
+        }
+        return false;
+    }
+
+    uint64_t allocated = 0;
+    if (fstat(fd, &st) == 0)
+    {
+        allocated = (uint64_t) st.st_blocks * 512;
+    }
+    if (allocated < mBufferBytes)
+    {
+        if ((fstatvfs(fd, &fs) != 0) ||
+                ((uint64_t) fs.f_bavail * fs.f_frsize < mBufferBytes - allocated))
+        {
+            LOG(DLOGL_ERROR, "%s: no room for %llu bytes", path.c_str(), (unsigned long long) mBufferBytes);
+            close(fd);
+            return false;
+        }
+
+        // blocks only, the size and the content stay what the recorder wrote
+        if ((fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, mBufferBytes) != 0) && (errno != EOPNOTSUPP))
+        {
+            LOG(DLOGL_ERROR, "%s: fallocate: %m", path.c_str());
+            close(fd);
+            return false;
+        }
+    }
+
+    pthread_mutex_lock(&mMutex);
+    mBuffers[drive][tsb].fd = fd;
+    mBuffers[drive][tsb].ready = true;
+    pthread_mutex_unlock(&mMutex);
+    return true;
+}
+
+// closes the buffer before it is prepared again, or gives back what the
+// pool reserved past the end of the file when the TSB left the drive
+void TsbPool::release(int drive, unsigned int tsb, bool drop)
+{
+    struct stat st;
+
+    pthread_mutex_lock(&mMutex);
+    int fd = mBuffers[drive][tsb].fd;
+    mBuffers[drive][tsb].fd = -1;
+    mBuffers[drive][tsb].ready = false;
+    pthread_mutex_unlock(&mMutex);
+
+    if (fd >= 0)
+    {
+        if (drop && (fstat(fd, &st) == 0) && (ftruncate(fd, st.st_size) != 0))
+        {
+            LOG(DLOGL_ERROR, "%s: ftruncate: %m", bufferPath(drive, tsb).c_str());
+        }
+        close(fd);
+    }
+}
+
+void TsbPool::runPending(void)
+{
+    pthread_mutex_lock(&mMutex);
+    while (!mPending.empty() && !mExit)
+    {
+        Job job = mPending.front();
+        mPending.pop_front();
+
+        if (job.drop)
+        {
+            if (mTsbs[job.tsb].drive == job.drive)
+            {
+                // came back to the drive meanwhile
+                continue;
+            }
+            pthread_mutex_unlock(&mMutex);
+            release(job.drive, job.tsb, true);
+            pthread_mutex_lock(&mMutex);
+            mStats.dropped++;
+            LOG(DLOGL_NOISE, "%s given back", bufferPath(job.drive, job.tsb).c_str());
+            continue;
+        }
+
+        if (mTsbs[job.tsb].inUse || (mTsbs[job.tsb].drive != job.drive))
+        {
+            // recycled again once released, or moved to another drive
+            continue;
+        }
+        pthread_mutex_unlock(&mMutex);
+
+        uint64_t start = nowMs();
+        bool created;
+        release(job.drive, job.tsb, false);
+        bool ok = prepare(job.drive, job.tsb, &created);
+        unsigned int ms = nowMs() - start;
+
+        pthread_mutex_lock(&mMutex);
+        if (ok)
+        {
+            mStats.prepared++;
+            if (ms > mStats.prepareMaxMs)
+            {
+                mStats.prepareMaxMs = ms;
+            }
+            LOG(DLOGL_MINOR_DEBUG, "%s ready in %d ms", bufferPath(job.drive, job.tsb).c_str(), ms);
+        }
+        else if (!created)
+        {
+            mStats.notCreated++;
+        }
+        else
+        {
+            mStats.prepareFailures++;
+        }
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+bool TsbPool::acquire(int drive, unsigned int tsb)
+{
+    bool ready = false;
+
+    pthread_mutex_lock(&mMutex);
+    if (tsb < mBufferCount)
+    {
+        // called under the mutex of the TsbHandler: a buffer being prepared is taken cold
+        bool known = (drive >= 0) && (drive < kTsbPoolMaxDrives);
+        ready = known && mBuffers[drive][tsb].ready;
+        mTsbs[tsb].inUse = true;
+        mTsbs[tsb].ready = ready;
+        if (known && (mTsbs[tsb].drive != drive))
+        {
+            if (mTsbs[tsb].drive != -1)
+            {
+                queue(mTsbs[tsb].drive, tsb, true);
+            }
+            mTsbs[tsb].drive = drive;
+        }
+    }
+    if (ready)
+    {
+        mStats.acquiredReady++;
+    }
+    else
+    {
+        mStats.acquiredCold++;
+    }
+    pthread_mutex_unlock(&mMutex);
+
+    LOG(DLOGL_NOISE, "TSB %d on drive %d %s", tsb, drive, ready ? "ready" : "cold");
+    return ready;
+}
+
+void TsbPool::recycle(unsigned int tsb)
+{
+    pthread_mutex_lock(&mMutex);
+    if ((tsb < mBufferCount) && mTsbs[tsb].inUse)
+    {
+        mTsbs[tsb].inUse = false;
+        mTsbs[tsb].ready = false;
+
+        // the recorder wrote to it, reserve and open it again on its drive
+        int drive = mTsbs[tsb].drive;
+        if (drive != -1)
+        {
+            mBuffers[drive][tsb].ready = false;
+            queue(drive, tsb, false);
+        }
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+void TsbPool::recordOpen(unsigned int tsb, unsigned int ms, bool ok)
+{
+    pthread_mutex_lock(&mMutex);
+    if (!ok)
+    {
+        mStats.openFailures++;
+    }
+    else if ((tsb < mBufferCount) && mTsbs[tsb].ready)
+    {
+        mStats.readyOpens++;
+        mStats.readyOpenTotalMs += ms;
+        if (ms > mStats.readyOpenMaxMs)
+        {
+            mStats.readyOpenMaxMs = ms;
+        }
+    }
+    else
+    {
+        mStats.coldOpens++;
+        mStats.coldOpenTotalMs += ms;
+        if (ms > mStats.coldOpenMaxMs)
+        {
+            mStats.coldOpenMaxMs = ms;
+        }
+    }
+    pthread_mutex_unlock(&mMutex);
+
+    LOG(DLOGL_NORMAL, "TSB %d %s in %d ms", tsb, ok ? "started" : "failed", ms);
+}
+
+bool TsbPool::isReady(int drive, unsigned int tsb)
+{
+    bool ready = false;
+
+    pthread_mutex_lock(&mMutex);
+    if ((drive >= 0) && (drive < kTsbPoolMaxDrives) && (tsb < mBufferCount))
+    {
+        ready = mBuffers[drive][tsb].ready;
+    }
+    pthread_mutex_unlock(&mMutex);
+    return ready;
+}
+
+void TsbPool::getStats(tTsbPoolStats *stats)
+{
+    pthread_mutex_lock(&mMutex);
+    *stats = mStats;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void TsbPool::logStats(void)
+{
+    tTsbPoolStats stats;
+
+    getStats(&stats);
+    LOG(DLOGL_NORMAL, "prepared:%d failed:%d not created:%d dropped:%d max ms:%d acquired ready:%d cold:%d",
+        stats.prepared, stats.prepareFailures, stats.notCreated, stats.dropped, stats.prepareMaxMs,
+        stats.acquiredReady, stats.acquiredCold);
+    LOG(DLOGL_NORMAL, "open ms ready:%d avg:%d max:%d cold:%d avg:%d max:%d failed:%d",
+        stats.readyOpens, stats.readyOpens ? stats.readyOpenTotalMs / stats.readyOpens : 0, stats.readyOpenMaxMs,
+        stats.coldOpens, stats.coldOpens ? stats.coldOpenTotalMs / stats.coldOpens : 0, stats.coldOpenMaxMs,
+        stats.openFailures);
+}
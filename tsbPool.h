@@ -0,0 +1,144 @@
+/**
+   \file tsbPool.h
+   \class TsbPool
+
+   Pool of the TSB buffers kept ready on the record drives.
+
+   The TSB of a record session is the file of its TSB number on the drive of
+   the session ("/mnt/dvr<drive>/dvr00<number + 1>").  The platform keeps that
+   file from one session to the next, but allocating its blocks as the TSB
+   fills puts the disk allocation in front of the first pause or rewind after
+   a tune.  The pool reserves the blocks of the TSB size ahead of time with
+   fallocate(FALLOC_FL_KEEP_SIZE) and keeps the file open.  The size and the
+   content of the file are left as the recorder wrote them, so the recorder
+   opens the same file it would without the pool, with its blocks allocated
+   and its inode in the cache.  The pool never creates a TSB file: a number
+   not used on its drive yet is left to the recorder.
+
+   Each TSB number has one drive of its own: the first drive prepareDrive()
+   is given, or the drive it last ran on.  Only that drive gets its buffer.
+   When acquire() moves a number to another drive, the blocks the pool
+   reserved past the end of the file on the old drive are given back.
+
+   The buffers follow the TSB numbers of the TsbHandler: acquire() marks a
+   number in use so that the pool does not prepare the file of a running TSB
+   again, and recycle() prepares it again for the next session once the
+   number is released.  acquire() does not wait for a buffer being prepared:
+   the reservation does not change what the recorder reads, so the TSB is
+   only counted as cold.  The open latency of the record sessions is kept
+   apart for the buffers that were ready and the ones that were not.
+*/
+
+#if !defined(TSB_POOL_H)
+#define TSB_POOL_H
+
+#include <stdint.h>
+#include <string>
+#include <list>
+#include <pthread.h>
+
+#define kTsbPoolMaxDrives       2
+#define kTsbPoolMaxBuffers      8
+#define kTsbPoolMountFormat     "/mnt/dvr%d"
+
+typedef struct
+{
+    unsigned int prepared;
+    unsigned int prepareFailures;
+    unsigned int notCreated;        ///< no TSB file on the drive yet, left to the recorder
+    unsigned int dropped;           ///< buffers given back on the drive a TSB left
+    unsigned int prepareMaxMs;
+    unsigned int acquiredReady;
+    unsigned int acquiredCold;      ///< not pooled or not ready yet
+    unsigned int readyOpens;        ///< record session open and start with a ready buffer
+    unsigned int readyOpenTotalMs;
+    unsigned int readyOpenMaxMs;
+    unsigned int coldOpens;
+    unsigned int coldOpenTotalMs;
+    unsigned int coldOpenMaxMs;
+    unsigned int openFailures;
+} tTsbPoolStats;
+
+class TsbPool
+{
+public:
+    /// buffers TSB numbers from 0 are pooled on each drive, bufferBytes each.
+    /// mountFormat gives the mount point of a drive number
+    TsbPool(unsigned int buffers, uint64_t bufferBytes, const char *mountFormat = kTsbPoolMountFormat);
+    virtual ~TsbPool();
+
+    /// Starts the thread preparing the buffers, the unit test calls runPending() itself
+    void start(void);
+
+    /// Prepares in the background the buffers of the TSB numbers that have no drive yet
+    void prepareDrive(int drive);
+
+    /// TSB number tsb is taken for a session on drive, -1 when not known.
+    /// Returns true when its buffer was ready on that drive; never waits
+    bool acquire(int drive, unsigned int tsb);
+    /// TSB number tsb is released, its buffer is prepared again
+    void recycle(unsigned int tsb);
+
+    /// The record session of tsb opened and started in ms, or failed to
+    void recordOpen(unsigned int tsb, unsigned int ms, bool ok);
+
+    bool isReady(int drive, unsigned int tsb);
+    std::string bufferPath(int drive, unsigned int tsb);
+
+    /// Prepares the buffers queued so far
+    void runPending(void);
+
+    void getStats(tTsbPoolStats *stats);
+    void logStats(void);
+
+protected:
+    /// Monotonic clock in ms, overridden by the unit test
+    virtual uint64_t nowMs(void);
+    /// True when the drive is mounted on mount, overridden by the unit test
+    virtual bool driveMounted(const char *mount);
+
+private:
+    struct Buffer
+    {
+        int             fd;             ///< kept open while prepared
+        bool            ready;
+    };
+
+    struct Tsb
+    {
+        bool            inUse;
+        bool            ready;          ///< when acquired, for the open latency
+        int             drive;          ///< drive of its buffer, -1 until it has one
+    };
+
+    struct Job
+    {
+        int             drive;
+        unsigned int    tsb;
+        bool            drop;           ///< give the buffer back instead of preparing it
+    };
+
+    static void *PrepareThread(void *arg);
+    void queue(int drive, unsigned int tsb, bool drop);
+    bool prepare(int drive, unsigned int tsb, bool *created);
+    void release(int drive, unsigned int tsb, bool drop);
+
+    pthread_mutex_t mMutex;
+    pthread_cond_t  mCond;
+    pthread_t       mThread;
+    bool            mThreadStarted;
+    bool            mExit;
+    unsigned int    mBufferCount;
+    uint64_t        mBufferBytes;
+    std::string     mMountFormat;
+    bool            mDrivePrepared[kTsbPoolMaxDrives];
+    Buffer          mBuffers[kTsbPoolMaxDrives][kTsbPoolMaxBuffers];
+    Tsb             mTsbs[kTsbPoolMaxBuffers];
+    std::list<Job>  mPending;
+    tTsbPoolStats   mStats;
+
+    TsbPool(const TsbPool&);
+    TsbPool& operator=(const TsbPool&);
+};
+
+#endif
@@ -0,0 +1,218 @@
+/**
+
+\file tsbPool_test.h -- contains the cxxtest test cases for the TSB pool
+
+The drives are directories of a temporary directory and the buffers are a few
+KB; the test creates the TSB files the recorder would have left and calls
+runPending() itself instead of starting the thread.
+*/
+
+#if !defined(TSB_POOL_TEST_H)
+#define TSB_POOL_TEST_H
+
+#include <cxxtest/TestSuite.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "tsbPool.h"
+
+#define kTestBufferBytes    (64 * 1024)
+
+class TestTsbPool : public TsbPool
+{
+public:
+    TestTsbPool(unsigned int buffers, const std::string &mountFormat) :
+        TsbPool(buffers, kTestBufferBytes, mountFormat.c_str())
+    {
+    }
+
+protected:
+    // the drive directories are not mount points
+    bool driveMounted(const char *mount)
+    {
+        struct stat st;
+        return (stat(mount, &st) == 0) && S_ISDIR(st.st_mode);
+    }
+};
+
+class tsbPoolTestSuite : public CxxTest::TestSuite
+{
+    char mDir[32];
+
+    static off_t fileSize(const std::string &path)
+    {
+        struct stat st;
+        return (stat(path.c_str(), &st) == 0) ? st.st_size : -1;
+    }
+
+    static off_t allocated(const std::string &path)
+    {
+        struct stat st;
+        return (stat(path.c_str(), &st) == 0) ? st.st_blocks * 512 : -1;
+    }
+
+    // a TSB file of size bytes, as the recorder leaves it
+    static void recorded(const std::string &path, off_t size)
+    {
+        int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+        TS_ASSERT(fd >= 0);
+        TS_ASSERT_EQUALS(ftruncate(fd, size), 0);
+        close(fd);
+    }
+
+public:
+
+    void setUp()
+    {
+        strcpy(mDir, "/tmp/tsbPoolXXXXXX");
+        TS_ASSERT(mkdtemp(mDir) != NULL);
+        // drive 1 is only there for testMovedDrive
+        std::string drive = std::string(mDir) + "/dvr0";
+        mkdir(drive.c_str(), 0755);
+    }
+
+    void tearDown()
+    {
+        std::string cmd = std::string("rm -rf ") + mDir;
+        TS_ASSERT_EQUALS(system(cmd.c_str()), 0);
+    }
+
+    void testPrepareDrive()
+    {
+        TestTsbPool pool(3, std::string(mDir) + "/dvr%d");
+        tTsbPoolStats stats;
+
+        TS_ASSERT_EQUALS(pool.bufferPath(0, 0), std::string(mDir) + "/dvr0/dvr001");
+        recorded(pool.bufferPath(0, 0), 0);
+        recorded(pool.bufferPath(0, 1), 1000);
+        pool.prepareDrive(0);
+        pool.prepareDrive(0);
+        TS_ASSERT(!pool.isReady(0, 0));
+        pool.runPending();
+
+        // blocks reserved, size left to the recorder, no file created
+        TS_ASSERT(pool.isReady(0, 0));
+        TS_ASSERT(pool.isReady(0, 1));
+        TS_ASSERT(!pool.isReady(0, 2));
+        TS_ASSERT_EQUALS(fileSize(pool.bufferPath(0, 0)), 0);
+        TS_ASSERT_EQUALS(fileSize(pool.bufferPath(0, 1)), 1000);
+        TS_ASSERT(allocated(pool.bufferPath(0, 0)) >= kTestBufferBytes);
+        TS_ASSERT(allocated(pool.bufferPath(0, 1)) >= kTestBufferBytes);
+        TS_ASSERT_EQUALS(fileSize(pool.bufferPath(0, 2)), -1);
+
+        pool.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.prepared, 2u);
+        TS_ASSERT_EQUALS(stats.notCreated, 1u);
+        TS_ASSERT_EQUALS(stats.prepareFailures, 0u);
+    }
+
+    void testAcquireAndRecycle()
+    {
+        TestTsbPool pool(2, std::string(mDir) + "/dvr%d");
+        tTsbPoolStats stats;
+
+        recorded(pool.bufferPath(0, 0), 0);
+        recorded(pool.bufferPath(0, 1), 0);
+        pool.prepareDrive(0);
+        pool.runPending();
+
+        TS_ASSERT(pool.acquire(0, 0));
+        TS_ASSERT(!pool.acquire(-1, 1));
+        TS_ASSERT(!pool.acquire(0, 5));
+        pool.recordOpen(0, 30, true);
+        pool.recordOpen(1, 200, true);
+        pool.recordOpen(5, 0, false);
+
+        // the recorder wrote and cut the file, its blocks are reserved again once released
+        recorded(pool.bufferPath(0, 0), 100);
+        pool.recycle(0);
+        TS_ASSERT(!pool.isReady(0, 0));
+        pool.runPending();
+        TS_ASSERT(pool.isReady(0, 0));
+        TS_ASSERT_EQUALS(fileSize(pool.bufferPath(0, 0)), 100);
+        TS_ASSERT(allocated(pool.bufferPath(0, 0)) >= kTestBufferBytes);
+
+        pool.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.acquiredReady, 1u);
+        TS_ASSERT_EQUALS(stats.acquiredCold, 2u);
+        TS_ASSERT_EQUALS(stats.readyOpens, 1u);
+        TS_ASSERT_EQUALS(stats.readyOpenTotalMs, 30u);
+        TS_ASSERT_EQUALS(stats.coldOpens, 1u);
+        TS_ASSERT_EQUALS(stats.coldOpenMaxMs, 200u);
+        TS_ASSERT_EQUALS(stats.openFailures, 1u);
+    }
+
+    void testInUseNotTouched()
+    {
+        TestTsbPool pool(2, std::string(mDir) + "/dvr%d");
+
+        // TSB 1 runs before the drive is prepared
+        recorded(pool.bufferPath(0, 0), 0);
+        recorded(pool.bufferPath(0, 1), 0);
+        pool.acquire(0, 1);
+        pool.prepareDrive(0);
+        pool.runPending();
+        TS_ASSERT(pool.isReady(0, 0));
+        TS_ASSERT(!pool.isReady(0, 1));
+        TS_ASSERT_EQUALS(allocated(pool.bufferPath(0, 1)), 0);
+
+        pool.recycle(1);
+        pool.runPending();
+        TS_ASSERT(pool.isReady(0, 1));
+    }
+
+    void testMovedDrive()
+    {
+        TestTsbPool pool(2, std::string(mDir) + "/dvr%d");
+        tTsbPoolStats stats;
+
+        mkdir((std::string(mDir) + "/dvr1").c_str(), 0755);
+        recorded(pool.bufferPath(0, 0), 0);
+        recorded(pool.bufferPath(1, 0), 0);
+
+        // the buffers are on the first drive only
+        pool.prepareDrive(0);
+        pool.prepareDrive(1);
+        pool.runPending();
+        TS_ASSERT(pool.isReady(0, 0));
+        TS_ASSERT(!pool.isReady(1, 0));
+        TS_ASSERT_EQUALS(allocated(pool.bufferPath(1, 0)), 0);
+
+        // TSB 0 runs on drive 1: what was reserved on drive 0 is given back
+        TS_ASSERT(!pool.acquire(1, 0));
+        pool.runPending();
+        TS_ASSERT(!pool.isReady(0, 0));
+        TS_ASSERT_EQUALS(allocated(pool.bufferPath(0, 0)), 0);
+        TS_ASSERT_EQUALS(fileSize(pool.bufferPath(0, 0)), 0);
+
+        pool.recycle(0);
+        pool.runPending();
+        TS_ASSERT(pool.isReady(1, 0));
+        TS_ASSERT(!pool.isReady(0, 0));
+        TS_ASSERT(allocated(pool.bufferPath(1, 0)) >= kTestBufferBytes);
+
+        pool.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.dropped, 1u);
+    }
+
+    void testNoDrive()
+    {
+        TestTsbPool pool(2, std::string(mDir) + "/dvr%d");
+        tTsbPoolStats stats;
+
+        pool.prepareDrive(1);
+        pool.prepareDrive(kTsbPoolMaxDrives);
+        pool.runPending();
+        TS_ASSERT(!pool.isReady(1, 0));
+        TS_ASSERT(!pool.acquire(1, 0));
+
+        pool.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.prepared, 0u);
+        TS_ASSERT_EQUALS(stats.prepareFailures, 2u);
+    }
+};
+
+#endif
@@ -0,0 +1,360 @@
+/**
+   \file vodDnsCache.cpp
+   \class VodDnsCache
+
+Implementation file for the host name cache of the on-demand stack
+*/
+
+#include <string.h>
+#include <time.h>
+#include <netdb.h>
+#include <resolv.h>
+#include <arpa/inet.h>
+#include <arpa/nameser.h>
+#include <sys/socket.h>
+#include <dlog.h>
+#include "pthread_named.h"
+
+#include "vodDnsCache.h"
+#include "monotonicTime.h"
+
+#define LOG(level, msg, args...)  dlog(DL_MSP_ONDEMAND, level,"VodDnsCache:%s:%d " msg, __FUNCTION__, __LINE__, ##args);
+
+#define kDnsAnswerSize      512
+
+VodDnsCache* VodDnsCache::mInstance = NULL;
+pthread_mutex_t VodDnsCache::mInstanceMutex = PTHREAD_MUTEX_INITIALIZER;
+
+VodDnsCache* VodDnsCache::getInstance(void)
+{
+    pthread_mutex_lock(&mInstanceMutex);
+    if (mInstance == NULL)
+    {
+        mInstance = new VodDnsCache();
+    }
+    pthread_mutex_unlock(&mInstanceMutex);
+    return mInstance;
+}
+
+VodDnsCache::VodDnsCache()
+{
+    pthread_mutex_init(&mMutex, NULL);
+    pthread_cond_init(&mCond, NULL);
+    mThreadStarted = false;
+    mExit = false;
+    mResolver = systemResolve;
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+VodDnsCache::~VodDnsCache()
+{
+    pthread_mutex_lock(&mMutex);
+    mExit = true;
+    bool started = mThreadStarted;
+    pthread_cond_signal(&mCond);
+    pthread_mutex_unlock(&mMutex);
+
+    if (started)
+    {
+        pthread_join(mThread, NULL);
+    }
+    pthread_cond_destroy(&mCond);
+    pthread_mutex_destroy(&mMutex);
+}
+
+uint64_t VodDnsCache::nowMs(void)
+{
+    return monotonicNowMs();
+}
+
+// skips a domain name of a DNS message, NULL when it runs past end
+static const unsigned char *skipName(const unsigned char *pos, const unsigned char *end)
+{
+    while (pos < end)
+    {
+        if (*pos == 0)
+        {
+            return pos + 1;
+        }
+        if ((*pos & 0xC0) == 0xC0)
+        {
+            return (pos + 2 <= end) ? pos + 2 : NULL;
+        }
+        pos += *pos + 1;
+    }
+    return NULL;
+}
+
+bool VodDnsCache::systemResolve(const char *host, struct in_addr *addr, uint32_t *ttlSecs)
+{
+    unsigned char answer[kDnsAnswerSize];
+    int length = res_query(host, C_IN, T_A, answer, sizeof(answer));
+
+    // header, question, then the answer records; the first A record is taken, with the lowest TTL of them
+    if (length >= HFIXEDSZ)
+    {
+        const unsigned char *end = answer + ((length < kDnsAnswerSize) ? length : kDnsAnswerSize);
+        const unsigned char *pos = answer + HFIXEDSZ;
+        unsigned int questions = (answer[4] << 8) | answer[5];
+        unsigned int answers = (answer[6] << 8) | answer[7];
+        bool found = false;
+
+        for (unsigned int i = 0; (i < questions) && pos; i++)
+        {
+            pos = skipName(pos, end);
+            pos = (pos && (pos + QFIXEDSZ <= end)) ? pos + QFIXEDSZ : NULL;
+        }
+        for (unsigned int i = 0; (i < answers) && pos; i++)
+        {
+            pos = skipName(pos, end);
+            if ((pos == NULL) || (pos + RRFIXEDSZ > end))
+            {
+                break;
+            }
+            unsigned int type = (pos[0] << 8) | pos[1];
+            uint32_t ttl = (pos[4] << 24) | (pos[5] << 16) | (pos[6] << 8) | pos[7];
+            unsigned int dataLength = (pos[8] << 8) | pos[9];
+            pos += RRFIXEDSZ;
+            if (pos + dataLength > end)
+            {
+                break;
+            }
+            if ((type == T_A) && (dataLength == 4))
+            {
+                if (!found)
+                {
+                    memcpy(&addr->s_addr, pos, 4);
+                    *ttlSecs = ttl;
+                }
+                else if (ttl < *ttlSecs)
+                {
+                    *ttlSecs = ttl;
+                }
+                found = true;
+            }
+            pos += dataLength;
+        }
+        if (found)
+        {
+            return true;
+        }
+    }
+
+    struct addrinfo hints;
+    struct addrinfo *result = NULL;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if ((getaddrinfo(host, NULL, &hints, &result) != 0) || (result == NULL))
+    {
+        return false;
+    }
+    *addr = ((struct sockaddr_in *) result->ai_addr)->sin_addr;
+    *ttlSecs = 0;
+    freeaddrinfo(result);
+    return true;
+}
+
+void VodDnsCache::setResolver(tDnsResolver resolver)
+{
+    pthread_mutex_lock(&mMutex);
+    mResolver = resolver ? resolver : systemResolve;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void *VodDnsCache::RefreshThread(void *arg)
+{
+    VodDnsCache *cache = (VodDnsCache *) arg;
+
+    pthread_mutex_lock(&cache->mMutex);
+    while (!cache->mExit)
+    {
+        if (cache->mPending.empty())
+        {
+            pthread_cond_wait(&cache->mCond, &cache->mMutex);
+            continue;
+        }
+
+        std::string host = cache->mPending.front();
+        cache->mPending.pop_front();
+        tDnsResolver resolver = cache->mResolver;
+        pthread_mutex_unlock(&cache->mMutex);
+
+        struct in_addr addr;
+        uint32_t ttl = 0;
+        memset(&addr, 0, sizeof(addr));
+        bool ok = resolver(host.c_str(), &addr, &ttl);
+        cache->store(host, ok, addr, ttl, true);
+
+        pthread_mutex_lock(&cache->mMutex);
+    }
+    pthread_mutex_unlock(&cache->mMutex);
+    return NULL;
+}
+
+// called with mMutex held
+void VodDnsCache::queueRefresh(const std::string &host)
+{
+    mPending.push_back(host);
+    if (!mThreadStarted)
+    {
+        if (pthread_create(&mThread, NULL, RefreshThread, this) != 0)
+        {
+            LOG(DLOGL_ERROR, ":%m: Error creating the DNS refresh thread");
+            mPending.clear();
+            mEntries[host].refreshing = false;
+            return;
+        }
+        mThreadStarted = true;
+        if (pthread_setname_np(mThread, "VOD DNS Refresh") != 0)
+        {
+            LOG(DLOGL_ERROR, "ERROR: %m: Thread Setname Failed.");
+        }
+    }
+    pthread_cond_signal(&mCond);
+}
+
+void VodDnsCache::store(const std::string &host, bool ok, const struct in_addr &addr, uint32_t ttlSecs, bool refresh)
+{
+    pthread_mutex_lock(&mMutex);
+    uint64_t now = nowMs();
+    Entry &entry = mEntries[host];
+
+    entry.refreshing = false;
+    if (refresh && !ok)
+    {
+        mStats.failedRefreshes++;
+        if (entry.valid && (now < entry.expiresMs))
+        {
+            // the address stays until its TTL is up, the next refresh is tried after a while
+            LOG(DLOGL_MINOR_EVENT, "refresh of %s failed", host.c_str());
+            entry.refreshMs = now + kDnsNegativeTtlSecs * 1000;
+            pthread_mutex_unlock(&mMutex);
+            return;
+        }
+    }
+    else if (refresh)
+    {
+        mStats.refreshes++;
+    }
+
+    if (ok)
+    {
+        if (ttlSecs == 0)
+        {
+            ttlSecs = kDnsDefaultTtlSecs;
+        }
+        else if (ttlSecs < kDnsMinTtlSecs)
+        {
+            ttlSecs = kDnsMinTtlSecs;
+        }
+        else if (ttlSecs > kDnsMaxTtlSecs)
+        {
+            ttlSecs = kDnsMaxTtlSecs;
+        }
+        entry.valid = true;
+        entry.addr = addr;
+        entry.expiresMs = now + (uint64_t) ttlSecs * 1000;
+        entry.refreshMs = now + (uint64_t) ttlSecs * 10 * kDnsRefreshPercent;
+        char ip[INET_ADDRSTRLEN];
+        LOG(DLOGL_NOISE, "%s is %s for %d s", host.c_str(), inet_ntop(AF_INET, &addr, ip, sizeof(ip)), ttlSecs);
+    }
+    else
+    {
+        entry.valid = false;
+        entry.expiresMs = now + kDnsNegativeTtlSecs * 1000;
+        entry.refreshMs = entry.expiresMs;
+        LOG(DLOGL_ERROR, "%s does not resolve", host.c_str());
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+bool VodDnsCache::resolve(const std::string &host, struct in_addr *addr)
+{
+    if (inet_aton(host.c_str(), addr) != 0)
+    {
+        return true;
+    }
+
+    pthread_mutex_lock(&mMutex);
+    uint64_t now = nowMs();
+    std::map<std::string, Entry>::iterator itr = mEntries.find(host);
+    if ((itr != mEntries.end()) && (now < itr->second.expiresMs))
+    {
+        Entry &entry = itr->second;
+        bool valid = entry.valid;
+        if (valid)
+        {
+            *addr = entry.addr;
+            mStats.hits++;
+            if ((now >= entry.refreshMs) && !entry.refreshing)
+            {
+                entry.refreshing = true;
+                queueRefresh(host);
+            }
+        }
+        else
+        {
+            mStats.negativeHits++;
+        }
+        pthread_mutex_unlock(&mMutex);
+        return valid;
+    }
+    mStats.misses++;
+    tDnsResolver resolver = mResolver;
+    pthread_mutex_unlock(&mMutex);
+
+    struct in_addr resolved;
+    uint32_t ttl = 0;
+    memset(&resolved, 0, sizeof(resolved));
+    bool ok = resolver(host.c_str(), &resolved, &ttl);
+    store(host, ok, resolved, ttl, false);
+    if (ok)
+    {
+        *addr = resolved;
+    }
+    return ok;
+}
+
+void VodDnsCache::prefetch(const std::string &host)
+{
+    struct in_addr addr;
+
+    if (host.empty() || (inet_aton(host.c_str(), &addr) != 0))
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&mMutex);
+    Entry &entry = mEntries[host];
+    if ((nowMs() >= entry.expiresMs) && !entry.refreshing)
+    {
+        entry.refreshing = true;
+        queueRefresh(host);
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+void VodDnsCache::flush(void)
+{
+    pthread_mutex_lock(&mMutex);
+    mEntries.clear();
+    pthread_mutex_unlock(&mMutex);
+}
+
+void VodDnsCache::getStats(tDnsCacheStats *stats)
+{
+    pthread_mutex_lock(&mMutex);
+    *stats = mStats;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void VodDnsCache::logStats(void)
+{
+    tDnsCacheStats stats;
+
+    getStats(&stats);
+    LOG(DLOGL_NORMAL, "hits:%d misses:%d negativeHits:%d refreshes:%d failedRefreshes:%d",
+        stats.hits, stats.misses, stats.negativeHits, stats.refreshes, stats.failedRefreshes);
+}
@@ -0,0 +1,105 @@
+/**
+   \file vodDnsCache.h
+   \class VodDnsCache
+
+   Host name cache of the on-demand stack.
+
+   The SRM, stream server and head-end host names are looked up on every VOD
+   session setup; with the cache only the first setup waits for the resolver.
+   An address is kept for the TTL of its DNS record (clamped to
+   [kDnsMinTtlSecs, kDnsMaxTtlSecs], kDnsDefaultTtlSecs when the resolver has
+   no TTL, as for a name of the hosts file).  A lookup past kDnsRefreshPercent
+   of the TTL gets the cached address and has the entry refreshed by the
+   background thread, so a host in use is never resolved on the setup path
+   again.  A name that does not resolve is remembered for kDnsNegativeTtlSecs,
+   and a refresh that fails keeps the address until its TTL is up.
+   Dotted quad addresses are converted without the cache.
+*/
+
+#if !defined(VOD_DNS_CACHE_H)
+#define VOD_DNS_CACHE_H
+
+#include <stdint.h>
+#include <string>
+#include <map>
+#include <deque>
+#include <pthread.h>
+#include <netinet/in.h>
+
+#define kDnsDefaultTtlSecs      300
+#define kDnsMinTtlSecs          5
+#define kDnsMaxTtlSecs          3600
+#define kDnsNegativeTtlSecs     30
+#define kDnsRefreshPercent      75
+
+/// Resolves host to an IPv4 address and the TTL in seconds of the answer, 0 when unknown
+typedef bool (*tDnsResolver)(const char *host, struct in_addr *addr, uint32_t *ttlSecs);
+
+typedef struct
+{
+    unsigned int hits;
+    unsigned int misses;         ///< lookups that waited for the resolver
+    unsigned int negativeHits;   ///< lookups answered by a remembered failure
+    unsigned int refreshes;      ///< background refreshes done
+    unsigned int failedRefreshes;
+} tDnsCacheStats;
+
+class VodDnsCache
+{
+public:
+    /// The cache shared by the on-demand stack
+    static VodDnsCache* getInstance(void);
+
+    VodDnsCache();
+    virtual ~VodDnsCache();
+
+    /// IPv4 address of host, false when it does not resolve
+    bool resolve(const std::string &host, struct in_addr *addr);
+    /// Has host resolved by the background thread if it is not cached yet
+    void prefetch(const std::string &host);
+    void flush(void);
+
+    /// Resolver used on a miss and by the refreshes, systemResolve() by default
+    void setResolver(tDnsResolver resolver);
+    /// res_query() for the TTL, getaddrinfo() for names DNS does not know
+    static bool systemResolve(const char *host, struct in_addr *addr, uint32_t *ttlSecs);
+
+    void getStats(tDnsCacheStats *stats);
+    void logStats(void);
+
+protected:
+    /// Monotonic clock in ms, overridden by the unit test
+    virtual uint64_t nowMs(void);
+
+private:
+    struct Entry
+    {
+        bool            valid;          ///< false for a remembered failure
+        struct in_addr  addr;
+        uint64_t        refreshMs;
+        uint64_t        expiresMs;
+        bool            refreshing;
+    };
+
+    static void *RefreshThread(void *arg);
+    void queueRefresh(const std::string &host);
+    void store(const std::string &host, bool ok, const struct in_addr &addr, uint32_t ttlSecs, bool refresh);
+
+    pthread_mutex_t mMutex;
+    pthread_cond_t  mCond;
+    pthread_t       mThread;
+    bool            mThreadStarted;
+    bool            mExit;
+    tDnsResolver    mResolver;
+    std::map<std::string, Entry> mEntries;
+    std::deque<std::string>      mPending;      ///< hosts for the background thread
+    tDnsCacheStats  mStats;
+
+    static VodDnsCache *mInstance;
+    static pthread_mutex_t mInstanceMutex;
+
+    VodDnsCache(const VodDnsCache&);
+    VodDnsCache& operator=(const VodDnsCache&);
+};
+
+#endif
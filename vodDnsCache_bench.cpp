@@ -0,0 +1,135 @@
+/** @file vodDnsCache_bench.cpp
+ *
+ * @brief Measures the part of a VOD session setup that depends on the resolver.
+ *
+ * A setup looks up the SRM host name and connects the LSCP socket to the
+ * stream server by name with VodLscp_Base::GetSocket(), against a listening
+ * socket on the loopback.  The names are answered by a local stub resolver
+ * that takes the given time, as a DNS server across the plant would:
+ *  - "cold": the cache is flushed before each setup, as every setup was
+ *    resolved before the cache,
+ *  - "warm": the names were looked up by an earlier setup.
+ * Build with "make vodDnsCache_bench" and run on the target, optionally with
+ * the resolver latency in ms as argument.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "vodDnsCache.h"
+#include "lscProtocolclass.h"
+
+#define kBenchSetups            100
+#define kBenchResolverMs        20
+#define kBenchSrmHost           "srm.headend.example"
+#define kBenchStreamerHost      "streamer.headend.example"
+
+static unsigned int gResolverMs = kBenchResolverMs;
+static volatile int gResolverCalls;
+
+static double nowMs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (ts.tv_sec * 1e3) + (ts.tv_nsec / 1e6);
+}
+
+// the head-end names are on the loopback, anything else does not exist
+static bool stubResolve(const char *host, struct in_addr *addr, uint32_t *ttlSecs)
+{
+    __sync_fetch_and_add(&gResolverCalls, 1);
+    usleep(gResolverMs * 1000);
+    if (strcmp(host, kBenchSrmHost) && strcmp(host, kBenchStreamerHost))
+    {
+        return false;
+    }
+    addr->s_addr = htonl(INADDR_LOOPBACK);
+    *ttlSecs = 300;
+    return true;
+}
+
+static bool setup(VodLscp_Base *lscp, int listenFd, unsigned short port)
+{
+    struct in_addr srm;
+
+    if (!VodDnsCache::getInstance()->resolve(kBenchSrmHost, &srm))
+    {
+        return false;
+    }
+    int fd = lscp->GetSocket(kBenchStreamerHost, port);
+    if (fd < 0)
+    {
+        return false;
+    }
+    close(fd);
+    close(accept(listenFd, NULL, NULL));
+    return true;
+}
+
+int main(int argc, char **argv)
+{
+    struct sockaddr_in addr;
+    socklen_t addrLen = sizeof(addr);
+    VodLscp_Base lscp;
+
+    if (argc > 1)
+    {
+        gResolverMs = atoi(argv[1]);
+    }
+    VodDnsCache::getInstance()->setResolver(stubResolve);
+
+    // the stream server
+    int listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if ((listenFd < 0) || (bind(listenFd, (struct sockaddr *) &addr, sizeof(addr)) < 0) ||
+            (listen(listenFd, 8) < 0) || (getsockname(listenFd, (struct sockaddr *) &addr, &addrLen) < 0))
+    {
+        printf("ERROR: no stream server socket\n");
+        return 1;
+    }
+    unsigned short port = ntohs(addr.sin_port);
+
+    printf("resolver %u ms, %d setups\n", gResolverMs, kBenchSetups);
+    printf("%-8s %12s %16s\n", "cache", "setup ms", "resolver calls");
+    for (int warm = 0; warm < 2; warm++)
+    {
+        double start = nowMs();
+
+        gResolverCalls = 0;
+        for (int i = 0; i < kBenchSetups; i++)
+        {
+            if (!warm)
+            {
+                VodDnsCache::getInstance()->flush();
+            }
+            if (!setup(&lscp, listenFd, port))
+            {
+                printf("ERROR: setup failed\n");
+                return 1;
+            }
+        }
+        printf("%-8s %12.3f %16d\n", warm ? "warm" : "cold", (nowMs() - start) / kBenchSetups, gResolverCalls);
+    }
+
+    // a name that does not resolve is not asked again on every setup
+    struct in_addr none;
+    gResolverCalls = 0;
+    double start = nowMs();
+    for (int i = 0; i < kBenchSetups; i++)
+    {
+        VodDnsCache::getInstance()->resolve("nohost.headend.example", &none);
+    }
+    printf("%-8s %12.3f %16d\n", "negative", (nowMs() - start) / kBenchSetups, gResolverCalls);
+
+    VodDnsCache::getInstance()->logStats();
+    close(listenFd);
+    return 0;
+}
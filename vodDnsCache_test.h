@@ -0,0 +1,219 @@
+/**
+
+\file vodDnsCache_test.h -- contains the cxxtest test cases for the VOD DNS cache
+
+The cache runs on a clock the test sets, with a stub resolver that counts
+its calls and answers with the address, TTL and failure the test gives it.
+*/
+
+#if !defined(VOD_DNS_CACHE_TEST_H)
+#define VOD_DNS_CACHE_TEST_H
+
+#include <cxxtest/TestSuite.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+
+#include "vodDnsCache.h"
+
+static volatile int gStubCalls;
+static volatile bool gStubFails;
+static volatile uint32_t gStubTtl;
+static volatile uint32_t gStubAddr;
+
+static bool stubResolve(const char *host, struct in_addr *addr, uint32_t *ttlSecs)
+{
+    (void) host;
+    __sync_fetch_and_add(&gStubCalls, 1);
+    if (gStubFails)
+    {
+        return false;
+    }
+    addr->s_addr = htonl(gStubAddr);
+    *ttlSecs = gStubTtl;
+    return true;
+}
+
+class TestVodDnsCache : public VodDnsCache
+{
+public:
+    TestVodDnsCache() : mNow(1000000)
+    {
+        setResolver(stubResolve);
+        gStubCalls = 0;
+        gStubFails = false;
+        gStubTtl = 60;
+        gStubAddr = 0x0A000001;
+    }
+
+    volatile uint64_t mNow;
+
+protected:
+    uint64_t nowMs(void)
+    {
+        return mNow;
+    }
+};
+
+class vodDnsCacheTestSuite : public CxxTest::TestSuite
+{
+    // waits until the background thread has tried that many refreshes
+    static bool waitRefreshes(VodDnsCache &cache, unsigned int refreshes)
+    {
+        tDnsCacheStats stats;
+
+        for (int i = 0; i < 200; i++)
+        {
+            cache.getStats(&stats);
+            if (stats.refreshes + stats.failedRefreshes >= refreshes)
+            {
+                return true;
+            }
+            usleep(5000);
+        }
+        return false;
+    }
+
+public:
+
+    void testNumericAddress()
+    {
+        TestVodDnsCache cache;
+        struct in_addr addr;
+
+        TS_ASSERT(cache.resolve("10.1.2.3", &addr));
+        TS_ASSERT_EQUALS(ntohl(addr.s_addr), 0x0A010203u);
+        TS_ASSERT_EQUALS(gStubCalls, 0);
+    }
+
+    void testHitWithinTtl()
+    {
+        TestVodDnsCache cache;
+        tDnsCacheStats stats;
+        struct in_addr addr;
+
+        TS_ASSERT(cache.resolve("srm.headend", &addr));
+        TS_ASSERT_EQUALS(ntohl(addr.s_addr), 0x0A000001u);
+        cache.mNow += 30000;
+        TS_ASSERT(cache.resolve("srm.headend", &addr));
+        TS_ASSERT_EQUALS(gStubCalls, 1);
+
+        // past the TTL the lookup waits for the resolver again
+        gStubAddr = 0x0A000002;
+        cache.mNow += 30000;
+        TS_ASSERT(cache.resolve("srm.headend", &addr));
+        TS_ASSERT_EQUALS(ntohl(addr.s_addr), 0x0A000002u);
+        TS_ASSERT_EQUALS(gStubCalls, 2);
+
+        cache.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.hits, 1u);
+        TS_ASSERT_EQUALS(stats.misses, 2u);
+    }
+
+    void testTtlClamped()
+    {
+        TestVodDnsCache cache;
+        struct in_addr addr;
+
+        // looked up short of the refresh point, so that nothing happens in the background
+        gStubTtl = 1;
+        uint64_t start = cache.mNow;
+        TS_ASSERT(cache.resolve("srm.headend", &addr));
+        cache.mNow = start + kDnsMinTtlSecs * 10 * kDnsRefreshPercent - 1;
+        TS_ASSERT(cache.resolve("srm.headend", &addr));
+        cache.mNow = start + kDnsMinTtlSecs * 1000;
+        TS_ASSERT(cache.resolve("srm.headend", &addr));
+        TS_ASSERT_EQUALS(gStubCalls, 2);
+
+        // no TTL from the resolver
+        gStubTtl = 0;
+        start = cache.mNow;
+        TS_ASSERT(cache.resolve("streamer.headend", &addr));
+        cache.mNow = start + kDnsDefaultTtlSecs * 10 * kDnsRefreshPercent - 1;
+        TS_ASSERT(cache.resolve("streamer.headend", &addr));
+        TS_ASSERT_EQUALS(gStubCalls, 3);
+    }
+
+    void testBackgroundRefresh()
+    {
+        TestVodDnsCache cache;
+        tDnsCacheStats stats;
+        struct in_addr addr;
+
+        TS_ASSERT(cache.resolve("srm.headend", &addr));
+
+        // past 3/4 of the TTL: the cached address, and a refresh behind it
+        gStubAddr = 0x0A000002;
+        cache.mNow += 46000;
+        TS_ASSERT(cache.resolve("srm.headend", &addr));
+        TS_ASSERT_EQUALS(ntohl(addr.s_addr), 0x0A000001u);
+        TS_ASSERT(waitRefreshes(cache, 1));
+
+        TS_ASSERT(cache.resolve("srm.headend", &addr));
+        TS_ASSERT_EQUALS(ntohl(addr.s_addr), 0x0A000002u);
+
+        // the refreshed entry has a TTL from the refresh
+        cache.mNow += 40000;
+        TS_ASSERT(cache.resolve("srm.headend", &addr));
+        cache.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.misses, 1u);
+        TS_ASSERT_EQUALS(stats.refreshes, 1u);
+        TS_ASSERT_EQUALS(gStubCalls, 2);
+    }
+
+    void testFailedRefreshKeepsAddress()
+    {
+        TestVodDnsCache cache;
+        struct in_addr addr;
+
+        TS_ASSERT(cache.resolve("srm.headend", &addr));
+        gStubFails = true;
+        cache.mNow += 46000;
+        TS_ASSERT(cache.resolve("srm.headend", &addr));
+        TS_ASSERT(waitRefreshes(cache, 1));
+
+        TS_ASSERT(cache.resolve("srm.headend", &addr));
+        TS_ASSERT_EQUALS(ntohl(addr.s_addr), 0x0A000001u);
+        TS_ASSERT_EQUALS(gStubCalls, 2);
+
+        // the address is gone with its TTL
+        cache.mNow += 15000;
+        TS_ASSERT(!cache.resolve("srm.headend", &addr));
+    }
+
+    void testNegativeCaching()
+    {
+        TestVodDnsCache cache;
+        tDnsCacheStats stats;
+        struct in_addr addr;
+
+        gStubFails = true;
+        TS_ASSERT(!cache.resolve("nohost.headend", &addr));
+        cache.mNow += kDnsNegativeTtlSecs * 1000 - 1;
+        TS_ASSERT(!cache.resolve("nohost.headend", &addr));
+        TS_ASSERT_EQUALS(gStubCalls, 1);
+
+        gStubFails = false;
+        cache.mNow += 1;
+        TS_ASSERT(cache.resolve("nohost.headend", &addr));
+        TS_ASSERT_EQUALS(gStubCalls, 2);
+
+        cache.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.negativeHits, 1u);
+    }
+
+    void testPrefetch()
+    {
+        TestVodDnsCache cache;
+        tDnsCacheStats stats;
+        struct in_addr addr;
+
+        cache.prefetch("streamer.headend");
+        TS_ASSERT(waitRefreshes(cache, 1));
+        TS_ASSERT(cache.resolve("streamer.headend", &addr));
+        cache.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.misses, 0u);
+        TS_ASSERT_EQUALS(gStubCalls, 1);
+    }
+};
+
+#endif
@@ -0,0 +1,368 @@
+/**
+   \file vodKeepAlive.cpp
+   \class VodKeepAlive
+
+Implementation file for the keep-alive scheduler of the VOD sessions
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+#include <dlog.h>
+#include "pthread_named.h"
+
+#include "vodKeepAlive.h"
+#include "monotonicTime.h"
+
+#define LOG(level, msg, args...)  dlog(DL_MSP_ONDEMAND, level,"VodKeepAlive:%s:%d " msg, __FUNCTION__, __LINE__, ##args);
+
+VodKeepAlive* VodKeepAlive::mInstance = NULL;
+pthread_mutex_t VodKeepAlive::mInstanceMutex = PTHREAD_MUTEX_INITIALIZER;
+
+VodKeepAlive* VodKeepAlive::getInstance(void)
+{
+    pthread_mutex_lock(&mInstanceMutex);
+    if (mInstance == NULL)
+    {
+        mInstance = new VodKeepAlive();
+        mInstance->start();
+    }
+    pthread_mutex_unlock(&mInstanceMutex);
+    return mInstance;
+}
+
+VodKeepAlive::VodKeepAlive()
+{
+    pthread_condattr_t attr;
+
+    pthread_mutex_init(&mMutex, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&mCond, &attr);
+    pthread_condattr_destroy(&attr);
+    mThreadStarted = false;
+    mExit = false;
+    mCalling = NULL;
+    mSeed = (uint32_t) time(NULL) ^ (uint32_t) getpid();
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+VodKeepAlive::~VodKeepAlive()
+{
+    pthread_mutex_lock(&mMutex);
+    mExit = true;
+    bool started = mThreadStarted;
+    pthread_cond_broadcast(&mCond);
+    pthread_mutex_unlock(&mMutex);
+
+    if (started)
+    {
+        pthread_join(mThread, NULL);
+    }
+    pthread_cond_destroy(&mCond);
+    pthread_mutex_destroy(&mMutex);
+}
+
+uint64_t VodKeepAlive::nowMs(void)
+{
+    return monotonicNowMs();
+}
+
+uint32_t VodKeepAlive::jitterPermille(void)
+{
+    // called with mMutex held
+    return rand_r(&mSeed) % (kVodKeepAliveJitterPct * 10);
+}
+
+void VodKeepAlive::start(void)
+{
+    pthread_mutex_lock(&mMutex);
+    if (!mThreadStarted)
+    {
+        if (pthread_create(&mThread, NULL, SchedulerThread, this) != 0)
+        {
+            LOG(DLOGL_ERROR, ":%m: Error creating the keep-alive thread");
+        }
+        else
+        {
+            mThreadStarted = true;
+            if (pthread_setname_np(mThread, "VOD KeepAlive") != 0)
+            {
+                LOG(DLOGL_ERROR, "ERROR: %m: Thread Setname Failed.");
+            }
+        }
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+// called with mMutex held, 0 when nothing is scheduled
+uint64_t VodKeepAlive::nextDueMs(void)
+{
+    uint64_t next = 0;
+
+    for (std::map<void *, Session>::iterator itr = mSessions.begin(); itr != mSessions.end(); ++itr)
+    {
+        if ((next == 0) || (itr->second.dueMs < next))
+        {
+            next = itr->second.dueMs;
+        }
+    }
+    return next;
+}
+
+void *VodKeepAlive::SchedulerThread(void *arg)
+{
+    VodKeepAlive *scheduler = (VodKeepAlive *) arg;
+
+    pthread_mutex_lock(&scheduler->mMutex);
+    while (!scheduler->mExit)
+    {
+        uint64_t next = scheduler->nextDueMs();
+        if (next == 0)
+        {
+            pthread_cond_wait(&scheduler->mCond, &scheduler->mMutex);
+            continue;
+        }
+
+        uint64_t now = scheduler->nowMs();
+        if (next > now)
+        {
+            struct timespec ts;
+            monotonicDeadlineIn(next - now, &ts);
+            pthread_cond_timedwait(&scheduler->mCond, &scheduler->mMutex, &ts);
+            continue;
+        }
+
+        pthread_mutex_unlock(&scheduler->mMutex);
+        scheduler->runDue();
+        pthread_mutex_lock(&scheduler->mMutex);
+    }
+    pthread_mutex_unlock(&scheduler->mMutex);
+    return NULL;
+}
+
+void VodKeepAlive::add(void *session, const std::string &server, uint32_t intervalMs, tKeepAliveDue due, bool expectsAnswer)
+{
+    if ((session == NULL) || (due == NULL) || (intervalMs == 0))
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&mMutex);
+    uint64_t now = nowMs();
+    uint64_t dueMs = now + intervalMs;
+
+    // joins the next wakeup of the server when that is not too late for it
+    for (std::map<void *, Session>::iterator itr = mSessions.begin(); itr != mSessions.end(); ++itr)
+    {
+        if ((itr->first != session) && (itr->second.server == server) &&
+                (itr->second.dueMs > now) && (itr->second.dueMs < dueMs))
+        {
+            dueMs = itr->second.dueMs;
+        }
+    }
+
+    if (mSessions.find(session) == mSessions.end())
+    {
+        mStats.sessions++;
+    }
+    Session &entry = mSessions[session];
+    entry.server = server;
+    entry.intervalMs = intervalMs;
+    entry.dueMs = dueMs;
+    entry.due = due;
+    entry.expectsAnswer = expectsAnswer;
+    entry.awaiting = false;
+    entry.sentMs = 0;
+    memset(&entry.stats, 0, sizeof(entry.stats));
+    pthread_cond_signal(&mCond);
+    pthread_mutex_unlock(&mMutex);
+
+    LOG(DLOGL_NORMAL, "%p to %s every %d ms", session, server.c_str(), intervalMs);
+}
+
+void VodKeepAlive::remove(void *session)
+{
+    pthread_mutex_lock(&mMutex);
+    while (mCalling == session)
+    {
+        pthread_cond_wait(&mCond, &mMutex);
+    }
+    if (mSessions.erase(session))
+    {
+        mStats.sessions--;
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+void VodKeepAlive::runDue(void)
+{
+    std::vector<void *> batch;
+
+    pthread_mutex_lock(&mMutex);
+    uint64_t now = nowMs();
+
+    // servers with a session due: their sessions due soon go in the same wakeup
+    std::map<std::string, uint32_t> jitter;
+    for (std::map<void *, Session>::iterator itr = mSessions.begin(); itr != mSessions.end(); ++itr)
+    {
+        if ((itr->second.dueMs <= now) && (jitter.find(itr->second.server) == jitter.end()))
+        {
+            jitter[itr->second.server] = jitterPermille();
+        }
+    }
+
+    for (std::map<void *, Session>::iterator itr = mSessions.begin(); itr != mSessions.end(); ++itr)
+    {
+        Session &entry = itr->second;
+        std::map<std::string, uint32_t>::iterator server = jitter.find(entry.server);
+        if ((server == jitter.end()) ||
+                (entry.dueMs > now + ((uint64_t) entry.intervalMs * kVodKeepAliveBatchPct) / 100))
+        {
+            continue;
+        }
+        if (entry.dueMs > now)
+        {
+            mStats.early++;
+        }
+        entry.dueMs = now + entry.intervalMs - ((uint64_t) entry.intervalMs * server->second) / 1000;
+        batch.push_back(itr->first);
+    }
+
+    if (!batch.empty())
+    {
+        mStats.wakeups++;
+        mStats.dues += batch.size();
+    }
+
+    // without the lock, a due function may take the lock of its session
+    for (std::vector<void *>::iterator itr = batch.begin(); itr != batch.end(); ++itr)
+    {
+        std::map<void *, Session>::iterator entry = mSessions.find(*itr);
+        if (entry == mSessions.end())
+        {
+            // removed meanwhile
+            continue;
+        }
+        tKeepAliveDue due = entry->second.due;
+        mCalling = *itr;
+        pthread_mutex_unlock(&mMutex);
+
+        due(*itr);
+
+        pthread_mutex_lock(&mMutex);
+        mCalling = NULL;
+        pthread_cond_broadcast(&mCond);
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+// called with mMutex held
+void VodKeepAlive::missed(Session &session)
+{
+    session.stats.missed++;
+    if (session.stats.missed == kVodKeepAliveMaxMisses)
+    {
+        LOG(DLOGL_ERROR, "%s: %d keep-alives in a row unanswered", session.server.c_str(), session.stats.missed);
+    }
+}
+
+void VodKeepAlive::sent(void *session)
+{
+    pthread_mutex_lock(&mMutex);
+    std::map<void *, Session>::iterator itr = mSessions.find(session);
+    if (itr != mSessions.end())
+    {
+        Session &entry = itr->second;
+        if (entry.awaiting)
+        {
+            missed(entry);
+        }
+        entry.stats.sent++;
+        entry.awaiting = entry.expectsAnswer;
+        entry.sentMs = nowMs();
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+void VodKeepAlive::answered(void *session, bool ok)
+{
+    pthread_mutex_lock(&mMutex);
+    std::map<void *, Session>::iterator itr = mSessions.find(session);
+    if ((itr != mSessions.end()) && itr->second.awaiting)
+    {
+        Session &entry = itr->second;
+        entry.awaiting = false;
+        if (ok)
+        {
+            unsigned int rttMs = nowMs() - entry.sentMs;
+            entry.stats.answered++;
+            entry.stats.missed = 0;
+            entry.stats.lastRttMs = rttMs;
+            entry.stats.avgRttMs = (entry.stats.answered == 1) ? rttMs :
+                                   entry.stats.avgRttMs - (entry.stats.avgRttMs / 8) + (rttMs / 8);
+            if (rttMs > entry.stats.maxRttMs)
+            {
+                entry.stats.maxRttMs = rttMs;
+            }
+        }
+        else
+        {
+            entry.stats.failed++;
+            missed(entry);
+        }
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+bool VodKeepAlive::getSessionStats(void *session, tKeepAliveSessionStats *stats)
+{
+    pthread_mutex_lock(&mMutex);
+    std::map<void *, Session>::iterator itr = mSessions.find(session);
+    bool found = (itr != mSessions.end());
+    if (found)
+    {
+        *stats = itr->second.stats;
+    }
+    pthread_mutex_unlock(&mMutex);
+    return found;
+}
+
+unsigned int VodKeepAlive::failingSessions(const std::string &server)
+{
+    unsigned int failing = 0;
+
+    pthread_mutex_lock(&mMutex);
+    for (std::map<void *, Session>::iterator itr = mSessions.begin(); itr != mSessions.end(); ++itr)
+    {
+        if ((itr->second.server == server) && (itr->second.stats.missed >= kVodKeepAliveMaxMisses))
+        {
+            failing++;
+        }
+    }
+    pthread_mutex_unlock(&mMutex);
+    return failing;
+}
+
+void VodKeepAlive::getStats(tKeepAliveStats *stats)
+{
+    pthread_mutex_lock(&mMutex);
+    *stats = mStats;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void VodKeepAlive::logStats(void)
+{
+    pthread_mutex_lock(&mMutex);
+    LOG(DLOGL_NORMAL, "sessions:%d wakeups:%d dues:%d early:%d", mStats.sessions, mStats.wakeups, mStats.dues, mStats.early);
+    for (std::map<void *, Session>::iterator itr = mSessions.begin(); itr != mSessions.end(); ++itr)
+    {
+        const tKeepAliveSessionStats &stats = itr->second.stats;
+        LOG(DLOGL_NORMAL, "%p %s sent:%d answered:%d failed:%d missed:%d rtt ms last:%d avg:%d max:%d",
+            itr->first, itr->second.server.c_str(), stats.sent, stats.answered, stats.failed, stats.missed,
+            stats.lastRttMs, stats.avgRttMs, stats.maxRttMs);
+    }
+    pthread_mutex_unlock(&mMutex);
+}
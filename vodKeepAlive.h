@@ -0,0 +1,130 @@
+/**
+   \file vodKeepAlive.h
+   \class VodKeepAlive
+
+   Keep-alive scheduler of the VOD sessions.
+
+   The sessions do not arm a timer each: one thread wakes up for the session
+   due first.  A session added to a server starts on the next wakeup of that
+   server, and the other sessions to the server that are due within
+   kVodKeepAliveBatchPct of their interval are sent early in the same wakeup,
+   so the keep-alives of a server stay aligned to one wakeup per interval.
+   The next keep-alives of a batch are jittered by up to kVodKeepAliveJitterPct
+   of the interval, always earlier, so that the servers are not all hit at the
+   same time and no keep-alive is late.
+
+   The due function of a session only queues the keep-alive to its event
+   loop; the session reports sent() when it goes out and answered() when the
+   server replies, which gives the keep-alive RTT of the session.  A server
+   whose sessions leave kVodKeepAliveMaxMisses keep-alives in a row unanswered
+   is reported failing before its sessions time out.
+*/
+
+#if !defined(VOD_KEEP_ALIVE_H)
+#define VOD_KEEP_ALIVE_H
+
+#include <stdint.h>
+#include <string>
+#include <map>
+#include <pthread.h>
+
+#define kVodKeepAliveBatchPct       25
+#define kVodKeepAliveJitterPct      10
+#define kVodKeepAliveMaxMisses      2
+
+/// Called from the scheduler thread when session is due, queues its keep-alive
+typedef void (*tKeepAliveDue)(void *session);
+
+typedef struct
+{
+    unsigned int sent;
+    unsigned int answered;
+    unsigned int failed;        ///< answered with an error
+    unsigned int missed;        ///< in a row, unanswered or failed
+    unsigned int lastRttMs;
+    unsigned int avgRttMs;      ///< moving average, 1/8 weight per answer
+    unsigned int maxRttMs;
+} tKeepAliveSessionStats;
+
+typedef struct
+{
+    unsigned int sessions;
+    unsigned int wakeups;       ///< that had keep-alives due
+    unsigned int dues;
+    unsigned int early;         ///< sent early to share a wakeup
+} tKeepAliveStats;
+
+class VodKeepAlive
+{
+public:
+    /// The scheduler shared by the VOD sessions, its thread started
+    static VodKeepAlive* getInstance(void);
+
+    VodKeepAlive();
+    virtual ~VodKeepAlive();
+
+    /// Starts the thread calling runDue(), the unit test calls it itself
+    void start(void);
+
+    /// Schedules session to server ("host:port") every intervalMs, from now on.
+    /// expectsAnswer is false for keep-alives the server does not answer
+    void add(void *session, const std::string &server, uint32_t intervalMs, tKeepAliveDue due, bool expectsAnswer);
+    /// No due call for session once this returns
+    void remove(void *session);
+
+    /// The keep-alive of session went out
+    void sent(void *session);
+    /// The server answered the last keep-alive of session
+    void answered(void *session, bool ok);
+
+    bool getSessionStats(void *session, tKeepAliveSessionStats *stats);
+    /// Sessions to server with kVodKeepAliveMaxMisses or more keep-alives missed
+    unsigned int failingSessions(const std::string &server);
+
+    /// Calls the due function of the sessions due now
+    void runDue(void);
+
+    void getStats(tKeepAliveStats *stats);
+    void logStats(void);
+
+protected:
+    /// Monotonic clock in ms, overridden by the unit test
+    virtual uint64_t nowMs(void);
+    /// Jitter of a batch in 1/1000 of the interval, below kVodKeepAliveJitterPct * 10
+    virtual uint32_t jitterPermille(void);
+
+private:
+    struct Session
+    {
+        std::string     server;
+        uint32_t        intervalMs;
+        uint64_t        dueMs;
+        tKeepAliveDue   due;
+        bool            expectsAnswer;
+        bool            awaiting;       ///< sent, no answer yet
+        uint64_t        sentMs;
+        tKeepAliveSessionStats stats;
+    };
+
+    static void *SchedulerThread(void *arg);
+    uint64_t nextDueMs(void);
+    void missed(Session &session);
+
+    pthread_mutex_t mMutex;
+    pthread_cond_t  mCond;
+    pthread_t       mThread;
+    bool            mThreadStarted;
+    bool            mExit;
+    void            *mCalling;      ///< session whose due function runs
+    uint32_t        mSeed;
+    std::map<void *, Session> mSessions;
+    tKeepAliveStats mStats;
+
+    static VodKeepAlive *mInstance;
+    static pthread_mutex_t mInstanceMutex;
+
+    VodKeepAlive(const VodKeepAlive&);
+    VodKeepAlive& operator=(const VodKeepAlive&);
+};
+
+#endif
@@ -0,0 +1,185 @@
+/**
+
+\file vodKeepAlive_test.h -- contains the cxxtest test cases for the VOD keep-alive scheduler
+
+The scheduler runs on a clock the test sets, with a fixed jitter and without
+its thread: the test calls runDue() itself.  The sessions are plain tokens
+whose due calls are counted.
+*/
+
+#if !defined(VOD_KEEP_ALIVE_TEST_H)
+#define VOD_KEEP_ALIVE_TEST_H
+
+#include <cxxtest/TestSuite.h>
+
+#include "vodKeepAlive.h"
+
+#define kTestSessions       8
+
+static int gDue[kTestSessions];
+
+static void stubDue(void *session)
+{
+    gDue[(long) session]++;
+}
+
+class TestVodKeepAlive : public VodKeepAlive
+{
+public:
+    TestVodKeepAlive() : mNow(1000000), mJitter(0)
+    {
+        for (int i = 0; i < kTestSessions; i++)
+        {
+            gDue[i] = 0;
+        }
+    }
+
+    uint64_t mNow;
+    uint32_t mJitter;
+
+protected:
+    uint64_t nowMs(void)
+    {
+        return mNow;
+    }
+
+    uint32_t jitterPermille(void)
+    {
+        return mJitter;
+    }
+};
+
+#define kTestSrm        "10.1.2.3:13819"
+#define kTestRtsp       "10.4.5.6:554"
+#define SESSION(n)      ((void *)(long)(n))
+
+class vodKeepAliveTestSuite : public CxxTest::TestSuite
+{
+public:
+
+    void testBatchPerServer()
+    {
+        TestVodKeepAlive scheduler;
+        tKeepAliveStats stats;
+
+        // three sessions to the SRM started a second apart, one to the RTSP server
+        scheduler.add(SESSION(1), kTestSrm, 10000, stubDue, false);
+        scheduler.mNow += 1000;
+        scheduler.add(SESSION(2), kTestSrm, 10000, stubDue, false);
+        scheduler.mNow += 1000;
+        scheduler.add(SESSION(3), kTestSrm, 11000, stubDue, false);
+        scheduler.add(SESSION(4), kTestRtsp, 10000, stubDue, true);
+
+        scheduler.mNow += 7999;
+        scheduler.runDue();
+        TS_ASSERT_EQUALS(gDue[1], 0);
+
+        // they joined the wakeup of the first one
+        scheduler.mNow += 1;
+        scheduler.runDue();
+        TS_ASSERT_EQUALS(gDue[1], 1);
+        TS_ASSERT_EQUALS(gDue[2], 1);
+        TS_ASSERT_EQUALS(gDue[3], 1);
+        TS_ASSERT_EQUALS(gDue[4], 0);
+
+        scheduler.mNow += 2000;
+        scheduler.runDue();
+        TS_ASSERT_EQUALS(gDue[4], 1);
+
+        // the longer interval is sent early to stay in the wakeup of its server
+        scheduler.mNow += 8000;
+        scheduler.runDue();
+        TS_ASSERT_EQUALS(gDue[1], 2);
+        TS_ASSERT_EQUALS(gDue[2], 2);
+        TS_ASSERT_EQUALS(gDue[3], 2);
+
+        scheduler.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.sessions, 4u);
+        TS_ASSERT_EQUALS(stats.wakeups, 3u);
+        TS_ASSERT_EQUALS(stats.dues, 7u);
+        TS_ASSERT_EQUALS(stats.early, 1u);
+    }
+
+    void testJitterNeverLate()
+    {
+        TestVodKeepAlive scheduler;
+
+        scheduler.mJitter = 50;
+        scheduler.add(SESSION(1), kTestSrm, 10000, stubDue, false);
+        scheduler.mNow += 10000;
+        scheduler.runDue();
+        TS_ASSERT_EQUALS(gDue[1], 1);
+
+        // 5% of the interval earlier
+        scheduler.mNow += 9499;
+        scheduler.runDue();
+        TS_ASSERT_EQUALS(gDue[1], 1);
+        scheduler.mNow += 1;
+        scheduler.runDue();
+        TS_ASSERT_EQUALS(gDue[1], 2);
+    }
+
+    void testRttAndMisses()
+    {
+        TestVodKeepAlive scheduler;
+        tKeepAliveSessionStats stats;
+
+        scheduler.add(SESSION(1), kTestRtsp, 10000, stubDue, true);
+        scheduler.add(SESSION(2), kTestSrm, 10000, stubDue, false);
+
+        scheduler.sent(SESSION(1));
+        scheduler.mNow += 40;
+        scheduler.answered(SESSION(1), true);
+        TS_ASSERT(scheduler.getSessionStats(SESSION(1), &stats));
+        TS_ASSERT_EQUALS(stats.lastRttMs, 40u);
+        TS_ASSERT_EQUALS(stats.avgRttMs, 40u);
+
+        // a late answer to nothing pending is ignored
+        scheduler.answered(SESSION(1), true);
+        scheduler.getSessionStats(SESSION(1), &stats);
+        TS_ASSERT_EQUALS(stats.answered, 1u);
+
+        // the server stops answering
+        scheduler.sent(SESSION(1));
+        scheduler.sent(SESSION(1));
+        TS_ASSERT_EQUALS(scheduler.failingSessions(kTestRtsp), 0u);
+        scheduler.answered(SESSION(1), false);
+        TS_ASSERT_EQUALS(scheduler.failingSessions(kTestRtsp), 1u);
+        scheduler.getSessionStats(SESSION(1), &stats);
+        TS_ASSERT_EQUALS(stats.sent, 3u);
+        TS_ASSERT_EQUALS(stats.failed, 1u);
+        TS_ASSERT_EQUALS(stats.missed, 2u);
+
+        scheduler.sent(SESSION(1));
+        scheduler.mNow += 120;
+        scheduler.answered(SESSION(1), true);
+        TS_ASSERT_EQUALS(scheduler.failingSessions(kTestRtsp), 0u);
+        scheduler.getSessionStats(SESSION(1), &stats);
+        TS_ASSERT_EQUALS(stats.maxRttMs, 120u);
+        TS_ASSERT_EQUALS(stats.avgRttMs, 50u);
+
+        // keep-alives without an answer are never missed
+        scheduler.sent(SESSION(2));
+        scheduler.sent(SESSION(2));
+        scheduler.sent(SESSION(2));
+        TS_ASSERT_EQUALS(scheduler.failingSessions(kTestSrm), 0u);
+    }
+
+    void testRemove()
+    {
+        TestVodKeepAlive scheduler;
+        tKeepAliveSessionStats stats;
+
+        scheduler.add(SESSION(1), kTestSrm, 10000, stubDue, false);
+        scheduler.add(SESSION(2), kTestSrm, 10000, stubDue, false);
+        scheduler.remove(SESSION(1));
+        scheduler.remove(SESSION(5));
+        scheduler.mNow += 10000;
+        scheduler.runDue();
+        TS_ASSERT_EQUALS(gDue[1], 0);
+        TS_ASSERT_EQUALS(gDue[2], 1);
+        TS_ASSERT(!scheduler.getSessionStats(SESSION(1), &stats));
+    }
+};
+
+#endif
@@ -0,0 +1,385 @@
+/**
+   \file vodSessionPrewarm.cpp
+   \class VodSessionPrewarm
+
+Implementation file for the VOD sessions set up ahead of Load
+*/
+
+#include <string.h>
+#include <time.h>
+#include <dlog.h>
+#include "pthread_named.h"
+
+#include "vodSessionPrewarm.h"
+#include "monotonicTime.h"
+
+#define LOG(level, msg, args...)  dlog(DL_MSP_ONDEMAND, level,"VodSessionPrewarm:%s:%d " msg, __FUNCTION__, __LINE__, ##args);
+
+VodSessionPrewarm* VodSessionPrewarm::mInstance = NULL;
+pthread_mutex_t VodSessionPrewarm::mInstanceMutex = PTHREAD_MUTEX_INITIALIZER;
+
+VodSessionPrewarm* VodSessionPrewarm::getInstance(void)
+{
+    pthread_mutex_lock(&mInstanceMutex);
+    if (mInstance == NULL)
+    {
+        mInstance = new VodSessionPrewarm();
+    }
+    pthread_mutex_unlock(&mInstanceMutex);
+    return mInstance;
+}
+
+VodSessionPrewarm::VodSessionPrewarm()
+{
+    pthread_condattr_t attr;
+
+    pthread_mutex_init(&mMutex, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&mCond, &attr);
+    pthread_condattr_destroy(&attr);
+    mThreadStarted = false;
+    mExit = false;
+    mOpen = NULL;
+    mClose = NULL;
+    mHoldSecs = kVodPrewarmHoldSecs;
+    mMaxHoldSecs = kVodPrewarmMaxHoldSecs;
+    mMaxSessions = kVodPrewarmMaxSessions;
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+VodSessionPrewarm::~VodSessionPrewarm()
+{
+    pthread_mutex_lock(&mMutex);
+    mExit = true;
+    bool started = mThreadStarted;
+    pthread_cond_signal(&mCond);
+    pthread_mutex_unlock(&mMutex);
+
+    if (started)
+    {
+        pthread_join(mThread, NULL);
+    }
+    releaseAll();
+    pthread_cond_destroy(&mCond);
+    pthread_mutex_destroy(&mMutex);
+}
+
+uint64_t VodSessionPrewarm::nowMs(void)
+{
+    return monotonicNowMs();
+}
+
+void VodSessionPrewarm::setSessionOps(tPrewarmOpen open, tPrewarmClose close)
+{
+    pthread_mutex_lock(&mMutex);
+    mOpen = open;
+    mClose = close;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void VodSessionPrewarm::setHoldSecs(unsigned int secs)
+{
+    pthread_mutex_lock(&mMutex);
+    mHoldSecs = secs;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void VodSessionPrewarm::setMaxHoldSecs(unsigned int secs)
+{
+    pthread_mutex_lock(&mMutex);
+    mMaxHoldSecs = secs;
+    pthread_mutex_unlock(&mMutex);
+}
+
+// called with mMutex held
+uint64_t VodSessionPrewarm::holdUntilLocked(uint64_t heldSinceMs)
+{
+    uint64_t expiresMs = nowMs() + (uint64_t) mHoldSecs * 1000;
+    uint64_t maxMs = heldSinceMs + (uint64_t) mMaxHoldSecs * 1000;
+
+    return (expiresMs < maxMs) ? expiresMs : maxMs;
+}
+
+void VodSessionPrewarm::setMaxSessions(unsigned int sessions)
+{
+    std::list<Entry> evicted;
+
+    pthread_mutex_lock(&mMutex);
+    mMaxSessions = sessions;
+    while (mHeld.size() > mMaxSessions)
+    {
+        evicted.push_back(mHeld.front());
+        mHeld.pop_front();
+    }
+    pthread_mutex_unlock(&mMutex);
+    close(evicted, false);
+}
+
+// the sessions are closed without the lock, a teardown waits for the event thread
+void VodSessionPrewarm::close(const std::list<Entry> &entries, bool expired)
+{
+    if (entries.empty())
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&mMutex);
+    tPrewarmClose closeSession = mClose;
+    mStats.wasted += entries.size();
+    if (expired)
+    {
+        mStats.expired += entries.size();
+    }
+    pthread_mutex_unlock(&mMutex);
+
+    for (std::list<Entry>::const_iterator itr = entries.begin(); itr != entries.end(); ++itr)
+    {
+        LOG(DLOGL_NORMAL, "release %s: %p %s", itr->url.c_str(), itr->session, expired ? "expired" : "not loaded");
+        if (closeSession)
+        {
+            closeSession(itr->session);
+        }
+    }
+}
+
+void *VodSessionPrewarm::SweepThread(void *arg)
+{
+    VodSessionPrewarm *pool = (VodSessionPrewarm *) arg;
+
+    pthread_mutex_lock(&pool->mMutex);
+    while (!pool->mExit)
+    {
+        if (pool->mHeld.empty())
+        {
+            pthread_cond_wait(&pool->mCond, &pool->mMutex);
+            continue;
+        }
+
+        struct timespec ts;
+        monotonicDeadlineIn(kVodPrewarmSweepMs, &ts);
+        pthread_cond_timedwait(&pool->mCond, &pool->mMutex, &ts);
+        if (pool->mExit)
+        {
+            break;
+        }
+        pthread_mutex_unlock(&pool->mMutex);
+        pool->expire();
+        pthread_mutex_lock(&pool->mMutex);
+    }
+    pthread_mutex_unlock(&pool->mMutex);
+    return NULL;
+}
+
+// called with mMutex held
+void VodSessionPrewarm::startThread(void)
+{
+    if (!mThreadStarted)
+    {
+        if (pthread_create(&mThread, NULL, SweepThread, this) != 0)
+        {
+            LOG(DLOGL_ERROR, ":%m: Error creating the prewarm sweep thread");
+            return;
+        }
+        mThreadStarted = true;
+        if (pthread_setname_np(mThread, "VOD Prewarm") != 0)
+        {
+            LOG(DLOGL_ERROR, "ERROR: %m: Thread Setname Failed.");
+        }
+    }
+    pthread_cond_signal(&mCond);
+}
+
+bool VodSessionPrewarm::prewarm(const std::string &url)
+{
+    std::list<Entry> evicted;
+
+    pthread_mutex_lock(&mMutex);
+    tPrewarmOpen openSession = mOpen;
+    if ((openSession == NULL) || (mMaxSessions == 0) || url.empty())
+    {
+        pthread_mutex_unlock(&mMutex);
+        return false;
+    }
+    for (std::list<Entry>::iterator itr = mHeld.begin(); itr != mHeld.end(); ++itr)
+    {
+        if (itr->url == url)
+        {
+            // focused again, held from now up to the max hold
+            itr->expiresMs = holdUntilLocked(itr->heldSinceMs);
+            pthread_mutex_unlock(&mMutex);
+            return true;
+        }
+    }
+    pthread_mutex_unlock(&mMutex);
+
+    OnDemand *session = openSession(url);
+
+    pthread_mutex_lock(&mMutex);
+    if (session == NULL)
+    {
+        mStats.failed++;
+        pthread_mutex_unlock(&mMutex);
+        LOG(DLOGL_ERROR, "no session for %s", url.c_str());
+        return false;
+    }
+
+    Entry entry;
+    entry.url = url;
+    entry.session = session;
+    entry.heldSinceMs = nowMs();
+    entry.expiresMs = holdUntilLocked(entry.heldSinceMs);
+
+    // set up twice by concurrent focus changes: the later one goes
+    for (std::list<Entry>::iterator itr = mHeld.begin(); itr != mHeld.end(); ++itr)
+    {
+        if (itr->url == url)
+        {
+            evicted.push_back(entry);
+            entry = *itr;
+            mHeld.erase(itr);
+            break;
+        }
+    }
+    mHeld.push_back(entry);
+    mStats.prewarms++;
+    while (mHeld.size() > mMaxSessions)
+    {
+        evicted.push_back(mHeld.front());
+        mHeld.pop_front();
+    }
+    startThread();
+    pthread_mutex_unlock(&mMutex);
+
+    LOG(DLOGL_NORMAL, "holding %p for %s", session, url.c_str());
+    close(evicted, false);
+    return true;
+}
+
+void VodSessionPrewarm::release(const std::string &url)
+{
+    std::list<Entry> released;
+
+    pthread_mutex_lock(&mMutex);
+    for (std::list<Entry>::iterator itr = mHeld.begin(); itr != mHeld.end(); ++itr)
+    {
+        if (itr->url == url)
+        {
+            released.push_back(*itr);
+            mHeld.erase(itr);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&mMutex);
+    close(released, false);
+}
+
+OnDemand* VodSessionPrewarm::take(const std::string &url)
+{
+    OnDemand *session = NULL;
+
+    pthread_mutex_lock(&mMutex);
+    if (mOpen == NULL)
+    {
+        // not in use, no miss either
+        pthread_mutex_unlock(&mMutex);
+        return NULL;
+    }
+    for (std::list<Entry>::iterator itr = mHeld.begin(); itr != mHeld.end(); ++itr)
+    {
+        if (itr->url == url)
+        {
+            session = itr->session;
+            mHeld.erase(itr);
+            break;
+        }
+    }
+    if (session)
+    {
+        mStats.hits++;
+    }
+    else
+    {
+        mStats.misses++;
+    }
+    pthread_mutex_unlock(&mMutex);
+
+    LOG(DLOGL_NORMAL, "%s %s", session ? "hit" : "miss", url.c_str());
+    return session;
+}
+
+void VodSessionPrewarm::discard(OnDemand *session)
+{
+    std::list<Entry> discarded;
+    Entry entry;
+
+    entry.session = session;
+    entry.heldSinceMs = 0;
+    entry.expiresMs = 0;
+    discarded.push_back(entry);
+
+    pthread_mutex_lock(&mMutex);
+    mStats.hits--;
+    mStats.misses++;
+    pthread_mutex_unlock(&mMutex);
+    close(discarded, false);
+}
+
+void VodSessionPrewarm::expire(void)
+{
+    std::list<Entry> expired;
+
+    pthread_mutex_lock(&mMutex);
+    uint64_t now = nowMs();
+    std::list<Entry>::iterator itr = mHeld.begin();
+    while (itr != mHeld.end())
+    {
+        if (now >= itr->expiresMs)
+        {
+            expired.push_back(*itr);
+            itr = mHeld.erase(itr);
+        }
+        else
+        {
+            ++itr;
+        }
+    }
+    pthread_mutex_unlock(&mMutex);
+    close(expired, true);
+}
+
+void VodSessionPrewarm::releaseAll(void)
+{
+    std::list<Entry> released;
+
+    pthread_mutex_lock(&mMutex);
+    released.swap(mHeld);
+    pthread_mutex_unlock(&mMutex);
+    close(released, false);
+}
+
+unsigned int VodSessionPrewarm::heldSessions(void)
+{
+    pthread_mutex_lock(&mMutex);
+    unsigned int held = mHeld.size();
+    pthread_mutex_unlock(&mMutex);
+    return held;
+}
+
+void VodSessionPrewarm::getStats(tPrewarmStats *stats)
+{
+    pthread_mutex_lock(&mMutex);
+    *stats = mStats;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void VodSessionPrewarm::logStats(void)
+{
+    tPrewarmStats stats;
+
+    getStats(&stats);
+    unsigned int loads = stats.hits + stats.misses;
+    LOG(DLOGL_NORMAL, "prewarms:%d failed:%d hits:%d misses:%d hitRate:%d%% wasted:%d expired:%d",
+        stats.prewarms, stats.failed, stats.hits, stats.misses, loads ? (stats.hits * 100) / loads : 0,
+        stats.wasted, stats.expired);
+}
@@ -0,0 +1,124 @@
+/**
+   \file vodSessionPrewarm.h
+   \class VodSessionPrewarm
+
+   VOD sessions set up ahead of Load.
+
+   When the guide focuses an asset the DSM-CC session of the asset is set up
+   speculatively (OnDemand::PrewarmSession()), so that the SRM confirm with
+   the tuning parameters is in by the time the asset is loaded.  A held
+   session is adopted by the OnDemand loading its URL, released when the
+   guide moves the focus away, and torn down by the background thread when it
+   has not been loaded within the hold window.  Focusing the asset again holds
+   it for another window, but never for more than mMaxHoldSecs since it was
+   set up, below the session-in-progress timeout of the SRM.  At most
+   mMaxSessions are held, the oldest is released for a new one.
+
+   Every held session takes SRM and QAM capacity of the head-end: the hit rate
+   and the number of sessions set up for nothing are counted, to tune the
+   hold window and the number of sessions against it.
+
+   The pool only keeps the sessions, they are opened and closed by the
+   functions given with setSessionOps().  These may block and are called
+   without the pool lock, never from the OnDemand event thread.
+*/
+
+#if !defined(VOD_SESSION_PREWARM_H)
+#define VOD_SESSION_PREWARM_H
+
+#include <stdint.h>
+#include <string>
+#include <list>
+#include <pthread.h>
+
+#define kVodPrewarmHoldSecs         10
+#define kVodPrewarmMaxHoldSecs      60
+#define kVodPrewarmMaxSessions      2
+#define kVodPrewarmSweepMs          500
+
+class OnDemand;
+
+/// Starts the session setup of url, NULL when it could not be started
+typedef OnDemand* (*tPrewarmOpen)(const std::string &url);
+/// Tears the session down and frees it
+typedef void (*tPrewarmClose)(OnDemand *session);
+
+typedef struct
+{
+    unsigned int prewarms;      ///< sessions set up ahead of Load
+    unsigned int failed;        ///< setups that could not be started
+    unsigned int hits;          ///< loads that adopted a held session
+    unsigned int misses;        ///< loads that set up their own session
+    unsigned int wasted;        ///< sessions torn down without being loaded
+    unsigned int expired;       ///< of wasted, at the end of the hold window
+} tPrewarmStats;
+
+class VodSessionPrewarm
+{
+public:
+    /// The pool shared by the OnDemand controllers
+    static VodSessionPrewarm* getInstance(void);
+
+    VodSessionPrewarm();
+    virtual ~VodSessionPrewarm();
+
+    void setSessionOps(tPrewarmOpen open, tPrewarmClose close);
+    void setHoldSecs(unsigned int secs);
+    void setMaxHoldSecs(unsigned int secs);
+    void setMaxSessions(unsigned int sessions);
+
+    /// Sets up a session for url, or holds the one set up already for another window
+    bool prewarm(const std::string &url);
+    /// Releases the session held for url
+    void release(const std::string &url);
+    /// The session held for url, handed over to the caller; NULL when none is held
+    OnDemand* take(const std::string &url);
+    /// Closes a session take() returned that turned out to be unusable, as a miss
+    void discard(OnDemand *session);
+    /// Releases the held sessions past their hold window, done by the background thread
+    void expire(void);
+    void releaseAll(void);
+
+    unsigned int heldSessions(void);
+    void getStats(tPrewarmStats *stats);
+    void logStats(void);
+
+protected:
+    /// Monotonic clock in ms, overridden by the unit test
+    virtual uint64_t nowMs(void);
+
+private:
+    struct Entry
+    {
+        std::string     url;
+        OnDemand        *session;
+        uint64_t        heldSinceMs;
+        uint64_t        expiresMs;
+    };
+
+    static void *SweepThread(void *arg);
+    void startThread(void);
+    void close(const std::list<Entry> &entries, bool expired);
+    uint64_t holdUntilLocked(uint64_t heldSinceMs);
+
+    pthread_mutex_t mMutex;
+    pthread_cond_t  mCond;
+    pthread_t       mThread;
+    bool            mThreadStarted;
+    bool            mExit;
+    tPrewarmOpen    mOpen;
+    tPrewarmClose   mClose;
+    unsigned int    mHoldSecs;
+    unsigned int    mMaxHoldSecs;
+    unsigned int    mMaxSessions;
+    std::list<Entry> mHeld;         ///< oldest first
+    tPrewarmStats   mStats;
+
+    static VodSessionPrewarm *mInstance;
+    static pthread_mutex_t mInstanceMutex;
+
+    VodSessionPrewarm(const VodSessionPrewarm&);
+    VodSessionPrewarm& operator=(const VodSessionPrewarm&);
+};
+
+#endif
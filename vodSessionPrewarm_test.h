@@ -0,0 +1,202 @@
+/**
+
+\file vodSessionPrewarm_test.h -- contains the cxxtest test cases for the VOD session prewarm pool
+
+The pool runs on a clock the test sets, with stub open and close functions
+that count the sessions set up and torn down.  The sessions are plain tokens,
+no OnDemand is created.
+*/
+
+#if !defined(VOD_SESSION_PREWARM_TEST_H)
+#define VOD_SESSION_PREWARM_TEST_H
+
+#include <cxxtest/TestSuite.h>
+
+#include "vodSessionPrewarm.h"
+
+static volatile int gOpened;
+static volatile int gClosed;
+static volatile bool gOpenFails;
+
+static OnDemand* stubOpen(const std::string &url)
+{
+    (void) url;
+    if (gOpenFails)
+    {
+        return NULL;
+    }
+    return (OnDemand *)(long) __sync_add_and_fetch(&gOpened, 1);
+}
+
+static void stubClose(OnDemand *session)
+{
+    (void) session;
+    __sync_fetch_and_add(&gClosed, 1);
+}
+
+class TestVodSessionPrewarm : public VodSessionPrewarm
+{
+public:
+    TestVodSessionPrewarm() : mNow(1000000)
+    {
+        setSessionOps(stubOpen, stubClose);
+        gOpened = 0;
+        gClosed = 0;
+        gOpenFails = false;
+    }
+
+    volatile uint64_t mNow;
+
+protected:
+    uint64_t nowMs(void)
+    {
+        return mNow;
+    }
+};
+
+class vodSessionPrewarmTestSuite : public CxxTest::TestSuite
+{
+public:
+
+    void testHitAdoptsHeldSession()
+    {
+        TestVodSessionPrewarm pool;
+        tPrewarmStats stats;
+
+        TS_ASSERT(pool.prewarm("lscp://asset/1"));
+        TS_ASSERT_EQUALS(pool.heldSessions(), 1u);
+        TS_ASSERT_EQUALS(pool.take("lscp://asset/1"), (OnDemand *) 1);
+        TS_ASSERT_EQUALS(pool.heldSessions(), 0u);
+
+        // a session is adopted once
+        TS_ASSERT(pool.take("lscp://asset/1") == NULL);
+        TS_ASSERT(pool.take("lscp://asset/2") == NULL);
+
+        pool.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.prewarms, 1u);
+        TS_ASSERT_EQUALS(stats.hits, 1u);
+        TS_ASSERT_EQUALS(stats.misses, 2u);
+        TS_ASSERT_EQUALS(stats.wasted, 0u);
+        TS_ASSERT_EQUALS(gClosed, 0);
+    }
+
+    void testNotInUse()
+    {
+        VodSessionPrewarm pool;
+        tPrewarmStats stats;
+
+        TS_ASSERT(!pool.prewarm("lscp://asset/1"));
+        TS_ASSERT(pool.take("lscp://asset/1") == NULL);
+        pool.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.misses, 0u);
+    }
+
+    void testExpiry()
+    {
+        TestVodSessionPrewarm pool;
+        tPrewarmStats stats;
+
+        pool.setHoldSecs(5);
+        TS_ASSERT(pool.prewarm("lscp://asset/1"));
+        pool.mNow += 4999;
+        pool.expire();
+        TS_ASSERT_EQUALS(pool.heldSessions(), 1u);
+
+        // focused again: held for another window
+        TS_ASSERT(pool.prewarm("lscp://asset/1"));
+        TS_ASSERT_EQUALS(gOpened, 1);
+        pool.mNow += 4999;
+        pool.expire();
+        TS_ASSERT_EQUALS(pool.heldSessions(), 1u);
+
+        pool.mNow += 1;
+        pool.expire();
+        TS_ASSERT_EQUALS(pool.heldSessions(), 0u);
+        TS_ASSERT_EQUALS(gClosed, 1);
+        TS_ASSERT(pool.take("lscp://asset/1") == NULL);
+
+        pool.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.wasted, 1u);
+        TS_ASSERT_EQUALS(stats.expired, 1u);
+        TS_ASSERT_EQUALS(stats.misses, 1u);
+    }
+
+    void testMaxHold()
+    {
+        TestVodSessionPrewarm pool;
+
+        pool.setHoldSecs(5);
+        pool.setMaxHoldSecs(12);
+        TS_ASSERT(pool.prewarm("lscp://asset/1"));
+
+        // focused again and again, held no longer than the max hold
+        pool.mNow += 4000;
+        TS_ASSERT(pool.prewarm("lscp://asset/1"));
+        pool.mNow += 4000;
+        TS_ASSERT(pool.prewarm("lscp://asset/1"));
+        pool.mNow += 3999;
+        TS_ASSERT(pool.prewarm("lscp://asset/1"));
+        pool.expire();
+        TS_ASSERT_EQUALS(pool.heldSessions(), 1u);
+
+        pool.mNow += 1;
+        pool.expire();
+        TS_ASSERT_EQUALS(pool.heldSessions(), 0u);
+        TS_ASSERT_EQUALS(gOpened, 1);
+        TS_ASSERT_EQUALS(gClosed, 1);
+    }
+
+    void testOldestEvicted()
+    {
+        TestVodSessionPrewarm pool;
+        tPrewarmStats stats;
+
+        pool.setMaxSessions(2);
+        TS_ASSERT(pool.prewarm("lscp://asset/1"));
+        TS_ASSERT(pool.prewarm("lscp://asset/2"));
+        TS_ASSERT(pool.prewarm("lscp://asset/3"));
+        TS_ASSERT_EQUALS(pool.heldSessions(), 2u);
+        TS_ASSERT_EQUALS(gClosed, 1);
+        TS_ASSERT(pool.take("lscp://asset/1") == NULL);
+        TS_ASSERT_EQUALS(pool.take("lscp://asset/3"), (OnDemand *) 3);
+
+        pool.setMaxSessions(0);
+        TS_ASSERT_EQUALS(pool.heldSessions(), 0u);
+        TS_ASSERT(!pool.prewarm("lscp://asset/4"));
+
+        pool.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.prewarms, 3u);
+        TS_ASSERT_EQUALS(stats.wasted, 2u);
+        TS_ASSERT_EQUALS(stats.expired, 0u);
+    }
+
+    void testReleaseAndDiscard()
+    {
+        TestVodSessionPrewarm pool;
+        tPrewarmStats stats;
+
+        TS_ASSERT(pool.prewarm("lscp://asset/1"));
+        pool.release("lscp://asset/1");
+        TS_ASSERT_EQUALS(gClosed, 1);
+        TS_ASSERT_EQUALS(pool.heldSessions(), 0u);
+
+        // a session that failed its setup on the way counts as a miss
+        TS_ASSERT(pool.prewarm("lscp://asset/2"));
+        OnDemand *session = pool.take("lscp://asset/2");
+        TS_ASSERT(session != NULL);
+        pool.discard(session);
+        TS_ASSERT_EQUALS(gClosed, 2);
+
+        gOpenFails = true;
+        TS_ASSERT(!pool.prewarm("lscp://asset/3"));
+
+        pool.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.prewarms, 2u);
+        TS_ASSERT_EQUALS(stats.failed, 1u);
+        TS_ASSERT_EQUALS(stats.hits, 0u);
+        TS_ASSERT_EQUALS(stats.misses, 1u);
+        TS_ASSERT_EQUALS(stats.wasted, 2u);
+    }
+};
+
+#endif
@@ -39,23 +39,19 @@ ui8* Utils::GetBuffer(ui8 *getPosition, ui8 *buffer, ui32 lengthInBytes)
 
 ui8 * Utils::Put1Byte(ui8 * pos, ui8 n)
 {
-    *(pos + 0) = ((n >> 0) & 0xFF);
+    *pos = n;
     return pos + 1;
 }
 
 ui8 * Utils::Put2Byte(ui8 * pos, ui16 n)
 {
-    *(pos + 0) = ((n >> 8) & 0xFF);
-    *(pos + 1) = ((n >> 0) & 0xFF);
+    Store2Byte(pos, n);
     return pos + 2;
 }
 
 ui8 * Utils::Put4Byte(ui8 * pos, ui32 n)
 {
-    *(pos + 0) = ((n >> 24) & 0xFF);
-    *(pos + 1) = ((n >> 16) & 0xFF);
-    *(pos + 2) = ((n >> 8) & 0xFF);
-    *(pos + 3) = ((n >> 0) & 0xFF);
+    Store4Byte(pos, n);
     return pos + 4;
 }
 
@@ -67,14 +63,13 @@ ui8 * Utils::Get1Byte(const ui8 * pos, ui8 * n)
 
 ui8 * Utils::Get2Byte(const ui8 * pos, ui16 * n)
 {
-    *n = ((*(pos + 0) << 8) | (*(pos + 1) << 0));
+    *n = Load2Byte(pos);
     return (ui8*) pos + 2;
 }
 
 ui8 * Utils::Get4Byte(const ui8 * pos, ui32 * n)
 {
-    *n = ((*(pos + 0) << 24) | (*(pos + 1) << 16) | (*(pos + 2) << 8) | (*(pos
-            + 3) << 0));
+    *n = Load4Byte(pos);
     return (ui8*) pos + 4;
 }
 
@@ -15,6 +15,7 @@
 #define _VODUTILS_H
 
 #include <cstring>
+#include <arpa/inet.h>
 
 // enum for status
 typedef enum
@@ -48,6 +49,248 @@ public:
     static ui8* Put2Byte(ui8 * pos, ui16 n);
     static ui8* Put4Byte(ui8 * pos, ui32 n);
 
+    // big endian value at any alignment, one load and one byte swap (none on a big endian cpu)
+    static ui8 Load1Byte(const ui8 *pos)
+    {
+        return *pos;
+    }
+    static ui16 Load2Byte(const ui8 *pos)
+    {
+        ui16 n;
+        memcpy(&n, pos, sizeof(n));
+        return ntohs(n);
+    }
+    static ui32 Load4Byte(const ui8 *pos)
+    {
+        ui32 n;
+        memcpy(&n, pos, sizeof(n));
+        return ntohl(n);
+    }
+    static void Store1Byte(ui8 *pos, ui8 n)
+    {
+        *pos = n;
+    }
+    static void Store2Byte(ui8 *pos, ui16 n)
+    {
+        n = htons(n);
+        memcpy(pos, &n, sizeof(n));
+    }
+    static void Store4Byte(ui8 *pos, ui32 n)
+    {
+        n = htonl(n);
+        memcpy(pos, &n, sizeof(n));
+    }
+};
+
+// Field of a fixed size header at a compile time offset, T is ui8, ui16 or ui32.
+// A header is a struct of such typedefs and an enum Size, see DsmccHeaderLayout.
+template <ui32 Offset, class T> struct VodField;
+
+template <ui32 Offset> struct VodField<Offset, ui8>
+{
+    enum { End = Offset + 1 };
+    static ui8 get(const ui8 *hdr)
+    {
+        return Utils::Load1Byte(hdr + Offset);
+    }
+    static void put(ui8 *hdr, ui8 n)
+    {
+        Utils::Store1Byte(hdr + Offset, n);
+    }
+};
+
+template <ui32 Offset> struct VodField<Offset, ui16>
+{
+    enum { End = Offset + 2 };
+    static ui16 get(const ui8 *hdr)
+    {
+        return Utils::Load2Byte(hdr + Offset);
+    }
+    static void put(ui8 *hdr, ui16 n)
+    {
+        Utils::Store2Byte(hdr + Offset, n);
+    }
+};
+
+template <ui32 Offset> struct VodField<Offset, ui32>
+{
+    enum { End = Offset + 4 };
+    static ui32 get(const ui8 *hdr)
+    {
+        return Utils::Load4Byte(hdr + Offset);
+    }
+    static void put(ui8 *hdr, ui32 n)
+    {
+        Utils::Store4Byte(hdr + Offset, n);
+    }
+};
+
+// fails to compile when the last field of a layout does not end at its Size
+#define VOD_LAYOUT_CHECK(Layout, LastField) \
+    typedef char Layout##_size_check[((ui32) Layout::LastField::End == (ui32) Layout::Size) ? 1 : -1]
+
+// Bounds checked big endian cursor over a message.  The first read past the
+// end fails the reader and it stays failed, reading 0 and NULL from then on,
+// so a run of fields is read unchecked and ok() tested once at the end.
+// fixed<Layout>() checks a whole header once and returns it for VodField reads.
+class ByteReader
+{
+public:
+    ByteReader(const ui8 *data, ui32 length) : mPos(data), mEnd(data + length), mOk(data != NULL || length == 0) {}
+
+    bool ok() const
+    {
+        return mOk;
+    }
+    ui32 left() const
+    {
+        return mOk ? (ui32)(mEnd - mPos) : 0;
+    }
+    const ui8* pos() const
+    {
+        return mPos;
+    }
+    ui8 get1()
+    {
+        return need(1) ? *mPos++ : 0;
+    }
+    ui16 get2()
+    {
+        if (!need(2))
+        {
+            return 0;
+        }
+        ui16 n = Utils::Load2Byte(mPos);
+        mPos += 2;
+        return n;
+    }
+    ui32 get4()
+    {
+        if (!need(4))
+        {
+            return 0;
+        }
+        ui32 n = Utils::Load4Byte(mPos);
+        mPos += 4;
+        return n;
+    }
+    // the next length bytes, NULL when there are not as many
+    const ui8* view(ui32 length)
+    {
+        if (!need(length))
+        {
+            return NULL;
+        }
+        const ui8 *p = mPos;
+        mPos += length;
+        return p;
+    }
+    template <class Layout> const ui8* fixed()
+    {
+        return view(Layout::Size);
+    }
+
+private:
+    bool need(ui32 length)
+    {
+        if (!mOk || ((ui32)(mEnd - mPos) < length))
+        {
+            mOk = false;
+            return false;
+        }
+        return true;
+    }
+
+    const ui8 *mPos;
+    const ui8 *mEnd;
+    bool mOk;
+};
+
+// Bounds checked big endian writer into a buffer owned by the caller, fails
+// like ByteReader.  written() is 0 once it has failed.
+class ByteWriter
+{
+public:
+    ByteWriter(ui8 *buf, ui32 size) : mStart(buf), mPos(buf), mEnd(buf + size), mOk(buf != NULL) {}
+
+    bool ok() const
+    {
+        return mOk;
+    }
+    ui32 written() const
+    {
+        return mOk ? (ui32)(mPos - mStart) : 0;
+    }
+    ui8* pos() const
+    {
+        return mPos;
+    }
+    void put1(ui8 n)
+    {
+        if (need(1))
+        {
+            *mPos++ = n;
+        }
+    }
+    void put2(ui16 n)
+    {
+        if (need(2))
+        {
+            Utils::Store2Byte(mPos, n);
+            mPos += 2;
+        }
+    }
+    void put4(ui32 n)
+    {
+        if (need(4))
+        {
+            Utils::Store4Byte(mPos, n);
+            mPos += 4;
+        }
+    }
+    // length bytes of data, zeros when data is NULL
+    void putBytes(const ui8 *data, ui32 length)
+    {
+        if (need(length))
+        {
+            if (data)
+            {
+                memcpy(mPos, data, length);
+            }
+            else
+            {
+                memset(mPos, 0, length);
+            }
+            mPos += length;
+        }
+    }
+    // room for a whole header, NULL when there is none, filled in with VodField puts
+    template <class Layout> ui8* fixed()
+    {
+        if (!need(Layout::Size))
+        {
+            return NULL;
+        }
+        ui8 *p = mPos;
+        mPos += Layout::Size;
+        return p;
+    }
+
+private:
+    bool need(ui32 length)
+    {
+        if (!mOk || ((ui32)(mEnd - mPos) < length))
+        {
+            mOk = false;
+            return false;
+        }
+        return true;
+    }
+
+    ui8 *mStart;
+    ui8 *mPos;
+    ui8 *mEnd;
+    bool mOk;
 };
 
 #endif
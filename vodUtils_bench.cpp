@@ -0,0 +1,306 @@
+/** @file vodUtils_bench.cpp
+ *
+ * @brief Compares the big endian field accessors of vodUtils.
+ *
+ * A buffer of back to back DSM-CC message headers, LSC headers and resource
+ * descriptor bodies is read and written:
+ *  - field by field with the byte by byte Get/Put functions Utils had
+ *    before (copied here out of line, as they are called from the
+ *    protocol classes), with a length check per header as
+ *    ParseDsmccMessageHdr() does,
+ *  - with the current Utils::Get/Put functions,
+ *  - with ByteReader/ByteWriter: a header checked once through its layout
+ *    and read with VodField, a descriptor body read with get2()/get4().
+ * Every method must produce the same checksum.
+ * Build with "make vodUtils_bench" and run on the target.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+
+#include "dsmccProtocol.h"
+#include "lscProtocolclass.h"
+
+#define kBenchMessages     4096
+#define kBenchRounds       200
+#define kBenchBodySize     18     // MPEG program descriptor: 8 2 byte fields, one 2 byte count
+#define kBenchLscVersion   0x01
+
+static double nowSecs(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + (ts.tv_nsec / 1e9);
+}
+
+// Utils before the change, byte by byte
+__attribute__((noinline)) static ui8* legacyGet1Byte(const ui8 * pos, ui8 * n)
+{
+    *n = *pos;
+    return (ui8*) pos + 1;
+}
+
+__attribute__((noinline)) static ui8* legacyGet2Byte(const ui8 * pos, ui16 * n)
+{
+    *n = ((*(pos + 0) << 8) | (*(pos + 1) << 0));
+    return (ui8*) pos + 2;
+}
+
+__attribute__((noinline)) static ui8* legacyGet4Byte(const ui8 * pos, ui32 * n)
+{
+    *n = ((*(pos + 0) << 24) | (*(pos + 1) << 16) | (*(pos + 2) << 8) | (*(pos + 3) << 0));
+    return (ui8*) pos + 4;
+}
+
+__attribute__((noinline)) static ui8* legacyPut1Byte(ui8 * pos, ui8 n)
+{
+    *(pos + 0) = ((n >> 0) & 0xFF);
+    return pos + 1;
+}
+
+__attribute__((noinline)) static ui8* legacyPut2Byte(ui8 * pos, ui16 n)
+{
+    *(pos + 0) = ((n >> 8) & 0xFF);
+    *(pos + 1) = ((n >> 0) & 0xFF);
+    return pos + 2;
+}
+
+__attribute__((noinline)) static ui8* legacyPut4Byte(ui8 * pos, ui32 n)
+{
+    *(pos + 0) = ((n >> 24) & 0xFF);
+    *(pos + 1) = ((n >> 16) & 0xFF);
+    *(pos + 2) = ((n >> 8) & 0xFF);
+    *(pos + 3) = ((n >> 0) & 0xFF);
+    return pos + 4;
+}
+
+// one message of the buffer: DSM-CC header, LSC header and a descriptor body
+#define kBenchMessageSize  (DSMCC_MSG_HEADER_SIZE + LSC_HEADER_SIZE + kBenchBodySize)
+
+typedef ui8* (*Get1Fn)(const ui8 *, ui8 *);
+typedef ui8* (*Get2Fn)(const ui8 *, ui16 *);
+typedef ui8* (*Get4Fn)(const ui8 *, ui32 *);
+
+template <Get1Fn get1, Get2Fn get2, Get4Fn get4>
+static ui32 readFields(const std::vector<ui8> &buf)
+{
+    ui32 sum = 0;
+    for (ui32 m = 0; m < kBenchMessages; m++)
+    {
+        ui8 *pos = (ui8 *) &buf[m * kBenchMessageSize];
+        ui32 left = kBenchMessageSize;
+        ui8 b;
+        ui16 s;
+        ui32 l;
+
+        if (left < DSMCC_MSG_HEADER_SIZE)
+        {
+            return 0;
+        }
+        pos = get1(pos, &b);
+        sum += b;
+        pos = get1(pos, &b);
+        sum += b;
+        pos = get2(pos, &s);
+        sum += s;
+        pos = get4(pos, &l);
+        sum += l;
+        pos = get1(pos, &b);
+        pos = get1(pos, &b);
+        sum += b;
+        pos = get2(pos, &s);
+        sum += s;
+        left -= DSMCC_MSG_HEADER_SIZE;
+
+        if (left < LSC_HEADER_SIZE)
+        {
+            return 0;
+        }
+        for (int i = 0; i < 4; i++)
+        {
+            pos = get1(pos, &b);
+            sum += b;
+        }
+        pos = get4(pos, &l);
+        sum += l;
+        left -= LSC_HEADER_SIZE;
+
+        for (ui32 i = 0; (i < kBenchBodySize / 2) && (left >= 2); i++, left -= 2)
+        {
+            pos = get2(pos, &s);
+            sum += s;
+        }
+    }
+    return sum;
+}
+
+static ui32 readFieldsReader(const std::vector<ui8> &buf)
+{
+    ui32 sum = 0;
+    ByteReader reader(&buf[0], buf.size());
+    for (ui32 m = 0; m < kBenchMessages; m++)
+    {
+        const ui8 *dsmcc = reader.fixed<DsmccHeaderLayout>();
+        const ui8 *lscp = reader.fixed<LscpHeaderLayout>();
+        if (!dsmcc || !lscp)
+        {
+            return 0;
+        }
+        sum += DsmccHeaderLayout::ProtocolDiscriminator::get(dsmcc);
+        sum += DsmccHeaderLayout::DsmccType::get(dsmcc);
+        sum += DsmccHeaderLayout::MessageId::get(dsmcc);
+        sum += DsmccHeaderLayout::TransactionId::get(dsmcc);
+        sum += DsmccHeaderLayout::AdaptationLength::get(dsmcc);
+        sum += DsmccHeaderLayout::MessageLength::get(dsmcc);
+
+        sum += LscpHeaderLayout::Version::get(lscp);
+        sum += LscpHeaderLayout::TransactionId::get(lscp);
+        sum += LscpHeaderLayout::Opcode::get(lscp);
+        sum += LscpHeaderLayout::StatusCode::get(lscp);
+        sum += LscpHeaderLayout::StreamHandle::get(lscp);
+
+        for (ui32 i = 0; i < kBenchBodySize / 2; i++)
+        {
+            sum += reader.get2();
+        }
+    }
+    return reader.ok() ? sum : 0;
+}
+
+typedef ui8* (*Put1Fn)(ui8 *, ui8);
+typedef ui8* (*Put2Fn)(ui8 *, ui16);
+typedef ui8* (*Put4Fn)(ui8 *, ui32);
+
+template <Put1Fn put1, Put2Fn put2, Put4Fn put4>
+static void writeFields(std::vector<ui8> &buf)
+{
+    ui8 *pos = &buf[0];
+    for (ui32 m = 0; m < kBenchMessages; m++)
+    {
+        pos = put1(pos, 0x11);
+        pos = put1(pos, DSMCC_SESSMSG_TYPE);
+        pos = put2(pos, dsmcc_ClientSessionSetUpConfirm);
+        pos = put4(pos, m);
+        pos = put1(pos, 0xff);
+        pos = put1(pos, 0);
+        pos = put2(pos, 0x100 + m);
+
+        pos = put1(pos, kBenchLscVersion);
+        pos = put1(pos, m);
+        pos = put1(pos, LSC_PLAY_REPLY);
+        pos = put1(pos, 0);
+        pos = put4(pos, 0xABCD0000 + m);
+
+        for (ui32 i = 0; i < kBenchBodySize / 2; i++)
+        {
+            pos = put2(pos, m * i);
+        }
+    }
+}
+
+static void writeFieldsWriter(std::vector<ui8> &buf)
+{
+    ByteWriter writer(&buf[0], buf.size());
+    for (ui32 m = 0; m < kBenchMessages; m++)
+    {
+        ui8 *dsmcc = writer.fixed<DsmccHeaderLayout>();
+        ui8 *lscp = writer.fixed<LscpHeaderLayout>();
+        if (!dsmcc || !lscp)
+        {
+            return;
+        }
+        DsmccHeaderLayout::ProtocolDiscriminator::put(dsmcc, 0x11);
+        DsmccHeaderLayout::DsmccType::put(dsmcc, DSMCC_SESSMSG_TYPE);
+        DsmccHeaderLayout::MessageId::put(dsmcc, dsmcc_ClientSessionSetUpConfirm);
+        DsmccHeaderLayout::TransactionId::put(dsmcc, m);
+        DsmccHeaderLayout::Reserved::put(dsmcc, 0xff);
+        DsmccHeaderLayout::AdaptationLength::put(dsmcc, 0);
+        DsmccHeaderLayout::MessageLength::put(dsmcc, 0x100 + m);
+
+        LscpHeaderLayout::Version::put(lscp, kBenchLscVersion);
+        LscpHeaderLayout::TransactionId::put(lscp, m);
+        LscpHeaderLayout::Opcode::put(lscp, LSC_PLAY_REPLY);
+        LscpHeaderLayout::StatusCode::put(lscp, 0);
+        LscpHeaderLayout::StreamHandle::put(lscp, 0xABCD0000 + m);
+
+        for (ui32 i = 0; i < kBenchBodySize / 2; i++)
+        {
+            writer.put2(m * i);
+        }
+    }
+}
+
+static void report(const char *method, const char *phase, double secs)
+{
+    printf("%-12s %-8s %10.2f\n", method, phase, secs * 1e9 / ((double) kBenchRounds * kBenchMessages));
+}
+
+int main(void)
+{
+    std::vector<ui8> legacy(kBenchMessages * kBenchMessageSize);
+    std::vector<ui8> utils(legacy.size());
+    std::vector<ui8> writer(legacy.size());
+    volatile ui32 sink = 0;
+    double start;
+
+    printf("%-12s %-8s %10s\n", "method", "phase", "ns/message");
+
+    start = nowSecs();
+    for (int r = 0; r < kBenchRounds; r++)
+    {
+        writeFields<legacyPut1Byte, legacyPut2Byte, legacyPut4Byte>(legacy);
+    }
+    report("byte-by-byte", "write", nowSecs() - start);
+
+    start = nowSecs();
+    for (int r = 0; r < kBenchRounds; r++)
+    {
+        writeFields<Utils::Put1Byte, Utils::Put2Byte, Utils::Put4Byte>(utils);
+    }
+    report("Utils", "write", nowSecs() - start);
+
+    start = nowSecs();
+    for (int r = 0; r < kBenchRounds; r++)
+    {
+        writeFieldsWriter(writer);
+    }
+    report("ByteWriter", "write", nowSecs() - start);
+
+    if ((utils != legacy) || (writer != legacy))
+    {
+        printf("ERROR: messages written differently\n");
+        return 1;
+    }
+
+    ui32 sums[3] = { 0, 0, 0 };
+
+    start = nowSecs();
+    for (int r = 0; r < kBenchRounds; r++)
+    {
+        sink += sums[0] = readFields<legacyGet1Byte, legacyGet2Byte, legacyGet4Byte>(legacy);
+    }
+    report("byte-by-byte", "read", nowSecs() - start);
+
+    start = nowSecs();
+    for (int r = 0; r < kBenchRounds; r++)
+    {
+        sink += sums[1] = readFields<Utils::Get1Byte, Utils::Get2Byte, Utils::Get4Byte>(legacy);
+    }
+    report("Utils", "read", nowSecs() - start);
+
+    start = nowSecs();
+    for (int r = 0; r < kBenchRounds; r++)
+    {
+        sink += sums[2] = readFieldsReader(legacy);
+    }
+    report("ByteReader", "read", nowSecs() - start);
+
+    if ((sums[0] == 0) || (sums[1] != sums[0]) || (sums[2] != sums[0]))
+    {
+        printf("ERROR: messages read differently %x %x %x\n", sums[0], sums[1], sums[2]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,412 @@
+/**
+   \file vodVendorProbe.cpp
+   \class VodVendorProbe
+
+Implementation file for the back-end probing of the VOD controller factory
+*/
+
+#include <string.h>
+#include <time.h>
+#include <dlog.h>
+#include "pthread_named.h"
+
+#include "vodVendorProbe.h"
+#include "monotonicTime.h"
+
+#define LOG(level, msg, args...)  dlog(DL_MSP_ONDEMAND, level,"VodVendorProbe:%s:%d " msg, __FUNCTION__, __LINE__, ##args);
+
+VodVendorProbe* VodVendorProbe::mInstance = NULL;
+pthread_mutex_t VodVendorProbe::mInstanceMutex = PTHREAD_MUTEX_INITIALIZER;
+
+VodVendorProbe* VodVendorProbe::getInstance(void)
+{
+    pthread_mutex_lock(&mInstanceMutex);
+    if (mInstance == NULL)
+    {
+        mInstance = new VodVendorProbe();
+    }
+    pthread_mutex_unlock(&mInstanceMutex);
+    return mInstance;
+}
+
+VodVendorProbe::VodVendorProbe()
+{
+    pthread_condattr_t attr;
+
+    pthread_mutex_init(&mMutex, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&mCond, &attr);
+    pthread_condattr_destroy(&attr);
+    mThreads = 0;
+    mTimeoutMs = kVodProbeTimeoutMs;
+    memset(mProbes, 0, sizeof(mProbes));
+    memset(&mStats, 0, sizeof(mStats));
+}
+
+VodVendorProbe::~VodVendorProbe()
+{
+    // the probes in flight are bounded by their timeout
+    pthread_mutex_lock(&mMutex);
+    while (mThreads > 0)
+    {
+        pthread_cond_wait(&mCond, &mMutex);
+    }
+    pthread_mutex_unlock(&mMutex);
+
+    pthread_cond_destroy(&mCond);
+    pthread_mutex_destroy(&mMutex);
+}
+
+uint64_t VodVendorProbe::nowMs(void)
+{
+    return monotonicNowMs();
+}
+
+const char *VodVendorProbe::vendorName(eVodVendor vendor)
+{
+    switch (vendor)
+    {
+    case kVodVendor_SeaChange:
+        return "SeaChange";
+    case kVodVendor_Arris:
+        return "Arris";
+    case kVodVendor_CloudDvr:
+        return "CloudDvr";
+    default:
+        return "none";
+    }
+}
+
+void VodVendorProbe::setProbe(eVodVendor vendor, tVodVendorProbe probe)
+{
+    if ((vendor > kVodVendor_None) && (vendor < kVodVendor_Count))
+    {
+        pthread_mutex_lock(&mMutex);
+        mProbes[vendor] = probe;
+        pthread_mutex_unlock(&mMutex);
+    }
+}
+
+void VodVendorProbe::setTimeout(uint32_t timeoutMs)
+{
+    pthread_mutex_lock(&mMutex);
+    mTimeoutMs = timeoutMs;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void *VodVendorProbe::ProbeThread(void *arg)
+{
+    Probe *probe = (Probe *) arg;
+    Run *run = probe->run;
+    VodVendorProbe *owner = run->owner;
+    struct timespec start;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    bool ok = probe->probe(run->endpoint, run->timeoutMs);
+    uint32_t ms = monotonicElapsedMs(start);
+
+    pthread_mutex_lock(&owner->mMutex);
+    tVodVendorStats &stats = owner->mStats.vendor[probe->vendor];
+    if (ok)
+    {
+        stats.answered++;
+        stats.totalMs += ms;
+        if ((stats.answered == 1) || (ms < stats.minMs))
+        {
+            stats.minMs = ms;
+        }
+        if (ms > stats.maxMs)
+        {
+            stats.maxMs = ms;
+        }
+        run->answered |= kVodVendorBit(probe->vendor);
+        if (run->first == kVodVendor_None)
+        {
+            run->first = probe->vendor;
+        }
+    }
+    else if (ms >= run->timeoutMs)
+    {
+        stats.timeouts++;
+    }
+    else
+    {
+        stats.failed++;
+    }
+    LOG(DLOGL_NORMAL, "%s at %s: %s in %d ms", vendorName(probe->vendor), run->endpoint.c_str(), ok ? "answered" : "no answer", ms);
+
+    run->pending--;
+    if (ok || (run->pending == 0))
+    {
+        owner->store(run);
+    }
+    if (run->pending == 0)
+    {
+        std::map<std::string, Run *>::iterator itr = owner->mRuns.find(run->endpoint);
+        if ((itr != owner->mRuns.end()) && (itr->second == run))
+        {
+            owner->mRuns.erase(itr);
+        }
+    }
+    owner->releaseRun(run);
+    owner->mThreads--;
+    pthread_cond_broadcast(&owner->mCond);
+    pthread_mutex_unlock(&owner->mMutex);
+
+    delete probe;
+    return NULL;
+}
+
+// called with mMutex held
+VodVendorProbe::Run *VodVendorProbe::startRun(const std::string &endpoint, unsigned int candidates)
+{
+    std::map<std::string, Run *>::iterator itr = mRuns.find(endpoint);
+    if (itr != mRuns.end())
+    {
+        itr->second->refs++;
+        return itr->second;
+    }
+
+    Run *run = new Run;
+    run->owner = this;
+    run->endpoint = endpoint;
+    run->candidates = candidates;
+    run->pending = 0;
+    run->answered = 0;
+    run->first = kVodVendor_None;
+    run->timeoutMs = mTimeoutMs;
+    run->refs = 1;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    for (int vendor = 0; vendor < kVodVendor_Count; vendor++)
+    {
+        if (!(candidates & kVodVendorBit(vendor)) || (mProbes[vendor] == NULL))
+        {
+            continue;
+        }
+
+        Probe *probe = new Probe;
+        probe->run = run;
+        probe->vendor = (eVodVendor) vendor;
+        probe->probe = mProbes[vendor];
+
+        pthread_t thread;
+        if (pthread_create(&thread, &attr, ProbeThread, probe) != 0)
+        {
+            LOG(DLOGL_ERROR, ":%m: Error creating the %s probe thread", vendorName((eVodVendor) vendor));
+            delete probe;
+            continue;
+        }
+        pthread_setname_np(thread, "VOD Probe");
+        mStats.vendor[vendor].probes++;
+        run->pending++;
+        run->refs++;
+        mThreads++;
+    }
+    pthread_attr_destroy(&attr);
+
+    if (run->pending == 0)
+    {
+        delete run;
+        return NULL;
+    }
+    mRuns[endpoint] = run;
+    return run;
+}
+
+// called with mMutex held
+void VodVendorProbe::releaseRun(Run *run)
+{
+    if (--run->refs == 0)
+    {
+        delete run;
+    }
+}
+
+// called with mMutex held
+void VodVendorProbe::store(Run *run)
+{
+    Entry &entry = mEntries[run->endpoint];
+
+    entry.answered = run->answered;
+    entry.first = run->first;
+    entry.expiresMs = nowMs() + (uint64_t)(run->answered ? kVodProbeCacheSecs : kVodProbeNegativeSecs) * 1000;
+}
+
+eVodVendor VodVendorProbe::choose(unsigned int answered, eVodVendor first, eVodVendor configured)
+{
+    if ((configured != kVodVendor_None) && ((answered == 0) || (answered & kVodVendorBit(configured))))
+    {
+        return configured;
+    }
+    if ((first != kVodVendor_None) && (answered & kVodVendorBit(first)))
+    {
+        return first;
+    }
+    for (int vendor = 0; vendor < kVodVendor_Count; vendor++)
+    {
+        if (answered & kVodVendorBit(vendor))
+        {
+            return (eVodVendor) vendor;
+        }
+    }
+    return kVodVendor_None;
+}
+
+eVodVendor VodVendorProbe::select(const std::string &endpoint, eVodVendor configured, unsigned int candidates)
+{
+    unsigned int answered = 0;
+    eVodVendor first = kVodVendor_None;
+
+    pthread_mutex_lock(&mMutex);
+    std::map<std::string, Entry>::iterator itr = mEntries.find(endpoint);
+    if ((itr != mEntries.end()) && (nowMs() < itr->second.expiresMs))
+    {
+        mStats.cacheHits++;
+        answered = itr->second.answered;
+        first = itr->second.first;
+    }
+    else
+    {
+        mStats.cacheMisses++;
+        Run *run = startRun(endpoint, candidates);
+        if (run)
+        {
+            struct timespec deadline;
+            monotonicDeadlineIn(run->timeoutMs, &deadline);
+
+            // the configured vendor is waited for, or else the first to answer
+            while ((run->pending > 0) &&
+                    (((configured == kVodVendor_None) && (run->first == kVodVendor_None)) ||
+                     ((configured != kVodVendor_None) && !(run->answered & kVodVendorBit(configured)))))
+            {
+                if (pthread_cond_timedwait(&mCond, &mMutex, &deadline) != 0)
+                {
+                    break;
+                }
+            }
+            answered = run->answered;
+            first = run->first;
+            releaseRun(run);
+        }
+    }
+
+    eVodVendor vendor = choose(answered & candidates, first, configured);
+    if ((vendor != configured) && (vendor != kVodVendor_None))
+    {
+        mStats.vendor[vendor].wins++;
+    }
+    pthread_mutex_unlock(&mMutex);
+
+    if (vendor != configured)
+    {
+        LOG(DLOGL_SIGNIFICANT_EVENT, "%s: %s configured, %s answers", endpoint.c_str(), vendorName(configured), vendorName(vendor));
+    }
+    return vendor;
+}
+
+void VodVendorProbe::prefetch(const std::string &endpoint, unsigned int candidates)
+{
+    pthread_mutex_lock(&mMutex);
+    std::map<std::string, Entry>::iterator itr = mEntries.find(endpoint);
+    if ((itr == mEntries.end()) || (nowMs() >= itr->second.expiresMs))
+    {
+        Run *run = startRun(endpoint, candidates);
+        if (run)
+        {
+            releaseRun(run);
+        }
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+void VodVendorProbe::invalidate(const std::string &endpoint)
+{
+    pthread_mutex_lock(&mMutex);
+    mEntries.erase(endpoint);
+    pthread_mutex_unlock(&mMutex);
+}
+
+eVodVendor VodVendorProbe::cached(const std::string &endpoint)
+{
+    eVodVendor vendor = kVodVendor_None;
+
+    pthread_mutex_lock(&mMutex);
+    std::map<std::string, Entry>::iterator itr = mEntries.find(endpoint);
+    if ((itr != mEntries.end()) && (nowMs() < itr->second.expiresMs))
+    {
+        vendor = choose(itr->second.answered, itr->second.first, kVodVendor_None);
+    }
+    pthread_mutex_unlock(&mMutex);
+    return vendor;
+}
+
+bool VodVendorProbe::down(const std::string &endpoint)
+{
+    bool noAnswer = false;
+
+    pthread_mutex_lock(&mMutex);
+    std::map<std::string, Entry>::iterator itr = mEntries.find(endpoint);
+    if ((itr != mEntries.end()) && (nowMs() < itr->second.expiresMs))
+    {
+        noAnswer = (itr->second.answered == 0);
+    }
+    pthread_mutex_unlock(&mMutex);
+    return noAnswer;
+}
+
+void VodVendorProbe::recordSetup(eVodVendor vendor, uint32_t ms, bool ok)
+{
+    if ((vendor <= kVodVendor_None) || (vendor >= kVodVendor_Count))
+    {
+        return;
+    }
+
+    pthread_mutex_lock(&mMutex);
+    tVodVendorStats &stats = mStats.vendor[vendor];
+    if (ok)
+    {
+        stats.setups++;
+        stats.setupTotalMs += ms;
+        if (ms > stats.setupMaxMs)
+        {
+            stats.setupMaxMs = ms;
+        }
+    }
+    else
+    {
+        stats.setupFailures++;
+    }
+    pthread_mutex_unlock(&mMutex);
+}
+
+void VodVendorProbe::getStats(tVodProbeStats *stats)
+{
+    pthread_mutex_lock(&mMutex);
+    *stats = mStats;
+    pthread_mutex_unlock(&mMutex);
+}
+
+void VodVendorProbe::logStats(void)
+{
+    tVodProbeStats stats;
+
+    getStats(&stats);
+    LOG(DLOGL_NORMAL, "cacheHits:%d cacheMisses:%d", stats.cacheHits, stats.cacheMisses);
+    for (int vendor = 0; vendor < kVodVendor_Count; vendor++)
+    {
+        tVodVendorStats &vs = stats.vendor[vendor];
+        if (vs.probes || vs.setups || vs.setupFailures)
+        {
+            LOG(DLOGL_NORMAL, "%s probes:%d answered:%d failed:%d timeouts:%d wins:%d probe ms avg:%d min:%d max:%d",
+                vendorName((eVodVendor) vendor), vs.probes, vs.answered, vs.failed, vs.timeouts, vs.wins,
+                vs.answered ? (unsigned int)(vs.totalMs / vs.answered) : 0, vs.minMs, vs.maxMs);
+            LOG(DLOGL_NORMAL, "%s setups:%d failures:%d setup ms avg:%d max:%d",
+                vendorName((eVodVendor) vendor), vs.setups, vs.setupFailures,
+                vs.setups ? (unsigned int)(vs.setupTotalMs / vs.setups) : 0, vs.setupMaxMs);
+        }
+    }
+}
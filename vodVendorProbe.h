@@ -0,0 +1,160 @@
+/**
+   \file vodVendorProbe.h
+   \class VodVendorProbe
+
+   Back-end probing for the VOD controller factory.
+
+   The first session to a head-end does not wait for a back-end that does not
+   answer: the probe functions of the candidate vendors are run concurrently,
+   each in its own thread and bounded by kVodProbeTimeoutMs, and the vendors
+   that answered are kept per head-end address (SRM or Cloud DVR RTSP server)
+   for kVodProbeCacheSecs, kVodProbeNegativeSecs when none did.  prefetch()
+   probes in the background, as the VOD controller factory does for the SRM at
+   boot and as sessions are set up, and down() tells from the cache alone that
+   the head-end did not answer: OnDemand then fails the session at once
+   instead of waiting for the setup timeout.  select() is for the callers
+   that choose among several vendors, none does yet: answered from the cache,
+   or probing and waiting, it keeps the configured vendor when that one
+   answered and otherwise takes the first vendor to answer.
+
+   The latency of each vendor is kept from the probes and from the session
+   setups reported with recordSetup(), for the diagnostics of mixed-vendor
+   head-ends.
+*/
+
+#if !defined(VOD_VENDOR_PROBE_H)
+#define VOD_VENDOR_PROBE_H
+
+#include <stdint.h>
+#include <string>
+#include <map>
+#include <pthread.h>
+
+#define kVodProbeTimeoutMs          1500
+#define kVodProbeCacheSecs          3600
+#define kVodProbeNegativeSecs       30
+
+typedef enum
+{
+    kVodVendor_None = -1,
+    kVodVendor_SeaChange,
+    kVodVendor_Arris,
+    kVodVendor_CloudDvr,
+    kVodVendor_Count
+} eVodVendor;
+
+#define kVodVendorBit(vendor)       (1u << (vendor))
+
+/// Whether the back-end of the vendor answers at endpoint ("host:port") within timeoutMs
+typedef bool (*tVodVendorProbe)(const std::string &endpoint, uint32_t timeoutMs);
+
+typedef struct
+{
+    unsigned int probes;
+    unsigned int answered;
+    unsigned int failed;        ///< said no before the timeout
+    unsigned int timeouts;
+    unsigned int wins;          ///< selected without being configured
+    unsigned int minMs;         ///< of the probes answered
+    unsigned int maxMs;
+    uint64_t     totalMs;
+    unsigned int setups;        ///< session setups confirmed
+    unsigned int setupFailures;
+    unsigned int setupMaxMs;
+    uint64_t     setupTotalMs;
+} tVodVendorStats;
+
+typedef struct
+{
+    unsigned int cacheHits;
+    unsigned int cacheMisses;
+    tVodVendorStats vendor[kVodVendor_Count];
+} tVodProbeStats;
+
+class VodVendorProbe
+{
+public:
+    /// The probe shared by the VOD controller factory
+    static VodVendorProbe* getInstance(void);
+
+    VodVendorProbe();
+    virtual ~VodVendorProbe();
+
+    /// Probe function of vendor, NULL when the vendor is not probed
+    void setProbe(eVodVendor vendor, tVodVendorProbe probe);
+    void setTimeout(uint32_t timeoutMs);
+
+    /// Vendor for endpoint among candidates (kVodVendorBit() mask), probing them when nothing is cached.
+    /// configured is kept when it answered or nothing did, kVodVendor_None when not configured
+    eVodVendor select(const std::string &endpoint, eVodVendor configured, unsigned int candidates);
+    /// Probes candidates of endpoint in the background if nothing is cached for it
+    void prefetch(const std::string &endpoint, unsigned int candidates);
+    /// Forgets endpoint, as when a session set up with the selected vendor failed
+    void invalidate(const std::string &endpoint);
+    /// Vendor selected last for endpoint, kVodVendor_None when not known
+    eVodVendor cached(const std::string &endpoint);
+    /// True when the last probe of endpoint, still cached, had no vendor answering
+    bool down(const std::string &endpoint);
+    /// A session setup with vendor took ms until its confirm, or failed
+    void recordSetup(eVodVendor vendor, uint32_t ms, bool ok);
+
+    void getStats(tVodProbeStats *stats);
+    void logStats(void);
+
+    static const char *vendorName(eVodVendor vendor);
+
+protected:
+    /// Monotonic clock in ms, overridden by the unit test
+    virtual uint64_t nowMs(void);
+
+private:
+    struct Entry
+    {
+        unsigned int    answered;       ///< kVodVendorBit() of the vendors that answered
+        eVodVendor      first;          ///< first to answer
+        uint64_t        expiresMs;
+    };
+
+    /// One probe of an endpoint, shared by its threads and the callers waiting for it
+    struct Run
+    {
+        VodVendorProbe  *owner;
+        std::string     endpoint;
+        unsigned int    candidates;
+        unsigned int    pending;        ///< probes not done yet
+        unsigned int    answered;
+        eVodVendor      first;
+        uint32_t        timeoutMs;
+        unsigned int    refs;
+    };
+
+    struct Probe
+    {
+        Run             *run;
+        eVodVendor      vendor;
+        tVodVendorProbe probe;
+    };
+
+    static void *ProbeThread(void *arg);
+    Run *startRun(const std::string &endpoint, unsigned int candidates);
+    void releaseRun(Run *run);
+    void store(Run *run);
+    eVodVendor choose(unsigned int answered, eVodVendor first, eVodVendor configured);
+
+    pthread_mutex_t mMutex;
+    pthread_cond_t  mCond;
+    unsigned int    mThreads;       ///< probe threads running
+    uint32_t        mTimeoutMs;
+    tVodVendorProbe mProbes[kVodVendor_Count];
+    std::map<std::string, Entry> mEntries;
+    std::map<std::string, Run *> mRuns;     ///< probes in flight
+    tVodProbeStats  mStats;
+
+    static VodVendorProbe *mInstance;
+    static pthread_mutex_t mInstanceMutex;
+
+    VodVendorProbe(const VodVendorProbe&);
+    VodVendorProbe& operator=(const VodVendorProbe&);
+};
+
+#endif
@@ -0,0 +1,235 @@
+/**
+
+\file vodVendorProbe_test.h -- contains the cxxtest test cases for the VOD back-end probing
+
+The probes are stubs that answer after the delay and with the result the test
+gives each vendor; the cache runs on a clock the test sets.
+*/
+
+#if !defined(VOD_VENDOR_PROBE_TEST_H)
+#define VOD_VENDOR_PROBE_TEST_H
+
+#include <cxxtest/TestSuite.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "vodVendorProbe.h"
+
+#define kTestProbeTimeoutMs     300
+
+static volatile int gProbeCalls[kVodVendor_Count];
+static volatile bool gProbeAnswers[kVodVendor_Count];
+static volatile unsigned int gProbeDelayMs[kVodVendor_Count];
+
+static bool stubProbe(eVodVendor vendor, uint32_t timeoutMs)
+{
+    __sync_fetch_and_add(&gProbeCalls[vendor], 1);
+    unsigned int delayMs = gProbeDelayMs[vendor];
+    usleep(((delayMs < timeoutMs) ? delayMs : timeoutMs) * 1000);
+    return gProbeAnswers[vendor] && (delayMs < timeoutMs);
+}
+
+static bool seaChangeProbe(const std::string &endpoint, uint32_t timeoutMs)
+{
+    (void) endpoint;
+    return stubProbe(kVodVendor_SeaChange, timeoutMs);
+}
+
+static bool arrisProbe(const std::string &endpoint, uint32_t timeoutMs)
+{
+    (void) endpoint;
+    return stubProbe(kVodVendor_Arris, timeoutMs);
+}
+
+class TestVodVendorProbe : public VodVendorProbe
+{
+public:
+    TestVodVendorProbe() : mNow(1000000)
+    {
+        setProbe(kVodVendor_SeaChange, seaChangeProbe);
+        setProbe(kVodVendor_Arris, arrisProbe);
+        setTimeout(kTestProbeTimeoutMs);
+        for (int vendor = 0; vendor < kVodVendor_Count; vendor++)
+        {
+            gProbeCalls[vendor] = 0;
+            gProbeAnswers[vendor] = true;
+            gProbeDelayMs[vendor] = 10;
+        }
+    }
+
+    volatile uint64_t mNow;
+
+protected:
+    uint64_t nowMs(void)
+    {
+        return mNow;
+    }
+};
+
+#define kTestSrm        "10.1.2.3:13819"
+#define kTestDsmcc      (kVodVendorBit(kVodVendor_SeaChange) | kVodVendorBit(kVodVendor_Arris))
+
+class vodVendorProbeTestSuite : public CxxTest::TestSuite
+{
+    static double nowMs(void)
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (ts.tv_sec * 1e3) + (ts.tv_nsec / 1e6);
+    }
+
+    // waits until the probes in the background are done
+    static void waitProbes(VodVendorProbe &probe, unsigned int done)
+    {
+        tVodProbeStats stats;
+
+        for (int i = 0; i < 200; i++)
+        {
+            probe.getStats(&stats);
+            unsigned int count = 0;
+            for (int vendor = 0; vendor < kVodVendor_Count; vendor++)
+            {
+                count += stats.vendor[vendor].answered + stats.vendor[vendor].failed + stats.vendor[vendor].timeouts;
+            }
+            if (count >= done)
+            {
+                return;
+            }
+            usleep(5000);
+        }
+    }
+
+public:
+
+    void testConfiguredKept()
+    {
+        TestVodVendorProbe probe;
+        tVodProbeStats stats;
+
+        gProbeDelayMs[kVodVendor_Arris] = 50;
+        TS_ASSERT_EQUALS(probe.select(kTestSrm, kVodVendor_Arris, kTestDsmcc), kVodVendor_Arris);
+        waitProbes(probe, 2);
+
+        // from the cache from now on
+        TS_ASSERT_EQUALS(probe.select(kTestSrm, kVodVendor_Arris, kTestDsmcc), kVodVendor_Arris);
+        TS_ASSERT_EQUALS(gProbeCalls[kVodVendor_Arris], 1);
+        probe.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.cacheHits, 1u);
+        TS_ASSERT_EQUALS(stats.cacheMisses, 1u);
+        TS_ASSERT_EQUALS(stats.vendor[kVodVendor_Arris].answered, 1u);
+        TS_ASSERT(stats.vendor[kVodVendor_Arris].minMs >= 40);
+        TS_ASSERT_EQUALS(stats.vendor[kVodVendor_Arris].wins, 0u);
+    }
+
+    void testFailedBackEndReplaced()
+    {
+        TestVodVendorProbe probe;
+        tVodProbeStats stats;
+
+        // configured Arris does not answer: SeaChange is taken within the timeout
+        gProbeAnswers[kVodVendor_Arris] = false;
+        gProbeDelayMs[kVodVendor_Arris] = 1000;
+        double start = nowMs();
+        TS_ASSERT_EQUALS(probe.select(kTestSrm, kVodVendor_Arris, kTestDsmcc), kVodVendor_SeaChange);
+        TS_ASSERT(nowMs() - start < kTestProbeTimeoutMs + 100);
+        waitProbes(probe, 2);
+        TS_ASSERT_EQUALS(probe.cached(kTestSrm), kVodVendor_SeaChange);
+
+        probe.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.vendor[kVodVendor_Arris].timeouts, 1u);
+        TS_ASSERT_EQUALS(stats.vendor[kVodVendor_SeaChange].wins, 1u);
+    }
+
+    void testNotConfiguredFirstToAnswer()
+    {
+        TestVodVendorProbe probe;
+
+        gProbeDelayMs[kVodVendor_SeaChange] = 100;
+        double start = nowMs();
+        TS_ASSERT_EQUALS(probe.select(kTestSrm, kVodVendor_None, kTestDsmcc), kVodVendor_Arris);
+        TS_ASSERT(nowMs() - start < 90);
+        waitProbes(probe, 2);
+    }
+
+    void testNoAnswer()
+    {
+        TestVodVendorProbe probe;
+
+        gProbeAnswers[kVodVendor_SeaChange] = false;
+        gProbeAnswers[kVodVendor_Arris] = false;
+        TS_ASSERT_EQUALS(probe.select(kTestSrm, kVodVendor_SeaChange, kTestDsmcc), kVodVendor_SeaChange);
+        TS_ASSERT_EQUALS(probe.select(kTestSrm, kVodVendor_None, kTestDsmcc), kVodVendor_None);
+        TS_ASSERT_EQUALS(gProbeCalls[kVodVendor_SeaChange], 1);
+
+        // the negative result is not kept long
+        gProbeAnswers[kVodVendor_Arris] = true;
+        probe.mNow += kVodProbeNegativeSecs * 1000;
+        TS_ASSERT_EQUALS(probe.select(kTestSrm, kVodVendor_None, kTestDsmcc), kVodVendor_Arris);
+        waitProbes(probe, 4);
+    }
+
+    void testDown()
+    {
+        TestVodVendorProbe probe;
+
+        // not known until a probe is done, and down() does not probe
+        TS_ASSERT(!probe.down(kTestSrm));
+        TS_ASSERT_EQUALS(gProbeCalls[kVodVendor_SeaChange], 0);
+
+        gProbeAnswers[kVodVendor_SeaChange] = false;
+        probe.prefetch(kTestSrm, kVodVendorBit(kVodVendor_SeaChange));
+        waitProbes(probe, 1);
+        TS_ASSERT(probe.down(kTestSrm));
+
+        // the negative result expires, an answer clears it
+        probe.mNow += kVodProbeNegativeSecs * 1000;
+        TS_ASSERT(!probe.down(kTestSrm));
+        gProbeAnswers[kVodVendor_SeaChange] = true;
+        probe.prefetch(kTestSrm, kVodVendorBit(kVodVendor_SeaChange));
+        waitProbes(probe, 2);
+        TS_ASSERT(!probe.down(kTestSrm));
+        TS_ASSERT_EQUALS(probe.cached(kTestSrm), kVodVendor_SeaChange);
+    }
+
+    void testPrefetchAndInvalidate()
+    {
+        TestVodVendorProbe probe;
+        tVodProbeStats stats;
+
+        probe.prefetch(kTestSrm, kTestDsmcc);
+        probe.prefetch(kTestSrm, kTestDsmcc);
+        waitProbes(probe, 2);
+        TS_ASSERT_EQUALS(gProbeCalls[kVodVendor_SeaChange], 1);
+        TS_ASSERT_EQUALS(probe.select(kTestSrm, kVodVendor_SeaChange, kTestDsmcc), kVodVendor_SeaChange);
+
+        probe.invalidate(kTestSrm);
+        TS_ASSERT_EQUALS(probe.cached(kTestSrm), kVodVendor_None);
+        TS_ASSERT_EQUALS(probe.select(kTestSrm, kVodVendor_SeaChange, kTestDsmcc), kVodVendor_SeaChange);
+        waitProbes(probe, 4);
+        TS_ASSERT_EQUALS(gProbeCalls[kVodVendor_SeaChange], 2);
+
+        probe.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.cacheHits, 1u);
+        TS_ASSERT_EQUALS(stats.cacheMisses, 1u);
+    }
+
+    void testSetupLatency()
+    {
+        TestVodVendorProbe probe;
+        tVodProbeStats stats;
+
+        probe.recordSetup(kVodVendor_Arris, 120, true);
+        probe.recordSetup(kVodVendor_Arris, 80, true);
+        probe.recordSetup(kVodVendor_Arris, 0, false);
+        probe.recordSetup(kVodVendor_None, 10, true);
+
+        probe.getStats(&stats);
+        TS_ASSERT_EQUALS(stats.vendor[kVodVendor_Arris].setups, 2u);
+        TS_ASSERT_EQUALS(stats.vendor[kVodVendor_Arris].setupFailures, 1u);
+        TS_ASSERT_EQUALS(stats.vendor[kVodVendor_Arris].setupTotalMs, 200u);
+        TS_ASSERT_EQUALS(stats.vendor[kVodVendor_Arris].setupMaxMs, 120u);
+        TS_ASSERT_EQUALS(stats.vendor[kVodVendor_SeaChange].setups, 0u);
+    }
+};
+
+#endif
@@ -38,8 +38,8 @@ Implementation file for zapper media controller class
 #include "psi.h"
 #include "languageSelection.h"
 #include "eventQueue.h"
+#include "MSPWorkerPool.h"
 #include "MSPRFSource.h"
-#include"pthread_named.h"
 #include "AnalogPsi.h"
 
 #ifdef LOG
@@ -65,40 +65,37 @@ bool Zapper::mEasAudioActive = false;
 
 /** *********************************************************
 */
-void* Zapper::eventthreadFunc(void *data)
+bool Zapper::eventHandler(void *data, Event *evt)
 {
-    // This is a static method running in a pthread and does not have
+    // This is a static method running on an MSP worker pool thread and does not have
     // direct access to class variables.  Access is through data pointer.
 
-    FNLOG(DL_MSP_ZAPPER);
-
     Zapper*     inst        = (Zapper*)data;
     MSPEventQueue* eventQueue  = inst->threadEventQueue;
     assert(eventQueue);
 
-    bool done = false;
-    while (!done)
+    inst->lockMutex();
+    bool done = inst->handleEvent(evt);  // call member function to handle event
+    eventQueue->freeEvent(evt);
+    inst->unLockMutex();
+
+    return done;
+}
+
+unsigned int Zapper::eventIdleTimeout(void *data)
+{
+    Zapper* inst = (Zapper*)data;
+    unsigned int waitTime = 0;
+
+    if (inst->state == kZapperWaitSourceReady)
     {
-        unsigned int waitTime = 0;
-        if (inst->state == kZapperWaitSourceReady)
-        {
-            waitTime = 5;
-            LOG(DLOGL_REALLY_NOISY, "Wait %d seconds for tuner lock", waitTime);
-        }
-        eventQueue->setTimeOutSecs(waitTime);
-        Event* evt = eventQueue->popEventQueue();
-        eventQueue->unSetTimeOut();
-        inst->lockMutex();
-        done = inst->handleEvent(evt);  // call member function to handle event
-        eventQueue->freeEvent(evt);
-        inst->unLockMutex();
+        waitTime = 5;
+        LOG(DLOGL_REALLY_NOISY, "Wait %d seconds for tuner lock", waitTime);
     }
-
-    LOG(DLOGL_REALLY_NOISY, "pthread_exit");
-    pthread_exit(NULL);
-    return NULL;
+    return waitTime;
 }
 
+
 /** *********************************************************
 */
 void Zapper::displaySessionCallbackFunction(eIMediaPlayerSignal sig, eIMediaPlayerStatus stat)
@@ -872,7 +869,7 @@ eIMediaPlayerStatus Zapper::loadSource()
         LOG(DLOGL_ERROR, "load failed");
         mediaPlayerStatus = kMediaPlayerStatus_Error_InvalidURL;
     }
-    else if (eventHandlerThread == 0)
+    else if (eventStrand == NULL)
     {
         int err = createEventThread();
         if (!err)
@@ -898,27 +895,11 @@ eIMediaPlayerStatus Zapper::loadSource()
 // return 0 on success
 int Zapper::createEventThread()
 {
-    pthread_attr_t attr;
-    pthread_attr_init(&attr);
-    pthread_attr_setstacksize(&attr, (128 * 1024));
+    // events are handled on the shared MSP worker pool, serially for this instance
+    eventStrand = new MSPStrand("MSP_Zapper_EvntHandlr", threadEventQueue, eventHandler, eventIdleTimeout, (void *) this);
+    eventStrand->start();
 
-    // By default the thread is created as joinable.
-    int err  = pthread_create(&eventHandlerThread, &attr, eventthreadFunc, (void *) this);
-    if (!err)
-    {
-        // failing to set name is not considered an major error
-        int retval = pthread_setname_np(eventHandlerThread, "MSP_Zapper_EvntHandlr");
-        if (retval)
-        {
-            LOG(DLOGL_ERROR, "pthread_setname_np error: %d", retval);
-        }
-    }
-    else
-    {
-        LOG(DLOGL_ERROR, "pthread_create error %d", err);
-    }
-
-    return err;
+    return 0;
 }
 
 void Zapper::tearDown()
@@ -969,19 +950,20 @@ void Zapper::Eject()
 
 
 
-    if (eventHandlerThread)
+    if (eventStrand)
     {
-        LOG(DLOGL_REALLY_NOISY, "exit thread");
-        queueEvent(kZapperEventExit);  // tell thread to exit first. so that, it don't process any stale callbacks from core modules,that may come during the process of teardown.
+        LOG(DLOGL_REALLY_NOISY, "exit strand");
+        queueEvent(kZapperEventExit);  // tell strand to exit first. so that, it don't process any stale callbacks from core modules,that may come during the process of teardown.
         unLockMutex();
-        pthread_join(eventHandlerThread, NULL);       // wait for event thread to exit
+        eventStrand->join();       // wait for exit event to be handled
+        delete eventStrand;
         lockMutex();
-        eventHandlerThread = 0;
+        eventStrand = NULL;
         tearDown();
     }
     else
     {
-        LOG(DLOGL_REALLY_NOISY, "eventHandlerThread null");
+        LOG(DLOGL_REALLY_NOISY, "eventStrand null");
     }
 
 }
@@ -1300,8 +1282,17 @@ Zapper::Zapper(bool isVod, IMediaPlayerSession *pIMediaPlayerSession)
 
     // create event queue for scan thread
     threadEventQueue = new MSPEventQueue();
-
-    eventHandlerThread = 0;
+    // exit must not wait behind a burst of PSI/SDV updates, and only the latest
+    // update of each kind is worth acting on (each one restarts the display)
+    threadEventQueue->setEventPriority(kZapperEventExit, kMSPEventPriorityHigh);
+    threadEventQueue->setEventPriority(kZapperPSIUpdateEvent, kMSPEventPriorityLow);
+    threadEventQueue->setEventCoalescing(kZapperPSIUpdateEvent, true);
+    threadEventQueue->setEventPriority(kZapperPmtRevUpdateEvent, kMSPEventPriorityLow);
+    threadEventQueue->setEventCoalescing(kZapperPmtRevUpdateEvent, true);
+    threadEventQueue->setEventPriority(kZapperEventSDVKeepAliveNeeded, kMSPEventPriorityLow);
+    threadEventQueue->setEventCoalescing(kZapperEventSDVKeepAliveNeeded, true);
+
+    eventStrand = NULL;
 
     screenRect.x = 0;
     screenRect.y = 0;
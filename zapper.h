@@ -29,6 +29,7 @@
 #include <directfb.h>
 class DisplaySession;
 class MSPEventQueue;
+class MSPStrand;
 class Event;
 
 
@@ -188,7 +189,8 @@ protected:
     } eZapperEvent;
 
     eMspStatus queueEvent(eZapperEvent evtyp);
-    static void* eventthreadFunc(void *data);
+    static bool eventHandler(void *data, Event *evt);
+    static unsigned int eventIdleTimeout(void *data);
     int  createEventThread();
     virtual bool handleEvent(Event *evt);
     MSPSource *mSource;
@@ -234,7 +236,7 @@ private:
 
     std::string dest_url;  /**< destination url as passed to Play */
     MSPEventQueue* threadEventQueue;
-    pthread_t eventHandlerThread;
+    MSPStrand* eventStrand;             // runs threadEventQueue on the shared MSP worker pool
     pthread_mutex_t  mMutex;
     CCIcallback_t mCCICBFn;
     std::list<CallbackInfo*> mCallbackList;